@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace impulse::frontend {
+
+// Runs a node's destructor and leaves its memory to the arena it came from
+struct AstDelete {
+    template <typename T>
+    void operator()(T* node) const {
+        node->~T();
+    }
+};
+
+template <typename T>
+using AstPtr = std::unique_ptr<T, AstDelete>;
+
+// Monotonic allocator for the nodes of one module's syntax tree: they are bumped out of a few
+// large blocks in parse order, next to each other, and the blocks are freed together when the
+// arena goes (see Module::arena). Dropping a node runs its destructor for the strings and
+// vectors it holds, but gives nothing back. Not thread-safe; one parser fills it.
+class AstArena {
+public:
+    AstArena() = default;
+    // The first block is sized for this many bytes of nodes
+    explicit AstArena(std::size_t expected_bytes) : next_block_bytes_(std::max(expected_bytes, kMinBlockBytes)) {}
+
+    AstArena(const AstArena&) = delete;
+    auto operator=(const AstArena&) -> AstArena& = delete;
+    AstArena(AstArena&&) = delete;
+    auto operator=(AstArena&&) -> AstArena& = delete;
+
+    template <typename T, typename... Args>
+    [[nodiscard]] auto make(Args&&... args) -> AstPtr<T> {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return AstPtr<T>(new (memory) T(std::forward<Args>(args)...));
+    }
+
+    [[nodiscard]] auto allocate(std::size_t bytes, std::size_t alignment) -> void* {
+        auto address = reinterpret_cast<std::uintptr_t>(next_);
+        std::size_t padding = (alignment - address % alignment) % alignment;
+        if (next_ == nullptr || padding + bytes > static_cast<std::size_t>(end_ - next_)) {
+            add_block(bytes + alignment);
+            address = reinterpret_cast<std::uintptr_t>(next_);
+            padding = (alignment - address % alignment) % alignment;
+        }
+        std::byte* result = next_ + padding;
+        next_ = result + bytes;
+        used_ += bytes;
+        return result;
+    }
+
+    // Bytes handed out, and bytes held in blocks
+    [[nodiscard]] auto bytes_used() const -> std::size_t { return used_; }
+    [[nodiscard]] auto bytes_reserved() const -> std::size_t { return reserved_; }
+
+private:
+    static constexpr std::size_t kMinBlockBytes = std::size_t{16} * 1024;
+    static constexpr std::size_t kMaxBlockBytes = std::size_t{1024} * 1024;
+
+    void add_block(std::size_t at_least) {
+        const std::size_t size = std::max(next_block_bytes_, at_least);
+        blocks_.emplace_back(new std::byte[size]);  // not zeroed: pages fault in as nodes reach them
+        next_ = blocks_.back().get();
+        end_ = next_ + size;
+        reserved_ += size;
+        next_block_bytes_ = std::min(next_block_bytes_ * 2, kMaxBlockBytes);
+    }
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::byte* next_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::size_t next_block_bytes_ = kMinBlockBytes;
+    std::size_t used_ = 0;
+    std::size_t reserved_ = 0;
+};
+
+}  // namespace impulse::frontend
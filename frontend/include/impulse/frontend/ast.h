@@ -4,8 +4,11 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "impulse/frontend/arena.h"
+
 namespace impulse::frontend {
 
 struct SourceLocation {
@@ -50,6 +53,7 @@ struct Expression {
         Binary,
         Unary,
         Call,
+        Field,  // operand.identifier
     };
 
     enum class LiteralKind : std::uint8_t {
@@ -87,11 +91,11 @@ struct Expression {
     Identifier identifier;
     BinaryOperator binary_operator = BinaryOperator::Add;
     UnaryOperator unary_operator = UnaryOperator::LogicalNot;
-    std::unique_ptr<Expression> left;
-    std::unique_ptr<Expression> right;
-    std::unique_ptr<Expression> operand;
+    AstPtr<Expression> left;
+    AstPtr<Expression> right;
+    AstPtr<Expression> operand;
     std::string callee;
-    std::vector<std::unique_ptr<Expression>> arguments;
+    std::vector<AstPtr<Expression>> arguments;
 };
 
 struct Parameter {
@@ -110,7 +114,7 @@ struct BindingDecl {
     Identifier name;
     Identifier type_name;
     Snippet initializer;
-    std::unique_ptr<Expression> initializer_expr;
+    AstPtr<Expression> initializer_expr;
 };
 
 struct Statement {
@@ -123,23 +127,25 @@ struct Statement {
         Break,
         Continue,
         ExprStmt,
-        Assign,  // x = expr;
+        Assign,       // x = expr;
+        FieldAssign,  // object.field = expr;
     } kind = Kind::Return;
 
     SourceLocation location;
-    std::unique_ptr<Expression> return_expression;
+    AstPtr<Expression> return_expression;
     BindingDecl binding;
     
-    std::unique_ptr<Expression> condition;
+    AstPtr<Expression> condition;
     std::vector<Statement> then_body;
     std::vector<Statement> else_body;
-    std::unique_ptr<Expression> expr;
-    std::unique_ptr<Statement> for_initializer;
-    std::unique_ptr<Statement> for_increment;
+    AstPtr<Expression> expr;
+    AstPtr<Statement> for_initializer;
+    AstPtr<Statement> for_increment;
     
-    // For Assign statement
+    // For Assign statement (the field, for FieldAssign)
     Identifier assign_target;
-    std::unique_ptr<Expression> assign_value;
+    AstPtr<Expression> assign_value;
+    AstPtr<Expression> assign_object;  // FieldAssign only
 };
 
 struct FunctionBody {
@@ -184,7 +190,30 @@ struct Declaration {
     InterfaceDecl interface_decl;
 };
 
+// Expression and statement nodes live in `arena`, which the module keeps alive; they must not
+// be moved out of a module that goes away before them.
 struct Module {
+    Module() = default;
+    Module(const Module&) = delete;
+    auto operator=(const Module&) -> Module& = delete;
+    Module(Module&&) noexcept = default;
+    ~Module() = default;
+
+    // Member-wise assignment would replace the arena first, freeing it while the old declarations
+    // still point into it; they are dropped before it instead
+    auto operator=(Module&& other) noexcept -> Module& {
+        if (this != &other) {
+            declarations.clear();
+            imports.clear();
+            arena = std::move(other.arena);
+            decl = std::move(other.decl);
+            imports = std::move(other.imports);
+            declarations = std::move(other.declarations);
+        }
+        return *this;
+    }
+
+    std::shared_ptr<AstArena> arena;  // first, so it outlives the declarations
     ModuleDecl decl;
     std::vector<ImportDecl> imports;
     std::vector<Declaration> declarations;
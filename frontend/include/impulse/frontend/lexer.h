@@ -2,7 +2,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace impulse::frontend {
@@ -77,14 +79,29 @@ enum class TokenKind : std::uint8_t {
 
 struct Token {
     TokenKind kind;
-    std::string lexeme;
+    // A view of the lexer's source; for string literals their value (unquoted, escapes decoded),
+    // for errors the message. Valid as long as the Lexer that produced it.
+    std::string_view lexeme;
     size_t line;
     size_t column;
 };
 
+// Tokens view the source the lexer keeps, so identifiers and numbers cost no allocation; only
+// string literals with escapes get a decoded copy. Tokens are produced on demand by next(), or
+// all at once by tokenize().
 class Lexer {
    public:
     explicit Lexer(std::string source);
+
+    // Tokens point into the lexer
+    Lexer(const Lexer&) = delete;
+    auto operator=(const Lexer&) -> Lexer& = delete;
+    Lexer(Lexer&&) = delete;
+    auto operator=(Lexer&&) -> Lexer& = delete;
+
+    // The next token; EndOfFile at the end of the source, as often as it is called
+    [[nodiscard]] auto next() -> Token;
+    // The tokens not read yet, ending with EndOfFile
     [[nodiscard]] auto tokenize() -> std::vector<Token>;
 
    private:
@@ -99,13 +116,13 @@ class Lexer {
     [[nodiscard]] auto match(char expected) -> bool;
     [[nodiscard]] auto isAtEnd() const -> bool;
     void skipTrivia();
-    void lexIdentifier(std::vector<Token>& tokens, SourceLocation location, size_t startIndex);
-    void lexNumber(std::vector<Token>& tokens, SourceLocation location, size_t startIndex);
-    void lexString(std::vector<Token>& tokens, SourceLocation location);
-    void pushToken(std::vector<Token>& tokens, TokenKind kind, std::string lexeme, SourceLocation location);
-    [[nodiscard]] auto slice(size_t startIndex) const -> std::string;
+    [[nodiscard]] auto lexIdentifier(SourceLocation location, size_t startIndex) -> Token;
+    [[nodiscard]] auto lexNumber(SourceLocation location, size_t startIndex) -> Token;
+    [[nodiscard]] auto lexString(SourceLocation location) -> Token;
+    [[nodiscard]] auto slice(size_t startIndex) const -> std::string_view;
 
     std::string source_;
+    std::deque<std::string> decoded_;  // values of string literals with escapes; never moved
     size_t current_ = 0;
     size_t line_ = 1;
     size_t column_ = 1;
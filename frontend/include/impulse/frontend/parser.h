@@ -1,7 +1,9 @@
 #pragma once
 
+#include <deque>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "impulse/frontend/ast.h"
 #include "impulse/frontend/lexer.h"
@@ -14,6 +16,11 @@ class Parser {
     [[nodiscard]] auto parseModule() -> ParseResult;
 
    private:
+    // Pulls the token after the buffered ones from the lexer
+    void pull();
+    void recordLexerError(const Token& token);
+    // Drops the buffered tokens before previous(); no snippet or backtrack may reach them
+    void discardConsumed();
     auto advance() -> const Token&;
     [[nodiscard]] auto peek() const -> const Token&;
     [[nodiscard]] auto previous() const -> const Token&;
@@ -39,11 +46,11 @@ class Parser {
     [[nodiscard]] auto parseInterfaceMethod() -> std::optional<InterfaceMethod>;
     [[nodiscard]] auto parseParameterList() -> std::vector<Parameter>;
     [[nodiscard]] auto parsePath(const char* context) -> std::vector<Identifier>;
-    [[nodiscard]] auto parseExpression() -> std::unique_ptr<Expression>;
-    [[nodiscard]] auto parseBinaryExpression(int minPrecedence) -> std::unique_ptr<Expression>;
-    [[nodiscard]] auto parseUnaryExpression() -> std::unique_ptr<Expression>;
-    [[nodiscard]] auto parsePostfixExpression() -> std::unique_ptr<Expression>;
-    [[nodiscard]] auto parsePrimaryExpression() -> std::unique_ptr<Expression>;
+    [[nodiscard]] auto parseExpression() -> AstPtr<Expression>;
+    [[nodiscard]] auto parseBinaryExpression(int minPrecedence) -> AstPtr<Expression>;
+    [[nodiscard]] auto parseUnaryExpression() -> AstPtr<Expression>;
+    [[nodiscard]] auto parsePostfixExpression() -> AstPtr<Expression>;
+    [[nodiscard]] auto parsePrimaryExpression() -> AstPtr<Expression>;
     [[nodiscard]] static auto binaryPrecedence(TokenKind kind) -> int;
     [[nodiscard]] static auto toBinaryOperator(TokenKind kind) -> Expression::BinaryOperator;
 
@@ -51,9 +58,15 @@ class Parser {
     [[nodiscard]] auto makeIdentifier(const Token& token) const -> Identifier;
     [[nodiscard]] auto makeSnippet(TokenRange range) const -> Snippet;
 
-    std::string source_;
-    std::vector<Token> tokens_;
+    std::shared_ptr<AstArena> arena_;  // handed to the module
+    Lexer lexer_;
+    // Tokens are pulled as the parser reaches them and dropped between top-level declarations.
+    // Indices (current_, TokenRange) count from the first token; tokens_[0] is token base_. A
+    // deque, so the references consume() hands out survive later pulls.
+    std::deque<Token> tokens_;
+    size_t base_ = 0;
     size_t current_ = 0;
+    std::vector<Diagnostic> lexerDiagnostics_;  // reported ahead of the parser's own
     std::vector<Diagnostic> diagnostics_;
 };
 
@@ -128,6 +128,7 @@ auto expr_kind_to_string(Expression::Kind kind) -> const char* {
         case Expression::Kind::Binary: return "Binary";
         case Expression::Kind::Unary: return "Unary";
         case Expression::Kind::Call: return "Call";
+        case Expression::Kind::Field: return "Field";
     }
     return "Unknown";
 }
@@ -249,6 +250,13 @@ void dump_expression(const Expression* expr, std::ostream& out, std::size_t dept
             dump_call_arguments(*expr, out, depth + 1);
             break;
         }
+        case Expression::Kind::Field: {
+            indent(out, depth + 1);
+            out << "Object" << '\n';
+            dump_expression(expr->operand.get(), out, depth + 2);
+            dump_identifier(expr->identifier, out, depth + 1);
+            break;
+        }
     }
 }
 
@@ -271,6 +279,7 @@ auto statement_kind_to_string(Statement::Kind kind) -> const char* {
         case Statement::Kind::Continue: return "Continue";
         case Statement::Kind::ExprStmt: return "ExprStmt";
         case Statement::Kind::Assign: return "Assign";
+        case Statement::Kind::FieldAssign: return "FieldAssign";
     }
     return "Unknown";
 }
@@ -356,6 +365,18 @@ void dump_statement(const Statement& stmt, std::ostream& out, std::size_t depth)
             dump_expression(stmt.assign_value.get(), out, depth + 2);
             break;
         }
+        case Statement::Kind::FieldAssign: {
+            indent(out, depth + 1);
+            out << "Object" << '\n';
+            dump_expression(stmt.assign_object.get(), out, depth + 2);
+            indent(out, depth + 1);
+            out << "Field" << '\n';
+            dump_identifier(stmt.assign_target, out, depth + 2);
+            indent(out, depth + 1);
+            out << "Value" << '\n';
+            dump_expression(stmt.assign_value.get(), out, depth + 2);
+            break;
+        }
     }
 }
 
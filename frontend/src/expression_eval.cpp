@@ -253,6 +253,8 @@ auto printExpression(const Expression& expr) -> std::string {
             result += ')';
             return result;
         }
+        case Expression::Kind::Field:
+            return (expr.operand ? printExpression(*expr.operand) : std::string{}) + '.' + expr.identifier.value;
     }
     return {};
 }
@@ -307,6 +309,7 @@ auto evaluateNumericExpression(const Expression& expr) -> ExpressionEvalResult {
             }
         }
         case Expression::Kind::Call:
+        case Expression::Kind::Field:
             return ExpressionEvalResult{
                 .status = ExpressionEvalStatus::NonConstant,
                 .value = std::nullopt,
@@ -1,7 +1,9 @@
 #include "../include/impulse/frontend/lexer.h"
 
+#include <algorithm>
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 
@@ -22,8 +24,8 @@ namespace {
     return std::isdigit(static_cast<unsigned char>(c)) != 0;
 }
 
-[[nodiscard]] auto keywordTable() -> const std::unordered_map<std::string, TokenKind>& {
-    static const std::unordered_map<std::string, TokenKind> table = {
+[[nodiscard]] auto keywordTable() -> const std::unordered_map<std::string_view, TokenKind>& {
+    static const std::unordered_map<std::string_view, TokenKind> table = {
     {"module", TokenKind::KwModule},   {"import", TokenKind::KwImport},   {"as", TokenKind::KwAs},
     {"export", TokenKind::KwExport},
         {"func", TokenKind::KwFunc},       {"struct", TokenKind::KwStruct},   {"interface", TokenKind::KwInterface},
@@ -37,7 +39,7 @@ namespace {
     return table;
 }
 
-[[nodiscard]] auto classifyIdentifier(const std::string& lexeme) -> TokenKind {
+[[nodiscard]] auto classifyIdentifier(std::string_view lexeme) -> TokenKind {
     if (lexeme == "true" || lexeme == "false") {
         return TokenKind::BooleanLiteral;
     }
@@ -53,135 +55,102 @@ Lexer::Lexer(std::string source) : source_(std::move(source)) {}
 
 auto Lexer::tokenize() -> std::vector<Token> {
     std::vector<Token> tokens;
-    tokens.reserve(source_.size() / 4 + 8);
-
-    while (true) {
-        skipTrivia();
-        if (isAtEnd()) {
-            break;
-        }
-
-        const SourceLocation location{line_, column_};
-        const size_t startIndex = current_;
-        const char c = advance();
+    tokens.reserve((source_.size() - std::min(current_, source_.size())) / 4 + 8);
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().kind != TokenKind::EndOfFile);
+    return tokens;
+}
 
-        if (isIdentifierStart(c)) {
-            lexIdentifier(tokens, location, startIndex);
-            continue;
-        }
+auto Lexer::next() -> Token {
+    skipTrivia();
+    if (isAtEnd()) {
+        return Token{TokenKind::EndOfFile, {}, line_, column_};
+    }
 
-        if (isDigit(c)) {
-            lexNumber(tokens, location, startIndex);
-            continue;
-        }
+    const SourceLocation location{line_, column_};
+    const size_t startIndex = current_;
+    const char c = advance();
 
-        switch (c) {
-            case '"':
-                lexString(tokens, location);
-                break;
-            case '(':
-                pushToken(tokens, TokenKind::LParen, "(", location);
-                break;
-            case ')':
-                pushToken(tokens, TokenKind::RParen, ")", location);
-                break;
-            case '{':
-                pushToken(tokens, TokenKind::LBrace, "{", location);
-                break;
-            case '}':
-                pushToken(tokens, TokenKind::RBrace, "}", location);
-                break;
-            case '[':
-                pushToken(tokens, TokenKind::LBracket, "[", location);
-                break;
-            case ']':
-                pushToken(tokens, TokenKind::RBracket, "]", location);
-                break;
-            case ',':
-                pushToken(tokens, TokenKind::Comma, ",", location);
-                break;
-            case ';':
-                pushToken(tokens, TokenKind::Semicolon, ";", location);
-                break;
-            case ':':
-                if (match(':')) {
-                    pushToken(tokens, TokenKind::DoubleColon, "::", location);
-                } else {
-                    pushToken(tokens, TokenKind::Colon, ":", location);
-                }
-                break;
-            case '.':
-                pushToken(tokens, TokenKind::Dot, ".", location);
-                break;
-            case '-':
-                if (match('>')) {
-                    pushToken(tokens, TokenKind::Arrow, "->", location);
-                } else {
-                    pushToken(tokens, TokenKind::Minus, "-", location);
-                }
-                break;
-            case '+':
-                pushToken(tokens, TokenKind::Plus, "+", location);
-                break;
-            case '*':
-                pushToken(tokens, TokenKind::Star, "*", location);
-                break;
-            case '/':
-                pushToken(tokens, TokenKind::Slash, "/", location);
-                break;
-            case '%':
-                pushToken(tokens, TokenKind::Percent, "%", location);
-                break;
-            case '&':
-                if (match('&')) {
-                    pushToken(tokens, TokenKind::AmpersandAmpersand, "&&", location);
-                } else {
-                    pushToken(tokens, TokenKind::Ampersand, "&", location);
-                }
-                break;
-            case '|':
-                if (match('|')) {
-                    pushToken(tokens, TokenKind::PipePipe, "||", location);
-                } else {
-                    pushToken(tokens, TokenKind::Pipe, "|", location);
-                }
-                break;
-            case '!':
-                if (match('=')) {
-                    pushToken(tokens, TokenKind::BangEqual, "!=", location);
-                } else {
-                    pushToken(tokens, TokenKind::Bang, "!", location);
-                }
-                break;
-            case '=':
-                if (match('=')) {
-                    pushToken(tokens, TokenKind::EqualEqual, "==", location);
-                } else {
-                    pushToken(tokens, TokenKind::Equal, "=", location);
-                }
-                break;
-            case '<':
-                if (match('=')) {
-                    pushToken(tokens, TokenKind::LessEqual, "<=", location);
-                } else {
-                    pushToken(tokens, TokenKind::Less, "<", location);
-                }
-                break;
-            case '>':
-                if (match('=')) {
-                    pushToken(tokens, TokenKind::GreaterEqual, ">=", location);
-                } else {
-                    pushToken(tokens, TokenKind::Greater, ">", location);
-                }
-                break;
-            default:
-                pushToken(tokens, TokenKind::Error, std::string{c}, location);
-                break;
-        }
+    if (isIdentifierStart(c)) {
+        return lexIdentifier(location, startIndex);
+    }
+    if (isDigit(c)) {
+        return lexNumber(location, startIndex);
+    }
+    if (c == '"') {
+        return lexString(location);
     }
 
-    tokens.push_back(Token{TokenKind::EndOfFile, "", line_, column_});
-    return tokens;
+    TokenKind kind = TokenKind::Error;  // an unexpected character is its own lexeme
+    switch (c) {
+        case '(':
+            kind = TokenKind::LParen;
+            break;
+        case ')':
+            kind = TokenKind::RParen;
+            break;
+        case '{':
+            kind = TokenKind::LBrace;
+            break;
+        case '}':
+            kind = TokenKind::RBrace;
+            break;
+        case '[':
+            kind = TokenKind::LBracket;
+            break;
+        case ']':
+            kind = TokenKind::RBracket;
+            break;
+        case ',':
+            kind = TokenKind::Comma;
+            break;
+        case ';':
+            kind = TokenKind::Semicolon;
+            break;
+        case ':':
+            kind = match(':') ? TokenKind::DoubleColon : TokenKind::Colon;
+            break;
+        case '.':
+            kind = TokenKind::Dot;
+            break;
+        case '-':
+            kind = match('>') ? TokenKind::Arrow : TokenKind::Minus;
+            break;
+        case '+':
+            kind = TokenKind::Plus;
+            break;
+        case '*':
+            kind = TokenKind::Star;
+            break;
+        case '/':
+            kind = TokenKind::Slash;
+            break;
+        case '%':
+            kind = TokenKind::Percent;
+            break;
+        case '&':
+            kind = match('&') ? TokenKind::AmpersandAmpersand : TokenKind::Ampersand;
+            break;
+        case '|':
+            kind = match('|') ? TokenKind::PipePipe : TokenKind::Pipe;
+            break;
+        case '!':
+            kind = match('=') ? TokenKind::BangEqual : TokenKind::Bang;
+            break;
+        case '=':
+            kind = match('=') ? TokenKind::EqualEqual : TokenKind::Equal;
+            break;
+        case '<':
+            kind = match('=') ? TokenKind::LessEqual : TokenKind::Less;
+            break;
+        case '>':
+            kind = match('=') ? TokenKind::GreaterEqual : TokenKind::Greater;
+            break;
+        default:
+            break;
+    }
+    return Token{kind, slice(startIndex), location.line, location.column};
 }
 
 [[nodiscard]] auto Lexer::peek() const -> char {
@@ -257,16 +226,15 @@ void Lexer::skipTrivia() {
     }
 }
 
-void Lexer::lexIdentifier(std::vector<Token>& tokens, SourceLocation location, size_t startIndex) {
+auto Lexer::lexIdentifier(SourceLocation location, size_t startIndex) -> Token {
     while (isIdentifierBody(peek())) {
         advance();
     }
-    auto lexeme = slice(startIndex);
-    const TokenKind kind = classifyIdentifier(lexeme);
-    pushToken(tokens, kind, std::move(lexeme), location);
+    const std::string_view lexeme = slice(startIndex);
+    return Token{classifyIdentifier(lexeme), lexeme, location.line, location.column};
 }
 
-void Lexer::lexNumber(std::vector<Token>& tokens, SourceLocation location, size_t startIndex) {
+auto Lexer::lexNumber(SourceLocation location, size_t startIndex) -> Token {
     const auto consumeDigits = [this]() {
         while (!isAtEnd()) {
             const char next = peek();
@@ -298,29 +266,38 @@ void Lexer::lexNumber(std::vector<Token>& tokens, SourceLocation location, size_
         consumeDigits();
 
         if (exponentDigitsStart == current_) {
-            pushToken(tokens, TokenKind::Error, "Invalid exponent", location);
-            return;
+            return Token{TokenKind::Error, "Invalid exponent", location.line, location.column};
         }
     }
 
-    auto lexeme = slice(startIndex);
     const TokenKind kind = isFloat ? TokenKind::FloatLiteral : TokenKind::IntegerLiteral;
-    pushToken(tokens, kind, std::move(lexeme), location);
+    return Token{kind, slice(startIndex), location.line, location.column};
 }
 
-void Lexer::lexString(std::vector<Token>& tokens, SourceLocation location) {
+auto Lexer::lexString(SourceLocation location) -> Token {
+    // Up to the first escape the value is the source itself; from there it is decoded into `value`
+    const size_t valueStart = current_;
     std::string value;
-    value.reserve(16);
+    bool escaped = false;
     bool terminated = false;
 
     while (!isAtEnd()) {
+        const size_t position = current_;
         const char c = advance();
         if (c == '"') {
             terminated = true;
+            if (!escaped) {
+                return Token{TokenKind::StringLiteral, std::string_view(source_).substr(valueStart, position - valueStart),
+                             location.line, location.column};
+            }
             break;
         }
 
         if (c == '\\') {
+            if (!escaped) {
+                value.assign(source_, valueStart, position - valueStart);
+                escaped = true;
+            }
             if (isAtEnd()) {
                 break;
             }
@@ -345,23 +322,21 @@ void Lexer::lexString(std::vector<Token>& tokens, SourceLocation location) {
             continue;
         }
 
-        value.push_back(c);
+        if (escaped) {
+            value.push_back(c);
+        }
     }
 
     if (!terminated) {
-        pushToken(tokens, TokenKind::Error, "Unterminated string literal", location);
-        return;
+        return Token{TokenKind::Error, "Unterminated string literal", location.line, location.column};
     }
 
-    pushToken(tokens, TokenKind::StringLiteral, std::move(value), location);
-}
-
-void Lexer::pushToken(std::vector<Token>& tokens, TokenKind kind, std::string lexeme, SourceLocation location) {
-    tokens.push_back(Token{kind, std::move(lexeme), location.line, location.column});
+    const std::string& stored = decoded_.emplace_back(std::move(value));
+    return Token{TokenKind::StringLiteral, stored, location.line, location.column};
 }
 
-[[nodiscard]] auto Lexer::slice(size_t startIndex) const -> std::string {
-    return source_.substr(startIndex, current_ - startIndex);
+[[nodiscard]] auto Lexer::slice(size_t startIndex) const -> std::string_view {
+    return std::string_view(source_).substr(startIndex, current_ - startIndex);
 }
 
 }  // namespace impulse::frontend
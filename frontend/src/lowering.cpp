@@ -5,6 +5,7 @@
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -32,11 +33,67 @@ struct LoopContext {
 struct ScopeLocal {
     std::string name;
     bool requires_drop = false;
+    std::string type;  // as declared
+};
+
+// Declared types that field accesses are resolved against: the module's structs and globals,
+// and the function's bindings in scope (innermost scope last, its parameters first)
+struct StaticTypes {
+    std::unordered_map<std::string, const StructDecl*> structs;
+    std::unordered_map<std::string, std::string> globals;
+    const std::vector<std::vector<ScopeLocal>>* scopes = nullptr;
+
+    [[nodiscard]] auto find_struct(const std::string& name) const -> const StructDecl* {
+        const auto it = structs.find(name);
+        return it != structs.end() ? it->second : nullptr;
+    }
+
+    [[nodiscard]] auto type_of(const std::string& name) const -> const std::string* {
+        if (scopes != nullptr) {
+            for (auto scope = scopes->rbegin(); scope != scopes->rend(); ++scope) {
+                for (auto local = scope->rbegin(); local != scope->rend(); ++local) {
+                    if (local->name == name) {
+                        return &local->type;
+                    }
+                }
+            }
+        }
+        const auto it = globals.find(name);
+        return it != globals.end() ? &it->second : nullptr;
+    }
+
+    // The struct `expr` evaluates to, when its declared type names one
+    [[nodiscard]] auto struct_of(const Expression& expr) const -> const StructDecl* {
+        switch (expr.kind) {
+            case Expression::Kind::Identifier: {
+                const std::string* type = type_of(expr.identifier.value);
+                return type != nullptr ? find_struct(*type) : nullptr;
+            }
+            case Expression::Kind::Call:
+                return find_struct(expr.callee);
+            case Expression::Kind::Field: {
+                const StructDecl* outer = expr.operand ? struct_of(*expr.operand) : nullptr;
+                const FieldDecl* field = outer != nullptr ? find_field(*outer, expr.identifier.value) : nullptr;
+                return field != nullptr ? find_struct(field->type_name.value) : nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    [[nodiscard]] static auto find_field(const StructDecl& structure, const std::string& name) -> const FieldDecl* {
+        for (const auto& field : structure.fields) {
+            if (field.name.value == name) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
 };
 
 void lower_statement_to_instructions(const Statement& statement, std::vector<ir::Instruction>& instructions,
                                      std::vector<LoopContext>& loop_stack,
-                                     std::vector<std::vector<ScopeLocal>>& scope_stack);
+                                     std::vector<std::vector<ScopeLocal>>& scope_stack, const StaticTypes& types);
 
 void emit_scope_drops(const std::vector<ScopeLocal>& locals, std::vector<ir::Instruction>& instructions) {
     for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
@@ -57,10 +114,10 @@ void emit_scope_drops(const std::vector<ScopeLocal>& locals, std::vector<ir::Ins
 void lower_statements_to_instructions(const std::vector<Statement>& statements,
                                       std::vector<ir::Instruction>& instructions,
                                       std::vector<LoopContext>& loop_stack,
-                                      std::vector<std::vector<ScopeLocal>>& scope_stack) {
+                                      std::vector<std::vector<ScopeLocal>>& scope_stack, const StaticTypes& types) {
     scope_stack.emplace_back();
     for (const auto& stmt : statements) {
-        lower_statement_to_instructions(stmt, instructions, loop_stack, scope_stack);
+        lower_statement_to_instructions(stmt, instructions, loop_stack, scope_stack, types);
     }
     emit_scope_drops(scope_stack.back(), instructions);
     scope_stack.pop_back();
@@ -123,7 +180,16 @@ void lower_statements_to_instructions(const std::vector<Statement>& statements,
     return "?";
 }
 
-void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instruction>& instructions) {
+// Operands of a field_get / field_set of `field` on `object`. The struct is left empty when the
+// object's declared type is not known to be one; loading the module reports it then.
+[[nodiscard]] auto field_operands(const Expression& object, const std::string& field, const StaticTypes& types)
+    -> std::vector<std::string> {
+    const StructDecl* structure = types.struct_of(object);
+    return {structure != nullptr ? structure->name.value : std::string{}, field};
+}
+
+void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instruction>& instructions,
+                               const StaticTypes& types) {
     switch (expr.kind) {
         case Expression::Kind::Literal:
             if (expr.literal_kind == Expression::LiteralKind::String) {
@@ -146,10 +212,10 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             break;
         case Expression::Kind::Binary:
             if (expr.left) {
-                lower_expression_to_stack(*expr.left, instructions);
+                lower_expression_to_stack(*expr.left, instructions, types);
             }
             if (expr.right) {
-                lower_expression_to_stack(*expr.right, instructions);
+                lower_expression_to_stack(*expr.right, instructions, types);
             }
             instructions.push_back(ir::Instruction{
                 .kind = ir::InstructionKind::Binary,
@@ -158,7 +224,7 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             break;
         case Expression::Kind::Unary:
             if (expr.operand) {
-                lower_expression_to_stack(*expr.operand, instructions);
+                lower_expression_to_stack(*expr.operand, instructions, types);
             }
             instructions.push_back(ir::Instruction{
                 .kind = ir::InstructionKind::Unary,
@@ -171,7 +237,7 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             if (expr.callee == "array") {
                 for (const auto& arg : expr.arguments) {
                     if (arg) {
-                        lower_expression_to_stack(*arg, instructions);
+                        lower_expression_to_stack(*arg, instructions, types);
                     }
                 }
                 instructions.push_back(ir::Instruction{
@@ -182,7 +248,7 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             if (expr.callee == "array_get") {
                 for (const auto& arg : expr.arguments) {
                     if (arg) {
-                        lower_expression_to_stack(*arg, instructions);
+                        lower_expression_to_stack(*arg, instructions, types);
                     }
                 }
                 instructions.push_back(ir::Instruction{
@@ -193,7 +259,7 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             if (expr.callee == "array_set") {
                 for (const auto& arg : expr.arguments) {
                     if (arg) {
-                        lower_expression_to_stack(*arg, instructions);
+                        lower_expression_to_stack(*arg, instructions, types);
                     }
                 }
                 instructions.push_back(ir::Instruction{
@@ -204,7 +270,7 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
             if (expr.callee == "array_length") {
                 for (const auto& arg : expr.arguments) {
                     if (arg) {
-                        lower_expression_to_stack(*arg, instructions);
+                        lower_expression_to_stack(*arg, instructions, types);
                     }
                 }
                 instructions.push_back(ir::Instruction{
@@ -213,24 +279,33 @@ void lower_expression_to_stack(const Expression& expr, std::vector<ir::Instructi
                 break;
             }
             for (const auto& arg : expr.arguments) {
-                lower_expression_to_stack(*arg, instructions);
+                lower_expression_to_stack(*arg, instructions, types);
             }
             instructions.push_back(ir::Instruction{
-                .kind = ir::InstructionKind::Call,
-                .operands = std::vector<std::string>{expr.callee, std::to_string(expr.arguments.size())},
+                types.find_struct(expr.callee) != nullptr ? ir::InstructionKind::MakeStruct : ir::InstructionKind::Call,
+                {expr.callee, std::to_string(expr.arguments.size())},
             });
             break;
         }
+        case Expression::Kind::Field:
+            if (expr.operand) {
+                lower_expression_to_stack(*expr.operand, instructions, types);
+                instructions.push_back(ir::Instruction{
+                    ir::InstructionKind::FieldGet,
+                    field_operands(*expr.operand, expr.identifier.value, types),
+                });
+            }
+            break;
     }
 }
 
 void lower_statement_to_instructions(const Statement& statement, std::vector<ir::Instruction>& instructions,
                                      std::vector<LoopContext>& loop_stack,
-                                     std::vector<std::vector<ScopeLocal>>& scope_stack) {
+                                     std::vector<std::vector<ScopeLocal>>& scope_stack, const StaticTypes& types) {
     switch (statement.kind) {
         case Statement::Kind::Return:
             if (statement.return_expression) {
-                lower_expression_to_stack(*statement.return_expression, instructions);
+                lower_expression_to_stack(*statement.return_expression, instructions, types);
             }
             instructions.push_back(ir::Instruction{
                 .kind = ir::InstructionKind::Return,
@@ -239,13 +314,14 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             break;
         case Statement::Kind::Binding:
             if (statement.binding.initializer_expr) {
-                lower_expression_to_stack(*statement.binding.initializer_expr, instructions);
+                lower_expression_to_stack(*statement.binding.initializer_expr, instructions, types);
                 instructions.push_back(ir::Instruction{
                     .kind = ir::InstructionKind::Store,
                     .operands = std::vector<std::string>{statement.binding.name.value},
                 });
                 if (!scope_stack.empty()) {
-                    scope_stack.back().push_back(ScopeLocal{statement.binding.name.value, false});
+                    scope_stack.back().push_back(
+                        ScopeLocal{statement.binding.name.value, false, statement.binding.type_name.value});
                 }
             }
             break;
@@ -257,13 +333,13 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             const std::string else_label = generate_label();
             const std::string end_label = generate_label();
 
-            lower_expression_to_stack(*statement.condition, instructions);
+            lower_expression_to_stack(*statement.condition, instructions, types);
             instructions.push_back(ir::Instruction{
                 .kind = ir::InstructionKind::BranchIf,
                 .operands = std::vector<std::string>{else_label, "0"},
             });
 
-            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack);
+            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack, types);
 
             if (!statement.else_body.empty()) {
                 instructions.push_back(ir::Instruction{
@@ -274,7 +350,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
                     .kind = ir::InstructionKind::Label,
                     .operands = std::vector<std::string>{else_label},
                 });
-                lower_statements_to_instructions(statement.else_body, instructions, loop_stack, scope_stack);
+                lower_statements_to_instructions(statement.else_body, instructions, loop_stack, scope_stack, types);
                 instructions.push_back(ir::Instruction{
                     .kind = ir::InstructionKind::Label,
                     .operands = std::vector<std::string>{end_label},
@@ -300,14 +376,14 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
                 .operands = std::vector<std::string>{loop_label},
             });
 
-            lower_expression_to_stack(*statement.condition, instructions);
+            lower_expression_to_stack(*statement.condition, instructions, types);
             instructions.push_back(ir::Instruction{
                 .kind = ir::InstructionKind::BranchIf,
                 .operands = std::vector<std::string>{end_label, "0"},
             });
 
             loop_stack.push_back(LoopContext{.continue_label = loop_label, .break_label = end_label});
-            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack);
+            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack, types);
             loop_stack.pop_back();
 
             instructions.push_back(ir::Instruction{
@@ -322,7 +398,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
         }
         case Statement::Kind::For: {
             if (statement.for_initializer) {
-                lower_statement_to_instructions(*statement.for_initializer, instructions, loop_stack, scope_stack);
+                lower_statement_to_instructions(*statement.for_initializer, instructions, loop_stack, scope_stack, types);
             }
 
             const std::string loop_label = generate_label();
@@ -336,7 +412,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             });
 
             if (statement.condition) {
-                lower_expression_to_stack(*statement.condition, instructions);
+                lower_expression_to_stack(*statement.condition, instructions, types);
                 instructions.push_back(ir::Instruction{
                     .kind = ir::InstructionKind::BranchIf,
                     .operands = std::vector<std::string>{end_label, "0"},
@@ -344,7 +420,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             }
 
             loop_stack.push_back(LoopContext{.continue_label = continue_label, .break_label = end_label});
-            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack);
+            lower_statements_to_instructions(statement.then_body, instructions, loop_stack, scope_stack, types);
             loop_stack.pop_back();
 
             if (has_increment) {
@@ -352,7 +428,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
                     .kind = ir::InstructionKind::Label,
                     .operands = std::vector<std::string>{continue_label},
                 });
-                lower_statement_to_instructions(*statement.for_increment, instructions, loop_stack, scope_stack);
+                lower_statement_to_instructions(*statement.for_increment, instructions, loop_stack, scope_stack, types);
             }
 
             instructions.push_back(ir::Instruction{
@@ -383,7 +459,7 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             break;
         case Statement::Kind::ExprStmt:
             if (statement.expr) {
-                lower_expression_to_stack(*statement.expr, instructions);
+                lower_expression_to_stack(*statement.expr, instructions, types);
                 instructions.push_back(ir::Instruction{
                     .kind = ir::InstructionKind::Drop,
                     .operands = {},
@@ -392,13 +468,23 @@ void lower_statement_to_instructions(const Statement& statement, std::vector<ir:
             break;
         case Statement::Kind::Assign:
             if (statement.assign_value) {
-                lower_expression_to_stack(*statement.assign_value, instructions);
+                lower_expression_to_stack(*statement.assign_value, instructions, types);
                 instructions.push_back(ir::Instruction{
                     .kind = ir::InstructionKind::Store,
                     .operands = std::vector<std::string>{statement.assign_target.value},
                 });
             }
             break;
+        case Statement::Kind::FieldAssign:
+            if (statement.assign_object && statement.assign_value) {
+                lower_expression_to_stack(*statement.assign_object, instructions, types);
+                lower_expression_to_stack(*statement.assign_value, instructions, types);
+                instructions.push_back(ir::Instruction{
+                    ir::InstructionKind::FieldSet,
+                    field_operands(*statement.assign_object, statement.assign_target.value, types),
+                });
+            }
+            break;
     }
 }
 
@@ -412,6 +498,15 @@ auto lower_to_ir(const Module& module) -> ir::Module {
         lowered.path.push_back(segment.value);
     }
 
+    StaticTypes types;
+    for (const auto& decl : module.declarations) {
+        if (decl.kind == Declaration::Kind::Struct) {
+            types.structs.emplace(decl.structure.name.value, &decl.structure);
+        } else if (decl.kind == Declaration::Kind::Binding) {
+            types.globals.emplace(decl.binding.name.value, decl.binding.type_name.value);
+        }
+    }
+
     for (const auto& decl : module.declarations) {
         switch (decl.kind) {
             case Declaration::Kind::Binding: {
@@ -428,7 +523,7 @@ auto lower_to_ir(const Module& module) -> ir::Module {
                             binding.constant_value = formatted;
                         }
                     }
-                    lower_expression_to_stack(*decl.binding.initializer_expr, binding.initializer_instructions);
+                    lower_expression_to_stack(*decl.binding.initializer_expr, binding.initializer_instructions, types);
                     binding.initializer_instructions.push_back(ir::Instruction{
                         .kind = ir::InstructionKind::Store,
                         .operands = std::vector<std::string>{decl.binding.name.value},
@@ -459,9 +554,14 @@ auto lower_to_ir(const Module& module) -> ir::Module {
                     ir::FunctionBuilder builder(function);
                     auto& entry = builder.entry();
                     std::vector<LoopContext> loop_stack;
-                    std::vector<std::vector<ScopeLocal>> scope_stack;
+                    std::vector<std::vector<ScopeLocal>> scope_stack(1);
+                    for (const auto& param : function.parameters) {
+                        scope_stack.front().push_back(ScopeLocal{param.name, false, param.type});
+                    }
+                    types.scopes = &scope_stack;
                     lower_statements_to_instructions(decl.function.parsed_body.statements, entry.instructions,
-                                                     loop_stack, scope_stack);
+                                                     loop_stack, scope_stack, types);
+                    types.scopes = nullptr;
                 } else if (!function.body_snippet.empty()) {
                     ir::FunctionBuilder builder(function);
                     builder.appendComment(function.body_snippet);
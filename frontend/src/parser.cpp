@@ -1,30 +1,44 @@
 #include "../include/impulse/frontend/parser.h"
 
-#include <sstream>
+#include <algorithm>
 #include <string>
 #include <utility>
 
 namespace impulse::frontend {
 
-Parser::Parser(std::string source) : source_(std::move(source)) {
-    Lexer lexer(source_);
-    tokens_ = lexer.tokenize();
+// Syntax trees take about a dozen bytes of nodes per character of source
+Parser::Parser(std::string source)
+    : arena_(std::make_shared<AstArena>(source.size() * 12)), lexer_(std::move(source)) {
+    pull();
 }
 
-auto Parser::parseModule() -> ParseResult {
-    ParseResult result{};
+void Parser::pull() {
+    tokens_.push_back(lexer_.next());
+    recordLexerError(tokens_.back());
+}
 
-    for (const auto& token : tokens_) {
-        if (token.kind == TokenKind::Error) {
-            reportError(token, token.lexeme.empty() ? "Lexer error" : token.lexeme);
-        }
+void Parser::recordLexerError(const Token& token) {
+    if (token.kind == TokenKind::Error) {
+        lexerDiagnostics_.push_back(Diagnostic{
+            SourceLocation{token.line, token.column},
+            token.lexeme.empty() ? std::string("Lexer error") : std::string(token.lexeme),
+        });
     }
+}
 
-    if (tokens_.empty()) {
-        reportError(Token{TokenKind::EndOfFile, "", 0, 0}, "No tokens produced");
+void Parser::discardConsumed() {
+    if (current_ - base_ > 1) {
+        const size_t drop = current_ - base_ - 1;
+        tokens_.erase(tokens_.begin(), tokens_.begin() + static_cast<std::ptrdiff_t>(drop));
+        base_ += drop;
     }
+}
+
+auto Parser::parseModule() -> ParseResult {
+    ParseResult result{};
 
     Module module;
+    module.arena = arena_;
     module.decl = parseModuleDecl();
     module.imports = parseImportList();
 
@@ -33,6 +47,7 @@ auto Parser::parseModule() -> ParseResult {
             break;
         }
 
+        discardConsumed();
         if (auto decl = parseDeclaration()) {
             module.declarations.push_back(std::move(*decl));
         } else {
@@ -40,22 +55,35 @@ auto Parser::parseModule() -> ParseResult {
         }
     }
 
+    // Lexer errors past where parsing stopped are still reported
+    if (!isAtEnd()) {
+        Token token{};
+        do {
+            token = lexer_.next();
+            recordLexerError(token);
+        } while (token.kind != TokenKind::EndOfFile);
+    }
+
     result.module = std::move(module);
-    result.diagnostics = diagnostics_;
-    result.success = diagnostics_.empty();
+    result.diagnostics = std::move(lexerDiagnostics_);
+    result.diagnostics.insert(result.diagnostics.end(), diagnostics_.begin(), diagnostics_.end());
+    result.success = result.diagnostics.empty();
     return result;
 }
 
 auto Parser::advance() -> const Token& {
     if (!isAtEnd()) {
         ++current_;
+        if (current_ - base_ == tokens_.size()) {
+            pull();
+        }
     }
     return previous();
 }
 
-auto Parser::peek() const -> const Token& { return tokens_[current_]; }
+auto Parser::peek() const -> const Token& { return tokens_[current_ - base_]; }
 
-auto Parser::previous() const -> const Token& { return tokens_[current_ - 1]; }
+auto Parser::previous() const -> const Token& { return tokens_[current_ - base_ - 1]; }
 
 auto Parser::isAtEnd() const -> bool { return peek().kind == TokenKind::EndOfFile; }
 
@@ -414,7 +442,7 @@ auto Parser::parseStatement() -> std::optional<Statement> {
                 } else if (keywordToken.kind == TokenKind::KwVar) {
                     kind = BindingKind::Var;
                 }
-                auto initStmt = std::make_unique<Statement>();
+                auto initStmt = arena_->make<Statement>();
                 initStmt->kind = Statement::Kind::Binding;
                 initStmt->location = SourceLocation{keywordToken.line, keywordToken.column};
                 initStmt->binding = parseBindingDecl(kind);
@@ -428,7 +456,7 @@ auto Parser::parseStatement() -> std::optional<Statement> {
                 if (!consume(TokenKind::Semicolon, "Expected ';' after for-loop initializer")) {
                     return std::nullopt;
                 }
-                auto initStmt = std::make_unique<Statement>();
+                auto initStmt = arena_->make<Statement>();
                 initStmt->kind = Statement::Kind::ExprStmt;
                 initStmt->location = initExpr->location;
                 initStmt->expr = std::move(initExpr);
@@ -461,7 +489,7 @@ auto Parser::parseStatement() -> std::optional<Statement> {
                 } else if (keywordToken.kind == TokenKind::KwVar) {
                     kind = BindingKind::Var;
                 }
-                auto incrementStmt = std::make_unique<Statement>();
+                auto incrementStmt = arena_->make<Statement>();
                 incrementStmt->kind = Statement::Kind::Binding;
                 incrementStmt->location = SourceLocation{keywordToken.line, keywordToken.column};
                 incrementStmt->binding = parseBindingDecl(kind, false);
@@ -472,7 +500,7 @@ auto Parser::parseStatement() -> std::optional<Statement> {
                     reportError(peek(), "Expected increment expression in for-loop");
                     return std::nullopt;
                 }
-                auto incrementStmt = std::make_unique<Statement>();
+                auto incrementStmt = arena_->make<Statement>();
                 incrementStmt->kind = Statement::Kind::ExprStmt;
                 incrementStmt->location = incrementExpr->location;
                 incrementStmt->expr = std::move(incrementExpr);
@@ -543,6 +571,25 @@ auto Parser::parseStatement() -> std::optional<Statement> {
         return std::nullopt;
     }
 
+    // Field assignment: object.field = expr;
+    if (expression->kind == Expression::Kind::Field && match(TokenKind::Equal)) {
+        auto value = parseExpression();
+        if (!value) {
+            reportError(peek(), "Expected expression after '='");
+            return std::nullopt;
+        }
+        if (!consume(TokenKind::Semicolon, "Expected ';' after assignment")) {
+            return std::nullopt;
+        }
+        Statement stmt;
+        stmt.kind = Statement::Kind::FieldAssign;
+        stmt.location = expression->location;
+        stmt.assign_target = expression->identifier;
+        stmt.assign_object = std::move(expression->operand);
+        stmt.assign_value = std::move(value);
+        return stmt;
+    }
+
     if (!consume(TokenKind::Semicolon, "Expected ';' after expression")) {
         // simple recovery: advance until next statement boundary
         while (!check(TokenKind::Semicolon) && !check(TokenKind::RBrace) && !check(TokenKind::EndOfFile)) {
@@ -734,9 +781,9 @@ auto Parser::parsePath(const char* context) -> std::vector<Identifier> {
     return path;
 }
 
-auto Parser::parseExpression() -> std::unique_ptr<Expression> { return parseBinaryExpression(0); }
+auto Parser::parseExpression() -> AstPtr<Expression> { return parseBinaryExpression(0); }
 
-auto Parser::parseBinaryExpression(int minPrecedence) -> std::unique_ptr<Expression> {
+auto Parser::parseBinaryExpression(int minPrecedence) -> AstPtr<Expression> {
     auto left = parseUnaryExpression();
     if (left == nullptr) {
         return nullptr;
@@ -754,7 +801,7 @@ auto Parser::parseBinaryExpression(int minPrecedence) -> std::unique_ptr<Express
             return left;
         }
 
-        auto binary = std::make_unique<Expression>();
+        auto binary = arena_->make<Expression>();
         binary->kind = Expression::Kind::Binary;
         binary->location = SourceLocation{op.line, op.column};
         binary->binary_operator = toBinaryOperator(op.kind);
@@ -766,14 +813,14 @@ auto Parser::parseBinaryExpression(int minPrecedence) -> std::unique_ptr<Express
     return left;
 }
 
-auto Parser::parseUnaryExpression() -> std::unique_ptr<Expression> {
+auto Parser::parseUnaryExpression() -> AstPtr<Expression> {
     if (match(TokenKind::Bang)) {
         const Token op = previous();
         auto operand = parseUnaryExpression();
         if (operand == nullptr) {
             return nullptr;
         }
-        auto unary = std::make_unique<Expression>();
+        auto unary = arena_->make<Expression>();
         unary->kind = Expression::Kind::Unary;
         unary->location = SourceLocation{op.line, op.column};
         unary->unary_operator = Expression::UnaryOperator::LogicalNot;
@@ -787,7 +834,7 @@ auto Parser::parseUnaryExpression() -> std::unique_ptr<Expression> {
         if (operand == nullptr) {
             return nullptr;
         }
-        auto unary = std::make_unique<Expression>();
+        auto unary = arena_->make<Expression>();
         unary->kind = Expression::Kind::Unary;
         unary->location = SourceLocation{op.line, op.column};
         unary->unary_operator = Expression::UnaryOperator::Negate;
@@ -798,11 +845,28 @@ auto Parser::parseUnaryExpression() -> std::unique_ptr<Expression> {
     return parsePostfixExpression();
 }
 
-auto Parser::parsePostfixExpression() -> std::unique_ptr<Expression> {
+auto Parser::parsePostfixExpression() -> AstPtr<Expression> {
     auto expr = parsePrimaryExpression();
-    
-    while (match(TokenKind::LParen)) {
-        auto call = std::make_unique<Expression>();
+    if (expr == nullptr) {
+        return nullptr;
+    }
+
+    while (check(TokenKind::LParen) || check(TokenKind::Dot)) {
+        if (match(TokenKind::Dot)) {
+            const Token* field = consume(TokenKind::Identifier, "Expected field name after '.'");
+            if (field == nullptr) {
+                return nullptr;
+            }
+            auto access = arena_->make<Expression>();
+            access->kind = Expression::Kind::Field;
+            access->location = expr->location;
+            access->identifier = makeIdentifier(*field);
+            access->operand = std::move(expr);
+            expr = std::move(access);
+            continue;
+        }
+        advance();  // '('
+        auto call = arena_->make<Expression>();
         call->kind = Expression::Kind::Call;
         call->location = expr->location;
         
@@ -835,40 +899,40 @@ auto Parser::parsePostfixExpression() -> std::unique_ptr<Expression> {
     return expr;
 }
 
-auto Parser::parsePrimaryExpression() -> std::unique_ptr<Expression> {
+auto Parser::parsePrimaryExpression() -> AstPtr<Expression> {
     if (match(TokenKind::StringLiteral)) {
         const Token literal = previous();
-        auto expr = std::make_unique<Expression>();
+        auto expr = arena_->make<Expression>();
         expr->kind = Expression::Kind::Literal;
         expr->literal_kind = Expression::LiteralKind::String;
         expr->location = SourceLocation{literal.line, literal.column};
-        expr->literal_value = literal.lexeme;
+        expr->literal_value = std::string(literal.lexeme);
         return expr;
     }
 
     if (match(TokenKind::IntegerLiteral) || match(TokenKind::FloatLiteral)) {
         const Token literal = previous();
-        auto expr = std::make_unique<Expression>();
+        auto expr = arena_->make<Expression>();
         expr->kind = Expression::Kind::Literal;
         expr->literal_kind = Expression::LiteralKind::Number;
         expr->location = SourceLocation{literal.line, literal.column};
-        expr->literal_value = literal.lexeme;
+        expr->literal_value = std::string(literal.lexeme);
         return expr;
     }
 
     if (match(TokenKind::BooleanLiteral)) {
         const Token literal = previous();
-        auto expr = std::make_unique<Expression>();
+        auto expr = arena_->make<Expression>();
         expr->kind = Expression::Kind::Literal;
         expr->literal_kind = Expression::LiteralKind::Boolean;
         expr->location = SourceLocation{literal.line, literal.column};
-        expr->literal_value = literal.lexeme;
+        expr->literal_value = std::string(literal.lexeme);
         return expr;
     }
 
     if (match(TokenKind::Identifier)) {
         const Token ident = previous();
-        auto expr = std::make_unique<Expression>();
+        auto expr = arena_->make<Expression>();
         expr->kind = Expression::Kind::Identifier;
         expr->location = SourceLocation{ident.line, ident.column};
         expr->identifier = makeIdentifier(ident);
@@ -960,25 +1024,24 @@ void Parser::reportError(const Token& token, std::string message) {
 
 auto Parser::makeIdentifier(const Token& token) const -> Identifier {
     return Identifier{
-        .value = token.lexeme,
-        .location = SourceLocation{token.line, token.column},
+        std::string(token.lexeme),
+        SourceLocation{token.line, token.column},
     };
 }
 
 auto Parser::makeSnippet(TokenRange range) const -> Snippet {
+    const size_t buffered = base_ + tokens_.size();
     Snippet stub;
-    stub.location = (range.start < tokens_.size())
-                        ? SourceLocation{tokens_[range.start].line, tokens_[range.start].column}
+    stub.location = (range.start >= base_ && range.start < buffered)
+                        ? SourceLocation{tokens_[range.start - base_].line, tokens_[range.start - base_].column}
                         : SourceLocation{};
 
-    std::ostringstream builder;
-    for (size_t i = range.start; i < range.end && i < tokens_.size(); ++i) {
+    for (size_t i = std::max(range.start, base_); i < range.end && i < buffered; ++i) {
         if (i != range.start) {
-            builder << ' ';
+            stub.text.push_back(' ');
         }
-        builder << tokens_[i].lexeme;
+        stub.text.append(tokens_[i - base_].lexeme);
     }
-    stub.text = builder.str();
     return stub;
 }
 
@@ -38,8 +38,6 @@ struct StructInfo {
     std::uint32_t type_id = 0;
     std::vector<std::string> field_order;
     std::unordered_map<std::string, TypeInfo> fields;
-    std::unordered_map<std::string, std::size_t> field_offsets;
-    std::size_t payload_size = 0;
 };
 
 struct FunctionSignature {
@@ -326,16 +324,11 @@ public:
         }
         it->second.field_order.clear();
         it->second.fields.clear();
-        it->second.field_offsets.clear();
         it->second.field_order.reserve(fieldsInfo.size());
-        std::size_t offset = 0;
         for (auto& [fieldName, fieldType] : fieldsInfo) {
             it->second.field_order.push_back(fieldName);
             it->second.fields.emplace(fieldName, std::move(fieldType));
-            it->second.field_offsets.emplace(fieldName, offset);
-            offset += sizeof(double);
         }
-        it->second.payload_size = offset;
     }
 
     [[nodiscard]] auto lookupStruct(const std::string& name) const -> const StructInfo* {
@@ -462,6 +455,8 @@ public:
                 return checkUnary(expr, env);
             case Expression::Kind::Call:
                 return checkCall(expr, env);
+            case Expression::Kind::Field:
+                return checkField(expr, env);
         }
         return makeErrorType();
     }
@@ -592,6 +587,24 @@ public:
                 }
                 break;
             }
+            case Statement::Kind::FieldAssign: {
+                if (!statement.assign_object || !statement.assign_value) {
+                    break;
+                }
+                TypeEnvironment* previousEnv = currentEnv;
+                currentEnv = &env;
+                const TypeInfo objectType = checkExpression(*statement.assign_object, env);
+                const TypeInfo valueType = checkExpression(*statement.assign_value, env);
+                currentEnv = previousEnv;
+                // Numeric fields are stored unboxed, so unlike variables they keep their type
+                const TypeInfo fieldType = resolveField(objectType, statement.assign_target);
+                if (!isAssignable(fieldType, valueType)) {
+                    addDiagnostic(result, statement.assign_value->location,
+                                  "Cannot assign expression of type '" + typeToString(valueType) + "' to field '" +
+                                      statement.assign_target.value + "' of type '" + typeToString(fieldType) + "'");
+                }
+                break;
+            }
         }
         currentEnv = previousEnv;
         return statementReturns;
@@ -725,10 +738,75 @@ private:
         return makeErrorType();
     }
 
+    // The type of `field` in values of `objectType`, reporting values that are not structs and
+    // fields they do not have
+    [[nodiscard]] auto resolveField(const TypeInfo& objectType, const Identifier& field) -> TypeInfo {
+        if (isError(objectType)) {
+            return makeErrorType();
+        }
+        const StructInfo* info = objectType.kind == TypeKind::Struct ? types.lookupStruct(objectType.name) : nullptr;
+        if (info == nullptr) {
+            addDiagnostic(result, field.location,
+                          "Field access requires a struct value but got '" + typeToString(objectType) + "'");
+            return makeErrorType();
+        }
+        const auto it = info->fields.find(field.value);
+        if (it == info->fields.end()) {
+            addDiagnostic(result, field.location,
+                          "Struct '" + objectType.name + "' has no field '" + field.value + "'");
+            return makeErrorType();
+        }
+        return it->second;
+    }
+
+    [[nodiscard]] auto checkField(const Expression& expr, TypeEnvironment& env) -> TypeInfo {
+        if (!expr.operand) {
+            return makeErrorType();
+        }
+        TypeEnvironment* previousEnv = currentEnv;
+        currentEnv = &env;
+        const TypeInfo objectType = checkExpression(*expr.operand, env);
+        currentEnv = previousEnv;
+        return resolveField(objectType, expr.identifier);
+    }
+
+    // Point(x, y): one argument per field, in declaration order
+    [[nodiscard]] auto checkConstruction(const Expression& expr, const StructInfo& info, TypeEnvironment& env)
+        -> TypeInfo {
+        if (expr.arguments.size() != info.field_order.size()) {
+            addDiagnostic(result, expr.location,
+                          "Struct '" + expr.callee + "' has " + std::to_string(info.field_order.size()) +
+                              " field(s) but received " + std::to_string(expr.arguments.size()) + " argument(s)");
+        }
+        for (std::size_t i = 0; i < expr.arguments.size(); ++i) {
+            if (!expr.arguments[i]) {
+                continue;
+            }
+            TypeEnvironment* previousEnv = currentEnv;
+            currentEnv = &env;
+            const TypeInfo argType = checkExpression(*expr.arguments[i], env);
+            currentEnv = previousEnv;
+            if (i >= info.field_order.size()) {
+                continue;
+            }
+            const std::string& field = info.field_order[i];
+            const TypeInfo& fieldType = info.fields.at(field);
+            if (!isAssignable(fieldType, argType)) {
+                addDiagnostic(result, expr.arguments[i]->location,
+                              "Cannot convert argument of type '" + typeToString(argType) + "' to field '" + field +
+                                  "' of type '" + typeToString(fieldType) + "'");
+            }
+        }
+        return info.type;
+    }
+
     [[nodiscard]] auto checkCall(const Expression& expr, TypeEnvironment& env) -> TypeInfo {
         if (const auto builtin = checkBuiltinCall(expr, env)) {
             return *builtin;
         }
+        if (const StructInfo* structure = types.lookupStruct(expr.callee)) {
+            return checkConstruction(expr, *structure, env);
+        }
 
         const auto it = functions.find(expr.callee);
         if (it == functions.end()) {
@@ -1043,6 +1121,57 @@ private:
             return makeArrayType();
         }
 
+        // Data-parallel maps; the last argument names a function that takes one number
+        if (expr.callee == "parallel_for" || expr.callee == "array_map_parallel") {
+            const bool range = expr.callee == "parallel_for";
+            const std::size_t expected = range ? 3 : 2;
+            if (expr.arguments.size() != expected) {
+                addDiagnostic(result, expr.location,
+                              "Builtin '" + expr.callee + "' expects " + std::to_string(expected) +
+                                  " arguments but received " + std::to_string(expr.arguments.size()));
+            }
+            for (std::size_t i = 0; i < expr.arguments.size(); ++i) {
+                if (!expr.arguments[i]) {
+                    continue;
+                }
+                const TypeInfo argumentType = evaluateArgument(i);
+                if (isError(argumentType) || i >= expected) {
+                    continue;
+                }
+                const Expression& argument = *expr.arguments[i];
+                if (i + 1 < expected) {
+                    if (range && !isNumeric(argumentType)) {
+                        addDiagnostic(result, argument.location,
+                                      "parallel_for expects numeric bounds but got '" + typeToString(argumentType) +
+                                          "'");
+                    } else if (!range && argumentType.kind != TypeKind::Array &&
+                               argumentType.kind != TypeKind::Unknown) {
+                        addDiagnostic(result, argument.location,
+                                      "array_map_parallel expects an array but got '" +
+                                          typeToString(argumentType) + "'");
+                    }
+                    continue;
+                }
+                if (argumentType.kind != TypeKind::String && argumentType.kind != TypeKind::Unknown) {
+                    addDiagnostic(result, argument.location,
+                                  expr.callee + " expects a function name but got '" + typeToString(argumentType) +
+                                      "'");
+                } else if (argument.kind == Expression::Kind::Literal &&
+                           argument.literal_kind == Expression::LiteralKind::String) {
+                    const auto callee = functions.find(argument.literal_value);
+                    if (callee == functions.end()) {
+                        addDiagnostic(result, argument.location,
+                                      expr.callee + ": unknown function '" + argument.literal_value + "'");
+                    } else if (callee->second.parameters.size() != 1) {
+                        addDiagnostic(result, argument.location,
+                                      expr.callee + ": '" + argument.literal_value +
+                                          "' must take exactly one argument");
+                    }
+                }
+            }
+            return makeArrayType();
+        }
+
         if (expr.callee == "array_push") {
             if (expr.arguments.size() != 2) {
                 addDiagnostic(result, expr.location,
@@ -1138,6 +1267,51 @@ private:
             return makePrimitive(TypeKind::Int);
         }
 
+        // Numeric array kernels; in `parameters`, 'a' is an array and 'n' a number
+        struct ArrayKernelBuiltin {
+            const char* name;
+            const char* parameters;
+            TypeKind result;
+        };
+        static constexpr ArrayKernelBuiltin kArrayKernels[] = {
+            {"array_dot", "aa", TypeKind::Float},   {"array_min", "a", TypeKind::Float},
+            {"array_max", "a", TypeKind::Float},    {"array_scale", "an", TypeKind::Array},
+            {"array_axpy", "naa", TypeKind::Array}, {"array_copy", "aa", TypeKind::Array},
+            {"array_sort", "a", TypeKind::Array},   {"array_sort_by_index", "a", TypeKind::Array},
+            {"array_binary_search", "an", TypeKind::Int},
+        };
+        for (const auto& kernel : kArrayKernels) {
+            if (expr.callee != kernel.name) {
+                continue;
+            }
+            const std::string parameters = kernel.parameters;
+            if (expr.arguments.size() != parameters.size()) {
+                addDiagnostic(result, expr.location,
+                              "Builtin '" + expr.callee + "' expects " + std::to_string(parameters.size()) +
+                                  (parameters.size() == 1 ? " argument" : " arguments") + " but received " +
+                                  std::to_string(expr.arguments.size()));
+            }
+            for (std::size_t i = 0; i < expr.arguments.size(); ++i) {
+                if (!expr.arguments[i]) {
+                    continue;
+                }
+                const TypeInfo argumentType = evaluateArgument(i);
+                if (i >= parameters.size() || isError(argumentType)) {
+                    continue;
+                }
+                if (parameters[i] == 'a' && argumentType.kind != TypeKind::Array &&
+                    argumentType.kind != TypeKind::Unknown) {
+                    addDiagnostic(result, expr.arguments[i]->location,
+                                  expr.callee + " expects an array but got '" + typeToString(argumentType) + "'");
+                } else if (parameters[i] == 'n' && !isNumeric(argumentType)) {
+                    addDiagnostic(result, expr.arguments[i]->location,
+                                  expr.callee + " expects a numeric argument but got '" +
+                                      typeToString(argumentType) + "'");
+                }
+            }
+            return kernel.result == TypeKind::Array ? makeArrayType() : makePrimitive(kernel.result);
+        }
+
         if (expr.callee == "array_set") {
             if (expr.arguments.size() != 3) {
                 addDiagnostic(result, expr.location,
@@ -1205,6 +1379,41 @@ private:
             return makePrimitive(TypeKind::String);
         }
 
+        if (expr.callee == "read_lines") {
+            if (expr.arguments.size() != 1) {
+                addDiagnostic(result, expr.location,
+                              "Builtin 'read_lines' expects 1 argument but received " +
+                                  std::to_string(expr.arguments.size()));
+            }
+            if (!expr.arguments.empty() && expr.arguments[0]) {
+                const TypeInfo countType = evaluateArgument(0);
+                if (!isError(countType) && !isNumeric(countType)) {
+                    addDiagnostic(result, expr.arguments[0]->location,
+                                  "read_lines count must be numeric but got '" + typeToString(countType) + "'");
+                }
+            }
+            for (std::size_t i = 1; i < expr.arguments.size(); ++i) {
+                if (expr.arguments[i]) {
+                    (void)evaluateArgument(i);
+                }
+            }
+            return makeArrayType();
+        }
+
+        if (expr.callee == "read_all") {
+            if (!expr.arguments.empty()) {
+                addDiagnostic(result, expr.location,
+                              "Builtin 'read_all' expects 0 arguments but received " +
+                                  std::to_string(expr.arguments.size()));
+            }
+            for (std::size_t i = 0; i < expr.arguments.size(); ++i) {
+                if (expr.arguments[i]) {
+                    (void)evaluateArgument(i);
+                }
+            }
+            return makePrimitive(TypeKind::String);
+        }
+
         // Math functions from std::math module
         if (expr.callee == "sqrt" || expr.callee == "std::math::sqrt") {
             if (expr.arguments.size() != 1) {
@@ -7,6 +7,7 @@
 #include "impulse/ir/cfg.h"
 #include "impulse/ir/ssa.h"
 #include "impulse/ir/ir.h"
+#include "impulse/ir/optimizer.h"
 
 namespace impulse::ir {
 
@@ -18,9 +19,10 @@ struct FunctionAnalysis {
     std::vector<std::string> optimisation_log;
 };
 
-[[nodiscard]] auto analyse_module(const Module& module) -> std::vector<FunctionAnalysis>;
+[[nodiscard]] auto analyse_module(const Module& module, const OptimizationOptions& options = {})
+    -> std::vector<FunctionAnalysis>;
 
-[[nodiscard]] auto optimise_with_log(SsaFunction function)
+[[nodiscard]] auto optimise_with_log(SsaFunction function, const OptimizationOptions& options = {})
     -> std::pair<SsaFunction, std::vector<std::string>>;
 
 }  // namespace impulse::ir
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_set>
+
+#include "impulse/ir/ssa.h"
+#include "impulse/ir/value_facts.h"
+
+namespace impulse::ir {
+
+// Array accesses whose index checks cannot fail. The proof covers counted loops: a header phi `i`
+// whose inputs are non-negative integer constants or `i + c` for such a c is a non-negative integer,
+// and where the header's `branch_if` only enters the loop while `i < array_length(a)`, `a[i]` in a
+// block dominated by that edge is in range. Arrays only shrink through `array_pop` and calls to user
+// functions, so none of them may run between the length and the access. The array is then known to
+// be one as well, since array_length checked it.
+class ArrayBounds {
+public:
+    ArrayBounds(const SsaFunction& function, const ValueFacts& facts);
+
+    // Whether `inst`, an array_get or array_set of the function, needs no index or bounds check.
+    // Instructions are identified by address, so the function must not change in between.
+    [[nodiscard]] auto in_bounds(const SsaInstruction& inst) const -> bool {
+        return proven_.count(&inst) != 0;
+    }
+    [[nodiscard]] auto size() const -> std::size_t { return proven_.size(); }
+
+private:
+    std::unordered_set<const SsaInstruction*> proven_;
+};
+
+}  // namespace impulse::ir
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <string>
 
 #include "impulse/ir/cfg.h"
 #include "impulse/ir/ir.h"
@@ -11,5 +12,7 @@ namespace impulse::ir {
 void dump_ir(const Module& module, std::ostream& out);
 void dump_cfg(const ControlFlowGraph& cfg, std::ostream& out);
 void dump_ssa(const SsaFunction& function, std::ostream& out, bool include_metadata = true);
+// One instruction as dump_ssa prints it, without indentation or newline
+[[nodiscard]] auto ssa_instruction_to_string(const SsaInstruction& inst) -> std::string;
 
 }  // namespace impulse::ir
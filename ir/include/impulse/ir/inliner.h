@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// What a call may be replaced with: the callee's final SSA, its parameter names in order and how
+// often it has been called so far
+struct InlineCandidate {
+    const SsaFunction* ssa = nullptr;
+    std::vector<std::string> parameters;
+    std::uint64_t calls = 0;
+};
+
+// Resolves the user-defined function a call names; nullopt for builtins, unknown names and
+// functions that must not be inlined (such as those still being compiled)
+using InlineLookup = std::function<std::optional<InlineCandidate>(const std::string& name)>;
+
+// Size limits, counted in SSA instructions
+struct InlineOptions {
+    std::size_t max_callee_instructions = 24;     // callees up to this size are always inlined
+    std::size_t hot_callee_instructions = 96;     // larger ones once they have had `hot_calls` calls
+    std::uint64_t hot_calls = 1000;
+    std::size_t max_function_instructions = 2000;  // a caller stops growing at this size
+};
+
+// Replaces calls to small functions with a copy of their body, renaming every callee value into
+// fresh temporaries of the caller. A callee qualifies when it is not the caller, takes exactly the
+// given arguments, reads no variable by name, returns a number on every path and only does
+// arithmetic, array element accesses and calls to other user-defined functions, so the copy
+// behaves exactly like the call did. Calls inside the copied body stay calls. Leaves dominators
+// and symbol indices rebuilt; returns how many calls were replaced.
+auto inline_calls(SsaFunction& caller, const InlineLookup& lookup, const InlineOptions& options = {})
+    -> std::size_t;
+
+}  // namespace impulse::ir
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "impulse/ir/ir.h"
 
@@ -27,11 +29,44 @@ struct FunctionEvalResult {
     std::string message;
 };
 
+// Runs the calls interpret_binding and interpret_function meet. Only functions marked callable
+// are run (see find_pure_functions in purity.h); since their result depends on nothing but their
+// arguments, each is evaluated once per distinct argument list, so naive recursion such as
+// fib(30) stays cheap. A top-level call gives up as NonConstant after `step_budget` instructions
+// or `max_depth` nested calls.
+class CallEvaluator {
+public:
+    static constexpr std::size_t kDefaultStepBudget = 1'000'000;
+    static constexpr std::size_t kMaxDepth = 256;
+
+    // `module` and `environment` (the values of module bindings) are read as they are at each call
+    CallEvaluator(const Module& module, std::vector<bool> callable,
+                  const std::unordered_map<std::string, double>& environment,
+                  std::size_t step_budget = kDefaultStepBudget);
+
+    [[nodiscard]] auto call(const std::string& name, const std::vector<double>& arguments) -> FunctionEvalResult;
+    // Accounts for one instruction; false once the current top-level call has used its budget
+    [[nodiscard]] auto spend() -> bool;
+
+private:
+    const Module& module_;
+    std::vector<bool> callable_;
+    const std::unordered_map<std::string, double>& environment_;
+    std::size_t step_budget_;
+    std::size_t steps_left_ = 0;
+    std::size_t depth_ = 0;
+    std::unordered_map<std::string, std::size_t> functions_;  // index in module_.functions by name
+    std::unordered_map<std::string, double> results_;         // by function index and argument bits
+};
+
+// Without `calls`, initializers and functions that call anything are NonConstant
 [[nodiscard]] auto interpret_binding(const Binding& binding,
-                                     const std::unordered_map<std::string, double>& environment) -> BindingEvalResult;
+                                     const std::unordered_map<std::string, double>& environment,
+                                     CallEvaluator* calls = nullptr) -> BindingEvalResult;
 
 [[nodiscard]] auto interpret_function(const Function& function,
                                       const std::unordered_map<std::string, double>& environment,
-                                      const std::unordered_map<std::string, double>& parameters) -> FunctionEvalResult;
+                                      const std::unordered_map<std::string, double>& parameters,
+                                      CallEvaluator* calls = nullptr) -> FunctionEvalResult;
 
 }  // namespace impulse::ir
@@ -15,6 +15,10 @@ struct StructField;
 struct BasicBlock;
 struct Instruction;
 
+// Tolerance the interpreter uses for zero divisors, integer tests and branch comparisons; the
+// optimizer and compiled code must agree with it
+inline constexpr double kEpsilon = 1e-12;
+
 enum class InstructionKind : std::uint8_t {
     Comment,
     Return,
@@ -33,6 +37,9 @@ enum class InstructionKind : std::uint8_t {
     ArrayGet,
     ArraySet,
     ArrayLength,
+    MakeStruct,  // operands: struct, field count; pops the field values in declaration order
+    FieldGet,    // operands: struct, field; pops the object
+    FieldSet,    // operands: struct, field; pops the value, then the object
 };
 
 struct Instruction {
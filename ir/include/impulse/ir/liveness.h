@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// Pack an SSA value into a single 64-bit key (symbol in the high half, version in the low half)
+[[nodiscard]] inline auto encode_ssa_value(const SsaValue& value) -> std::uint64_t {
+    return (static_cast<std::uint64_t>(value.symbol) << 32U) | static_cast<std::uint64_t>(value.version);
+}
+
+// Block-level liveness over SSA values.
+// Every value referenced by the function is numbered densely; live sets hold those dense indices.
+// Phi semantics follow the usual edge convention: a phi result is defined on entry to its block,
+// and a phi input is used at the end of the predecessor it flows in from.
+struct SsaLiveness {
+    std::vector<SsaValue> values;
+    std::unordered_map<std::uint64_t, std::size_t> index;
+    std::vector<std::vector<std::size_t>> live_in;   // per block, sorted
+    std::vector<std::vector<std::size_t>> live_out;  // per block, sorted
+
+    [[nodiscard]] auto find(const SsaValue& value) const -> std::optional<std::size_t>;
+    [[nodiscard]] auto is_live_out(std::size_t block, const SsaValue& value) const -> bool;
+};
+
+[[nodiscard]] auto compute_liveness(const SsaFunction& function) -> SsaLiveness;
+
+}  // namespace impulse::ir
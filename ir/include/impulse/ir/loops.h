@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// A natural loop: the target of one or more back edges (edges into a block that dominates their
+// source) together with every block that reaches such an edge without passing through the header.
+struct Loop {
+    std::size_t header = 0;
+    std::vector<std::size_t> blocks;   // sorted, header included
+    std::vector<std::size_t> latches;  // sources of the back edges, sorted
+    // The only predecessor from outside the loop, when the header is its only successor
+    std::optional<std::size_t> preheader;
+    std::optional<std::size_t> parent;  // innermost enclosing loop, as an index into LoopNest::loops
+    std::size_t depth = 1;
+
+    [[nodiscard]] auto contains(std::size_t block) const -> bool;
+};
+
+// Every loop of a function, inner loops before the loops enclosing them. Needs the dominator
+// information build_ssa and compute_dominators leave behind; irreducible cycles are not loops.
+struct LoopNest {
+    std::vector<Loop> loops;
+    std::vector<std::optional<std::size_t>> innermost;  // per block, the smallest loop containing it
+
+    [[nodiscard]] auto loop_of(std::size_t block) const -> const Loop*;
+};
+
+[[nodiscard]] auto find_loops(const SsaFunction& function) -> LoopNest;
+
+// Gives loops entered over a single edge from a block with other successors a preheader: an
+// empty block placed right before the header that branches to it. Keeping it adjacent keeps every
+// back edge pointing backwards in the block order. Returns how many blocks were inserted.
+auto insert_preheaders(SsaFunction& function) -> std::size_t;
+
+}  // namespace impulse::ir
@@ -1,9 +1,37 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "impulse/ir/ssa.h"
 
 namespace impulse::ir {
 
-[[nodiscard]] auto optimize_ssa(SsaFunction& function) -> bool;
+// Which passes optimize_ssa runs; all of them by default. `inlining` needs the other functions of
+// the module and `tail_calls` the parameter names, so the callers that have them run inline_calls
+// (inliner.h) and eliminate_self_tail_calls (tail_calls.h) before optimize_ssa. `fold_calls`
+// works on the whole module before SSA is built (fold_constant_calls in purity.h).
+struct OptimizationOptions {
+    bool fold_calls = true;                  // "fold-calls": evaluate pure calls with literal arguments at load
+    bool inlining = true;                    // "inline": replace calls to small functions with their body
+    bool tail_calls = true;                  // "tail-calls": turn self-recursive tail calls into loops
+    bool constant_propagation = true;        // "sccp": sparse conditional constant propagation
+    bool copy_propagation = true;            // "copy-propagation": forward assigns and trivial phis
+    bool value_numbering = true;             // "gvn": reuse identical computations over the dominator tree
+    bool loop_invariant_code_motion = true;  // "licm": move invariant computations into loop preheaders
+    bool strength_reduction = true;          // "strength-reduction": turn induction variable products into sums
+    bool scalar_replacement = true;          // "scalar-replacement": keep arrays that do not escape in SSA values
+    bool dead_code_elimination = true;       // "dce": drop unused side-effect-free definitions
+};
+
+// Turns off the pass called `pass` (the names above); false when there is no such pass
+[[nodiscard]] auto disable_optimization_pass(OptimizationOptions& options, std::string_view pass) -> bool;
+
+// Runs the enabled passes until none of them changes anything. Every pass keeps the behaviour
+// the interpreter gives the unoptimised function, runtime errors included. When `log` is given,
+// one summary line per pass is appended to it. Returns whether the function changed.
+[[nodiscard]] auto optimize_ssa(SsaFunction& function, const OptimizationOptions& options = {},
+                                std::vector<std::string>* log = nullptr) -> bool;
 
 }  // namespace impulse::ir
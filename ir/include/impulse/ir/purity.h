@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "impulse/ir/interpreter.h"
+#include "impulse/ir/ir.h"
+
+namespace impulse::ir {
+
+// Which functions are pure, indexed like module.functions. A pure function's result depends on
+// nothing but its arguments and running it has no effect: it uses no strings, arrays or structs,
+// calls no builtins (so does no I/O), writes no module binding, reads no `var` binding, and only
+// calls functions that are pure as well (itself included).
+[[nodiscard]] auto find_pure_functions(const Module& module) -> std::vector<bool>;
+
+// Replaces each call in `function` whose arguments are all literals with the result `calls`
+// computes for it, so only calls to the functions it may run (the pure ones) are replaced. Calls
+// folded earlier count as literals, so fib(fib(5)) folds too; calls that fail or run out of
+// budget stay calls, for the Vm to run and report. Returns how many calls were replaced.
+auto fold_constant_calls(Function& function, CallEvaluator& calls) -> std::size_t;
+
+}  // namespace impulse::ir
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// Little-endian binary encoding shared by the on-disk caches
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) : out_(out) {}
+
+    void u8(std::uint8_t value) { out_.push_back(static_cast<char>(value)); }
+    void u32(std::uint32_t value);
+    void u64(std::uint64_t value);
+    void string(std::string_view value);
+    void bytes(const void* data, std::size_t size);
+
+private:
+    std::string& out_;
+};
+
+// Reads what BinaryWriter wrote. Reads past the end fail the reader instead of throwing; every
+// later read then returns zero values, so callers check ok() once at the end.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view in) : in_(in) {}
+
+    [[nodiscard]] auto u8() -> std::uint8_t;
+    [[nodiscard]] auto u32() -> std::uint32_t;
+    [[nodiscard]] auto u64() -> std::uint64_t;
+    [[nodiscard]] auto string() -> std::string;
+    // Borrowed view of the next `size` bytes of the input
+    [[nodiscard]] auto bytes(std::size_t size) -> std::string_view;
+
+    void fail() { ok_ = false; }
+    [[nodiscard]] auto ok() const -> bool { return ok_; }
+    [[nodiscard]] auto remaining() const -> std::size_t { return in_.size(); }
+
+private:
+    [[nodiscard]] auto take(std::size_t size) -> std::string_view;
+
+    std::string_view in_;
+    bool ok_ = true;
+};
+
+// Encoding of a complete SSA function, including its dominator information
+void serialize_ssa(const SsaFunction& function, BinaryWriter& out);
+[[nodiscard]] auto deserialize_ssa(BinaryReader& in) -> std::optional<SsaFunction>;
+
+}  // namespace impulse::ir
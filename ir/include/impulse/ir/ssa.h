@@ -39,6 +39,11 @@ enum class SsaOpcode : std::uint8_t {
     ArrayLength,
     ArrayPush,
     ArrayPop,
+
+    // Struct operations: immediates name the struct (and the field)
+    StructMake,
+    FieldGet,
+    FieldSet,
     
     // Other
     Drop,
@@ -63,6 +68,9 @@ enum class SsaOpcode : std::uint8_t {
     if (s == "array_length") return SsaOpcode::ArrayLength;
     if (s == "array_push") return SsaOpcode::ArrayPush;
     if (s == "array_pop") return SsaOpcode::ArrayPop;
+    if (s == "field_get") return SsaOpcode::FieldGet;
+    if (s == "field_set") return SsaOpcode::FieldSet;
+    if (s == "struct_make") return SsaOpcode::StructMake;
     if (s == "unary") return SsaOpcode::Unary;
     if (s == "literal_string") return SsaOpcode::LiteralString;
     if (s == "drop") return SsaOpcode::Drop;
@@ -87,6 +95,9 @@ enum class SsaOpcode : std::uint8_t {
         case SsaOpcode::ArrayLength: return "array_length";
         case SsaOpcode::ArrayPush: return "array_push";
         case SsaOpcode::ArrayPop: return "array_pop";
+        case SsaOpcode::StructMake: return "struct_make";
+        case SsaOpcode::FieldGet: return "field_get";
+        case SsaOpcode::FieldSet: return "field_set";
         case SsaOpcode::Drop: return "drop";
         case SsaOpcode::Unknown: return "unknown";
     }
@@ -128,6 +139,22 @@ enum class BinaryOp : std::uint8_t {
     return BinaryOp::Unknown;
 }
 
+enum class UnaryOp : std::uint8_t {
+    Neg,  // -
+    Not,  // !
+    Unknown
+};
+
+[[nodiscard]] inline auto unary_op_from_string(const std::string& s) -> UnaryOp {
+    if (s == "-") return UnaryOp::Neg;
+    if (s == "!") return UnaryOp::Not;
+    return UnaryOp::Unknown;
+}
+
+// Parses a `literal` immediate with the runtime's rules ("true", "false", '_' digit separators),
+// so a literal only counts as a number when it would load as one
+[[nodiscard]] auto parse_number_literal(const std::string& text) -> std::optional<double>;
+
 struct SsaValue {
     SymbolId symbol = 0;
     std::uint32_t version = 0;
@@ -156,8 +183,16 @@ struct SsaInstruction {
     std::vector<SsaValue> arguments;
     std::vector<std::string> immediates;
     std::optional<SsaValue> result;
+    UnaryOp unary_op = UnaryOp::Unknown;  // For unary instructions
+    // Literal: its value; BranchIf: the value the condition is compared against (immediates[1]).
+    // Nullopt when the text is missing or does not parse.
+    std::optional<double> number;
 };
 
+// Fill op, binary_op, unary_op and number from opcode and immediates, so no later stage has to
+// parse them again. Passes that rewrite a literal's or a branch_if's text must call it.
+void decode_operands(SsaInstruction& inst);
+
 struct SsaBlock {
     std::size_t id = 0;
     std::string name;
@@ -190,6 +225,11 @@ struct SsaFunction {
     [[nodiscard]] auto find_symbol(const std::string& name) const -> const SsaSymbol*;
 };
 
+// Rebuild the symbol lookup indices from `function.symbols`
+void index_symbols(SsaFunction& function);
+// Recompute immediate dominators, dominator children and dominance frontiers from the edges
+void compute_dominators(SsaFunction& function);
+
 [[nodiscard]] auto build_ssa(const Function& function, const ControlFlowGraph& cfg) -> SsaFunction;
 [[nodiscard]] auto build_ssa(const Function& function) -> SsaFunction;
 
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// Whether instruction `index` of `block` is a call in tail position: the instruction after it
+// returns the call's result, so the caller has nothing left to do once the callee is done
+[[nodiscard]] auto is_tail_call(const SsaBlock& block, std::size_t index) -> bool;
+
+// Turns calls of `function` to itself in tail position into jumps back to its start. A new entry
+// block branches to the old one, which gets a phi per parameter (`parameters`, by name, in order)
+// taking the arguments of every such call, and reads of the parameters go to the phis. Only done
+// when the old entry has no predecessors and no parameter is read by name (vN.0). Leaves
+// dominators and symbol indices rebuilt; returns how many calls were replaced.
+auto eliminate_self_tail_calls(SsaFunction& function, const std::vector<std::string>& parameters) -> std::size_t;
+
+}  // namespace impulse::ir
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::ir {
+
+// What is known about a function's values without running it: which are always numbers and which
+// always integers (exactly representable ones, below 2^53). Both are greatest fixed points: start
+// from every value that may qualify and drop those with an input that does not. Additions of
+// strings concatenate, so they only count with numeric inputs. Parameters declared int, float or
+// bool are numbers, as semantic analysis only lets numbers through to them.
+class ValueFacts {
+public:
+    explicit ValueFacts(const SsaFunction& function);
+
+    [[nodiscard]] auto numeric(const SsaValue& value) const -> bool;
+    [[nodiscard]] auto integral(const SsaValue& value) const -> bool;
+    // The value of a parseable literal
+    [[nodiscard]] auto constant(const SsaValue& value) const -> std::optional<double>;
+    // A constant the interpreter would not reject as a zero divisor
+    [[nodiscard]] auto safe_divisor(const SsaValue& value) const -> bool;
+
+private:
+    std::unordered_map<std::uint64_t, double> constants_;
+    std::unordered_set<std::uint64_t> numbers_;
+    std::unordered_set<std::uint64_t> integers_;
+};
+
+}  // namespace impulse::ir
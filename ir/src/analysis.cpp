@@ -1,16 +1,22 @@
 #include "impulse/ir/analysis.h"
 
-#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <optional>
+
+#include "impulse/ir/inliner.h"
 
 namespace impulse::ir {
 
-auto optimise_with_log(SsaFunction function) -> std::pair<SsaFunction, std::vector<std::string>> {
+auto optimise_with_log(SsaFunction function, const OptimizationOptions& options)
+    -> std::pair<SsaFunction, std::vector<std::string>> {
+    index_symbols(function);  // the copy still points into the original's symbols
     std::vector<std::string> log;
-    log.push_back("optimizations disabled - using JIT");
+    [[maybe_unused]] const bool changed = optimize_ssa(function, options, &log);
     return {std::move(function), std::move(log)};
 }
 
-auto analyse_module(const Module& module) -> std::vector<FunctionAnalysis> {
+auto analyse_module(const Module& module, const OptimizationOptions& options) -> std::vector<FunctionAnalysis> {
     std::vector<FunctionAnalysis> results;
     results.reserve(module.functions.size());
 
@@ -19,12 +25,54 @@ auto analyse_module(const Module& module) -> std::vector<FunctionAnalysis> {
         analysis.name = function.name;
         analysis.cfg = build_control_flow_graph(function);
         analysis.ssa_before = build_ssa(function, analysis.cfg);
-        auto optimisation_result = optimise_with_log(analysis.ssa_before);
-        analysis.ssa_after = std::move(optimisation_result.first);
-        analysis.optimisation_log = std::move(optimisation_result.second);
         results.push_back(std::move(analysis));
     }
 
+    // Callees are optimised before their callers, as the Vm does, so inlined bodies are final.
+    // Functions still on the stack (recursion) are left as calls.
+    std::vector<bool> finished(results.size(), false);
+    std::vector<bool> active(results.size(), false);
+    std::function<void(std::size_t)> finish = [&](std::size_t index) {
+        auto& analysis = results[index];
+        active[index] = true;
+        SsaFunction function = analysis.ssa_before;
+        index_symbols(function);  // the copy still points into the original's symbols
+        std::string inline_summary = "disabled";
+        if (options.inlining) {
+            const auto lookup = [&](const std::string& name) -> std::optional<InlineCandidate> {
+                const auto callee = std::find_if(module.functions.begin(), module.functions.end(),
+                                                 [&](const Function& candidate) { return candidate.name == name; });
+                const auto callee_index = static_cast<std::size_t>(callee - module.functions.begin());
+                if (callee == module.functions.end() || callee->blocks.empty() || active[callee_index]) {
+                    return std::nullopt;
+                }
+                if (!finished[callee_index]) {
+                    finish(callee_index);
+                }
+                InlineCandidate candidate;
+                candidate.ssa = &results[callee_index].ssa_after;
+                for (const auto& parameter : callee->parameters) {
+                    candidate.parameters.push_back(parameter.name);
+                }
+                return candidate;
+            };
+            const std::size_t inlined = inline_calls(function, lookup);
+            inline_summary = std::to_string(inlined) + (inlined == 1 ? " call" : " calls") + " inlined";
+        }
+        auto optimisation_result = optimise_with_log(std::move(function), options);
+        analysis.ssa_after = std::move(optimisation_result.first);
+        analysis.optimisation_log.push_back("inline: " + inline_summary);
+        analysis.optimisation_log.insert(analysis.optimisation_log.end(), optimisation_result.second.begin(),
+                                         optimisation_result.second.end());
+        active[index] = false;
+        finished[index] = true;
+    };
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (!finished[i]) {
+            finish(i);
+        }
+    }
+
     return results;
 }
 
@@ -0,0 +1,242 @@
+#include "impulse/ir/bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/ir/liveness.h"
+#include "impulse/ir/loops.h"
+
+namespace impulse::ir {
+
+namespace {
+
+constexpr double kMaxExactInteger = 9007199254740992.0;  // 2^53
+
+[[nodiscard]] auto same(const SsaValue& left, const SsaValue& right) -> bool {
+    return left.symbol == right.symbol && left.version == right.version;
+}
+
+[[nodiscard]] auto dominates(const SsaFunction& function, std::size_t dominator, std::size_t block) -> bool {
+    const std::size_t count = function.blocks.size();
+    while (block < count) {
+        if (block == dominator) {
+            return true;
+        }
+        const std::size_t parent = function.blocks[block].immediate_dominator;
+        if (parent == block) {
+            return false;
+        }
+        block = parent;
+    }
+    return false;
+}
+
+// Whether `inst` leaves the length of every array as it is, or only grows it. Builtins other
+// than array_pop keep lengths; a user function might pop.
+[[nodiscard]] auto keeps_lengths(const SsaInstruction& inst) -> bool {
+    if (inst.op == SsaOpcode::ArrayPop) {
+        return false;
+    }
+    if (inst.op != SsaOpcode::Call) {
+        return true;
+    }
+    static const std::unordered_set<std::string> builtins{
+        "print",     "println",   "array_push", "array_sum",  "array_dot",  "array_min",
+        "array_max", "array_scale", "array_axpy", "array_copy", "array_fill", "array_sort",
+        "array_sort_by_index", "array_binary_search", "array_join", "parallel_for", "array_map_parallel",
+    };
+    return !inst.immediates.empty() && builtins.count(inst.immediates.front()) != 0;
+}
+
+[[nodiscard]] auto non_negative_integer(std::optional<double> value) -> bool {
+    return value.has_value() && *value >= 0.0 && std::floor(*value) == *value && *value <= kMaxExactInteger;
+}
+
+class Prover {
+public:
+    Prover(const SsaFunction& function, const ValueFacts& facts) : function_(function), facts_(facts) {
+        shrinks_.assign(function.blocks.size(), false);
+        for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+            for (const auto& inst : function.blocks[b].instructions) {
+                if (inst.result.has_value()) {
+                    definitions_[encode_ssa_value(*inst.result)] = Definition{b, &inst};
+                }
+                shrinks_[b] = shrinks_[b] || !keeps_lengths(inst);
+            }
+        }
+    }
+
+    void prove(const Loop& loop, std::unordered_set<const SsaInstruction*>& proven) const {
+        if (std::any_of(loop.blocks.begin(), loop.blocks.end(), [&](std::size_t b) { return shrinks_[b]; })) {
+            return;
+        }
+        const auto& header = function_.blocks[loop.header];
+        if (header.instructions.empty() || header.successors.size() != 2) {
+            return;
+        }
+        const auto& branch = header.instructions.back();
+        if (branch.op != SsaOpcode::BranchIf || branch.arguments.size() != 1 || branch.immediates.empty() ||
+            !branch.number.has_value()) {
+            return;
+        }
+        const auto* compare = definition(branch.arguments[0]);
+        if (compare == nullptr || compare->inst->op != SsaOpcode::Binary || compare->inst->arguments.size() != 2) {
+            return;
+        }
+        SsaValue index;
+        SsaValue bound;
+        if (compare->inst->binary_op == BinaryOp::Lt) {
+            index = compare->inst->arguments[0];
+            bound = compare->inst->arguments[1];
+        } else if (compare->inst->binary_op == BinaryOp::Gt) {
+            index = compare->inst->arguments[1];
+            bound = compare->inst->arguments[0];
+        } else {
+            return;
+        }
+
+        // The successor taken exactly when the comparison holds, entered from the header only
+        const std::size_t target = function_.blocks[header.successors[0]].name == branch.immediates.front()
+                                       ? header.successors[0]
+                                       : header.successors[1];
+        const std::size_t other = target == header.successors[0] ? header.successors[1] : header.successors[0];
+        std::size_t inside = 0;
+        if (std::abs(*branch.number - 1.0) < kEpsilon) {
+            inside = target;
+        } else if (std::abs(*branch.number) < kEpsilon) {
+            inside = other;
+        } else {
+            return;
+        }
+        if (!loop.contains(inside) || function_.blocks[inside].predecessors != std::vector<std::size_t>{loop.header}) {
+            return;
+        }
+
+        const auto* length = definition(bound);
+        if (length == nullptr || length->inst->op != SsaOpcode::ArrayLength || length->inst->arguments.size() != 1 ||
+            !induction(header, index) || !length_stays(*length, loop)) {
+            return;
+        }
+        const SsaValue& array = length->inst->arguments[0];
+        for (const auto b : loop.blocks) {
+            if (!dominates(function_, inside, b)) {
+                continue;
+            }
+            for (const auto& inst : function_.blocks[b].instructions) {
+                const bool access = (inst.op == SsaOpcode::ArrayGet && inst.arguments.size() == 2) ||
+                                    (inst.op == SsaOpcode::ArraySet && inst.arguments.size() == 3);
+                if (access && same(inst.arguments[0], array) && same(inst.arguments[1], index)) {
+                    proven.insert(&inst);
+                }
+            }
+        }
+    }
+
+private:
+    struct Definition {
+        std::size_t block = 0;
+        const SsaInstruction* inst = nullptr;
+    };
+
+    [[nodiscard]] auto definition(const SsaValue& value) const -> const Definition* {
+        const auto it = definitions_.find(encode_ssa_value(value));
+        return it == definitions_.end() || value.version == 0 ? nullptr : &it->second;
+    }
+
+    // A phi of the header that starts at and steps by non-negative integers
+    [[nodiscard]] auto induction(const SsaBlock& header, const SsaValue& value) const -> bool {
+        for (const auto& phi : header.phi_nodes) {
+            if (!same(phi.result, value)) {
+                continue;
+            }
+            for (const auto& input : phi.inputs) {
+                if (!input.value.has_value()) {
+                    return false;
+                }
+                if (non_negative_integer(facts_.constant(*input.value))) {
+                    continue;
+                }
+                const auto* step = definition(*input.value);
+                if (step == nullptr || step->inst->op != SsaOpcode::Binary ||
+                    step->inst->binary_op != BinaryOp::Add || step->inst->arguments.size() != 2) {
+                    return false;
+                }
+                const auto& args = step->inst->arguments;
+                const bool stepped = (same(args[0], phi.result) && non_negative_integer(facts_.constant(args[1]))) ||
+                                     (same(args[1], phi.result) && non_negative_integer(facts_.constant(args[0])));
+                if (!stepped) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Whether no instruction that might shrink an array runs between the length and the loop.
+    // The loop itself has been checked already.
+    [[nodiscard]] auto length_stays(const Definition& length, const Loop& loop) const -> bool {
+        if (loop.contains(length.block)) {
+            return true;
+        }
+        const std::size_t count = function_.blocks.size();
+        std::vector<bool> after(count, false);
+        std::vector<std::size_t> work{length.block};
+        after[length.block] = true;
+        while (!work.empty()) {
+            const std::size_t b = work.back();
+            work.pop_back();
+            for (const auto successor : function_.blocks[b].successors) {
+                if (!after[successor] && !loop.contains(successor)) {
+                    after[successor] = true;
+                    work.push_back(successor);
+                }
+            }
+        }
+        std::vector<bool> before(count, false);
+        for (const auto predecessor : function_.blocks[loop.header].predecessors) {
+            if (!loop.contains(predecessor) && !before[predecessor]) {
+                before[predecessor] = true;
+                work.push_back(predecessor);
+            }
+        }
+        while (!work.empty()) {
+            const std::size_t b = work.back();
+            work.pop_back();
+            if (after[b] && shrinks_[b]) {
+                return false;
+            }
+            if (b == length.block) {
+                continue;
+            }
+            for (const auto predecessor : function_.blocks[b].predecessors) {
+                if (!before[predecessor] && !loop.contains(predecessor)) {
+                    before[predecessor] = true;
+                    work.push_back(predecessor);
+                }
+            }
+        }
+        return true;
+    }
+
+    const SsaFunction& function_;
+    const ValueFacts& facts_;
+    std::unordered_map<std::uint64_t, Definition> definitions_;
+    std::vector<bool> shrinks_;  // per block
+};
+
+}  // namespace
+
+ArrayBounds::ArrayBounds(const SsaFunction& function, const ValueFacts& facts) {
+    const Prover prover(function, facts);
+    for (const auto& loop : find_loops(function).loops) {
+        prover.prove(loop, proven_);
+    }
+}
+
+}  // namespace impulse::ir
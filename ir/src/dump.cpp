@@ -2,6 +2,7 @@
 
 #include <limits>
 #include <ostream>
+#include <sstream>
 #include <string>
 
 #include "impulse/ir/printer.h"
@@ -120,6 +121,16 @@ auto instruction_to_string(const Instruction& inst) -> std::string {
             return "array_set";
         case InstructionKind::ArrayLength:
             return "array_length";
+        case InstructionKind::MakeStruct:
+            return inst.operands.empty() ? "make_struct" : "make_struct " + inst.operands.front();
+        case InstructionKind::FieldGet:
+        case InstructionKind::FieldSet: {
+            std::string result = inst.kind == InstructionKind::FieldGet ? "field_get" : "field_set";
+            if (inst.operands.size() >= 2) {
+                result += ' ' + inst.operands[0] + '.' + inst.operands[1];
+            }
+            return result;
+        }
     }
     return "<instruction>";
 }
@@ -270,6 +281,14 @@ void dump_ssa_block(const SsaBlock& block, std::ostream& out, bool include_metad
 
 }  // namespace
 
+auto ssa_instruction_to_string(const SsaInstruction& inst) -> std::string {
+    std::ostringstream out;
+    dump_ssa_instruction(inst, out, 0);
+    std::string text = out.str();
+    text.pop_back();  // the newline
+    return text;
+}
+
 void dump_ir(const Module& module, std::ostream& out) {
     out << print_module(module);
 }
@@ -0,0 +1,329 @@
+#include "impulse/ir/inliner.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+
+#include "impulse/ir/value_facts.h"
+
+namespace impulse::ir {
+
+namespace {
+
+[[nodiscard]] auto instruction_count(const SsaFunction& function) -> std::size_t {
+    std::size_t count = 0;
+    for (const auto& block : function.blocks) {
+        count += block.phi_nodes.size() + block.instructions.size();
+    }
+    return count;
+}
+
+[[nodiscard]] auto make_branch(const std::string& target) -> SsaInstruction {
+    SsaInstruction branch;
+    branch.op = SsaOpcode::Branch;
+    branch.opcode = "branch";
+    branch.immediates.push_back(target);
+    return branch;
+}
+
+// Whether replacing a call to `callee` with its body keeps every observable effect: output and
+// errors come from the same instructions, and nothing depends on the callee having its own frame
+// (variables read by name, a non-numeric return value, falling off the end of a block).
+[[nodiscard]] auto inlinable(const SsaFunction& callee, const InlineLookup& lookup) -> bool {
+    if (callee.blocks.empty() || !callee.blocks.front().phi_nodes.empty() ||
+        !callee.blocks.front().predecessors.empty()) {
+        return false;  // the entry must stay enterable over a single edge
+    }
+    const ValueFacts facts(callee);
+    for (const auto& block : callee.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value() && input.value->version == 0) {
+                    return false;
+                }
+            }
+        }
+        bool returns = false;
+        for (const auto& inst : block.instructions) {
+            if (std::any_of(inst.arguments.begin(), inst.arguments.end(),
+                            [](const SsaValue& value) { return value.version == 0; })) {
+                return false;
+            }
+            switch (inst.op) {
+                case SsaOpcode::Literal:
+                case SsaOpcode::Assign:
+                case SsaOpcode::Binary:
+                case SsaOpcode::Unary:
+                case SsaOpcode::Branch:
+                case SsaOpcode::BranchIf:
+                case SsaOpcode::Drop:
+                case SsaOpcode::ArrayGet:
+                case SsaOpcode::ArraySet:
+                case SsaOpcode::ArrayLength:
+                case SsaOpcode::FieldGet:
+                case SsaOpcode::FieldSet:
+                    break;
+                case SsaOpcode::Return:
+                    if (inst.arguments.size() != 1 || !facts.numeric(inst.arguments[0])) {
+                        return false;
+                    }
+                    returns = true;
+                    break;
+                case SsaOpcode::Call:
+                    if (inst.immediates.empty() || !lookup(inst.immediates.front()).has_value()) {
+                        return false;  // builtins have to see the caller's frame
+                    }
+                    break;
+                default:
+                    return false;
+            }
+            if (returns) {
+                break;
+            }
+        }
+        if (!returns && block.successors.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies one callee body into a caller at a call site
+class CallSplicer {
+public:
+    CallSplicer(SsaFunction& caller, const SsaFunction& callee, const std::vector<std::string>& parameters)
+        : caller_(caller), callee_(callee) {
+        for (const auto& symbol : caller_.symbols) {
+            next_id_ = std::max(next_id_, symbol.id + 1);
+            if (symbol.name.size() > 2 && symbol.name.compare(0, 2, "%t") == 0) {
+                const auto number = std::strtoull(symbol.name.c_str() + 2, nullptr, 10);
+                next_temporary_ = std::max(next_temporary_, static_cast<std::size_t>(number) + 1);
+            }
+        }
+        for (std::size_t i = 0; i < parameters.size(); ++i) {
+            for (const auto& symbol : callee_.symbols) {
+                if (symbol.name == parameters[i]) {
+                    parameter_index_.emplace(symbol.id, i);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Replaces the call at instruction `index` of `block` by the callee body. The instructions
+    // after it move to a new block following the copy; returns that block's index.
+    auto splice(std::size_t block, std::size_t index, const std::string& prefix) -> std::size_t {
+        const SsaInstruction call = caller_.blocks[block].instructions[index];
+        arguments_ = call.arguments;
+        const std::size_t count = callee_.blocks.size();
+        const std::size_t entry = block + 1;
+        const std::size_t tail = entry + count;
+        const auto shift = [&](std::size_t& target) {
+            if (target > block) {
+                target += count + 1;
+            }
+        };
+        for (auto& existing : caller_.blocks) {
+            shift(existing.id);
+            std::for_each(existing.successors.begin(), existing.successors.end(), shift);
+            std::for_each(existing.predecessors.begin(), existing.predecessors.end(), shift);
+            for (auto& phi : existing.phi_nodes) {
+                for (auto& input : phi.inputs) {
+                    shift(input.predecessor);
+                }
+            }
+        }
+
+        SsaBlock rest;
+        rest.id = tail;
+        rest.name = prefix + "return";
+        auto& head = caller_.blocks[block];
+        const auto after = head.instructions.begin() + static_cast<std::ptrdiff_t>(index) + 1;
+        rest.instructions.assign(std::make_move_iterator(after), std::make_move_iterator(head.instructions.end()));
+        rest.successors = std::move(head.successors);
+        head.instructions.resize(index);
+        head.instructions.push_back(make_branch(prefix + callee_.blocks.front().name));
+        head.successors = {entry};
+        for (const auto successor : rest.successors) {
+            // The copy is not in place yet, so shifted indices are still off by its size
+            auto& next = caller_.blocks[successor > block ? successor - count - 1 : successor];
+            std::replace(next.predecessors.begin(), next.predecessors.end(), block, tail);
+            for (auto& phi : next.phi_nodes) {
+                for (auto& input : phi.inputs) {
+                    if (input.predecessor == block) {
+                        input.predecessor = tail;
+                    }
+                }
+            }
+        }
+
+        std::vector<SsaBlock> body;
+        body.reserve(count + 1);
+        std::vector<PhiInput> results;
+        for (std::size_t b = 0; b < count; ++b) {
+            body.push_back(copy_block(callee_.blocks[b], entry, prefix, rest.name, tail, results));
+        }
+        body.front().predecessors = {block};
+        for (const auto& result : results) {
+            rest.predecessors.push_back(result.predecessor);
+        }
+        if (call.result.has_value()) {
+            if (results.size() == 1) {
+                SsaInstruction assign;
+                assign.op = SsaOpcode::Assign;
+                assign.opcode = "assign";
+                assign.arguments.push_back(*results.front().value);
+                assign.result = call.result;
+                auto& returning = body[results.front().predecessor - entry].instructions;
+                returning.insert(returning.end() - 1, std::move(assign));
+            } else if (!results.empty()) {
+                PhiNode phi;
+                phi.result = *call.result;
+                phi.symbol = call.result->symbol;
+                phi.inputs = std::move(results);
+                rest.phi_nodes.push_back(std::move(phi));
+            }
+        }
+        body.push_back(std::move(rest));
+        caller_.blocks.insert(caller_.blocks.begin() + static_cast<std::ptrdiff_t>(entry),
+                              std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+        return tail;
+    }
+
+private:
+    [[nodiscard]] auto rename(const SsaValue& value) -> SsaValue {
+        const auto parameter = parameter_index_.find(value.symbol);
+        if (parameter != parameter_index_.end() && value.version == 1 && parameter->second < arguments_.size()) {
+            return arguments_[parameter->second];
+        }
+        auto [it, inserted] = symbols_.emplace(value.symbol, next_id_);
+        if (inserted) {
+            caller_.symbols.push_back(SsaSymbol{next_id_, "%t" + std::to_string(next_temporary_++), {}});
+            ++next_id_;
+        }
+        return SsaValue{it->second, value.version};
+    }
+
+    [[nodiscard]] auto copy_block(const SsaBlock& source, std::size_t offset, const std::string& prefix,
+                                  const std::string& return_label, std::size_t return_block,
+                                  std::vector<PhiInput>& results) -> SsaBlock {
+        SsaBlock block;
+        block.id = source.id + offset;
+        block.name = prefix + source.name;
+        for (const auto successor : source.successors) {
+            block.successors.push_back(successor + offset);
+        }
+        for (const auto predecessor : source.predecessors) {
+            block.predecessors.push_back(predecessor + offset);
+        }
+        for (const auto& phi : source.phi_nodes) {
+            PhiNode copy;
+            copy.result = rename(phi.result);
+            copy.symbol = copy.result.symbol;
+            for (const auto& input : phi.inputs) {
+                PhiInput renamed;
+                renamed.predecessor = input.predecessor + offset;
+                if (input.value.has_value()) {
+                    renamed.value = rename(*input.value);
+                }
+                copy.inputs.push_back(std::move(renamed));
+            }
+            block.phi_nodes.push_back(std::move(copy));
+        }
+        for (const auto& inst : source.instructions) {
+            if (inst.op == SsaOpcode::Return) {
+                results.push_back(PhiInput{block.id, rename(inst.arguments.front())});
+                block.instructions.push_back(make_branch(return_label));
+                block.successors = {return_block};
+                break;
+            }
+            SsaInstruction copy = inst;
+            for (auto& argument : copy.arguments) {
+                argument = rename(argument);
+            }
+            if (copy.result.has_value()) {
+                copy.result = rename(*copy.result);
+            }
+            if ((copy.op == SsaOpcode::Branch || copy.op == SsaOpcode::BranchIf) && !copy.immediates.empty() &&
+                callee_.find_block(copy.immediates.front()) != nullptr) {
+                copy.immediates.front() = prefix + copy.immediates.front();
+            }
+            block.instructions.push_back(std::move(copy));
+        }
+        return block;
+    }
+
+    SsaFunction& caller_;
+    const SsaFunction& callee_;
+    std::vector<SsaValue> arguments_;
+    std::unordered_map<SymbolId, std::size_t> parameter_index_;
+    std::unordered_map<SymbolId, SymbolId> symbols_;
+    SymbolId next_id_ = 1;
+    std::size_t next_temporary_ = 0;
+};
+
+[[nodiscard]] auto unused_prefix(const SsaFunction& caller, const std::string& callee, std::size_t& site)
+    -> std::string {
+    for (;; ++site) {
+        std::string prefix = "inline" + std::to_string(site) + "." + callee + ".";
+        const bool taken = std::any_of(caller.blocks.begin(), caller.blocks.end(), [&](const SsaBlock& block) {
+            return block.name.compare(0, prefix.size(), prefix) == 0;
+        });
+        if (!taken) {
+            ++site;
+            return prefix;
+        }
+    }
+}
+
+}  // namespace
+
+auto inline_calls(SsaFunction& caller, const InlineLookup& lookup, const InlineOptions& options) -> std::size_t {
+    std::unordered_map<std::string, bool> verdicts;
+    std::size_t size = instruction_count(caller);
+    std::size_t inlined = 0;
+    std::size_t site = 0;
+
+    for (std::size_t b = 0; b < caller.blocks.size(); ++b) {
+        std::size_t i = 0;
+        while (i < caller.blocks[b].instructions.size()) {
+            const auto& inst = caller.blocks[b].instructions[i];
+            const std::string name = inst.immediates.empty() ? std::string{} : inst.immediates.front();
+            const auto candidate = inst.op == SsaOpcode::Call && name != caller.name ? lookup(name) : std::nullopt;
+            bool fits = candidate.has_value() && candidate->ssa != nullptr &&
+                        candidate->parameters.size() == inst.arguments.size();
+            if (fits) {
+                const std::size_t callee_size = instruction_count(*candidate->ssa);
+                const std::size_t budget = candidate->calls >= options.hot_calls ? options.hot_callee_instructions
+                                                                                 : options.max_callee_instructions;
+                fits = callee_size <= budget && size + callee_size <= options.max_function_instructions;
+                if (fits) {
+                    auto verdict = verdicts.find(name);
+                    if (verdict == verdicts.end()) {
+                        verdict = verdicts.emplace(name, inlinable(*candidate->ssa, lookup)).first;
+                    }
+                    fits = verdict->second;
+                }
+                if (fits) {
+                    size += callee_size;
+                }
+            }
+            if (!fits) {
+                ++i;
+                continue;
+            }
+            CallSplicer splicer(caller, *candidate->ssa, candidate->parameters);
+            b = splicer.splice(b, i, unused_prefix(caller, name, site));  // go on after the call
+            i = 0;
+            ++inlined;
+        }
+    }
+    if (inlined != 0) {
+        compute_dominators(caller);
+        index_symbols(caller);
+    }
+    return inlined;
+}
+
+}  // namespace impulse::ir
@@ -1,6 +1,8 @@
 #include "impulse/ir/interpreter.h"
 
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -10,8 +12,6 @@ namespace impulse::ir {
 
 namespace {
 
-constexpr double kEpsilon = 1e-12;
-
 [[nodiscard]] auto strip_numeric_separators(std::string_view literal) -> std::string {
     std::string sanitized;
     sanitized.reserve(literal.size());
@@ -49,6 +49,39 @@ constexpr double kEpsilon = 1e-12;
     }
 }
 
+// The Vm's `%` takes non-negative integers only
+[[nodiscard]] auto to_index(double value) -> std::optional<std::size_t> {
+    if (!std::isfinite(value) || value < 0.0) {
+        return std::nullopt;
+    }
+    const double truncated = std::floor(value + kEpsilon);
+    if (std::abs(truncated - value) > kEpsilon ||
+        truncated > static_cast<double>(std::numeric_limits<std::size_t>::max())) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(truncated);
+}
+
+// Pops a call's arguments (operands: callee, argument count) into `arguments`, first one first
+[[nodiscard]] auto pop_arguments(const Instruction& inst, std::vector<double>& stack, std::vector<double>& arguments)
+    -> bool {
+    if (inst.operands.size() < 2) {
+        return false;
+    }
+    std::size_t count = 0;
+    try {
+        count = static_cast<std::size_t>(std::stoul(inst.operands[1]));
+    } catch (...) {
+        return false;
+    }
+    if (stack.size() < count) {
+        return false;
+    }
+    arguments.assign(stack.end() - static_cast<std::ptrdiff_t>(count), stack.end());
+    stack.resize(stack.size() - count);
+    return true;
+}
+
 [[nodiscard]] auto make_error(std::string message) -> BindingEvalResult {
     BindingEvalResult result;
     result.status = EvalStatus::Error;
@@ -99,8 +132,8 @@ constexpr double kEpsilon = 1e-12;
 
 }  // namespace
 
-auto interpret_binding(const Binding& binding, const std::unordered_map<std::string, double>& environment)
-    -> BindingEvalResult {
+auto interpret_binding(const Binding& binding, const std::unordered_map<std::string, double>& environment,
+                       CallEvaluator* calls) -> BindingEvalResult {
     if (binding.initializer_instructions.empty()) {
         return make_non_constant("no initializer instructions");
     }
@@ -219,14 +252,32 @@ auto interpret_binding(const Binding& binding, const std::unordered_map<std::str
                 stack.pop_back();
                 break;
             }
+            case InstructionKind::Call: {
+                if (calls == nullptr) {
+                    return make_non_constant("non-constant control flow in initializer");
+                }
+                std::vector<double> arguments;
+                if (!pop_arguments(inst, stack, arguments)) {
+                    return make_error("call instruction requires its arguments");
+                }
+                const auto result = calls->call(inst.operands.front(), arguments);
+                if (result.status != EvalStatus::Success || !result.value.has_value()) {
+                    return result.status == EvalStatus::Error ? make_error(result.message)
+                                                              : make_non_constant(result.message);
+                }
+                stack.push_back(*result.value);
+                break;
+            }
             case InstructionKind::Branch:
             case InstructionKind::BranchIf:
             case InstructionKind::Label:
-            case InstructionKind::Call:
             case InstructionKind::MakeArray:
             case InstructionKind::ArrayGet:
             case InstructionKind::ArraySet:
             case InstructionKind::ArrayLength:
+            case InstructionKind::MakeStruct:
+            case InstructionKind::FieldGet:
+            case InstructionKind::FieldSet:
                 return make_non_constant("non-constant control flow in initializer");
             case InstructionKind::Comment:
             case InstructionKind::Return:
@@ -242,7 +293,8 @@ auto interpret_binding(const Binding& binding, const std::unordered_map<std::str
 }
 
 auto interpret_function(const Function& function, const std::unordered_map<std::string, double>& environment,
-                        const std::unordered_map<std::string, double>& parameters) -> FunctionEvalResult {
+                        const std::unordered_map<std::string, double>& parameters, CallEvaluator* calls)
+    -> FunctionEvalResult {
     if (function.blocks.empty()) {
         return make_function_non_constant("function has no basic blocks");
     }
@@ -265,7 +317,10 @@ auto interpret_function(const Function& function, const std::unordered_map<std::
     size_t pc = 0;
     while (pc < all_instructions.size()) {
         const auto& inst = all_instructions[pc];
-        
+        if (calls != nullptr && !calls->spend()) {
+            return make_function_non_constant("evaluation budget exhausted");
+        }
+
         switch (inst.kind) {
             case InstructionKind::Literal: {
                 if (inst.operands.empty()) {
@@ -326,12 +381,14 @@ auto interpret_function(const Function& function, const std::unordered_map<std::
                         }
                         stack.push_back(left / right);
                     } else if (op == "%") {
-                        if (std::abs(right) < kEpsilon) {
-                            return make_function_error("modulo by zero during interpretation");
+                        // As the Vm does it, so calls folded at load time keep their result
+                        const auto leftIndex = to_index(left);
+                        const auto rightIndex = to_index(right);
+                        if (!leftIndex.has_value() || !rightIndex.has_value() || *rightIndex == 0) {
+                            return make_function_error(
+                                "modulo requires non-negative integer operands and non-zero divisor");
                         }
-                        const int leftInt = static_cast<int>(left);
-                        const int rightInt = static_cast<int>(right);
-                        stack.push_back(static_cast<double>(leftInt % rightInt));
+                        stack.push_back(static_cast<double>(*leftIndex % *rightIndex));
                     } else if (op == "==") {
                         stack.push_back((left == right) ? 1.0 : 0.0);
                     } else if (op == "!=") {
@@ -430,12 +487,28 @@ auto interpret_function(const Function& function, const std::unordered_map<std::
                     }
                     break;
                 }
-                case InstructionKind::Call:
-                    return make_function_non_constant("function calls require runtime execution");
+                case InstructionKind::Call: {
+                    if (calls == nullptr) {
+                        return make_function_non_constant("function calls require runtime execution");
+                    }
+                    std::vector<double> arguments;
+                    if (!pop_arguments(inst, stack, arguments)) {
+                        return make_function_error("call instruction requires its arguments");
+                    }
+                    auto result = calls->call(inst.operands.front(), arguments);
+                    if (result.status != EvalStatus::Success || !result.value.has_value()) {
+                        return result;
+                    }
+                    stack.push_back(*result.value);
+                    break;
+                }
                     case InstructionKind::MakeArray:
                     case InstructionKind::ArrayGet:
                     case InstructionKind::ArraySet:
                     case InstructionKind::ArrayLength:
+                    case InstructionKind::MakeStruct:
+                    case InstructionKind::FieldGet:
+                    case InstructionKind::FieldSet:
                         return make_function_non_constant("non-constant instruction encountered");
                 case InstructionKind::Label:
                 case InstructionKind::Comment:
@@ -447,4 +520,59 @@ auto interpret_function(const Function& function, const std::unordered_map<std::
     return make_function_non_constant("no return encountered");
 }
 
+CallEvaluator::CallEvaluator(const Module& module, std::vector<bool> callable,
+                             const std::unordered_map<std::string, double>& environment, std::size_t step_budget)
+    : module_(module), callable_(std::move(callable)), environment_(environment), step_budget_(step_budget) {
+    for (std::size_t i = 0; i < module_.functions.size(); ++i) {
+        functions_.emplace(module_.functions[i].name, i);
+    }
+}
+
+auto CallEvaluator::spend() -> bool {
+    if (steps_left_ == 0) {
+        return false;
+    }
+    --steps_left_;
+    return true;
+}
+
+auto CallEvaluator::call(const std::string& name, const std::vector<double>& arguments) -> FunctionEvalResult {
+    const auto it = functions_.find(name);
+    if (it == functions_.end() || it->second >= callable_.size() || !callable_[it->second]) {
+        return make_function_non_constant("call to '" + name + "' requires runtime execution");
+    }
+    const Function& function = module_.functions[it->second];
+    if (function.parameters.size() != arguments.size()) {
+        return make_function_non_constant("call to '" + name + "' has the wrong number of arguments");
+    }
+
+    std::string key(sizeof(std::size_t) + arguments.size() * sizeof(double), '\0');
+    std::memcpy(key.data(), &it->second, sizeof(std::size_t));
+    if (!arguments.empty()) {
+        std::memcpy(key.data() + sizeof(std::size_t), arguments.data(), arguments.size() * sizeof(double));
+    }
+    if (const auto known = results_.find(key); known != results_.end()) {
+        return make_function_success(known->second);
+    }
+    if (depth_ == kMaxDepth) {
+        return make_function_non_constant("calls nested too deeply to evaluate");
+    }
+
+    if (depth_ == 0) {
+        steps_left_ = step_budget_;
+    }
+    std::unordered_map<std::string, double> parameters;
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        parameters[function.parameters[i].name] = arguments[i];
+    }
+    ++depth_;
+    auto result = interpret_function(function, environment_, parameters, this);
+    --depth_;
+    // Literals cannot spell the others, and failures may depend on bindings not known yet
+    if (result.status == EvalStatus::Success && result.value.has_value() && std::isfinite(*result.value)) {
+        results_.emplace(std::move(key), *result.value);
+    }
+    return result;
+}
+
 }  // namespace impulse::ir
@@ -0,0 +1,168 @@
+#include "impulse/ir/liveness.h"
+
+#include <algorithm>
+
+namespace impulse::ir {
+
+namespace {
+
+// Fixed-width bit set sized once per function; live sets are dense so words beat hash sets here.
+class BitSet {
+public:
+    explicit BitSet(std::size_t size = 0) : words_((size + 63) / 64, 0) {}
+
+    void set(std::size_t bit) { words_[bit / 64] |= (std::uint64_t{1} << (bit % 64)); }
+    [[nodiscard]] auto test(std::size_t bit) const -> bool {
+        return (words_[bit / 64] >> (bit % 64)) & std::uint64_t{1};
+    }
+
+    // this |= other; returns true when any bit changed
+    auto merge(const BitSet& other) -> bool {
+        bool changed = false;
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            const std::uint64_t merged = words_[i] | other.words_[i];
+            changed = changed || merged != words_[i];
+            words_[i] = merged;
+        }
+        return changed;
+    }
+
+    // this |= (other & ~mask); returns true when any bit changed
+    auto merge_difference(const BitSet& other, const BitSet& mask) -> bool {
+        bool changed = false;
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            const std::uint64_t merged = words_[i] | (other.words_[i] & ~mask.words_[i]);
+            changed = changed || merged != words_[i];
+            words_[i] = merged;
+        }
+        return changed;
+    }
+
+    [[nodiscard]] auto to_indices() const -> std::vector<std::size_t> {
+        std::vector<std::size_t> out;
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            std::uint64_t word = words_[i];
+            while (word != 0) {
+                const auto bit = static_cast<std::size_t>(__builtin_ctzll(word));
+                out.push_back(i * 64 + bit);
+                word &= word - 1;
+            }
+        }
+        return out;
+    }
+
+private:
+    std::vector<std::uint64_t> words_;
+};
+
+}  // namespace
+
+auto SsaLiveness::find(const SsaValue& value) const -> std::optional<std::size_t> {
+    const auto it = index.find(encode_ssa_value(value));
+    if (it == index.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+auto SsaLiveness::is_live_out(std::size_t block, const SsaValue& value) const -> bool {
+    const auto id = find(value);
+    if (!id.has_value() || block >= live_out.size()) {
+        return false;
+    }
+    return std::binary_search(live_out[block].begin(), live_out[block].end(), *id);
+}
+
+auto compute_liveness(const SsaFunction& function) -> SsaLiveness {
+    SsaLiveness liveness;
+    const auto number = [&](const SsaValue& value) -> std::size_t {
+        const auto [it, inserted] = liveness.index.emplace(encode_ssa_value(value), liveness.values.size());
+        if (inserted) {
+            liveness.values.push_back(value);
+        }
+        return it->second;
+    };
+
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            number(phi.result);
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    number(*input.value);
+                }
+            }
+        }
+        for (const auto& inst : block.instructions) {
+            for (const auto& arg : inst.arguments) {
+                number(arg);
+            }
+            if (inst.result.has_value()) {
+                number(*inst.result);
+            }
+        }
+    }
+
+    const std::size_t block_count = function.blocks.size();
+    const std::size_t value_count = liveness.values.size();
+
+    // Local use/def summaries: upward-exposed uses and definitions (phi results count as definitions)
+    std::vector<BitSet> uses(block_count, BitSet(value_count));
+    std::vector<BitSet> defs(block_count, BitSet(value_count));
+    // Phi inputs flowing out of each predecessor along its outgoing edges
+    std::vector<BitSet> edge_uses(block_count, BitSet(value_count));
+
+    for (std::size_t b = 0; b < block_count; ++b) {
+        const auto& block = function.blocks[b];
+        for (const auto& phi : block.phi_nodes) {
+            defs[b].set(liveness.index.at(encode_ssa_value(phi.result)));
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value() && input.predecessor < block_count) {
+                    edge_uses[input.predecessor].set(liveness.index.at(encode_ssa_value(*input.value)));
+                }
+            }
+        }
+        for (const auto& inst : block.instructions) {
+            for (const auto& arg : inst.arguments) {
+                const std::size_t id = liveness.index.at(encode_ssa_value(arg));
+                if (!defs[b].test(id)) {
+                    uses[b].set(id);
+                }
+            }
+            if (inst.result.has_value()) {
+                defs[b].set(liveness.index.at(encode_ssa_value(*inst.result)));
+            }
+        }
+    }
+
+    std::vector<BitSet> live_in(block_count, BitSet(value_count));
+    std::vector<BitSet> live_out(block_count, BitSet(value_count));
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::size_t i = block_count; i-- > 0;) {
+            const auto& block = function.blocks[i];
+            BitSet out = edge_uses[i];
+            for (const auto succ : block.successors) {
+                if (succ < block_count) {
+                    out.merge(live_in[succ]);
+                }
+            }
+            changed = live_out[i].merge(out) || changed;
+
+            // live_in = uses | (live_out - defs)
+            changed = live_in[i].merge(uses[i]) || changed;
+            changed = live_in[i].merge_difference(live_out[i], defs[i]) || changed;
+        }
+    }
+
+    liveness.live_in.reserve(block_count);
+    liveness.live_out.reserve(block_count);
+    for (std::size_t b = 0; b < block_count; ++b) {
+        liveness.live_in.push_back(live_in[b].to_indices());
+        liveness.live_out.push_back(live_out[b].to_indices());
+    }
+    return liveness;
+}
+
+}  // namespace impulse::ir
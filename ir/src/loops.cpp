@@ -0,0 +1,218 @@
+#include "impulse/ir/loops.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace impulse::ir {
+
+namespace {
+
+[[nodiscard]] auto dominates(const SsaFunction& function, std::size_t dominator, std::size_t block) -> bool {
+    const std::size_t count = function.blocks.size();
+    while (block < count) {
+        if (block == dominator) {
+            return true;
+        }
+        const std::size_t parent = function.blocks[block].immediate_dominator;
+        if (parent == block) {
+            return false;  // reached the entry
+        }
+        block = parent;
+    }
+    return false;  // unreachable blocks have no dominator
+}
+
+[[nodiscard]] auto preheader_name(const SsaFunction& function, const std::string& header) -> std::string {
+    std::string name = header + ".preheader";
+    for (std::size_t suffix = 1; function.find_block(name) != nullptr; ++suffix) {
+        name = header + ".preheader" + std::to_string(suffix);
+    }
+    return name;
+}
+
+// Places a block that only branches to `header` at the header's position and routes the edge
+// from `from` through it
+void split_loop_entry(SsaFunction& function, std::size_t from, std::size_t header) {
+    const std::size_t at = header;
+    const auto shift = [at](std::size_t& index) {
+        if (index >= at) {
+            ++index;
+        }
+    };
+    for (auto& block : function.blocks) {
+        shift(block.id);
+        std::for_each(block.successors.begin(), block.successors.end(), shift);
+        std::for_each(block.predecessors.begin(), block.predecessors.end(), shift);
+        for (auto& phi : block.phi_nodes) {
+            for (auto& input : phi.inputs) {
+                shift(input.predecessor);
+            }
+        }
+    }
+    shift(from);
+    shift(header);
+
+    SsaBlock preheader;
+    preheader.id = at;
+    preheader.name = preheader_name(function, function.blocks[at].name);
+    SsaInstruction branch;
+    branch.op = SsaOpcode::Branch;
+    branch.opcode = "branch";
+    branch.immediates.push_back(function.blocks[at].name);
+    preheader.instructions.push_back(std::move(branch));
+    preheader.successors.push_back(header);
+    preheader.predecessors.push_back(from);
+
+    auto& source = function.blocks[from];
+    std::replace(source.successors.begin(), source.successors.end(), header, at);
+    if (!source.instructions.empty()) {
+        auto& terminator = source.instructions.back();
+        const bool jumps = terminator.op == SsaOpcode::Branch || terminator.op == SsaOpcode::BranchIf;
+        if (jumps && !terminator.immediates.empty() && terminator.immediates.front() == function.blocks[at].name) {
+            terminator.immediates.front() = preheader.name;
+        }
+    }
+    auto& target = function.blocks[at];
+    std::replace(target.predecessors.begin(), target.predecessors.end(), from, at);
+    for (auto& phi : target.phi_nodes) {
+        for (auto& input : phi.inputs) {
+            if (input.predecessor == from) {
+                input.predecessor = at;
+            }
+        }
+    }
+    function.blocks.insert(function.blocks.begin() + static_cast<std::ptrdiff_t>(at), std::move(preheader));
+}
+
+}  // namespace
+
+auto Loop::contains(std::size_t block) const -> bool {
+    return std::binary_search(blocks.begin(), blocks.end(), block);
+}
+
+auto LoopNest::loop_of(std::size_t block) const -> const Loop* {
+    if (block >= innermost.size() || !innermost[block].has_value()) {
+        return nullptr;
+    }
+    return &loops[*innermost[block]];
+}
+
+auto find_loops(const SsaFunction& function) -> LoopNest {
+    const std::size_t count = function.blocks.size();
+    LoopNest nest;
+    nest.innermost.assign(count, std::nullopt);
+
+    std::vector<std::vector<std::size_t>> latches(count);
+    for (std::size_t b = 0; b < count; ++b) {
+        for (const auto successor : function.blocks[b].successors) {
+            if (successor < count && dominates(function, successor, b)) {
+                latches[successor].push_back(b);
+            }
+        }
+    }
+
+    std::vector<bool> inside(count, false);
+    for (std::size_t header = 0; header < count; ++header) {
+        if (latches[header].empty()) {
+            continue;
+        }
+        Loop loop;
+        loop.header = header;
+        loop.latches = latches[header];
+        std::sort(loop.latches.begin(), loop.latches.end());
+        loop.latches.erase(std::unique(loop.latches.begin(), loop.latches.end()), loop.latches.end());
+
+        std::fill(inside.begin(), inside.end(), false);
+        inside[header] = true;
+        std::vector<std::size_t> work = loop.latches;
+        while (!work.empty()) {
+            const std::size_t block = work.back();
+            work.pop_back();
+            if (block >= count || inside[block] || !dominates(function, header, block)) {
+                continue;
+            }
+            inside[block] = true;
+            const auto& predecessors = function.blocks[block].predecessors;
+            work.insert(work.end(), predecessors.begin(), predecessors.end());
+        }
+        for (std::size_t b = 0; b < count; ++b) {
+            if (inside[b]) {
+                loop.blocks.push_back(b);
+            }
+        }
+
+        std::optional<std::size_t> outside;
+        bool single = true;
+        for (const auto predecessor : function.blocks[header].predecessors) {
+            if (predecessor >= count || inside[predecessor]) {
+                continue;
+            }
+            if (outside.has_value() && *outside != predecessor) {
+                single = false;
+            }
+            outside = predecessor;
+        }
+        if (single && outside.has_value() && function.blocks[*outside].successors.size() == 1) {
+            loop.preheader = outside;
+        }
+        nest.loops.push_back(std::move(loop));
+    }
+
+    // A loop nested in another has strictly fewer blocks, so sorting by size puts inner loops first
+    // and makes the first larger loop containing a header its parent
+    std::stable_sort(nest.loops.begin(), nest.loops.end(),
+                     [](const Loop& left, const Loop& right) { return left.blocks.size() < right.blocks.size(); });
+    for (std::size_t i = 0; i < nest.loops.size(); ++i) {
+        for (std::size_t j = i + 1; j < nest.loops.size(); ++j) {
+            if (nest.loops[j].contains(nest.loops[i].header)) {
+                nest.loops[i].parent = j;
+                break;
+            }
+        }
+    }
+    for (std::size_t i = nest.loops.size(); i-- > 0;) {
+        auto& loop = nest.loops[i];
+        loop.depth = loop.parent.has_value() ? nest.loops[*loop.parent].depth + 1 : 1;
+        for (const auto block : loop.blocks) {
+            nest.innermost[block] = i;  // visited outermost first, so the last write is the innermost
+        }
+    }
+    return nest;
+}
+
+auto insert_preheaders(SsaFunction& function) -> std::size_t {
+    std::size_t inserted = 0;
+    for (;;) {
+        std::optional<std::pair<std::size_t, std::size_t>> entry;
+        const LoopNest nest = find_loops(function);
+        for (const auto& loop : nest.loops) {
+            if (loop.preheader.has_value() || loop.header == 0) {
+                continue;
+            }
+            const auto& predecessors = function.blocks[loop.header].predecessors;
+            std::vector<std::size_t> outside;
+            for (const auto predecessor : predecessors) {
+                if (!loop.contains(predecessor)) {
+                    outside.push_back(predecessor);
+                }
+            }
+            if (outside.size() != 1) {
+                continue;  // several entries would need their phi inputs merged first
+            }
+            const auto& successors = function.blocks[outside.front()].successors;
+            if (std::count(successors.begin(), successors.end(), loop.header) == 1) {
+                entry = std::make_pair(outside.front(), loop.header);
+                break;
+            }
+        }
+        if (!entry.has_value()) {
+            return inserted;
+        }
+        split_loop_entry(function, entry->first, entry->second);
+        compute_dominators(function);
+        ++inserted;
+    }
+}
+
+}  // namespace impulse::ir
@@ -0,0 +1,20 @@
+#include "number_format.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace impulse::ir {
+
+auto format_number(double value) -> std::string {
+    char buffer[32];
+    for (int precision = 15; precision <= 17; ++precision) {
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (std::strtod(buffer, nullptr) == value) {
+            break;
+        }
+    }
+    return buffer;
+}
+
+}  // namespace impulse::ir
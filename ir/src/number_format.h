@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace impulse::ir {
+
+// Shortest text that parses back to exactly `value`, for the literals the optimizer and the
+// purity analysis fold into instructions. Internal to impulse-ir.
+[[nodiscard]] auto format_number(double value) -> std::string;
+
+}  // namespace impulse::ir
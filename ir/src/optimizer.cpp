@@ -1,10 +1,1670 @@
 #include "impulse/ir/optimizer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "impulse/ir/loops.h"
+#include "impulse/ir/value_facts.h"
+#include "number_format.h"
+
 namespace impulse::ir {
 
-auto optimize_ssa(SsaFunction& /*function*/) -> bool {
-    // Optimizations removed - JIT handles performance
-    return false;
+namespace {
+
+constexpr int kMaxRounds = 8;
+constexpr double kMaxExactInteger = 9007199254740992.0;  // 2^53
+
+using ValueKey = std::uint64_t;
+
+[[nodiscard]] auto value_key(const SsaValue& value) -> ValueKey {
+    return (static_cast<ValueKey>(value.symbol) << 32) | value.version;
+}
+
+[[nodiscard]] auto same_value(const SsaValue& left, const SsaValue& right) -> bool {
+    return left.symbol == right.symbol && left.version == right.version;
+}
+
+[[nodiscard]] auto to_index(double value) -> std::optional<std::size_t> {
+    if (!std::isfinite(value) || value < 0.0) {
+        return std::nullopt;
+    }
+    const double truncated = std::floor(value + kEpsilon);
+    if (std::abs(truncated - value) > kEpsilon ||
+        truncated > static_cast<double>(std::numeric_limits<std::size_t>::max())) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(truncated);
+}
+
+// The interpreter's result for numeric operands, or nullopt where it would raise an error
+[[nodiscard]] auto fold_binary(BinaryOp op, double left, double right) -> std::optional<double> {
+    double result = 0.0;
+    switch (op) {
+        case BinaryOp::Add: result = left + right; break;
+        case BinaryOp::Sub: result = left - right; break;
+        case BinaryOp::Mul: result = left * right; break;
+        case BinaryOp::Div:
+            if (std::abs(right) < kEpsilon) {
+                return std::nullopt;
+            }
+            result = left / right;
+            break;
+        case BinaryOp::Mod: {
+            const auto left_index = to_index(left);
+            const auto right_index = to_index(right);
+            if (!left_index.has_value() || !right_index.has_value() || *right_index == 0) {
+                return std::nullopt;
+            }
+            result = static_cast<double>(*left_index % *right_index);
+            break;
+        }
+        case BinaryOp::Lt: result = left < right ? 1.0 : 0.0; break;
+        case BinaryOp::Le: result = left <= right ? 1.0 : 0.0; break;
+        case BinaryOp::Gt: result = left > right ? 1.0 : 0.0; break;
+        case BinaryOp::Ge: result = left >= right ? 1.0 : 0.0; break;
+        case BinaryOp::Eq: result = left == right ? 1.0 : 0.0; break;
+        case BinaryOp::Ne: result = left != right ? 1.0 : 0.0; break;
+        case BinaryOp::And: result = (left != 0.0 && right != 0.0) ? 1.0 : 0.0; break;
+        case BinaryOp::Or: result = (left != 0.0 || right != 0.0) ? 1.0 : 0.0; break;
+        case BinaryOp::Unknown: return std::nullopt;
+    }
+    if (!std::isfinite(result)) {
+        return std::nullopt;  // literals cannot spell it
+    }
+    return result;
+}
+
+[[nodiscard]] auto fold_unary(UnaryOp op, double operand) -> std::optional<double> {
+    switch (op) {
+        case UnaryOp::Neg: return -operand;
+        case UnaryOp::Not: return operand == 0.0 ? 1.0 : 0.0;
+        case UnaryOp::Unknown: return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] auto make_literal(const SsaValue& result, double value) -> SsaInstruction {
+    SsaInstruction inst;
+    inst.op = SsaOpcode::Literal;
+    inst.opcode = "literal";
+    inst.immediates.push_back(format_number(value));
+    inst.number = value;
+    inst.result = result;
+    return inst;
+}
+
+// A fresh "%tN" symbol; its single definition is version 1. The caller reindexes the symbols.
+[[nodiscard]] auto new_temporary(SsaFunction& function) -> SsaValue {
+    SymbolId id = 0;
+    std::size_t counter = 0;
+    for (const auto& symbol : function.symbols) {
+        id = std::max(id, symbol.id);
+        if (symbol.name.size() > 2 && symbol.name.compare(0, 2, "%t") == 0) {
+            const auto number = std::strtoull(symbol.name.c_str() + 2, nullptr, 10);
+            counter = std::max(counter, static_cast<std::size_t>(number) + 1);
+        }
+    }
+    function.symbols.push_back(SsaSymbol{id + 1, "%t" + std::to_string(counter), {}});
+    return SsaValue{id + 1, 1};
+}
+
+[[nodiscard]] auto make_assign(const SsaValue& result, const SsaValue& source) -> SsaInstruction {
+    SsaInstruction inst;
+    inst.op = SsaOpcode::Assign;
+    inst.opcode = "assign";
+    inst.arguments.push_back(source);
+    inst.result = result;
+    return inst;
+}
+
+[[nodiscard]] auto block_index(const SsaFunction& function, const std::string& name) -> std::optional<std::size_t> {
+    const SsaBlock* block = function.find_block(name);
+    if (block == nullptr) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(block - function.blocks.data());
+}
+
+// Where a branch_if on `condition` goes, as the bytecode resolves it; nullopt when the
+// instruction is malformed and must be left for the runtime to report
+[[nodiscard]] auto branch_destination(const SsaFunction& function, const SsaBlock& block, const SsaInstruction& inst,
+                                      double condition) -> std::optional<std::size_t> {
+    if (inst.immediates.empty()) {
+        return std::nullopt;
+    }
+    const auto target = block_index(function, inst.immediates.front());
+    if (!target.has_value()) {
+        return std::nullopt;
+    }
+    if (inst.immediates.size() >= 2 && !inst.number.has_value()) {
+        return std::nullopt;
+    }
+    const double compare = inst.number.value_or(0.0);
+    if (std::abs(condition - compare) < kEpsilon) {
+        return target;
+    }
+    for (const auto successor : block.successors) {
+        if (successor != *target) {
+            return successor;
+        }
+    }
+    return std::nullopt;
+}
+
+// Variables read by name (version 0) see the locals map, which the interpreter mirrors every
+// version-0/1 store of a named symbol into. Those definitions are observable and must stay.
+class NamedReads {
+public:
+    explicit NamedReads(const SsaFunction& function) {
+        const auto note = [&](const SsaValue& value) {
+            if (value.version == 0) {
+                symbols_.insert(value.symbol);
+            }
+        };
+        for (const auto& block : function.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                for (const auto& input : phi.inputs) {
+                    if (input.value.has_value()) {
+                        note(*input.value);
+                    }
+                }
+            }
+            for (const auto& inst : block.instructions) {
+                for (const auto& argument : inst.arguments) {
+                    note(argument);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] auto observable(const SsaValue& value) const -> bool {
+        return value.version <= 1 && symbols_.count(value.symbol) != 0;
+    }
+
+private:
+    std::unordered_set<SymbolId> symbols_;
+};
+
+[[nodiscard]] auto phi_results(const SsaBlock& block) -> std::unordered_set<ValueKey> {
+    std::unordered_set<ValueKey> results;
+    for (const auto& phi : block.phi_nodes) {
+        results.insert(value_key(phi.result));
+    }
+    return results;
+}
+
+// Maps values to the values replacing them; lookups follow chains to the final value
+class Replacements {
+public:
+    void add(const SsaValue& from, const SsaValue& to) { map_[value_key(from)] = to; }
+
+    [[nodiscard]] auto resolve(SsaValue value) const -> SsaValue {
+        for (auto it = map_.find(value_key(value)); it != map_.end(); it = map_.find(value_key(value))) {
+            value = it->second;
+        }
+        return value;
+    }
+
+    // The interpreter assigns a block's phis one after another, so an input naming another phi
+    // of the same block would see its new value. Such chains stop at the copy in front of it.
+    [[nodiscard]] auto resolve_phi_input(SsaValue value, const std::unordered_set<ValueKey>& block_phis) const
+        -> SsaValue {
+        for (auto it = map_.find(value_key(value)); it != map_.end(); it = map_.find(value_key(value))) {
+            if (block_phis.count(value_key(it->second)) != 0) {
+                break;
+            }
+            value = it->second;
+        }
+        return value;
+    }
+
+    // Rewrites every use in `function`; returns how many uses changed
+    auto apply(SsaFunction& function) const -> std::size_t {
+        if (map_.empty()) {
+            return 0;
+        }
+        std::size_t rewritten = 0;
+        const auto rewrite = [&](SsaValue& value) {
+            const SsaValue replacement = resolve(value);
+            if (!same_value(replacement, value)) {
+                value = replacement;
+                ++rewritten;
+            }
+        };
+        for (auto& block : function.blocks) {
+            const auto block_phis = phi_results(block);
+            for (auto& phi : block.phi_nodes) {
+                for (auto& input : phi.inputs) {
+                    if (!input.value.has_value()) {
+                        continue;
+                    }
+                    const SsaValue replacement = resolve_phi_input(*input.value, block_phis);
+                    if (!same_value(replacement, *input.value)) {
+                        input.value = replacement;
+                        ++rewritten;
+                    }
+                }
+            }
+            for (auto& inst : block.instructions) {
+                for (auto& argument : inst.arguments) {
+                    rewrite(argument);
+                }
+            }
+        }
+        return rewritten;
+    }
+
+private:
+    std::unordered_map<ValueKey, SsaValue> map_;
+};
+
+struct PassStats {
+    std::size_t first = 0;
+    std::size_t second = 0;
+    std::size_t third = 0;
+
+    [[nodiscard]] auto changed() const -> bool { return first != 0 || second != 0 || third != 0; }
+    void add(const PassStats& other) {
+        first += other.first;
+        second += other.second;
+        third += other.third;
+    }
+};
+
+// Sparse conditional constant propagation (Wegman & Zadeck). Values start unknown and only move
+// down to a constant and then to varying; blocks are only visited once an edge into them is
+// known to execute. Stats: values folded, branches resolved, blocks removed.
+class ConstantPropagation {
+public:
+    explicit ConstantPropagation(SsaFunction& function) : function_(function) {}
+
+    auto run() -> PassStats {
+        if (function_.blocks.empty()) {
+            return {};
+        }
+        index_definitions();
+        executable_.assign(function_.blocks.size(), false);
+        executable_[0] = true;
+        visit_block(0);
+        while (!flow_work_.empty() || !value_work_.empty()) {
+            while (!flow_work_.empty()) {
+                const auto [from, to] = flow_work_.back();
+                flow_work_.pop_back();
+                if (!edges_.insert(edge_key(from, to)).second) {
+                    continue;
+                }
+                if (!executable_[to]) {
+                    executable_[to] = true;
+                    visit_block(to);
+                } else {
+                    for (std::size_t i = 0; i < function_.blocks[to].phi_nodes.size(); ++i) {
+                        visit_phi(to, i);
+                    }
+                }
+            }
+            while (!value_work_.empty()) {
+                const ValueKey key = value_work_.back();
+                value_work_.pop_back();
+                const auto users = users_.find(key);
+                if (users == users_.end()) {
+                    continue;
+                }
+                for (const auto& use : users->second) {
+                    if (!executable_[use.block]) {
+                        continue;
+                    }
+                    if (use.phi) {
+                        visit_phi(use.block, use.index);
+                    } else {
+                        visit_instruction(use.block, use.index);
+                    }
+                }
+            }
+        }
+        return rewrite();
+    }
+
+private:
+    enum class Kind : std::uint8_t { Unknown, Constant, Varying };
+
+    struct Lattice {
+        Kind kind = Kind::Unknown;
+        double value = 0.0;
+    };
+
+    struct Use {
+        std::size_t block = 0;
+        bool phi = false;
+        std::size_t index = 0;
+    };
+
+    [[nodiscard]] static auto edge_key(std::size_t from, std::size_t to) -> std::uint64_t {
+        return (static_cast<std::uint64_t>(from) << 32) | static_cast<std::uint64_t>(to);
+    }
+
+    [[nodiscard]] static auto varying() -> Lattice { return Lattice{Kind::Varying, 0.0}; }
+    [[nodiscard]] static auto constant(double value) -> Lattice { return Lattice{Kind::Constant, value}; }
+
+    [[nodiscard]] static auto meet(const Lattice& left, const Lattice& right) -> Lattice {
+        if (left.kind == Kind::Unknown) {
+            return right;
+        }
+        if (right.kind == Kind::Unknown) {
+            return left;
+        }
+        if (left.kind == Kind::Constant && right.kind == Kind::Constant && left.value == right.value &&
+            std::signbit(left.value) == std::signbit(right.value)) {
+            return left;
+        }
+        return varying();
+    }
+
+    void index_definitions() {
+        for (std::size_t b = 0; b < function_.blocks.size(); ++b) {
+            const auto& block = function_.blocks[b];
+            for (std::size_t i = 0; i < block.phi_nodes.size(); ++i) {
+                const auto& phi = block.phi_nodes[i];
+                defined_.insert(value_key(phi.result));
+                for (const auto& input : phi.inputs) {
+                    if (input.value.has_value()) {
+                        users_[value_key(*input.value)].push_back(Use{b, true, i});
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < block.instructions.size(); ++i) {
+                const auto& inst = block.instructions[i];
+                if (inst.result.has_value()) {
+                    defined_.insert(value_key(*inst.result));
+                }
+                for (const auto& argument : inst.arguments) {
+                    users_[value_key(argument)].push_back(Use{b, false, i});
+                }
+            }
+        }
+    }
+
+    // Reads by name and parameters are defined outside the function
+    [[nodiscard]] auto lattice(const SsaValue& value) const -> Lattice {
+        const ValueKey key = value_key(value);
+        if (value.version == 0 || defined_.count(key) == 0) {
+            return varying();
+        }
+        const auto it = values_.find(key);
+        return it == values_.end() ? Lattice{} : it->second;
+    }
+
+    void update(const SsaValue& value, Lattice next) {
+        const ValueKey key = value_key(value);
+        Lattice& current = values_[key];
+        next = meet(current, next);
+        if (next.kind == current.kind && (next.kind != Kind::Constant || next.value == current.value)) {
+            return;
+        }
+        current = next;
+        value_work_.push_back(key);
+    }
+
+    void visit_block(std::size_t b) {
+        const auto& block = function_.blocks[b];
+        for (std::size_t i = 0; i < block.phi_nodes.size(); ++i) {
+            visit_phi(b, i);
+        }
+        for (std::size_t i = 0; i < block.instructions.size(); ++i) {
+            visit_instruction(b, i);
+        }
+        if (block.instructions.empty() || block.instructions.back().op != SsaOpcode::BranchIf) {
+            for (const auto successor : block.successors) {
+                flow_work_.emplace_back(b, successor);
+            }
+        }
+    }
+
+    void visit_phi(std::size_t b, std::size_t index) {
+        const auto& phi = function_.blocks[b].phi_nodes[index];
+        if (b == 0) {
+            update(phi.result, varying());  // entered without an edge, inputs are picked at run time
+            return;
+        }
+        Lattice result;
+        for (const auto& input : phi.inputs) {
+            if (edges_.count(edge_key(input.predecessor, b)) == 0) {
+                continue;
+            }
+            result = meet(result, input.value.has_value() ? lattice(*input.value) : varying());
+        }
+        update(phi.result, result);
+    }
+
+    void visit_instruction(std::size_t b, std::size_t index) {
+        const auto& block = function_.blocks[b];
+        const auto& inst = block.instructions[index];
+        if (inst.op == SsaOpcode::BranchIf) {
+            visit_branch(b, inst);
+            return;
+        }
+        if (!inst.result.has_value()) {
+            return;
+        }
+        update(*inst.result, evaluate(inst));
+    }
+
+    [[nodiscard]] auto evaluate(const SsaInstruction& inst) const -> Lattice {
+        switch (inst.op) {
+            case SsaOpcode::Literal: {
+                return inst.number.has_value() ? constant(*inst.number) : varying();
+            }
+            case SsaOpcode::Assign:
+                return inst.arguments.size() == 1 ? lattice(inst.arguments[0]) : varying();
+            case SsaOpcode::Unary: {
+                if (inst.arguments.size() != 1) {
+                    return varying();
+                }
+                const Lattice operand = lattice(inst.arguments[0]);
+                if (operand.kind != Kind::Constant) {
+                    return operand;
+                }
+                const auto value = fold_unary(inst.unary_op, operand.value);
+                return value.has_value() ? constant(*value) : varying();
+            }
+            case SsaOpcode::Binary: {
+                if (inst.arguments.size() != 2) {
+                    return varying();
+                }
+                const Lattice left = lattice(inst.arguments[0]);
+                const Lattice right = lattice(inst.arguments[1]);
+                if (left.kind == Kind::Varying || right.kind == Kind::Varying) {
+                    return varying();
+                }
+                if (left.kind == Kind::Unknown || right.kind == Kind::Unknown) {
+                    return {};
+                }
+                const auto value = fold_binary(inst.binary_op, left.value, right.value);
+                return value.has_value() ? constant(*value) : varying();
+            }
+            default:
+                return varying();
+        }
+    }
+
+    // An unknown condition is treated as varying: every successor stays reachable
+    void visit_branch(std::size_t b, const SsaInstruction& inst) {
+        const auto& block = function_.blocks[b];
+        if (!inst.arguments.empty()) {
+            const Lattice condition = lattice(inst.arguments[0]);
+            if (condition.kind == Kind::Constant) {
+                if (const auto destination = branch_destination(function_, block, inst, condition.value)) {
+                    flow_work_.emplace_back(b, *destination);
+                    return;
+                }
+            }
+        }
+        for (const auto successor : block.successors) {
+            flow_work_.emplace_back(b, successor);
+        }
+    }
+
+    [[nodiscard]] auto constant_value(const SsaValue& value) const -> std::optional<double> {
+        const Lattice state = lattice(value);
+        if (state.kind != Kind::Constant) {
+            return std::nullopt;
+        }
+        return state.value;
+    }
+
+    auto rewrite() -> PassStats {
+        PassStats stats;
+        for (std::size_t b = 0; b < function_.blocks.size(); ++b) {
+            if (!executable_[b]) {
+                continue;
+            }
+            auto& block = function_.blocks[b];
+
+            // Constant phis become literals at the top of the block
+            std::vector<SsaInstruction> hoisted;
+            std::vector<PhiNode> phis;
+            for (auto& phi : block.phi_nodes) {
+                if (const auto value = constant_value(phi.result)) {
+                    hoisted.push_back(make_literal(phi.result, *value));
+                    ++stats.first;
+                } else {
+                    phis.push_back(std::move(phi));
+                }
+            }
+            block.phi_nodes = std::move(phis);
+
+            for (auto& inst : block.instructions) {
+                if (inst.op == SsaOpcode::BranchIf && !inst.arguments.empty()) {
+                    const auto condition = constant_value(inst.arguments[0]);
+                    const auto destination = condition.has_value()
+                                                 ? branch_destination(function_, block, inst, *condition)
+                                                 : std::nullopt;
+                    if (destination.has_value()) {
+                        SsaInstruction branch;
+                        branch.op = SsaOpcode::Branch;
+                        branch.opcode = "branch";
+                        branch.immediates.push_back(function_.blocks[*destination].name);
+                        inst = std::move(branch);
+                        ++stats.second;
+                    }
+                    continue;
+                }
+                const bool foldable =
+                    inst.op == SsaOpcode::Assign || inst.op == SsaOpcode::Unary || inst.op == SsaOpcode::Binary;
+                if (!foldable || !inst.result.has_value()) {
+                    continue;
+                }
+                if (const auto value = constant_value(*inst.result)) {
+                    inst = make_literal(*inst.result, *value);
+                    ++stats.first;
+                }
+            }
+            if (!hoisted.empty()) {
+                block.instructions.insert(block.instructions.begin(), std::make_move_iterator(hoisted.begin()),
+                                          std::make_move_iterator(hoisted.end()));
+            }
+        }
+        stats.third = remove_dead_edges();
+        return stats;
+    }
+
+    // Drops edges that never execute and the blocks only they reached, then renumbers the rest
+    auto remove_dead_edges() -> std::size_t {
+        const std::size_t count = function_.blocks.size();
+        bool edges_removed = false;
+        for (std::size_t b = 0; b < count && !edges_removed; ++b) {
+            if (!executable_[b]) {
+                edges_removed = true;
+                break;
+            }
+            for (const auto successor : function_.blocks[b].successors) {
+                if (edges_.count(edge_key(b, successor)) == 0) {
+                    edges_removed = true;
+                }
+            }
+        }
+        if (!edges_removed) {
+            return 0;
+        }
+
+        constexpr std::size_t kRemoved = std::numeric_limits<std::size_t>::max();
+        std::vector<std::size_t> renumbered(count, kRemoved);
+        std::size_t next = 0;
+        for (std::size_t b = 0; b < count; ++b) {
+            if (executable_[b]) {
+                renumbered[b] = next++;
+            }
+        }
+
+        std::vector<SsaBlock> kept;
+        kept.reserve(next);
+        for (std::size_t b = 0; b < count; ++b) {
+            if (!executable_[b]) {
+                continue;
+            }
+            SsaBlock block = std::move(function_.blocks[b]);
+            block.id = renumbered[b];
+            std::vector<std::size_t> successors;
+            for (const auto successor : block.successors) {
+                if (edges_.count(edge_key(b, successor)) != 0) {
+                    successors.push_back(renumbered[successor]);
+                }
+            }
+            block.successors = std::move(successors);
+            std::vector<std::size_t> predecessors;
+            for (const auto predecessor : block.predecessors) {
+                if (edges_.count(edge_key(predecessor, b)) != 0) {
+                    predecessors.push_back(renumbered[predecessor]);
+                }
+            }
+            block.predecessors = std::move(predecessors);
+            for (auto& phi : block.phi_nodes) {
+                std::vector<PhiInput> inputs;
+                for (auto& input : phi.inputs) {
+                    if (edges_.count(edge_key(input.predecessor, b)) != 0) {
+                        input.predecessor = renumbered[input.predecessor];
+                        inputs.push_back(std::move(input));
+                    }
+                }
+                phi.inputs = std::move(inputs);
+            }
+            kept.push_back(std::move(block));
+        }
+        function_.blocks = std::move(kept);
+        compute_dominators(function_);
+        return count - next;
+    }
+
+    SsaFunction& function_;
+    std::vector<bool> executable_;
+    std::unordered_set<std::uint64_t> edges_;
+    std::unordered_set<ValueKey> defined_;
+    std::unordered_map<ValueKey, Lattice> values_;
+    std::unordered_map<ValueKey, std::vector<Use>> users_;
+    std::vector<std::pair<std::size_t, std::size_t>> flow_work_;
+    std::vector<ValueKey> value_work_;
+};
+
+// Forwards the source of every assign to its uses and replaces phis whose inputs all agree.
+// Reads by name are never forwarded: they see the variable as of the moment they run.
+// Stats: uses forwarded, phis removed.
+auto propagate_copies(SsaFunction& function) -> PassStats {
+    const NamedReads named(function);
+    Replacements replacements;
+    PassStats stats;
+
+    for (auto& block : function.blocks) {
+        std::vector<PhiNode> phis;
+        for (auto& phi : block.phi_nodes) {
+            std::optional<SsaValue> only;
+            bool trivial = true;
+            for (const auto& input : phi.inputs) {
+                if (!input.value.has_value()) {
+                    trivial = false;  // undefined inputs fall back to another edge at run time
+                    break;
+                }
+                const SsaValue value = replacements.resolve(*input.value);
+                if (same_value(value, phi.result)) {
+                    continue;
+                }
+                if (only.has_value() && !same_value(*only, value)) {
+                    trivial = false;
+                    break;
+                }
+                only = value;
+            }
+            if (trivial && only.has_value() && only->version != 0) {
+                replacements.add(phi.result, *only);
+                if (!named.observable(phi.result)) {
+                    ++stats.second;
+                    continue;
+                }
+            }
+            phis.push_back(std::move(phi));
+        }
+        block.phi_nodes = std::move(phis);
+
+        for (const auto& inst : block.instructions) {
+            if (inst.op != SsaOpcode::Assign || !inst.result.has_value() || inst.arguments.size() != 1 ||
+                inst.arguments[0].version == 0) {
+                continue;
+            }
+            const SsaValue source = replacements.resolve(inst.arguments[0]);
+            if (!same_value(source, *inst.result)) {
+                replacements.add(*inst.result, source);
+            }
+        }
+    }
+    stats.first = replacements.apply(function);
+    return stats;
+}
+
+// Dominator-tree value numbering: a pure computation repeated in a block dominated by its first
+// occurrence reuses that result. A repeated computation that faults would have faulted at the
+// first one already, so divisions and string operations can be shared too. Stats: values removed.
+class ValueNumbering {
+public:
+    explicit ValueNumbering(SsaFunction& function) : function_(function), named_(function) {}
+
+    auto run() -> PassStats {
+        PassStats stats;
+        if (function_.blocks.empty()) {
+            return stats;
+        }
+        // Iterative preorder walk; a negative entry closes the scope of block ~entry
+        std::vector<std::ptrdiff_t> work{0};
+        std::vector<std::vector<std::string>> scopes(function_.blocks.size());
+        while (!work.empty()) {
+            const std::ptrdiff_t entry = work.back();
+            work.pop_back();
+            if (entry < 0) {
+                for (const auto& key : scopes[static_cast<std::size_t>(~entry)]) {
+                    table_.erase(key);
+                }
+                continue;
+            }
+            const auto b = static_cast<std::size_t>(entry);
+            stats.first += number_block(b, scopes[b]);
+            work.push_back(~entry);
+            const auto& children = function_.blocks[b].dominator_children;
+            for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                if (*it < function_.blocks.size()) {
+                    work.push_back(static_cast<std::ptrdiff_t>(*it));
+                }
+            }
+        }
+        replacements_.apply(function_);
+        return stats;
+    }
+
+private:
+    [[nodiscard]] static auto commutative(BinaryOp op) -> bool {
+        // Not Add: concatenating strings depends on the order
+        return op == BinaryOp::Mul || op == BinaryOp::Eq || op == BinaryOp::Ne || op == BinaryOp::And ||
+               op == BinaryOp::Or;
+    }
+
+    [[nodiscard]] static auto key_of(const SsaInstruction& inst) -> std::optional<std::string> {
+        for (const auto& argument : inst.arguments) {
+            if (argument.version == 0) {
+                return std::nullopt;
+            }
+        }
+        std::string key;
+        switch (inst.op) {
+            case SsaOpcode::Literal: {
+                if (!inst.number.has_value()) {
+                    return std::nullopt;
+                }
+                key = "n" + format_number(*inst.number);
+                return key;
+            }
+            case SsaOpcode::LiteralString:
+                if (inst.immediates.empty()) {
+                    return std::nullopt;
+                }
+                return "s" + inst.immediates.front();
+            case SsaOpcode::Unary:
+                if (inst.arguments.size() != 1 || inst.immediates.empty()) {
+                    return std::nullopt;
+                }
+                return "u" + inst.immediates.front() + " " + inst.arguments[0].to_string();
+            case SsaOpcode::Binary: {
+                if (inst.arguments.size() != 2 || inst.binary_op == BinaryOp::Unknown) {
+                    return std::nullopt;
+                }
+                std::string left = inst.arguments[0].to_string();
+                std::string right = inst.arguments[1].to_string();
+                if (commutative(inst.binary_op) && right < left) {
+                    std::swap(left, right);
+                }
+                key = "b" + std::to_string(static_cast<int>(inst.binary_op)) + " " + left + " " + right;
+                return key;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+
+    [[nodiscard]] static auto key_of(const PhiNode& phi, std::size_t block) -> std::string {
+        std::string key = "p" + std::to_string(block);
+        for (const auto& input : phi.inputs) {
+            key += " " + std::to_string(input.predecessor) + ":" +
+                   (input.value.has_value() ? input.value->to_string() : std::string{"-"});
+        }
+        return key;
+    }
+
+    // Looks `key` up in the enclosing scopes; records `value` under it when it is new
+    [[nodiscard]] auto find_or_insert(std::string key, const SsaValue& value, std::vector<std::string>& scope)
+        -> std::optional<SsaValue> {
+        const auto [it, inserted] = table_.emplace(key, value);
+        if (!inserted) {
+            return it->second;
+        }
+        scope.push_back(std::move(key));
+        return std::nullopt;
+    }
+
+    auto number_block(std::size_t b, std::vector<std::string>& scope) -> std::size_t {
+        auto& block = function_.blocks[b];
+        std::size_t removed = 0;
+
+        const auto block_phis = phi_results(block);
+        std::vector<PhiNode> phis;
+        for (auto& phi : block.phi_nodes) {
+            for (auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    input.value = replacements_.resolve_phi_input(*input.value, block_phis);
+                }
+            }
+            if (!named_.observable(phi.result)) {
+                if (const auto existing = find_or_insert(key_of(phi, b), phi.result, scope)) {
+                    replacements_.add(phi.result, *existing);
+                    ++removed;
+                    continue;
+                }
+            }
+            phis.push_back(std::move(phi));
+        }
+        block.phi_nodes = std::move(phis);
+
+        std::vector<SsaInstruction> kept;
+        kept.reserve(block.instructions.size());
+        for (auto& inst : block.instructions) {
+            for (auto& argument : inst.arguments) {
+                argument = replacements_.resolve(argument);
+            }
+            if (inst.result.has_value() && !named_.observable(*inst.result)) {
+                if (auto key = key_of(inst)) {
+                    if (const auto existing = find_or_insert(std::move(*key), *inst.result, scope)) {
+                        replacements_.add(*inst.result, *existing);
+                        ++removed;
+                        continue;
+                    }
+                }
+            }
+            kept.push_back(std::move(inst));
+        }
+        block.instructions = std::move(kept);
+        return removed;
+    }
+
+    SsaFunction& function_;
+    NamedReads named_;
+    Replacements replacements_;
+    std::unordered_map<std::string, SsaValue> table_;
+};
+
+// Whether evaluating `inst` can neither raise an error nor touch anything but its result:
+// arithmetic only counts when its operands are known to be numbers and any divisor a non-zero constant
+[[nodiscard]] auto pure_and_safe(const SsaInstruction& inst, const ValueFacts& facts) -> bool {
+    switch (inst.op) {
+        case SsaOpcode::Literal:
+            return inst.number.has_value();
+        case SsaOpcode::LiteralString:
+            return true;
+        case SsaOpcode::Unary:
+            return inst.arguments.size() == 1 && facts.numeric(inst.arguments[0]) &&
+                   inst.unary_op != UnaryOp::Unknown;
+        case SsaOpcode::Binary:
+            if (inst.arguments.size() != 2 || !facts.numeric(inst.arguments[0]) || !facts.numeric(inst.arguments[1])) {
+                return false;
+            }
+            if (inst.binary_op == BinaryOp::Div) {
+                return facts.safe_divisor(inst.arguments[1]);
+            }
+            return inst.binary_op != BinaryOp::Mod && inst.binary_op != BinaryOp::Unknown;
+        default:
+            return false;
+    }
+}
+
+// Where instructions appended to `block` go: in front of its terminator, if it has one
+[[nodiscard]] auto insertion_point(SsaBlock& block) -> std::vector<SsaInstruction>::iterator {
+    if (!block.instructions.empty()) {
+        const SsaOpcode last = block.instructions.back().op;
+        if (last == SsaOpcode::Branch || last == SsaOpcode::BranchIf || last == SsaOpcode::Return) {
+            return block.instructions.end() - 1;
+        }
+    }
+    return block.instructions.end();
+}
+
+// Loop-invariant code motion: computations whose operands do not change inside a loop move to the
+// loop's preheader, innermost loops first so they can keep moving outwards. Only instructions that
+// cannot fault move, since the loop body might never have run them. Stats: instructions hoisted,
+// preheaders inserted.
+auto hoist_loop_invariants(SsaFunction& function) -> PassStats {
+    PassStats stats;
+    stats.second = insert_preheaders(function);
+    const NamedReads named(function);
+    const ValueFacts facts(function);  // values only move, so what it knows stays true
+    const LoopNest nest = find_loops(function);
+
+    std::unordered_map<ValueKey, std::size_t> defined_in;
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            defined_in[value_key(phi.result)] = block.id;
+        }
+        for (const auto& inst : block.instructions) {
+            if (inst.result.has_value()) {
+                defined_in[value_key(*inst.result)] = block.id;
+            }
+        }
+    }
+
+    for (const auto& loop : nest.loops) {
+        if (!loop.preheader.has_value()) {
+            continue;
+        }
+        const std::size_t preheader = *loop.preheader;
+        const auto invariant = [&](const SsaValue& value) {
+            const auto it = defined_in.find(value_key(value));
+            return it == defined_in.end() || !loop.contains(it->second);  // parameters are defined outside
+        };
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (const auto b : loop.blocks) {
+                auto& instructions = function.blocks[b].instructions;
+                std::vector<SsaInstruction> kept;
+                kept.reserve(instructions.size());
+                for (auto& inst : instructions) {
+                    const bool hoist = inst.result.has_value() && !named.observable(*inst.result) &&
+                                       pure_and_safe(inst, facts) &&
+                                       std::all_of(inst.arguments.begin(), inst.arguments.end(), invariant);
+                    if (!hoist) {
+                        kept.push_back(std::move(inst));
+                        continue;
+                    }
+                    defined_in[value_key(*inst.result)] = preheader;
+                    auto& target = function.blocks[preheader];
+                    target.instructions.insert(insertion_point(target), std::move(inst));
+                    ++stats.first;
+                    moved = true;
+                }
+                instructions = std::move(kept);
+            }
+        }
+    }
+    return stats;
+}
+
+// Strength reduction of induction variables: where a loop header phi `i` steps by a constant
+// integer c on its back edge, `i * s` for a positive integer constant s becomes a second header phi
+// starting at `init * s` and stepping by c * s. The sums are exact, and so equal to the products,
+// while the values stay integers below 2^53. Stats: multiplications reduced.
+class StrengthReduction {
+public:
+    explicit StrengthReduction(SsaFunction& function) : function_(function) {}
+
+    auto run() -> PassStats {
+        PassStats stats;
+        insert_preheaders(function_);
+        while (stats.first < kMaxReductions && reduce_one()) {
+            ++stats.first;
+        }
+        if (stats.changed()) {
+            index_symbols(function_);
+        }
+        return stats;
+    }
+
+private:
+    static constexpr std::size_t kMaxReductions = 64;
+
+    struct Induction {
+        SsaValue phi;
+        SsaValue init;
+        std::size_t step_block = 0;  // where the next value is computed
+        std::size_t step_index = 0;
+        BinaryOp op = BinaryOp::Add;
+        double step = 0.0;
+    };
+
+    struct Candidate {
+        const Loop* loop = nullptr;
+        Induction induction;
+        std::size_t block = 0;  // the multiplication
+        std::size_t index = 0;
+        double scale = 0.0;
+    };
+
+    [[nodiscard]] auto reduce_one() -> bool {
+        const NamedReads named(function_);
+        const ValueFacts facts(function_);
+        const LoopNest nest = find_loops(function_);
+        for (const auto& loop : nest.loops) {
+            if (!loop.preheader.has_value() || loop.latches.size() != 1) {
+                continue;
+            }
+            for (const auto& induction : inductions(loop, facts)) {
+                if (const auto candidate = find_multiply(loop, induction, facts, named)) {
+                    apply(*candidate);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] static auto small_integer(std::optional<double> value) -> bool {
+        return value.has_value() && std::floor(*value) == *value && std::abs(*value) <= kMaxExactInteger;
+    }
+
+    [[nodiscard]] auto inductions(const Loop& loop, const ValueFacts& facts) const -> std::vector<Induction> {
+        std::vector<Induction> found;
+        const auto& header = function_.blocks[loop.header];
+        for (const auto& phi : header.phi_nodes) {
+            if (phi.inputs.size() != 2) {
+                continue;
+            }
+            std::optional<SsaValue> init;
+            std::optional<SsaValue> next;
+            for (const auto& input : phi.inputs) {
+                if (input.predecessor == *loop.preheader) {
+                    init = input.value;
+                } else if (input.predecessor == loop.latches.front()) {
+                    next = input.value;
+                }
+            }
+            if (!init.has_value() || !next.has_value() || !facts.integral(*init)) {
+                continue;
+            }
+            for (const auto b : loop.blocks) {
+                const auto& instructions = function_.blocks[b].instructions;
+                for (std::size_t i = 0; i < instructions.size(); ++i) {
+                    const auto& inst = instructions[i];
+                    if (!inst.result.has_value() || !same_value(*inst.result, *next) || inst.op != SsaOpcode::Binary ||
+                        inst.arguments.size() != 2) {
+                        continue;
+                    }
+                    const bool add = inst.binary_op == BinaryOp::Add;
+                    std::optional<double> step;
+                    if ((add || inst.binary_op == BinaryOp::Sub) && same_value(inst.arguments[0], phi.result)) {
+                        step = facts.constant(inst.arguments[1]);
+                    } else if (add && same_value(inst.arguments[1], phi.result)) {
+                        step = facts.constant(inst.arguments[0]);
+                    }
+                    if (small_integer(step) && *step != 0.0) {
+                        found.push_back(Induction{phi.result, *init, b, i, inst.binary_op, *step});
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    [[nodiscard]] auto find_multiply(const Loop& loop, const Induction& induction, const ValueFacts& facts,
+                                     const NamedReads& named) const -> std::optional<Candidate> {
+        // A header phi reading the product would have to read the new phi, which the interpreter
+        // assigns in order with the others
+        std::unordered_set<ValueKey> header_inputs;
+        for (const auto& phi : function_.blocks[loop.header].phi_nodes) {
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    header_inputs.insert(value_key(*input.value));
+                }
+            }
+        }
+        for (const auto b : loop.blocks) {
+            const auto& instructions = function_.blocks[b].instructions;
+            for (std::size_t i = 0; i < instructions.size(); ++i) {
+                const auto& inst = instructions[i];
+                if (inst.op != SsaOpcode::Binary || inst.binary_op != BinaryOp::Mul || inst.arguments.size() != 2 ||
+                    !inst.result.has_value() || named.observable(*inst.result) ||
+                    header_inputs.count(value_key(*inst.result)) != 0) {
+                    continue;
+                }
+                std::optional<double> scale;
+                if (same_value(inst.arguments[0], induction.phi)) {
+                    scale = facts.constant(inst.arguments[1]);
+                } else if (same_value(inst.arguments[1], induction.phi)) {
+                    scale = facts.constant(inst.arguments[0]);
+                }
+                if (!small_integer(scale) || *scale <= 0.0 || !small_integer(*scale * induction.step)) {
+                    continue;  // a negative scale could turn a -0 product into +0
+                }
+                return Candidate{&loop, induction, b, i, *scale};
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] static auto make_binary(const SsaValue& result, BinaryOp op, const char* text, const SsaValue& left,
+                                          const SsaValue& right) -> SsaInstruction {
+        SsaInstruction inst;
+        inst.op = SsaOpcode::Binary;
+        inst.opcode = "binary";
+        inst.binary_op = op;
+        inst.arguments = {left, right};
+        inst.immediates.emplace_back(text);
+        inst.result = result;
+        return inst;
+    }
+
+    void apply(const Candidate& candidate) {
+        const Loop& loop = *candidate.loop;
+        const Induction& induction = candidate.induction;
+        const SsaValue product = *function_.blocks[candidate.block].instructions[candidate.index].result;
+        const SsaValue scale = new_temporary(function_);
+        const SsaValue start = new_temporary(function_);
+        const SsaValue step = new_temporary(function_);
+        const SsaValue reduced = new_temporary(function_);
+        const SsaValue next = new_temporary(function_);
+        const char* step_text = induction.op == BinaryOp::Add ? "+" : "-";
+
+        // Everything the rewrite needs is built before any instruction moves
+        auto& preheader = function_.blocks[*loop.preheader];
+        const std::vector<SsaInstruction> setup = {
+            make_literal(scale, candidate.scale),
+            make_binary(start, BinaryOp::Mul, "*", induction.init, scale),
+            make_literal(step, candidate.scale * induction.step),
+        };
+        preheader.instructions.insert(insertion_point(preheader), setup.begin(), setup.end());
+
+        auto& step_block = function_.blocks[induction.step_block];
+        step_block.instructions.insert(
+            step_block.instructions.begin() + static_cast<std::ptrdiff_t>(induction.step_index) + 1,
+            make_binary(next, induction.op, step_text, reduced, step));
+
+        PhiNode phi;
+        phi.result = reduced;
+        phi.symbol = reduced.symbol;
+        phi.inputs = {PhiInput{*loop.preheader, start}, PhiInput{loop.latches.front(), next}};
+        function_.blocks[loop.header].phi_nodes.push_back(std::move(phi));
+
+        auto& multiply_block = function_.blocks[candidate.block];
+        const std::size_t index = candidate.index + (induction.step_block == candidate.block &&
+                                                     induction.step_index < candidate.index ? 1 : 0);
+        multiply_block.instructions.erase(multiply_block.instructions.begin() + static_cast<std::ptrdiff_t>(index));
+
+        Replacements replacements;
+        replacements.add(product, reduced);
+        replacements.apply(function_);
+    }
+
+    SsaFunction& function_;
+};
+
+// Scalar replacement of arrays that do not escape: an `array_make` of a small constant length
+// whose result is only indexed by constants in range (`array_get`, `array_set`), measured or
+// dropped is never seen outside the function, so its elements can live in SSA values and the
+// allocation goes. A read becomes a copy of the store that reaches it, with phis where stores
+// from different predecessors meet (built on demand, as in Braun et al.'s SSA construction), and
+// `array_length` becomes a literal. An array with a read that may run before the element's first
+// store, which would see nil, stays. Stats: arrays replaced.
+class ScalarReplacement {
+public:
+    explicit ScalarReplacement(SsaFunction& function) : function_(function) {}
+
+    auto run() -> PassStats {
+        PassStats stats;
+        std::vector<std::pair<SsaValue, std::size_t>> candidates;
+        {
+            const ValueFacts facts(function_);
+            for (const auto& block : function_.blocks) {
+                for (const auto& inst : block.instructions) {
+                    if (inst.op != SsaOpcode::ArrayMake || !inst.result.has_value() || inst.arguments.size() != 1) {
+                        continue;
+                    }
+                    const auto length = element_index(facts.constant(inst.arguments[0]), kMaxElements + 1);
+                    if (length.has_value()) {
+                        candidates.emplace_back(*inst.result, *length);
+                    }
+                }
+            }
+        }
+        for (const auto& [array, length] : candidates) {
+            if (replace(array, length)) {
+                ++stats.first;
+            }
+        }
+        if (stats.changed()) {
+            index_symbols(function_);
+        }
+        return stats;
+    }
+
+private:
+    static constexpr std::size_t kMaxElements = 16;
+    static constexpr std::size_t kNoElement = std::numeric_limits<std::size_t>::max();
+
+    // An instruction reading or writing the array; element is kNoElement for array_length, drop
+    // and the array_make itself
+    struct Access {
+        std::size_t block = 0;
+        std::size_t index = 0;
+        std::size_t element = kNoElement;
+    };
+
+    // The value an element holds at some point; nil before its first store
+    struct Definition {
+        bool nil = true;
+        SsaValue value;
+    };
+
+    struct PendingPhi {
+        std::size_t block = 0;
+        PhiNode phi;
+    };
+
+    // `value` as an index below `limit`, when it is exactly such an integer (as array_get wants)
+    [[nodiscard]] static auto element_index(std::optional<double> value, std::size_t limit)
+        -> std::optional<std::size_t> {
+        if (!value.has_value() || !(*value >= 0.0) || *value >= static_cast<double>(limit) ||
+            std::floor(*value) != *value) {
+            return std::nullopt;
+        }
+        return static_cast<std::size_t>(*value);
+    }
+
+    // Every instruction touching `array`, in block order; nullopt when one of them lets it escape
+    [[nodiscard]] auto accesses(const SsaValue& array, std::size_t length) const -> std::optional<std::vector<Access>> {
+        const NamedReads named(function_);
+        const ValueFacts facts(function_);
+        if (named.observable(array)) {
+            return std::nullopt;
+        }
+        std::vector<Access> found;
+        for (std::size_t b = 0; b < function_.blocks.size(); ++b) {
+            const auto& block = function_.blocks[b];
+            for (const auto& phi : block.phi_nodes) {
+                for (const auto& input : phi.inputs) {
+                    if (input.value.has_value() && same_value(*input.value, array)) {
+                        return std::nullopt;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < block.instructions.size(); ++i) {
+                const auto& inst = block.instructions[i];
+                if (inst.result.has_value() && same_value(*inst.result, array)) {
+                    found.push_back(Access{b, i, kNoElement});
+                    continue;
+                }
+                bool uses = false;
+                for (std::size_t a = 0; a < inst.arguments.size(); ++a) {
+                    if (inst.arguments[a].symbol == array.symbol && inst.arguments[a].version == 0) {
+                        return std::nullopt;  // the variable is read by name
+                    }
+                    if (!same_value(inst.arguments[a], array)) {
+                        continue;
+                    }
+                    if (a != 0) {
+                        return std::nullopt;  // stored, passed or returned
+                    }
+                    uses = true;
+                }
+                if (!uses) {
+                    continue;
+                }
+                if ((inst.op == SsaOpcode::ArrayLength || inst.op == SsaOpcode::Drop) && inst.arguments.size() == 1) {
+                    found.push_back(Access{b, i, kNoElement});
+                    continue;
+                }
+                const bool get = inst.op == SsaOpcode::ArrayGet && inst.arguments.size() == 2;
+                const bool set = inst.op == SsaOpcode::ArraySet && inst.arguments.size() == 3;
+                const auto element = get || set ? element_index(facts.constant(inst.arguments[1]), length) : std::nullopt;
+                if (!element.has_value()) {
+                    return std::nullopt;  // another operation, or an index that might fail
+                }
+                found.push_back(Access{b, i, *element});
+            }
+        }
+        return found;
+    }
+
+    auto replace(const SsaValue& array, std::size_t length) -> bool {
+        const auto found = accesses(array, length);
+        if (!found.has_value()) {
+            return false;
+        }
+        for (const auto& access : *found) {
+            const auto& inst = function_.blocks[access.block].instructions[access.index];
+            if (inst.op == SsaOpcode::ArrayMake) {
+                make_block_ = access.block;
+            }
+        }
+        length_ = length;
+        const std::size_t blocks = function_.blocks.size();
+        last_store_.assign(blocks * length, std::nullopt);
+        entry_.assign(blocks * length, std::nullopt);
+        pending_.clear();
+        saw_nil_ = false;
+        for (const auto& access : *found) {
+            const auto& inst = function_.blocks[access.block].instructions[access.index];
+            if (inst.op == SsaOpcode::ArraySet) {
+                last_store_[access.block * length + access.element] = inst.arguments[2];
+            }
+        }
+
+        const std::size_t symbols = function_.symbols.size();
+        std::vector<std::pair<const Access*, SsaValue>> reads;  // and the value each one sees
+        std::vector<std::optional<Definition>> current(length);
+        std::size_t block = blocks;
+        for (const auto& access : *found) {
+            if (access.block != block) {
+                block = access.block;
+                std::fill(current.begin(), current.end(),
+                          block == make_block_ ? std::optional<Definition>{Definition{}} : std::nullopt);
+            }
+            if (access.element == kNoElement) {
+                continue;
+            }
+            const auto& inst = function_.blocks[block].instructions[access.index];
+            if (inst.op == SsaOpcode::ArraySet) {
+                current[access.element] = Definition{false, inst.arguments[2]};
+                continue;
+            }
+            const Definition seen =
+                current[access.element].has_value() ? *current[access.element] : at_entry(block, access.element);
+            if (seen.nil || saw_nil_) {
+                // at_entry may have added phi temporaries, moving the symbols the index points into
+                function_.symbols.resize(symbols);
+                index_symbols(function_);
+                return false;
+            }
+            reads.emplace_back(&access, seen.value);
+        }
+
+        // Rewrite in place first, so the positions recorded in `found` stay valid
+        std::vector<std::vector<std::size_t>> removed(blocks);
+        for (const auto& [access, value] : reads) {
+            auto& inst = function_.blocks[access->block].instructions[access->index];
+            if (inst.result.has_value()) {
+                inst = make_assign(*inst.result, value);
+            } else {
+                removed[access->block].push_back(access->index);
+            }
+        }
+        for (const auto& access : *found) {
+            auto& inst = function_.blocks[access.block].instructions[access.index];
+            if (access.element != kNoElement && inst.op != SsaOpcode::ArraySet) {
+                continue;  // a read, rewritten above
+            }
+            if (inst.op == SsaOpcode::ArraySet && inst.result.has_value()) {
+                inst = make_assign(*inst.result, inst.arguments[2]);
+            } else if (inst.op == SsaOpcode::ArrayLength && inst.result.has_value()) {
+                inst = make_literal(*inst.result, static_cast<double>(length));
+            } else {
+                removed[access.block].push_back(access.index);
+            }
+        }
+        for (std::size_t b = 0; b < blocks; ++b) {
+            auto& instructions = function_.blocks[b].instructions;
+            std::sort(removed[b].rbegin(), removed[b].rend());
+            for (const auto index : removed[b]) {
+                instructions.erase(instructions.begin() + static_cast<std::ptrdiff_t>(index));
+            }
+        }
+
+        // The interpreter assigns a block's phis in order, so an input naming another phi of the
+        // same block goes through a copy at the end of the predecessor
+        for (auto& [target, phi] : pending_) {
+            const auto block_phis = phi_results(function_.blocks[target]);
+            for (auto& input : phi.inputs) {
+                if (!input.value.has_value() || same_value(*input.value, phi.result)) {
+                    continue;
+                }
+                bool same_block = block_phis.count(value_key(*input.value)) != 0;
+                for (const auto& other : pending_) {
+                    same_block = same_block || (other.block == target && same_value(other.phi.result, *input.value));
+                }
+                if (same_block) {
+                    const SsaValue copy = new_temporary(function_);
+                    auto& predecessor = function_.blocks[input.predecessor];
+                    predecessor.instructions.insert(insertion_point(predecessor), make_assign(copy, *input.value));
+                    input.value = copy;
+                }
+            }
+        }
+        for (auto& [target, phi] : pending_) {
+            function_.blocks[target].phi_nodes.push_back(std::move(phi));
+        }
+        return true;
+    }
+
+    // The element's value when `block` is entered. Blocks reached here are dominated by the
+    // array_make, as every use of the array is, so the walk up the predecessors stops there.
+    [[nodiscard]] auto at_entry(std::size_t block, std::size_t element) -> Definition {
+        auto& memo = entry_[block * length_ + element];
+        if (memo.has_value()) {
+            return *memo;
+        }
+        const auto& predecessors = function_.blocks[block].predecessors;
+        if (predecessors.size() == 1) {
+            memo = at_exit(predecessors.front(), element);
+            return *memo;
+        }
+        if (predecessors.empty()) {
+            memo = Definition{};
+            return *memo;
+        }
+        // The phi is recorded first, so loops find it instead of coming back here
+        PendingPhi pending{block, {}};
+        pending.phi.result = new_temporary(function_);
+        pending.phi.symbol = pending.phi.result.symbol;
+        memo = Definition{false, pending.phi.result};
+        for (const auto predecessor : predecessors) {
+            const Definition incoming = at_exit(predecessor, element);
+            saw_nil_ = saw_nil_ || incoming.nil;
+            pending.phi.inputs.push_back(PhiInput{predecessor, incoming.value});
+        }
+        const Definition result = *memo;
+        pending_.push_back(std::move(pending));
+        return result;
+    }
+
+    [[nodiscard]] auto at_exit(std::size_t block, std::size_t element) -> Definition {
+        if (const auto& store = last_store_[block * length_ + element]) {
+            return Definition{false, *store};
+        }
+        if (block == make_block_) {
+            return Definition{};
+        }
+        return at_entry(block, element);
+    }
+
+    SsaFunction& function_;
+    std::size_t make_block_ = 0;
+    std::size_t length_ = 0;
+    std::vector<std::optional<SsaValue>> last_store_;  // by block * length + element
+    std::vector<std::optional<Definition>> entry_;
+    std::vector<PendingPhi> pending_;
+    bool saw_nil_ = false;
+};
+
+// Removes definitions nobody uses, as long as evaluating them could not have raised an error.
+// Calls, array operations and control flow always stay. Stats: instructions, phis removed.
+class DeadCodeElimination {
+public:
+    explicit DeadCodeElimination(SsaFunction& function) : function_(function), named_(function), facts_(function) {}
+
+    auto run() -> PassStats {
+        index_definitions();
+        mark_live();
+
+        PassStats stats;
+        for (auto& block : function_.blocks) {
+            const std::size_t phis = block.phi_nodes.size();
+            block.phi_nodes.erase(std::remove_if(block.phi_nodes.begin(), block.phi_nodes.end(),
+                                                 [&](const PhiNode& phi) { return !live(phi.result); }),
+                                  block.phi_nodes.end());
+            stats.second += phis - block.phi_nodes.size();
+
+            const std::size_t instructions = block.instructions.size();
+            block.instructions.erase(
+                std::remove_if(block.instructions.begin(), block.instructions.end(),
+                               [&](const SsaInstruction& inst) {
+                                   return removable(inst) && (!inst.result.has_value() || !live(*inst.result));
+                               }),
+                block.instructions.end());
+            stats.first += instructions - block.instructions.size();
+        }
+        return stats;
+    }
+
+private:
+    struct Definition {
+        const PhiNode* phi = nullptr;
+        const SsaInstruction* inst = nullptr;
+    };
+
+    void index_definitions() {
+        for (const auto& block : function_.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                definitions_[value_key(phi.result)] = Definition{&phi, nullptr};
+            }
+            for (const auto& inst : block.instructions) {
+                if (inst.result.has_value()) {
+                    definitions_[value_key(*inst.result)] = Definition{nullptr, &inst};
+                }
+            }
+        }
+    }
+
+    // Whether dropping `inst` (when its result is unused) changes nothing about the run
+    [[nodiscard]] auto removable(const SsaInstruction& inst) const -> bool {
+        if (inst.result.has_value() && named_.observable(*inst.result)) {
+            return false;
+        }
+        if (inst.op == SsaOpcode::Assign || inst.op == SsaOpcode::Drop) {
+            return inst.arguments.size() == 1 && inst.arguments[0].version != 0;
+        }
+        return pure_and_safe(inst, facts_);
+    }
+
+    [[nodiscard]] auto live(const SsaValue& value) const -> bool { return live_.count(value_key(value)) != 0; }
+
+    void mark_live() {
+        std::vector<SsaValue> work;
+        const auto use = [&](const SsaValue& value) {
+            if (live_.insert(value_key(value)).second) {
+                work.push_back(value);
+            }
+        };
+        for (const auto& block : function_.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                if (named_.observable(phi.result)) {
+                    use(phi.result);
+                }
+            }
+            for (const auto& inst : block.instructions) {
+                if (!removable(inst)) {
+                    for (const auto& argument : inst.arguments) {
+                        use(argument);
+                    }
+                    if (inst.result.has_value()) {
+                        use(*inst.result);
+                    }
+                }
+            }
+        }
+        while (!work.empty()) {
+            const SsaValue value = work.back();
+            work.pop_back();
+            const auto it = definitions_.find(value_key(value));
+            if (it == definitions_.end()) {
+                continue;
+            }
+            if (it->second.phi != nullptr) {
+                for (const auto& input : it->second.phi->inputs) {
+                    if (input.value.has_value()) {
+                        use(*input.value);
+                    }
+                }
+            } else {
+                for (const auto& argument : it->second.inst->arguments) {
+                    use(argument);
+                }
+            }
+        }
+    }
+
+    SsaFunction& function_;
+    NamedReads named_;
+    ValueFacts facts_;
+    std::unordered_map<ValueKey, Definition> definitions_;
+    std::unordered_set<ValueKey> live_;
+};
+
+[[nodiscard]] auto plural(std::size_t count, const char* noun) -> std::string {
+    std::string text = std::to_string(count) + " " + noun;
+    if (count != 1) {
+        text += noun[std::char_traits<char>::length(noun) - 1] == 'h' ? "es" : "s";
+    }
+    return text;
+}
+
+}  // namespace
+
+auto disable_optimization_pass(OptimizationOptions& options, std::string_view pass) -> bool {
+    if (pass == "fold-calls") {
+        options.fold_calls = false;
+    } else if (pass == "inline") {
+        options.inlining = false;
+    } else if (pass == "tail-calls") {
+        options.tail_calls = false;
+    } else if (pass == "sccp") {
+        options.constant_propagation = false;
+    } else if (pass == "copy-propagation") {
+        options.copy_propagation = false;
+    } else if (pass == "gvn") {
+        options.value_numbering = false;
+    } else if (pass == "licm") {
+        options.loop_invariant_code_motion = false;
+    } else if (pass == "strength-reduction") {
+        options.strength_reduction = false;
+    } else if (pass == "scalar-replacement") {
+        options.scalar_replacement = false;
+    } else if (pass == "dce") {
+        options.dead_code_elimination = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+auto optimize_ssa(SsaFunction& function, const OptimizationOptions& options, std::vector<std::string>* log)
+    -> bool {
+    PassStats sccp;
+    PassStats copies;
+    PassStats gvn;
+    PassStats licm;
+    PassStats reduction;
+    PassStats sroa;
+    PassStats dce;
+    bool changed_any = false;
+    for (int round = 0; round < kMaxRounds; ++round) {
+        bool changed = false;
+        if (options.constant_propagation) {
+            const PassStats stats = ConstantPropagation(function).run();
+            sccp.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.copy_propagation) {
+            const PassStats stats = propagate_copies(function);
+            copies.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.value_numbering) {
+            const PassStats stats = ValueNumbering(function).run();
+            gvn.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.loop_invariant_code_motion) {
+            const PassStats stats = hoist_loop_invariants(function);
+            licm.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.strength_reduction) {
+            const PassStats stats = StrengthReduction(function).run();
+            reduction.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.scalar_replacement) {
+            const PassStats stats = ScalarReplacement(function).run();
+            sroa.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (options.dead_code_elimination) {
+            const PassStats stats = DeadCodeElimination(function).run();
+            dce.add(stats);
+            changed = changed || stats.changed();
+        }
+        if (!changed) {
+            break;
+        }
+        changed_any = true;
+    }
+
+    if (log != nullptr) {
+        const auto report = [&](bool enabled, const char* pass, std::string summary) {
+            log->push_back(std::string{pass} + ": " + (enabled ? std::move(summary) : std::string{"disabled"}));
+        };
+        report(options.constant_propagation, "sccp",
+               plural(sccp.first, "value") + " folded, " + plural(sccp.second, "branch") + " resolved, " +
+                   plural(sccp.third, "block") + " removed");
+        report(options.copy_propagation, "copy-propagation",
+               plural(copies.first, "use") + " forwarded, " + plural(copies.second, "phi") + " removed");
+        report(options.value_numbering, "gvn", plural(gvn.first, "redundant value") + " removed");
+        report(options.loop_invariant_code_motion, "licm",
+               plural(licm.first, "instruction") + " hoisted, " + plural(licm.second, "preheader") + " inserted");
+        report(options.strength_reduction, "strength-reduction",
+               plural(reduction.first, "multiplication") + " reduced");
+        report(options.scalar_replacement, "scalar-replacement", plural(sroa.first, "array") + " replaced");
+        report(options.dead_code_elimination, "dce",
+               plural(dce.first, "instruction") + " and " + plural(dce.second, "phi") + " removed");
+    }
+    return changed_any;
 }
 
 }  // namespace impulse::ir
@@ -156,6 +156,19 @@ namespace {
         case InstructionKind::ArrayLength:
             out << "array_length";
             break;
+        case InstructionKind::MakeStruct:
+            out << "make_struct";
+            if (!inst.operands.empty()) {
+                out << ' ' << inst.operands.front();
+            }
+            break;
+        case InstructionKind::FieldGet:
+        case InstructionKind::FieldSet:
+            out << (inst.kind == InstructionKind::FieldGet ? "field_get" : "field_set");
+            if (inst.operands.size() >= 2) {
+                out << ' ' << inst.operands[0] << '.' << inst.operands[1];
+            }
+            break;
     }
     return out.str();
 }
@@ -0,0 +1,200 @@
+#include "impulse/ir/purity.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "number_format.h"
+
+namespace impulse::ir {
+
+namespace {
+
+// A literal operand's value, as the evaluator reads it
+[[nodiscard]] auto literal_value(const Instruction& inst) -> std::optional<double> {
+    if (inst.kind != InstructionKind::Literal || inst.operands.empty()) {
+        return std::nullopt;
+    }
+    const std::string& text = inst.operands.front();
+    if (text == "true" || text == "false") {
+        return text == "true" ? 1.0 : 0.0;
+    }
+    std::string digits;
+    for (const char ch : text) {
+        if (ch != '_') {
+            digits.push_back(ch);
+        }
+    }
+    char* end = nullptr;
+    const double value = std::strtod(digits.c_str(), &end);
+    if (digits.empty() || end != digits.c_str() + digits.size() || !std::isfinite(value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+[[nodiscard]] auto call_arity(const Instruction& inst) -> std::optional<std::size_t> {
+    if (inst.operands.size() < 2) {
+        return std::nullopt;
+    }
+    char* end = nullptr;
+    const auto arity = std::strtoul(inst.operands[1].c_str(), &end, 10);
+    if (end == inst.operands[1].c_str() || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(arity);
+}
+
+// Whether the function's own instructions qualify, leaving out what its callees do
+[[nodiscard]] auto locally_pure(const Function& function, const Module& module,
+                                const std::unordered_map<std::string, std::size_t>& functions) -> bool {
+    if (function.blocks.empty()) {
+        return false;
+    }
+    std::unordered_map<std::string, StorageClass> bindings;
+    for (const auto& binding : module.bindings) {
+        bindings.emplace(binding.name, binding.storage);
+    }
+    std::unordered_set<std::string> locals;
+    for (const auto& parameter : function.parameters) {
+        locals.insert(parameter.name);
+    }
+    for (const auto& block : function.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.kind == InstructionKind::Store && !inst.operands.empty()) {
+                // A binding's name may be assigned to as a global: treat it as one
+                if (bindings.count(inst.operands.front()) != 0) {
+                    return false;
+                }
+                locals.insert(inst.operands.front());
+            }
+        }
+    }
+
+    for (const auto& block : function.blocks) {
+        for (const auto& inst : block.instructions) {
+            switch (inst.kind) {
+                case InstructionKind::Reference: {
+                    if (inst.operands.empty()) {
+                        return false;
+                    }
+                    const std::string& name = inst.operands.front();
+                    if (locals.count(name) != 0) {
+                        break;
+                    }
+                    const auto binding = bindings.find(name);
+                    if (binding == bindings.end() || binding->second == StorageClass::Var) {
+                        return false;
+                    }
+                    break;
+                }
+                case InstructionKind::Call: {
+                    const auto callee = inst.operands.empty() ? functions.end() : functions.find(inst.operands.front());
+                    const auto arity = call_arity(inst);
+                    if (callee == functions.end() || !arity.has_value() ||
+                        module.functions[callee->second].parameters.size() != *arity) {
+                        return false;  // builtins, unknown names and mismatched calls
+                    }
+                    break;
+                }
+                case InstructionKind::StringLiteral:
+                case InstructionKind::MakeArray:
+                case InstructionKind::ArrayGet:
+                case InstructionKind::ArraySet:
+                case InstructionKind::ArrayLength:
+                case InstructionKind::MakeStruct:
+                case InstructionKind::FieldGet:
+                case InstructionKind::FieldSet:
+                    return false;
+                case InstructionKind::Comment:
+                case InstructionKind::Return:
+                case InstructionKind::Literal:
+                case InstructionKind::Binary:
+                case InstructionKind::Unary:
+                case InstructionKind::Store:
+                case InstructionKind::Drop:
+                case InstructionKind::Branch:
+                case InstructionKind::BranchIf:
+                case InstructionKind::Label:
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+auto find_pure_functions(const Module& module) -> std::vector<bool> {
+    std::unordered_map<std::string, std::size_t> functions;
+    for (std::size_t i = 0; i < module.functions.size(); ++i) {
+        functions.emplace(module.functions[i].name, i);
+    }
+    std::vector<bool> pure(module.functions.size());
+    for (std::size_t i = 0; i < module.functions.size(); ++i) {
+        pure[i] = locally_pure(module.functions[i], module, functions);
+    }
+
+    // Calling an impure function makes the caller impure, until nothing changes
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::size_t i = 0; i < module.functions.size(); ++i) {
+            if (!pure[i]) {
+                continue;
+            }
+            for (const auto& block : module.functions[i].blocks) {
+                for (const auto& inst : block.instructions) {
+                    if (inst.kind == InstructionKind::Call && !pure[functions.at(inst.operands.front())]) {
+                        pure[i] = false;
+                    }
+                }
+            }
+            changed = changed || !pure[i];
+        }
+    }
+    return pure;
+}
+
+auto fold_constant_calls(Function& function, CallEvaluator& calls) -> std::size_t {
+    std::size_t folded = 0;
+    std::vector<double> arguments;
+    for (auto& block : function.blocks) {
+        auto& instructions = block.instructions;
+        for (std::size_t i = 0; i < instructions.size(); ++i) {
+            const Instruction& inst = instructions[i];
+            const auto arity = inst.kind == InstructionKind::Call ? call_arity(inst) : std::nullopt;
+            if (!arity.has_value() || *arity > i) {
+                continue;
+            }
+            // Each argument is pushed by one of the literals right before the call
+            arguments.clear();
+            for (std::size_t a = i - *arity; a < i; ++a) {
+                const auto value = literal_value(instructions[a]);
+                if (!value.has_value()) {
+                    break;
+                }
+                arguments.push_back(*value);
+            }
+            if (arguments.size() != *arity) {
+                continue;
+            }
+            const auto result = calls.call(inst.operands.front(), arguments);
+            if (result.status != EvalStatus::Success || !result.value.has_value() || !std::isfinite(*result.value)) {
+                continue;
+            }
+
+            const std::size_t first = i - *arity;
+            instructions[first] = Instruction{InstructionKind::Literal, {format_number(*result.value)}};
+            instructions.erase(instructions.begin() + static_cast<std::ptrdiff_t>(first) + 1,
+                               instructions.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+            i = first;
+            ++folded;
+        }
+    }
+    return folded;
+}
+
+}  // namespace impulse::ir
@@ -0,0 +1,253 @@
+#include "impulse/ir/serialize.h"
+
+#include <utility>
+#include <vector>
+
+namespace impulse::ir {
+
+void BinaryWriter::u32(std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        u8(static_cast<std::uint8_t>(value >> shift));
+    }
+}
+
+void BinaryWriter::u64(std::uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        u8(static_cast<std::uint8_t>(value >> shift));
+    }
+}
+
+void BinaryWriter::string(std::string_view value) {
+    u64(value.size());
+    out_.append(value.data(), value.size());
+}
+
+void BinaryWriter::bytes(const void* data, std::size_t size) {
+    out_.append(static_cast<const char*>(data), size);
+}
+
+auto BinaryReader::take(std::size_t size) -> std::string_view {
+    if (!ok_ || size > in_.size()) {
+        ok_ = false;
+        return {};
+    }
+    const std::string_view taken = in_.substr(0, size);
+    in_.remove_prefix(size);
+    return taken;
+}
+
+auto BinaryReader::u8() -> std::uint8_t {
+    const std::string_view byte = take(1);
+    return byte.empty() ? 0 : static_cast<std::uint8_t>(byte[0]);
+}
+
+auto BinaryReader::u32() -> std::uint32_t {
+    const std::string_view raw = take(4);
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(raw[i])) << (8 * i);
+    }
+    return value;
+}
+
+auto BinaryReader::u64() -> std::uint64_t {
+    const std::string_view raw = take(8);
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(raw[i])) << (8 * i);
+    }
+    return value;
+}
+
+auto BinaryReader::string() -> std::string {
+    const std::uint64_t size = u64();
+    return std::string(take(static_cast<std::size_t>(size)));
+}
+
+auto BinaryReader::bytes(std::size_t size) -> std::string_view { return take(size); }
+
+namespace {
+
+void write_value(const SsaValue& value, BinaryWriter& out) {
+    out.u32(value.symbol);
+    out.u32(value.version);
+}
+
+auto read_value(BinaryReader& in) -> SsaValue {
+    SsaValue value;
+    value.symbol = in.u32();
+    value.version = in.u32();
+    return value;
+}
+
+void write_indices(const std::vector<std::size_t>& indices, BinaryWriter& out) {
+    out.u64(indices.size());
+    for (const auto index : indices) {
+        out.u64(index);
+    }
+}
+
+// Counts come from the input, so each element must consume at least one byte before the
+// vector is grown; this keeps corrupt counts from reserving huge amounts of memory.
+auto read_count(BinaryReader& in) -> std::size_t {
+    const std::uint64_t count = in.u64();
+    if (count > in.remaining()) {
+        in.fail();
+        return 0;
+    }
+    return static_cast<std::size_t>(count);
+}
+
+auto read_indices(BinaryReader& in) -> std::vector<std::size_t> {
+    std::vector<std::size_t> indices(read_count(in));
+    for (auto& index : indices) {
+        index = static_cast<std::size_t>(in.u64());
+    }
+    return indices;
+}
+
+void write_instruction(const SsaInstruction& inst, BinaryWriter& out) {
+    out.u8(static_cast<std::uint8_t>(inst.op));
+    out.u8(static_cast<std::uint8_t>(inst.binary_op));
+    out.string(inst.opcode);
+    out.u64(inst.arguments.size());
+    for (const auto& argument : inst.arguments) {
+        write_value(argument, out);
+    }
+    out.u64(inst.immediates.size());
+    for (const auto& immediate : inst.immediates) {
+        out.string(immediate);
+    }
+    out.u8(inst.result.has_value() ? 1 : 0);
+    if (inst.result.has_value()) {
+        write_value(*inst.result, out);
+    }
+}
+
+auto read_instruction(BinaryReader& in) -> SsaInstruction {
+    SsaInstruction inst;
+    const std::uint8_t op = in.u8();
+    const std::uint8_t binary_op = in.u8();
+    inst.op = op <= static_cast<std::uint8_t>(SsaOpcode::Unknown) ? static_cast<SsaOpcode>(op) : SsaOpcode::Unknown;
+    inst.binary_op = binary_op <= static_cast<std::uint8_t>(BinaryOp::Unknown) ? static_cast<BinaryOp>(binary_op)
+                                                                               : BinaryOp::Unknown;
+    inst.opcode = in.string();
+    inst.arguments.resize(read_count(in));
+    for (auto& argument : inst.arguments) {
+        argument = read_value(in);
+    }
+    inst.immediates.resize(read_count(in));
+    for (auto& immediate : inst.immediates) {
+        immediate = in.string();
+    }
+    if (in.u8() != 0) {
+        inst.result = read_value(in);
+    }
+    decode_operands(inst);  // the decoded forms are not stored
+    return inst;
+}
+
+void write_block(const SsaBlock& block, BinaryWriter& out) {
+    out.u64(block.id);
+    out.string(block.name);
+    out.u64(block.phi_nodes.size());
+    for (const auto& phi : block.phi_nodes) {
+        write_value(phi.result, out);
+        out.u32(phi.symbol);
+        out.u64(phi.inputs.size());
+        for (const auto& input : phi.inputs) {
+            out.u64(input.predecessor);
+            out.u8(input.value.has_value() ? 1 : 0);
+            if (input.value.has_value()) {
+                write_value(*input.value, out);
+            }
+        }
+    }
+    out.u64(block.instructions.size());
+    for (const auto& inst : block.instructions) {
+        write_instruction(inst, out);
+    }
+    write_indices(block.successors, out);
+    write_indices(block.predecessors, out);
+    out.u64(block.immediate_dominator);
+    write_indices(block.dominator_children, out);
+    write_indices(block.dominance_frontier, out);
+}
+
+auto read_block(BinaryReader& in) -> SsaBlock {
+    SsaBlock block;
+    block.id = static_cast<std::size_t>(in.u64());
+    block.name = in.string();
+    block.phi_nodes.resize(read_count(in));
+    for (auto& phi : block.phi_nodes) {
+        phi.result = read_value(in);
+        phi.symbol = in.u32();
+        phi.inputs.resize(read_count(in));
+        for (auto& input : phi.inputs) {
+            input.predecessor = static_cast<std::size_t>(in.u64());
+            if (in.u8() != 0) {
+                input.value = read_value(in);
+            }
+        }
+    }
+    block.instructions.resize(read_count(in));
+    for (auto& inst : block.instructions) {
+        inst = read_instruction(in);
+    }
+    block.successors = read_indices(in);
+    block.predecessors = read_indices(in);
+    block.immediate_dominator = static_cast<std::size_t>(in.u64());
+    block.dominator_children = read_indices(in);
+    block.dominance_frontier = read_indices(in);
+    return block;
+}
+
+}  // namespace
+
+void serialize_ssa(const SsaFunction& function, BinaryWriter& out) {
+    out.string(function.name);
+    out.u64(function.symbols.size());
+    for (const auto& symbol : function.symbols) {
+        out.u32(symbol.id);
+        out.string(symbol.name);
+        out.string(symbol.type);
+    }
+    out.u64(function.blocks.size());
+    for (const auto& block : function.blocks) {
+        write_block(block, out);
+    }
+}
+
+auto deserialize_ssa(BinaryReader& in) -> std::optional<SsaFunction> {
+    SsaFunction function;
+    function.name = in.string();
+    function.symbols.resize(read_count(in));
+    for (auto& symbol : function.symbols) {
+        symbol.id = in.u32();
+        symbol.name = in.string();
+        symbol.type = in.string();
+    }
+    function.blocks.resize(read_count(in));
+    for (auto& block : function.blocks) {
+        block = read_block(in);
+    }
+    if (!in.ok()) {
+        return std::nullopt;
+    }
+
+    // Block references index the block list; reject anything that would read out of range
+    const std::size_t block_count = function.blocks.size();
+    for (const auto& block : function.blocks) {
+        for (const auto* indices : {&block.successors, &block.predecessors}) {
+            for (const auto index : *indices) {
+                if (index >= block_count) {
+                    return std::nullopt;
+                }
+            }
+        }
+    }
+    index_symbols(function);
+    return function;
+}
+
+}  // namespace impulse::ir
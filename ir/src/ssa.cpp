@@ -1,10 +1,10 @@
 #include "impulse/ir/ssa.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <optional>
 #include <unordered_map>
-#include <unordered_set>
 
 namespace {
 
@@ -66,84 +66,102 @@ private:
     std::unordered_map<std::string, SymbolId> name_to_id_;
 };
 
-[[nodiscard]] auto compute_reverse_postorder(const ControlFlowGraph& cfg) -> std::vector<std::size_t> {
-    std::vector<std::size_t> order;
-    order.reserve(cfg.blocks.size());
-    std::vector<bool> visited(cfg.blocks.size(), false);
+// The dominator helpers work on any graph whose blocks list their successors and predecessors
+// by index: the CFG while building SSA, and the SSA itself once the optimiser changed its edges.
+//
+// Immediate dominators by semi-NCA: semidominators as in Lengauer-Tarjan (path-compressed eval
+// over a depth-first spanning tree), then each idom is the nearest common ancestor of the parent
+// and the semidominator, found by walking up the spanning tree. Near-linear, no fixed-point
+// iteration, and neither step recurses, so deep graphs cannot exhaust the stack. The entry is its
+// own dominator; blocks unreachable from it get none.
+template <typename Graph>
+[[nodiscard]] auto compute_immediate_dominators(const Graph& cfg) -> std::vector<std::size_t> {
+    constexpr std::size_t kUndefined = std::numeric_limits<std::size_t>::max();
+    const std::size_t count = cfg.blocks.size();
+    std::vector<std::size_t> idom(count, kUndefined);
+    if (count == 0) {
+        return idom;
+    }
 
-    const auto dfs = [&](auto&& self, std::size_t block_index) -> void {
-        if (block_index >= cfg.blocks.size() || visited[block_index]) {
-            return;
+    // Depth-first preorder: order[n] is the n-th block reached, number[block] its position
+    std::vector<std::size_t> number(count, kUndefined);
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> parent;  // by preorder number
+    order.reserve(count);
+    parent.reserve(count);
+    std::vector<std::pair<std::size_t, std::size_t>> stack;  // block, next successor to visit
+    number[0] = 0;
+    order.push_back(0);
+    parent.push_back(0);
+    stack.emplace_back(0, 0);
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        const auto& successors = cfg.blocks[block].successors;
+        if (next == successors.size()) {
+            stack.pop_back();
+            continue;
         }
-        visited[block_index] = true;
-        const auto& block = cfg.blocks[block_index];
-        for (const auto succ : block.successors) {
-            self(self, succ);
+        const std::size_t successor = successors[next++];
+        if (successor < count && number[successor] == kUndefined) {
+            number[successor] = order.size();
+            parent.push_back(number[block]);
+            order.push_back(successor);
+            stack.emplace_back(successor, 0);
         }
-        order.push_back(block_index);
-    };
-
-    if (!cfg.blocks.empty()) {
-        dfs(dfs, 0);
     }
 
-    std::reverse(order.begin(), order.end());
-    return order;
-}
-
-[[nodiscard]] auto compute_immediate_dominators(const ControlFlowGraph& cfg) -> std::vector<std::size_t> {
-    if (cfg.blocks.empty()) {
-        return {};
+    const std::size_t reached = order.size();
+    std::vector<std::size_t> semi(reached);
+    std::vector<std::size_t> label(reached);
+    std::vector<std::size_t> ancestor(reached, kUndefined);
+    for (std::size_t n = 0; n < reached; ++n) {
+        semi[n] = n;
+        label[n] = n;
     }
-
-    constexpr std::size_t kUndefined = std::numeric_limits<std::size_t>::max();
-    std::vector<std::size_t> idom(cfg.blocks.size(), kUndefined);
-    idom[0] = 0;
-
-    const auto rpo = compute_reverse_postorder(cfg);
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (std::size_t idx = 1; idx < rpo.size(); ++idx) {
-            const std::size_t block_index = rpo[idx];
-            const auto& block = cfg.blocks[block_index];
-
-            std::size_t new_idom = kUndefined;
-            for (const auto pred : block.predecessors) {
-                if (pred >= cfg.blocks.size()) {
-                    continue;
-                }
-                if (idom[pred] == kUndefined) {
-                    continue;
-                }
-                if (new_idom == kUndefined) {
-                    new_idom = pred;
-                } else {
-                    std::size_t finger1 = pred;
-                    std::size_t finger2 = new_idom;
-                    while (finger1 != finger2) {
-                        while (finger1 > finger2) {
-                            finger1 = idom[finger1];
-                        }
-                        while (finger2 > finger1) {
-                            finger2 = idom[finger2];
-                        }
-                    }
-                    new_idom = finger1;
-                }
+    std::vector<std::size_t> path;
+    // The vertex of least semidominator on the forest path above v
+    const auto eval = [&](std::size_t v) {
+        if (ancestor[v] == kUndefined) {
+            return v;
+        }
+        path.clear();
+        for (std::size_t x = v; ancestor[ancestor[x]] != kUndefined; x = ancestor[x]) {
+            path.push_back(x);
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            const std::size_t x = *it;
+            const std::size_t up = ancestor[x];
+            if (semi[label[up]] < semi[label[x]]) {
+                label[x] = label[up];
             }
-
-            if (new_idom != kUndefined && idom[block_index] != new_idom) {
-                idom[block_index] = new_idom;
-                changed = true;
+            ancestor[x] = ancestor[up];
+        }
+        return label[v];
+    };
+    for (std::size_t w = reached - 1; w > 0; --w) {
+        for (const auto predecessor : cfg.blocks[order[w]].predecessors) {
+            if (predecessor >= count || number[predecessor] == kUndefined) {
+                continue;
             }
+            semi[w] = std::min(semi[w], semi[eval(number[predecessor])]);
         }
+        ancestor[w] = parent[w];
     }
 
+    std::vector<std::size_t> dominator(parent);
+    for (std::size_t w = 1; w < reached; ++w) {
+        while (dominator[w] > semi[w]) {
+            dominator[w] = dominator[dominator[w]];
+        }
+    }
+    for (std::size_t w = 0; w < reached; ++w) {
+        idom[order[w]] = order[dominator[w]];
+    }
     return idom;
 }
 
-[[nodiscard]] auto compute_dominance_frontiers(const ControlFlowGraph& cfg,
+template <typename Graph>
+[[nodiscard]] auto compute_dominance_frontiers(const Graph& cfg,
                                                const std::vector<std::size_t>& idom)
     -> std::vector<std::vector<std::size_t>> {
     std::vector<std::vector<std::size_t>> frontiers(cfg.blocks.size());
@@ -178,23 +196,37 @@ private:
 class RenameContext {
 public:
     RenameContext(const Function& function, const ControlFlowGraph& cfg, SsaFunction& ssa, SymbolTable& symbols)
-        : function_(function), cfg_(cfg), ssa_(ssa), symbols_(symbols) {
-        block_instructions_.resize(cfg_.blocks.size());
-        for (std::size_t block_index = 0; block_index < cfg_.blocks.size(); ++block_index) {
-            const auto& block = cfg_.blocks[block_index];
-            if (block.start_index >= block.end_index) {
-                continue;
-            }
-            for (std::size_t i = block.start_index; i < block.end_index && i < cfg_.instructions.size(); ++i) {
-                block_instructions_[block_index].push_back(cfg_.instructions[i]);
-            }
-        }
-    }
+        : function_(function), cfg_(cfg), ssa_(ssa), symbols_(symbols) {}
 
+    // Walks the dominator tree with an explicit stack: each block's definitions stay on the
+    // symbol stacks while its dominated blocks are renamed, and are popped when it is left
     void run() {
         initialize_parameters();
-        if (!ssa_.blocks.empty()) {
-            rename_block(0);
+        if (ssa_.blocks.empty()) {
+            return;
+        }
+        struct Visit {
+            std::size_t block;
+            std::size_t next_child = 0;
+            std::vector<SymbolId> defined;
+        };
+        std::vector<Visit> walk;
+        walk.push_back(Visit{0, 0, rename_block(0)});
+        while (!walk.empty()) {
+            Visit& visit = walk.back();
+            const auto& children = ssa_.blocks[visit.block].dominator_children;
+            if (visit.next_child < children.size()) {
+                const std::size_t child = children[visit.next_child++];
+                if (child < ssa_.blocks.size()) {
+                    auto defined = rename_block(child);
+                    walk.push_back(Visit{child, 0, std::move(defined)});
+                }
+                continue;
+            }
+            for (auto it = visit.defined.rbegin(); it != visit.defined.rend(); ++it) {
+                pop(*it);
+            }
+            walk.pop_back();
         }
     }
 
@@ -209,11 +241,8 @@ private:
         }
     }
 
-    void rename_block(std::size_t block_index) {
-        if (block_index >= ssa_.blocks.size()) {
-            return;
-        }
-
+    // Renames one block and fills its successors' phi inputs; returns the symbols it pushed
+    [[nodiscard]] auto rename_block(std::size_t block_index) -> std::vector<SymbolId> {
         auto& block = ssa_.blocks[block_index];
         std::vector<SymbolId> defined_symbols;
         defined_symbols.reserve(block.phi_nodes.size());
@@ -226,8 +255,11 @@ private:
             defined_symbols.push_back(phi.symbol);
         }
 
-        if (block_index < block_instructions_.size()) {
-            for (const auto* inst : block_instructions_[block_index]) {
+        if (block_index < cfg_.blocks.size()) {
+            const auto& cfg_block = cfg_.blocks[block_index];
+            const std::size_t end = std::min(cfg_block.end_index, cfg_.instructions.size());
+            for (std::size_t i = cfg_block.start_index; i < end; ++i) {
+                const auto* inst = cfg_.instructions[i];
                 if (inst == nullptr) {
                     continue;
                 }
@@ -438,6 +470,54 @@ private:
                         eval_stack.push_back(result);
                         break;
                     }
+                    case InstructionKind::MakeStruct: {
+                        if (inst->operands.size() < 2) {
+                            break;
+                        }
+                        const auto field_count = static_cast<std::size_t>(std::stoul(inst->operands[1]));
+                        if (eval_stack.size() < field_count) {
+                            break;
+                        }
+                        SsaInstruction out;
+                        out.opcode = "struct_make";
+                        out.arguments.resize(field_count);
+                        for (std::size_t i = field_count; i > 0; --i) {
+                            out.arguments[i - 1] = pop(eval_stack);
+                        }
+                        out.immediates.push_back(inst->operands[0]);
+                        const auto result = make_temporary();
+                        out.result = result;
+                        materialized.push_back(out);
+                        eval_stack.push_back(result);
+                        break;
+                    }
+                    case InstructionKind::FieldGet: {
+                        if (eval_stack.empty() || inst->operands.size() < 2) {
+                            break;
+                        }
+                        SsaInstruction out;
+                        out.opcode = "field_get";
+                        out.arguments.push_back(pop(eval_stack));
+                        out.immediates = inst->operands;
+                        const auto result = make_temporary();
+                        out.result = result;
+                        materialized.push_back(out);
+                        eval_stack.push_back(result);
+                        break;
+                    }
+                    case InstructionKind::FieldSet: {
+                        if (eval_stack.size() < 2 || inst->operands.size() < 2) {
+                            break;
+                        }
+                        const auto value = pop(eval_stack);
+                        const auto object = pop(eval_stack);
+                        SsaInstruction out;
+                        out.opcode = "field_set";
+                        out.arguments = {object, value};
+                        out.immediates = inst->operands;
+                        materialized.push_back(out);
+                        break;
+                    }
                     case InstructionKind::Label:
                     case InstructionKind::Comment:
                         break;
@@ -445,13 +525,8 @@ private:
             }
         }
 
-        // Set enum opcodes for fast dispatch (avoids string comparison in hot path)
         for (auto& inst : materialized) {
-            inst.op = impulse::ir::opcode_from_string(inst.opcode);
-            // For binary instructions, also set the binary operator enum
-            if (inst.op == impulse::ir::SsaOpcode::Binary && !inst.immediates.empty()) {
-                inst.binary_op = impulse::ir::binary_op_from_string(inst.immediates[0]);
-            }
+            impulse::ir::decode_operands(inst);
         }
 
         block.instructions = std::move(materialized);
@@ -477,16 +552,19 @@ private:
             }
         }
 
-        for (const auto child : block.dominator_children) {
-            rename_block(child);
-        }
+        return defined_symbols;
+    }
 
-        for (auto it = defined_symbols.rbegin(); it != defined_symbols.rend(); ++it) {
-            pop(*it);
+    // Symbol ids are dense, so the version stacks and counters are indexed by them
+    void reserve_symbol(SymbolId symbol) {
+        if (symbol >= stacks_.size()) {
+            stacks_.resize(symbol + 1);
+            counters_.resize(symbol + 1, 0);
         }
     }
 
     [[nodiscard]] auto next_version(SymbolId symbol) -> SsaValue {
+        reserve_symbol(symbol);
         auto& counter = counters_[symbol];
         counter += 1;
         stacks_[symbol].push_back(counter);
@@ -494,8 +572,8 @@ private:
     }
 
     void push_existing(const SsaValue& value) {
-        auto& stack = stacks_[value.symbol];
-        stack.push_back(value.version);
+        reserve_symbol(value.symbol);
+        stacks_[value.symbol].push_back(value.version);
         auto& counter = counters_[value.symbol];
         if (counter < value.version) {
             counter = value.version;
@@ -503,11 +581,10 @@ private:
     }
 
     [[nodiscard]] auto current(SymbolId symbol) const -> std::optional<SsaValue> {
-        const auto it = stacks_.find(symbol);
-        if (it == stacks_.end() || it->second.empty()) {
+        if (symbol >= stacks_.size() || stacks_[symbol].empty()) {
             return std::nullopt;
         }
-        return SsaValue{symbol, it->second.back()};
+        return SsaValue{symbol, stacks_[symbol].back()};
     }
 
     [[nodiscard]] auto make_temporary() -> SsaValue {
@@ -522,20 +599,17 @@ private:
     }
 
     void pop(SymbolId symbol) {
-        auto it = stacks_.find(symbol);
-        if (it == stacks_.end() || it->second.empty()) {
-            return;
+        if (symbol < stacks_.size() && !stacks_[symbol].empty()) {
+            stacks_[symbol].pop_back();
         }
-        it->second.pop_back();
     }
 
     const Function& function_;
     const ControlFlowGraph& cfg_;
     SsaFunction& ssa_;
     SymbolTable& symbols_;
-    std::unordered_map<SymbolId, std::vector<std::uint32_t>> stacks_;
-    std::unordered_map<SymbolId, std::uint32_t> counters_;
-    std::vector<std::vector<const Instruction*>> block_instructions_;
+    std::vector<std::vector<std::uint32_t>> stacks_;
+    std::vector<std::uint32_t> counters_;
 };
 
 }  // namespace
@@ -568,6 +642,7 @@ auto SsaFunction::find_symbol(const std::string& name) const -> const SsaSymbol*
 }
 
 auto impulse::ir::build_ssa(const Function& function, const ControlFlowGraph& cfg) -> SsaFunction {
+    constexpr std::size_t kNoBlock = std::numeric_limits<std::size_t>::max();
     SymbolTable symbol_table;
     for (const auto& parameter : function.parameters) {
         symbol_table.add_parameter(parameter);
@@ -602,83 +677,111 @@ auto impulse::ir::build_ssa(const Function& function, const ControlFlowGraph& cf
         ssa.blocks.push_back(std::move(block));
     }
 
-    std::vector<std::unordered_set<SymbolId>> existing_phi(ssa.blocks.size());
-    std::unordered_map<SymbolId, std::vector<std::size_t>> definition_sites;
-
-    std::unordered_map<const Instruction*, std::size_t> instruction_to_block;
-    for (std::size_t block_index = 0; block_index < cfg.blocks.size(); ++block_index) {
+    // Where each variable is stored, and where it is read before any store in the same block
+    // (upward-exposed). Ids are handed out to stored names in instruction order, as before.
+    const std::size_t block_count = ssa.blocks.size();
+    const auto block_range = [&](std::size_t block_index) {
         const auto& cfg_block = cfg.blocks[block_index];
-        for (std::size_t i = cfg_block.start_index; i < cfg_block.end_index && i < cfg.instructions.size(); ++i) {
-            const auto* inst = cfg.instructions[i];
-            if (inst == nullptr) {
-                continue;
-            }
-            instruction_to_block[inst] = block_index;
+        return std::pair{cfg_block.start_index, std::min(cfg_block.end_index, cfg.instructions.size())};
+    };
+    for (const auto* inst : cfg.instructions) {
+        if (inst != nullptr && inst->kind == InstructionKind::Store && !inst->operands.empty()) {
+            (void)symbol_table.get_or_create(inst->operands.front());
         }
     }
-
-    for (std::size_t block_index = 0; block_index < function.blocks.size(); ++block_index) {
-        const auto& source_block = function.blocks[block_index];
-        for (const auto& instruction : source_block.instructions) {
-            if (instruction.kind != InstructionKind::Store || instruction.operands.empty()) {
-                continue;
-            }
-            const std::string& name = instruction.operands.front();
-            const SymbolId id = symbol_table.get_or_create(name);
-            std::size_t ssa_index = block_index;
-            const auto it = instruction_to_block.find(&instruction);
-            if (it != instruction_to_block.end()) {
-                ssa_index = it->second;
-            } else {
-                const auto* cfg_block = cfg.find_block(source_block.label.empty() ? ssa.blocks[block_index].name
-                                                                                   : source_block.label);
-                if (cfg_block != nullptr) {
-                    ssa_index = static_cast<std::size_t>(cfg_block - cfg.blocks.data());
+    const std::size_t symbol_limit = symbol_table.symbols().size() + 1;
+    std::vector<std::vector<std::size_t>> definition_sites(symbol_limit);
+    std::vector<std::vector<std::size_t>> exposed_uses(symbol_limit);
+    {
+        std::vector<std::size_t> defined_in(symbol_limit, kNoBlock);  // last block seen storing it
+        for (std::size_t block_index = 0; block_index < block_count; ++block_index) {
+            const auto [begin, end] = block_range(block_index);
+            for (std::size_t i = begin; i < end; ++i) {
+                const auto* inst = cfg.instructions[i];
+                if (inst == nullptr || inst->operands.empty()) {
+                    continue;
+                }
+                if (inst->kind == InstructionKind::Store) {
+                    const SymbolId id = *symbol_table.find(inst->operands.front());
+                    if (defined_in[id] != block_index) {
+                        defined_in[id] = block_index;
+                        definition_sites[id].push_back(block_index);
+                    }
+                } else if (inst->kind == InstructionKind::Reference) {
+                    const auto id = symbol_table.find(inst->operands.front());
+                    if (id.has_value() && *id < symbol_limit && defined_in[*id] != block_index &&
+                        (exposed_uses[*id].empty() || exposed_uses[*id].back() != block_index)) {
+                        exposed_uses[*id].push_back(block_index);
+                    }
                 }
             }
-            definition_sites[id].push_back(ssa_index);
         }
     }
-
-    if (!ssa.blocks.empty()) {
+    if (block_count != 0) {
         for (const auto& parameter : function.parameters) {
             if (const auto symbol_id = symbol_table.find(parameter.name)) {
-                definition_sites[*symbol_id].push_back(0);
+                auto& sites = definition_sites[*symbol_id];
+                if (sites.empty() || sites.front() != 0) {
+                    sites.insert(sites.begin(), 0);
+                }
             }
         }
     }
 
-    for (auto& [symbol, sites] : definition_sites) {
-        std::vector<std::size_t> worklist;
-        worklist.reserve(sites.size());
-        std::unordered_set<std::size_t> visited;
+    // Pruned SSA: a variable gets a phi on its iterated dominance frontier only where it is live
+    // on entry, so stores nobody reads again (loop temporaries, dead updates) add no phis. Liveness
+    // is found per variable by walking back from its exposed uses, stopping at blocks that store it.
+    // The per-block marks hold the id of the variable that last set them, so they never need clearing.
+    std::vector<SymbolId> stores_it(block_count, 0);
+    std::vector<SymbolId> live_in(block_count, 0);
+    std::vector<SymbolId> has_phi(block_count, 0);
+    std::vector<SymbolId> queued(block_count, 0);
+    std::vector<std::size_t> worklist;
+    for (SymbolId symbol = 1; symbol < symbol_limit; ++symbol) {
+        const auto& sites = definition_sites[symbol];
+        if (sites.empty() || exposed_uses[symbol].empty()) {
+            continue;
+        }
         for (const auto site : sites) {
-            worklist.push_back(site);
-            visited.insert(site);
+            stores_it[site] = symbol;
+        }
+        worklist.clear();
+        for (const auto use : exposed_uses[symbol]) {
+            if (live_in[use] != symbol) {
+                live_in[use] = symbol;
+                worklist.push_back(use);
+            }
         }
-
         while (!worklist.empty()) {
             const std::size_t block_index = worklist.back();
             worklist.pop_back();
-
-            if (block_index >= dom_frontiers.size()) {
-                continue;
+            for (const auto predecessor : cfg.blocks[block_index].predecessors) {
+                if (predecessor < block_count && live_in[predecessor] != symbol && stores_it[predecessor] != symbol) {
+                    live_in[predecessor] = symbol;
+                    worklist.push_back(predecessor);
+                }
             }
+        }
 
+        worklist.assign(sites.begin(), sites.end());
+        for (const auto site : sites) {
+            queued[site] = symbol;
+        }
+        while (!worklist.empty()) {
+            const std::size_t block_index = worklist.back();
+            worklist.pop_back();
             for (const auto frontier_block : dom_frontiers[block_index]) {
-                if (frontier_block >= ssa.blocks.size()) {
+                if (frontier_block >= block_count || has_phi[frontier_block] == symbol ||
+                    live_in[frontier_block] != symbol) {
                     continue;
                 }
-                if (!existing_phi[frontier_block].emplace(symbol).second) {
-                    continue;
-                }
-
+                has_phi[frontier_block] = symbol;
                 PhiNode node;
                 node.symbol = symbol;
                 node.result = SsaValue{symbol, 0};
                 ssa.blocks[frontier_block].phi_nodes.push_back(std::move(node));
-
-                if (visited.insert(frontier_block).second) {
+                if (queued[frontier_block] != symbol) {
+                    queued[frontier_block] = symbol;
                     worklist.push_back(frontier_block);
                 }
             }
@@ -704,16 +807,92 @@ auto impulse::ir::build_ssa(const Function& function, const ControlFlowGraph& cf
     }
 
     ssa.symbols = symbol_table.symbols();
-    
-    // Build symbol index maps for O(1) lookup performance
-    for (const auto& symbol : ssa.symbols) {
-        ssa.symbol_id_index_[symbol.id] = &symbol;
+    index_symbols(ssa);
+    return ssa;
+}
+
+auto impulse::ir::parse_number_literal(const std::string& text) -> std::optional<double> {
+    if (text == "true") {
+        return 1.0;
+    }
+    if (text == "false") {
+        return 0.0;
+    }
+    std::string sanitized;
+    sanitized.reserve(text.size());
+    for (const char ch : text) {
+        if (ch != '_') {
+            sanitized.push_back(ch);
+        }
+    }
+    if (sanitized.empty()) {
+        return std::nullopt;
+    }
+    try {
+        std::size_t processed = 0;
+        const double value = std::stod(sanitized, &processed);
+        if (processed != sanitized.size() || !std::isfinite(value)) {
+            return std::nullopt;
+        }
+        return value;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+void impulse::ir::decode_operands(SsaInstruction& inst) {
+    inst.op = opcode_from_string(inst.opcode);
+    inst.binary_op = BinaryOp::Unknown;
+    inst.unary_op = UnaryOp::Unknown;
+    inst.number.reset();
+    switch (inst.op) {
+        case SsaOpcode::Binary:
+            if (!inst.immediates.empty()) {
+                inst.binary_op = binary_op_from_string(inst.immediates.front());
+            }
+            break;
+        case SsaOpcode::Unary:
+            if (!inst.immediates.empty()) {
+                inst.unary_op = unary_op_from_string(inst.immediates.front());
+            }
+            break;
+        case SsaOpcode::Literal:
+            if (!inst.immediates.empty()) {
+                inst.number = parse_number_literal(inst.immediates.front());
+            }
+            break;
+        case SsaOpcode::BranchIf:
+            if (inst.immediates.size() >= 2) {
+                inst.number = parse_number_literal(inst.immediates[1]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void impulse::ir::index_symbols(SsaFunction& function) {
+    // Symbol index maps for O(1) lookup performance
+    function.symbol_id_index_.clear();
+    function.symbol_name_index_.clear();
+    for (const auto& symbol : function.symbols) {
+        function.symbol_id_index_[symbol.id] = &symbol;
         if (!symbol.name.empty()) {
-            ssa.symbol_name_index_[symbol.name] = &symbol;
+            function.symbol_name_index_[symbol.name] = &symbol;
         }
     }
-    
-    return ssa;
+}
+
+void impulse::ir::compute_dominators(SsaFunction& function) {
+    const auto idom = compute_immediate_dominators(function);
+    const auto dom_tree = build_dominator_tree(idom);
+    const auto dom_frontiers = compute_dominance_frontiers(function, idom);
+    for (std::size_t index = 0; index < function.blocks.size(); ++index) {
+        auto& block = function.blocks[index];
+        block.immediate_dominator = idom[index];
+        block.dominator_children = dom_tree[index];
+        block.dominance_frontier = dom_frontiers[index];
+    }
 }
 
 auto impulse::ir::build_ssa(const Function& function) -> SsaFunction {
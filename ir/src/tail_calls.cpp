@@ -0,0 +1,210 @@
+#include "impulse/ir/tail_calls.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace impulse::ir {
+
+namespace {
+
+[[nodiscard]] auto same_value(const SsaValue& lhs, const SsaValue& rhs) -> bool {
+    return lhs.symbol == rhs.symbol && lhs.version == rhs.version;
+}
+
+// A fresh "%tN" temporary, numbered past those the function (or the inliner) already made
+[[nodiscard]] auto add_temporary(SsaFunction& function) -> SymbolId {
+    SymbolId id = 1;
+    std::size_t temporary = 0;
+    for (const auto& symbol : function.symbols) {
+        id = std::max(id, symbol.id + 1);
+        if (symbol.name.size() > 2 && symbol.name.compare(0, 2, "%t") == 0) {
+            const auto number = std::strtoull(symbol.name.c_str() + 2, nullptr, 10);
+            temporary = std::max(temporary, static_cast<std::size_t>(number) + 1);
+        }
+    }
+    function.symbols.push_back(SsaSymbol{id, "%t" + std::to_string(temporary), {}});
+    return id;
+}
+
+}  // namespace
+
+auto is_tail_call(const SsaBlock& block, std::size_t index) -> bool {
+    if (index + 1 >= block.instructions.size()) {
+        return false;
+    }
+    const auto& call = block.instructions[index];
+    const auto& next = block.instructions[index + 1];
+    return call.op == SsaOpcode::Call && call.result.has_value() && next.op == SsaOpcode::Return &&
+           next.arguments.size() == 1 && same_value(next.arguments.front(), *call.result);
+}
+
+auto eliminate_self_tail_calls(SsaFunction& function, const std::vector<std::string>& parameters) -> std::size_t {
+    if (function.blocks.empty() || !function.blocks.front().predecessors.empty() ||
+        !function.blocks.front().phi_nodes.empty()) {
+        return 0;
+    }
+
+    // Blocks ending in a self tail call, with the call's position
+    std::vector<std::pair<std::size_t, std::size_t>> sites;
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+        const auto& instructions = function.blocks[b].instructions;
+        for (std::size_t i = 0; i < instructions.size(); ++i) {
+            if (is_tail_call(function.blocks[b], i) && !instructions[i].immediates.empty() &&
+                instructions[i].immediates.front() == function.name &&
+                instructions[i].arguments.size() == parameters.size()) {
+                sites.emplace_back(b, i);
+                break;
+            }
+        }
+    }
+    if (sites.empty()) {
+        return 0;
+    }
+
+    // Parameters nothing reads have no symbol and get no phi
+    std::vector<std::optional<SymbolId>> symbols;
+    std::unordered_map<SymbolId, std::uint32_t> next_version;
+    for (const auto& name : parameters) {
+        const auto it = std::find_if(function.symbols.begin(), function.symbols.end(),
+                                     [&](const SsaSymbol& symbol) { return symbol.name == name; });
+        symbols.push_back(it != function.symbols.end() ? std::optional<SymbolId>(it->id) : std::nullopt);
+        if (it != function.symbols.end()) {
+            next_version.emplace(it->id, 2);
+        }
+    }
+    // A read by name would see the first call's arguments, not the phi
+    const auto note = [&](const SsaValue& value) -> bool {
+        const auto it = next_version.find(value.symbol);
+        if (it == next_version.end()) {
+            return true;
+        }
+        it->second = std::max(it->second, value.version + 1);
+        return value.version != 0;
+    };
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            note(phi.result);
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value() && !note(*input.value)) {
+                    return 0;
+                }
+            }
+        }
+        for (const auto& inst : block.instructions) {
+            if (!std::all_of(inst.arguments.begin(), inst.arguments.end(), note)) {
+                return 0;
+            }
+            if (inst.result.has_value()) {
+                note(*inst.result);
+            }
+        }
+    }
+
+    // The old entry moves to index 1 and becomes the loop header
+    for (auto& block : function.blocks) {
+        ++block.id;
+        for (auto& successor : block.successors) {
+            ++successor;
+        }
+        for (auto& predecessor : block.predecessors) {
+            ++predecessor;
+        }
+        for (auto& phi : block.phi_nodes) {
+            for (auto& input : phi.inputs) {
+                ++input.predecessor;
+            }
+        }
+    }
+    SsaBlock entry;
+    entry.id = 0;
+    entry.name = "tail.entry";
+    SsaInstruction jump;
+    jump.op = SsaOpcode::Branch;
+    jump.opcode = "branch";
+    jump.immediates.push_back(function.blocks.front().name);
+    entry.instructions.push_back(std::move(jump));
+    entry.successors.push_back(1);
+    function.blocks.insert(function.blocks.begin(), std::move(entry));
+    SsaBlock& header = function.blocks[1];
+    header.predecessors.push_back(0);
+
+    // Every read of a parameter's entry value now reads its phi
+    std::unordered_map<SymbolId, SsaValue> renamed;
+    for (const auto& symbol : symbols) {
+        if (symbol.has_value()) {
+            renamed.emplace(*symbol, SsaValue{*symbol, next_version.at(*symbol)});
+        }
+    }
+    const auto rename = [&](SsaValue& value) {
+        const auto it = renamed.find(value.symbol);
+        if (it != renamed.end() && value.version == 1) {
+            value = it->second;
+        }
+    };
+    for (auto& block : function.blocks) {
+        for (auto& phi : block.phi_nodes) {
+            for (auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    rename(*input.value);
+                }
+            }
+        }
+        for (auto& inst : block.instructions) {
+            std::for_each(inst.arguments.begin(), inst.arguments.end(), rename);
+        }
+    }
+    for (std::size_t p = 0; p < symbols.size(); ++p) {
+        if (!symbols[p].has_value()) {
+            continue;
+        }
+        PhiNode phi;
+        phi.result = renamed.at(*symbols[p]);
+        phi.symbol = *symbols[p];
+        phi.inputs.push_back(PhiInput{0, SsaValue{*symbols[p], 1}});
+        header.phi_nodes.push_back(std::move(phi));
+    }
+
+    // Each call becomes a jump to the header, its arguments the phis' inputs on that edge. An
+    // argument that is itself one of the phis goes through a copy first, since the interpreter
+    // assigns the phis of a block in order.
+    const std::string header_name = header.name;
+    for (const auto& [index, call_index] : sites) {
+        const std::size_t b = index + 1;
+        SsaInstruction call = std::move(function.blocks[b].instructions[call_index]);
+        function.blocks[b].instructions.resize(call_index);
+        std::size_t phi = 0;
+        for (std::size_t p = 0; p < symbols.size(); ++p) {
+            if (!symbols[p].has_value()) {
+                continue;
+            }
+            SsaValue argument = call.arguments[p];
+            if (std::any_of(function.blocks[1].phi_nodes.begin(), function.blocks[1].phi_nodes.end(),
+                            [&](const PhiNode& node) { return same_value(node.result, argument); })) {
+                SsaInstruction copy;
+                copy.op = SsaOpcode::Assign;
+                copy.opcode = "assign";
+                copy.arguments.push_back(argument);
+                argument = SsaValue{add_temporary(function), 1};
+                copy.result = argument;
+                function.blocks[b].instructions.push_back(std::move(copy));
+            }
+            function.blocks[1].phi_nodes[phi++].inputs.push_back(PhiInput{b, argument});
+        }
+        SsaInstruction branch;
+        branch.op = SsaOpcode::Branch;
+        branch.opcode = "branch";
+        branch.immediates.push_back(header_name);
+        function.blocks[b].instructions.push_back(std::move(branch));
+        function.blocks[b].successors = {1};
+        function.blocks[1].predecessors.push_back(b);
+    }
+
+    compute_dominators(function);
+    index_symbols(function);
+    return sites.size();
+}
+
+}  // namespace impulse::ir
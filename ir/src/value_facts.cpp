@@ -0,0 +1,164 @@
+#include "impulse/ir/value_facts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "impulse/ir/liveness.h"
+
+namespace impulse::ir {
+
+namespace {
+
+constexpr double kMaxExactInteger = 9007199254740992.0;  // 2^53
+
+struct Definition {
+    std::uint64_t key = 0;
+    const PhiNode* phi = nullptr;
+    const SsaInstruction* inst = nullptr;
+};
+
+using ValueSet = std::unordered_set<std::uint64_t>;
+
+[[nodiscard]] auto member(const ValueSet& set, const SsaValue& value) -> bool {
+    return value.version != 0 && set.count(encode_ssa_value(value)) != 0;
+}
+
+[[nodiscard]] auto phi_inputs_in(const PhiNode& phi, const ValueSet& set) -> bool {
+    return std::all_of(phi.inputs.begin(), phi.inputs.end(),
+                       [&](const PhiInput& input) { return input.value.has_value() && member(set, *input.value); });
+}
+
+[[nodiscard]] auto produces_number(const SsaInstruction& inst) -> bool {
+    switch (inst.op) {
+        case SsaOpcode::Literal:
+            return inst.number.has_value();
+        case SsaOpcode::Assign:
+        case SsaOpcode::Unary:
+        case SsaOpcode::Binary:
+        case SsaOpcode::ArrayLength:
+            return true;
+        default:
+            return false;
+    }
+}
+
+[[nodiscard]] auto produces_integer(const SsaInstruction& inst) -> bool {
+    switch (inst.op) {
+        case SsaOpcode::Literal: {
+            const auto& value = inst.number;
+            return value.has_value() && std::floor(*value) == *value && std::abs(*value) <= kMaxExactInteger;
+        }
+        case SsaOpcode::Assign:
+        case SsaOpcode::ArrayLength:
+            return true;
+        case SsaOpcode::Unary:
+            return inst.unary_op == UnaryOp::Neg;
+        case SsaOpcode::Binary:
+            return inst.binary_op == BinaryOp::Add || inst.binary_op == BinaryOp::Sub ||
+                   inst.binary_op == BinaryOp::Mul;
+        default:
+            return false;
+    }
+}
+
+[[nodiscard]] auto inputs_numeric(const Definition& definition, const ValueSet& numbers) -> bool {
+    if (definition.phi != nullptr) {
+        return phi_inputs_in(*definition.phi, numbers);
+    }
+    const auto& inst = *definition.inst;
+    if (inst.op == SsaOpcode::Assign || (inst.op == SsaOpcode::Binary && inst.binary_op == BinaryOp::Add)) {
+        return std::all_of(inst.arguments.begin(), inst.arguments.end(),
+                           [&](const SsaValue& value) { return member(numbers, value); });
+    }
+    return true;
+}
+
+[[nodiscard]] auto inputs_integral(const Definition& definition, const ValueSet& integers) -> bool {
+    if (definition.phi != nullptr) {
+        return phi_inputs_in(*definition.phi, integers);
+    }
+    if (definition.inst->op == SsaOpcode::ArrayLength) {
+        return true;
+    }
+    return std::all_of(definition.inst->arguments.begin(), definition.inst->arguments.end(),
+                       [&](const SsaValue& value) { return member(integers, value); });
+}
+
+template <typename Keep>
+void refine(const std::vector<Definition>& definitions, ValueSet& set, Keep keep) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& definition : definitions) {
+            if (set.count(definition.key) != 0 && !keep(definition)) {
+                set.erase(definition.key);
+                changed = true;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+ValueFacts::ValueFacts(const SsaFunction& function) {
+    std::vector<Definition> definitions;
+    ValueSet defined;
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            definitions.push_back(Definition{encode_ssa_value(phi.result), &phi, nullptr});
+            defined.insert(encode_ssa_value(phi.result));
+        }
+        for (const auto& inst : block.instructions) {
+            if (!inst.result.has_value()) {
+                continue;
+            }
+            const std::uint64_t key = encode_ssa_value(*inst.result);
+            definitions.push_back(Definition{key, nullptr, &inst});
+            defined.insert(key);
+            if (inst.op == SsaOpcode::Literal && inst.number.has_value()) {
+                constants_[key] = *inst.number;
+            }
+        }
+    }
+    for (const auto& symbol : function.symbols) {
+        const bool numeric_type = symbol.type == "int" || symbol.type == "float" || symbol.type == "bool";
+        const std::uint64_t parameter = encode_ssa_value(SsaValue{symbol.id, 1});
+        if (numeric_type && defined.count(parameter) == 0) {
+            numbers_.insert(parameter);
+        }
+    }
+
+    for (const auto& definition : definitions) {
+        if (definition.phi != nullptr || produces_number(*definition.inst)) {
+            numbers_.insert(definition.key);
+        }
+        if (definition.phi != nullptr || produces_integer(*definition.inst)) {
+            integers_.insert(definition.key);
+        }
+    }
+    refine(definitions, numbers_, [&](const Definition& definition) { return inputs_numeric(definition, numbers_); });
+    refine(definitions, integers_,
+           [&](const Definition& definition) { return inputs_integral(definition, integers_); });
+}
+
+auto ValueFacts::numeric(const SsaValue& value) const -> bool { return member(numbers_, value); }
+
+auto ValueFacts::integral(const SsaValue& value) const -> bool {
+    return numeric(value) && member(integers_, value);
+}
+
+auto ValueFacts::constant(const SsaValue& value) const -> std::optional<double> {
+    const auto it = constants_.find(encode_ssa_value(value));
+    if (value.version == 0 || it == constants_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+auto ValueFacts::safe_divisor(const SsaValue& value) const -> bool {
+    const auto divisor = constant(value);
+    return divisor.has_value() && std::abs(*divisor) >= kEpsilon;
+}
+
+}  // namespace impulse::ir
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::jit {
+
+// AArch64 condition codes, as b.cond and cset encode them
+enum class Arm64Condition : std::uint8_t {
+    Eq = 0x0,
+    Ne = 0x1,
+    Hs = 0x2,
+    Lo = 0x3,
+    Mi = 0x4,
+    Pl = 0x5,
+    Vs = 0x6,
+    Vc = 0x7,
+    Hi = 0x8,
+    Ls = 0x9,
+    Ge = 0xA,
+    Lt = 0xB,
+    Gt = 0xC,
+    Le = 0xD,
+};
+
+// Encodes A64 instructions into a word stream. Plain byte output, so code for AArch64 hosts can
+// be generated (and checked) anywhere. Register numbers are 0-31; 31 is sp or the zero register,
+// whichever the instruction means by it. Branches name labels and are patched by finish().
+class Arm64Assembler {
+public:
+    static constexpr int kSp = 31;
+    static constexpr int kZr = 31;
+    static constexpr int kFp = 29;
+
+    // AAPCS64 frame: stp x29, x30, [sp, #-16]!; mov x29, sp; sub sp, sp, #frame_bytes
+    // (a multiple of 16 below 16 MiB)
+    void prologue(std::uint32_t frame_bytes);
+    // mov sp, x29; ldp x29, x30, [sp], #16; ret
+    void epilogue();
+
+    // Loads and stores of a double (or x register) at [base + offset], offset a multiple of 8
+    // below 32 KiB
+    void ldr_d(int dt, int base, std::uint32_t offset);
+    void str_d(int dt, int base, std::uint32_t offset);
+    void str_x(int xt, int base, std::uint32_t offset);
+
+    void fadd(int dd, int dn, int dm);
+    void fsub(int dd, int dn, int dm);
+    void fmul(int dd, int dn, int dm);
+    void fdiv(int dd, int dn, int dm);
+    void fneg(int dd, int dn);
+    void fmov(int dd, int dn);       // d register copy
+    void fmov_dx(int dd, int xn);    // dd = bits of xn
+    void fcmp(int dn, int dm);
+    void fcmp_zero(int dn);          // fcmp dn, #0.0
+
+    void mov_imm64(int xd, std::uint64_t value);  // movz plus a movk per further nonzero half
+    void cset(int wd, Arm64Condition condition);
+    void ucvtf(int dd, int wn);                   // dd = (double)(uint32)wn
+    void and_w(int wd, int wn, int wm);
+    void orr_w(int wd, int wn, int wm);
+
+    [[nodiscard]] auto new_label() -> std::size_t;
+    void bind(std::size_t label);
+    void b(std::size_t label);
+    void b_cond(Arm64Condition condition, std::size_t label);
+
+    // The code as bytes, branches patched; nullopt when a label was never bound or a b.cond
+    // target is out of its +-1 MiB range
+    [[nodiscard]] auto finish() const -> std::optional<std::vector<std::uint8_t>>;
+    [[nodiscard]] auto words() const -> const std::vector<std::uint32_t>& { return words_; }
+
+private:
+    struct Fixup {
+        std::size_t word = 0;
+        std::size_t label = 0;
+        bool conditional = false;
+    };
+
+    void emit(std::uint32_t word) { words_.push_back(word); }
+    void add_sub_sp(bool subtract, int rd, int rn, std::uint32_t imm12, bool shifted);
+
+    static constexpr std::size_t kUnbound = static_cast<std::size_t>(-1);
+
+    std::vector<std::uint32_t> words_;
+    std::vector<std::size_t> labels_;  // word index of each label, kUnbound until bound
+    std::vector<Fixup> fixups_;
+};
+
+// Compiles `function` for AArch64 with the JitFunction convention (x0 points at the arguments,
+// the result comes back in d0). Covers numeric code only: literals, assignments, + - *, / by a
+// nonzero constant, comparisons, && ||, unary - and !, branches and phis. Every value lives in a
+// stack slot of its own; comparisons and && || treat NaN as the interpreter does. `parameters`
+// maps each parameter's entry value to its argument index. Nullopt for anything else (calls,
+// arrays, structs, %, / by a variable, globals), which then stays with the interpreter.
+[[nodiscard]] auto compile_arm64(const ir::SsaFunction& function,
+                                 const std::vector<std::pair<ir::SsaValue, int>>& parameters)
+    -> std::optional<std::vector<std::uint8_t>>;
+
+}  // namespace impulse::jit
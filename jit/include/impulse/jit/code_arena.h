@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace impulse::jit {
+
+// Executable memory shared by many compiled functions. Functions are bump-allocated, packed at
+// kFunctionAlignment, into large regions mapped once. Pages are never writable and executable
+// at the same time. Where the system allows it (Linux memfd) each region is mapped twice, once
+// read-execute and once read-write, and code is copied in through the writable view, so
+// installing never changes the protection of code another thread may be running. Elsewhere
+// installing flips the pages it touches to read-write, copies, and flips them back to
+// read-execute. Several threads may install at once. Everything is unmapped together when the
+// arena is destroyed, so code installed here must not outlive it.
+class JitCodeArena {
+public:
+    static constexpr std::size_t kRegionBytes = std::size_t{256} * std::size_t{1024};
+    static constexpr std::size_t kFunctionAlignment = 16;
+
+    JitCodeArena() = default;
+    ~JitCodeArena();
+
+    JitCodeArena(const JitCodeArena&) = delete;
+    auto operator=(const JitCodeArena&) -> JitCodeArena& = delete;
+    JitCodeArena(JitCodeArena&&) = delete;
+    auto operator=(JitCodeArena&&) -> JitCodeArena& = delete;
+
+    // Copies `code` into executable memory; returns its address, or nullptr if memory could not
+    // be mapped or protected
+    [[nodiscard]] auto install(const std::vector<std::uint8_t>& code) -> void*;
+
+    [[nodiscard]] auto function_count() const -> std::size_t;
+    [[nodiscard]] auto bytes_used() const -> std::size_t;
+    [[nodiscard]] auto bytes_reserved() const -> std::size_t;
+    [[nodiscard]] auto region_count() const -> std::size_t;
+
+private:
+    struct Region {
+        unsigned char* base = nullptr;   // where the code runs
+        unsigned char* write = nullptr;  // writable view of the same memory; null if single-mapped
+        std::size_t size = 0;
+        std::size_t used = 0;
+    };
+
+    [[nodiscard]] auto add_region(std::size_t min_bytes) -> Region*;
+
+    mutable std::mutex mutex_;  // guards everything below
+    std::vector<Region> regions_;
+    std::size_t function_count_ = 0;
+};
+
+}  // namespace impulse::jit
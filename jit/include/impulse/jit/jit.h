@@ -1,19 +1,194 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "impulse/ir/bounds.h"
 #include "impulse/ir/ssa.h"
+#include "impulse/ir/value_facts.h"
+#include "impulse/jit/code_arena.h"
+#include "impulse/jit/osr.h"
+#include "impulse/jit/register_allocator.h"
+#include "impulse/jit/vectorize.h"
 
 namespace impulse::jit {
 
 // JIT compiled function signature: takes array of doubles, returns double
 using JitFunction = double (*)(double*);
 
+struct JitCallTable;
+
+// Slow path for calls whose callee has no native entry yet: (table, callee slot, args) -> result
+using JitTrampoline = double (*)(JitCallTable*, std::uint64_t, double*);
+
+// Runtime errors raised by inline checks in compiled code
+enum class JitTrap : std::uint64_t {
+    ArrayGetNotArray,
+    ArrayGetBadIndex,
+    ArrayGetOutOfBounds,
+    ArrayGetNotNumeric,
+    ArraySetNotArray,
+    ArraySetBadIndex,
+    ArraySetOutOfBounds,
+    ArrayLengthNotArray,
+    ModuloBadOperands,
+    FieldGetNotStruct,
+    FieldSetNotStruct,
+    DivisionByZero,
+};
+
+// Reports a trap to the runtime; compiled code then unwinds exactly as for a failed call
+using JitTrapHandler = void (*)(JitCallTable*, std::uint64_t);
+
+// What a call returns to compiled code when the callee failed: the trampoline returns it, and
+// compiled code checks every call result for it and returns it straight on to its own caller.
+// It is a signalling NaN, which arithmetic never produces (NaN results are quiet) and number
+// parsing never yields, so no program value can be mistaken for it. Keeping the signal in the
+// return value rather than the call table lets several threads run a module's code at once.
+inline constexpr std::uint64_t kJitUnwindBits = 0x7FF00000DEAD0001ULL;
+[[nodiscard]] auto jit_unwind_value() -> double;
+[[nodiscard]] auto is_jit_unwind(double value) -> bool;
+
+// Memory layout of the runtime's array objects, so compiled code can index them inline.
+// Array values travel through compiled code as the raw object pointer bits in a double slot.
+// Boxed arrays lay their elements out contiguously between the pointers at
+// elements_begin/elements_end; Float64 arrays keep raw doubles between numbers_begin/numbers_end,
+// with never-assigned elements holding hole_bits. Struct instances are carried the same way; their
+// numeric fields are raw doubles at fixed offsets from struct_numbers (see JitStructLayout).
+struct JitArrayLayout {
+    bool available = false;  // false when the runtime could not describe its layout
+    int32_t object_kind = 0;        // offset of the object kind byte
+    std::uint8_t array_kind = 0;    // kind byte value of boxed arrays
+    std::uint8_t float64_kind = 0;  // kind byte value of Float64 arrays
+    int32_t numbers_begin = 0;      // offset of the pointer to the first double
+    int32_t numbers_end = 0;        // offset of the pointer one past the last double
+    std::uint64_t hole_bits = 0;    // bit pattern of a Float64 element that reads as nil
+    int32_t elements_begin = 0;   // offset of the pointer to the first element
+    int32_t elements_end = 0;     // offset of the pointer one past the last element
+    int32_t element_size = 0;
+    int32_t value_kind = 0;        // offset of the kind byte inside an element
+    std::uint8_t number_kind = 0;  // kind byte value of numbers
+    int32_t value_number = 0;      // offset of the double payload inside an element
+    int32_t value_object = 0;      // offset of the object pointer inside an element (may equal value_number)
+    std::uint8_t struct_kind = 0;  // kind byte value of struct instances
+    int32_t object_shape = 0;      // offset of a struct's 32-bit shape
+    int32_t struct_numbers = 0;    // offset of a struct's first numeric field
+};
+
+// A struct's numeric fields, for inline field_get / field_set: an instance has `shape` and keeps
+// field `slot` at JitArrayLayout::struct_numbers + 8 * slot. Other fields stay interpreted.
+struct JitStructLayout {
+    std::uint32_t shape = 0;
+    std::unordered_map<std::string, std::uint32_t> numeric_fields;  // field name -> slot
+};
+
+// Runtime functions compiled code calls directly rather than through the call table: the
+// kernels behind the numeric array builtins. Each has the JitFunction signature, taking the
+// outgoing arguments (arrays as object pointer bits). It returns its number, the array argument
+// it updated, or kJitUnwindBits after reporting a failure to the runtime as the trampoline does.
+enum class JitNative : std::uint8_t {
+    ArraySum,
+    ArrayDot,
+    ArrayMin,
+    ArrayMax,
+    ArrayScale,
+    ArrayAxpy,
+    ArrayCopy,
+    ArrayFill,
+    ArraySort,
+    ArrayBinarySearch,
+};
+inline constexpr std::size_t kJitNativeCount = 10;
+
+struct JitNativeSignature {
+    JitNative id = JitNative::ArraySum;
+    const char* callee = "";             // the builtin it implements
+    std::size_t arity = 0;
+    std::uint32_t array_arguments = 0;   // bit i set: argument i is an array
+    int returned_argument = -1;          // the array argument it returns; -1: returns a number
+};
+
+// The native behind builtin `callee`; nullptr when calls to it cannot be compiled
+[[nodiscard]] auto find_jit_native(const std::string& callee) -> const JitNativeSignature*;
+
+// Math builtins compiled code evaluates without leaving native code: sqrt and abs inline,
+// floor and ceil inline with SSE4.1 (roundsd), and the others as direct calls to the C library
+// functions the interpreter uses, so both give bit-identical results.
+enum class JitMath : std::uint8_t {
+    Sqrt,
+    Abs,
+    Floor,
+    Ceil,
+    Round,
+    Sin,
+    Cos,
+    Tan,
+    Exp,
+    Log,
+    Log10,
+    Pow,
+};
+inline constexpr std::size_t kJitMathCount = 12;
+
+struct JitMathSignature {
+    JitMath id = JitMath::Sqrt;
+    const char* callee = "";  // the builtin it implements, without the std::math:: prefix
+    std::size_t arity = 1;
+};
+
+// The math builtin `callee` names ("sqrt" or "std::math::sqrt"); nullptr for anything else
+[[nodiscard]] auto find_jit_math(const std::string& callee) -> const JitMathSignature*;
+// The C library function compiled code calls for `id`: double(double), or double(double, double) for Pow
+[[nodiscard]] auto jit_math_function(JitMath id) -> const void*;
+
+// Runtime linkage shared by every compiled function of a module.
+// Compiled `call` instructions load entries[slot] and call it directly; a null entry routes the
+// call through `trampoline` instead, which lets the runtime compile the callee and patch its slot.
+// `entries` is sized once when the table is created and must never reallocate afterwards,
+// because generated code embeds the address of each slot. Entries are atomic so the runtime can
+// publish a callee while other threads run code that reads its slot.
+struct JitCallTable {
+    std::vector<std::atomic<JitFunction>> entries;
+    std::unordered_map<std::string, std::size_t> slots;  // function name -> index into entries
+    JitTrampoline trampoline = nullptr;
+    JitTrapHandler trap = nullptr;
+    JitArrayLayout arrays;
+    std::array<JitFunction, kJitNativeCount> natives{};  // by JitNative; null ones are not compiled
+    JitCodeArena* code = nullptr;  // where compiled functions are installed; null: own pages each
+    void* owner = nullptr;  // opaque context for the trampoline and trap handler
+    // Module globals compiled code reads by name. const and let values are folded into the code
+    // as immediates; var values are loaded from globals[slot], which is sized once like `entries`.
+    std::unordered_map<std::string, double> constants;
+    std::vector<double> globals;
+    std::unordered_map<std::string, std::size_t> global_slots;  // global name -> index into globals
+    std::unordered_map<std::string, JitStructLayout> structs;   // the module's structs by name
+};
+
+// Absolute addresses embedded in generated code, recorded so the code can be saved and linked
+// against another module's call table later (see link_code)
+enum class JitRelocationKind : std::uint8_t {
+    CallTable,    // the JitCallTable itself, plus `addend` bytes
+    CallEntry,    // entries[addend]
+    Trampoline,   // the table's trampoline
+    TrapHandler,  // the table's trap handler
+    Native,       // natives[addend]
+    Math,         // jit_math_function(addend)
+    Global,       // globals[addend]
+};
+
+struct JitRelocation {
+    std::uint32_t offset = 0;  // position of the 8-byte immediate within the code
+    JitRelocationKind kind = JitRelocationKind::CallTable;
+    std::uint64_t addend = 0;
+};
+
 // Memory region for executable code
 class CodeBuffer {
 public:
@@ -41,11 +216,35 @@ public:
     void emit_movsd_xmm_mem(int xmm, int base_reg, int32_t offset);
     void emit_movsd_mem_xmm(int base_reg, int32_t offset, int xmm);
     void emit_movsd_xmm_xmm(int dst, int src);
+    void emit_movapd(int dst, int src);          // full register copy, no merge dependency
+    void emit_xorpd(int dst, int src);
+    void emit_movq_xmm_reg(int xmm, int reg);    // movq xmm, r64
+    void emit_movq_reg_xmm(int reg, int xmm);    // movq r64, xmm
+    void emit_cvtsi2sd(int xmm, int reg);        // xmm = (double)r64
+    void emit_cvttsd2si(int reg, int xmm);       // r64 = (int64)xmm, truncating
     
     void emit_addsd(int dst, int src);
     void emit_subsd(int dst, int src);
     void emit_mulsd(int dst, int src);
     void emit_divsd(int dst, int src);
+    void emit_sqrtsd(int dst, int src);
+    void emit_andpd(int dst, int src);
+    void emit_roundsd(int dst, int src, uint8_t mode);  // SSE4.1; mode 9 = floor, 10 = ceil, no inexact
+
+    // Packed doubles in YMM registers (AVX, AVX2 where noted): dst = lhs op rhs, lane by lane
+    void emit_vaddpd(int dst, int lhs, int rhs);
+    void emit_vsubpd(int dst, int lhs, int rhs);
+    void emit_vmulpd(int dst, int lhs, int rhs);
+    void emit_vdivpd(int dst, int lhs, int rhs);
+    void emit_vxorpd(int dst, int lhs, int rhs);
+    void emit_vunpckhpd(int dst, int lhs, int rhs);          // high doubles of each 128-bit half
+    void emit_vcmppd(int dst, int lhs, int rhs, uint8_t predicate);  // all-ones lanes where it holds; 3 = unordered
+    void emit_vmovupd_load(int ymm, int base_reg, int index_reg);   // ymm = [base + index * 8]
+    void emit_vmovupd_store(int base_reg, int index_reg, int ymm);  // [base + index * 8] = ymm
+    void emit_vbroadcastsd(int ymm, int xmm);                // AVX2; every lane = low double of xmm
+    void emit_vptest(int lhs, int rhs);                      // ZF = (lhs & rhs) == 0
+    void emit_vextractf128(int xmm, int ymm, uint8_t half);  // xmm = 128-bit half of ymm
+    void emit_vzeroupper();
     
     // Comparison
     void emit_ucomisd(int xmm1, int xmm2);
@@ -55,34 +254,78 @@ public:
     void emit_setbe(int reg8);  // unsigned below or equal (<=)
     void emit_sete(int reg8);   // equal (==)
     void emit_setne(int reg8);  // not equal (!=)
+    void emit_setp(int reg8);   // parity (unordered)
+    void emit_setnp(int reg8);  // no parity (ordered)
     
     // Integer operations
     void emit_mov_reg_imm64(int reg, int64_t imm);
+    // mov reg, imm64 of `address`, recorded as a relocation against the call table
+    void emit_mov_reg_address(int reg, const void* address, JitRelocationKind kind, std::uint64_t addend = 0);
     void emit_mov_reg_mem(int reg, int base_reg, int32_t offset);
     void emit_mov_mem_reg(int base_reg, int32_t offset, int reg);
+    void emit_mov_reg_reg(int dst, int src);
     void emit_xor_reg_reg(int dst, int src);
+    void emit_add_reg_reg(int dst, int src);
+    void emit_sub_reg_reg(int dst, int src);
+    void emit_cmp_reg_reg(int lhs, int rhs);
+    void emit_imul_reg_reg(int dst, int src);
+    void emit_imul_reg_imm32(int dst, int32_t imm);          // dst = dst * imm
+    void emit_div_reg(int reg);                              // rax, rdx = rdx:rax / reg, unsigned
+    void emit_shr_reg_imm8(int reg, uint8_t imm);
+    void emit_cmp_byte_mem_imm(int base_reg, int32_t offset, uint8_t imm);
+    void emit_cmp_dword_mem_imm(int base_reg, int32_t offset, uint32_t imm);
+    void emit_mov_byte_mem_imm(int base_reg, int32_t offset, uint8_t imm);
     
     // Control flow
     void emit_jmp_rel32(int32_t offset);
     void emit_jne_rel32(int32_t offset);
     void emit_je_rel32(int32_t offset);
+    void emit_jcc_rel32(uint8_t condition, int32_t offset);  // 0F <condition> rel32, e.g. 0x83 = jae
+    void emit_jmp_rel8(int8_t offset);
+    void emit_jcc_rel8(uint8_t condition, int8_t offset);    // same condition byte as the rel32 form
+    void emit_nops(std::size_t count);                       // multi-byte NOPs filling `count` bytes
     void emit_test_reg_reg(int reg1, int reg2);
+    void emit_call_reg(int reg);                            // call r64
+    void emit_jmp_reg(int reg);                             // jmp r64
+    void emit_lea_reg_mem(int reg, int base_reg, int32_t offset);
     
     // Get current position for patching
     [[nodiscard]] auto position() const -> size_t;
     
     // Patch a relative offset at a given position
     void patch_rel32(size_t pos, int32_t offset);
+    void patch_rel8(size_t pos, int8_t offset);
     
-    // Finalize and make executable
-    [[nodiscard]] auto finalize() -> JitFunction;
+    // Finalize and make executable: installed into `arena` when given (which then owns the
+    // code), otherwise into pages owned by this buffer
+    [[nodiscard]] auto finalize(JitCodeArena* arena = nullptr) -> JitFunction;
+
+    // The generated bytes (still available after finalize) and their relocations
+    [[nodiscard]] auto code() const -> const std::vector<uint8_t>& { return code_; }
+    [[nodiscard]] auto relocations() const -> const std::vector<JitRelocation>& { return relocations_; }
 
 private:
+    // prefix [REX] 0F opcode ModRM(reg-reg); REX.W added when wide is set
+    void emit_sse_rr(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide = false);
+    // REX.W opcode ModRM(reg-reg) for the two-operand integer ALU forms (dst is ModRM.rm)
+    void emit_alu_rr(uint8_t opcode, int dst, int src);
+    // 256-bit C4 RXB.map W.vvvv.L.pp opcode ModRM with pp = 66: ModRM.rm is register `rm`, or the
+    // memory operand [rm + index * 8] when index >= 0
+    void emit_vex(uint8_t map, uint8_t opcode, int reg, int vvvv, int rm, int index = -1);
+    // opcode /extension [base_reg + disp32], imm8
+    void emit_byte_mem_imm(uint8_t opcode, int extension, int base_reg, int32_t offset, uint8_t imm);
+
     std::vector<uint8_t> code_;
+    std::vector<JitRelocation> relocations_;
     void* executable_ = nullptr;
     size_t executable_size_ = 0;
 };
 
+// Installs previously generated code into `table.code` with its relocations applied against
+// `table`; returns nullptr when a relocation does not fit the table or the code cannot be mapped
+[[nodiscard]] auto link_code(std::vector<uint8_t> code, const std::vector<JitRelocation>& relocations,
+                             JitCallTable& table) -> JitFunction;
+
 // Register allocation
 enum class Register : int {
     RAX = 0, RCX = 1, RDX = 2, RBX = 3,
@@ -105,20 +348,60 @@ public:
     
     // Compile an SSA function to native code
     // parameter_names: names of parameters in order (to map to args array indices)
-    [[nodiscard]] auto compile(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names) -> JitFunction;
+    // calls: linkage for `call` instructions; functions containing calls fail to compile without it
+    [[nodiscard]] auto compile(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names,
+                               JitCallTable* calls = nullptr) -> JitFunction;
     
     // Compile and return both the function and the code buffer (for caching)
     // parameter_names: names of parameters in order (to map to args array indices)
-    [[nodiscard]] auto compile_with_buffer(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names) -> std::pair<JitFunction, CodeBuffer>;
+    // Other symbols read before any definition are module globals taken from `calls`
+    [[nodiscard]] auto compile_with_buffer(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names,
+                                           JitCallTable* calls = nullptr) -> std::pair<JitFunction, CodeBuffer>;
+
+    // Compile the loop described by `plan` as an on-stack replacement entry (see OsrPlan for the
+    // state array it takes). Jumps out of the loop become exits back to the interpreter.
+    [[nodiscard]] auto compile_osr_with_buffer(const ir::SsaFunction& function, const OsrPlan& plan,
+                                               JitCallTable* calls = nullptr) -> std::pair<JitFunction, CodeBuffer>;
     
     // Check if JIT is supported on this platform
     [[nodiscard]] static auto is_supported() -> bool;
+    // The instruction set generated code is for: "x86-64", "aarch64" (numeric functions only, see
+    // compile_arm64), or "none"
+    [[nodiscard]] static auto target() -> const char*;
+    // Whether generated code may use SSE4.1 instructions on this CPU
+    [[nodiscard]] static auto uses_sse41() -> bool;
+    // Whether generated code may use AVX2 (and the OS saves YMM state), for vectorized loops
+    [[nodiscard]] static auto uses_avx2() -> bool;
 
 private:
     CodeBuffer buffer_;
     
-    // SSA value to stack offset mapping
-    std::unordered_map<uint64_t, int32_t> value_offsets_;
+    // SSA value to register / spill slot mapping from the linear-scan allocator
+    RegisterAllocation allocation_;
+    // Values proven to hold integers, whose conversions to int64 need no exactness check
+    std::optional<ir::ValueFacts> facts_;
+    // Array accesses proven in range, which compile without their index and bounds checks
+    std::optional<ir::ArrayBounds> bounds_;
+
+    // Branch layout: the block compiled after the current one (which jumps there fall through),
+    // reads of each SSA value, and edges whose phi moves are emitted out of line
+    std::string next_block_;
+    std::unordered_map<std::uint64_t, std::size_t> use_counts_;
+    struct DeferredEdge {
+        std::string label;
+        std::size_t from = 0;
+        std::string target;
+    };
+    std::vector<DeferredEdge> deferred_edges_;
+    // A comparison left for the branch_if right after it, which only reads it as flags
+    const ir::SsaInstruction* fused_compare_ = nullptr;
+    // Loops whose entry edges run them four iterations at a time before the scalar loop takes over
+    struct VectorEntry {
+        VectorLoop loop;
+        const ir::SsaBlock* body = nullptr;
+        std::vector<int> registers;  // XMM registers holding nothing live on entry to the header
+    };
+    std::vector<VectorEntry> vector_loops_;
     int32_t stack_size_ = 0;
     
     // Label positions for patching
@@ -133,6 +416,28 @@ private:
     };
     std::unordered_map<std::string, std::vector<PhiInfo>> phi_map_;
     std::size_t current_block_id_ = 0;
+    std::size_t current_instruction_ = 0;  // index in the current block, for guard exits
+
+    // Call support
+    JitCallTable* calls_ = nullptr;
+    int32_t outgoing_args_offset_ = 0;                 // [rbp + offset] of the outgoing args array
+    std::unordered_map<int, int32_t> register_saves_;  // XMM register -> save slot across calls
+    bool needs_unwind_stub_ = false;
+    std::vector<JitTrap> used_traps_;
+    bool failed_ = false;                              // unsupported construct met during codegen
+    // Tail calls reuse the caller's args array, which holds at least incoming_args_ values
+    std::size_t incoming_args_ = 0;
+    int32_t incoming_args_offset_ = 0;                 // [rbp + offset] keeps its pointer; 0: no tail calls
+
+    // OSR support: the plan being compiled (null for whole functions)
+    const OsrPlan* osr_ = nullptr;
+    int32_t osr_state_offset_ = 0;  // [rbp + offset] holds the state array pointer
+    std::unordered_map<std::string, std::size_t> block_ids_;
+
+    [[nodiscard]] auto compile_function(const ir::SsaFunction& function,
+                                        const std::vector<std::pair<ir::SsaValue, int>>& parameters,
+                                        const std::vector<std::pair<ir::SsaValue, std::string>>& globals,
+                                        const OsrPlan* osr, JitCallTable* calls) -> std::pair<JitFunction, CodeBuffer>;
     
     void compile_block(const ir::SsaBlock& block, const ir::SsaFunction& function);
     void compile_instruction(const ir::SsaInstruction& inst, const ir::SsaBlock& block, const ir::SsaFunction& function);
@@ -140,14 +445,88 @@ private:
     void emit_prologue(int num_locals);
     void emit_epilogue();
     
-    // Emit phi moves for a jump to target block from current block
+    // Jump from the current block to `target`, with its phi moves (or to the OSR exit leaving the
+    // loop). With `may_fall_through` the jump itself is left out when `target` comes next.
+    void emit_jump_to_block(const std::string& target, bool may_fall_through = false);
+    // jmp, or jcc on `condition` (the rel32 form's second opcode byte), to `label`: rel8 when the
+    // label is already placed within reach, rel32 patched at the end otherwise
+    void emit_jump_to_label(std::optional<uint8_t> condition, const std::string& label);
+    // Whether the edge from the current block to `target` has code on it: phi moves to make or a
+    // vectorized loop to run
+    [[nodiscard]] auto edge_has_code(const std::string& target) -> bool;
+    // The vectorized loop the edge from the current block to `target` enters; null when none
+    [[nodiscard]] auto vector_loop_entered(const std::string& target) const -> const VectorEntry*;
+    // Runs the loop of `entry` in packed chunks of four iterations for as long as its bound, its
+    // arrays' lengths and their elements allow, leaving the induction phi and sums at the
+    // iteration the scalar loop goes on from. Jumps past it unless every array is a Float64 array.
+    void emit_vector_loop(const VectorEntry& entry);
+
+    // How a comparison shows in the flags of its ucomisd: unordered operands (NaN) always
+    // compare false, as in the interpreter
+    enum class FlagTest : std::uint8_t { Equal, Above, AboveOrEqual, OrderedEqual };
+    struct Condition {
+        FlagTest test = FlagTest::Equal;
+        bool negated = false;
+    };
+    [[nodiscard]] static auto is_comparison(const ir::SsaInstruction& inst) -> bool;
+    // Emits the ucomisd for comparison `inst` and returns the condition meaning "true"
+    [[nodiscard]] auto emit_compare(const ir::SsaInstruction& inst) -> Condition;
+    // Jumps to `label` when `condition` holds
+    void emit_condition_jump(Condition condition, const std::string& label);
+    void emit_branch_if(const ir::SsaInstruction& inst, const ir::SsaBlock& block, const ir::SsaFunction& function);
+    // Label a jump to `target` resolves to: the block itself, or an OSR exit stub
+    [[nodiscard]] auto jump_label(const std::string& target) -> std::string;
+    void emit_osr_exits();
+    // Emit phi moves for a jump to target block from current block (as one parallel copy)
     void emit_phi_moves(const std::string& target_block);
+    void emit_move(const ValueLocation& dst, const ValueLocation& src);
+    // `tail`: the next instruction returns the call's result (ir::is_tail_call)
+    void emit_call(const ir::SsaInstruction& inst, bool tail);
+    void emit_slot_call(std::size_t slot);  // entries[slot] when set, the trampoline otherwise
+    // When entries[slot] is set, leaves this frame and jumps there with `inst`'s arguments in the
+    // incoming args array, so the callee returns straight to this function's caller. Falls
+    // through, with the array overwritten, when there is no native entry yet.
+    void emit_tail_jump(const ir::SsaInstruction& inst, std::size_t slot);
+    void emit_math(const ir::SsaInstruction& inst, const JitMathSignature& math);
+    void emit_array_get(const ir::SsaInstruction& inst);
+    void emit_array_set(const ir::SsaInstruction& inst);
+    void emit_array_length(const ir::SsaInstruction& inst);
+    void emit_field_get(const ir::SsaInstruction& inst);
+    void emit_field_set(const ir::SsaInstruction& inst);
+    // RAX = the struct the field access `inst` reads or writes, trapping unless it has the
+    // struct's shape. Returns the field's offset from RAX; nullopt (and the compilation fails)
+    // when the field is not a numeric one of a known struct.
+    [[nodiscard]] auto emit_load_struct(const ir::SsaInstruction& inst, JitTrap not_struct) -> std::optional<int32_t>;
+    // RAX = array object pointer held by `array`; traps when it is null. The helpers taking an
+    // optional trap check nothing without one, for accesses ir::ArrayBounds has proven.
+    void emit_load_array(const ir::SsaValue& array, std::optional<JitTrap> not_array);
+    // Traps unless RAX points at an array. Boxed arrays fall through; Float64 arrays take a jump
+    // whose rel32 is at the returned position, for the caller to patch.
+    [[nodiscard]] auto emit_array_kind_dispatch(std::optional<JitTrap> not_array) -> size_t;
+    // RCX = `index`, trapping unless it is a non-negative integer
+    void emit_array_index(const ir::SsaValue& index, std::optional<JitTrap> bad_index);
+    // `reg` = `value` as an int64, trapping unless it is a non-negative integer
+    void emit_integer_operand(const ir::SsaValue& value, int reg, JitTrap trap);
+    // Traps when the double in `divisor` is one the interpreter rejects as a zero divisor
+    void emit_zero_divisor_check(int divisor);
+    // dst = lhs % rhs on non-negative integers, as the interpreter computes it
+    void emit_integer_remainder(const ir::SsaInstruction& inst, int dst);
+    // RDX = address of element RCX of the storage between the pointers at `begin`/`end` in RAX
+    void emit_element_address(int32_t begin, int32_t end, int32_t element_size, std::optional<JitTrap> out_of_bounds);
+    // Conditional jump (jcc condition byte) to the out-of-line stub reporting `trap`, or to the
+    // plan's guard exit for the current instruction when it has one
+    void emit_trap_jump(uint8_t condition, JitTrap trap);
+    void emit_trap_stubs();
     
-    [[nodiscard]] auto get_value_offset(const ir::SsaValue& value) -> int32_t;
-    void allocate_value(const ir::SsaValue& value);
+    [[nodiscard]] auto find_location(const ir::SsaValue& value) const -> const ValueLocation*;
+    // Register holding the value: its allocated register, or `scratch` after loading a spilled value
+    [[nodiscard]] auto operand_register(const ir::SsaValue& value, int scratch) -> int;
+    // Register a result should be computed into: its allocated register, or `scratch`
+    [[nodiscard]] auto result_register(const ir::SsaValue& value, int scratch) const -> int;
     
     void load_value_to_xmm(int xmm, const ir::SsaValue& value);
     void store_xmm_to_value(const ir::SsaValue& value, int xmm);
+    void load_constant_to_xmm(int xmm, double constant);
 };
 
 }  // namespace impulse::jit
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "impulse/jit/jit.h"
+
+namespace impulse::jit {
+
+// One function of an ahead-of-time object: its machine code and the relocations link_code
+// applies. `code` borrows from the caller when writing and from the file's contents when reading.
+struct JitObjectFunction {
+    std::string name;  // the ELF symbol, "module::function"
+    std::string_view code;
+    std::vector<JitRelocation> relocations;
+};
+
+struct JitObject {
+    std::uint64_t key = 0;  // what the code was compiled for (the runtime's code cache key)
+    std::vector<JitObjectFunction> functions;
+};
+
+// An ELF64 x86-64 relocatable object: every function in one .text section under a global
+// function symbol, each relocation as an R_X86_64_64 against an undefined symbol naming what it
+// points at (impulse_call_table, impulse_call_entries + 8 * slot, impulse_trampoline,
+// impulse_trap_handler, impulse_native_<n>, impulse_math_<n>, impulse_globals + 8 * slot), and
+// `key` as the absolute symbol impulse_code_key. Compiled functions keep the JitFunction calling
+// convention, so a host that defines those symbols can link the object and call them. Empty
+// where the format is not available (off Linux).
+[[nodiscard]] auto write_object_file(const JitObject& object) -> std::string;
+// Reads an object written by write_object_file back into the functions and relocations it was
+// written from; nullopt when `contents` is not such an object
+[[nodiscard]] auto read_object_file(std::string_view contents) -> std::optional<JitObject>;
+
+}  // namespace impulse::jit
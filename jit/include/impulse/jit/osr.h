@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::jit {
+
+// Leaving compiled code for the interpreter: along the edge from -> to (from inside the compiled
+// region, to outside it), or, with `instruction` set, in the middle of block `from` (== `to`)
+// right before that instruction. Compiled code stops there when it does not compile the
+// instruction; with `guard` set it gets there when one of the instruction's inline checks fails,
+// before the instruction had any effect, so the interpreter runs it again and produces its own
+// result or error (a deoptimisation). `outputs` are the region-defined values still live there;
+// everything else is unchanged in the interpreter frame.
+struct OsrExit {
+    std::size_t from = 0;
+    std::size_t to = 0;
+    std::optional<std::size_t> instruction;
+    bool guard = false;
+    std::vector<ir::SsaValue> outputs;
+};
+
+// On-stack replacement entry at a loop header, or a speculative entry for the whole function at
+// its entry block. Only the blocks of the region are compiled, so the rest of the function may
+// use anything the interpreter supports.
+//
+// Compiled OSR code takes a state array instead of parameters:
+//   on entry    state[1 + i] holds inputs[i] (the header's phi results already materialised)
+//   on exit     state[0] = k + 1 and state[1 + i] holds exits[k].outputs[i]
+//   on return   state[0] is left at 0 and the function result is returned
+struct OsrPlan {
+    std::size_t header = 0;
+    std::vector<bool> region;  // per block: compiled
+    std::vector<ir::SsaValue> inputs;
+    std::vector<OsrExit> exits;
+    // (block, instruction) of the deferred instructions compiled code skipped; the runtime
+    // materialises their results in the frame on every exit
+    std::vector<std::pair<std::size_t, std::size_t>> deferred;
+
+    [[nodiscard]] auto in_region(std::size_t block) const -> bool {
+        return block < region.size() && region[block];
+    }
+    [[nodiscard]] auto state_size() const -> std::size_t;
+    // The exit inside `block` at `instruction`: a guard exit, or the stop when `guard` is false
+    [[nodiscard]] auto find_exit(std::size_t block, std::size_t instruction, bool guard) const
+        -> std::optional<std::size_t>;
+};
+
+// Plan an OSR entry at `header`: the natural loop of its back-edges (predecessors at or after
+// it in layout order, matching the interpreter's back-edge counting). Fails when `header` has no
+// back-edge predecessor.
+[[nodiscard]] auto plan_osr(const ir::SsaFunction& function, std::size_t header) -> std::optional<OsrPlan>;
+
+// Plan a speculative entry for the whole function: compiled code starts at the entry block with
+// the parameters as inputs and runs the first compiled[b] instructions of each block it reaches,
+// stopping before the first one it does not compile. Blocks are reached through the successors of
+// blocks compiled to their end; edges into blocks whose first instruction is not compiled leave
+// the region. Fails when the entry block's first instruction is not compiled.
+[[nodiscard]] auto plan_speculation(const ir::SsaFunction& function, const std::vector<std::size_t>& compiled)
+    -> std::optional<OsrPlan>;
+
+// Instructions compiled code skips, leaving their results to be materialised on exit: string
+// literals, which it cannot represent but which read nothing and have no effect
+[[nodiscard]] auto is_deferred(const ir::SsaInstruction& inst) -> bool;
+
+// Whether compiled code checks the operands of `inst` inline (array and field accesses and `%`), giving its
+// OSR and speculative plans a guard exit there
+[[nodiscard]] auto is_guarded(const ir::SsaInstruction& inst) -> bool;
+
+}  // namespace impulse::jit
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+
+namespace impulse::jit {
+
+// Where an SSA value lives for the whole of its live range
+struct ValueLocation {
+    enum class Kind : std::uint8_t { Register, Stack };
+
+    Kind kind = Kind::Stack;
+    int reg = -1;         // XMM register number when kind == Register
+    int32_t offset = 0;   // [rbp + offset] when kind == Stack
+
+    [[nodiscard]] auto is_register() const -> bool { return kind == Kind::Register; }
+    [[nodiscard]] auto operator==(const ValueLocation& other) const -> bool {
+        return kind == other.kind && (is_register() ? reg == other.reg : offset == other.offset);
+    }
+    [[nodiscard]] auto operator!=(const ValueLocation& other) const -> bool { return !(*this == other); }
+
+    [[nodiscard]] static auto in_register(int xmm) -> ValueLocation {
+        return ValueLocation{Kind::Register, xmm, 0};
+    }
+    [[nodiscard]] static auto on_stack(int32_t rbp_offset) -> ValueLocation {
+        return ValueLocation{Kind::Stack, -1, rbp_offset};
+    }
+};
+
+struct RegisterAllocation {
+    // Keyed by ir::encode_ssa_value
+    std::unordered_map<uint64_t, ValueLocation> locations;
+    int spill_slots = 0;
+    // Every XMM register is caller-saved, so registers holding values that stay live across a
+    // `call` instruction must be saved around it
+    std::unordered_map<const ir::SsaInstruction*, std::vector<int>> preserved_across_calls;
+};
+
+// XMM0 and XMM1 are never handed out: code generation uses them as scratch registers.
+[[nodiscard]] auto allocatable_xmm_registers() -> const std::vector<int>&;
+
+// Linear-scan allocation (Poletto & Sarkar) over one conservative interval per SSA value.
+// Blocks are numbered in layout order; each block contributes an entry position (phi results),
+// one position per instruction, and an exit position where outgoing phi moves are emitted.
+// Parameters are defined before the first block.
+[[nodiscard]] auto allocate_registers(const ir::SsaFunction& function,
+                                      const std::vector<ir::SsaValue>& parameters) -> RegisterAllocation;
+
+}  // namespace impulse::jit
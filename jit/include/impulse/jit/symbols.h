@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace impulse::jit {
+
+// What to tell profilers and debuggers about compiled code (see JitSymbols)
+struct JitSymbolOptions {
+    bool perf_map = false;  // append "<address> <size> <name>" lines to <directory>/perf-<pid>.map
+    bool jitdump = false;   // write code-load records with the code bytes to <directory>/jit-<pid>.dump
+    bool gdb = false;       // register an in-memory ELF object per function through the GDB JIT interface
+    std::string directory = "/tmp";  // where the perf map and jitdump files go
+
+    [[nodiscard]] auto any() const -> bool { return perf_map || jitdump || gdb; }
+};
+
+// Names compiled code for external tools as it is installed, so `perf report` and `gdb bt` show
+// functions instead of anonymous addresses. perf reads /tmp/perf-<pid>.map by itself;
+// `perf record -k 1` followed by `perf inject --jit` picks up the jitdump file, because opening it
+// maps a page of it executable, which perf records. GDB reads the objects registered in
+// __jit_debug_descriptor whenever __jit_debug_register_code runs. Only Linux emits anything.
+//
+// Several threads may add code at once. Files are kept open until the publisher is destroyed;
+// GDB objects are unregistered by forget() (when the code they describe is unmapped) or then.
+class JitSymbols {
+public:
+    explicit JitSymbols(JitSymbolOptions options);
+    ~JitSymbols();
+
+    JitSymbols(const JitSymbols&) = delete;
+    auto operator=(const JitSymbols&) -> JitSymbols& = delete;
+    JitSymbols(JitSymbols&&) = delete;
+    auto operator=(JitSymbols&&) -> JitSymbols& = delete;
+
+    // `size` bytes of installed code at `code` are the function `name`. `owner` groups
+    // entries unmapped together, for forget().
+    void add(const void* owner, const std::string& name, const void* code, std::size_t size);
+    // Drops the GDB objects of everything added for `owner` (for every owner when null)
+    void forget(const void* owner);
+
+    [[nodiscard]] auto options() const -> const JitSymbolOptions& { return options_; }
+    // GDB objects currently registered by this publisher
+    [[nodiscard]] auto gdb_entry_count() const -> std::size_t;
+
+private:
+    struct GdbEntry;
+
+    void write_perf_map(const std::string& name, const void* code, std::size_t size);
+    void write_jitdump(const std::string& name, const void* code, std::size_t size);
+    void register_gdb(const void* owner, const std::string& name, const void* code, std::size_t size);
+
+    JitSymbolOptions options_;
+    mutable std::mutex mutex_;  // guards everything below
+    int perf_map_ = -1;         // file descriptors
+    int jitdump_ = -1;
+    void* jitdump_marker_ = nullptr;  // the executable mapping perf looks for
+    std::uint64_t code_index_ = 0;
+    std::vector<std::unique_ptr<GdbEntry>> gdb_entries_;
+};
+
+}  // namespace impulse::jit
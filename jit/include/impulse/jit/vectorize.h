@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+#include "impulse/ir/value_facts.h"
+
+namespace impulse::jit {
+
+// Arrays one vector loop may index: each needs a caller-saved general register for its elements
+inline constexpr std::size_t kMaxVectorArrays = 4;
+
+// `phi = phi + addend` carried around the loop by a header phi
+struct VectorReduction {
+    ir::SsaValue phi;
+    ir::SsaValue update;  // phi + addend, computed in the body and fed back into the phi
+    ir::SsaValue addend;
+};
+
+// A counted loop whose iterations are independent, so compiled code can run four at a time in
+// packed registers: a header that only tests `induction < bound`, and one body block that counts
+// the induction phi up by one and otherwise holds literals, + - * / and array_get / array_set at
+// index `induction` of arrays defined before the loop (a[i] = a[i] * s + b[i]). As every
+// iteration touches only element i, arrays that alias change nothing. Reductions are limited to
+// sums of integers, which are exact in any order: adding doubles four lanes at a time would not
+// round like the interpreter's one-by-one sum.
+struct VectorLoop {
+    std::size_t header = 0;
+    std::size_t body = 0;
+    ir::SsaValue induction;
+    ir::SsaValue step;   // induction + 1, fed back into the phi
+    ir::SsaValue bound;  // defined before the loop
+    std::vector<ir::SsaValue> arrays;  // distinct arrays the body indexes, at most kMaxVectorArrays
+    std::vector<VectorReduction> reductions;
+};
+
+// Every loop of `function` with that shape
+[[nodiscard]] auto plan_vector_loops(const ir::SsaFunction& function, const ir::ValueFacts& facts)
+    -> std::vector<VectorLoop>;
+
+}  // namespace impulse::jit
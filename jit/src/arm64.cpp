@@ -0,0 +1,537 @@
+#include "impulse/jit/arm64.h"
+
+#include <cstring>
+#include <unordered_map>
+
+#include "impulse/ir/liveness.h"
+#include "impulse/ir/value_facts.h"
+
+namespace impulse::jit {
+
+namespace {
+
+[[nodiscard]] auto reg(int number) -> std::uint32_t {
+    return static_cast<std::uint32_t>(number) & 31U;
+}
+
+// Floating-point data processing, two sources: 0x1E6 | Rm | opcode | Rn | Rd
+[[nodiscard]] auto fp_rrr(std::uint32_t opcode, int dd, int dn, int dm) -> std::uint32_t {
+    return 0x1E600800U | (opcode << 12) | (reg(dm) << 16) | (reg(dn) << 5) | reg(dd);
+}
+
+}  // namespace
+
+// ============================================================================
+// Arm64Assembler
+// ============================================================================
+
+void Arm64Assembler::add_sub_sp(bool subtract, int rd, int rn, std::uint32_t imm12, bool shifted) {
+    emit((subtract ? 0xD1000000U : 0x91000000U) | (shifted ? 1U << 22 : 0U) | ((imm12 & 0xFFFU) << 10) |
+         (reg(rn) << 5) | reg(rd));
+}
+
+void Arm64Assembler::prologue(std::uint32_t frame_bytes) {
+    emit(0xA9BF7BFDU);  // stp x29, x30, [sp, #-16]!
+    add_sub_sp(false, kFp, kSp, 0, false);
+    if ((frame_bytes >> 12) != 0) {
+        add_sub_sp(true, kSp, kSp, frame_bytes >> 12, true);
+    }
+    if ((frame_bytes & 0xFFFU) != 0) {
+        add_sub_sp(true, kSp, kSp, frame_bytes & 0xFFFU, false);
+    }
+}
+
+void Arm64Assembler::epilogue() {
+    add_sub_sp(false, kSp, kFp, 0, false);
+    emit(0xA8C17BFDU);  // ldp x29, x30, [sp], #16
+    emit(0xD65F03C0U);  // ret
+}
+
+void Arm64Assembler::ldr_d(int dt, int base, std::uint32_t offset) {
+    emit(0xFD400000U | ((offset / 8) << 10) | (reg(base) << 5) | reg(dt));
+}
+
+void Arm64Assembler::str_d(int dt, int base, std::uint32_t offset) {
+    emit(0xFD000000U | ((offset / 8) << 10) | (reg(base) << 5) | reg(dt));
+}
+
+void Arm64Assembler::str_x(int xt, int base, std::uint32_t offset) {
+    emit(0xF9000000U | ((offset / 8) << 10) | (reg(base) << 5) | reg(xt));
+}
+
+void Arm64Assembler::fadd(int dd, int dn, int dm) { emit(fp_rrr(0x2, dd, dn, dm)); }
+void Arm64Assembler::fsub(int dd, int dn, int dm) { emit(fp_rrr(0x3, dd, dn, dm)); }
+void Arm64Assembler::fmul(int dd, int dn, int dm) { emit(fp_rrr(0x0, dd, dn, dm)); }
+void Arm64Assembler::fdiv(int dd, int dn, int dm) { emit(fp_rrr(0x1, dd, dn, dm)); }
+
+void Arm64Assembler::fneg(int dd, int dn) {
+    emit(0x1E614000U | (reg(dn) << 5) | reg(dd));
+}
+
+void Arm64Assembler::fmov(int dd, int dn) {
+    emit(0x1E604000U | (reg(dn) << 5) | reg(dd));
+}
+
+void Arm64Assembler::fmov_dx(int dd, int xn) {
+    emit(0x9E670000U | (reg(xn) << 5) | reg(dd));
+}
+
+void Arm64Assembler::fcmp(int dn, int dm) {
+    emit(0x1E602000U | (reg(dm) << 16) | (reg(dn) << 5));
+}
+
+void Arm64Assembler::fcmp_zero(int dn) {
+    emit(0x1E602008U | (reg(dn) << 5));
+}
+
+void Arm64Assembler::mov_imm64(int xd, std::uint64_t value) {
+    bool first = true;
+    for (std::uint32_t half = 0; half < 4; ++half) {
+        const auto bits = static_cast<std::uint32_t>((value >> (half * 16)) & 0xFFFFU);
+        if (bits == 0 && !(first && half == 3)) {
+            continue;
+        }
+        // movz for the first half written, movk for the rest
+        emit((first ? 0xD2800000U : 0xF2800000U) | (half << 21) | (bits << 5) | reg(xd));
+        first = false;
+    }
+}
+
+void Arm64Assembler::cset(int wd, Arm64Condition condition) {
+    // csinc wd, wzr, wzr, !condition
+    const auto inverted = static_cast<std::uint32_t>(condition) ^ 1U;
+    emit(0x1A9F07E0U | (inverted << 12) | reg(wd));
+}
+
+void Arm64Assembler::ucvtf(int dd, int wn) {
+    emit(0x1E630000U | (reg(wn) << 5) | reg(dd));
+}
+
+void Arm64Assembler::and_w(int wd, int wn, int wm) {
+    emit(0x0A000000U | (reg(wm) << 16) | (reg(wn) << 5) | reg(wd));
+}
+
+void Arm64Assembler::orr_w(int wd, int wn, int wm) {
+    emit(0x2A000000U | (reg(wm) << 16) | (reg(wn) << 5) | reg(wd));
+}
+
+auto Arm64Assembler::new_label() -> std::size_t {
+    labels_.push_back(kUnbound);
+    return labels_.size() - 1;
+}
+
+void Arm64Assembler::bind(std::size_t label) {
+    labels_[label] = words_.size();
+}
+
+void Arm64Assembler::b(std::size_t label) {
+    fixups_.push_back(Fixup{words_.size(), label, false});
+    emit(0x14000000U);
+}
+
+void Arm64Assembler::b_cond(Arm64Condition condition, std::size_t label) {
+    fixups_.push_back(Fixup{words_.size(), label, true});
+    emit(0x54000000U | static_cast<std::uint32_t>(condition));
+}
+
+auto Arm64Assembler::finish() const -> std::optional<std::vector<std::uint8_t>> {
+    std::vector<std::uint32_t> words = words_;
+    for (const auto& fixup : fixups_) {
+        if (labels_[fixup.label] == kUnbound) {
+            return std::nullopt;
+        }
+        // Offsets count instructions from the branch itself
+        const auto delta = static_cast<std::int64_t>(labels_[fixup.label]) - static_cast<std::int64_t>(fixup.word);
+        if (fixup.conditional) {
+            if (delta < -(std::int64_t{1} << 18) || delta >= (std::int64_t{1} << 18)) {
+                return std::nullopt;
+            }
+            words[fixup.word] |= (static_cast<std::uint32_t>(delta) & 0x7FFFFU) << 5;
+        } else {
+            if (delta < -(std::int64_t{1} << 25) || delta >= (std::int64_t{1} << 25)) {
+                return std::nullopt;
+            }
+            words[fixup.word] |= static_cast<std::uint32_t>(delta) & 0x3FFFFFFU;
+        }
+    }
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(words.size() * 4);
+    for (const std::uint32_t word : words) {
+        for (int i = 0; i < 4; ++i) {
+            bytes.push_back(static_cast<std::uint8_t>(word >> (i * 8)));
+        }
+    }
+    return bytes;
+}
+
+// ============================================================================
+// compile_arm64
+// ============================================================================
+
+namespace {
+
+constexpr int kArgs = 0;       // x0: the argument array
+constexpr int kScratchX0 = 9;  // x9, x10: caller-saved, free for our own use
+constexpr int kScratchX1 = 10;
+// d16-d31 are caller-saved and unused otherwise; an edge with at most this many phi moves reads
+// all of its sources into them before writing any destination
+constexpr int kFirstMoveRegister = 16;
+constexpr std::size_t kRegisterMoves = 16;
+// Slots are addressed as [sp, #8 * slot]: the scaled 12-bit offset of ldr / str
+constexpr std::size_t kMaxSlots = 4095;
+
+class Arm64FunctionCompiler {
+public:
+    explicit Arm64FunctionCompiler(const ir::SsaFunction& function) : function_(function), facts_(function) {}
+
+    auto compile(const std::vector<std::pair<ir::SsaValue, int>>& parameters)
+        -> std::optional<std::vector<std::uint8_t>> {
+        if (function_.blocks.empty() || !assign_slots(parameters)) {
+            return std::nullopt;
+        }
+        for (std::size_t i = 0; i < function_.blocks.size(); ++i) {
+            block_index_[function_.blocks[i].id] = i;
+            labels_.push_back(assembler_.new_label());
+        }
+
+        const std::size_t slots = slots_.size() + temporaries_;
+        assembler_.prologue(static_cast<std::uint32_t>((slots * 8 + 15) / 16 * 16));
+        for (const auto& [value, index] : parameters) {
+            if (index < 0 || static_cast<std::size_t>(index) > kMaxSlots) {
+                return std::nullopt;
+            }
+            assembler_.ldr_d(0, kArgs, static_cast<std::uint32_t>(index) * 8);
+            store(0, value);
+        }
+
+        for (std::size_t i = 0; i < function_.blocks.size(); ++i) {
+            if (!compile_block(i)) {
+                return std::nullopt;
+            }
+        }
+        return assembler_.finish();
+    }
+
+private:
+    // One slot per parameter, phi and instruction result, then the spill area of the largest
+    // set of phi moves that does not fit the move registers
+    auto assign_slots(const std::vector<std::pair<ir::SsaValue, int>>& parameters) -> bool {
+        const auto define = [this](const ir::SsaValue& value) {
+            slots_.emplace(ir::encode_ssa_value(value), static_cast<std::uint32_t>(slots_.size()));
+        };
+        for (const auto& [value, index] : parameters) {
+            define(value);
+        }
+        for (const auto& block : function_.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                define(phi.result);
+            }
+            for (const auto& inst : block.instructions) {
+                if (inst.result.has_value()) {
+                    define(*inst.result);
+                }
+            }
+        }
+
+        // Anything read but never defined here is a global, which this backend does not load
+        std::unordered_map<std::uint64_t, std::size_t> moves;  // (target, predecessor) -> count
+        for (const auto& block : function_.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                for (const auto& input : phi.inputs) {
+                    if (!input.value.has_value()) {
+                        continue;
+                    }
+                    if (slots_.count(ir::encode_ssa_value(*input.value)) == 0) {
+                        return false;
+                    }
+                    ++moves[(static_cast<std::uint64_t>(block.id) << 32) | input.predecessor];
+                }
+            }
+            for (const auto& inst : block.instructions) {
+                for (const auto& argument : inst.arguments) {
+                    if (slots_.count(ir::encode_ssa_value(argument)) == 0) {
+                        return false;
+                    }
+                }
+            }
+        }
+        for (const auto& [edge, count] : moves) {
+            if (count > kRegisterMoves && count > temporaries_) {
+                temporaries_ = count;
+            }
+        }
+        return slots_.size() + temporaries_ <= kMaxSlots;
+    }
+
+    [[nodiscard]] auto offset(const ir::SsaValue& value) const -> std::uint32_t {
+        return slots_.at(ir::encode_ssa_value(value)) * 8;
+    }
+
+    void load(int dt, const ir::SsaValue& value) { assembler_.ldr_d(dt, Arm64Assembler::kSp, offset(value)); }
+    void store(int dt, const ir::SsaValue& value) { assembler_.str_d(dt, Arm64Assembler::kSp, offset(value)); }
+
+    // d0 = 1.0 when the flags of the last fcmp satisfy `condition`, 0.0 otherwise
+    void materialize(Arm64Condition condition) {
+        assembler_.cset(kScratchX0, condition);
+        assembler_.ucvtf(0, kScratchX0);
+    }
+
+    auto compile_block(std::size_t index) -> bool {
+        const auto& block = function_.blocks[index];
+        assembler_.bind(labels_[index]);
+        for (const auto& inst : block.instructions) {
+            switch (inst.op) {
+            case ir::SsaOpcode::Literal: {
+                if (!inst.number.has_value()) {
+                    return false;
+                }
+                if (!inst.result.has_value()) {
+                    break;
+                }
+                std::uint64_t bits = 0;
+                std::memcpy(&bits, &*inst.number, sizeof(bits));
+                if (bits == 0) {
+                    assembler_.str_x(Arm64Assembler::kZr, Arm64Assembler::kSp, offset(*inst.result));
+                } else {
+                    assembler_.mov_imm64(kScratchX0, bits);
+                    assembler_.str_x(kScratchX0, Arm64Assembler::kSp, offset(*inst.result));
+                }
+                break;
+            }
+            case ir::SsaOpcode::Assign:
+                if (inst.arguments.empty()) {
+                    return false;
+                }
+                if (inst.result.has_value()) {
+                    load(0, inst.arguments[0]);
+                    store(0, *inst.result);
+                }
+                break;
+            case ir::SsaOpcode::Binary:
+                if (!compile_binary(inst)) {
+                    return false;
+                }
+                break;
+            case ir::SsaOpcode::Unary:
+                if (inst.arguments.empty() || inst.unary_op == ir::UnaryOp::Unknown) {
+                    return false;
+                }
+                if (inst.result.has_value()) {
+                    load(0, inst.arguments[0]);
+                    if (inst.unary_op == ir::UnaryOp::Neg) {
+                        assembler_.fneg(0, 0);
+                    } else {
+                        assembler_.fcmp_zero(0);
+                        materialize(Arm64Condition::Eq);
+                    }
+                    store(0, *inst.result);
+                }
+                break;
+            case ir::SsaOpcode::Drop:
+                break;
+            case ir::SsaOpcode::Branch: {
+                const auto target = block_named(inst);
+                return target.has_value() && emit_edge(block, *target, index);
+            }
+            case ir::SsaOpcode::BranchIf:
+                return compile_branch_if(inst, block, index);
+            case ir::SsaOpcode::Return:
+                if (inst.arguments.empty()) {
+                    assembler_.fmov_dx(0, Arm64Assembler::kZr);
+                } else {
+                    load(0, inst.arguments[0]);
+                }
+                assembler_.epilogue();
+                return true;
+            default:
+                return false;
+            }
+        }
+        // A block without a terminator continues into its only successor
+        if (block.successors.size() != 1) {
+            return false;
+        }
+        const auto it = block_index_.find(block.successors.front());
+        return it != block_index_.end() && emit_edge(block, it->second, index);
+    }
+
+    auto compile_binary(const ir::SsaInstruction& inst) -> bool {
+        if (inst.arguments.size() < 2) {
+            return false;
+        }
+        const auto comparison = [](ir::BinaryOp op) -> std::optional<Arm64Condition> {
+            // After fcmp an unordered pair sets C and V only, so none of these but ne holds for NaN
+            switch (op) {
+            case ir::BinaryOp::Lt: return Arm64Condition::Mi;
+            case ir::BinaryOp::Le: return Arm64Condition::Ls;
+            case ir::BinaryOp::Gt: return Arm64Condition::Gt;
+            case ir::BinaryOp::Ge: return Arm64Condition::Ge;
+            case ir::BinaryOp::Eq: return Arm64Condition::Eq;
+            case ir::BinaryOp::Ne: return Arm64Condition::Ne;
+            default: return std::nullopt;
+            }
+        };
+        switch (inst.binary_op) {
+        case ir::BinaryOp::Add:
+        case ir::BinaryOp::Sub:
+        case ir::BinaryOp::Mul:
+        case ir::BinaryOp::And:
+        case ir::BinaryOp::Or:
+            break;
+        case ir::BinaryOp::Div:
+            if (!facts_.safe_divisor(inst.arguments[1])) {
+                return false;  // a variable divisor needs the trap the x86-64 backend has
+            }
+            break;
+        default:
+            if (!comparison(inst.binary_op).has_value()) {
+                return false;  // % needs the division-by-zero trap the x86-64 backend has
+            }
+            break;
+        }
+        if (!inst.result.has_value()) {
+            return true;
+        }
+
+        load(0, inst.arguments[0]);
+        load(1, inst.arguments[1]);
+        switch (inst.binary_op) {
+        case ir::BinaryOp::Add: assembler_.fadd(0, 0, 1); break;
+        case ir::BinaryOp::Sub: assembler_.fsub(0, 0, 1); break;
+        case ir::BinaryOp::Mul: assembler_.fmul(0, 0, 1); break;
+        case ir::BinaryOp::Div: assembler_.fdiv(0, 0, 1); break;
+        case ir::BinaryOp::And:
+        case ir::BinaryOp::Or:
+            // x != 0.0 for each side, which holds for NaN
+            assembler_.fcmp_zero(0);
+            assembler_.cset(kScratchX0, Arm64Condition::Ne);
+            assembler_.fcmp_zero(1);
+            assembler_.cset(kScratchX1, Arm64Condition::Ne);
+            if (inst.binary_op == ir::BinaryOp::And) {
+                assembler_.and_w(kScratchX0, kScratchX0, kScratchX1);
+            } else {
+                assembler_.orr_w(kScratchX0, kScratchX0, kScratchX1);
+            }
+            assembler_.ucvtf(0, kScratchX0);
+            break;
+        default:
+            assembler_.fcmp(0, 1);
+            materialize(*comparison(inst.binary_op));
+            break;
+        }
+        store(0, *inst.result);
+        return true;
+    }
+
+    // branch_if condition | target compare_val: to target when condition == compare_val, else
+    // to the other successor
+    auto compile_branch_if(const ir::SsaInstruction& inst, const ir::SsaBlock& block, std::size_t index) -> bool {
+        if (inst.arguments.empty() || (inst.immediates.size() >= 2 && !inst.number.has_value())) {
+            return false;
+        }
+        const auto target = block_named(inst);
+        if (!target.has_value()) {
+            return false;
+        }
+        std::optional<std::size_t> fallthrough;
+        for (const std::size_t successor : block.successors) {
+            const auto it = block_index_.find(successor);
+            if (it != block_index_.end() && it->second != *target) {
+                fallthrough = it->second;
+                break;
+            }
+        }
+        if (!fallthrough.has_value()) {
+            return emit_edge(block, *target, index);
+        }
+
+        const double compare = inst.number.value_or(0.0);
+        load(0, inst.arguments[0]);
+        if (compare == 0.0) {
+            assembler_.fcmp_zero(0);
+        } else {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &compare, sizeof(bits));
+            assembler_.mov_imm64(kScratchX0, bits);
+            assembler_.fmov_dx(1, kScratchX0);
+            assembler_.fcmp(0, 1);
+        }
+        // ne also holds for an unordered condition, which equals nothing
+        const std::size_t other = assembler_.new_label();
+        assembler_.b_cond(Arm64Condition::Ne, other);
+        if (!emit_edge(block, *target, std::nullopt)) {
+            return false;
+        }
+        assembler_.bind(other);
+        return emit_edge(block, *fallthrough, index);
+    }
+
+    [[nodiscard]] auto block_named(const ir::SsaInstruction& inst) const -> std::optional<std::size_t> {
+        if (inst.immediates.empty()) {
+            return std::nullopt;
+        }
+        const ir::SsaBlock* target = function_.find_block(inst.immediates[0]);
+        if (target == nullptr) {
+            return std::nullopt;
+        }
+        const auto it = block_index_.find(target->id);
+        return it != block_index_.end() ? std::optional<std::size_t>(it->second) : std::nullopt;
+    }
+
+    // The phi moves of the edge from `from` into block `target`, then the jump, left out when
+    // `target` directly follows block `layout` (the one being compiled, if the edge is its last)
+    auto emit_edge(const ir::SsaBlock& from, std::size_t target, std::optional<std::size_t> layout) -> bool {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> moves;  // source, destination offsets
+        for (const auto& phi : function_.blocks[target].phi_nodes) {
+            for (const auto& input : phi.inputs) {
+                if (input.predecessor == from.id && input.value.has_value()) {
+                    const std::uint32_t source = offset(*input.value);
+                    const std::uint32_t destination = offset(phi.result);
+                    if (source != destination) {
+                        moves.emplace_back(source, destination);
+                    }
+                }
+            }
+        }
+        // Read every source before writing any destination, as the phis take their inputs together
+        if (moves.size() <= kRegisterMoves) {
+            for (std::size_t i = 0; i < moves.size(); ++i) {
+                assembler_.ldr_d(kFirstMoveRegister + static_cast<int>(i), Arm64Assembler::kSp, moves[i].first);
+            }
+            for (std::size_t i = 0; i < moves.size(); ++i) {
+                assembler_.str_d(kFirstMoveRegister + static_cast<int>(i), Arm64Assembler::kSp, moves[i].second);
+            }
+        } else {
+            const auto spill = static_cast<std::uint32_t>(slots_.size()) * 8;
+            for (std::size_t i = 0; i < moves.size(); ++i) {
+                assembler_.ldr_d(0, Arm64Assembler::kSp, moves[i].first);
+                assembler_.str_d(0, Arm64Assembler::kSp, spill + static_cast<std::uint32_t>(i) * 8);
+            }
+            for (std::size_t i = 0; i < moves.size(); ++i) {
+                assembler_.ldr_d(0, Arm64Assembler::kSp, spill + static_cast<std::uint32_t>(i) * 8);
+                assembler_.str_d(0, Arm64Assembler::kSp, moves[i].second);
+            }
+        }
+        if (!layout.has_value() || *layout + 1 != target) {
+            assembler_.b(labels_[target]);
+        }
+        return true;
+    }
+
+    const ir::SsaFunction& function_;
+    ir::ValueFacts facts_;
+    Arm64Assembler assembler_;
+    std::unordered_map<std::uint64_t, std::uint32_t> slots_;  // encoded value -> slot
+    std::size_t temporaries_ = 0;
+    std::unordered_map<std::size_t, std::size_t> block_index_;  // block id -> position
+    std::vector<std::size_t> labels_;
+};
+
+}  // namespace
+
+auto compile_arm64(const ir::SsaFunction& function, const std::vector<std::pair<ir::SsaValue, int>>& parameters)
+    -> std::optional<std::vector<std::uint8_t>> {
+    return Arm64FunctionCompiler(function).compile(parameters);
+}
+
+}  // namespace impulse::jit
@@ -0,0 +1,210 @@
+#include "impulse/jit/code_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace impulse::jit {
+
+namespace {
+
+constexpr std::uint8_t kInt3 = 0xCC;  // padding between functions
+
+[[nodiscard]] auto page_size() -> std::size_t {
+#ifdef __linux__
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#elif defined(_WIN32)
+    static const std::size_t size = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<std::size_t>(info.dwPageSize);
+    }();
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+[[nodiscard]] auto round_up(std::size_t value, std::size_t multiple) -> std::size_t {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+[[nodiscard]] auto map_pages(std::size_t size) -> unsigned char* {
+#ifdef __linux__
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<unsigned char*>(memory);
+#elif defined(_WIN32)
+    return static_cast<unsigned char*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+    (void)size;
+    return nullptr;
+#endif
+}
+
+void unmap_pages(unsigned char* base, std::size_t size) {
+#ifdef __linux__
+    munmap(base, size);
+#elif defined(_WIN32)
+    (void)size;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    (void)base;
+    (void)size;
+#endif
+}
+
+// Read-execute and read-write views of one fresh shared memory object, or nullopt when the
+// system has no such objects (or forbids executing them)
+[[nodiscard]] auto map_dual_pages(std::size_t size) -> std::optional<std::pair<unsigned char*, unsigned char*>> {
+#ifdef __linux__
+    const int fd = memfd_create("impulse-jit", MFD_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    void* execute = MAP_FAILED;
+    void* write = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        execute = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        write = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);  // the mappings keep the object alive
+    if (execute == MAP_FAILED || write == MAP_FAILED) {
+        if (execute != MAP_FAILED) {
+            munmap(execute, size);
+        }
+        if (write != MAP_FAILED) {
+            munmap(write, size);
+        }
+        return std::nullopt;
+    }
+    return std::make_pair(static_cast<unsigned char*>(execute), static_cast<unsigned char*>(write));
+#else
+    (void)size;
+    return std::nullopt;
+#endif
+}
+
+[[nodiscard]] auto protect_pages(unsigned char* begin, std::size_t size, bool executable) -> bool {
+#ifdef __linux__
+    return mprotect(begin, size, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#elif defined(_WIN32)
+    DWORD previous = 0;
+    return VirtualProtect(begin, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &previous) != 0;
+#else
+    (void)begin;
+    (void)size;
+    (void)executable;
+    return false;
+#endif
+}
+
+}  // namespace
+
+JitCodeArena::~JitCodeArena() {
+    for (const auto& region : regions_) {
+        unmap_pages(region.base, region.size);
+        if (region.write != nullptr) {
+            unmap_pages(region.write, region.size);
+        }
+    }
+}
+
+auto JitCodeArena::add_region(std::size_t min_bytes) -> Region* {
+    const std::size_t size = round_up(std::max(min_bytes, kRegionBytes), page_size());
+    if (const auto views = map_dual_pages(size)) {
+        regions_.push_back(Region{views->first, views->second, size, 0});
+        return &regions_.back();
+    }
+    unsigned char* base = map_pages(size);
+    if (base == nullptr) {
+        return nullptr;
+    }
+    regions_.push_back(Region{base, nullptr, size, 0});
+    return &regions_.back();
+}
+
+auto JitCodeArena::install(const std::vector<std::uint8_t>& code) -> void* {
+    if (code.empty()) {
+        return nullptr;
+    }
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    // Functions are only ever appended to the newest region; the tails of older ones are left
+    Region* region = regions_.empty() ? nullptr : &regions_.back();
+    std::size_t offset = region != nullptr ? round_up(region->used, kFunctionAlignment) : 0;
+    if (region == nullptr || offset + code.size() > region->size) {
+        region = add_region(code.size());
+        if (region == nullptr) {
+            return nullptr;
+        }
+        offset = 0;
+    }
+
+    if (region->write != nullptr) {
+        std::memset(region->write + region->used, kInt3, offset - region->used);
+        std::memcpy(region->write + offset, code.data(), code.size());
+    } else {
+        // Write through the pages spanning the padding and the new code, then make them executable
+        const std::size_t page = page_size();
+        const std::size_t first_page = region->used / page * page;
+        const std::size_t end = round_up(offset + code.size(), page);
+        unsigned char* pages = region->base + first_page;
+        if (!protect_pages(pages, end - first_page, false)) {
+            return nullptr;
+        }
+        std::memset(region->base + region->used, kInt3, offset - region->used);
+        std::memcpy(region->base + offset, code.data(), code.size());
+        if (!protect_pages(pages, end - first_page, true)) {
+            return nullptr;
+        }
+    }
+#if defined(__GNUC__)
+    __builtin___clear_cache(reinterpret_cast<char*>(region->base + offset),
+                            reinterpret_cast<char*>(region->base + offset + code.size()));
+#endif
+
+    region->used = offset + code.size();
+    ++function_count_;
+    return region->base + offset;
+}
+
+auto JitCodeArena::function_count() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return function_count_;
+}
+
+auto JitCodeArena::region_count() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return regions_.size();
+}
+
+auto JitCodeArena::bytes_used() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t used = 0;
+    for (const auto& region : regions_) {
+        used += region.used;
+    }
+    return used;
+}
+
+auto JitCodeArena::bytes_reserved() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t reserved = 0;
+    for (const auto& region : regions_) {
+        reserved += region.size;
+    }
+    return reserved;
+}
+
+}  // namespace impulse::jit
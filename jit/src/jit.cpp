@@ -1,12 +1,26 @@
 #include "impulse/jit/jit.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+#include "impulse/ir/liveness.h"
+#include "impulse/ir/tail_calls.h"
+#include "impulse/jit/arm64.h"
 
 #ifdef __linux__
 #include <sys/mman.h>
 #endif
 
+#ifdef __APPLE__
+#include <libkern/OSCacheControl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -23,7 +37,7 @@ CodeBuffer::CodeBuffer() {
 
 CodeBuffer::~CodeBuffer() {
     if (executable_ != nullptr) {
-#ifdef __linux__
+#if defined(__linux__) || defined(__APPLE__)
         munmap(executable_, executable_size_);
 #endif
 #ifdef _WIN32
@@ -34,6 +48,7 @@ CodeBuffer::~CodeBuffer() {
 
 CodeBuffer::CodeBuffer(CodeBuffer&& other) noexcept
     : code_(std::move(other.code_)),
+      relocations_(std::move(other.relocations_)),
       executable_(other.executable_),
       executable_size_(other.executable_size_) {
     other.executable_ = nullptr;
@@ -43,7 +58,7 @@ CodeBuffer::CodeBuffer(CodeBuffer&& other) noexcept
 auto CodeBuffer::operator=(CodeBuffer&& other) noexcept -> CodeBuffer& {
     if (this != &other) {
         if (executable_ != nullptr) {
-#ifdef __linux__
+#if defined(__linux__) || defined(__APPLE__)
             munmap(executable_, executable_size_);
 #endif
 #ifdef _WIN32
@@ -51,6 +66,7 @@ auto CodeBuffer::operator=(CodeBuffer&& other) noexcept -> CodeBuffer& {
 #endif
         }
         code_ = std::move(other.code_);
+        relocations_ = std::move(other.relocations_);
         executable_ = other.executable_;
         executable_size_ = other.executable_size_;
         other.executable_ = nullptr;
@@ -170,6 +186,45 @@ void CodeBuffer::emit_movsd_xmm_xmm(int dst, int src) {
     emit({0x0F, 0x10, static_cast<uint8_t>(0xC0 | (dst << 3) | src)});
 }
 
+void CodeBuffer::emit_sse_rr(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide) {
+    uint8_t rex = wide ? 0x48 : 0x40;
+    if (reg >= 8) {
+        rex |= 0x04;  // REX.R
+        reg -= 8;
+    }
+    if (rm >= 8) {
+        rex |= 0x01;  // REX.B
+        rm -= 8;
+    }
+    emit(prefix);
+    if (rex != 0x40) emit(rex);
+    emit({0x0F, opcode, static_cast<uint8_t>(0xC0 | (reg << 3) | rm)});
+}
+
+void CodeBuffer::emit_movapd(int dst, int src) {
+    emit_sse_rr(0x66, 0x28, dst, src);  // movapd dst, src
+}
+
+void CodeBuffer::emit_xorpd(int dst, int src) {
+    emit_sse_rr(0x66, 0x57, dst, src);  // xorpd dst, src
+}
+
+void CodeBuffer::emit_movq_xmm_reg(int xmm, int reg) {
+    emit_sse_rr(0x66, 0x6E, xmm, reg, true);  // movq xmm, r64
+}
+
+void CodeBuffer::emit_movq_reg_xmm(int reg, int xmm) {
+    emit_sse_rr(0x66, 0x7E, xmm, reg, true);  // movq r64, xmm
+}
+
+void CodeBuffer::emit_cvtsi2sd(int xmm, int reg) {
+    emit_sse_rr(0xF2, 0x2A, xmm, reg, true);  // cvtsi2sd xmm, r64
+}
+
+void CodeBuffer::emit_cvttsd2si(int reg, int xmm) {
+    emit_sse_rr(0xF2, 0x2C, reg, xmm, true);  // cvttsd2si r64, xmm
+}
+
 void CodeBuffer::emit_addsd(int dst, int src) {
     // addsd dst, src
     uint8_t rex = 0x00;
@@ -238,6 +293,114 @@ void CodeBuffer::emit_divsd(int dst, int src) {
     emit({0x0F, 0x5E, static_cast<uint8_t>(0xC0 | (dst << 3) | src)});
 }
 
+void CodeBuffer::emit_sqrtsd(int dst, int src) {
+    emit_sse_rr(0xF2, 0x51, dst, src);  // sqrtsd dst, src
+}
+
+void CodeBuffer::emit_andpd(int dst, int src) {
+    emit_sse_rr(0x66, 0x54, dst, src);  // andpd dst, src
+}
+
+void CodeBuffer::emit_roundsd(int dst, int src, uint8_t mode) {
+    // roundsd dst, src, mode: 66 [REX] 0F 3A 0B /r ib
+    uint8_t rex = 0x40;
+    if (dst >= 8) {
+        rex |= 0x04;
+        dst -= 8;
+    }
+    if (src >= 8) {
+        rex |= 0x01;
+        src -= 8;
+    }
+    emit(0x66);
+    if (rex != 0x40) emit(rex);
+    emit({0x0F, 0x3A, 0x0B, static_cast<uint8_t>(0xC0 | (dst << 3) | src), mode});
+}
+
+void CodeBuffer::emit_vex(uint8_t map, uint8_t opcode, int reg, int vvvv, int rm, int index) {
+    // R, X and B are stored inverted, as is vvvv; an unused vvvv is encoded as 1111 (register 0)
+    uint8_t rxb = 0xE0;
+    if (reg >= 8) {
+        rxb &= ~0x80U;
+        reg -= 8;
+    }
+    if (index >= 8) {
+        rxb &= ~0x40U;
+        index -= 8;
+    }
+    if (rm >= 8) {
+        rxb &= ~0x20U;
+        rm -= 8;
+    }
+    emit({0xC4, static_cast<uint8_t>(rxb | map),
+          static_cast<uint8_t>(((~vvvv & 0x0F) << 3) | 0x05), opcode});  // L = 256 bits, pp = 66
+    if (index < 0) {
+        emit(static_cast<uint8_t>(0xC0 | (reg << 3) | rm));
+        return;
+    }
+    // [base + index * 8] through a SIB byte; rbp/r13 as base only exist with a displacement
+    const bool displaced = rm == 5;
+    emit(static_cast<uint8_t>((displaced ? 0x44 : 0x04) | (reg << 3)));
+    emit(static_cast<uint8_t>(0xC0 | (index << 3) | rm));
+    if (displaced) {
+        emit(0x00);
+    }
+}
+
+void CodeBuffer::emit_vaddpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x58, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vsubpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x5C, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vmulpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x59, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vdivpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x5E, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vxorpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x57, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vunpckhpd(int dst, int lhs, int rhs) {
+    emit_vex(0x01, 0x15, dst, lhs, rhs);
+}
+
+void CodeBuffer::emit_vcmppd(int dst, int lhs, int rhs, uint8_t predicate) {
+    emit_vex(0x01, 0xC2, dst, lhs, rhs);
+    emit(predicate);
+}
+
+void CodeBuffer::emit_vmovupd_load(int ymm, int base_reg, int index_reg) {
+    emit_vex(0x01, 0x10, ymm, 0, base_reg, index_reg);
+}
+
+void CodeBuffer::emit_vmovupd_store(int base_reg, int index_reg, int ymm) {
+    emit_vex(0x01, 0x11, ymm, 0, base_reg, index_reg);
+}
+
+void CodeBuffer::emit_vbroadcastsd(int ymm, int xmm) {
+    emit_vex(0x02, 0x19, ymm, 0, xmm);
+}
+
+void CodeBuffer::emit_vptest(int lhs, int rhs) {
+    emit_vex(0x02, 0x17, lhs, 0, rhs);
+}
+
+void CodeBuffer::emit_vextractf128(int xmm, int ymm, uint8_t half) {
+    emit_vex(0x03, 0x19, ymm, 0, xmm);  // the destination is ModRM.rm
+    emit(half);
+}
+
+void CodeBuffer::emit_vzeroupper() {
+    emit({0xC5, 0xF8, 0x77});
+}
+
 void CodeBuffer::emit_ucomisd(int xmm1, int xmm2) {
     // ucomisd xmm1, xmm2
     uint8_t rex = 0x00;
@@ -269,9 +432,92 @@ void CodeBuffer::emit_mov_reg_imm64(int reg, int64_t imm) {
     }
 }
 
+void CodeBuffer::emit_mov_reg_address(int reg, const void* address, JitRelocationKind kind, std::uint64_t addend) {
+    emit_mov_reg_imm64(reg, static_cast<int64_t>(reinterpret_cast<std::uintptr_t>(address)));
+    relocations_.push_back(JitRelocation{static_cast<std::uint32_t>(code_.size() - 8), kind, addend});
+}
+
+void CodeBuffer::emit_mov_reg_mem(int reg, int base_reg, int32_t offset) {
+    // mov reg, [base_reg + disp32] (REX.W 8B /r)
+    uint8_t rex = 0x48;
+    if (reg >= 8) {
+        rex |= 0x04;
+        reg -= 8;
+    }
+    if (base_reg >= 8) {
+        rex |= 0x01;
+        base_reg -= 8;
+    }
+    emit(rex);
+    emit(0x8B);
+    emit(static_cast<uint8_t>(0x80 | (reg << 3) | base_reg));
+    if (base_reg == 4) emit(0x24);  // SIB byte for rsp/r12 base
+    emit(static_cast<uint8_t>(offset & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
+}
+
+void CodeBuffer::emit_mov_mem_reg(int base_reg, int32_t offset, int reg) {
+    // mov [base_reg + disp32], reg (REX.W 89 /r)
+    uint8_t rex = 0x48;
+    if (reg >= 8) {
+        rex |= 0x04;
+        reg -= 8;
+    }
+    if (base_reg >= 8) {
+        rex |= 0x01;
+        base_reg -= 8;
+    }
+    emit(rex);
+    emit(0x89);
+    emit(static_cast<uint8_t>(0x80 | (reg << 3) | base_reg));
+    if (base_reg == 4) emit(0x24);  // SIB byte for rsp/r12 base
+    emit(static_cast<uint8_t>(offset & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
+}
+
+void CodeBuffer::emit_alu_rr(uint8_t opcode, int dst, int src) {
+    // REX.W opcode /r with ModRM.reg = src, ModRM.rm = dst
+    uint8_t rex = 0x48;
+    if (src >= 8) {
+        rex |= 0x04;  // REX.R
+        src -= 8;
+    }
+    if (dst >= 8) {
+        rex |= 0x01;  // REX.B
+        dst -= 8;
+    }
+    emit(rex);
+    emit(opcode);
+    emit(static_cast<uint8_t>(0xC0 | (src << 3) | dst));
+}
+
+void CodeBuffer::emit_mov_reg_reg(int dst, int src) {
+    emit_alu_rr(0x89, dst, src);  // mov dst, src
+}
+
 void CodeBuffer::emit_xor_reg_reg(int dst, int src) {
-    // xor dst, src
-    uint8_t rex = 0x48;  // REX.W
+    emit_alu_rr(0x31, dst, src);  // xor dst, src
+}
+
+void CodeBuffer::emit_add_reg_reg(int dst, int src) {
+    emit_alu_rr(0x01, dst, src);  // add dst, src
+}
+
+void CodeBuffer::emit_sub_reg_reg(int dst, int src) {
+    emit_alu_rr(0x29, dst, src);  // sub dst, src
+}
+
+void CodeBuffer::emit_cmp_reg_reg(int lhs, int rhs) {
+    emit_alu_rr(0x39, lhs, rhs);  // cmp lhs, rhs (flags from lhs - rhs)
+}
+
+void CodeBuffer::emit_imul_reg_reg(int dst, int src) {
+    // imul dst, src (REX.W 0F AF /r)
+    uint8_t rex = 0x48;
     if (dst >= 8) {
         rex |= 0x04;
         dst -= 8;
@@ -280,9 +526,83 @@ void CodeBuffer::emit_xor_reg_reg(int dst, int src) {
         rex |= 0x01;
         src -= 8;
     }
-    emit(rex);
-    emit(0x31);
-    emit(static_cast<uint8_t>(0xC0 | (src << 3) | dst));
+    emit({rex, 0x0F, 0xAF, static_cast<uint8_t>(0xC0 | (dst << 3) | src)});
+}
+
+void CodeBuffer::emit_div_reg(int reg) {
+    // div reg (REX.W F7 /6)
+    uint8_t rex = 0x48;
+    if (reg >= 8) {
+        rex |= 0x01;
+        reg -= 8;
+    }
+    emit({rex, 0xF7, static_cast<uint8_t>(0xF0 | reg)});
+}
+
+void CodeBuffer::emit_imul_reg_imm32(int dst, int32_t imm) {
+    // imul dst, dst, imm32 (REX.W 69 /r id)
+    uint8_t rex = 0x48;
+    if (dst >= 8) {
+        rex |= 0x05;  // REX.R and REX.B
+        dst -= 8;
+    }
+    emit({rex, 0x69, static_cast<uint8_t>(0xC0 | (dst << 3) | dst)});
+    emit(static_cast<uint8_t>(imm & 0xFF));
+    emit(static_cast<uint8_t>((imm >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((imm >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((imm >> 24) & 0xFF));
+}
+
+void CodeBuffer::emit_shr_reg_imm8(int reg, uint8_t imm) {
+    // shr reg, imm8 (REX.W C1 /5 ib)
+    uint8_t rex = 0x48;
+    if (reg >= 8) {
+        rex |= 0x01;
+        reg -= 8;
+    }
+    emit({rex, 0xC1, static_cast<uint8_t>(0xE8 | reg), imm});
+}
+
+void CodeBuffer::emit_cmp_byte_mem_imm(int base_reg, int32_t offset, uint8_t imm) {
+    // cmp byte [base_reg + disp32], imm8 (80 /7 ib)
+    emit_byte_mem_imm(0x80, 7, base_reg, offset, imm);
+}
+
+void CodeBuffer::emit_cmp_dword_mem_imm(int base_reg, int32_t offset, uint32_t imm) {
+    // cmp dword [base_reg + disp32], imm32 (81 /7 id)
+    if (base_reg >= 8) {
+        emit(0x41);  // REX.B
+        base_reg -= 8;
+    }
+    emit(0x81);
+    emit(static_cast<uint8_t>(0x80 | (7 << 3) | base_reg));
+    if (base_reg == 4) emit(0x24);  // SIB byte for rsp/r12 base
+    for (int shift = 0; shift < 32; shift += 8) {
+        emit(static_cast<uint8_t>((offset >> shift) & 0xFF));
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        emit(static_cast<uint8_t>((imm >> shift) & 0xFF));
+    }
+}
+
+void CodeBuffer::emit_mov_byte_mem_imm(int base_reg, int32_t offset, uint8_t imm) {
+    // mov byte [base_reg + disp32], imm8 (C6 /0 ib)
+    emit_byte_mem_imm(0xC6, 0, base_reg, offset, imm);
+}
+
+void CodeBuffer::emit_byte_mem_imm(uint8_t opcode, int extension, int base_reg, int32_t offset, uint8_t imm) {
+    if (base_reg >= 8) {
+        emit(0x41);  // REX.B
+        base_reg -= 8;
+    }
+    emit(opcode);
+    emit(static_cast<uint8_t>(0x80 | (extension << 3) | base_reg));
+    if (base_reg == 4) emit(0x24);  // SIB byte for rsp/r12 base
+    emit(static_cast<uint8_t>(offset & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
+    emit(imm);
 }
 
 void CodeBuffer::emit_jmp_rel32(int32_t offset) {
@@ -309,6 +629,42 @@ void CodeBuffer::emit_je_rel32(int32_t offset) {
     emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
 }
 
+void CodeBuffer::emit_jcc_rel32(uint8_t condition, int32_t offset) {
+    emit({0x0F, condition});
+    emit(static_cast<uint8_t>(offset & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
+}
+
+void CodeBuffer::emit_jmp_rel8(int8_t offset) {
+    emit({0xEB, static_cast<uint8_t>(offset)});
+}
+
+void CodeBuffer::emit_jcc_rel8(uint8_t condition, int8_t offset) {
+    emit({static_cast<uint8_t>(0x70 | (condition & 0x0F)), static_cast<uint8_t>(offset)});
+}
+
+void CodeBuffer::emit_nops(std::size_t count) {
+    // The recommended NOP forms of 1 to 8 bytes
+    static const std::vector<uint8_t> kNops[] = {
+        {},
+        {0x90},
+        {0x66, 0x90},
+        {0x0F, 0x1F, 0x00},
+        {0x0F, 0x1F, 0x40, 0x00},
+        {0x0F, 0x1F, 0x44, 0x00, 0x00},
+        {0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+        {0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+        {0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+    };
+    while (count > 0) {
+        const std::size_t size = std::min<std::size_t>(count, 8);
+        emit(kNops[size]);
+        count -= size;
+    }
+}
+
 void CodeBuffer::emit_test_reg_reg(int reg1, int reg2) {
     uint8_t rex = 0x48;
     if (reg1 >= 8) {
@@ -324,6 +680,45 @@ void CodeBuffer::emit_test_reg_reg(int reg1, int reg2) {
     emit(static_cast<uint8_t>(0xC0 | (reg2 << 3) | reg1));
 }
 
+void CodeBuffer::emit_call_reg(int reg) {
+    // call r64 (FF /2)
+    if (reg >= 8) {
+        emit(0x41);
+        reg -= 8;
+    }
+    emit({0xFF, static_cast<uint8_t>(0xD0 | reg)});
+}
+
+void CodeBuffer::emit_jmp_reg(int reg) {
+    // jmp r64 (FF /4)
+    if (reg >= 8) {
+        emit(0x41);
+        reg -= 8;
+    }
+    emit({0xFF, static_cast<uint8_t>(0xE0 | reg)});
+}
+
+void CodeBuffer::emit_lea_reg_mem(int reg, int base_reg, int32_t offset) {
+    // lea reg, [base_reg + disp32] (REX.W 8D /r)
+    uint8_t rex = 0x48;
+    if (reg >= 8) {
+        rex |= 0x04;
+        reg -= 8;
+    }
+    if (base_reg >= 8) {
+        rex |= 0x01;
+        base_reg -= 8;
+    }
+    emit(rex);
+    emit(0x8D);
+    emit(static_cast<uint8_t>(0x80 | (reg << 3) | base_reg));
+    if (base_reg == 4) emit(0x24);  // SIB byte for rsp/r12 base
+    emit(static_cast<uint8_t>(offset & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
+    emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
+}
+
 void CodeBuffer::emit_seta(int reg8) {
     if (reg8 >= 4) {
         emit(0x40);  // REX prefix needed for SPL, BPL, SIL, DIL
@@ -356,6 +751,16 @@ void CodeBuffer::emit_setne(int reg8) {
     emit({0x0F, 0x95, static_cast<uint8_t>(0xC0 | (reg8 & 7))});
 }
 
+void CodeBuffer::emit_setp(int reg8) {
+    if (reg8 >= 4) emit(0x40);
+    emit({0x0F, 0x9A, static_cast<uint8_t>(0xC0 | (reg8 & 7))});
+}
+
+void CodeBuffer::emit_setnp(int reg8) {
+    if (reg8 >= 4) emit(0x40);
+    emit({0x0F, 0x9B, static_cast<uint8_t>(0xC0 | (reg8 & 7))});
+}
+
 auto CodeBuffer::position() const -> size_t {
     return code_.size();
 }
@@ -367,58 +772,313 @@ void CodeBuffer::patch_rel32(size_t pos, int32_t offset) {
     code_[pos + 3] = static_cast<uint8_t>((offset >> 24) & 0xFF);
 }
 
-auto CodeBuffer::finalize() -> JitFunction {
+void CodeBuffer::patch_rel8(size_t pos, int8_t offset) {
+    code_[pos] = static_cast<uint8_t>(offset);
+}
+
+auto CodeBuffer::finalize(JitCodeArena* arena) -> JitFunction {
     if (code_.empty()) {
         return nullptr;
     }
-    
+    if (arena != nullptr) {
+        return reinterpret_cast<JitFunction>(arena->install(code_));
+    }
+
+    // Written while read-write, then flipped to read-execute
 #ifdef __linux__
     executable_size_ = code_.size();
     executable_ = mmap(nullptr, executable_size_,
-                       PROT_READ | PROT_WRITE | PROT_EXEC,
+                       PROT_READ | PROT_WRITE,
                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (executable_ == MAP_FAILED) {
         executable_ = nullptr;
         return nullptr;
     }
     std::memcpy(executable_, code_.data(), code_.size());
+    if (mprotect(executable_, executable_size_, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+#if defined(__GNUC__)
+    // AArch64 fetches instructions through a cache that does not see the memcpy
+    __builtin___clear_cache(static_cast<char*>(executable_), static_cast<char*>(executable_) + executable_size_);
+#endif
+#endif
+
+#ifdef __APPLE__
+    // Hardened runtime only executes MAP_JIT pages, which are toggled per thread instead of
+    // mprotect-ed
+    executable_size_ = code_.size();
+    executable_ = mmap(nullptr, executable_size_,
+                       PROT_READ | PROT_WRITE | PROT_EXEC,
+                       MAP_PRIVATE | MAP_ANON | MAP_JIT, -1, 0);
+    if (executable_ == MAP_FAILED) {
+        executable_ = nullptr;
+        return nullptr;
+    }
+    pthread_jit_write_protect_np(0);
+    std::memcpy(executable_, code_.data(), code_.size());
+    pthread_jit_write_protect_np(1);
+    sys_icache_invalidate(executable_, executable_size_);
 #endif
 
 #ifdef _WIN32
     executable_size_ = code_.size();
     executable_ = VirtualAlloc(nullptr, executable_size_,
                                MEM_COMMIT | MEM_RESERVE,
-                               PAGE_EXECUTE_READWRITE);
+                               PAGE_READWRITE);
     if (executable_ == nullptr) {
         return nullptr;
     }
     std::memcpy(executable_, code_.data(), code_.size());
+    DWORD previous = 0;
+    if (VirtualProtect(executable_, executable_size_, PAGE_EXECUTE_READ, &previous) == 0) {
+        return nullptr;
+    }
 #endif
 
     return reinterpret_cast<JitFunction>(executable_);
 }
 
-// ============================================================================
-// JitCompiler implementation
-// ============================================================================
+// Compiled code reads call table entries with a plain load
+static_assert(std::atomic<JitFunction>::is_always_lock_free && sizeof(std::atomic<JitFunction>) == sizeof(JitFunction),
+              "call table entries must be plain pointers in memory");
 
-JitCompiler::JitCompiler() = default;
+auto jit_unwind_value() -> double {
+    double value = 0.0;
+    std::memcpy(&value, &kJitUnwindBits, sizeof(value));
+    return value;
+}
 
-auto JitCompiler::is_supported() -> bool {
-#if defined(__x86_64__) || defined(_M_X64)
-    return true;
-#else
-    return false;
-#endif
+auto is_jit_unwind(double value) -> bool {
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits == kJitUnwindBits;
 }
 
-void JitCompiler::emit_prologue(int num_locals) {
-    buffer_.emit_push_rbp();
-    buffer_.emit_mov_rbp_rsp();
-    
-    // Allocate stack space for locals + 16 bytes for temp (16-byte aligned)
-    // Extra 16 bytes for temporary storage (e.g., for unary negation sign mask)
-    stack_size_ = (((num_locals * 8) + 16) + 15) & ~15;
+auto find_jit_native(const std::string& callee) -> const JitNativeSignature* {
+    static const std::array<JitNativeSignature, kJitNativeCount> kNatives = {{
+        {JitNative::ArraySum, "array_sum", 1, 0b1, -1},
+        {JitNative::ArrayDot, "array_dot", 2, 0b11, -1},
+        {JitNative::ArrayMin, "array_min", 1, 0b1, -1},
+        {JitNative::ArrayMax, "array_max", 1, 0b1, -1},
+        {JitNative::ArrayScale, "array_scale", 2, 0b01, 0},
+        {JitNative::ArrayAxpy, "array_axpy", 3, 0b110, 2},
+        {JitNative::ArrayCopy, "array_copy", 2, 0b11, 0},
+        {JitNative::ArrayFill, "array_fill", 2, 0b01, 0},
+        {JitNative::ArraySort, "array_sort", 1, 0b1, 0},
+        {JitNative::ArrayBinarySearch, "array_binary_search", 2, 0b01, -1},
+    }};
+    for (const auto& native : kNatives) {
+        if (callee == native.callee) {
+            return &native;
+        }
+    }
+    return nullptr;
+}
+
+auto find_jit_math(const std::string& callee) -> const JitMathSignature* {
+    static const std::array<JitMathSignature, kJitMathCount> kMath = {{
+        {JitMath::Sqrt, "sqrt", 1},   {JitMath::Abs, "abs", 1},   {JitMath::Floor, "floor", 1},
+        {JitMath::Ceil, "ceil", 1},   {JitMath::Round, "round", 1}, {JitMath::Sin, "sin", 1},
+        {JitMath::Cos, "cos", 1},     {JitMath::Tan, "tan", 1},   {JitMath::Exp, "exp", 1},
+        {JitMath::Log, "log", 1},     {JitMath::Log10, "log10", 1}, {JitMath::Pow, "pow", 2},
+    }};
+    constexpr std::string_view kPrefix = "std::math::";
+    std::string_view name = callee;
+    if (name.substr(0, kPrefix.size()) == kPrefix) {
+        name.remove_prefix(kPrefix.size());
+    }
+    for (const auto& math : kMath) {
+        if (name == math.callee) {
+            return &math;
+        }
+    }
+    return nullptr;
+}
+
+auto jit_math_function(JitMath id) -> const void* {
+    using Unary = double (*)(double);
+    using Binary = double (*)(double, double);
+    switch (id) {
+    case JitMath::Sqrt: return reinterpret_cast<const void*>(static_cast<Unary>(std::sqrt));
+    case JitMath::Abs: return reinterpret_cast<const void*>(static_cast<Unary>(std::abs));
+    case JitMath::Floor: return reinterpret_cast<const void*>(static_cast<Unary>(std::floor));
+    case JitMath::Ceil: return reinterpret_cast<const void*>(static_cast<Unary>(std::ceil));
+    case JitMath::Round: return reinterpret_cast<const void*>(static_cast<Unary>(std::round));
+    case JitMath::Sin: return reinterpret_cast<const void*>(static_cast<Unary>(std::sin));
+    case JitMath::Cos: return reinterpret_cast<const void*>(static_cast<Unary>(std::cos));
+    case JitMath::Tan: return reinterpret_cast<const void*>(static_cast<Unary>(std::tan));
+    case JitMath::Exp: return reinterpret_cast<const void*>(static_cast<Unary>(std::exp));
+    case JitMath::Log: return reinterpret_cast<const void*>(static_cast<Unary>(std::log));
+    case JitMath::Log10: return reinterpret_cast<const void*>(static_cast<Unary>(std::log10));
+    case JitMath::Pow: return reinterpret_cast<const void*>(static_cast<Binary>(std::pow));
+    }
+    return nullptr;
+}
+
+auto link_code(std::vector<uint8_t> code, const std::vector<JitRelocation>& relocations,
+               JitCallTable& table) -> JitFunction {
+    if (table.code == nullptr) {
+        return nullptr;
+    }
+    for (const auto& relocation : relocations) {
+        if (std::size_t{relocation.offset} + 8 > code.size()) {
+            return nullptr;
+        }
+        const void* target = nullptr;
+        switch (relocation.kind) {
+        case JitRelocationKind::CallTable:
+            if (relocation.addend >= sizeof(JitCallTable)) {
+                return nullptr;
+            }
+            target = reinterpret_cast<const unsigned char*>(&table) + relocation.addend;
+            break;
+        case JitRelocationKind::CallEntry:
+            if (relocation.addend >= table.entries.size()) {
+                return nullptr;
+            }
+            target = &table.entries[relocation.addend];
+            break;
+        case JitRelocationKind::Trampoline:
+            target = reinterpret_cast<const void*>(table.trampoline);
+            break;
+        case JitRelocationKind::TrapHandler:
+            target = reinterpret_cast<const void*>(table.trap);
+            break;
+        case JitRelocationKind::Native:
+            if (relocation.addend >= table.natives.size() || table.natives[relocation.addend] == nullptr) {
+                return nullptr;
+            }
+            target = reinterpret_cast<const void*>(table.natives[relocation.addend]);
+            break;
+        case JitRelocationKind::Math:
+            if (relocation.addend >= kJitMathCount) {
+                return nullptr;
+            }
+            target = jit_math_function(static_cast<JitMath>(relocation.addend));
+            break;
+        case JitRelocationKind::Global:
+            if (relocation.addend >= table.globals.size()) {
+                return nullptr;
+            }
+            target = &table.globals[relocation.addend];
+            break;
+        default:
+            return nullptr;
+        }
+        const auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(target));
+        for (int i = 0; i < 8; ++i) {
+            code[relocation.offset + i] = static_cast<uint8_t>(bits >> (i * 8));
+        }
+    }
+    return reinterpret_cast<JitFunction>(table.code->install(code));
+}
+
+// ============================================================================
+// JitCompiler implementation
+// ============================================================================
+
+namespace {
+
+constexpr int kScratch0 = 0;  // XMM0: scratch / return value
+constexpr int kScratch1 = 1;  // XMM1: scratch
+
+// Shared exit taken when a call returns kJitUnwindBits: passes the failure on to the caller
+const std::string kUnwindLabel = "$unwind";
+
+// jcc condition bytes (second opcode byte of the rel32 forms)
+constexpr uint8_t kJumpIfBelow = 0x82;
+constexpr uint8_t kJumpIfAboveOrEqual = 0x83;
+constexpr uint8_t kJumpIfEqual = 0x84;
+constexpr uint8_t kJumpIfNotEqual = 0x85;
+constexpr uint8_t kJumpIfBelowOrEqual = 0x86;
+constexpr uint8_t kJumpIfAbove = 0x87;
+constexpr uint8_t kJumpIfSign = 0x88;
+constexpr uint8_t kJumpIfParity = 0x8A;
+constexpr uint8_t kJumpIfNotParity = 0x8B;
+
+// vcmppd predicate true when either operand is NaN
+constexpr uint8_t kUnordered = 3;
+
+// Loop headers start on this boundary, so the back edge lands on a fresh fetch block
+constexpr std::size_t kLoopAlignment = 16;
+
+[[nodiscard]] auto trap_label(JitTrap trap) -> std::string {
+    return "$trap" + std::to_string(static_cast<std::uint64_t>(trap));
+}
+
+[[nodiscard]] auto osr_exit_label(std::size_t exit) -> std::string {
+    return "$osr_exit" + std::to_string(exit);
+}
+
+// Multiplicative inverse of an odd number modulo 2^64 (Newton iteration, 3 -> 96 correct bits)
+[[nodiscard]] auto inverse_mod_2_64(std::uint64_t odd) -> std::uint64_t {
+    std::uint64_t inverse = odd;
+    for (int i = 0; i < 5; ++i) {
+        inverse *= 2 - odd * inverse;
+    }
+    return inverse;
+}
+
+#ifdef _WIN32
+constexpr int kArgReg0 = static_cast<int>(Register::RCX);
+constexpr int kArgReg1 = static_cast<int>(Register::RDX);
+constexpr int kArgReg2 = static_cast<int>(Register::R8);
+constexpr int kShadowSlots = 4;  // 32-byte home area the Windows x64 ABI reserves for callees
+#else
+constexpr int kArgReg0 = static_cast<int>(Register::RDI);
+constexpr int kArgReg1 = static_cast<int>(Register::RSI);
+constexpr int kArgReg2 = static_cast<int>(Register::RDX);
+constexpr int kShadowSlots = 0;
+#endif
+
+}  // namespace
+
+JitCompiler::JitCompiler() = default;
+
+auto JitCompiler::is_supported() -> bool {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto JitCompiler::target() -> const char* {
+#if defined(__x86_64__) || defined(_M_X64)
+    return "x86-64";
+#elif defined(__aarch64__)
+    return "aarch64";
+#else
+    return "none";
+#endif
+}
+
+auto JitCompiler::uses_sse41() -> bool {
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+    static const bool supported = __builtin_cpu_supports("sse4.1") != 0;
+    return supported;
+#else
+    return false;
+#endif
+}
+
+auto JitCompiler::uses_avx2() -> bool {
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+    // The compiler's check covers the OS enabling YMM state (XGETBV) as well as the CPUID bit
+    static const bool supported = __builtin_cpu_supports("avx2") != 0;
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void JitCompiler::emit_prologue(int num_locals) {
+    buffer_.emit_push_rbp();
+    buffer_.emit_mov_rbp_rsp();
+
+    // Allocate stack space for spill slots (16-byte aligned)
+    stack_size_ = ((num_locals * 8) + 15) & ~15;
     if (stack_size_ > 0) {
         // sub rsp, stack_size_
         buffer_.emit({0x48, 0x81, 0xEC});
@@ -435,371 +1095,1326 @@ void JitCompiler::emit_epilogue() {
     buffer_.emit_ret();
 }
 
-auto JitCompiler::get_value_offset(const ir::SsaValue& value) -> int32_t {
-    uint64_t key = (static_cast<uint64_t>(value.symbol) << 32) | value.version;
-    auto it = value_offsets_.find(key);
-    if (it != value_offsets_.end()) {
-        return it->second;
+auto JitCompiler::find_location(const ir::SsaValue& value) const -> const ValueLocation* {
+    auto it = allocation_.locations.find(ir::encode_ssa_value(value));
+    if (it == allocation_.locations.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+auto JitCompiler::operand_register(const ir::SsaValue& value, int scratch) -> int {
+    const ValueLocation* location = find_location(value);
+    if (location != nullptr && location->is_register()) {
+        return location->reg;
+    }
+    load_value_to_xmm(scratch, value);
+    return scratch;
+}
+
+auto JitCompiler::result_register(const ir::SsaValue& value, int scratch) const -> int {
+    const ValueLocation* location = find_location(value);
+    if (location != nullptr && location->is_register()) {
+        return location->reg;
     }
-    // Allocate new slot
-    allocate_value(value);
-    return value_offsets_[key];
+    return scratch;
 }
 
-void JitCompiler::allocate_value(const ir::SsaValue& value) {
-    uint64_t key = (static_cast<uint64_t>(value.symbol) << 32) | value.version;
-    if (value_offsets_.find(key) != value_offsets_.end()) {
-        return;  // Already allocated
+void JitCompiler::emit_move(const ValueLocation& dst, const ValueLocation& src) {
+    const int rbp = static_cast<int>(Register::RBP);
+    if (dst.is_register() && src.is_register()) {
+        if (dst.reg != src.reg) {
+            buffer_.emit_movapd(dst.reg, src.reg);
+        }
+    } else if (dst.is_register()) {
+        buffer_.emit_movsd_xmm_mem(dst.reg, rbp, src.offset);
+    } else if (src.is_register()) {
+        buffer_.emit_movsd_mem_xmm(rbp, dst.offset, src.reg);
+    } else if (dst.offset != src.offset) {
+        buffer_.emit_movsd_xmm_mem(kScratch1, rbp, src.offset);
+        buffer_.emit_movsd_mem_xmm(rbp, dst.offset, kScratch1);
     }
-    // Allocate stack slot: negative offset from RBP (growing downward)
-    // Each slot is 8 bytes (double)
-    int32_t slot_index = static_cast<int32_t>(value_offsets_.size());
-    int32_t offset = -static_cast<int32_t>((slot_index + 1) * 8);
-    value_offsets_[key] = offset;
 }
 
 void JitCompiler::load_value_to_xmm(int xmm, const ir::SsaValue& value) {
-    int32_t offset = get_value_offset(value);
-    buffer_.emit_movsd_xmm_mem(xmm, static_cast<int>(Register::RBP), offset);
+    const ValueLocation* location = find_location(value);
+    if (location == nullptr) {
+        // Value without a definition (never live) - materialise 0.0
+        buffer_.emit_xorpd(xmm, xmm);
+        return;
+    }
+    emit_move(ValueLocation::in_register(xmm), *location);
 }
 
 void JitCompiler::store_xmm_to_value(const ir::SsaValue& value, int xmm) {
-    int32_t offset = get_value_offset(value);
-    buffer_.emit_movsd_mem_xmm(static_cast<int>(Register::RBP), offset, xmm);
+    const ValueLocation* location = find_location(value);
+    if (location == nullptr) {
+        return;
+    }
+    emit_move(*location, ValueLocation::in_register(xmm));
+}
+
+void JitCompiler::load_constant_to_xmm(int xmm, double constant) {
+    int64_t bits;
+    std::memcpy(&bits, &constant, sizeof(bits));
+    if (bits == 0) {
+        buffer_.emit_xorpd(xmm, xmm);
+        return;
+    }
+    // mov rax, imm64 (the double bits); movq xmm, rax
+    buffer_.emit_mov_reg_imm64(static_cast<int>(Register::RAX), bits);
+    buffer_.emit_movq_xmm_reg(xmm, static_cast<int>(Register::RAX));
 }
 
 void JitCompiler::compile_instruction(const ir::SsaInstruction& inst, const ir::SsaBlock& block, const ir::SsaFunction& function) {
-    if (inst.opcode == "literal") {
-        // Load immediate double value directly into XMM0, then store to stack
-        double val = 0.0;
-        if (!inst.immediates.empty()) {
-            const std::string& lit = inst.immediates[0];
-            if (lit == "true") {
-                val = 1.0;
-            } else if (lit == "false") {
-                val = 0.0;
-            } else {
-                try {
-                    val = std::stod(lit);
-                } catch (const std::exception& e) {
-                    // Invalid literal format, default to 0.0
-                    val = 0.0;
-                }
-            }
+    const int rax = static_cast<int>(Register::RAX);
+
+    switch (inst.op) {
+    case ir::SsaOpcode::Literal: {
+        if (!inst.result.has_value()) {
+            return;
         }
-        
-        if (inst.result.has_value()) {
-            // Load double constant into XMM0 using movsd from memory
-            // We'll store the constant in the code and load it
-            // First, allocate space for the constant
-            int32_t offset = get_value_offset(*inst.result);
-            
-            // Move the double bits to RAX, then to memory, then load to XMM
+        const double val = inst.number.value_or(0.0);
+        const ValueLocation* location = find_location(*inst.result);
+        if (location == nullptr) {
+            return;
+        }
+        if (location->is_register()) {
+            load_constant_to_xmm(location->reg, val);
+        } else {
+            // Store the double bits straight to the spill slot
             int64_t bits;
             std::memcpy(&bits, &val, sizeof(bits));
-            
-            // mov rax, imm64 (the double bits)
-            buffer_.emit_mov_reg_imm64(static_cast<int>(Register::RAX), bits);
-            
-            // mov [rbp + offset], rax (store the double bits to stack)
-            buffer_.emit({0x48, 0x89, 0x85});  // mov [rbp + disp32], rax
-            buffer_.emit(static_cast<uint8_t>(offset & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((offset >> 8) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((offset >> 16) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((offset >> 24) & 0xFF));
-            
-            // Now load it into XMM0 for consistency (though we could skip this)
-            // movsd xmm0, [rbp + offset]
-            buffer_.emit_movsd_xmm_mem(0, static_cast<int>(Register::RBP), offset);
-        }
-    }
-    else if (inst.opcode == "binary") {
-        if (inst.arguments.size() < 2 || inst.immediates.empty()) {
+            buffer_.emit_mov_reg_imm64(rax, bits);
+            buffer_.emit_mov_mem_reg(static_cast<int>(Register::RBP), location->offset, rax);
+        }
+        break;
+    }
+    case ir::SsaOpcode::Binary: {
+        if (inst.arguments.size() < 2) {
             return;
         }
-        
-        load_value_to_xmm(0, inst.arguments[0]);
-        load_value_to_xmm(1, inst.arguments[1]);
-        
-        const std::string& op = inst.immediates[0];
-        
-        if (op == "+") {
-            buffer_.emit_addsd(0, 1);
-        } else if (op == "-") {
-            buffer_.emit_subsd(0, 1);
-        } else if (op == "*") {
-            buffer_.emit_mulsd(0, 1);
-        } else if (op == "/") {
-            buffer_.emit_divsd(0, 1);
-        } else if (op == "%") {
-            // Modulo for doubles: a % b = a - floor(a/b) * b
-            // xmm0 = a, xmm1 = b
-            // Save xmm0 (a) to xmm2
-            buffer_.emit({0xF2, 0x0F, 0x10, 0xD0});  // movsd xmm2, xmm0
-            // Save xmm1 (b) to xmm3
-            buffer_.emit({0xF2, 0x0F, 0x10, 0xD9});  // movsd xmm3, xmm1
-            // xmm0 = a / b
-            buffer_.emit_divsd(0, 1);
-            // Convert to int64 (truncates toward zero), then back to double = floor for positive
-            // cvttsd2si rax, xmm0  (truncate to integer)
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2C, 0xC0});
-            // cvtsi2sd xmm0, rax   (convert back to double)
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});
-            // xmm0 = floor(a/b) * b
-            buffer_.emit_mulsd(0, 3);
-            // xmm2 = a - floor(a/b)*b
-            buffer_.emit({0xF2, 0x0F, 0x5C, 0xD0});  // subsd xmm2, xmm0
-            // Move result to xmm0
-            buffer_.emit({0xF2, 0x0F, 0x10, 0xC2});  // movsd xmm0, xmm2
-        } else if (op == "&&") {
-            // Logical AND: (a != 0) && (b != 0)
-            // Zero RAX
-            buffer_.emit_xor_reg_reg(static_cast<int>(Register::RAX), static_cast<int>(Register::RAX));
-            // Zero xmm2 for comparison
-            buffer_.emit({0x0F, 0x57, 0xD2});  // xorps xmm2, xmm2
-            // Compare xmm0 with 0
-            buffer_.emit_ucomisd(0, 2);
-            // Set CL = (xmm0 != 0) using setne
-            buffer_.emit({0x0F, 0x95, 0xC1});  // setne cl
-            // Compare xmm1 with 0
-            buffer_.emit_ucomisd(1, 2);
-            // Set AL = (xmm1 != 0) using setne
-            buffer_.emit_setne(0);
-            // AL = AL & CL
-            buffer_.emit({0x20, 0xC8});  // and al, cl
-            // Convert AL to double
-            buffer_.emit({0x48, 0x0F, 0xB6, 0xC0});  // movzx rax, al
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});  // cvtsi2sd xmm0, rax
-        } else if (op == "||") {
-            // Logical OR: (a != 0) || (b != 0)
-            // Zero RAX
-            buffer_.emit_xor_reg_reg(static_cast<int>(Register::RAX), static_cast<int>(Register::RAX));
-            // Zero xmm2 for comparison
-            buffer_.emit({0x0F, 0x57, 0xD2});  // xorps xmm2, xmm2
-            // Compare xmm0 with 0
-            buffer_.emit_ucomisd(0, 2);
-            // Set CL = (xmm0 != 0) using setne
+
+        const ir::BinaryOp op = inst.binary_op;
+        const ir::SsaValue& lhs = inst.arguments[0];
+        const ir::SsaValue& rhs = inst.arguments[1];
+        const int dst = inst.result.has_value() ? result_register(*inst.result, kScratch0) : kScratch0;
+
+        if (op == ir::BinaryOp::Add || op == ir::BinaryOp::Sub || op == ir::BinaryOp::Mul || op == ir::BinaryOp::Div) {
+            // dst = lhs; dst op= rhs. The rhs must not live in dst, or loading lhs would clobber it.
+            int rhs_reg = operand_register(rhs, kScratch1);
+            if (rhs_reg == dst) {
+                buffer_.emit_movapd(kScratch1, rhs_reg);
+                rhs_reg = kScratch1;
+            }
+            if (op == ir::BinaryOp::Div && calls_ != nullptr && calls_->trap != nullptr &&
+                !(facts_.has_value() && facts_->safe_divisor(rhs))) {
+                emit_zero_divisor_check(rhs_reg);
+            }
+            load_value_to_xmm(dst, lhs);
+            if (op == ir::BinaryOp::Add) {
+                buffer_.emit_addsd(dst, rhs_reg);
+            } else if (op == ir::BinaryOp::Sub) {
+                buffer_.emit_subsd(dst, rhs_reg);
+            } else if (op == ir::BinaryOp::Mul) {
+                buffer_.emit_mulsd(dst, rhs_reg);
+            } else {
+                buffer_.emit_divsd(dst, rhs_reg);
+            }
+        } else if (op == ir::BinaryOp::Mod && calls_ != nullptr && calls_->trap != nullptr) {
+            emit_integer_remainder(inst, dst);
+        } else if (op == ir::BinaryOp::Mod) {
+            // Without a trap handler: a % b = a - trunc(a/b) * b in doubles
+            load_value_to_xmm(kScratch0, lhs);
+            load_value_to_xmm(kScratch1, rhs);
+            buffer_.emit_divsd(kScratch0, kScratch1);
+            // Convert to int64 (truncates toward zero), then back to double
+            buffer_.emit_cvttsd2si(rax, kScratch0);
+            buffer_.emit_cvtsi2sd(kScratch0, rax);
+            // xmm1 = trunc(a/b) * b
+            buffer_.emit_mulsd(kScratch1, kScratch0);
+            // dst = a - trunc(a/b) * b (a is still intact in its own location)
+            load_value_to_xmm(kScratch0, lhs);
+            buffer_.emit_subsd(kScratch0, kScratch1);
+            if (dst != kScratch0) {
+                buffer_.emit_movapd(dst, kScratch0);
+            }
+        } else if (op == ir::BinaryOp::And || op == ir::BinaryOp::Or) {
+            // Logical AND/OR: (a != 0) op (b != 0)
+            buffer_.emit_xor_reg_reg(rax, rax);
+            buffer_.emit_xorpd(kScratch1, kScratch1);  // zero for comparison
+            buffer_.emit_ucomisd(operand_register(lhs, kScratch0), kScratch1);
             buffer_.emit({0x0F, 0x95, 0xC1});  // setne cl
-            // Compare xmm1 with 0
-            buffer_.emit_ucomisd(1, 2);
-            // Set AL = (xmm1 != 0) using setne
-            buffer_.emit_setne(0);
-            // AL = AL | CL
-            buffer_.emit({0x08, 0xC8});  // or al, cl
-            // Convert AL to double
+            buffer_.emit_ucomisd(operand_register(rhs, kScratch0), kScratch1);
+            buffer_.emit_setne(0);  // setne al
+            if (op == ir::BinaryOp::And) {
+                buffer_.emit({0x20, 0xC8});  // and al, cl
+            } else {
+                buffer_.emit({0x08, 0xC8});  // or al, cl
+            }
             buffer_.emit({0x48, 0x0F, 0xB6, 0xC0});  // movzx rax, al
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});  // cvtsi2sd xmm0, rax
-        } else if (op == "<" || op == "<=" || op == ">" || op == ">=" ||
-                   op == "==" || op == "!=") {
+            buffer_.emit_cvtsi2sd(dst, rax);
+        } else if (is_comparison(inst)) {
             // Zero RAX first (before ucomisd, so flags aren't affected)
-            buffer_.emit_xor_reg_reg(static_cast<int>(Register::RAX),
-                                     static_cast<int>(Register::RAX));
-            // Compare xmm0 and xmm1, setting flags
-            buffer_.emit_ucomisd(0, 1);
-            
-            if (op == "<") {
-                buffer_.emit_setb(0);  // al = (xmm0 < xmm1)
-            } else if (op == "<=") {
-                buffer_.emit_setbe(0);
-            } else if (op == ">") {
-                buffer_.emit_seta(0);
-            } else if (op == ">=") {
-                buffer_.emit_setae(0);
-            } else if (op == "==") {
-                buffer_.emit_sete(0);
-            } else if (op == "!=") {
-                buffer_.emit_setne(0);
-            }
-            
-            // Convert al to double in xmm0
-            // cvtsi2sd xmm0, rax
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});
-        }
-        
+            buffer_.emit_xor_reg_reg(rax, rax);
+            const Condition condition = emit_compare(inst);
+            switch (condition.test) {
+            case FlagTest::Equal:
+                condition.negated ? buffer_.emit_setne(0) : buffer_.emit_sete(0);
+                break;
+            case FlagTest::Above:
+                condition.negated ? buffer_.emit_setbe(0) : buffer_.emit_seta(0);
+                break;
+            case FlagTest::AboveOrEqual:
+                condition.negated ? buffer_.emit_setb(0) : buffer_.emit_setae(0);
+                break;
+            case FlagTest::OrderedEqual:
+                // al = ZF && !PF, or ZF == 0 || PF when negated
+                if (condition.negated) {
+                    buffer_.emit_setne(0);
+                    buffer_.emit_setp(1);
+                    buffer_.emit({0x08, 0xC8});  // or al, cl
+                } else {
+                    buffer_.emit_sete(0);
+                    buffer_.emit_setnp(1);
+                    buffer_.emit({0x20, 0xC8});  // and al, cl
+                }
+                break;
+            }
+            buffer_.emit_cvtsi2sd(dst, rax);
+        } else {
+            return;
+        }
+
         if (inst.result.has_value()) {
-            store_xmm_to_value(*inst.result, 0);
+            store_xmm_to_value(*inst.result, dst);
         }
+        break;
     }
-    else if (inst.opcode == "unary") {
-        if (inst.arguments.empty() || inst.immediates.empty()) {
+    case ir::SsaOpcode::Unary: {
+        if (inst.arguments.empty()) {
             return;
         }
-        
-        load_value_to_xmm(0, inst.arguments[0]);
-        
-        const std::string& op = inst.immediates[0];
-        
-        if (op == "-") {
-            // Negate: xorps xmm0, sign_mask (flip sign bit)
-            // Sign mask for double: 0x8000000000000000
-            // Load sign mask into RAX, store to stack, load to XMM1, then xorpd
-            int64_t sign_mask = static_cast<int64_t>(0x8000000000000000ULL);
-            buffer_.emit_mov_reg_imm64(static_cast<int>(Register::RAX), sign_mask);
-            
-            // Store to temporary location on stack (use a fixed offset beyond locals)
-            // We can use [rbp - (stack_size + 8)] as temp
-            int32_t temp_offset = -static_cast<int32_t>(stack_size_ + 8);
-            buffer_.emit({0x48, 0x89, 0x85});  // mov [rbp + disp32], rax
-            buffer_.emit(static_cast<uint8_t>(temp_offset & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 8) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 16) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 24) & 0xFF));
-            
-            // movsd xmm1, [rbp + temp_offset]
-            buffer_.emit_movsd_xmm_mem(1, static_cast<int>(Register::RBP), temp_offset);
-            
-            // xorpd xmm0, xmm1 (flip sign bit)
-            buffer_.emit({0x66, 0x0F, 0x57, 0xC1});
-        }
-        else if (op == "!") {
+
+        const ir::UnaryOp op = inst.unary_op;
+        const int dst = inst.result.has_value() ? result_register(*inst.result, kScratch0) : kScratch0;
+
+        if (op == ir::UnaryOp::Neg) {
+            // Negate: flip the sign bit with xorpd against 0x8000000000000000
+            load_value_to_xmm(dst, inst.arguments[0]);
+            buffer_.emit_mov_reg_imm64(rax, static_cast<int64_t>(0x8000000000000000ULL));
+            buffer_.emit_movq_xmm_reg(kScratch1, rax);
+            buffer_.emit_xorpd(dst, kScratch1);
+        }
+        else if (op == ir::UnaryOp::Not) {
             // Logical not: 0.0 -> 1.0, non-zero -> 0.0
-            // Compare with zero, set AL, convert to double
-            buffer_.emit_xor_reg_reg(static_cast<int>(Register::RAX),
-                                     static_cast<int>(Register::RAX));
-            buffer_.emit({0x0F, 0x57, 0xC9});  // xorps xmm1, xmm1 (zero)
-            buffer_.emit_ucomisd(0, 1);
-            buffer_.emit_sete(0);  // AL = 1 if XMM0 == 0.0
-            // cvtsi2sd xmm0, rax
-            buffer_.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});
-        }
-        
+            const int src = operand_register(inst.arguments[0], kScratch0);
+            buffer_.emit_xor_reg_reg(rax, rax);
+            buffer_.emit_xorpd(kScratch1, kScratch1);
+            buffer_.emit_ucomisd(src, kScratch1);
+            buffer_.emit_sete(0);  // AL = 1 if src == 0.0
+            buffer_.emit_cvtsi2sd(dst, rax);
+        } else {
+            return;
+        }
+
         if (inst.result.has_value()) {
-            store_xmm_to_value(*inst.result, 0);
+            store_xmm_to_value(*inst.result, dst);
         }
+        break;
     }
-    else if (inst.opcode == "assign") {
+    case ir::SsaOpcode::Assign:
         if (!inst.arguments.empty() && inst.result.has_value()) {
-            load_value_to_xmm(0, inst.arguments[0]);
-            store_xmm_to_value(*inst.result, 0);
+            const ValueLocation* dst = find_location(*inst.result);
+            const ValueLocation* src = find_location(inst.arguments[0]);
+            if (dst != nullptr && src != nullptr) {
+                emit_move(*dst, *src);
+            } else if (dst != nullptr) {
+                load_value_to_xmm(kScratch0, inst.arguments[0]);
+                store_xmm_to_value(*inst.result, kScratch0);
+            }
         }
-    }
-    else if (inst.opcode == "branch") {
+        break;
+    case ir::SsaOpcode::Branch:
         // Unconditional jump to target block
         if (!inst.immediates.empty()) {
-            const std::string& target = inst.immediates[0];
-            // Emit phi moves before the jump
-            emit_phi_moves(target);
-            // Emit jmp rel32 placeholder
-            buffer_.emit_jmp_rel32(0);
-            // Record position for patching
-            pending_jumps_.emplace_back(buffer_.position() - 4, target);
-        }
-    }
-    else if (inst.opcode == "branch_if") {
-        // branch_if condition | target compare_val
-        // Jump to target if condition == compare_val, else fallthrough to next successor
-        if (inst.arguments.empty() || inst.immediates.empty()) {
-            return;
-        }
-        
-        const std::string& target_label = inst.immediates[0];
-        double compare_val = 0.0;
-        if (inst.immediates.size() >= 2) {
-            try {
-                compare_val = std::stod(inst.immediates[1]);
-            } catch (const std::exception& e) {
-                // Invalid compare value format, default to 0.0
-                compare_val = 0.0;
-            }
-        }
-        
-        // Find fallthrough block (the successor that is not the target)
-        std::string fallthrough_label;
-        for (std::size_t succ_id : block.successors) {
-            if (succ_id < function.blocks.size()) {
-                const auto& succ_block = function.blocks[succ_id];
-                if (succ_block.name != target_label) {
-                    fallthrough_label = succ_block.name;
-                    break;
-                }
-            }
+            emit_jump_to_block(inst.immediates[0], true);
         }
-        
-        // Load condition value to XMM0
-        load_value_to_xmm(0, inst.arguments[0]);
-        
-        // Load compare_val to XMM1
-        if (compare_val == 0.0) {
-            buffer_.emit({0x0F, 0x57, 0xC9});  // xorps xmm1, xmm1
-        } else {
-            // Load compare_val as constant
-            int64_t bits;
-            std::memcpy(&bits, &compare_val, sizeof(bits));
-            buffer_.emit_mov_reg_imm64(static_cast<int>(Register::RAX), bits);
-            int32_t temp_offset = -static_cast<int32_t>(stack_size_ + 8);
-            buffer_.emit({0x48, 0x89, 0x85});  // mov [rbp + disp32], rax
-            buffer_.emit(static_cast<uint8_t>(temp_offset & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 8) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 16) & 0xFF));
-            buffer_.emit(static_cast<uint8_t>((temp_offset >> 24) & 0xFF));
-            buffer_.emit_movsd_xmm_mem(1, static_cast<int>(Register::RBP), temp_offset);
-        }
-        
-        buffer_.emit_ucomisd(0, 1);
-        
-        // je target_label (jump if condition == compare_val)
-        // But first we need to emit phi moves for both paths
-        // Problem: je takes the target block, not fallthrough
-        
-        // Strategy: 
-        // 1. je to "take_branch" code
-        // 2. Fallthrough: emit phi moves for fallthrough, jmp to fallthrough block
-        // 3. take_branch: emit phi moves for target, jmp to target block
-        
-        buffer_.emit_je_rel32(0);
-        size_t branch_jump_pos = buffer_.position() - 4;
-        
-        // Fallthrough path (condition != compare_val)
-        if (!fallthrough_label.empty()) {
-            emit_phi_moves(fallthrough_label);
-            buffer_.emit_jmp_rel32(0);
-            pending_jumps_.emplace_back(buffer_.position() - 4, fallthrough_label);
-        }
-        
-        // Branch taken path (condition == compare_val)
-        buffer_.patch_rel32(branch_jump_pos, static_cast<int32_t>(buffer_.position() - branch_jump_pos - 4));
-        emit_phi_moves(target_label);
-        buffer_.emit_jmp_rel32(0);
-        pending_jumps_.emplace_back(buffer_.position() - 4, target_label);
-    }
-    else if (inst.opcode == "return") {
+        break;
+    case ir::SsaOpcode::BranchIf:
+        emit_branch_if(inst, block, function);
+        break;
+    case ir::SsaOpcode::Call:
+        emit_call(inst, ir::is_tail_call(block, current_instruction_));
+        break;
+    case ir::SsaOpcode::Drop:
+        // Discarded expression statement: the value was already computed
+        break;
+    case ir::SsaOpcode::ArrayGet:
+        emit_array_get(inst);
+        break;
+    case ir::SsaOpcode::ArraySet:
+        emit_array_set(inst);
+        break;
+    case ir::SsaOpcode::ArrayLength:
+        emit_array_length(inst);
+        break;
+    case ir::SsaOpcode::FieldGet:
+        emit_field_get(inst);
+        break;
+    case ir::SsaOpcode::FieldSet:
+        emit_field_set(inst);
+        break;
+    case ir::SsaOpcode::Return:
         if (!inst.arguments.empty()) {
-            load_value_to_xmm(0, inst.arguments[0]);
+            load_value_to_xmm(kScratch0, inst.arguments[0]);
         } else {
             // No return value - set XMM0 to 0.0
-            // xorps xmm0, xmm0 (faster than loading from memory)
-            buffer_.emit({0x0F, 0x57, 0xC0});  // xorps xmm0, xmm0
+            buffer_.emit_xorpd(kScratch0, kScratch0);
         }
         emit_epilogue();
+        break;
+    default:
+        break;
+    }
+}
+
+auto JitCompiler::is_comparison(const ir::SsaInstruction& inst) -> bool {
+    if (inst.op != ir::SsaOpcode::Binary || inst.arguments.size() < 2) {
+        return false;
+    }
+    switch (inst.binary_op) {
+    case ir::BinaryOp::Lt:
+    case ir::BinaryOp::Le:
+    case ir::BinaryOp::Gt:
+    case ir::BinaryOp::Ge:
+    case ir::BinaryOp::Eq:
+    case ir::BinaryOp::Ne:
+        return true;
+    default:
+        return false;
     }
 }
 
+auto JitCompiler::emit_compare(const ir::SsaInstruction& inst) -> Condition {
+    // a < b is tested as b > a (and a <= b as b >= a): "above" is false for unordered operands,
+    // where "below" would be true
+    const ir::BinaryOp op = inst.binary_op;
+    const bool swap = op == ir::BinaryOp::Lt || op == ir::BinaryOp::Le;
+    const int first = operand_register(inst.arguments[swap ? 1 : 0], kScratch0);
+    const int second = operand_register(inst.arguments[swap ? 0 : 1], kScratch1);
+    buffer_.emit_ucomisd(first, second);
+    if (op == ir::BinaryOp::Lt || op == ir::BinaryOp::Gt) {
+        return Condition{FlagTest::Above, false};
+    }
+    if (op == ir::BinaryOp::Le || op == ir::BinaryOp::Ge) {
+        return Condition{FlagTest::AboveOrEqual, false};
+    }
+    return Condition{FlagTest::OrderedEqual, op == ir::BinaryOp::Ne};
+}
+
+void JitCompiler::emit_condition_jump(Condition condition, const std::string& label) {
+    switch (condition.test) {
+    case FlagTest::Equal:
+        emit_jump_to_label(condition.negated ? kJumpIfNotEqual : kJumpIfEqual, label);
+        break;
+    case FlagTest::Above:
+        emit_jump_to_label(condition.negated ? kJumpIfBelowOrEqual : kJumpIfAbove, label);
+        break;
+    case FlagTest::AboveOrEqual:
+        emit_jump_to_label(condition.negated ? kJumpIfBelow : kJumpIfAboveOrEqual, label);
+        break;
+    case FlagTest::OrderedEqual:
+        if (condition.negated) {
+            emit_jump_to_label(kJumpIfParity, label);
+            emit_jump_to_label(kJumpIfNotEqual, label);
+        } else {
+            // Skip the je when unordered
+            buffer_.emit_jcc_rel8(kJumpIfParity, 0);
+            const size_t skip_pos = buffer_.position() - 1;
+            emit_jump_to_label(kJumpIfEqual, label);
+            buffer_.patch_rel8(skip_pos, static_cast<int8_t>(buffer_.position() - skip_pos - 1));
+        }
+        break;
+    }
+}
+
+void JitCompiler::emit_branch_if(const ir::SsaInstruction& inst, const ir::SsaBlock& block,
+                                 const ir::SsaFunction& function) {
+    // branch_if condition | target compare_val
+    // Jump to target if condition == compare_val, else fallthrough to next successor
+    const ir::SsaInstruction* compare = fused_compare_;
+    fused_compare_ = nullptr;
+    if (inst.arguments.empty() || inst.immediates.empty()) {
+        return;
+    }
+
+    const std::string& target_label = inst.immediates[0];
+    const double compare_val = inst.number.value_or(0.0);
+
+    // Find fallthrough block (the successor that is not the target)
+    std::string fallthrough_label;
+    for (std::size_t succ_id : block.successors) {
+        if (succ_id < function.blocks.size()) {
+            const auto& succ_block = function.blocks[succ_id];
+            if (succ_block.name != target_label) {
+                fallthrough_label = succ_block.name;
+                break;
+            }
+        }
+    }
+    if (fallthrough_label.empty()) {
+        emit_jump_to_block(target_label, true);
+        return;
+    }
+
+    // The condition under which the target edge is taken. A fused comparison is 1.0 when it
+    // holds, so compare_val is 0 or 1 for it.
+    Condition taken;
+    if (compare != nullptr) {
+        taken = emit_compare(*compare);
+        taken.negated = taken.negated != (compare_val == 0.0);
+    } else {
+        const int cond_reg = operand_register(inst.arguments[0], kScratch0);
+        load_constant_to_xmm(kScratch1, compare_val);
+        buffer_.emit_ucomisd(cond_reg, kScratch1);
+        taken = Condition{FlagTest::Equal, false};
+    }
+
+    // Lay out last the edge into the block that comes next, which then needs no jump. The other
+    // edge is a conditional jump: straight to its block when it has no phi moves, otherwise to
+    // an out-of-line stub making them.
+    const bool target_last = target_label == next_block_;
+    const std::string& last = target_last ? target_label : fallthrough_label;
+    const std::string& other = target_last ? fallthrough_label : target_label;
+    Condition to_other = taken;
+    to_other.negated = taken.negated != target_last;
+    if (edge_has_code(other)) {
+        const std::string stub = "$edge" + std::to_string(deferred_edges_.size());
+        deferred_edges_.push_back(DeferredEdge{stub, current_block_id_, other});
+        emit_condition_jump(to_other, stub);
+    } else {
+        emit_condition_jump(to_other, jump_label(other));
+    }
+    emit_jump_to_block(last, true);
+}
+
+void JitCompiler::emit_call(const ir::SsaInstruction& inst, bool tail) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rbp = static_cast<int>(Register::RBP);
+
+    if (calls_ == nullptr || inst.immediates.empty()) {
+        failed_ = true;
+        return;
+    }
+    if (const JitMathSignature* math = find_jit_math(inst.immediates[0])) {
+        emit_math(inst, *math);
+        return;
+    }
+    // Builtins with a native are called straight; everything else goes through its slot
+    const JitNativeSignature* native = find_jit_native(inst.immediates[0]);
+    std::size_t slot = 0;
+    if (native != nullptr) {
+        if (calls_->natives[static_cast<std::size_t>(native->id)] == nullptr || inst.arguments.size() != native->arity) {
+            failed_ = true;
+            return;
+        }
+    } else {
+        const auto slot_it = calls_->slots.find(inst.immediates[0]);
+        if (calls_->trampoline == nullptr || slot_it == calls_->slots.end() ||
+            slot_it->second >= calls_->entries.size()) {
+            failed_ = true;
+            return;
+        }
+        slot = slot_it->second;
+        if (tail && incoming_args_offset_ != 0 && inst.arguments.size() <= incoming_args_) {
+            emit_tail_jump(inst, slot);
+        }
+    }
+
+    // Marshal arguments into the outgoing args array at the bottom of the frame
+    for (std::size_t i = 0; i < inst.arguments.size(); ++i) {
+        const int reg = operand_register(inst.arguments[i], kScratch0);
+        buffer_.emit_movsd_mem_xmm(rbp, outgoing_args_offset_ + static_cast<int32_t>(i * 8), reg);
+    }
+
+    const std::vector<int>* preserved = nullptr;
+    if (auto it = allocation_.preserved_across_calls.find(&inst); it != allocation_.preserved_across_calls.end()) {
+        preserved = &it->second;
+        for (const int reg : *preserved) {
+            buffer_.emit_movsd_mem_xmm(rbp, register_saves_.at(reg), reg);
+        }
+    }
+
+    if (native != nullptr) {
+        const auto id = static_cast<std::size_t>(native->id);
+        buffer_.emit_mov_reg_address(rax, reinterpret_cast<const void*>(calls_->natives[id]), JitRelocationKind::Native,
+                                     id);
+        buffer_.emit_lea_reg_mem(kArgReg0, rbp, outgoing_args_offset_);
+        buffer_.emit_call_reg(rax);
+    } else {
+        emit_slot_call(slot);
+    }
+
+    // Bail out if the callee (or anything below it) failed
+    const int rcx = static_cast<int>(Register::RCX);
+    buffer_.emit_movq_reg_xmm(rax, kScratch0);
+    buffer_.emit_mov_reg_imm64(rcx, static_cast<int64_t>(kJitUnwindBits));
+    buffer_.emit_cmp_reg_reg(rax, rcx);
+    buffer_.emit_je_rel32(0);
+    pending_jumps_.emplace_back(buffer_.position() - 4, kUnwindLabel);
+    needs_unwind_stub_ = true;
+
+    if (preserved != nullptr) {
+        for (const int reg : *preserved) {
+            buffer_.emit_movsd_xmm_mem(reg, rbp, register_saves_.at(reg));
+        }
+    }
+    if (inst.result.has_value()) {
+        store_xmm_to_value(*inst.result, kScratch0);
+    }
+}
+
+void JitCompiler::emit_math(const ir::SsaInstruction& inst, const JitMathSignature& math) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rbp = static_cast<int>(Register::RBP);
+    if (inst.arguments.size() != math.arity) {
+        failed_ = true;
+        return;
+    }
+    for (std::size_t i = 0; i < inst.arguments.size(); ++i) {
+        load_value_to_xmm(kScratch0 + static_cast<int>(i), inst.arguments[i]);
+    }
+
+    // Inline forms touch only the scratch registers and RAX
+    const bool rounds = math.id == JitMath::Floor || math.id == JitMath::Ceil;
+    if (math.id == JitMath::Sqrt) {
+        buffer_.emit_sqrtsd(kScratch0, kScratch0);
+    } else if (math.id == JitMath::Abs) {
+        buffer_.emit_mov_reg_imm64(rax, 0x7FFFFFFFFFFFFFFFLL);
+        buffer_.emit_movq_xmm_reg(kScratch1, rax);
+        buffer_.emit_andpd(kScratch0, kScratch1);
+    } else if (rounds && uses_sse41()) {
+        buffer_.emit_roundsd(kScratch0, kScratch0, math.id == JitMath::Floor ? 0x09 : 0x0A);
+    } else {
+        // The C library function, with the arguments already in XMM0 / XMM1
+        const std::vector<int>* preserved = nullptr;
+        if (auto it = allocation_.preserved_across_calls.find(&inst); it != allocation_.preserved_across_calls.end()) {
+            preserved = &it->second;
+            for (const int reg : *preserved) {
+                buffer_.emit_movsd_mem_xmm(rbp, register_saves_.at(reg), reg);
+            }
+        }
+        const auto id = static_cast<std::size_t>(math.id);
+        buffer_.emit_mov_reg_address(rax, jit_math_function(math.id), JitRelocationKind::Math, id);
+        buffer_.emit_call_reg(rax);
+        if (preserved != nullptr) {
+            for (const int reg : *preserved) {
+                buffer_.emit_movsd_xmm_mem(reg, rbp, register_saves_.at(reg));
+            }
+        }
+    }
+    if (inst.result.has_value()) {
+        store_xmm_to_value(*inst.result, kScratch0);
+    }
+}
+
+void JitCompiler::emit_slot_call(std::size_t slot) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rbp = static_cast<int>(Register::RBP);
+
+    // Fast path: the callee already has a native entry in its slot
+    buffer_.emit_mov_reg_address(rax, &calls_->entries[slot], JitRelocationKind::CallEntry, slot);
+    buffer_.emit_mov_reg_mem(rax, rax, 0);
+    buffer_.emit_test_reg_reg(rax, rax);
+    buffer_.emit_je_rel32(0);
+    const size_t slow_jump_pos = buffer_.position() - 4;
+    buffer_.emit_lea_reg_mem(kArgReg0, rbp, outgoing_args_offset_);
+    buffer_.emit_call_reg(rax);
+    buffer_.emit_jmp_rel32(0);
+    const size_t done_jump_pos = buffer_.position() - 4;
+
+    // Slow path: trampoline(table, slot, args) back into the runtime
+    buffer_.patch_rel32(slow_jump_pos, static_cast<int32_t>(buffer_.position() - slow_jump_pos - 4));
+    buffer_.emit_mov_reg_address(kArgReg0, calls_, JitRelocationKind::CallTable);
+    buffer_.emit_mov_reg_imm64(kArgReg1, static_cast<int64_t>(slot));
+    buffer_.emit_lea_reg_mem(kArgReg2, rbp, outgoing_args_offset_);
+    buffer_.emit_mov_reg_address(rax, reinterpret_cast<const void*>(calls_->trampoline), JitRelocationKind::Trampoline);
+    buffer_.emit_call_reg(rax);
+    buffer_.patch_rel32(done_jump_pos, static_cast<int32_t>(buffer_.position() - done_jump_pos - 4));
+}
+
+void JitCompiler::emit_tail_jump(const ir::SsaInstruction& inst, std::size_t slot) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rbp = static_cast<int>(Register::RBP);
+
+    // Nothing reads the incoming arguments after the prologue. Constants go through RAX, so the
+    // entry is loaded once they are all written.
+    buffer_.emit_mov_reg_mem(kArgReg0, rbp, incoming_args_offset_);
+    for (std::size_t i = 0; i < inst.arguments.size(); ++i) {
+        const int reg = operand_register(inst.arguments[i], kScratch0);
+        buffer_.emit_movsd_mem_xmm(kArgReg0, static_cast<int32_t>(i * 8), reg);
+    }
+    buffer_.emit_mov_reg_address(rax, &calls_->entries[slot], JitRelocationKind::CallEntry, slot);
+    buffer_.emit_mov_reg_mem(rax, rax, 0);
+    buffer_.emit_test_reg_reg(rax, rax);
+    buffer_.emit_je_rel32(0);
+    const size_t call_jump_pos = buffer_.position() - 4;
+    buffer_.emit_mov_rsp_rbp();
+    buffer_.emit_pop_rbp();
+    buffer_.emit_jmp_reg(rax);
+    buffer_.patch_rel32(call_jump_pos, static_cast<int32_t>(buffer_.position() - call_jump_pos - 4));
+}
+
+void JitCompiler::emit_trap_jump(uint8_t condition, JitTrap trap) {
+    // With an interpreter frame to go back to, a failed check deoptimises instead
+    if (osr_ != nullptr) {
+        if (const auto exit = osr_->find_exit(current_block_id_, current_instruction_, true)) {
+            buffer_.emit_jcc_rel32(condition, 0);
+            pending_jumps_.emplace_back(buffer_.position() - 4, osr_exit_label(*exit));
+            return;
+        }
+    }
+    buffer_.emit_jcc_rel32(condition, 0);
+    pending_jumps_.emplace_back(buffer_.position() - 4, trap_label(trap));
+    if (std::find(used_traps_.begin(), used_traps_.end(), trap) == used_traps_.end()) {
+        used_traps_.push_back(trap);
+    }
+}
+
+void JitCompiler::emit_trap_stubs() {
+    const int rax = static_cast<int>(Register::RAX);
+    for (const JitTrap trap : used_traps_) {
+        // trap(table, code), then leave through the shared unwind exit
+        label_positions_[trap_label(trap)] = buffer_.position();
+        buffer_.emit_mov_reg_address(kArgReg0, calls_, JitRelocationKind::CallTable);
+        buffer_.emit_mov_reg_imm64(kArgReg1, static_cast<int64_t>(trap));
+        buffer_.emit_mov_reg_address(rax, reinterpret_cast<const void*>(calls_->trap), JitRelocationKind::TrapHandler);
+        buffer_.emit_call_reg(rax);
+        buffer_.emit_jmp_rel32(0);
+        pending_jumps_.emplace_back(buffer_.position() - 4, kUnwindLabel);
+        needs_unwind_stub_ = true;
+    }
+}
+
+void JitCompiler::emit_load_array(const ir::SsaValue& array, std::optional<JitTrap> not_array) {
+    const int rax = static_cast<int>(Register::RAX);
+    buffer_.emit_movq_reg_xmm(rax, operand_register(array, kScratch1));
+    if (not_array.has_value()) {
+        buffer_.emit_test_reg_reg(rax, rax);
+        emit_trap_jump(kJumpIfEqual, *not_array);
+    }
+}
+
+auto JitCompiler::emit_array_kind_dispatch(std::optional<JitTrap> not_array) -> size_t {
+    const int rax = static_cast<int>(Register::RAX);
+    const JitArrayLayout& layout = calls_->arrays;
+
+    buffer_.emit_cmp_byte_mem_imm(rax, layout.object_kind, layout.float64_kind);
+    buffer_.emit_je_rel32(0);
+    const size_t float64_jump = buffer_.position() - 4;
+    if (not_array.has_value()) {
+        buffer_.emit_cmp_byte_mem_imm(rax, layout.object_kind, layout.array_kind);
+        emit_trap_jump(kJumpIfNotEqual, *not_array);
+    }
+    return float64_jump;
+}
+
+void JitCompiler::emit_array_index(const ir::SsaValue& index, std::optional<JitTrap> bad_index) {
+    if (!bad_index.has_value()) {
+        buffer_.emit_cvttsd2si(static_cast<int>(Register::RCX), operand_register(index, kScratch0));
+        return;
+    }
+    emit_integer_operand(index, static_cast<int>(Register::RCX), *bad_index);
+}
+
+void JitCompiler::emit_integer_operand(const ir::SsaValue& value, int reg, JitTrap trap) {
+    // Truncate, then require an exact round trip. Values proven integral skip the round trip:
+    // NaN, infinities and anything beyond int64 truncate to INT64_MIN, which the sign test catches.
+    const int value_reg = operand_register(value, kScratch0);
+    buffer_.emit_cvttsd2si(reg, value_reg);
+    buffer_.emit_test_reg_reg(reg, reg);
+    emit_trap_jump(kJumpIfSign, trap);
+    if (facts_.has_value() && facts_->integral(value)) {
+        return;
+    }
+    buffer_.emit_cvtsi2sd(kScratch1, reg);
+    buffer_.emit_ucomisd(kScratch1, value_reg);
+    emit_trap_jump(kJumpIfParity, trap);
+    emit_trap_jump(kJumpIfNotEqual, trap);
+}
+
+void JitCompiler::emit_zero_divisor_check(int divisor) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rcx = static_cast<int>(Register::RCX);
+
+    // |divisor| < the interpreter's epsilon: doubling the bits drops the sign, and the magnitudes
+    // below the epsilon are exactly the doubled bits below its own (NaN lies above)
+    std::uint64_t epsilon = 0;
+    std::memcpy(&epsilon, &ir::kEpsilon, sizeof(epsilon));
+    buffer_.emit_movq_reg_xmm(rax, divisor);
+    buffer_.emit_add_reg_reg(rax, rax);
+    buffer_.emit_mov_reg_imm64(rcx, static_cast<int64_t>(epsilon << 1U));
+    buffer_.emit_cmp_reg_reg(rax, rcx);
+    emit_trap_jump(kJumpIfBelow, JitTrap::DivisionByZero);
+}
+
+void JitCompiler::emit_integer_remainder(const ir::SsaInstruction& inst, int dst) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+
+    emit_integer_operand(inst.arguments[0], rax, JitTrap::ModuloBadOperands);
+    emit_integer_operand(inst.arguments[1], rcx, JitTrap::ModuloBadOperands);
+    buffer_.emit_test_reg_reg(rcx, rcx);
+    emit_trap_jump(kJumpIfEqual, JitTrap::ModuloBadOperands);
+    buffer_.emit_xor_reg_reg(rdx, rdx);
+    buffer_.emit_div_reg(rcx);
+    buffer_.emit_cvtsi2sd(dst, rdx);
+}
+
+void JitCompiler::emit_element_address(int32_t begin, int32_t end, int32_t element_size,
+                                       std::optional<JitTrap> out_of_bounds) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+    const int r11 = static_cast<int>(Register::R11);
+    if (!out_of_bounds.has_value()) {
+        buffer_.emit_mov_reg_mem(rdx, rax, begin);
+        buffer_.emit_imul_reg_imm32(rcx, element_size);
+        buffer_.emit_add_reg_reg(rdx, rcx);
+        return;
+    }
+
+    // rdx = byte length of the element storage. Checking the raw index against it first keeps
+    // the scaled index below from overflowing.
+    buffer_.emit_mov_reg_mem(r11, rax, begin);
+    buffer_.emit_mov_reg_mem(rdx, rax, end);
+    buffer_.emit_sub_reg_reg(rdx, r11);
+    buffer_.emit_cmp_reg_reg(rcx, rdx);
+    emit_trap_jump(kJumpIfAboveOrEqual, *out_of_bounds);
+    buffer_.emit_imul_reg_imm32(rcx, element_size);
+    buffer_.emit_cmp_reg_reg(rcx, rdx);
+    emit_trap_jump(kJumpIfAboveOrEqual, *out_of_bounds);
+
+    buffer_.emit_mov_reg_reg(rdx, r11);
+    buffer_.emit_add_reg_reg(rdx, rcx);
+}
+
+void JitCompiler::emit_array_get(const ir::SsaInstruction& inst) {
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+    const int r11 = static_cast<int>(Register::R11);
+    if (calls_ == nullptr || calls_->trap == nullptr || !calls_->arrays.available || inst.arguments.size() != 2 ||
+        !inst.result.has_value()) {
+        failed_ = true;
+        return;
+    }
+    const JitArrayLayout& layout = calls_->arrays;
+    const bool proven = bounds_.has_value() && bounds_->in_bounds(inst);
+    const auto check = [&](JitTrap trap) { return proven ? std::nullopt : std::optional<JitTrap>(trap); };
+
+    emit_load_array(inst.arguments[0], check(JitTrap::ArrayGetNotArray));
+    emit_array_index(inst.arguments[1], check(JitTrap::ArrayGetBadIndex));
+    const size_t float64_jump = emit_array_kind_dispatch(check(JitTrap::ArrayGetNotArray));
+    const int dst = result_register(*inst.result, kScratch0);
+
+    // Compiled code only carries numbers, so any other element kind is reported rather than read
+    emit_element_address(layout.elements_begin, layout.elements_end, layout.element_size,
+                         check(JitTrap::ArrayGetOutOfBounds));
+    buffer_.emit_cmp_byte_mem_imm(rdx, layout.value_kind, layout.number_kind);
+    emit_trap_jump(kJumpIfNotEqual, JitTrap::ArrayGetNotNumeric);
+    buffer_.emit_movsd_xmm_mem(dst, rdx, layout.value_number);
+    buffer_.emit_jmp_rel32(0);
+    const size_t done_jump = buffer_.position() - 4;
+
+    // Float64 elements are the doubles themselves; a hole is the one pattern that is not a number
+    buffer_.patch_rel32(float64_jump, static_cast<int32_t>(buffer_.position() - float64_jump - 4));
+    emit_element_address(layout.numbers_begin, layout.numbers_end, static_cast<int32_t>(sizeof(double)),
+                         check(JitTrap::ArrayGetOutOfBounds));
+    buffer_.emit_mov_reg_mem(rcx, rdx, 0);
+    buffer_.emit_mov_reg_imm64(r11, static_cast<int64_t>(layout.hole_bits));
+    buffer_.emit_cmp_reg_reg(rcx, r11);
+    emit_trap_jump(kJumpIfEqual, JitTrap::ArrayGetNotNumeric);
+    buffer_.emit_movq_xmm_reg(dst, rcx);
+
+    buffer_.patch_rel32(done_jump, static_cast<int32_t>(buffer_.position() - done_jump - 4));
+    store_xmm_to_value(*inst.result, dst);
+}
+
+void JitCompiler::emit_array_set(const ir::SsaInstruction& inst) {
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+    if (calls_ == nullptr || calls_->trap == nullptr || !calls_->arrays.available || inst.arguments.size() != 3) {
+        failed_ = true;
+        return;
+    }
+    const JitArrayLayout& layout = calls_->arrays;
+    const bool proven = bounds_.has_value() && bounds_->in_bounds(inst);
+    const auto check = [&](JitTrap trap) { return proven ? std::nullopt : std::optional<JitTrap>(trap); };
+
+    emit_load_array(inst.arguments[0], check(JitTrap::ArraySetNotArray));
+    emit_array_index(inst.arguments[1], check(JitTrap::ArraySetBadIndex));
+    const size_t float64_jump = emit_array_kind_dispatch(check(JitTrap::ArraySetNotArray));
+
+    // Overwrite the element with a number: kind, payload, and a cleared object pointer unless it
+    // shares the payload's storage
+    emit_element_address(layout.elements_begin, layout.elements_end, layout.element_size,
+                         check(JitTrap::ArraySetOutOfBounds));
+    int value_reg = operand_register(inst.arguments[2], kScratch0);
+    buffer_.emit_mov_byte_mem_imm(rdx, layout.value_kind, layout.number_kind);
+    buffer_.emit_movsd_mem_xmm(rdx, layout.value_number, value_reg);
+    if (layout.value_object != layout.value_number) {
+        buffer_.emit_xor_reg_reg(rcx, rcx);
+        buffer_.emit_mov_mem_reg(rdx, layout.value_object, rcx);
+    }
+    buffer_.emit_jmp_rel32(0);
+    const size_t done_jump = buffer_.position() - 4;
+
+    // Float64 elements take the double as is: arithmetic never produces the hole's signalling NaN
+    buffer_.patch_rel32(float64_jump, static_cast<int32_t>(buffer_.position() - float64_jump - 4));
+    emit_element_address(layout.numbers_begin, layout.numbers_end, static_cast<int32_t>(sizeof(double)),
+                         check(JitTrap::ArraySetOutOfBounds));
+    value_reg = operand_register(inst.arguments[2], kScratch0);
+    buffer_.emit_movsd_mem_xmm(rdx, 0, value_reg);
+
+    buffer_.patch_rel32(done_jump, static_cast<int32_t>(buffer_.position() - done_jump - 4));
+    if (inst.result.has_value()) {
+        store_xmm_to_value(*inst.result, value_reg);
+    }
+}
+
+void JitCompiler::emit_array_length(const ir::SsaInstruction& inst) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+    const int r11 = static_cast<int>(Register::R11);
+    if (calls_ == nullptr || calls_->trap == nullptr || !calls_->arrays.available || inst.arguments.size() != 1 ||
+        !inst.result.has_value() || calls_->arrays.element_size <= 0) {
+        failed_ = true;
+        return;
+    }
+    const JitArrayLayout& layout = calls_->arrays;
+
+    emit_load_array(inst.arguments[0], JitTrap::ArrayLengthNotArray);
+    const size_t float64_jump = emit_array_kind_dispatch(JitTrap::ArrayLengthNotArray);
+    buffer_.emit_mov_reg_mem(rdx, rax, layout.elements_end);
+    buffer_.emit_mov_reg_mem(r11, rax, layout.elements_begin);
+    buffer_.emit_sub_reg_reg(rdx, r11);
+
+    // Byte length / element size without a div: the length is an exact multiple, so divide
+    // out the power of two with a shift and the odd factor with its inverse modulo 2^64
+    auto size = static_cast<std::uint64_t>(layout.element_size);
+    uint8_t shift = 0;
+    while ((size & 1U) == 0) {
+        size >>= 1U;
+        ++shift;
+    }
+    if (shift != 0) {
+        buffer_.emit_shr_reg_imm8(rdx, shift);
+    }
+    if (size != 1) {
+        buffer_.emit_mov_reg_imm64(rcx, static_cast<int64_t>(inverse_mod_2_64(size)));
+        buffer_.emit_imul_reg_reg(rdx, rcx);
+    }
+    buffer_.emit_jmp_rel32(0);
+    const size_t done_jump = buffer_.position() - 4;
+
+    buffer_.patch_rel32(float64_jump, static_cast<int32_t>(buffer_.position() - float64_jump - 4));
+    buffer_.emit_mov_reg_mem(rdx, rax, layout.numbers_end);
+    buffer_.emit_mov_reg_mem(r11, rax, layout.numbers_begin);
+    buffer_.emit_sub_reg_reg(rdx, r11);
+    buffer_.emit_shr_reg_imm8(rdx, 3);
+
+    buffer_.patch_rel32(done_jump, static_cast<int32_t>(buffer_.position() - done_jump - 4));
+    const int dst = result_register(*inst.result, kScratch0);
+    buffer_.emit_cvtsi2sd(dst, rdx);
+    store_xmm_to_value(*inst.result, dst);
+}
+
+auto JitCompiler::emit_load_struct(const ir::SsaInstruction& inst, JitTrap not_struct) -> std::optional<int32_t> {
+    const int rax = static_cast<int>(Register::RAX);
+    if (calls_ == nullptr || calls_->trap == nullptr || !calls_->arrays.available || inst.arguments.empty() ||
+        inst.immediates.size() != 2) {
+        return std::nullopt;
+    }
+    const auto structure = calls_->structs.find(inst.immediates[0]);
+    if (structure == calls_->structs.end()) {
+        return std::nullopt;
+    }
+    const auto field = structure->second.numeric_fields.find(inst.immediates[1]);
+    if (field == structure->second.numeric_fields.end()) {
+        return std::nullopt;
+    }
+    const JitArrayLayout& layout = calls_->arrays;
+
+    emit_load_array(inst.arguments[0], not_struct);
+    buffer_.emit_cmp_byte_mem_imm(rax, layout.object_kind, layout.struct_kind);
+    emit_trap_jump(kJumpIfNotEqual, not_struct);
+    buffer_.emit_cmp_dword_mem_imm(rax, layout.object_shape, structure->second.shape);
+    emit_trap_jump(kJumpIfNotEqual, not_struct);
+    return layout.struct_numbers + static_cast<int32_t>(field->second * sizeof(double));
+}
+
+void JitCompiler::emit_field_get(const ir::SsaInstruction& inst) {
+    const int rax = static_cast<int>(Register::RAX);
+    const auto offset = inst.result.has_value() ? emit_load_struct(inst, JitTrap::FieldGetNotStruct) : std::nullopt;
+    if (!offset.has_value()) {
+        failed_ = true;
+        return;
+    }
+    const int dst = result_register(*inst.result, kScratch0);
+    buffer_.emit_movsd_xmm_mem(dst, rax, *offset);
+    store_xmm_to_value(*inst.result, dst);
+}
+
+void JitCompiler::emit_field_set(const ir::SsaInstruction& inst) {
+    const int rax = static_cast<int>(Register::RAX);
+    const auto offset = inst.arguments.size() == 2 ? emit_load_struct(inst, JitTrap::FieldSetNotStruct) : std::nullopt;
+    if (!offset.has_value()) {
+        failed_ = true;
+        return;
+    }
+    buffer_.emit_movsd_mem_xmm(rax, *offset, operand_register(inst.arguments[1], kScratch0));
+}
+
 void JitCompiler::compile_block(const ir::SsaBlock& block, const ir::SsaFunction& function) {
+    // Loop headers (targets of a backward jump) start aligned
+    const bool loop_header = std::any_of(block.predecessors.begin(), block.predecessors.end(),
+                                         [&](std::size_t pred) { return pred >= block.id; });
+    if (loop_header) {
+        buffer_.emit_nops((kLoopAlignment - buffer_.position() % kLoopAlignment) % kLoopAlignment);
+    }
     label_positions_[block.name] = buffer_.position();
     current_block_id_ = block.id;
-    
+
     // Phi nodes are handled during SSA deconstruction at branch sites
     // No code generated here for phi nodes
-    
-    // Compile instructions
+
+    // Compile instructions, up to the one a speculative plan stops before. A comparison read only
+    // by the branch_if right after it becomes that branch's flags instead of a value.
+    std::size_t count = block.instructions.size();
+    std::optional<std::size_t> stop;
+    for (std::size_t k = 0; osr_ != nullptr && k < osr_->exits.size(); ++k) {
+        const OsrExit& exit = osr_->exits[k];
+        if (exit.from == block.id && exit.instruction.has_value() && !exit.guard) {
+            stop = k;
+            count = *exit.instruction;
+        }
+    }
     bool has_terminator = false;
-    for (const auto& inst : block.instructions) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& inst = block.instructions[i];
+        current_instruction_ = i;
+        if (i + 1 < count && is_comparison(inst) && inst.result.has_value()) {
+            const auto& next = block.instructions[i + 1];
+            const auto uses = use_counts_.find(ir::encode_ssa_value(*inst.result));
+            const double compare_val = next.number.value_or(0.0);
+            if (next.op == ir::SsaOpcode::BranchIf && !next.arguments.empty() && !next.immediates.empty() &&
+                ir::encode_ssa_value(next.arguments[0]) == ir::encode_ssa_value(*inst.result) &&
+                uses != use_counts_.end() && uses->second == 1 && (compare_val == 0.0 || compare_val == 1.0)) {
+                fused_compare_ = &inst;
+                continue;
+            }
+        }
         compile_instruction(inst, block, function);
-        if (inst.opcode == "return" || inst.opcode == "branch" || inst.opcode == "branch_if") {
+        if (inst.op == ir::SsaOpcode::Return || inst.op == ir::SsaOpcode::Branch ||
+            inst.op == ir::SsaOpcode::BranchIf) {
             has_terminator = true;
         }
     }
-    
+    if (stop.has_value()) {
+        emit_jump_to_label(std::nullopt, osr_exit_label(*stop));
+        return;
+    }
+
     // If no explicit terminator, add implicit fallthrough to first successor
     if (!has_terminator && !block.successors.empty()) {
         std::size_t succ_id = block.successors[0];
         if (succ_id < function.blocks.size()) {
-            const std::string& target = function.blocks[succ_id].name;
-            emit_phi_moves(target);
-            buffer_.emit_jmp_rel32(0);
-            pending_jumps_.emplace_back(buffer_.position() - 4, target);
+            emit_jump_to_block(function.blocks[succ_id].name, true);
+        }
+    }
+}
+
+void JitCompiler::emit_jump_to_block(const std::string& target, bool may_fall_through) {
+    const std::string label = jump_label(target);
+    if (label == target) {
+        emit_phi_moves(target);  // an OSR exit leaves the target's phis to the interpreter
+        if (const VectorEntry* vector = vector_loop_entered(target)) {
+            emit_vector_loop(*vector);
+        }
+    }
+    if (may_fall_through && label == next_block_) {
+        return;
+    }
+    emit_jump_to_label(std::nullopt, label);
+}
+
+void JitCompiler::emit_jump_to_label(std::optional<uint8_t> condition, const std::string& label) {
+    // Backward jumps know their distance now: measured from the end of the 2-byte rel8 form
+    if (const auto placed = label_positions_.find(label); placed != label_positions_.end()) {
+        const auto distance = static_cast<std::int64_t>(placed->second) - static_cast<std::int64_t>(buffer_.position());
+        if (distance - 2 >= -128) {
+            const auto offset = static_cast<int8_t>(distance - 2);
+            condition.has_value() ? buffer_.emit_jcc_rel8(*condition, offset) : buffer_.emit_jmp_rel8(offset);
+            return;
+        }
+    }
+    condition.has_value() ? buffer_.emit_jcc_rel32(*condition, 0) : buffer_.emit_jmp_rel32(0);
+    pending_jumps_.emplace_back(buffer_.position() - 4, label);
+}
+
+auto JitCompiler::edge_has_code(const std::string& target) -> bool {
+    if (jump_label(target) != target) {
+        return false;  // OSR exits make no phi moves
+    }
+    if (vector_loop_entered(target) != nullptr) {
+        return true;
+    }
+    const auto it = phi_map_.find(target);
+    if (it == phi_map_.end()) {
+        return false;
+    }
+    return std::any_of(it->second.begin(), it->second.end(), [&](const PhiInfo& info) {
+        if (info.pred_block_id != current_block_id_) {
+            return false;
+        }
+        const ValueLocation* dst = find_location(info.result);
+        const ValueLocation* src = find_location(info.input);
+        return dst != nullptr && src != nullptr && *dst != *src;
+    });
+}
+
+auto JitCompiler::vector_loop_entered(const std::string& target) const -> const VectorEntry* {
+    const auto id = block_ids_.find(target);
+    if (id == block_ids_.end()) {
+        return nullptr;
+    }
+    for (const auto& entry : vector_loops_) {
+        if (entry.loop.header == id->second && entry.loop.body != current_block_id_) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void JitCompiler::emit_vector_loop(const VectorEntry& entry) {
+    const int rax = static_cast<int>(Register::RAX);
+    const int rcx = static_cast<int>(Register::RCX);
+    const int rdx = static_cast<int>(Register::RDX);
+    // Element pointers of the arrays, in registers no ABI expects preserved
+    static constexpr std::array<int, kMaxVectorArrays> kBases = {
+        static_cast<int>(Register::R8), static_cast<int>(Register::R9), static_cast<int>(Register::R10),
+        static_cast<int>(Register::R11)};
+    const VectorLoop& loop = entry.loop;
+    const JitArrayLayout& layout = calls_->arrays;
+    const auto& body = entry.body->instructions;
+    const auto base_of = [&](const ir::SsaValue& array) {
+        for (std::size_t k = 0; k < loop.arrays.size(); ++k) {
+            if (ir::encode_ssa_value(loop.arrays[k]) == ir::encode_ssa_value(array)) {
+                return kBases[k];
+            }
+        }
+        return kBases[0];
+    };
+    const auto reduction_of = [&](const ir::SsaInstruction& inst) -> const VectorReduction* {
+        for (const auto& sum : loop.reductions) {
+            if (inst.result.has_value() && ir::encode_ssa_value(*inst.result) == ir::encode_ssa_value(sum.update)) {
+                return &sum;
+            }
+        }
+        return nullptr;
+    };
+    const auto is_step = [&](const ir::SsaInstruction& inst) {
+        return inst.result.has_value() && ir::encode_ssa_value(*inst.result) == ir::encode_ssa_value(loop.step);
+    };
+
+    // YMM registers, from those free on entry to the header. Values from before the loop,
+    // literals and the sums keep theirs for the whole loop; values computed in an iteration hold
+    // one (or XMM0, once the setup is done with it) until their last use. Loads ahead of the
+    // body's first store ("early") are made, and checked for holes, before anything is stored.
+    // Later loads are checked there too, so a chunk that would meet a hole leaves before it
+    // changes any array. A hole is a NaN, and testing for any NaN needs no register: chunks
+    // holding NaN values leave to the scalar loop as well, which tells the two apart.
+    std::vector<int> free_registers(entry.registers.rbegin(), entry.registers.rend());
+    std::unordered_map<std::uint64_t, int> lanes;
+    std::unordered_map<std::uint64_t, std::size_t> last_use;
+    std::unordered_set<std::uint64_t> computed;
+    std::vector<std::pair<ir::SsaValue, int>> invariants;
+    std::vector<std::pair<double, int>> constants;
+    std::vector<std::size_t> early_loads;
+    std::vector<std::size_t> late_loads;
+    bool out_of_registers = false;
+    const auto take = [&]() {
+        if (free_registers.empty()) {
+            out_of_registers = true;
+            return kScratch1;
+        }
+        const int reg = free_registers.back();
+        free_registers.pop_back();
+        return reg;
+    };
+    bool stored = false;
+    for (std::size_t p = 0; p < body.size(); ++p) {
+        const auto& inst = body[p];
+        if (is_step(inst)) {
+            continue;
+        }
+        for (const auto& argument : inst.arguments) {
+            last_use[ir::encode_ssa_value(argument)] = p;
+        }
+        if (inst.result.has_value()) {
+            computed.insert(ir::encode_ssa_value(*inst.result));
+        }
+        if (inst.op == ir::SsaOpcode::ArraySet) {
+            stored = true;
+        } else if (inst.op == ir::SsaOpcode::ArrayGet) {
+            (stored ? late_loads : early_loads).push_back(p);
+        }
+    }
+    const auto lane_operand = [&](const ir::SsaValue& value) {
+        const std::uint64_t key = ir::encode_ssa_value(value);
+        if (computed.count(key) == 0 && lanes.count(key) == 0) {
+            const int reg = take();
+            lanes[key] = reg;
+            invariants.emplace_back(value, reg);
+        }
+    };
+    const auto release = [&](const ir::SsaInstruction& inst, std::size_t p) {
+        for (const auto& argument : inst.arguments) {
+            const std::uint64_t key = ir::encode_ssa_value(argument);
+            const auto lane = lanes.find(key);
+            const auto last = last_use.find(key);
+            if (computed.count(key) != 0 && lane != lanes.end() && last != last_use.end() && last->second == p) {
+                free_registers.push_back(lane->second);
+                last_use.erase(last);
+            }
+        }
+    };
+    const auto define = [&](const ir::SsaValue& value) {
+        const int reg = take();
+        lanes[ir::encode_ssa_value(value)] = reg;
+        if (last_use.count(ir::encode_ssa_value(value)) == 0) {
+            free_registers.push_back(reg);  // never read: the register is free again at once
+        }
+    };
+    for (const auto& inst : body) {
+        if (const VectorReduction* sum = reduction_of(inst)) {
+            lane_operand(sum->addend);
+        } else if (inst.op == ir::SsaOpcode::Binary && !is_step(inst)) {
+            lane_operand(inst.arguments[0]);
+            lane_operand(inst.arguments[1]);
+        } else if (inst.op == ir::SsaOpcode::ArraySet) {
+            lane_operand(inst.arguments[2]);
+        } else if (inst.op == ir::SsaOpcode::Literal) {
+            const int reg = take();
+            lanes[ir::encode_ssa_value(*inst.result)] = reg;
+            last_use.erase(ir::encode_ssa_value(*inst.result));  // held for the whole loop
+            constants.emplace_back(facts_->constant(*inst.result).value_or(0.0), reg);
+        }
+    }
+    std::vector<int> sums;
+    for (std::size_t k = 0; k < loop.reductions.size(); ++k) {
+        sums.push_back(take());
+    }
+    free_registers.push_back(kScratch0);
+    for (const std::size_t p : early_loads) {
+        define(*body[p].result);
+    }
+    for (std::size_t p = 0; p < body.size(); ++p) {
+        const auto& inst = body[p];
+        if (is_step(inst) || inst.op == ir::SsaOpcode::Literal || inst.op == ir::SsaOpcode::Branch) {
+            continue;
+        }
+        release(inst, p);
+        const bool late_load = std::find(early_loads.begin(), early_loads.end(), p) == early_loads.end();
+        if (reduction_of(inst) == nullptr && inst.result.has_value() &&
+            (inst.op == ir::SsaOpcode::Binary || (inst.op == ir::SsaOpcode::ArrayGet && late_load))) {
+            define(*inst.result);
+        }
+    }
+    if (out_of_registers) {
+        return;  // the scalar loop runs every iteration
+    }
+    const auto lane = [&](const ir::SsaValue& value) { return lanes.at(ir::encode_ssa_value(value)); };
+
+    // Until the first packed instruction, leaving means skipping the loop: RCX = first
+    // iteration, RDX = min(bound, array lengths), both as non-negative integers
+    std::vector<size_t> skips;
+    const auto skip_if = [&](uint8_t condition) {
+        buffer_.emit_jcc_rel32(condition, 0);
+        skips.push_back(buffer_.position() - 4);
+    };
+    const auto load_count = [&](const ir::SsaValue& value, int reg) {
+        const int value_reg = operand_register(value, kScratch0);
+        buffer_.emit_cvttsd2si(reg, value_reg);
+        buffer_.emit_test_reg_reg(reg, reg);
+        skip_if(kJumpIfSign);
+        if (!facts_->integral(value)) {
+            buffer_.emit_cvtsi2sd(kScratch1, reg);
+            buffer_.emit_ucomisd(kScratch1, value_reg);
+            skip_if(kJumpIfParity);
+            skip_if(kJumpIfNotEqual);
+        }
+    };
+    load_count(loop.induction, rcx);
+    load_count(loop.bound, rdx);
+    for (std::size_t k = 0; k < loop.arrays.size(); ++k) {
+        buffer_.emit_movq_reg_xmm(rax, operand_register(loop.arrays[k], kScratch0));
+        buffer_.emit_test_reg_reg(rax, rax);
+        skip_if(kJumpIfEqual);
+        buffer_.emit_cmp_byte_mem_imm(rax, layout.object_kind, layout.float64_kind);
+        skip_if(kJumpIfNotEqual);
+        buffer_.emit_mov_reg_mem(kBases[k], rax, layout.numbers_begin);
+        buffer_.emit_mov_reg_mem(rax, rax, layout.numbers_end);
+        buffer_.emit_sub_reg_reg(rax, kBases[k]);
+        buffer_.emit_shr_reg_imm8(rax, 3);
+        buffer_.emit_cmp_reg_reg(rdx, rax);
+        buffer_.emit_jcc_rel8(kJumpIfBelowOrEqual, 0);
+        const size_t shorter = buffer_.position() - 1;
+        buffer_.emit_mov_reg_reg(rdx, rax);
+        buffer_.patch_rel8(shorter, static_cast<int8_t>(buffer_.position() - shorter - 1));
+    }
+    buffer_.emit_lea_reg_mem(rax, rcx, 4);
+    buffer_.emit_cmp_reg_reg(rax, rdx);
+    skip_if(kJumpIfAbove);
+
+    for (const auto& [value, reg] : invariants) {
+        buffer_.emit_vbroadcastsd(reg, operand_register(value, kScratch0));
+    }
+    for (const auto& [constant, reg] : constants) {
+        load_constant_to_xmm(kScratch0, constant);
+        buffer_.emit_vbroadcastsd(reg, kScratch0);
+    }
+    for (const int sum : sums) {
+        buffer_.emit_vxorpd(sum, sum, sum);
+    }
+
+    // One chunk: elements RCX .. RCX + 3 of every array
+    buffer_.emit_nops((kLoopAlignment - buffer_.position() % kLoopAlignment) % kLoopAlignment);
+    const size_t top = buffer_.position();
+    std::vector<size_t> leaves;
+    const auto leave_on_hole = [&](int reg) {
+        buffer_.emit_vcmppd(kScratch1, reg, reg, kUnordered);
+        buffer_.emit_vptest(kScratch1, kScratch1);
+        buffer_.emit_jcc_rel32(kJumpIfNotEqual, 0);
+        leaves.push_back(buffer_.position() - 4);
+    };
+    for (const std::size_t p : early_loads) {
+        const int reg = lane(*body[p].result);
+        buffer_.emit_vmovupd_load(reg, base_of(body[p].arguments[0]), rcx);
+        leave_on_hole(reg);
+    }
+    for (const std::size_t p : late_loads) {
+        buffer_.emit_vmovupd_load(kScratch1, base_of(body[p].arguments[0]), rcx);
+        leave_on_hole(kScratch1);
+    }
+    for (std::size_t p = 0; p < body.size(); ++p) {
+        const auto& inst = body[p];
+        if (is_step(inst)) {
+            continue;
+        }
+        if (const VectorReduction* sum = reduction_of(inst)) {
+            const int reg = sums[static_cast<std::size_t>(sum - loop.reductions.data())];
+            buffer_.emit_vaddpd(reg, reg, lane(sum->addend));
+        } else if (inst.op == ir::SsaOpcode::ArrayGet) {
+            if (std::find(late_loads.begin(), late_loads.end(), p) != late_loads.end()) {
+                buffer_.emit_vmovupd_load(lane(*inst.result), base_of(inst.arguments[0]), rcx);
+            }
+        } else if (inst.op == ir::SsaOpcode::ArraySet) {
+            buffer_.emit_vmovupd_store(base_of(inst.arguments[0]), rcx, lane(inst.arguments[2]));
+        } else if (inst.op == ir::SsaOpcode::Binary) {
+            const int dst = lane(*inst.result);
+            const int lhs = lane(inst.arguments[0]);
+            const int rhs = lane(inst.arguments[1]);
+            switch (inst.binary_op) {
+            case ir::BinaryOp::Add:
+                buffer_.emit_vaddpd(dst, lhs, rhs);
+                break;
+            case ir::BinaryOp::Sub:
+                buffer_.emit_vsubpd(dst, lhs, rhs);
+                break;
+            case ir::BinaryOp::Mul:
+                buffer_.emit_vmulpd(dst, lhs, rhs);
+                break;
+            default:
+                buffer_.emit_vdivpd(dst, lhs, rhs);
+                break;
+            }
+        }
+    }
+    buffer_.emit_lea_reg_mem(rcx, rcx, 4);
+    buffer_.emit_lea_reg_mem(rax, rcx, 4);
+    buffer_.emit_cmp_reg_reg(rax, rdx);
+    const auto back = static_cast<std::int64_t>(top) - static_cast<std::int64_t>(buffer_.position());
+    if (back - 2 >= -128) {
+        buffer_.emit_jcc_rel8(kJumpIfBelowOrEqual, static_cast<int8_t>(back - 2));
+    } else {
+        buffer_.emit_jcc_rel32(kJumpIfBelowOrEqual, static_cast<int32_t>(back - 6));
+    }
+
+    // Fold each sum's lanes into its phi and hand RCX back as the induction variable
+    for (const size_t leave : leaves) {
+        buffer_.patch_rel32(leave, static_cast<int32_t>(buffer_.position() - leave - 4));
+    }
+    for (const int sum : sums) {
+        buffer_.emit_vextractf128(kScratch1, sum, 1);
+        buffer_.emit_vaddpd(sum, sum, kScratch1);
+        buffer_.emit_vunpckhpd(kScratch1, sum, sum);
+        buffer_.emit_vaddpd(sum, sum, kScratch1);
+    }
+    buffer_.emit_vzeroupper();
+    for (std::size_t k = 0; k < loop.reductions.size(); ++k) {
+        const ir::SsaValue& phi = loop.reductions[k].phi;
+        const int dst = result_register(phi, kScratch0);
+        load_value_to_xmm(dst, phi);
+        buffer_.emit_addsd(dst, sums[k]);
+        store_xmm_to_value(phi, dst);
+    }
+    const int induction = result_register(loop.induction, kScratch0);
+    buffer_.emit_cvtsi2sd(induction, rcx);
+    store_xmm_to_value(loop.induction, induction);
+
+    for (const size_t skip : skips) {
+        buffer_.patch_rel32(skip, static_cast<int32_t>(buffer_.position() - skip - 4));
+    }
+}
+
+auto JitCompiler::jump_label(const std::string& target) -> std::string {
+    if (osr_ == nullptr) {
+        return target;
+    }
+    const auto id_it = block_ids_.find(target);
+    if (id_it == block_ids_.end() || osr_->in_region(id_it->second)) {
+        return target;
+    }
+    for (std::size_t i = 0; i < osr_->exits.size(); ++i) {
+        if (osr_->exits[i].from == current_block_id_ && osr_->exits[i].to == id_it->second) {
+            return osr_exit_label(i);
         }
     }
+    failed_ = true;  // the plan does not cover this edge
+    return target;
+}
+
+void JitCompiler::emit_osr_exits() {
+    const int state_reg = static_cast<int>(Register::RAX);
+    const int rbp = static_cast<int>(Register::RBP);
+    for (std::size_t i = 0; i < osr_->exits.size(); ++i) {
+        label_positions_[osr_exit_label(i)] = buffer_.position();
+        // Constants go through RAX, so materialise the exit code before loading the state pointer
+        load_constant_to_xmm(kScratch1, static_cast<double>(i + 1));
+        buffer_.emit_mov_reg_mem(state_reg, rbp, osr_state_offset_);
+        buffer_.emit_movsd_mem_xmm(state_reg, 0, kScratch1);
+        const auto& outputs = osr_->exits[i].outputs;
+        for (std::size_t slot = 0; slot < outputs.size(); ++slot) {
+            const int reg = operand_register(outputs[slot], kScratch0);
+            buffer_.emit_movsd_mem_xmm(state_reg, static_cast<int32_t>((slot + 1) * 8), reg);
+        }
+        buffer_.emit_xorpd(kScratch0, kScratch0);
+        emit_epilogue();
+    }
 }
 
 void JitCompiler::emit_phi_moves(const std::string& target_block) {
@@ -807,40 +2422,148 @@ void JitCompiler::emit_phi_moves(const std::string& target_block) {
     if (it == phi_map_.end()) {
         return;
     }
-    
-    // Find phi inputs for current block and copy values to phi results
+
+    // All phis on an edge read their inputs before any result is written, so the moves
+    // form a parallel copy. Sequence it: emit moves whose destination is no longer needed
+    // as a source, and break cycles by parking one destination in XMM0.
+    struct Move {
+        ValueLocation dst;
+        ValueLocation src;
+    };
+    std::vector<Move> moves;
     for (const auto& phi_info : it->second) {
-        if (phi_info.pred_block_id == current_block_id_) {
-            load_value_to_xmm(0, phi_info.input);
-            store_xmm_to_value(phi_info.result, 0);
+        if (phi_info.pred_block_id != current_block_id_) {
+            continue;
+        }
+        const ValueLocation* dst = find_location(phi_info.result);
+        const ValueLocation* src = find_location(phi_info.input);
+        if (dst != nullptr && src != nullptr && *dst != *src) {
+            moves.push_back({*dst, *src});
+        }
+    }
+
+    while (!moves.empty()) {
+        bool emitted = false;
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            const bool blocked = std::any_of(moves.begin(), moves.end(), [&](const Move& other) {
+                return other.src == moves[i].dst;
+            });
+            if (!blocked) {
+                emit_move(moves[i].dst, moves[i].src);
+                moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(i));
+                emitted = true;
+                break;
+            }
+        }
+        if (emitted) {
+            continue;
+        }
+        // Every remaining destination is still read: save one and redirect its readers
+        const ValueLocation saved = moves.front().dst;
+        const ValueLocation scratch = ValueLocation::in_register(kScratch0);
+        emit_move(scratch, saved);
+        for (auto& move : moves) {
+            if (move.src == saved) {
+                move.src = scratch;
+            }
         }
     }
 }
 
-auto JitCompiler::compile(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names) -> JitFunction {
-    auto [func, _] = compile_with_buffer(function, parameter_names);
+auto JitCompiler::compile(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names,
+                          JitCallTable* calls) -> JitFunction {
+    auto [func, _] = compile_with_buffer(function, parameter_names, calls);
     return func;
 }
 
-auto JitCompiler::compile_with_buffer(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names) -> std::pair<JitFunction, CodeBuffer> {
+auto JitCompiler::compile_with_buffer(const ir::SsaFunction& function, const std::vector<std::string>& parameter_names,
+                                      JitCallTable* calls) -> std::pair<JitFunction, CodeBuffer> {
+    // Parameters map to args array indices by name
+    std::unordered_map<std::string, int> param_index_map;
+    for (size_t i = 0; i < parameter_names.size(); ++i) {
+        param_index_map[parameter_names[i]] = static_cast<int>(i);
+    }
+    std::vector<std::pair<ir::SsaValue, int>> parameters;
+    std::vector<std::pair<ir::SsaValue, std::string>> globals;
+    for (const auto& symbol : function.symbols) {
+        auto it = param_index_map.find(symbol.name);
+        if (it != param_index_map.end()) {
+            parameters.emplace_back(ir::SsaValue{symbol.id, 1}, it->second);
+        } else if (calls != nullptr &&
+                   (calls->constants.count(symbol.name) != 0 || calls->global_slots.count(symbol.name) != 0)) {
+            globals.emplace_back(ir::SsaValue{symbol.id, 0}, symbol.name);
+        }
+    }
+    return compile_function(function, parameters, globals, nullptr, calls);
+}
+
+auto JitCompiler::compile_osr_with_buffer(const ir::SsaFunction& function, const OsrPlan& plan,
+                                          JitCallTable* calls) -> std::pair<JitFunction, CodeBuffer> {
+    if (plan.region.size() != function.blocks.size() || plan.header >= function.blocks.size()) {
+        return {nullptr, CodeBuffer{}};
+    }
+    // The interpreter hands over the globals the region reads like any other live value
+    return compile_function(function, {}, {}, &plan, calls);
+}
+
+auto JitCompiler::compile_function(const ir::SsaFunction& function,
+                                   const std::vector<std::pair<ir::SsaValue, int>>& parameters,
+                                   const std::vector<std::pair<ir::SsaValue, std::string>>& globals,
+                                   const OsrPlan* osr, JitCallTable* calls) -> std::pair<JitFunction, CodeBuffer> {
     if (!is_supported()) {
         return {nullptr, CodeBuffer{}};
     }
-    
+#if defined(__aarch64__)
+    // The AArch64 backend has no calls, traps or exits yet: numeric functions compile, and the
+    // rest (OSR entries included) stays with the interpreter
+    if (osr != nullptr) {
+        return {nullptr, CodeBuffer{}};
+    }
+    auto code = compile_arm64(function, parameters);
+    if (!code.has_value()) {
+        return {nullptr, CodeBuffer{}};
+    }
+    buffer_ = CodeBuffer{};
+    buffer_.emit(*code);
+    JitFunction compiled = buffer_.finalize(calls != nullptr ? calls->code : nullptr);
+    return {compiled, std::move(buffer_)};
+#endif
+
     // Reset state
-    value_offsets_.clear();
+    allocation_ = RegisterAllocation{};
     label_positions_.clear();
     pending_jumps_.clear();
     phi_map_.clear();
     current_block_id_ = 0;
+    current_instruction_ = 0;
+    calls_ = calls;
+    register_saves_.clear();
+    used_traps_.clear();
+    needs_unwind_stub_ = false;
+    failed_ = false;
+    incoming_args_ = 0;
+    incoming_args_offset_ = 0;
+    osr_ = osr;
+    block_ids_.clear();
+    next_block_.clear();
+    use_counts_.clear();
+    deferred_edges_.clear();
+    fused_compare_ = nullptr;
     buffer_ = CodeBuffer{};
-    
+
     // Build phi map for SSA deconstruction
     // Map: target block name -> list of (predecessor block id, phi result, phi input)
     for (const auto& block : function.blocks) {
+        block_ids_[block.name] = block.id;
+        for (const auto& inst : block.instructions) {
+            for (const auto& argument : inst.arguments) {
+                ++use_counts_[ir::encode_ssa_value(argument)];
+            }
+        }
         for (const auto& phi : block.phi_nodes) {
             for (const auto& input : phi.inputs) {
                 if (input.value.has_value()) {
+                    ++use_counts_[ir::encode_ssa_value(*input.value)];
                     PhiInfo info;
                     info.pred_block_id = input.predecessor;
                     info.result = phi.result;
@@ -850,73 +2573,197 @@ auto JitCompiler::compile_with_buffer(const ir::SsaFunction& function, const std
             }
         }
     }
-    
-    // Pre-allocate all values to determine stack size
-    // First, allocate parameters
-    std::unordered_map<std::string, int> param_index_map;
-    for (size_t i = 0; i < parameter_names.size(); ++i) {
-        param_index_map[parameter_names[i]] = static_cast<int>(i);
+
+    std::vector<ir::SsaValue> parameter_values;
+    parameter_values.reserve(parameters.size());
+    for (const auto& [param_value, param_index] : parameters) {
+        parameter_values.push_back(param_value);
     }
-    
-    // Allocate parameter slots
-    for (const auto& symbol : function.symbols) {
-        auto it = param_index_map.find(symbol.name);
-        if (it != param_index_map.end()) {
-            ir::SsaValue param_value{symbol.id, 1};
-            allocate_value(param_value);
+    for (const auto& [global_value, name] : globals) {
+        parameter_values.push_back(global_value);
+    }
+    allocation_ = allocate_registers(function, parameter_values);
+    facts_.emplace(function);
+    bounds_.emplace(function, *facts_);
+
+    // Vectorized loops get the XMM registers no value live into their header occupies
+    vector_loops_.clear();
+    if (uses_avx2() && calls != nullptr && calls->arrays.available) {
+        std::vector<VectorLoop> plans = plan_vector_loops(function, *facts_);
+        const ir::SsaLiveness liveness = plans.empty() ? ir::SsaLiveness{} : ir::compute_liveness(function);
+        for (auto& plan : plans) {
+            std::vector<bool> busy(16, false);
+            const auto occupy = [&](const ir::SsaValue& value) {
+                const ValueLocation* location = find_location(value);
+                if (location != nullptr && location->is_register()) {
+                    busy[static_cast<std::size_t>(location->reg)] = true;
+                }
+            };
+            for (const std::size_t index : liveness.live_in[plan.header]) {
+                occupy(liveness.values[index]);
+            }
+            for (const auto& phi : function.blocks[plan.header].phi_nodes) {
+                occupy(phi.result);
+            }
+            VectorEntry entry;
+            entry.body = &function.blocks[plan.body];
+            for (const int reg : allocatable_xmm_registers()) {
+                if (!busy[static_cast<std::size_t>(reg)]) {
+                    entry.registers.push_back(reg);
+                }
+            }
+            entry.loop = std::move(plan);
+            vector_loops_.push_back(std::move(entry));
         }
     }
-    
-    // Pre-allocate all result values from instructions
+
+    // Frame layout below rbp: spill slots, one save slot per register preserved across a call,
+    // the OSR state pointer, then the outgoing args array (above the Windows home area) at the
+    // bottom of the frame
+    int frame_slots = allocation_.spill_slots;
+    std::size_t max_call_args = 0;
+    bool has_calls = false;
     for (const auto& block : function.blocks) {
-        for (const auto& phi : block.phi_nodes) {
-            allocate_value(phi.result);
-        }
         for (const auto& inst : block.instructions) {
-            if (inst.result.has_value()) {
-                allocate_value(*inst.result);
+            if (inst.op == ir::SsaOpcode::Call) {
+                has_calls = true;
+                max_call_args = std::max(max_call_args, inst.arguments.size());
+            } else if (inst.op == ir::SsaOpcode::ArrayGet || inst.op == ir::SsaOpcode::ArraySet ||
+                       inst.op == ir::SsaOpcode::ArrayLength || inst.op == ir::SsaOpcode::FieldGet ||
+                       inst.op == ir::SsaOpcode::FieldSet ||
+                       (inst.op == ir::SsaOpcode::Binary && inst.binary_op == ir::BinaryOp::Mod)) {
+                has_calls = true;  // bounds and operand checks may call the trap handler
             }
         }
     }
-    
-    // Calculate total stack size needed (16-byte aligned)
-    int num_slots = static_cast<int>(value_offsets_.size());
-    emit_prologue(num_slots);
-    
+    for (const auto& [inst, preserved] : allocation_.preserved_across_calls) {
+        for (const int reg : preserved) {
+            if (register_saves_.find(reg) == register_saves_.end()) {
+                ++frame_slots;
+                register_saves_[reg] = -static_cast<int32_t>(frame_slots * 8);
+            }
+        }
+    }
+    if (osr != nullptr) {
+        ++frame_slots;
+        osr_state_offset_ = -static_cast<int32_t>(frame_slots * 8);
+    }
+    // OSR entries are not called with an args array; whole functions keep theirs for tail calls
+    for (const auto& [param_value, param_index] : parameters) {
+        incoming_args_ = std::max(incoming_args_, static_cast<std::size_t>(param_index) + 1);
+    }
+    for (const auto& block : function.blocks) {
+        for (std::size_t i = 0; osr == nullptr && incoming_args_offset_ == 0 && i < block.instructions.size(); ++i) {
+            if (ir::is_tail_call(block, i)) {
+                ++frame_slots;
+                incoming_args_offset_ = -static_cast<int32_t>(frame_slots * 8);
+            }
+        }
+    }
+    const int outgoing_slots = has_calls ? kShadowSlots + static_cast<int>(max_call_args) : 0;
+    emit_prologue(frame_slots + outgoing_slots);
+    outgoing_args_offset_ = -stack_size_ + kShadowSlots * 8;
+
     // Load function parameters from args array
     // On Windows x64: first parameter is in RCX
     // On Linux x64: first parameter is in RDI
     // Parameters are passed as doubles in args[0], args[1], etc.
-    if (!parameter_names.empty()) {
-#ifdef _WIN32
-        int args_reg = static_cast<int>(Register::RCX);  // Windows x64 calling convention
-#else
-        int args_reg = static_cast<int>(Register::RDI);  // Linux x64 calling convention
-#endif
-        for (const auto& symbol : function.symbols) {
-            auto it = param_index_map.find(symbol.name);
-            if (it != param_index_map.end()) {
-                // This is a parameter - load it from args array
-                ir::SsaValue param_value{symbol.id, 1};
-                
-                // Load from args[i] into XMM0, then store to stack slot
-                int param_index = it->second;
-                int32_t args_offset = static_cast<int32_t>(param_index * 8);
-                
-                // movsd xmm0, [args_reg + args_offset]
-                buffer_.emit_movsd_xmm_mem(0, args_reg, args_offset);
-                
-                // Store to stack slot
-                store_xmm_to_value(param_value, 0);
+    const int args_reg = kArgReg0;
+    if (incoming_args_offset_ != 0) {
+        buffer_.emit_mov_mem_reg(static_cast<int>(Register::RBP), incoming_args_offset_, args_reg);
+    }
+    for (const auto& [param_value, param_index] : parameters) {
+        const ValueLocation* location = find_location(param_value);
+        if (location == nullptr) {
+            continue;  // Unused parameter
+        }
+        const int32_t args_offset = static_cast<int32_t>(param_index * 8);
+        const int reg = location->is_register() ? location->reg : kScratch0;
+        buffer_.emit_movsd_xmm_mem(reg, args_reg, args_offset);
+        store_xmm_to_value(param_value, reg);
+    }
+
+    // Globals are defined on entry too: immediates for const / let, a load from the table for var
+    for (const auto& [global_value, name] : globals) {
+        const ValueLocation* location = find_location(global_value);
+        if (location == nullptr) {
+            continue;  // only mentioned by dead code
+        }
+        const int reg = location->is_register() ? location->reg : kScratch0;
+        if (const auto constant = calls->constants.find(name); constant != calls->constants.end()) {
+            load_constant_to_xmm(reg, constant->second);
+        } else {
+            const std::size_t slot = calls->global_slots.at(name);
+            const int rax = static_cast<int>(Register::RAX);
+            buffer_.emit_mov_reg_address(rax, &calls->globals[slot], JitRelocationKind::Global, slot);
+            buffer_.emit_movsd_xmm_mem(reg, rax, 0);
+        }
+        store_xmm_to_value(global_value, reg);
+    }
+
+    if (osr != nullptr) {
+        // Keep the state pointer for the exits (calls clobber the argument register), load the
+        // values live at the loop header and continue there
+        buffer_.emit_mov_mem_reg(static_cast<int>(Register::RBP), osr_state_offset_, args_reg);
+        for (std::size_t slot = 0; slot < osr->inputs.size(); ++slot) {
+            const ValueLocation* location = find_location(osr->inputs[slot]);
+            if (location == nullptr) {
+                continue;
+            }
+            const int reg = location->is_register() ? location->reg : kScratch0;
+            buffer_.emit_movsd_xmm_mem(reg, args_reg, static_cast<int32_t>((slot + 1) * 8));
+            store_xmm_to_value(osr->inputs[slot], reg);
+        }
+        for (const auto& vector : vector_loops_) {
+            if (vector.loop.header == osr->header) {
+                emit_vector_loop(vector);
             }
         }
+        buffer_.emit_jmp_rel32(0);
+        pending_jumps_.emplace_back(buffer_.position() - 4, function.blocks[osr->header].name);
     }
-    
-    // Compile the blocks
+
+    if (osr != nullptr) {
+        for (const auto& exit : osr->exits) {
+            for (const auto& output : exit.outputs) {
+                ++use_counts_[ir::encode_ssa_value(output)];
+            }
+        }
+    }
+
+    // Compile the blocks, then the edges whose phi moves were left out of line
+    std::vector<const ir::SsaBlock*> layout;
     for (const auto& block : function.blocks) {
-        compile_block(block, function);
+        if (osr == nullptr || osr->in_region(block.id)) {
+            layout.push_back(&block);
+        }
     }
-    
+    for (std::size_t i = 0; i < layout.size(); ++i) {
+        next_block_ = i + 1 < layout.size() ? layout[i + 1]->name : std::string{};
+        compile_block(*layout[i], function);
+    }
+    next_block_.clear();
+    for (std::size_t i = 0; i < deferred_edges_.size(); ++i) {
+        const DeferredEdge edge = deferred_edges_[i];
+        label_positions_[edge.label] = buffer_.position();
+        current_block_id_ = edge.from;
+        emit_jump_to_block(edge.target);
+    }
+    if (failed_) {
+        return {nullptr, CodeBuffer{}};
+    }
+
+    if (osr != nullptr) {
+        emit_osr_exits();
+    }
+    emit_trap_stubs();
+    if (needs_unwind_stub_) {
+        label_positions_[kUnwindLabel] = buffer_.position();
+        buffer_.emit_mov_reg_imm64(static_cast<int>(Register::RAX), static_cast<int64_t>(kJitUnwindBits));
+        buffer_.emit_movq_xmm_reg(kScratch0, static_cast<int>(Register::RAX));
+        emit_epilogue();
+    }
+
     // Patch jumps
     for (const auto& [pos, label] : pending_jumps_) {
         auto it = label_positions_.find(label);
@@ -925,9 +2772,9 @@ auto JitCompiler::compile_with_buffer(const ir::SsaFunction& function, const std
             buffer_.patch_rel32(pos, offset);
         }
     }
-    
-    JitFunction func = buffer_.finalize();
-    // Move the buffer out so it stays alive
+
+    JitFunction func = buffer_.finalize(calls != nullptr ? calls->code : nullptr);
+    // Move the buffer out so it stays alive (it owns the code unless the arena does)
     CodeBuffer moved_buffer = std::move(buffer_);
     return {func, std::move(moved_buffer)};
 }
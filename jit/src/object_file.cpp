@@ -0,0 +1,413 @@
+#include "impulse/jit/object_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <elf.h>
+#endif
+
+namespace impulse::jit {
+
+#ifdef __linux__
+
+namespace {
+
+// Call entries and globals are 8-byte slots, so relocations against them address slot * 8
+constexpr std::uint64_t kSlotBytes = 8;
+static_assert(sizeof(std::atomic<JitFunction>) == kSlotBytes && sizeof(double) == kSlotBytes);
+
+constexpr std::string_view kKeySymbol = "impulse_code_key";
+constexpr std::string_view kNativePrefix = "impulse_native_";
+constexpr std::string_view kMathPrefix = "impulse_math_";
+
+// The undefined symbol and addend an R_X86_64_64 needs to reach what `relocation` points at
+struct RelocationTarget {
+    std::string symbol;
+    std::int64_t addend = 0;
+};
+
+[[nodiscard]] auto relocation_target(const JitRelocation& relocation) -> RelocationTarget {
+    const auto addend = static_cast<std::int64_t>(relocation.addend);
+    switch (relocation.kind) {
+    case JitRelocationKind::CallTable:
+        return {"impulse_call_table", addend};
+    case JitRelocationKind::CallEntry:
+        return {"impulse_call_entries", addend * static_cast<std::int64_t>(kSlotBytes)};
+    case JitRelocationKind::Trampoline:
+        return {"impulse_trampoline", 0};
+    case JitRelocationKind::TrapHandler:
+        return {"impulse_trap_handler", 0};
+    case JitRelocationKind::Native:
+        return {std::string(kNativePrefix) + std::to_string(relocation.addend), 0};
+    case JitRelocationKind::Math:
+        return {std::string(kMathPrefix) + std::to_string(relocation.addend), 0};
+    case JitRelocationKind::Global:
+        return {"impulse_globals", addend * static_cast<std::int64_t>(kSlotBytes)};
+    }
+    return {"impulse_call_table", addend};
+}
+
+// The number after `prefix` in `name`, when that is all there is to it
+[[nodiscard]] auto numbered(std::string_view name, std::string_view prefix) -> std::optional<std::uint64_t> {
+    if (name.size() <= prefix.size() || name.substr(0, prefix.size()) != prefix ||
+        name.size() - prefix.size() > 9) {
+        return std::nullopt;
+    }
+    std::uint64_t value = 0;
+    for (const char c : name.substr(prefix.size())) {
+        if (c < '0' || c > '9') {
+            return std::nullopt;
+        }
+        value = value * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    return value;
+}
+
+// relocation_target's inverse
+[[nodiscard]] auto relocation_from(std::string_view symbol, std::int64_t addend, std::uint32_t offset)
+    -> std::optional<JitRelocation> {
+    JitRelocation relocation;
+    relocation.offset = offset;
+    const auto slot = [&](JitRelocationKind kind) -> std::optional<JitRelocation> {
+        if (addend < 0 || static_cast<std::uint64_t>(addend) % kSlotBytes != 0) {
+            return std::nullopt;
+        }
+        relocation.kind = kind;
+        relocation.addend = static_cast<std::uint64_t>(addend) / kSlotBytes;
+        return relocation;
+    };
+    const auto exact = [&](JitRelocationKind kind, std::uint64_t value) -> std::optional<JitRelocation> {
+        if (addend != 0) {
+            return std::nullopt;
+        }
+        relocation.kind = kind;
+        relocation.addend = value;
+        return relocation;
+    };
+    if (symbol == "impulse_call_table") {
+        if (addend < 0) {
+            return std::nullopt;
+        }
+        relocation.kind = JitRelocationKind::CallTable;
+        relocation.addend = static_cast<std::uint64_t>(addend);
+        return relocation;
+    }
+    if (symbol == "impulse_call_entries") {
+        return slot(JitRelocationKind::CallEntry);
+    }
+    if (symbol == "impulse_globals") {
+        return slot(JitRelocationKind::Global);
+    }
+    if (symbol == "impulse_trampoline") {
+        return exact(JitRelocationKind::Trampoline, 0);
+    }
+    if (symbol == "impulse_trap_handler") {
+        return exact(JitRelocationKind::TrapHandler, 0);
+    }
+    if (const auto native = numbered(symbol, kNativePrefix)) {
+        return exact(JitRelocationKind::Native, *native);
+    }
+    if (const auto math = numbered(symbol, kMathPrefix)) {
+        return exact(JitRelocationKind::Math, *math);
+    }
+    return std::nullopt;
+}
+
+class StringTable {
+public:
+    StringTable() : bytes_(1, '\0') {}
+
+    auto add(std::string_view text) -> std::uint32_t {
+        const auto offset = static_cast<std::uint32_t>(bytes_.size());
+        bytes_.append(text.data(), text.size());
+        bytes_.push_back('\0');
+        return offset;
+    }
+
+    [[nodiscard]] auto bytes() const -> const std::string& { return bytes_; }
+
+private:
+    std::string bytes_;
+};
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void align(std::string& out, std::size_t alignment, char fill = '\0') {
+    out.resize((out.size() + alignment - 1) / alignment * alignment, fill);
+}
+
+// A T at `offset` of `contents`, when it lies inside
+template <typename T>
+[[nodiscard]] auto read_at(std::string_view contents, std::uint64_t offset) -> std::optional<T> {
+    if (offset > contents.size() || contents.size() - offset < sizeof(T)) {
+        return std::nullopt;
+    }
+    T value;
+    std::memcpy(&value, contents.data() + offset, sizeof(T));
+    return value;
+}
+
+}  // namespace
+
+auto write_object_file(const JitObject& object) -> std::string {
+    enum : std::uint16_t { kNull, kText, kRela, kSymtab, kStrtab, kNoteStack, kShstrtab, kSections };
+
+    std::string text;
+    std::vector<std::size_t> starts;
+    starts.reserve(object.functions.size());
+    for (const auto& function : object.functions) {
+        align(text, 16, '\xCC');  // int3 between functions
+        starts.push_back(text.size());
+        text.append(function.code.data(), function.code.size());
+    }
+
+    // Locals first: the null symbol and .text's section symbol
+    StringTable names;
+    std::vector<Elf64_Sym> symbols(2);
+    symbols[1].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    symbols[1].st_shndx = kText;
+    const auto first_global = static_cast<std::uint32_t>(symbols.size());
+    for (std::size_t i = 0; i < object.functions.size(); ++i) {
+        Elf64_Sym symbol{};
+        symbol.st_name = names.add(object.functions[i].name);
+        symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+        symbol.st_shndx = kText;
+        symbol.st_value = starts[i];
+        symbol.st_size = object.functions[i].code.size();
+        symbols.push_back(symbol);
+    }
+    Elf64_Sym key{};
+    key.st_name = names.add(kKeySymbol);
+    key.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+    key.st_shndx = SHN_ABS;
+    key.st_value = object.key;
+    symbols.push_back(key);
+
+    std::unordered_map<std::string, std::uint32_t> undefined;
+    std::vector<Elf64_Rela> relocations;
+    for (std::size_t i = 0; i < object.functions.size(); ++i) {
+        for (const auto& relocation : object.functions[i].relocations) {
+            const RelocationTarget target = relocation_target(relocation);
+            const auto [it, inserted] = undefined.emplace(target.symbol, static_cast<std::uint32_t>(symbols.size()));
+            if (inserted) {
+                Elf64_Sym symbol{};
+                symbol.st_name = names.add(target.symbol);
+                symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+                symbol.st_shndx = SHN_UNDEF;
+                symbols.push_back(symbol);
+            }
+            Elf64_Rela rela{};
+            rela.r_offset = starts[i] + relocation.offset;
+            rela.r_info = ELF64_R_INFO(it->second, R_X86_64_64);
+            rela.r_addend = target.addend;
+            relocations.push_back(rela);
+        }
+    }
+
+    StringTable section_names;
+    Elf64_Shdr sections[kSections]{};
+    sections[kText].sh_name = section_names.add(".text");
+    sections[kRela].sh_name = section_names.add(".rela.text");
+    sections[kSymtab].sh_name = section_names.add(".symtab");
+    sections[kStrtab].sh_name = section_names.add(".strtab");
+    sections[kNoteStack].sh_name = section_names.add(".note.GNU-stack");  // no executable stack needed
+    sections[kShstrtab].sh_name = section_names.add(".shstrtab");
+
+    std::string file(sizeof(Elf64_Ehdr), '\0');
+    align(file, 16);
+    sections[kText].sh_type = SHT_PROGBITS;
+    sections[kText].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    sections[kText].sh_offset = file.size();
+    sections[kText].sh_size = text.size();
+    sections[kText].sh_addralign = 16;
+    file += text;
+
+    align(file, 8);
+    sections[kRela].sh_type = SHT_RELA;
+    sections[kRela].sh_flags = SHF_INFO_LINK;
+    sections[kRela].sh_offset = file.size();
+    sections[kRela].sh_size = relocations.size() * sizeof(Elf64_Rela);
+    sections[kRela].sh_link = kSymtab;
+    sections[kRela].sh_info = kText;
+    sections[kRela].sh_addralign = 8;
+    sections[kRela].sh_entsize = sizeof(Elf64_Rela);
+    for (const auto& rela : relocations) {
+        append(file, rela);
+    }
+
+    sections[kSymtab].sh_type = SHT_SYMTAB;
+    sections[kSymtab].sh_offset = file.size();
+    sections[kSymtab].sh_size = symbols.size() * sizeof(Elf64_Sym);
+    sections[kSymtab].sh_link = kStrtab;
+    sections[kSymtab].sh_info = first_global;
+    sections[kSymtab].sh_addralign = 8;
+    sections[kSymtab].sh_entsize = sizeof(Elf64_Sym);
+    for (const auto& symbol : symbols) {
+        append(file, symbol);
+    }
+
+    sections[kStrtab].sh_type = SHT_STRTAB;
+    sections[kStrtab].sh_offset = file.size();
+    sections[kStrtab].sh_size = names.bytes().size();
+    sections[kStrtab].sh_addralign = 1;
+    file += names.bytes();
+
+    sections[kNoteStack].sh_type = SHT_PROGBITS;
+    sections[kNoteStack].sh_offset = file.size();
+    sections[kNoteStack].sh_addralign = 1;
+
+    sections[kShstrtab].sh_type = SHT_STRTAB;
+    sections[kShstrtab].sh_offset = file.size();
+    sections[kShstrtab].sh_size = section_names.bytes().size();
+    sections[kShstrtab].sh_addralign = 1;
+    file += section_names.bytes();
+
+    align(file, 8);
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = file.size();
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = kSections;
+    header.e_shstrndx = kShstrtab;
+    std::memcpy(file.data(), &header, sizeof(header));
+    for (const auto& section : sections) {
+        append(file, section);
+    }
+    return file;
+}
+
+auto read_object_file(std::string_view contents) -> std::optional<JitObject> {
+    const auto header = read_at<Elf64_Ehdr>(contents, 0);
+    if (!header.has_value() || std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != ELFCLASS64 || header->e_ident[EI_DATA] != ELFDATA2LSB ||
+        header->e_type != ET_REL || header->e_machine != EM_X86_64 || header->e_shentsize != sizeof(Elf64_Shdr)) {
+        return std::nullopt;
+    }
+    std::vector<Elf64_Shdr> sections;
+    for (std::uint16_t i = 0; i < header->e_shnum; ++i) {
+        const auto section = read_at<Elf64_Shdr>(contents, header->e_shoff + std::uint64_t{i} * sizeof(Elf64_Shdr));
+        if (!section.has_value() || (section->sh_type != SHT_NOBITS && (section->sh_offset > contents.size() ||
+                                                                        contents.size() - section->sh_offset < section->sh_size))) {
+            return std::nullopt;
+        }
+        sections.push_back(*section);
+    }
+    const auto bytes = [&](const Elf64_Shdr& section) { return contents.substr(section.sh_offset, section.sh_size); };
+
+    const auto symtab = std::find_if(sections.begin(), sections.end(),
+                                     [](const Elf64_Shdr& section) { return section.sh_type == SHT_SYMTAB; });
+    if (symtab == sections.end() || symtab->sh_link >= sections.size() || symtab->sh_entsize != sizeof(Elf64_Sym)) {
+        return std::nullopt;
+    }
+    const std::string_view strings = bytes(sections[symtab->sh_link]);
+    const auto name_of = [&](const Elf64_Sym& symbol) -> std::optional<std::string_view> {
+        if (symbol.st_name >= strings.size()) {
+            return std::nullopt;
+        }
+        const std::string_view rest = strings.substr(symbol.st_name);
+        const auto end = rest.find('\0');
+        return end == std::string_view::npos ? std::nullopt : std::optional{rest.substr(0, end)};
+    };
+
+    struct Defined {
+        std::uint64_t start = 0;
+        std::uint64_t size = 0;
+        std::string_view name;
+    };
+    JitObject object;
+    std::vector<Defined> functions;
+    std::vector<std::string_view> symbol_names;
+    std::uint16_t text = SHN_UNDEF;
+    bool has_key = false;
+    const std::string_view symbol_bytes = bytes(*symtab);
+    for (std::size_t offset = 0; offset + sizeof(Elf64_Sym) <= symbol_bytes.size(); offset += sizeof(Elf64_Sym)) {
+        const auto symbol = *read_at<Elf64_Sym>(symbol_bytes, offset);
+        const auto name = name_of(symbol);
+        if (!name.has_value()) {
+            return std::nullopt;
+        }
+        symbol_names.push_back(*name);
+        if (ELF64_ST_TYPE(symbol.st_info) == STT_FUNC && symbol.st_shndx != SHN_UNDEF) {
+            if (text != SHN_UNDEF && symbol.st_shndx != text) {
+                return std::nullopt;  // one .text holds them all
+            }
+            text = symbol.st_shndx;
+            functions.push_back(Defined{symbol.st_value, symbol.st_size, *name});
+        } else if (*name == kKeySymbol && symbol.st_shndx == SHN_ABS) {
+            object.key = symbol.st_value;
+            has_key = true;
+        }
+    }
+    if (!has_key || (!functions.empty() && (text >= sections.size() || sections[text].sh_type != SHT_PROGBITS))) {
+        return std::nullopt;
+    }
+    const std::string_view code = functions.empty() ? std::string_view{} : bytes(sections[text]);
+    std::sort(functions.begin(), functions.end(),
+              [](const Defined& lhs, const Defined& rhs) { return lhs.start < rhs.start; });
+    for (const auto& function : functions) {
+        if (function.start > code.size() || code.size() - function.start < function.size) {
+            return std::nullopt;
+        }
+        object.functions.push_back(JitObjectFunction{std::string(function.name), code.substr(function.start, function.size), {}});
+    }
+
+    for (const auto& section : sections) {
+        if (section.sh_type != SHT_RELA || section.sh_info != text || functions.empty()) {
+            continue;
+        }
+        if (section.sh_entsize != sizeof(Elf64_Rela) || section.sh_link != static_cast<std::uint32_t>(symtab - sections.begin())) {
+            return std::nullopt;
+        }
+        const std::string_view rela_bytes = bytes(section);
+        for (std::size_t offset = 0; offset + sizeof(Elf64_Rela) <= rela_bytes.size(); offset += sizeof(Elf64_Rela)) {
+            const auto rela = *read_at<Elf64_Rela>(rela_bytes, offset);
+            const auto symbol = ELF64_R_SYM(rela.r_info);
+            if (ELF64_R_TYPE(rela.r_info) != R_X86_64_64 || symbol >= symbol_names.size()) {
+                return std::nullopt;
+            }
+            // The function whose code holds the whole 8-byte immediate
+            const auto after = std::upper_bound(functions.begin(), functions.end(), rela.r_offset,
+                                                [](std::uint64_t value, const Defined& f) { return value < f.start; });
+            if (after == functions.begin() || rela.r_offset - std::prev(after)->start + 8 > std::prev(after)->size) {
+                return std::nullopt;
+            }
+            const auto index = static_cast<std::size_t>(std::prev(after) - functions.begin());
+            const auto relocation = relocation_from(symbol_names[symbol], rela.r_addend,
+                                                    static_cast<std::uint32_t>(rela.r_offset - functions[index].start));
+            if (!relocation.has_value()) {
+                return std::nullopt;
+            }
+            object.functions[index].relocations.push_back(*relocation);
+        }
+    }
+    return object;
+}
+
+#else
+
+auto write_object_file(const JitObject&) -> std::string {
+    return {};
+}
+
+auto read_object_file(std::string_view) -> std::optional<JitObject> {
+    return std::nullopt;
+}
+
+#endif
+
+}  // namespace impulse::jit
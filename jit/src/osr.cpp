@@ -0,0 +1,224 @@
+#include "impulse/jit/osr.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "impulse/ir/liveness.h"
+
+namespace impulse::jit {
+
+namespace {
+
+// Inputs and exits of `plan`, whose header and region are set; compiled[b] instructions of each
+// region block run natively
+void finish_plan(const ir::SsaFunction& function, const std::vector<std::size_t>& compiled, OsrPlan& plan) {
+    const ir::SsaLiveness liveness = ir::compute_liveness(function);
+    std::unordered_set<std::size_t> defined;
+    std::unordered_set<std::size_t> used;
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+        if (!plan.region[b]) {
+            continue;
+        }
+        const auto& block = function.blocks[b];
+        for (const auto& phi : block.phi_nodes) {
+            defined.insert(*liveness.find(phi.result));
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value() && plan.in_region(input.predecessor)) {
+                    used.insert(*liveness.find(*input.value));
+                }
+            }
+        }
+        for (std::size_t i = 0; i < compiled[b]; ++i) {
+            const auto& inst = block.instructions[i];
+            if (is_deferred(inst)) {
+                plan.deferred.emplace_back(b, i);
+                continue;
+            }
+            for (const auto& arg : inst.arguments) {
+                used.insert(*liveness.find(arg));
+            }
+            if (inst.result.has_value()) {
+                defined.insert(*liveness.find(*inst.result));
+            }
+        }
+    }
+
+    // The interpreter has already materialised the header's phis when it hands over
+    for (const auto& phi : function.blocks[plan.header].phi_nodes) {
+        plan.inputs.push_back(phi.result);
+    }
+    for (const auto id : liveness.live_in[plan.header]) {
+        if (used.count(id) != 0) {
+            plan.inputs.push_back(liveness.values[id]);
+        }
+    }
+
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+        if (!plan.region[b]) {
+            continue;
+        }
+        const auto& block = function.blocks[b];
+        if (compiled[b] >= block.instructions.size()) {
+            for (const auto succ : block.successors) {
+                if (plan.in_region(succ)) {
+                    continue;
+                }
+                OsrExit exit;
+                exit.from = b;
+                exit.to = succ;
+                for (const auto id : liveness.live_out[b]) {
+                    if (defined.count(id) != 0) {
+                        exit.outputs.push_back(liveness.values[id]);
+                    }
+                }
+                plan.exits.push_back(std::move(exit));
+            }
+        }
+
+        // Exits inside the block, from the last instruction back: values live before each
+        std::unordered_set<std::size_t> live(liveness.live_out[b].begin(), liveness.live_out[b].end());
+        for (std::size_t i = block.instructions.size(); i-- > 0;) {
+            const auto& inst = block.instructions[i];
+            if (inst.result.has_value()) {
+                live.erase(*liveness.find(*inst.result));
+            }
+            for (const auto& arg : inst.arguments) {
+                live.insert(*liveness.find(arg));
+            }
+            const bool stop = i == compiled[b];
+            if (!stop && !(i < compiled[b] && is_guarded(inst))) {
+                continue;
+            }
+            OsrExit exit;
+            exit.from = b;
+            exit.to = b;
+            exit.instruction = i;
+            exit.guard = !stop;
+            for (const auto id : live) {
+                if (defined.count(id) != 0) {
+                    exit.outputs.push_back(liveness.values[id]);
+                }
+            }
+            std::sort(exit.outputs.begin(), exit.outputs.end(), [&](const ir::SsaValue& lhs, const ir::SsaValue& rhs) {
+                return *liveness.find(lhs) < *liveness.find(rhs);
+            });
+            plan.exits.push_back(std::move(exit));
+        }
+    }
+}
+
+}  // namespace
+
+auto OsrPlan::state_size() const -> std::size_t {
+    std::size_t slots = inputs.size();
+    for (const auto& exit : exits) {
+        slots = std::max(slots, exit.outputs.size());
+    }
+    return 1 + slots;
+}
+
+auto OsrPlan::find_exit(std::size_t block, std::size_t instruction, bool guard) const -> std::optional<std::size_t> {
+    for (std::size_t k = 0; k < exits.size(); ++k) {
+        if (exits[k].from == block && exits[k].instruction == instruction && exits[k].guard == guard) {
+            return k;
+        }
+    }
+    return std::nullopt;
+}
+
+auto is_deferred(const ir::SsaInstruction& inst) -> bool {
+    return inst.op == ir::SsaOpcode::LiteralString;
+}
+
+auto is_guarded(const ir::SsaInstruction& inst) -> bool {
+    return inst.op == ir::SsaOpcode::ArrayGet || inst.op == ir::SsaOpcode::ArraySet ||
+           inst.op == ir::SsaOpcode::ArrayLength || inst.op == ir::SsaOpcode::FieldGet ||
+           inst.op == ir::SsaOpcode::FieldSet ||
+           (inst.op == ir::SsaOpcode::Binary && inst.binary_op == ir::BinaryOp::Mod);
+}
+
+auto plan_osr(const ir::SsaFunction& function, std::size_t header) -> std::optional<OsrPlan> {
+    if (header >= function.blocks.size()) {
+        return std::nullopt;
+    }
+
+    OsrPlan plan;
+    plan.header = header;
+    plan.region.assign(function.blocks.size(), false);
+    plan.region[header] = true;
+
+    // Natural loop: everything that reaches a back-edge source without passing the header
+    std::vector<std::size_t> worklist;
+    for (const auto pred : function.blocks[header].predecessors) {
+        if (pred >= header && pred < function.blocks.size()) {
+            worklist.push_back(pred);
+        }
+    }
+    if (worklist.empty()) {
+        return std::nullopt;
+    }
+    while (!worklist.empty()) {
+        const std::size_t block = worklist.back();
+        worklist.pop_back();
+        if (plan.region[block]) {
+            continue;
+        }
+        plan.region[block] = true;
+        for (const auto pred : function.blocks[block].predecessors) {
+            if (pred < function.blocks.size() && !plan.region[pred]) {
+                worklist.push_back(pred);
+            }
+        }
+    }
+
+    std::vector<std::size_t> compiled;
+    compiled.reserve(function.blocks.size());
+    for (const auto& block : function.blocks) {
+        compiled.push_back(block.instructions.size());
+    }
+    finish_plan(function, compiled, plan);
+    return plan;
+}
+
+auto plan_speculation(const ir::SsaFunction& function, const std::vector<std::size_t>& compiled)
+    -> std::optional<OsrPlan> {
+    if (function.blocks.empty() || compiled.size() != function.blocks.size()) {
+        return std::nullopt;
+    }
+    const auto enters = [&](std::size_t block) {
+        return compiled[block] > 0 || function.blocks[block].instructions.empty();
+    };
+    if (!enters(0)) {
+        return std::nullopt;
+    }
+
+    OsrPlan plan;
+    plan.header = 0;
+    plan.region.assign(function.blocks.size(), false);
+    std::vector<std::size_t> worklist{0};
+    while (!worklist.empty()) {
+        const std::size_t block = worklist.back();
+        worklist.pop_back();
+        if (plan.region[block]) {
+            continue;
+        }
+        plan.region[block] = true;
+        if (compiled[block] < function.blocks[block].instructions.size()) {
+            continue;  // compiled code stops inside it
+        }
+        for (const auto succ : function.blocks[block].successors) {
+            if (succ < function.blocks.size() && !plan.region[succ] && enters(succ)) {
+                worklist.push_back(succ);
+            }
+        }
+    }
+
+    std::vector<std::size_t> limits(compiled.size());
+    for (std::size_t b = 0; b < compiled.size(); ++b) {
+        limits[b] = std::min(compiled[b], function.blocks[b].instructions.size());
+    }
+    finish_plan(function, limits, plan);
+    return plan;
+}
+
+}  // namespace impulse::jit
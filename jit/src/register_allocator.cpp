@@ -0,0 +1,169 @@
+#include "impulse/jit/register_allocator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "impulse/ir/liveness.h"
+
+namespace impulse::jit {
+
+namespace {
+
+struct LiveInterval {
+    std::size_t value = 0;  // dense index from SsaLiveness
+    int start = std::numeric_limits<int>::max();
+    int end = -1;
+
+    void extend(int position) {
+        start = std::min(start, position);
+        end = std::max(end, position);
+    }
+    [[nodiscard]] auto valid() const -> bool { return end >= 0; }
+};
+
+}  // namespace
+
+auto allocatable_xmm_registers() -> const std::vector<int>& {
+#ifdef _WIN32
+    // XMM6-XMM15 are callee-saved in the Windows x64 ABI
+    static const std::vector<int> registers{2, 3, 4, 5};
+#else
+    static const std::vector<int> registers{2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+#endif
+    return registers;
+}
+
+auto allocate_registers(const ir::SsaFunction& function, const std::vector<ir::SsaValue>& parameters)
+    -> RegisterAllocation {
+    const ir::SsaLiveness liveness = ir::compute_liveness(function);
+    std::vector<LiveInterval> intervals(liveness.values.size());
+    for (std::size_t i = 0; i < intervals.size(); ++i) {
+        intervals[i].value = i;
+    }
+
+    const auto extend = [&](const ir::SsaValue& value, int position) {
+        if (const auto id = liveness.find(value)) {
+            intervals[*id].extend(position);
+        }
+    };
+
+    // Position 0 is the function entry where parameters are loaded
+    int position = 0;
+    for (const auto& param : parameters) {
+        extend(param, position);
+    }
+    ++position;
+
+    std::vector<int> block_end(function.blocks.size(), 0);
+    std::vector<std::pair<int, const ir::SsaInstruction*>> calls;
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+        const auto& block = function.blocks[b];
+        const int entry = position++;
+        for (const auto id : liveness.live_in[b]) {
+            intervals[id].extend(entry);
+        }
+        for (const auto& phi : block.phi_nodes) {
+            extend(phi.result, entry);
+        }
+        for (const auto& inst : block.instructions) {
+            for (const auto& arg : inst.arguments) {
+                extend(arg, position);
+            }
+            if (inst.result.has_value()) {
+                extend(*inst.result, position);
+            }
+            if (inst.op == ir::SsaOpcode::Call) {
+                calls.emplace_back(position, &inst);
+            }
+            ++position;
+        }
+        const int exit = position++;
+        block_end[b] = exit;
+        for (const auto id : liveness.live_out[b]) {
+            intervals[id].extend(exit);
+        }
+    }
+
+    // Phi results are written by the moves at the end of each predecessor
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value() && input.predecessor < block_end.size()) {
+                    extend(phi.result, block_end[input.predecessor]);
+                }
+            }
+        }
+    }
+
+    std::vector<LiveInterval> ordered;
+    ordered.reserve(intervals.size());
+    for (const auto& interval : intervals) {
+        if (interval.valid()) {
+            ordered.push_back(interval);
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const LiveInterval& lhs, const LiveInterval& rhs) {
+        return lhs.start != rhs.start ? lhs.start < rhs.start : lhs.end < rhs.end;
+    });
+
+    RegisterAllocation allocation;
+    std::vector<int> assigned(intervals.size(), -1);
+    const auto spill = [&](std::size_t value) {
+        assigned[value] = -1;
+        const int32_t offset = -static_cast<int32_t>((allocation.spill_slots + 1) * 8);
+        ++allocation.spill_slots;
+        allocation.locations[ir::encode_ssa_value(liveness.values[value])] = ValueLocation::on_stack(offset);
+    };
+
+    // Free registers kept sorted descending so the lowest number is popped first
+    std::vector<int> free_registers(allocatable_xmm_registers().rbegin(), allocatable_xmm_registers().rend());
+    // Active intervals sorted by increasing end, paired with their register
+    std::vector<std::pair<LiveInterval, int>> active;
+
+    for (const auto& current : ordered) {
+        // Expire intervals that end no later than this one starts. An instruction reads its
+        // operands before writing its result, so a dying operand's register can be reused.
+        while (!active.empty() && active.front().first.end <= current.start) {
+            free_registers.push_back(active.front().second);
+            active.erase(active.begin());
+        }
+        std::sort(free_registers.begin(), free_registers.end(), std::greater<>());
+
+        int reg = -1;
+        if (!free_registers.empty()) {
+            reg = free_registers.back();
+            free_registers.pop_back();
+        } else if (!active.empty() && active.back().first.end > current.end) {
+            // Steal the register of the interval that stays live the longest
+            auto victim = active.back();
+            active.pop_back();
+            spill(victim.first.value);
+            reg = victim.second;
+        } else {
+            spill(current.value);
+            continue;
+        }
+
+        assigned[current.value] = reg;
+        allocation.locations[ir::encode_ssa_value(liveness.values[current.value])] = ValueLocation::in_register(reg);
+        const auto insert_at = std::upper_bound(active.begin(), active.end(), current.end,
+                                                [](int end, const auto& entry) { return end < entry.first.end; });
+        active.insert(insert_at, {current, reg});
+    }
+
+    for (const auto& [call_position, inst] : calls) {
+        auto& preserved = allocation.preserved_across_calls[inst];
+        for (const auto& interval : ordered) {
+            if (interval.start >= call_position) {
+                break;
+            }
+            if (interval.end > call_position && assigned[interval.value] >= 0) {
+                preserved.push_back(assigned[interval.value]);
+            }
+        }
+    }
+
+    return allocation;
+}
+
+}  // namespace impulse::jit
@@ -0,0 +1,346 @@
+#include "impulse/jit/symbols.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef __linux__
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// The GDB JIT interface: GDB sets a breakpoint in __jit_debug_register_code and reads the entry
+// named by the descriptor each time it is hit. Both names and layouts are fixed by GDB.
+extern "C" {
+struct jit_code_entry {
+    jit_code_entry* next_entry;
+    jit_code_entry* prev_entry;
+    const char* symfile_addr;
+    std::uint64_t symfile_size;
+};
+
+struct jit_descriptor {
+    std::uint32_t version;
+    std::uint32_t action_flag;  // 1: register relevant_entry, 2: unregister it
+    jit_code_entry* relevant_entry;
+    jit_code_entry* first_entry;
+};
+
+[[gnu::noinline, gnu::used]] void __jit_debug_register_code() {
+    asm volatile("" ::: "memory");  // keeps the call, which is where GDB stops
+}
+
+[[gnu::used]] jit_descriptor __jit_debug_descriptor = {1, 0, nullptr, nullptr};
+}
+#endif
+
+namespace impulse::jit {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr std::uint32_t kJitdumpMagic = 0x4A695444;  // "JiTD"
+constexpr std::uint32_t kJitdumpVersion = 1;
+constexpr std::uint32_t kJitCodeLoad = 0;
+
+struct JitdumpHeader {
+    std::uint32_t magic = kJitdumpMagic;
+    std::uint32_t version = kJitdumpVersion;
+    std::uint32_t total_size = sizeof(JitdumpHeader);
+    std::uint32_t elf_mach = EM_X86_64;
+    std::uint32_t pad1 = 0;
+    std::uint32_t pid = 0;
+    std::uint64_t timestamp = 0;
+    std::uint64_t flags = 0;
+};
+
+struct JitdumpCodeLoad {
+    std::uint32_t id = kJitCodeLoad;
+    std::uint32_t total_size = 0;
+    std::uint64_t timestamp = 0;
+    std::uint32_t pid = 0;
+    std::uint32_t tid = 0;
+    std::uint64_t vma = 0;
+    std::uint64_t code_addr = 0;
+    std::uint64_t code_size = 0;
+    std::uint64_t code_index = 0;
+    // followed by the name, NUL-terminated, and the code bytes
+};
+
+// The clock `perf record -k 1` uses, so records line up with samples
+[[nodiscard]] auto monotonic_ns() -> std::uint64_t {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(now.tv_nsec);
+}
+
+void write_all(int fd, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return;  // symbols are best effort
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+template <typename T>
+void append(std::vector<char>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// A relocatable ELF object with no contents of its own: a NOBITS .text placed at the code's
+// address and one function symbol covering it, which is all GDB needs to name frames
+[[nodiscard]] auto symbol_file(const std::string& name, const void* code, std::size_t size) -> std::vector<char> {
+    static constexpr char kSectionNames[] = "\0.text\0.symtab\0.strtab\0.shstrtab";
+    enum : std::uint16_t { kNull, kText, kSymtab, kStrtab, kShstrtab, kSections };
+    const auto address = static_cast<Elf64_Addr>(reinterpret_cast<std::uintptr_t>(code));
+
+    std::vector<char> strtab(1, '\0');
+    strtab.insert(strtab.end(), name.begin(), name.end());
+    strtab.push_back('\0');
+
+    Elf64_Sym symbols[2]{};
+    symbols[1].st_name = 1;
+    symbols[1].st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+    symbols[1].st_shndx = kText;
+    symbols[1].st_value = address;
+    symbols[1].st_size = size;
+
+    const std::size_t symtab_offset = sizeof(Elf64_Ehdr);
+    const std::size_t strtab_offset = symtab_offset + sizeof(symbols);
+    const std::size_t shstrtab_offset = strtab_offset + strtab.size();
+    const std::size_t headers_offset = (shstrtab_offset + sizeof(kSectionNames) + 7) & ~std::size_t{7};
+
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = headers_offset;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = kSections;
+    header.e_shstrndx = kShstrtab;
+
+    Elf64_Shdr sections[kSections]{};
+    sections[kText].sh_name = 1;
+    sections[kText].sh_type = SHT_NOBITS;
+    sections[kText].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    sections[kText].sh_addr = address;
+    sections[kText].sh_size = size;
+    sections[kText].sh_addralign = 16;
+    sections[kSymtab].sh_name = 7;
+    sections[kSymtab].sh_type = SHT_SYMTAB;
+    sections[kSymtab].sh_offset = symtab_offset;
+    sections[kSymtab].sh_size = sizeof(symbols);
+    sections[kSymtab].sh_link = kStrtab;
+    sections[kSymtab].sh_info = 1;  // index of the first global symbol
+    sections[kSymtab].sh_addralign = 8;
+    sections[kSymtab].sh_entsize = sizeof(Elf64_Sym);
+    sections[kStrtab].sh_name = 15;
+    sections[kStrtab].sh_type = SHT_STRTAB;
+    sections[kStrtab].sh_offset = strtab_offset;
+    sections[kStrtab].sh_size = strtab.size();
+    sections[kStrtab].sh_addralign = 1;
+    sections[kShstrtab].sh_name = 23;
+    sections[kShstrtab].sh_type = SHT_STRTAB;
+    sections[kShstrtab].sh_offset = shstrtab_offset;
+    sections[kShstrtab].sh_size = sizeof(kSectionNames);
+    sections[kShstrtab].sh_addralign = 1;
+
+    std::vector<char> file;
+    file.reserve(headers_offset + sizeof(sections));
+    append(file, header);
+    append(file, symbols);
+    file.insert(file.end(), strtab.begin(), strtab.end());
+    file.insert(file.end(), kSectionNames, kSectionNames + sizeof(kSectionNames));
+    file.resize(headers_offset, '\0');
+    append(file, sections);
+    return file;
+}
+
+// Serialises registrations from every publisher in the process: there is one descriptor
+[[nodiscard]] auto gdb_mutex() -> std::mutex& {
+    static std::mutex mutex;
+    return mutex;
+}
+
+}  // namespace
+
+struct JitSymbols::GdbEntry {
+    const void* owner = nullptr;
+    std::vector<char> symfile;
+    jit_code_entry entry{};
+};
+
+JitSymbols::JitSymbols(JitSymbolOptions options) : options_(std::move(options)) {
+    const std::string pid = std::to_string(getpid());
+    if (options_.perf_map) {
+        const std::string path = options_.directory + "/perf-" + pid + ".map";
+        perf_map_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+    if (options_.jitdump) {
+        const std::string path = options_.directory + "/jit-" + pid + ".dump";
+        jitdump_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (jitdump_ >= 0) {
+            JitdumpHeader header;
+            header.pid = static_cast<std::uint32_t>(getpid());
+            header.timestamp = monotonic_ns();
+            write_all(jitdump_, &header, sizeof(header));
+            const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            void* marker = mmap(nullptr, page, PROT_READ | PROT_EXEC, MAP_PRIVATE, jitdump_, 0);
+            jitdump_marker_ = marker != MAP_FAILED ? marker : nullptr;
+        }
+    }
+}
+
+JitSymbols::~JitSymbols() {
+    forget(nullptr);
+    if (jitdump_marker_ != nullptr) {
+        munmap(jitdump_marker_, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+    }
+    if (jitdump_ >= 0) {
+        close(jitdump_);
+    }
+    if (perf_map_ >= 0) {
+        close(perf_map_);
+    }
+}
+
+void JitSymbols::add(const void* owner, const std::string& name, const void* code, std::size_t size) {
+    if (code == nullptr || size == 0) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(mutex_);
+    write_perf_map(name, code, size);
+    write_jitdump(name, code, size);
+    register_gdb(owner, name, code, size);
+}
+
+void JitSymbols::forget(const void* owner) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    const std::lock_guard<std::mutex> gdb_lock(gdb_mutex());
+    for (auto it = gdb_entries_.begin(); it != gdb_entries_.end();) {
+        if (owner != nullptr && (*it)->owner != owner) {
+            ++it;
+            continue;
+        }
+        jit_code_entry* entry = &(*it)->entry;
+        if (entry->prev_entry != nullptr) {
+            entry->prev_entry->next_entry = entry->next_entry;
+        } else {
+            __jit_debug_descriptor.first_entry = entry->next_entry;
+        }
+        if (entry->next_entry != nullptr) {
+            entry->next_entry->prev_entry = entry->prev_entry;
+        }
+        __jit_debug_descriptor.relevant_entry = entry;
+        __jit_debug_descriptor.action_flag = 2;
+        __jit_debug_register_code();
+        it = gdb_entries_.erase(it);
+    }
+}
+
+auto JitSymbols::gdb_entry_count() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return gdb_entries_.size();
+}
+
+void JitSymbols::write_perf_map(const std::string& name, const void* code, std::size_t size) {
+    if (perf_map_ < 0) {
+        return;
+    }
+    char prefix[64];
+    const int length = std::snprintf(prefix, sizeof(prefix), "%lx %zx ",
+                                     static_cast<unsigned long>(reinterpret_cast<std::uintptr_t>(code)), size);
+    std::string line(prefix, static_cast<std::size_t>(length));
+    line += name;
+    line += '\n';
+    write_all(perf_map_, line.data(), line.size());  // one write per line: O_APPEND keeps lines whole
+}
+
+void JitSymbols::write_jitdump(const std::string& name, const void* code, std::size_t size) {
+    if (jitdump_ < 0) {
+        return;
+    }
+    JitdumpCodeLoad record;
+    record.total_size = static_cast<std::uint32_t>(sizeof(record) + name.size() + 1 + size);
+    record.timestamp = monotonic_ns();
+    record.pid = static_cast<std::uint32_t>(getpid());
+    record.tid = static_cast<std::uint32_t>(syscall(SYS_gettid));
+    record.vma = reinterpret_cast<std::uintptr_t>(code);
+    record.code_addr = record.vma;
+    record.code_size = size;
+    record.code_index = code_index_++;
+
+    std::vector<char> bytes;
+    bytes.reserve(record.total_size);
+    append(bytes, record);
+    bytes.insert(bytes.end(), name.begin(), name.end());
+    bytes.push_back('\0');
+    const auto* begin = static_cast<const char*>(code);  // installed code stays readable
+    bytes.insert(bytes.end(), begin, begin + size);
+    write_all(jitdump_, bytes.data(), bytes.size());
+}
+
+void JitSymbols::register_gdb(const void* owner, const std::string& name, const void* code, std::size_t size) {
+    if (!options_.gdb) {
+        return;
+    }
+    auto entry = std::make_unique<GdbEntry>();
+    entry->owner = owner;
+    entry->symfile = symbol_file(name, code, size);
+    entry->entry.symfile_addr = entry->symfile.data();
+    entry->entry.symfile_size = entry->symfile.size();
+
+    const std::lock_guard<std::mutex> gdb_lock(gdb_mutex());
+    entry->entry.next_entry = __jit_debug_descriptor.first_entry;
+    if (entry->entry.next_entry != nullptr) {
+        entry->entry.next_entry->prev_entry = &entry->entry;
+    }
+    __jit_debug_descriptor.first_entry = &entry->entry;
+    __jit_debug_descriptor.relevant_entry = &entry->entry;
+    __jit_debug_descriptor.action_flag = 1;
+    __jit_debug_register_code();
+    gdb_entries_.push_back(std::move(entry));
+}
+
+#else
+
+struct JitSymbols::GdbEntry {};
+
+JitSymbols::JitSymbols(JitSymbolOptions options) : options_(std::move(options)) {}
+
+JitSymbols::~JitSymbols() = default;
+
+void JitSymbols::add(const void*, const std::string&, const void*, std::size_t) {}
+
+void JitSymbols::forget(const void*) {}
+
+auto JitSymbols::gdb_entry_count() const -> std::size_t {
+    return 0;
+}
+
+void JitSymbols::write_perf_map(const std::string&, const void*, std::size_t) {}
+
+void JitSymbols::write_jitdump(const std::string&, const void*, std::size_t) {}
+
+void JitSymbols::register_gdb(const void*, const std::string&, const void*, std::size_t) {}
+
+#endif
+
+}  // namespace impulse::jit
@@ -0,0 +1,248 @@
+#include "impulse/jit/vectorize.h"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "impulse/ir/liveness.h"
+#include "impulse/ir/loops.h"
+
+namespace impulse::jit {
+
+namespace {
+
+using UseCounts = std::unordered_map<std::uint64_t, std::size_t>;
+
+[[nodiscard]] auto same(const ir::SsaValue& lhs, const ir::SsaValue& rhs) -> bool {
+    return lhs.symbol == rhs.symbol && lhs.version == rhs.version;
+}
+
+[[nodiscard]] auto count(const UseCounts& uses, const ir::SsaValue& value) -> std::size_t {
+    const auto it = uses.find(ir::encode_ssa_value(value));
+    return it == uses.end() ? 0 : it->second;
+}
+
+void count_uses(const ir::SsaBlock& block, UseCounts& uses) {
+    for (const auto& inst : block.instructions) {
+        for (const auto& argument : inst.arguments) {
+            ++uses[ir::encode_ssa_value(argument)];
+        }
+    }
+}
+
+// x when `inst` computes value + x or x + value
+[[nodiscard]] auto added_to(const ir::SsaInstruction& inst, const ir::SsaValue& value) -> std::optional<ir::SsaValue> {
+    if (inst.op != ir::SsaOpcode::Binary || inst.binary_op != ir::BinaryOp::Add || inst.arguments.size() != 2) {
+        return std::nullopt;
+    }
+    if (same(inst.arguments[0], value)) {
+        return inst.arguments[1];
+    }
+    if (same(inst.arguments[1], value)) {
+        return inst.arguments[0];
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] auto plan_loop(const ir::SsaFunction& function, const ir::Loop& loop, const ir::ValueFacts& facts,
+                             const UseCounts& uses) -> std::optional<VectorLoop> {
+    if (loop.blocks.size() != 2 || loop.latches.size() != 1 || loop.latches.front() == loop.header) {
+        return std::nullopt;
+    }
+    VectorLoop plan;
+    plan.header = loop.header;
+    plan.body = loop.latches.front();
+    const auto& header = function.blocks[plan.header];
+    const auto& body = function.blocks[plan.body];
+    if (body.predecessors != std::vector<std::size_t>{plan.header} ||
+        body.successors != std::vector<std::size_t>{plan.header} || header.instructions.size() != 2 ||
+        body.instructions.empty()) {
+        return std::nullopt;
+    }
+
+    // header: c = i < bound; go on to the body exactly when c holds
+    const auto& compare = header.instructions[0];
+    const auto& branch = header.instructions[1];
+    if (compare.op != ir::SsaOpcode::Binary || compare.arguments.size() != 2 || !compare.result.has_value() ||
+        branch.op != ir::SsaOpcode::BranchIf || branch.arguments.size() != 1 || branch.immediates.size() < 2 ||
+        !same(branch.arguments[0], *compare.result) || count(uses, *compare.result) != 1) {
+        return std::nullopt;
+    }
+    const auto& compare_val = branch.number;
+    const bool to_body = branch.immediates[0] == body.name;
+    if (!compare_val.has_value() || !((*compare_val == 0.0 && !to_body) || (*compare_val == 1.0 && to_body))) {
+        return std::nullopt;
+    }
+    if (compare.binary_op == ir::BinaryOp::Lt) {
+        plan.induction = compare.arguments[0];
+        plan.bound = compare.arguments[1];
+    } else if (compare.binary_op == ir::BinaryOp::Gt) {
+        plan.induction = compare.arguments[1];
+        plan.bound = compare.arguments[0];
+    } else {
+        return std::nullopt;
+    }
+
+    std::unordered_set<std::uint64_t> defined;
+    UseCounts inside;
+    for (const auto& phi : header.phi_nodes) {
+        defined.insert(ir::encode_ssa_value(phi.result));
+        for (const auto& input : phi.inputs) {
+            if (input.predecessor == plan.body && input.value.has_value()) {
+                ++inside[ir::encode_ssa_value(*input.value)];
+            }
+        }
+    }
+    for (const auto* block : {&header, &body}) {
+        for (const auto& inst : block->instructions) {
+            if (inst.result.has_value()) {
+                defined.insert(ir::encode_ssa_value(*inst.result));
+            }
+        }
+        count_uses(*block, inside);
+    }
+    const auto is_defined = [&](const ir::SsaValue& value) { return defined.count(ir::encode_ssa_value(value)) != 0; };
+    if (is_defined(plan.bound)) {
+        return std::nullopt;
+    }
+
+    // Header phis: the induction variable and sums, each with one input from outside and one
+    // from the body
+    bool counted = false;
+    for (const auto& phi : header.phi_nodes) {
+        std::optional<ir::SsaValue> back;
+        std::size_t entries = 0;
+        for (const auto& input : phi.inputs) {
+            if (!input.value.has_value()) {
+                return std::nullopt;
+            }
+            if (input.predecessor == plan.body) {
+                back = input.value;
+            } else {
+                ++entries;
+            }
+        }
+        if (!back.has_value() || entries != 1 || count(uses, *back) != 1) {
+            return std::nullopt;
+        }
+        if (same(phi.result, plan.induction)) {
+            plan.step = *back;
+            counted = true;
+        } else {
+            plan.reductions.push_back(VectorReduction{phi.result, *back, ir::SsaValue{}});
+        }
+    }
+    if (!counted) {
+        return std::nullopt;
+    }
+
+    // Body: lane-wise operations on values computed in this iteration or before the loop
+    std::unordered_set<std::uint64_t> lanes;
+    const auto lane_operand = [&](const ir::SsaValue& value) {
+        return !is_defined(value) || lanes.count(ir::encode_ssa_value(value)) != 0;
+    };
+    const auto use_array = [&](const ir::SsaInstruction& inst) {
+        if (is_defined(inst.arguments[0]) || !same(inst.arguments[1], plan.induction)) {
+            return false;
+        }
+        const auto known = std::find_if(plan.arrays.begin(), plan.arrays.end(),
+                                        [&](const ir::SsaValue& array) { return same(array, inst.arguments[0]); });
+        if (known == plan.arrays.end()) {
+            plan.arrays.push_back(inst.arguments[0]);
+        }
+        return true;
+    };
+    for (std::size_t i = 0; i < body.instructions.size(); ++i) {
+        const auto& inst = body.instructions[i];
+        if (i + 1 == body.instructions.size()) {
+            if (inst.op != ir::SsaOpcode::Branch || inst.immediates.empty() || inst.immediates[0] != header.name) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        if (inst.result.has_value() && same(*inst.result, plan.step)) {
+            const auto one = added_to(inst, plan.induction);
+            if (!one.has_value() || facts.constant(*one) != 1.0) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        const auto reduction =
+            std::find_if(plan.reductions.begin(), plan.reductions.end(), [&](const VectorReduction& sum) {
+                return inst.result.has_value() && same(*inst.result, sum.update);
+            });
+        if (reduction != plan.reductions.end()) {
+            const auto addend = added_to(inst, reduction->phi);
+            if (!addend.has_value() || same(*addend, reduction->phi) || !lane_operand(*addend) ||
+                count(inside, reduction->phi) != 1 || !facts.integral(reduction->phi) || !facts.integral(*addend)) {
+                return std::nullopt;
+            }
+            reduction->addend = *addend;
+            continue;
+        }
+
+        bool supported = false;
+        switch (inst.op) {
+        case ir::SsaOpcode::Literal:
+            supported = inst.result.has_value() && facts.constant(*inst.result).has_value();
+            break;
+        case ir::SsaOpcode::Binary:
+            supported = inst.result.has_value() && inst.arguments.size() == 2 &&
+                        (inst.binary_op == ir::BinaryOp::Add || inst.binary_op == ir::BinaryOp::Sub ||
+                         inst.binary_op == ir::BinaryOp::Mul ||
+                         // vdivpd does not trap, so only a divisor known not to be zero is safe
+                         (inst.binary_op == ir::BinaryOp::Div && facts.safe_divisor(inst.arguments[1]))) &&
+                        lane_operand(inst.arguments[0]) && lane_operand(inst.arguments[1]);
+            break;
+        case ir::SsaOpcode::ArrayGet:
+            supported = inst.result.has_value() && inst.arguments.size() == 2 && use_array(inst);
+            break;
+        case ir::SsaOpcode::ArraySet:
+            supported = inst.arguments.size() == 3 && lane_operand(inst.arguments[2]) &&
+                        (!inst.result.has_value() || count(uses, *inst.result) == 0) && use_array(inst);
+            break;
+        default:
+            break;
+        }
+        if (!supported) {
+            return std::nullopt;
+        }
+        if (inst.result.has_value()) {
+            lanes.insert(ir::encode_ssa_value(*inst.result));
+        }
+    }
+
+    const bool summed = std::all_of(plan.reductions.begin(), plan.reductions.end(),
+                                    [](const VectorReduction& sum) { return sum.addend.is_valid(); });
+    if (!summed || plan.arrays.empty() || plan.arrays.size() > kMaxVectorArrays) {
+        return std::nullopt;
+    }
+    return plan;
+}
+
+}  // namespace
+
+auto plan_vector_loops(const ir::SsaFunction& function, const ir::ValueFacts& facts) -> std::vector<VectorLoop> {
+    UseCounts uses;
+    for (const auto& block : function.blocks) {
+        count_uses(block, uses);
+        for (const auto& phi : block.phi_nodes) {
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    ++uses[ir::encode_ssa_value(*input.value)];
+                }
+            }
+        }
+    }
+
+    std::vector<VectorLoop> plans;
+    for (const auto& loop : ir::find_loops(function).loops) {
+        if (auto plan = plan_loop(function, loop, facts, uses)) {
+            plans.push_back(std::move(*plan));
+        }
+    }
+    return plans;
+}
+
+}  // namespace impulse::jit
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "impulse/runtime/runtime.h"
+#include "impulse/runtime/value.h"
+
+namespace impulse::runtime {
+
+// Loops over unboxed array elements (Float64Array storage, holes included). One implementation is
+// picked per process from what the CPU supports: AVX-512, AVX2 or portable scalar code. All of
+// them combine elements in the same order (16 interleaved partial results folded pairwise, then
+// the last count % 16 elements one by one) and none contracts to FMA, so results are bit-for-bit
+// the same on every CPU.
+struct ArrayKernels {
+    const char* isa = "scalar";
+    // Holes are skipped
+    double (*sum)(const double* values, std::size_t count) = nullptr;
+    // Pairs with a hole on either side are skipped
+    double (*dot)(const double* lhs, const double* rhs, std::size_t count) = nullptr;
+    // Smallest / largest element, skipping holes and NaNs; false when nothing is left
+    bool (*min)(const double* values, std::size_t count, double* result) = nullptr;
+    bool (*max)(const double* values, std::size_t count, double* result) = nullptr;
+    // values *= factor, leaving holes in place
+    void (*scale)(double* values, std::size_t count, double factor) = nullptr;
+    // y += factor * x: holes in x add nothing, holes in y stay holes
+    void (*axpy)(double factor, const double* x, double* y, std::size_t count) = nullptr;
+};
+
+// The best implementation for this CPU
+[[nodiscard]] auto array_kernels() -> const ArrayKernels&;
+// Every implementation this CPU can run, scalar first
+[[nodiscard]] auto supported_array_kernels() -> std::vector<const ArrayKernels*>;
+
+// The numeric array builtins (array_sum, array_dot, array_min, array_max, array_scale,
+// array_axpy, array_copy, array_fill with a number, and the sort and search ones) on whole
+// arrays, shared by the interpreter and compiled code. Float64Arrays are processed in place;
+// boxed arrays must hold only numbers and nil, which go through a scratch copy. The reductions
+// return their number in VmResult::value; the others update the array in place and return no
+// value.
+[[nodiscard]] auto array_sum(const GcObject& array) -> VmResult;
+[[nodiscard]] auto array_dot(const GcObject& lhs, const GcObject& rhs) -> VmResult;
+[[nodiscard]] auto array_min(const GcObject& array) -> VmResult;
+[[nodiscard]] auto array_max(const GcObject& array) -> VmResult;
+[[nodiscard]] auto array_scale(GcObject& array, double factor) -> VmResult;
+// y += factor * x
+[[nodiscard]] auto array_axpy(double factor, const GcObject& x, GcObject& y) -> VmResult;
+// Copies `source` over `destination`, which must be as long
+[[nodiscard]] auto array_copy(GcObject& destination, const GcObject& source) -> VmResult;
+[[nodiscard]] auto array_fill_number(GcObject& array, double value) -> VmResult;
+
+// Sorting orders numbers ascending, then NaNs, then nils, with -0 before +0. Arrays of at least
+// kParallelSortElements are radix sorted on several threads, smaller ones with std::sort (or
+// std::stable_sort for the index order, which keeps equal elements in array order).
+inline constexpr std::size_t kParallelSortElements = std::size_t{1} << 17;
+[[nodiscard]] auto array_sort(GcObject& array) -> VmResult;
+// The indices of `array` in sorted order, for array_sort_by_index
+[[nodiscard]] auto array_sort_order(const GcObject& array, std::vector<double>& order) -> VmResult;
+// Index of the first element equal to `value` in a sorted array, -1 when there is none
+[[nodiscard]] auto array_binary_search(const GcObject& array, double value) -> VmResult;
+
+}  // namespace impulse::runtime
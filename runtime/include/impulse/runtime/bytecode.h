@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "impulse/ir/ir.h"
+#include "impulse/ir/ssa.h"
+#include "impulse/runtime/frame_layout.h"
+#include "impulse/runtime/struct_layout.h"
+
+namespace impulse::runtime {
+
+// Operands are register-file slots (see SsaFrameLayout) unless noted otherwise
+enum class BytecodeOp : std::uint8_t {
+    LoadNumber,    // dst = constants[a]
+    LoadString,    // dst = strings[a]
+    Move,          // dst = a
+    Drop,          // check that a is defined
+    Neg,           // dst = -a
+    Not,           // dst = !a
+    Add,           // dst = a op b, for Add through Or
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Eq,
+    Ne,
+    And,
+    Or,
+    Return,        // return a
+    Jump,          // branch to block a
+    Fallthrough,   // implicit edge to block a at the end of a block (not traced as a branch)
+    JumpIf,        // if a == constants[dst] branch to block b, else to block c (kNoBlock: none)
+    Call,          // dst = callees[c](operands[a .. a + b))
+    TailCall,      // Call whose result the next instruction returns (see ir::is_tail_call)
+    ArrayMake,     // dst = array of length a
+    ArrayGet,      // dst = a[b]
+    ArraySet,      // a[b] = c, dst = c
+    ArrayGetInBounds,  // ArrayGet where a is known to be an array and b an index below its length
+    ArraySetInBounds,  // ArraySet, with the same guarantee (see ir::ArrayBounds)
+    ArrayLength,   // dst = length of a
+    ArrayPush,     // push b onto a, dst = new length
+    ArrayPop,      // dst = value popped from a
+    StructMake,    // dst = new instance of structs[a], fields from operands[b ..) in declaration order
+    FieldGetNumber,  // dst = numeric field c of a, which must have shape b
+    FieldGetValue,   // dst = boxed field c of a, which must have shape b
+    FieldSetNumber,  // numeric field c of a = dst, a must have shape b
+    FieldSetValue,   // boxed field c of a = dst, a must have shape b
+    Fail,          // stop with VmStatus a and message strings[b]
+};
+
+// Fixed-width instruction: 20 bytes, no owning members
+struct BytecodeInstruction {
+    BytecodeOp op = BytecodeOp::Fail;
+    std::uint32_t dst = 0;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t c = 0;
+};
+
+// A run of SsaBytecode::live_slots
+struct LiveRange {
+    std::uint32_t begin = 0;
+    std::uint32_t end = 0;
+};
+
+struct BytecodeCallee {
+    static constexpr std::uint32_t kNoFunction = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t kNoBuiltin = std::numeric_limits<std::uint32_t>::max();
+
+    std::string name;
+    std::uint32_t builtin = kNoBuiltin;    // index into the interpreter's builtins (SsaInterpreter::find_builtin)
+    std::uint32_t function = kNoFunction;  // index into the module's functions when not a builtin
+};
+
+// Compact form of an SSA function for the interpreter, built once when the SSA is cached. Each
+// block's instructions are laid out contiguously and end in a control transfer (a Fallthrough to
+// the block's first successor, or a Fail when it has none). Literals, call arities, branch
+// labels, callees and struct fields are resolved here; instructions the SSA interpreter would reject become Fail
+// instructions carrying the same status and message, so errors still surface only when reached.
+struct SsaBytecode {
+    static constexpr std::uint32_t kNoSource = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t kNoBlock = std::numeric_limits<std::uint32_t>::max();
+
+    std::vector<BytecodeInstruction> code;
+    std::vector<std::uint32_t> block_start;  // per block: index of its first instruction
+    std::vector<std::uint32_t> sources;      // per instruction: SSA instruction index in its block, for tracing
+    std::vector<double> constants;
+    std::vector<std::string> strings;
+    std::vector<std::uint32_t> operands;     // call argument and struct field slots
+    std::vector<BytecodeCallee> callees;
+    std::vector<StructLayout> structs;       // every struct the function builds or accesses
+    // Precise GC roots, from SSA liveness. An instruction that may collect (string loads and
+    // concatenations, calls, array and struct allocations) lists the slots read by it or after it; a block
+    // lists those live once its phis are materialised, which is where OSR entries happen.
+    std::vector<LiveRange> safepoints;  // per instruction, left empty for the others
+    std::vector<LiveRange> block_live;  // per block
+    std::vector<std::uint32_t> live_slots;
+};
+
+// `functions` are the module's functions; Call instructions refer to them by index. Field
+// accesses are resolved against `structs`, the module's struct layouts.
+[[nodiscard]] auto compile_bytecode(const ir::SsaFunction& function, const SsaFrameLayout& layout,
+                                    const std::vector<ir::Function>& functions,
+                                    const std::vector<StructLayout>& structs = {}) -> SsaBytecode;
+
+}  // namespace impulse::runtime
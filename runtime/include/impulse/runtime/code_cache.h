@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/ir/ir.h"
+#include "impulse/ir/optimizer.h"
+#include "impulse/jit/jit.h"
+#include "impulse/runtime/struct_layout.h"
+
+namespace impulse::runtime {
+
+// Read-only view of a whole file: memory-mapped where possible, read into memory otherwise
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+    [[nodiscard]] auto contents() const -> std::string_view;
+
+private:
+    void* mapped_ = nullptr;
+    std::size_t size_ = 0;
+    std::string fallback_;
+};
+
+// What a run produced for one function. The views borrow from the cache file (or, when
+// writing, from the caller): `ssa` is the serialize_ssa encoding of the optimised SSA, and
+// `code` the machine code with its relocations, once the function was considered for the JIT.
+struct PersistedFunction {
+    std::string_view ssa;
+    bool jit_checked = false;
+    bool can_jit = false;
+    std::string_view code;
+    std::vector<jit::JitRelocation> relocations;
+};
+
+// One module's cache file, by function name; `file` backs every view
+struct PersistedModule {
+    std::unique_ptr<MappedFile> file;
+    std::unordered_map<std::string, PersistedFunction> functions;
+};
+
+// Identifies the compiled form of `module`: the cache format, the lowered IR, the SSA passes
+// and everything the generated code bakes in (array layout, the module's struct layouts and
+// shapes, Value size, SSE4.1 use). Any change produces a new file.
+[[nodiscard]] auto code_cache_key(const ir::Module& module, const jit::JitArrayLayout& arrays,
+                                  const ir::OptimizationOptions& passes, const std::vector<StructLayout>& structs)
+    -> std::uint64_t;
+// Content hash of each of `module`'s functions, in module order, over its lowered blocks and
+// those of every module function it calls directly or not (their SSA may be inlined into it).
+// A function whose hash survives a reload would be rebuilt and recompiled the same.
+[[nodiscard]] auto function_hashes(const ir::Module& module) -> std::vector<std::uint64_t>;
+[[nodiscard]] auto code_cache_path(const std::string& directory, std::uint64_t key) -> std::string;
+
+// Maps a cache file and indexes its functions; nullopt when it is missing, written for another
+// key or corrupt (its payload no longer matches the digest in its header)
+[[nodiscard]] auto read_code_cache(const std::string& path, std::uint64_t key) -> std::optional<PersistedModule>;
+// Writes through a temporary file renamed over `path`, so readers never see a partial file
+[[nodiscard]] auto write_code_cache(const std::string& path, std::uint64_t key,
+                                    const std::unordered_map<std::string, PersistedFunction>& functions) -> bool;
+
+}  // namespace impulse::runtime
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "impulse/ir/ir.h"
+#include "impulse/ir/ssa.h"
+#include "impulse/runtime/value.h"
+
+namespace impulse::runtime {
+
+// Dense numbering of an SSA function's values for the interpreter's register file, built once
+// when the SSA is cached. Versions of one symbol occupy consecutive slots, so a value's slot is
+// symbol_base[symbol] + version without hashing. Phi inputs are resolved to slots up front.
+struct SsaFrameLayout {
+    static constexpr std::uint32_t kNoSlot = std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot {
+        ir::SsaValue value;
+        std::string name;           // symbol name; version 0 reads fall back to it
+        bool mirror_local = false;  // versions 0/1 of variables read by name are also kept in the locals map
+    };
+
+    struct Phi {
+        std::uint32_t result = kNoSlot;
+        std::vector<std::pair<std::size_t, std::uint32_t>> inputs;  // (predecessor block, slot)
+    };
+
+    struct Block {
+        std::vector<Phi> phis;
+    };
+
+    std::vector<std::uint32_t> symbol_base;      // indexed by symbol id
+    std::vector<std::uint32_t> symbol_versions;  // number of slots reserved per symbol
+    std::vector<Slot> slots;
+    std::vector<Block> blocks;
+    std::vector<std::uint32_t> parameters;  // version 1 slot of each parameter in order (kNoSlot if unused)
+
+    [[nodiscard]] auto slot_of(const ir::SsaValue& value) const -> std::uint32_t {
+        if (value.symbol >= symbol_base.size() || value.version >= symbol_versions[value.symbol]) {
+            return kNoSlot;
+        }
+        return symbol_base[value.symbol] + value.version;
+    }
+};
+
+[[nodiscard]] auto build_frame_layout(const ir::SsaFunction& function,
+                                      const std::vector<ir::FunctionParameter>& parameters = {}) -> SsaFrameLayout;
+
+// Storage of one interpreter activation. The VM keeps a stack of these and reuses them across
+// calls, so a call only allocates when it runs deeper or needs more slots than any call before.
+struct InterpreterFrame {
+    std::vector<Value> registers;                   // one Value per layout slot
+    std::vector<std::uint8_t> defined;              // per slot: written during this call
+    std::unordered_map<std::string, Value> locals;  // mirrored variables, for version 0 reads
+    std::vector<Value> arguments;                   // outgoing call arguments
+    std::vector<double> native_arguments;           // arguments of a compiled entry
+    // Once the interpreter has passed a safepoint, only these registers hold values it will read
+    // again and only they are GC roots (the others may point at collected objects). Until then
+    // every register is a root.
+    bool precise_roots = false;
+    const std::uint32_t* live_slots = nullptr;
+    std::size_t live_count = 0;
+
+    // Forget the previous call's values, keeping the storage
+    void reset(std::size_t slots) {
+        precise_roots = false;
+        registers.assign(slots, Value{});
+        defined.assign(slots, 0);
+        if (!locals.empty()) {
+            locals.clear();
+        }
+        arguments.clear();
+        native_arguments.clear();
+    }
+};
+
+}  // namespace impulse::runtime
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace impulse::runtime {
+
+// Growable element storage of a GcObject. Like std::vector it is a begin/end/capacity triple, so
+// compiled code can read the element pointers, but the heap may hand it storage inside the
+// object's own cell (use_inline); it moves to malloc'd storage only once it outgrows that.
+template <typename T>
+class GcBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "elements are moved with memcpy");
+
+public:
+    GcBuffer() = default;
+    ~GcBuffer() { release(); }
+
+    GcBuffer(const GcBuffer&) = delete;
+    auto operator=(const GcBuffer&) -> GcBuffer& = delete;
+    GcBuffer(GcBuffer&&) = delete;
+    auto operator=(GcBuffer&&) -> GcBuffer& = delete;
+
+    // Use `bytes` of `storage`, owned by someone else, until the elements outgrow it. Requires an
+    // empty buffer without storage.
+    void use_inline(void* storage, std::size_t bytes) {
+        begin_ = static_cast<T*>(storage);
+        end_ = begin_;
+        capacity_ = begin_ + (bytes / sizeof(T));
+        inline_ = true;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return static_cast<std::size_t>(end_ - begin_); }
+    [[nodiscard]] auto capacity() const -> std::size_t { return static_cast<std::size_t>(capacity_ - begin_); }
+    [[nodiscard]] auto empty() const -> bool { return begin_ == end_; }
+    // Bytes held outside the object's cell
+    [[nodiscard]] auto heap_bytes() const -> std::size_t { return inline_ ? 0 : capacity() * sizeof(T); }
+
+    [[nodiscard]] auto data() -> T* { return begin_; }
+    [[nodiscard]] auto data() const -> const T* { return begin_; }
+    [[nodiscard]] auto begin() -> T* { return begin_; }
+    [[nodiscard]] auto begin() const -> const T* { return begin_; }
+    [[nodiscard]] auto end() -> T* { return end_; }
+    [[nodiscard]] auto end() const -> const T* { return end_; }
+    [[nodiscard]] auto operator[](std::size_t index) -> T& { return begin_[index]; }
+    [[nodiscard]] auto operator[](std::size_t index) const -> const T& { return begin_[index]; }
+    [[nodiscard]] auto front() const -> const T& { return *begin_; }
+    [[nodiscard]] auto back() const -> const T& { return *(end_ - 1); }
+
+    void push_back(const T& value) {
+        if (end_ == capacity_) {
+            const T copy = value;  // `value` may live in the storage being replaced
+            reallocate(std::max<std::size_t>(capacity() * 2, 4));
+            *end_++ = copy;
+            return;
+        }
+        *end_++ = value;
+    }
+
+    void pop_back() { --end_; }
+
+    void resize(std::size_t count, const T& fill = T{}) {
+        if (count > capacity()) {
+            reallocate(count);
+        }
+        std::fill(end_, begin_ + count, fill);
+        end_ = begin_ + count;
+    }
+
+    void reserve(std::size_t count) {
+        if (count > capacity()) {
+            reallocate(count);
+        }
+    }
+
+    void clear() { end_ = begin_; }
+
+    // Gives back unused malloc'd capacity, or all storage of an empty buffer
+    void shrink_to_fit() {
+        if (empty()) {
+            release();
+            begin_ = end_ = capacity_ = nullptr;
+            inline_ = false;
+        } else if (!inline_ && end_ != capacity_) {
+            reallocate(size());
+        }
+    }
+
+private:
+    void reallocate(std::size_t count) {
+        const std::size_t length = size();
+        T* storage = nullptr;
+        if (inline_ || begin_ == nullptr) {
+            storage = static_cast<T*>(std::malloc(count * sizeof(T)));
+            if (storage != nullptr && length != 0) {
+                std::memcpy(storage, begin_, length * sizeof(T));
+            }
+        } else {
+            storage = static_cast<T*>(std::realloc(begin_, count * sizeof(T)));
+        }
+        if (storage == nullptr) {
+            throw std::bad_alloc();
+        }
+        begin_ = storage;
+        end_ = storage + length;
+        capacity_ = storage + count;
+        inline_ = false;
+    }
+
+    void release() {
+        if (!inline_) {
+            std::free(begin_);
+        }
+    }
+
+    T* begin_ = nullptr;
+    T* end_ = nullptr;
+    T* capacity_ = nullptr;
+    bool inline_ = false;
+};
+
+}  // namespace impulse::runtime
@@ -1,12 +1,64 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "impulse/runtime/value.h"
 
 namespace impulse::runtime {
 
+// When the heap collects. A full collection starts once the heap reaches `growth` times what the
+// previous one left alive, but never below `min_threshold` and, when `limit` is set, never above
+// it (unless the live data alone is that large). With a `max_pause` budget the nursery shrinks
+// while minor collections overrun it and grows back, up to GcHeap::nursery_bytes(), once they
+// take well under it. A nonzero `mark_budget` makes full collections incremental: each step
+// traces at most that many objects and sweeps at most that many old ones.
+struct GcPacing {
+    double growth = 2.0;
+    std::size_t min_threshold = std::size_t{1024} * std::size_t{1024};
+    std::size_t limit = 0;
+    std::chrono::nanoseconds max_pause{0};
+    std::size_t mark_budget = 0;
+};
+
+// What a heap's collector has done since the heap was created (see GcHeap::stats)
+struct GcStats {
+    std::uint64_t full_collections = 0;  // one-pause collections and finished incremental cycles
+    std::uint64_t minor_collections = 0;
+    std::uint64_t pauses = 0;            // every collection and incremental step
+    std::chrono::nanoseconds total_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::uint64_t objects_freed = 0;
+    std::uint64_t bytes_freed = 0;
+    std::uint64_t bytes_promoted = 0;  // young objects that survived into the old generation
+    std::uint64_t live_bytes = 0;      // allocated when the last pause ended
+    std::uint64_t peak_bytes = 0;      // most allocated when a pause started
+};
+
+// Generational mark-sweep heap. Objects are bump-allocated into the cells of size-class pages
+// (see GcPage), with room for their initial elements after the header; larger ones get a page of
+// their own. Each class reuses freed cells first. Marks are kept in the pages' bitmaps. Objects
+// start young, on an intrusive list; promoted objects move to the old generation's object table.
+// Minor collections trace only young objects, from the roots plus the remembered set of old
+// objects that were given young references, and promote survivors in place; objects never move,
+// so raw GcObject pointers held by compiled code stay valid.
+// Full collections trace and sweep everything, either in one pause or incrementally: marking
+// is tri-color with the mark stack as the gray set, spread over mark_step calls, and objects
+// allocated meanwhile start marked. Storing an unmarked object into a marked one grays it (the
+// write barrier below), and finish_marking rescans the roots before the young generation is
+// swept. Old objects are then swept lazily, a few per allocation and a budget per sweep_step.
+// Minor collections wait while a cycle is marking. With several collector threads, one-pause
+// full collections of a large heap mark with work stealing and sweep the old object table in
+// ranges, one per thread. Sizes count allocated capacity; objects that grow after allocation
+// are reported through record_resize.
 class GcHeap {
 public:
     GcHeap();
@@ -18,27 +70,162 @@ public:
     auto operator=(GcHeap&&) -> GcHeap& = delete;
 
     [[nodiscard]] auto allocate_array(std::size_t length, const Value& fill = Value::make_nil()) -> GcObject*;
+    // Unboxed numeric array whose elements all start as nil (kFloat64Hole)
+    [[nodiscard]] auto allocate_float64_array(std::size_t length) -> GcObject*;
+    // Struct instance with `numeric` unboxed fields (0) followed by `boxed` ones (nil), all inline
+    [[nodiscard]] auto allocate_struct(std::uint32_t shape, std::size_t numeric, std::size_t boxed) -> GcObject*;
+    [[nodiscard]] auto allocate_string(std::string text) -> GcObject*;
+    // The one string holding `text` in this heap. Interned strings are never collected; they are
+    // meant for literals, whose number is bounded by the program.
+    [[nodiscard]] auto intern_string(std::string_view text) -> GcObject*;
+    // `left` followed by `right`: a rope sharing both, unless the result is short enough to copy
+    [[nodiscard]] auto concat_strings(GcObject* left, GcObject* right) -> GcObject*;
+    // `count` characters of `text` from `start` (in bounds): a view of the flat string underneath,
+    // unless the slice fits the small-string buffer
+    [[nodiscard]] auto slice_string(GcObject* text, std::size_t start, std::size_t count) -> GcObject*;
 
+    // Full collection
     void collect(const std::vector<Value*>& roots);
+    // Young-generation collection; every surviving young object is promoted. Does nothing while
+    // an incremental cycle is marking.
+    void collect_minor(const std::vector<Value*>& roots);
+
+    // Incremental full collection: start_marking grays the roots, mark_step traces up to the
+    // budget and returns true once nothing is gray, and finish_marking rescans the roots, sweeps
+    // the young generation and leaves the old one to sweep_step and allocation. collect finishes
+    // a cycle in progress.
+    void start_marking(const std::vector<Value*>& roots);
+    [[nodiscard]] auto mark_step() -> bool;
+    void finish_marking(const std::vector<Value*>& roots);
+    void sweep_step();
+    [[nodiscard]] auto incremental() const -> bool { return pacing_.mark_budget != 0; }
+    [[nodiscard]] auto marking() const -> bool { return marking_; }
+    [[nodiscard]] auto sweeping() const -> bool { return unswept_next_ < unswept_.size(); }
+
+    // Write barrier: call after storing `value` into `object`
+    void record_write(GcObject* object, const Value& value) {
+        if (object->needs_barrier(value)) {
+            write_barrier(object, value);
+        }
+    }
+    // Slow path of record_write: remembers old objects given young references and, while
+    // marking, grays what a marked object was given
+    void write_barrier(GcObject* object, const Value& value);
+
+    // Call after `object`'s footprint may have changed (elements pushed, representation switched)
+    void record_resize(GcObject* object) {
+        if (object->footprint() != object->accounted_bytes) {
+            account(object);
+        }
+    }
+
+    // Threads a full collection may use, the calling one included; 1 by default
+    void set_collector_threads(std::size_t threads) { collector_threads_ = std::max<std::size_t>(threads, 1); }
+    [[nodiscard]] auto collector_threads() const -> std::size_t { return collector_threads_; }
 
     void set_next_gc_threshold(std::size_t bytes);
+    void set_pacing(const GcPacing& pacing);
+    [[nodiscard]] auto pacing() const -> const GcPacing& { return pacing_; }
 
     [[nodiscard]] auto bytes_allocated() const -> std::size_t;
+    [[nodiscard]] auto young_bytes() const -> std::size_t { return young_bytes_; }
     [[nodiscard]] auto live_object_count() const -> std::size_t;
     [[nodiscard]] auto next_gc_threshold() const -> std::size_t;
     [[nodiscard]] auto should_collect() const -> bool { return bytes_allocated_ >= next_gc_threshold_; }
+    [[nodiscard]] auto should_collect_minor() const -> bool {
+        return !marking_ && young_bytes_ >= nursery_limit_;
+    }
     [[nodiscard]] static constexpr auto default_threshold() -> std::size_t {
         return std::size_t{1024} * std::size_t{1024};
     }
+    // Largest nursery; the pause budget may keep it smaller
+    [[nodiscard]] static constexpr auto nursery_bytes() -> std::size_t { return std::size_t{256} * std::size_t{1024}; }
+    [[nodiscard]] auto nursery_limit() const -> std::size_t { return nursery_limit_; }
+    [[nodiscard]] auto last_pause() const -> std::chrono::nanoseconds { return last_pause_; }
+    // Unlike the rest of the heap, safe to read from any thread (counters are relaxed atomics
+    // written by the owning thread only)
+    [[nodiscard]] auto stats() const -> GcStats;
 
 private:
-    void mark_value(const Value& value);
-    void mark_object(GcObject* object);
-    void sweep();
+    // Inline element bytes of each size class; longer arrays are large objects
+    static constexpr std::size_t kSizeClasses[] = {0, 32, 64, 128, 256, 512, 1024};
+    static constexpr std::size_t kClassCount = sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+    static constexpr std::uint8_t kLargeClass = 0xFF;
+    // Shorter concatenations are copied: a rope node costs more than the bytes
+    static constexpr std::size_t kMinRopeBytes = 256;
+    static constexpr std::size_t kMinNurseryBytes = std::size_t{16} * std::size_t{1024};
+    static constexpr std::size_t kSweepPerAllocation = 8;
+    // Smaller heaps are collected on one thread: starting the others would cost more
+    static constexpr std::size_t kParallelMinBytes = std::size_t{1024} * std::size_t{1024};
 
-    GcObject* objects_ = nullptr;
+    struct FreeCell {
+        FreeCell* next = nullptr;
+    };
+    struct SizeClass {
+        FreeCell* free = nullptr;
+        GcPage* page = nullptr;  // newest page, handing out cells from `used` on
+        std::size_t used = 0;
+    };
+    struct PageDeleter {
+        void operator()(GcPage* page) const;
+    };
+
+    // An object with room for `payload_bytes` of elements in its cell
+    [[nodiscard]] auto new_object(ObjectKind kind, std::size_t payload_bytes) -> GcObject*;
+    [[nodiscard]] static auto allocate_page(std::size_t cell_bytes, std::size_t cell_count) -> GcPage*;
+    void free_object(GcObject* object);
+    // Returns the cell of a destroyed object to its class, or frees a large object's page
+    void release_cell(GcObject* object);
+    static void set_marked(GcObject* object, bool marked) { GcPage::of(object)->set_marked(object->cell, marked); }
+    void link(GcObject* object);
+    void account(GcObject* object);
+    // Threshold for the next full collection once `live` bytes survived one
+    [[nodiscard]] auto paced_threshold(std::size_t live) const -> std::size_t;
+    void adapt_nursery(std::chrono::nanoseconds pause);
+    // Ends a pause that started at `start` with `bytes` allocated
+    void end_pause(std::chrono::steady_clock::time_point start, std::size_t bytes);
+    void mark_roots(const std::vector<Value*>& roots, bool young_only);
+    void mark_object(GcObject* object, bool young_only);
+    void drain_mark_stack(bool young_only);
+    void parallel_mark(const std::vector<Value*>& roots);
+    void sweep_lazily(std::size_t budget);
+    [[nodiscard]] auto sweep_young() -> std::size_t;
+    [[nodiscard]] auto sweep_old() -> std::size_t;
+    void clear_remembered();
+
+    std::vector<std::unique_ptr<GcPage, PageDeleter>> pages_;  // size-class pages
+    SizeClass classes_[kClassCount];
+    GcObject* young_ = nullptr;
+    std::vector<GcObject*> old_;
+    std::vector<GcObject*> unswept_;  // old objects of the current cycle, swept up to unswept_next_
+    std::size_t unswept_next_ = 0;
+    bool marking_ = false;
+    std::vector<GcObject*> remembered_;
+    // Interned strings, keyed by their own text; they stay marked and on no generation's list
+    std::unordered_map<std::string_view, GcObject*> interned_;
+    std::size_t interned_bytes_ = 0;
+    std::vector<GcObject*> mark_stack_;
     std::size_t bytes_allocated_ = 0;
+    std::size_t young_bytes_ = 0;
     std::size_t next_gc_threshold_ = default_threshold();
+    std::size_t nursery_limit_ = nursery_bytes();
+    GcPacing pacing_;
+    std::chrono::nanoseconds last_pause_{0};
+    std::size_t collector_threads_ = 1;
+
+    struct Counters {
+        std::atomic<std::uint64_t> full_collections{0};
+        std::atomic<std::uint64_t> minor_collections{0};
+        std::atomic<std::uint64_t> pauses{0};
+        std::atomic<std::int64_t> total_pause_ns{0};
+        std::atomic<std::int64_t> max_pause_ns{0};
+        std::atomic<std::uint64_t> objects_freed{0};
+        std::atomic<std::uint64_t> bytes_freed{0};
+        std::atomic<std::uint64_t> bytes_promoted{0};
+        std::atomic<std::uint64_t> live_bytes{0};
+        std::atomic<std::uint64_t> peak_bytes{0};
+    };
+    Counters counters_;
 };
 
 }  // namespace impulse::runtime
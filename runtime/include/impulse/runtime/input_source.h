@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace impulse::runtime {
+
+class MappedFile;
+
+// Program input (read_line, read_lines, read_all) handed out as views instead of fresh strings.
+// A regular file is memory-mapped and its lines are views of the mapping; other input is read a
+// large chunk at a time and a line is a view of the chunk, or of a carry buffer when it spans two
+// chunks. Lines exclude their '\n'. A view stays valid until the next call.
+class InputSource {
+public:
+    static constexpr std::size_t kDefaultChunkBytes = std::size_t{1024} * std::size_t{1024};
+
+    // nullptr when the file cannot be opened
+    [[nodiscard]] static auto open_file(const std::string& path) -> std::unique_ptr<InputSource>;
+    explicit InputSource(std::istream& stream, std::size_t chunk_bytes = kDefaultChunkBytes);
+    // Reads the descriptor as data arrives, so an interactive stdin does not wait for a full chunk
+    explicit InputSource(int fd, std::size_t chunk_bytes = kDefaultChunkBytes);
+    explicit InputSource(std::string text);
+    ~InputSource();
+
+    InputSource(const InputSource&) = delete;
+    auto operator=(const InputSource&) -> InputSource& = delete;
+
+    // The next line; nullopt once the input is used up
+    [[nodiscard]] auto next_line() -> std::optional<std::string_view>;
+    // Everything not read yet
+    [[nodiscard]] auto read_all() -> std::string_view;
+
+private:
+    InputSource() = default;
+    // Replaces the window with the stream's next chunk; false at the end of the stream
+    auto refill() -> bool;
+
+    std::unique_ptr<MappedFile> file_;
+    std::unique_ptr<std::istream> owned_stream_;
+    std::istream* stream_ = nullptr;
+    int fd_ = -1;
+    std::string text_;         // owned input of the text constructor
+    std::vector<char> chunk_;  // stream input
+    std::string carry_;        // a line that spans chunks, or read_all's result
+    std::string_view window_;  // input in memory not read yet
+};
+
+}  // namespace impulse::runtime
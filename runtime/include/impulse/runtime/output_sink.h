@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace impulse::runtime {
+
+// Destination for program output (print / println) that streams instead of accumulating: writes
+// collect in a bounded buffer that is flushed to a file descriptor or a callback once full, when
+// a run ends and on destruction. A write that would not fit is delivered together with the
+// buffer, with writev on a descriptor, without being copied. Runs on several threads may share
+// one sink; writes are serialised, and the callback is invoked with the sink locked.
+class OutputSink {
+public:
+    using Callback = std::function<void(std::string_view)>;
+    static constexpr std::size_t kDefaultBufferBytes = std::size_t{64} * std::size_t{1024};
+
+    explicit OutputSink(int fd, std::size_t buffer_bytes = kDefaultBufferBytes);
+    explicit OutputSink(Callback callback, std::size_t buffer_bytes = kDefaultBufferBytes);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    auto operator=(const OutputSink&) -> OutputSink& = delete;
+
+    // Writes `text` followed by `suffix`
+    void write(std::string_view text, std::string_view suffix = {});
+    void flush();
+
+    // Bytes written so far, buffered ones included
+    [[nodiscard]] auto bytes_written() const -> std::size_t;
+    // True when nothing was written or the last byte was a newline
+    [[nodiscard]] auto at_line_start() const -> bool;
+    // False once writing to the descriptor failed; later output is dropped
+    [[nodiscard]] auto ok() const -> bool;
+
+private:
+    // Delivers the buffer followed by `text`, then empties the buffer
+    void deliver(std::string_view text, std::string_view suffix);
+
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    Callback callback_;
+    std::size_t capacity_ = kDefaultBufferBytes;
+    std::string buffer_;
+    std::size_t written_ = 0;
+    char last_ = '\n';
+    bool failed_ = false;
+};
+
+}  // namespace impulse::runtime
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace impulse::runtime {
+
+// One profiled function (see Vm::get_profile_report)
+struct FunctionProfileSummary {
+    std::string function;  // "module::function"
+    std::uint64_t calls = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds min{0};
+    std::chrono::nanoseconds max{0};
+    std::string tier;                          // "jit", "speculative", "osr" or "interpreter"
+    std::chrono::nanoseconds compile_time{0};  // spent compiling its code, OSR loops included
+};
+
+// A span of one thread's time: a call, a garbage collector pause or a compilation
+struct ProfileEvent {
+    enum class Kind : std::uint8_t {
+        Call,
+        Gc,
+        Compile,
+    };
+
+    Kind kind = Kind::Call;
+    std::string name;          // the function, or the collector's step ("gc minor", ...)
+    std::uint32_t thread = 0;  // dense, in the order threads first recorded something
+    std::chrono::nanoseconds start{0};  // since profiling was enabled or last reset
+    std::chrono::nanoseconds duration{0};
+};
+
+struct ProfileReport {
+    std::vector<FunctionProfileSummary> functions;  // most total time first
+    std::vector<ProfileEvent> events;               // in the order they ended
+    std::uint64_t dropped_events = 0;               // past the timeline's capacity
+};
+
+enum class ProfileFormat : std::uint8_t {
+    Json,         // per-function statistics and GC totals
+    ChromeTrace,  // trace-event timeline, for chrome://tracing and Perfetto
+    Pprof,        // uncompressed profile.proto of call stacks rebuilt from the timeline
+};
+
+// "json", "chrome" or "pprof"
+[[nodiscard]] auto parse_profile_format(std::string_view name) -> std::optional<ProfileFormat>;
+void write_profile(const ProfileReport& report, ProfileFormat format, std::ostream& out);
+
+void write_profile_json(const ProfileReport& report, std::ostream& out);
+void write_chrome_trace(const ProfileReport& report, std::ostream& out);
+// Each call's self time, by the stack of calls it ran under on its thread. Collector pauses and
+// compilations show up as frames of their own under the call that triggered them.
+void write_pprof(const ProfileReport& report, std::ostream& out);
+
+}  // namespace impulse::runtime
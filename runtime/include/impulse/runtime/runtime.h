@@ -1,17 +1,35 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "impulse/ir/ir.h"
+#include "impulse/ir/optimizer.h"
 #include "impulse/jit/jit.h"
+#include "impulse/jit/symbols.h"
+#include "impulse/runtime/bytecode.h"
+#include "impulse/runtime/code_cache.h"
+#include "impulse/runtime/frame_layout.h"
 #include "impulse/runtime/gc_heap.h"
+#include "impulse/runtime/input_source.h"
+#include "impulse/runtime/output_sink.h"
+#include "impulse/runtime/profile_export.h"
+#include "impulse/runtime/struct_layout.h"
+#include "impulse/runtime/task_pool.h"
 #include "impulse/runtime/value.h"
 
 namespace impulse::runtime {
@@ -33,22 +51,199 @@ struct VmResult {
 struct VmLoadResult {
     bool success = true;
     std::vector<std::string> diagnostics;
+    // On a reload, the functions whose SSA and compiled code were kept (see Vm::load)
+    std::size_t functions_kept = 0;
+    // Functions whose machine code was bound from the precompiled object (see
+    // Vm::set_precompiled_code)
+    std::size_t functions_precompiled = 0;
 };
 
+// Where a function currently runs
+enum class ExecutionTier : std::uint8_t {
+    Interpreter,
+    Jit,
+};
+
+// Tiered execution: functions start in the SSA interpreter and are promoted to the JIT once
+// they have been called `calls` times or have taken `back_edges` loop back-edges in total.
+// A threshold of 1 call compiles on first use. Reaching `back_edges` inside a running call also
+// moves a compilable loop to native code on the spot (on-stack replacement).
+//
+// Functions the JIT cannot compile whole (a print, a string operation or a global read somewhere)
+// run their compilable part speculatively instead: each call starts in compiled code, which hands
+// the frame to the interpreter at the first instruction it does not compile. Inline checks that
+// fail in compiled loops and speculative code deoptimise the same way, letting the interpreter
+// redo the instruction. A function whose checks have failed `deopts` times runs interpreted only.
+struct TierThresholds {
+    std::uint64_t calls = 2;
+    std::uint64_t back_edges = 1000;
+    std::uint64_t deopts = 64;
+    std::uint64_t memoize = 100;  // calls before a pure function's results are kept (Vm::set_memoization)
+};
+
+struct TierCounters {
+    std::uint64_t calls = 0;
+    std::uint64_t back_edges = 0;
+    std::uint64_t osr_entries = 0;          // transfers from the interpreter into compiled loop code
+    std::uint64_t speculative_entries = 0;  // calls started in speculative code
+    std::uint64_t deopts = 0;               // failed inline checks handed back to the interpreter
+};
+
+// A snapshot of the runtime's counters, since the Vm was created (see Vm::metrics)
+struct VmMetrics {
+    GcStats gc;  // summed over every thread's heap; live and peak bytes too
+    std::uint64_t gc_threads = 0;  // heaps, one per thread that ran code
+
+    std::uint64_t jit_compilations = 0;         // functions, speculative entries and OSR loops compiled
+    std::uint64_t jit_rejections = 0;           // functions and loops the JIT turned down
+    std::uint64_t code_cache_hits = 0;          // functions linked from the code cache instead
+    std::chrono::nanoseconds jit_compile_time{0};
+    std::uint64_t code_bytes = 0;               // machine code installed in the modules' code arenas
+    std::uint64_t code_bytes_reserved = 0;      // executable memory mapped for it
+    std::uint64_t calls = 0;                    // entered through the VM (not compiled-to-compiled)
+    std::uint64_t osr_entries = 0;
+    std::uint64_t speculative_entries = 0;
+    std::uint64_t deopts = 0;
+
+    std::uint64_t interpreted_calls = 0;
+    std::uint64_t interpreter_instructions = 0;  // bytecode, see SsaInterpreter::instructions_executed
+    std::uint64_t ssa_cache_lookups = 0;         // calls that needed their function's SSA
+    std::uint64_t ssa_cache_misses = 0;          // ... and had to build it (or decode it from the code cache)
+    std::uint64_t memo_hits = 0;                 // calls answered from a pure function's memo table
+    std::uint64_t parallel_elements = 0;         // parallel_for / array_map_parallel callee calls on the task pool
+};
+
+// One collector pause, as reported to Vm::set_gc_callback
+struct GcEvent {
+    enum class Kind : std::uint8_t {
+        Minor,
+        Full,
+        Mark,   // a step of an incremental cycle's marking (its first and last included)
+        Sweep,  // a step of an incremental cycle's sweeping
+    };
+
+    Kind kind = Kind::Minor;
+    std::chrono::nanoseconds pause{0};
+    std::uint64_t bytes_freed = 0;
+    std::uint64_t heap_bytes = 0;  // allocated once the pause ended
+};
+
+// One SSA block of a function, as counted by block profiling (see Vm::set_block_profiling_enabled)
+struct BlockProfile {
+    std::string function;  // "module::function"
+    std::size_t block = 0;
+    std::string label;
+    std::uint64_t entries = 0;       // times calls entered the block
+    std::uint64_t instructions = 0;  // instructions those entries ran: entries times the block's length
+    std::vector<std::string> code;   // the block's instructions, as --dump-ssa prints them
+};
+
+// Dense handle of a loaded function, assigned by Vm::load. A reloaded module's functions get
+// fresh ids, so an id never refers to code from before the reload.
+using FunctionId = std::uint32_t;
+
 class FrameGuard;
+class SsaInterpreter;
+class TraceWriter;
 
+// run() may be called from several threads at once. Loaded modules, their SSA and compiled code
+// are shared; each thread runs on its own frames, heap and output buffer. load() and the set_*
+// calls must not overlap with running code, and trace and input streams and the output sink are
+// shared as given.
 class Vm {
 public:
+    Vm() = default;
+    ~Vm();
+
+    Vm(const Vm&) = delete;
+    auto operator=(const Vm&) -> Vm& = delete;
+
+    // Loads `module`, replacing a loaded module of the same name. A reload that keeps the
+    // function list, the bindings and the structs as they were only drops the SSA, compiled code
+    // and counters of functions whose own code, or that of a module function they call, changed.
+    // Any other reload starts the whole module over with new function ids.
     auto load(ir::Module module) -> VmLoadResult;
 
     [[nodiscard]] auto run(const std::string& module_name, const std::string& entry) const -> VmResult;
 
     void set_trace_stream(std::ostream* stream) const;
+    // Traces the same events as the trace stream, in binary records (see TraceWriter); either
+    // or both may be set. Call the writer's flush() once the run is over.
+    void set_trace_writer(TraceWriter* writer) const;
     void set_input_stream(std::istream* stream) const;
     void set_read_line_provider(std::function<std::optional<std::string>()> provider) const;
+    // Program input (read_line, read_lines, read_all) comes from `source` without a copy per
+    // line. Takes precedence over the input stream; a read-line provider takes precedence over
+    // both. Like the stream, the source is not synchronised: runs that read input must not
+    // overlap.
+    void set_input_source(InputSource* source) const;
+    // Program output goes to `sink` as it is produced, and run() flushes it before returning.
+    // Without a sink (the default, or after setting nullptr) output is collected and returned in
+    // VmResult::message.
+    void set_output_sink(OutputSink* sink) const;
     void set_jit_enabled(bool enabled) const;
+    // With background compilation on, a function that gets hot is queued to a compiler thread and
+    // keeps running interpreted until its native code is published, so no call waits for codegen.
+    // Off by default: tier-up then happens synchronously on the call that crosses the threshold.
+    void set_background_compilation(bool enabled) const;
+    // Blocks until every queued compilation has been published
+    void wait_for_background_compilation() const;
+    // With `threads` > 0, load() builds, optimises and (with the JIT on) compiles every function
+    // of the module on that many threads before it returns, so the first run finds native code.
+    // Functions are scheduled callees first, so inlining sees the same SSA as lazy loading does.
+    // 0, the default, keeps everything lazy.
+    void set_eager_loading(std::size_t threads) const;
+    // SSA passes run on each function before it executes; set before load() so the code cache
+    // key covers them
+    void set_optimization_options(const ir::OptimizationOptions& options);
+    // Memoisation: once a pure function (ir::find_pure_functions) has had TierThresholds::memoize
+    // calls, its results are kept by numeric arguments and later calls with the same arguments
+    // return them without running it. Compiled callers then reach those functions through the
+    // VM instead of calling them directly. Off by default.
+    void set_memoization(bool enabled) const;
 
+    // Collects the calling thread's heap
     void collect_garbage() const;
+    // Collection policy for every thread's heap (see GcPacing); set while no run is in progress
+    void set_gc_pacing(const GcPacing& pacing) const;
+    [[nodiscard]] auto gc_pacing() const -> GcPacing;
+    // Threads each heap's full collections may use (see GcHeap::set_collector_threads)
+    void set_gc_threads(std::size_t threads) const;
+    // Threads parallel_for and array_map_parallel run on, the calling one included (default: one
+    // per hardware thread). They spread calls of a pure function (ir::find_pure_functions) with
+    // compiled code over a TaskPool; other callees, and every callee while tracing or profiling,
+    // run one call at a time on the calling thread. Set while no run is in progress.
+    void set_parallel_threads(std::size_t threads) const;
+
+    // Persistent code cache: when a directory is set, load() maps the module's cache file (keyed
+    // by code_cache_key) and functions reuse its SSA and machine code instead of rebuilding them.
+    // save_code_cache() writes back every loaded module that compiled something new; it returns
+    // false if a file could not be written.
+    void set_code_cache_directory(std::string directory);
+    [[nodiscard]] auto save_code_cache() const -> bool;
+
+    // Ahead-of-time code. write_precompiled_code() saves the machine code of every function of the
+    // module compiled so far as a relocatable ELF object (see jit::write_object_file) and returns
+    // how many functions it holds; nullopt when the module is not loaded with JIT linkage or the
+    // file cannot be written. Given such an object, load() of the module it was compiled for
+    // (same code_cache_key) binds its functions' code, so they run natively from their first
+    // call without compiling anything; an object for anything else is ignored.
+    void set_precompiled_code(std::string path);
+    [[nodiscard]] auto write_precompiled_code(const std::string& module_name, const std::string& path) const
+        -> std::optional<std::size_t>;
+
+    // Names compiled code for perf (perf map, jitdump) and GDB as it is installed, so profiles
+    // and backtraces show "module::function" instead of anonymous addresses (see
+    // jit::JitSymbols). Code installed before the call is not named.
+    void set_jit_symbols(jit::JitSymbolOptions options);
+
+    // Cheap to take from any thread while code runs (not during load()): every counter is a
+    // relaxed atomic
+    [[nodiscard]] auto metrics() const -> VmMetrics;
+    // Called on the collecting thread after each collector pause, before the program resumes.
+    // Set it before running code; it must not run code on this Vm.
+    using GcCallback = std::function<void(const GcEvent&)>;
+    void set_gc_callback(GcCallback callback);
 
     // JIT cache inspection API (for testing)
     // Check if a function is cached
@@ -58,30 +253,88 @@ public:
     // Get cache entry count (for testing)
     [[nodiscard]] auto get_jit_cache_size() const -> size_t;
 
+    // Tiered execution
+    void set_tier_thresholds(TierThresholds thresholds) const;
+    [[nodiscard]] auto tier_thresholds() const -> TierThresholds;
+    [[nodiscard]] auto function_tier(const std::string& module_name, const std::string& function_name) const -> ExecutionTier;
+    [[nodiscard]] auto function_tier_counters(const std::string& module_name, const std::string& function_name) const -> TierCounters;
+    // The function's id, or nullopt when no loaded module has it
+    [[nodiscard]] auto function_id(const std::string& module_name, const std::string& function_name) const
+        -> std::optional<FunctionId>;
+
     // Profiling API
     void set_profiling_enabled(bool enabled) const;
     void reset_profiling() const;
     void dump_profiling_results(std::ostream& out) const;
     [[nodiscard]] auto get_profiling_results() const -> std::string;
+    // Block profiling counts each entry into each SSA block, at one relaxed increment per entry.
+    // Like tracing, it keeps calls interpreted, so the counts cover every call and no timing is
+    // involved. reset_profiling() clears the counts.
+    void set_block_profiling_enabled(bool enabled) const;
+    // Every block entered since the counts were last cleared, most instructions run first
+    [[nodiscard]] auto get_block_profile() const -> std::vector<BlockProfile>;
+    // Function profiling as data, for write_profile(): the statistics dump_profiling_results()
+    // prints, plus a timeline of calls, collector pauses and compilations. The timeline keeps
+    // the first kMaxProfileEvents spans since the last reset and counts the rest as dropped.
+    [[nodiscard]] auto get_profile_report() const -> ProfileReport;
+    static constexpr std::size_t kMaxProfileEvents = std::size_t{1} << 20;
 
 private:
     friend class FrameGuard;
 
+    struct JitLink;
+
+    // What one thread needs to run code. Objects never leave the thread that allocated them
+    // (globals only hold numbers), so each thread collects its own heap. Created on the thread's
+    // first run() and kept until the Vm is destroyed.
+    struct ExecutionContext {
+        GcHeap heap;
+        // Frames of the active calls are frame_pool[0, frame_depth); deeper ones wait for reuse
+        std::vector<std::unique_ptr<InterpreterFrame>> frame_pool;
+        std::size_t frame_depth = 0;
+        std::vector<Value*> root_buffer;
+        std::string output;
+        std::string input;  // last line or read_all result copied from a provider or stream
+        std::optional<VmResult> pending;  // failure being unwound through compiled frames
+        // For metrics(); written by this thread only
+        std::atomic<std::uint64_t> interpreted_calls{0};
+        std::atomic<std::uint64_t> interpreter_instructions{0};
+        std::atomic<std::uint64_t> ssa_lookups{0};
+        std::atomic<std::uint64_t> memo_hits{0};
+        std::atomic<std::uint64_t> parallel_elements{0};
+
+        // The pooled frame for the next call down; release_frame() hands it back
+        [[nodiscard]] auto acquire_frame() -> InterpreterFrame&;
+        void release_frame();
+    };
+
     struct LoadedModule {
         std::string name;
         ir::Module module;
         std::unordered_map<std::string, Value> globals;
+        std::vector<StructLayout> structs;  // module.structs, laid out when it was loaded
+        FunctionId first_function = 0;  // module.functions[i] has id first_function + i
+        std::vector<std::uint64_t> function_hashes;  // function_hashes(module)
+        std::vector<bool> pure;         // ir::find_pure_functions(module)
+        JitLink* link = nullptr;        // its call table, owned by jit_links_
     };
 
-    struct ExecutionFrame {
-        std::unordered_map<std::string, Value>* locals = nullptr;
-        std::vector<Value>* stack = nullptr;
+    // Compiled code entered with an interpreter frame to hand back to: a loop entered mid-call, or
+    // a speculative entry for a whole function. `function` is null when it cannot be compiled.
+    struct OsrCacheEntry {
+        std::size_t block = 0;  // loop header (the entry block for speculation)
+        std::atomic<jit::JitFunction> function{nullptr};
+        jit::CodeBuffer code_buffer;
+        jit::OsrPlan plan;
+        std::unordered_set<std::uint64_t> arrays;  // encoded SSA values carried as array pointers
     };
 
     struct JitCacheEntry {
         jit::JitFunction function = nullptr;
-        jit::CodeBuffer code_buffer;  // Keep executable memory alive
+        jit::CodeBuffer code_buffer;  // Keep executable memory alive (empty when the code is in the module's arena)
         bool can_jit = false;
+        // Without `can_jit`: the function's compilable part, run from the start of each call
+        std::unique_ptr<OsrCacheEntry> speculative;
         
         JitCacheEntry() = default;
         JitCacheEntry(JitCacheEntry&&) = default;
@@ -90,33 +343,21 @@ private:
         auto operator=(const JitCacheEntry&) -> JitCacheEntry& = delete;
     };
 
-    [[nodiscard]] auto execute_function(const LoadedModule& module, const ir::Function& function,
-                                        const std::unordered_map<std::string, Value>& parameters,
-                                        std::string* output_buffer) const -> VmResult;
-
-    [[nodiscard]] static auto normalize_module_name(const ir::Module& module) -> std::string;
+    // Per-module call linkage for compiled code; `table.owner` points back at the link
+    struct JitLink {
+        const Vm* vm = nullptr;
+        std::string module_name;
+        jit::JitCodeArena code;                // the module's compiled code, freed with the link
+        jit::JitCallTable table;
+    };
 
-    void push_frame(std::unordered_map<std::string, Value>& locals, std::vector<Value>& stack) const;
-    void pop_frame() const;
-    void gather_roots(std::vector<Value*>& out) const;
-    void maybe_collect() const;
+    struct CachedSsa {
+        ir::SsaFunction ssa;
+        SsaFrameLayout layout;
+        SsaBytecode bytecode;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> block_entries;  // per block, for block profiling
+    };
 
-    std::vector<LoadedModule> modules_;
-    mutable GcHeap heap_;
-    mutable std::vector<ExecutionFrame> frames_;
-    mutable std::vector<Value*> root_buffer_;
-    mutable std::ostream* trace_stream_ = nullptr;
-    mutable std::istream* input_stream_ = nullptr;
-    mutable std::function<std::optional<std::string>()> read_line_provider_;
-    mutable bool jit_enabled_ = true;
-    mutable std::string output_buffer_;
-    // JIT cache: maps (module_name, function_name) -> JitCacheEntry
-    mutable std::unordered_map<std::string, JitCacheEntry> jit_cache_;
-    // SSA cache: maps (module_name, function_name) -> SsaFunction
-    // This avoids rebuilding SSA on every function call (major performance bottleneck)
-    mutable std::unordered_map<std::string, ir::SsaFunction> ssa_cache_;
-    
-    // Profiling data
     struct FunctionProfile {
         std::string full_name;  // "module::function"
         uint64_t call_count = 0;
@@ -125,8 +366,206 @@ private:
         std::chrono::nanoseconds max_time{0};
         bool was_jit_compiled = false;
     };
+
+    // Counted by every thread running the function. Increments are relaxed loads and stores, so
+    // concurrent calls may lose a few; the counts only steer tiering.
+    struct SharedTierCounters {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> back_edges{0};
+        std::atomic<std::uint64_t> osr_entries{0};
+        std::atomic<std::uint64_t> speculative_entries{0};
+        std::atomic<std::uint64_t> deopts{0};
+    };
+
+    // Everything the VM keeps about one function, indexed by its id. `ssa` is written once under
+    // state_mutex_ (or by the eager loader, which owns the record while load() runs), `jit` once
+    // by the thread that claimed `compile_claimed`; both may be read after their ready flag is seen
+    // set. `osr`, `profile` and `building` are only touched under the mutex, `memo` under its own.
+    struct FunctionRecord {
+        std::string key;                                                      // "module::function"
+        std::unique_ptr<CachedSsa> ssa;                                       // built on first use
+        std::atomic<bool> ssa_ready{false};
+        std::optional<JitCacheEntry> jit;                                     // set once the function got hot enough
+        std::atomic<bool> jit_ready{false};
+        std::atomic<bool> compile_claimed{false};                             // some thread compiles it
+        std::unordered_map<std::size_t, std::unique_ptr<OsrCacheEntry>> osr;  // by loop header block
+        SharedTierCounters counters;
+        FunctionProfile profile;                                              // call_count stays 0 until profiled
+        std::atomic<std::int64_t> compile_nanoseconds{0};                     // whole function, speculative and OSR code
+        bool building = false;                                                // SSA under construction: not inlinable
+        std::mutex memo_mutex;
+        std::unordered_map<std::string, double> memo;  // results by argument bits, see set_memoization
+    };
+    static constexpr std::size_t kMaxMemoEntries = std::size_t{1} << 16;  // per function; later results are not kept
+
+    // The function's SSA, built (or restored from the code cache) and optimised on first use.
+    // Small callees are inlined first, so their own SSA is built before the caller's.
+    [[nodiscard]] auto cached_ssa(const LoadedModule& module, FunctionId id) const -> const CachedSsa&;
+    // cached_ssa with state_mutex_ held
+    [[nodiscard]] auto cached_ssa_locked(const LoadedModule& module, FunctionId id) const -> const CachedSsa&;
+    // Sets the function's `jit` entry: restored from the code cache, compiled, or marked as not
+    // compilable. Only the thread that claimed `compile_claimed` calls it, without state_mutex_.
+    void compile_function(const LoadedModule& module, FunctionId id) const;
+    // Queues compile_function for the compiler thread, once per function
+    void request_compilation(const LoadedModule& module, FunctionId id) const;
+    void compiler_loop() const;
+    // Eager loading: builds and compiles every function of a just loaded module
+    void prepare_module(const LoadedModule& module) const;
+
+    // Calls function `id` of `module` with its arguments in parameter order. Tail calls the
+    // interpreter hands back run one after another in this loop, so chains of them (mutual
+    // recursion included) take constant stack.
+    [[nodiscard]] auto execute_function(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                                        const std::vector<Value>& arguments) const -> VmResult;
+    // One activation for execute_function. When it ends in a tail call, `tail` is set to the callee
+    // (an index into the module's functions), its arguments are copied into `tail_arguments` and
+    // the result is the caller's to ignore.
+    [[nodiscard]] auto execute_frame(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                                     const std::vector<Value>& arguments, std::optional<std::size_t>& tail,
+                                     std::vector<Value>& tail_arguments) const -> VmResult;
+
+    // OSR handler body: runs the loop headed by `block` natively from the interpreter's state.
+    // `last` caches the entry this activation used most recently.
+    [[nodiscard]] auto enter_osr(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                                 std::size_t block, SsaInterpreter& frame, OsrCacheEntry*& last) const
+        -> std::optional<VmResult>;
+    // Runs `entry` on the values in `frame`, counting the start in `entries`: the call's result,
+    // or nullopt after handing the call back to `frame` (resuming it where compiled code left) or
+    // declining to start
+    [[nodiscard]] auto run_osr_entry(ExecutionContext& context, FunctionRecord& record, OsrCacheEntry& entry,
+                                     SsaInterpreter& frame, std::atomic<std::uint64_t>& entries) const
+        -> std::optional<VmResult>;
+    // False once the function's compiled code has failed `deopts` guards: it then stays interpreted
+    [[nodiscard]] auto speculation_allowed(const FunctionRecord& record) const -> bool;
+    // Ends a collector pause of `context`'s heap, for the profiling timeline and the GC callback;
+    // `freed_before` is the heap's bytes_freed when it began
+    void end_gc_pause(ExecutionContext& context, GcEvent::Kind kind,
+                      std::chrono::high_resolution_clock::time_point start, std::uint64_t freed_before) const;
+    // Adds a span from `start` to `end` (now by default) to the profiling timeline
+    void record_profile_event(ProfileEvent::Kind kind, std::string name,
+                              std::chrono::high_resolution_clock::time_point start,
+                              std::chrono::high_resolution_clock::time_point end =
+                                  std::chrono::high_resolution_clock::now()) const;
+    // Names `size` bytes of code installed in `link` for the tools chosen by set_jit_symbols()
+    void publish_code(const JitLink* link, const std::string& name, jit::JitFunction code,
+                      std::size_t size) const;
+
+    // Persisted state of a module under the code cache directory
+    struct PersistedCode {
+        std::uint64_t key = 0;
+        std::string path;
+        PersistedModule contents;
+        std::atomic<bool> dirty{false};  // something was compiled that the file does not have yet
+    };
+
+    [[nodiscard]] auto find_module(const std::string& name) const -> const LoadedModule*;
+    [[nodiscard]] auto find_record(const std::string& module_name, const std::string& function_name) const
+        -> const FunctionRecord*;
+    // The module's persisted code, or null when no code cache directory is set
+    [[nodiscard]] auto persisted_code(const std::string& module_name) const -> PersistedCode*;
+    // Binds the precompiled object's code for `module`'s functions that have none yet; returns
+    // how many were bound
+    [[nodiscard]] auto bind_precompiled_code(const LoadedModule& module, std::uint64_t key) const -> std::size_t;
+    // True when compiled code may call compiled callees directly (no tracing or profiling to honour)
+    [[nodiscard]] auto direct_jit_calls_allowed() const -> bool;
+    // True when calls to the function go through execute_function for its memo table
+    [[nodiscard]] auto memoized(const LoadedModule& module, FunctionId id) const -> bool;
+    // True when every block a call enters must be seen (tracing, block profiling): calls stay interpreted
+    [[nodiscard]] auto blocks_observed() const -> bool;
+    // A trace stream or trace writer is set
+    [[nodiscard]] auto tracing() const -> bool { return trace_stream_ != nullptr || trace_writer_ != nullptr; }
+    void reset_jit_call_entries() const;
+    // parallel_for / array_map_parallel (see SsaInterpreter::ParallelMap) with callee `id`
+    [[nodiscard]] auto parallel_map(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                                    const std::string& builtin, const std::vector<double>& inputs,
+                                    std::vector<double>& outputs) const -> std::optional<VmResult>;
+    // JitTrampoline: runs a callee without a native entry through execute_function
+    static auto jit_call_trampoline(jit::JitCallTable* table, std::uint64_t slot, double* args) -> double;
+    // JitTrapHandler: turns a failed inline check into the interpreter's runtime error
+    static void jit_trap_handler(jit::JitCallTable* table, std::uint64_t trap);
+    // Entry points of the jit::JitNative functions, by id
+    [[nodiscard]] static auto jit_natives() -> std::array<jit::JitFunction, jit::kJitNativeCount>;
+    // What a native hands back to compiled code: the result's value, else `updated` (the array it
+    // updated); on failure the unwind value, with the failure pending in the context
+    [[nodiscard]] static auto jit_native_result(VmResult result, double updated) -> double;
+
+    [[nodiscard]] static auto normalize_module_name(const ir::Module& module) -> std::string;
+
+    // The calling thread's execution context
+    [[nodiscard]] auto thread_context() const -> ExecutionContext&;
+    void gather_roots(const ExecutionContext& context, std::vector<Value*>& out) const;
+    void collect(ExecutionContext& context) const;
+    void maybe_collect(ExecutionContext& context) const;
+
+    std::vector<LoadedModule> modules_;
+    std::uint32_t next_struct_shape_ = 1;  // shapes are never reused, so reloaded structs get new ones
+    mutable std::mutex contexts_mutex_;
+    mutable std::unordered_map<std::thread::id, std::unique_ptr<ExecutionContext>> contexts_;
+    mutable GcPacing gc_pacing_;  // guarded by contexts_mutex_
+    mutable std::size_t gc_threads_ = 1;  // guarded by contexts_mutex_
+    // Started on the first parallel map; declared after contexts_ so its workers stop before the
+    // contexts they ran in go away
+    mutable std::mutex parallel_mutex_;
+    mutable std::size_t parallel_threads_ = 0;  // 0: one per hardware thread
+    mutable std::unique_ptr<TaskPool> parallel_pool_;
+    // Context of the run() in progress on this thread, for the JIT callbacks
+    static thread_local ExecutionContext* active_context_;
+    mutable std::ostream* trace_stream_ = nullptr;
+    mutable TraceWriter* trace_writer_ = nullptr;
+    mutable OutputSink* output_sink_ = nullptr;
+    mutable std::istream* input_stream_ = nullptr;
+    mutable InputSource* input_source_ = nullptr;
+    mutable std::function<std::optional<std::string>()> read_line_provider_;
+    mutable bool jit_enabled_ = true;
+    mutable bool memoization_ = false;
+    ir::OptimizationOptions optimization_options_;
+    // Per-function SSA, compiled code, tier counters and profile, by FunctionId. A reload leaves
+    // the old records empty and appends new ones.
+    mutable std::vector<std::unique_ptr<FunctionRecord>> function_records_;
+    // Guards what threads build lazily and share: SSA, compiled code, OSR entries, profiles and
+    // the persisted code
+    mutable std::mutex state_mutex_;
+
+    // Background compilation. load() waits for the queue to drain, so queued modules stay put.
+    struct CompileRequest {
+        const LoadedModule* module = nullptr;
+        FunctionId id = 0;
+    };
+    mutable bool background_compilation_ = false;
+    mutable std::mutex compile_queue_mutex_;
+    mutable std::condition_variable compile_queued_;  // work arrived, or the thread should stop
+    mutable std::condition_variable compile_idle_;    // queue empty and nothing in flight
+    mutable std::deque<CompileRequest> compile_queue_;
+    mutable std::size_t compiles_in_flight_ = 0;
+    mutable bool stop_compiler_ = false;
+    mutable std::thread compiler_thread_;  // started on the first request
+    mutable std::size_t eager_load_threads_ = 0;
+    mutable TierThresholds tier_thresholds_;
+    // Call tables by module name (heap-allocated: compiled code holds pointers into them)
+    mutable std::unordered_map<std::string, std::unique_ptr<JitLink>> jit_links_;
+    // Persistent code cache by module name
+    std::string code_cache_directory_;
+    std::string precompiled_code_;  // path of the object set_precompiled_code() named
+    std::unique_ptr<jit::JitSymbols> jit_symbols_;  // null unless set_jit_symbols() asked for a tool
+    mutable std::unordered_map<std::string, std::unique_ptr<PersistedCode>> persisted_code_;
     mutable bool profiling_enabled_ = false;
-    mutable std::unordered_map<std::string, FunctionProfile> profiling_data_;
+    mutable bool block_profiling_enabled_ = false;
+    // The profiling timeline, separate from state_mutex_ so that spans can end while it is held
+    mutable std::mutex profile_events_mutex_;
+    mutable std::vector<ProfileEvent> profile_events_;
+    mutable std::uint64_t dropped_profile_events_ = 0;
+    mutable std::chrono::high_resolution_clock::time_point profile_epoch_;  // time zero of the timeline
+    mutable std::unordered_map<std::thread::id, std::uint32_t> profile_threads_;
+    GcCallback gc_callback_;
+    // Counted for metrics() by whichever thread compiles or builds SSA
+    struct MetricCounters {
+        std::atomic<std::uint64_t> jit_compilations{0};
+        std::atomic<std::uint64_t> jit_rejections{0};
+        std::atomic<std::uint64_t> code_cache_hits{0};
+        std::atomic<std::int64_t> compile_nanoseconds{0};
+        std::atomic<std::uint64_t> ssa_misses{0};
+    };
+    mutable MetricCounters metrics_;
 };
 
 }  // namespace impulse::runtime
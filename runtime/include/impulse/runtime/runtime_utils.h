@@ -16,7 +16,7 @@
 namespace impulse::runtime {
 
 // Utility functions for runtime
-inline constexpr double kEpsilon = 1e-12;
+inline constexpr double kEpsilon = ir::kEpsilon;
 
 // Hot-path functions - inline for performance
 [[nodiscard]] inline auto encode_value_id(ir::SsaValue value) -> std::uint64_t {
@@ -48,7 +48,6 @@ inline constexpr double kEpsilon = 1e-12;
 }
 
 // Non-hot-path functions - keep in .cpp
-[[nodiscard]] auto parse_literal(const std::string& operand) -> std::optional<double>;
 [[nodiscard]] auto format_ssa_value(const ir::SsaValue& value) -> std::string;
 [[nodiscard]] auto join_ssa_values(const std::vector<ir::SsaValue>& values) -> std::string;
 [[nodiscard]] auto join_strings(const std::vector<std::string>& values) -> std::string;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+#include "impulse/runtime/runtime.h"
+
+namespace impulse::runtime {
+
+// Request input above this is refused as malformed
+constexpr std::size_t kMaxRequestInputBytes = std::size_t{1} << 30;
+
+// The --serve protocol: runs each request read from `in` against the loaded module, until `in`
+// ends. A request is a line "run <entry> <n>" followed by n bytes of program input; the reply on
+// `out` is a line "exit <code> <n>", or "error <n>" for a failed run, followed by n bytes of the
+// run's output or of the failure. SSA, compiled code and tier counters stay warm from one request
+// to the next, while input and output are the request's own and its heap is collected once it
+// replies. A malformed header (n not a byte count up to kMaxRequestInputBytes included) or input
+// that ends early is reported on `errors` and ends the loop with 2; otherwise it returns 0.
+auto serve_requests(const Vm& vm, const std::string& module_name, std::istream& in, std::ostream& out,
+                    std::ostream& errors) -> int;
+
+}  // namespace impulse::runtime
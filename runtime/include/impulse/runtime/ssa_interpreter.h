@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <iosfwd>
@@ -10,8 +11,11 @@
 
 #include "impulse/ir/ir.h"
 #include "impulse/ir/ssa.h"
+#include "impulse/runtime/bytecode.h"
+#include "impulse/runtime/frame_layout.h"
 #include "impulse/runtime/runtime.h"
 #include "impulse/runtime/runtime_utils.h"
+#include "impulse/runtime/trace_writer.h"
 #include "impulse/runtime/value.h"
 
 #include <algorithm>
@@ -22,23 +26,152 @@ namespace impulse::runtime {
 
 class SsaInterpreter {
 public:
-    using CallFunction = std::function<VmResult(const ir::Function&, const std::vector<Value>&)>;
+    // Calls functions[function] with arguments in parameter order
+    using CallFunction = std::function<VmResult(std::size_t function, const std::vector<Value>& arguments)>;
     using AllocateArray = std::function<GcObject*(std::size_t)>;
+    using AllocateString = std::function<GcObject*(std::string)>;
     using MaybeCollect = std::function<void()>;
-    using ReadLine = std::function<std::optional<std::string>()>;
-    using BuiltinHandler = std::function<std::optional<VmResult>(SsaInterpreter*, const std::string&, const std::vector<Value>&, const std::optional<ir::SsaValue>&)>;
+    // The next input line without its '\n', nullopt at the end of input. The view only has to
+    // stay valid until the next call.
+    using ReadLine = std::function<std::optional<std::string_view>()>;
+    // All input not read yet (read_all)
+    using ReadAll = std::function<std::string_view()>;
+    // The arguments of a builtin call, valid while it runs
+    struct BuiltinArguments {
+        const Value* values = nullptr;
+        std::size_t count = 0;
 
-    SsaInterpreter(const ir::SsaFunction& ssa, const std::unordered_map<std::string, Value>& parameters,
-                   std::unordered_map<std::string, Value>& locals, const std::vector<ir::Function>& functions,
+        [[nodiscard]] auto size() const -> std::size_t { return count; }
+        [[nodiscard]] auto empty() const -> bool { return count == 0; }
+        [[nodiscard]] auto operator[](std::size_t index) const -> const Value& { return values[index]; }
+    };
+    struct Builtin;
+    using BuiltinHandler = std::optional<VmResult> (*)(SsaInterpreter*, const Builtin&, BuiltinArguments,
+                                                        const std::optional<ir::SsaValue>&);
+    using ArrayKernelCall = VmResult (*)(BuiltinArguments args);
+    // A builtin function. Handlers are plain functions; families of builtins sharing one handler
+    // (math functions, array kernels) tell each other apart by the fields after it.
+    struct Builtin {
+        std::string name;
+        BuiltinHandler handler = nullptr;
+        double (*math)(double) = nullptr;
+        ArrayKernelCall kernel = nullptr;
+        jit::JitNativeSignature signature{};
+    };
+
+    // Runs `code`, the bytecode compiled from `ssa`, on the storage of `frame`, with the function's
+    // arguments in parameter order. The caller owns the frame so it can be reported as a GC root.
+    SsaInterpreter(const ir::SsaFunction& ssa, const SsaFrameLayout& layout, const SsaBytecode& code,
+                   InterpreterFrame& frame, const std::vector<Value>& arguments,
+                   const std::vector<ir::Function>& functions,
                    const std::unordered_map<std::string, Value>& globals, CallFunction call_function,
-                   AllocateArray allocate_array, MaybeCollect maybe_collect, std::string* output_buffer,
+                   AllocateArray allocate_array, AllocateString allocate_string, MaybeCollect maybe_collect,
+                   std::string* output_buffer,
                    std::ostream* trace, ReadLine read_line);
 
     [[nodiscard]] auto run() -> VmResult;
 
+    // Incremented on every jump to a block at or before the current one in layout order
+    // (loop headers precede their bodies), feeding the VM's tiering decisions. The counter may be
+    // shared with other threads; increments are relaxed and may occasionally be lost.
+    void set_back_edge_counter(std::atomic<std::uint64_t>* counter) { back_edge_counter_ = counter; }
+    // Incremented on every entry into block b, counts[b] (block profiling); same sharing rules
+    void set_block_counters(std::atomic<std::uint64_t>* counts) { block_counters_ = counts; }
+    // Bytecode instructions of the blocks entered so far, whole blocks at a time: a block left
+    // early (an error, a hand-over to compiled code) still counts in full
+    [[nodiscard]] auto instructions_executed() const -> std::uint64_t { return instructions_; }
+
+    // With tail calls on, run() stops at a call whose result the function would just return:
+    // tail_call() is then the callee (an index into `functions`) and tail_arguments() its
+    // arguments, valid until the frame is reused, and the callee's result is the call's.
+    // Builtins and calls with bad arities still run here.
+    void set_tail_calls(bool enabled) { tail_calls_ = enabled; }
+    [[nodiscard]] auto tail_call() const -> std::optional<std::size_t> { return tail_call_; }
+    [[nodiscard]] auto tail_arguments() const -> const std::vector<Value>& { return call_arguments_; }
+
+    // On-stack replacement hook, called after every back-edge once the target block's phis are
+    // materialised. The handler either finishes the function (returns its result), continues the
+    // frame elsewhere via write_value + resume_at, or declines (returns nullopt without resuming).
+    using OsrHandler = std::function<std::optional<VmResult>(SsaInterpreter&, std::size_t block)>;
+    void set_osr_handler(OsrHandler handler) { osr_handler_ = std::move(handler); }
+
+    // Write barrier: receives the stores GcObject::needs_barrier flags, with the stored value
+    // (see GcHeap::record_write)
+    using WriteBarrier = std::function<void(GcObject*, const Value&)>;
+    void set_write_barrier(WriteBarrier barrier) { write_barrier_ = std::move(barrier); }
+
+    // Heap accounting: receives arrays whose footprint changed since the heap last counted them
+    // (see GcHeap::record_resize)
+    using ResizeHook = std::function<void(GcObject*)>;
+    void set_resize_hook(ResizeHook hook) { resize_hook_ = std::move(hook); }
+
+    // Heap for strings that share storage: interned literals, ropes and zero-copy slices
+    void set_string_heap(GcHeap* heap) { string_heap_ = heap; }
+
+    // Without it struct_make fails: a new instance of the layout, its fields zero and nil
+    using AllocateStruct = std::function<GcObject*(const StructLayout&)>;
+    void set_struct_allocator(AllocateStruct allocate) { allocate_struct_ = std::move(allocate); }
+
+    // Traces into `writer` as well as the trace stream, as the function with that id
+    void set_trace_writer(TraceWriter* writer, FunctionId function) {
+        trace_writer_ = writer;
+        trace_function_ = function;
+        tracing_ = trace_ != nullptr || writer != nullptr;
+        if (writer == nullptr) {
+            return;
+        }
+        writer->define_code(function, ssa_);
+        // The parameters were stored before there was a writer to see them
+        for (const std::uint32_t slot : layout_.parameters) {
+            if (slot < defined_.size() && defined_[slot] != 0) {
+                writer->store(layout_.slots[slot].value, registers_[slot]);
+            }
+        }
+    }
+
+    // parallel_for and array_map_parallel (`builtin`): sets outputs[i] to what functions[function]
+    // returns for inputs[i], or returns why it could not. Without it they make the calls one at a
+    // time through the CallFunction callback.
+    using ParallelMap = std::function<std::optional<VmResult>(const std::string& builtin, std::size_t function,
+                                                              const std::vector<double>& inputs,
+                                                              std::vector<double>& outputs)>;
+    void set_parallel_map(ParallelMap map) { parallel_map_ = std::move(map); }
+
+    // Streams output there instead of appending it to the output buffer
+    void set_output_sink(OutputSink* sink) { output_sink_ = sink; }
+
+    // Without it read_all gathers the remaining lines through the ReadLine callback
+    void set_read_all(ReadAll read_all) { read_all_ = std::move(read_all); }
+
+    // Frame access for the OSR handler
+    [[nodiscard]] auto read_value(const ir::SsaValue& value) -> std::optional<Value> {
+        if (!value.is_valid()) {
+            return std::nullopt;
+        }
+        const Value* found = lookup_slot(layout_.slot_of(value));
+        return found != nullptr ? std::optional<Value>(*found) : std::nullopt;
+    }
+    void write_value(const ir::SsaValue& value, const Value& data) { store_value(value, data); }
+    // Continue interpreting at `block`, entered from `previous`. Called before run(), the call
+    // starts there instead of at the entry block (compiled code ran it up to that edge).
+    void resume_at(std::size_t previous, std::size_t block) { osr_resume_ = Resume{previous, block, std::nullopt}; }
+    // Same inside `block`, at its SSA instruction `instruction`: compiled code deoptimised there
+    // after writing every value live at that point
+    void resume_inside(std::size_t block, std::size_t instruction) {
+        osr_resume_ = Resume{block, block, instruction};
+    }
+
+    [[nodiscard]] static auto is_builtin(const std::string& name) -> bool;
+    // Index of the builtin called `name`, for BytecodeCallee::builtin; kNoBuiltin when there is none
+    [[nodiscard]] static auto find_builtin(const std::string& name) -> std::uint32_t;
+
 private:
     // Hot-path I/O functions - inline for performance
     inline void append_output(const std::string& text, bool newline) const {
+        if (output_sink_ != nullptr) {
+            output_sink_->write(text, newline ? "\n" : "");
+            return;
+        }
         if (output_buffer_ == nullptr) {
             return;
         }
@@ -48,7 +181,17 @@ private:
         }
     }
 
+    // Reads a string result (flattening a rope) only when tracing
+    inline void trace_builtin(const std::string& name, const Value& text) const {
+        if (tracing_) {
+            trace_builtin(name, text.as_string());
+        }
+    }
+
     inline void trace_builtin(const std::string& name, std::string_view payload) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->builtin(name, payload);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -59,106 +202,171 @@ private:
         *trace_ << '\n';
     }
     [[nodiscard]] auto materialize_phi(const ir::SsaBlock& block, std::optional<std::size_t> previous) -> std::optional<VmResult>;
-    
-    // Instruction handler functions
-    [[nodiscard]] auto handle_literal(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_literal_string(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_unary(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_binary(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_assign(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_drop(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_return(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_branch(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_branch_if(const ir::SsaBlock& block, const ir::SsaInstruction& inst, std::size_t current, std::optional<std::size_t>& previous, bool& jumped) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_call(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_make(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_get(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_set(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_length(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_push(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    [[nodiscard]] auto handle_array_pop(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult>;
-    
+    // Enter `current` from `previous`: phis, tracing and the OSR hook, which may move `current`,
+    // even into the middle of a block. `pc` is left at the instruction to run next.
+    [[nodiscard]] auto enter_block(std::size_t& current, std::size_t& pc, std::optional<std::size_t> previous,
+                                   bool back_edge) -> std::optional<VmResult>;
+    // The bytecode position of SSA instruction `instruction` of `block`
+    [[nodiscard]] auto resume_pc(std::size_t block, std::size_t instruction) const -> std::size_t;
+
+    // Out-of-line bytecode handlers for the less frequent instructions
+    [[nodiscard]] auto execute_binary(const BytecodeInstruction& inst, const Value& lhs, const Value& rhs) -> std::optional<VmResult>;
+    [[nodiscard]] auto execute_call(const BytecodeInstruction& inst) -> std::optional<VmResult>;
+    [[nodiscard]] auto execute_array_make(const BytecodeInstruction& inst) -> std::optional<VmResult>;
+    [[nodiscard]] auto execute_array_push(const BytecodeInstruction& inst) -> std::optional<VmResult>;
+    [[nodiscard]] auto execute_array_pop(const BytecodeInstruction& inst) -> std::optional<VmResult>;
+    [[nodiscard]] auto execute_struct_make(const BytecodeInstruction& inst) -> std::optional<VmResult>;
+    // Stores a new array of what the function named by `function` returns for each input
+    [[nodiscard]] auto map_inputs(const Builtin& builtin, const Value& function, const std::vector<double>& inputs,
+                                  const std::optional<ir::SsaValue>& result) -> std::optional<VmResult>;
+    // Why the field instruction `inst` cannot run
+    [[nodiscard]] static auto field_error(const BytecodeInstruction& inst) -> VmResult;
+
     static void init_builtin_table_static();
-    void ensure_builtin_table();
-    
-    [[nodiscard]] auto execute_instruction(const ir::SsaBlock& block, const ir::SsaInstruction& inst,
-                                           std::size_t current,
-                                           std::optional<std::size_t>& previous, bool& jumped) -> std::optional<VmResult>;
-    
-    // Hot-path functions - inline for performance
-    [[nodiscard]] inline auto lookup_value(const ir::SsaValue& value) -> std::optional<Value> {
-        if (!value.is_valid()) {
+    static void ensure_builtin_table();
+    static void add_builtin(Builtin builtin);
+    static void add_builtin(const std::string& name, BuiltinHandler handler);
+
+    // Numeric fast path of a binary operator; strings and errors go through execute_binary
+    template <typename Op>
+    [[nodiscard]] inline auto numeric_binary(const BytecodeInstruction& inst, Op op) -> std::optional<VmResult> {
+        const Value* lhs = lookup_slot(inst.a);
+        const Value* rhs = lookup_slot(inst.b);
+        if (lhs != nullptr && rhs != nullptr && lhs->is_number() && rhs->is_number()) {
+            store_number(inst.dst, op(lhs->number, rhs->number));
             return std::nullopt;
         }
+        if (lhs == nullptr || rhs == nullptr) {
+            return make_result(VmStatus::RuntimeError, "binary instruction missing operands");
+        }
+        return execute_binary(inst, *lhs, *rhs);
+    }
+
+    // Hot-path functions - inline for performance
+    // The value in `slot`, or nullptr when it is undefined. References into the locals map stay
+    // valid across stores (unordered_map never moves its nodes).
+    [[nodiscard]] inline auto lookup_slot(std::uint32_t slot) const -> const Value* {
+        if (slot >= defined_.size()) {
+            return nullptr;
+        }
+        if (defined_[slot] != 0) {
+            return &registers_[slot];
+        }
 
-        const auto key = encode_value_id(value);
-        const auto it = value_cache_.find(key);
-        if (it != value_cache_.end()) {
-            return it->second;
-        }
-
-        if (value.version == 0) {
-            // Use cached symbol name lookup instead of calling find_symbol
-            const auto nameIt = symbol_id_to_name_.find(value.symbol);
-            if (nameIt != symbol_id_to_name_.end() && !nameIt->second.empty()) {
-                const std::string& name = nameIt->second;
-                if (const auto localIt = locals_.find(name); localIt != locals_.end()) {
-                    return localIt->second;
-                }
-                if (const auto paramIt = parameters_.find(name); paramIt != parameters_.end()) {
-                    return paramIt->second;
-                }
-                if (const auto globalIt = globals_.find(name); globalIt != globals_.end()) {
-                    return globalIt->second;
-                }
+        const auto& info = layout_.slots[slot];
+        if (info.value.version == 0 && !info.name.empty()) {
+            // Symbol defined outside this function (or before any SSA definition); parameters are
+            // in the locals map once stored
+            if (const auto localIt = locals_.find(info.name); localIt != locals_.end()) {
+                return &localIt->second;
+            }
+            if (const auto globalIt = globals_.find(info.name); globalIt != globals_.end()) {
+                return &globalIt->second;
             }
         }
 
-        return std::nullopt;
+        return nullptr;
     }
 
     inline void store_value(const ir::SsaValue& value, const Value& data) {
         if (!value.is_valid()) {
             return;
         }
-        const auto key = encode_value_id(value);
-        value_cache_[key] = data;
+        store_slot(layout_.slot_of(value), data);
+    }
 
-        // Update locals_ for version 0 and 1 (parameters and initial values) - hot path (version > 1) skips this
-        // This avoids expensive hash map lookups in the hot path while maintaining compatibility
-        if (value.version <= 1) {
-            const auto nameIt = symbol_id_to_name_.find(value.symbol);
-            if (nameIt != symbol_id_to_name_.end() && !nameIt->second.empty()) {
-                locals_[nameIt->second] = data;
-            }
+    inline void store_slot(std::uint32_t slot, const Value& data) {
+        if (slot >= defined_.size()) {
+            return;
         }
+        registers_[slot] = data;
+        stored(slot);
+    }
 
-        // Inline trace check to avoid function call overhead when tracing is disabled
-        if (trace_ != nullptr) {
-            trace_store(value, data);
+    inline void store_number(std::uint32_t slot, double number) {
+        if (slot >= defined_.size()) {
+            return;
         }
+        registers_[slot] = Value::make_number(number);
+        stored(slot);
     }
-    // Hot-path control flow functions - inline for performance
-    [[nodiscard]] inline auto resolve_block(const std::string& label) const -> std::optional<std::size_t> {
-        const auto it = block_lookup_.find(label);
-        if (it == block_lookup_.end()) {
-            return std::nullopt;
+
+    // From here on the collector sees only the registers `live` names
+    inline void report_live(const LiveRange& live) {
+        frame_.precise_roots = true;
+        frame_.live_slots = code_.live_slots.data() + live.begin;
+        frame_.live_count = live.end - live.begin;
+    }
+
+    // Call before an instruction that may collect, directly or in a callee
+    inline void enter_safepoint(const BytecodeInstruction& inst) {
+        report_live(code_.safepoints[static_cast<std::size_t>(&inst - code_.code.data())]);
+    }
+
+    // Strings are heap objects: allocate, store, then give the collector a chance once the new
+    // string is reachable from the frame
+    inline void store_string(std::uint32_t slot, std::string text) {
+        store_slot(slot, Value::make_string(allocate_string_(std::move(text))));
+        maybe_collect_();
+    }
+
+    inline void store_string(const ir::SsaValue& value, std::string text) {
+        store_string(value.is_valid() ? layout_.slot_of(value) : SsaFrameLayout::kNoSlot, std::move(text));
+    }
+
+    // Same for a string object that already exists, e.g. one sharing its operands' storage
+    inline void store_string_object(std::uint32_t slot, GcObject* string) {
+        store_slot(slot, Value::make_string(string));
+        maybe_collect_();
+    }
+
+    inline void store_string_object(const ir::SsaValue& value, GcObject* string) {
+        store_string_object(value.is_valid() ? layout_.slot_of(value) : SsaFrameLayout::kNoSlot, string);
+    }
+
+    // String results through the string heap when one is set (interned literals, ropes, slices),
+    // fresh copies otherwise. Operands must be strings; slices must be in bounds.
+    [[nodiscard]] auto literal_string(const std::string& text) -> GcObject*;
+    [[nodiscard]] auto concat_strings(const Value& lhs, const Value& rhs) -> GcObject*;
+    [[nodiscard]] auto slice_string(const Value& text, std::size_t start, std::size_t count) -> GcObject*;
+
+    // The object a field instruction accesses: slot a, when it holds a struct of shape b
+    [[nodiscard]] inline auto struct_operand(const BytecodeInstruction& inst) const -> GcObject* {
+        const Value* value = lookup_slot(inst.a);
+        GcObject* object = value != nullptr ? value->as_object() : nullptr;
+        return object != nullptr && object->kind == ObjectKind::Struct && object->shape == inst.b ? object : nullptr;
+    }
+
+    // Call after every store of `value` into the elements of `object`, pushes included
+    inline void record_write(GcObject* object, const Value& value) {
+        if (object->needs_barrier(value) && write_barrier_) {
+            write_barrier_(object, value);
+        }
+        if (object->footprint() != object->accounted_bytes && resize_hook_) {
+            resize_hook_(object);
         }
-        return it->second;
     }
 
-    [[nodiscard]] inline auto pick_fallthrough(const ir::SsaBlock& block, std::optional<std::size_t> exclude = std::nullopt) const -> std::optional<std::size_t> {
-        for (const auto succ : block.successors) {
-            if (exclude.has_value() && succ == *exclude) {
-                continue;
-            }
-            return succ;
+    inline void stored(std::uint32_t slot) {
+        defined_[slot] = 1;
+
+        // Versions 0 and 1 of named variables stay visible to by-name (version 0) reads
+        const auto& info = layout_.slots[slot];
+        if (info.mirror_local) {
+            locals_[info.name] = registers_[slot];
+        }
+
+        // Inline trace check to avoid function call overhead when tracing is disabled
+        if (tracing_) {
+            trace_store(info.value, registers_[slot]);
         }
-        return std::nullopt;
     }
-    
+
     // Trace functions - inline for performance (nullptr check is fast, compiler optimizes away when disabled)
     inline void trace_block_entry(const ir::SsaBlock& block) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->enter_block(trace_function_, block.id);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -170,6 +378,9 @@ private:
     }
 
     inline void trace_phi_materialization(const ir::SsaBlock& block, const ir::PhiNode& phi, const Value& value) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->phi(phi.result, value, block.id);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -177,15 +388,24 @@ private:
         *trace_ << " in block " << block.id << '\n';
     }
 
-    inline void trace_instruction(const ir::SsaBlock& block, const ir::SsaInstruction& inst) const {
+    // Synthetic instructions (block fallthroughs) have no SSA source and are not traced
+    inline void trace_instruction(std::size_t block, std::size_t pc) const {
+        if (code_.sources[pc] == SsaBytecode::kNoSource) {
+            return;
+        }
+        if (trace_writer_ != nullptr) {
+            trace_writer_->instruction(trace_function_, block, code_.sources[pc]);
+        }
         if (trace_ == nullptr) {
             return;
         }
-        (void)block;
-        *trace_ << "    " << format_ssa_instruction(inst) << '\n';
+        *trace_ << "    " << format_ssa_instruction(ssa_.blocks[block].instructions[code_.sources[pc]]) << '\n';
     }
 
     inline void trace_store(const ir::SsaValue& destination, const Value& value) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->store(destination, value);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -193,6 +413,9 @@ private:
     }
 
     inline void trace_return(const Value& value) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->returned(value);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -200,6 +423,9 @@ private:
     }
 
     inline void trace_branch(std::size_t target, bool taken) const {
+        if (trace_writer_ != nullptr) {
+            trace_writer_->branch(trace_function_, target, taken);
+        }
         if (trace_ == nullptr) {
             return;
         }
@@ -217,28 +443,49 @@ private:
     }
 
     const ir::SsaFunction& ssa_;
-    const std::unordered_map<std::string, Value>& parameters_;
     std::unordered_map<std::string, Value>& locals_;
     const std::vector<ir::Function>& functions_;
     const std::unordered_map<std::string, Value>& globals_;
 
-    std::unordered_map<std::uint64_t, Value> value_cache_;
-    std::unordered_map<std::string, std::size_t> block_lookup_;
-    std::unordered_map<std::string, const ir::Function*> function_lookup_;  // O(1) function lookup
-    // Static builtin table - initialized once, shared across all instances
-    static std::unordered_map<std::string, BuiltinHandler> builtin_table_;
-    static bool builtin_table_initialized_;
-    // Performance optimization: cache symbol ID to name mapping to avoid repeated find_symbol calls
-    std::unordered_map<ir::SymbolId, std::string> symbol_id_to_name_;
-    // Performance optimization: cache phi node predecessor lookups
-    std::unordered_map<std::uint64_t, std::unordered_map<std::size_t, const ir::PhiInput*>> phi_predecessor_cache_;
-    std::optional<std::size_t> next_block_;
+    const SsaFrameLayout& layout_;
+    const SsaBytecode& code_;
+    InterpreterFrame& frame_;
+    std::vector<Value>& registers_;
+    std::vector<std::uint8_t>& defined_;
+    std::vector<Value>& call_arguments_;  // reused by every call instruction
+    // Static builtin table - initialized once, shared across all instances. Bytecode refers to
+    // builtins by index, so names are only looked up when a function is compiled.
+    static std::vector<Builtin> builtins_;
+    static std::unordered_map<std::string, std::uint32_t> builtin_ids_;
+    std::atomic<std::uint64_t>* back_edge_counter_ = nullptr;
+    std::atomic<std::uint64_t>* block_counters_ = nullptr;
+    std::uint64_t instructions_ = 0;
+    bool tail_calls_ = false;
+    std::optional<std::size_t> tail_call_;
+    OsrHandler osr_handler_;
+    WriteBarrier write_barrier_;
+    ResizeHook resize_hook_;
+    GcHeap* string_heap_ = nullptr;
+    struct Resume {
+        std::size_t previous = 0;
+        std::size_t block = 0;
+        std::optional<std::size_t> instruction;  // set: inside `block`, without entering it
+    };
+    std::optional<Resume> osr_resume_;
     CallFunction call_function_;
     AllocateArray allocate_array_;
+    AllocateString allocate_string_;
+    AllocateStruct allocate_struct_;
     MaybeCollect maybe_collect_;
+    ParallelMap parallel_map_;
     std::string* output_buffer_ = nullptr;
+    OutputSink* output_sink_ = nullptr;
     std::ostream* trace_ = nullptr;
+    TraceWriter* trace_writer_ = nullptr;
+    FunctionId trace_function_ = 0;
+    bool tracing_ = false;  // trace_ or trace_writer_
     ReadLine read_line_;
+    ReadAll read_all_;
 };
 
 }  // namespace impulse::runtime
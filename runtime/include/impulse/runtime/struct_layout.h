@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "impulse/ir/ir.h"
+
+namespace impulse::runtime {
+
+// Where one field lives in its struct's instances
+struct StructFieldSlot {
+    std::string name;
+    bool numeric = false;    // int, float or bool: an unboxed double in GcObject::numbers
+    std::uint32_t slot = 0;  // index into `numbers` when numeric, into `fields` otherwise
+};
+
+// Flat layout of a struct's instances (ObjectKind::Struct), fixed when its module is loaded. The
+// numeric fields are packed first, in declaration order, as raw doubles right after the object
+// header; the others follow as boxed Values. Field accesses are resolved against it once, when a
+// function's bytecode is built, so running one is a shape check and an indexed load or store.
+struct StructLayout {
+    std::string name;
+    std::uint32_t shape = 0;              // GcObject::shape of every instance; unique within a Vm
+    std::vector<StructFieldSlot> fields;  // declaration order
+    std::uint32_t numeric_count = 0;
+    std::uint32_t boxed_count = 0;
+
+    // nullptr when the struct has no such field
+    [[nodiscard]] auto find(std::string_view field) const -> const StructFieldSlot*;
+};
+
+[[nodiscard]] auto build_struct_layout(const ir::Struct& structure, std::uint32_t shape) -> StructLayout;
+// nullptr when none of `layouts` is named `name`
+[[nodiscard]] auto find_struct_layout(const std::vector<StructLayout>& layouts, std::string_view name)
+    -> const StructLayout*;
+
+}  // namespace impulse::runtime
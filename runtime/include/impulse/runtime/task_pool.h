@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace impulse::runtime {
+
+// Worker threads for the data-parallel builtins (parallel_for, array_map_parallel). run() cuts a
+// range into chunks and deals them out to one deque per participant, the calling thread
+// included. Each participant takes chunks from the back of its own deque and, once that is empty,
+// steals from the front of the others', so chunks that take longer even out. Runs do not
+// overlap: a second caller waits for the first run to finish.
+class TaskPool {
+public:
+    // Called with the participant (0 is the calling thread) and a chunk [begin, end) of the range
+    using Work = std::function<void(std::size_t participant, std::size_t begin, std::size_t end)>;
+
+    // `threads` participants in all: the caller and threads - 1 workers started here
+    explicit TaskPool(std::size_t threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    auto operator=(const TaskPool&) -> TaskPool& = delete;
+
+    [[nodiscard]] auto threads() const -> std::size_t { return deques_.size(); }
+    // Runs `work` over [0, count) in chunks of at most `chunk` elements and returns once every
+    // chunk has run. A range of one chunk runs on the calling thread alone.
+    void run(std::size_t count, std::size_t chunk, const Work& work);
+    // Chunks a participant took from another one's deque so far
+    [[nodiscard]] auto steals() const -> std::uint64_t { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+    struct Deque {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    void worker(std::size_t participant);
+    // Runs chunks until every deque is empty
+    void drain(std::size_t participant, const Work& work);
+    [[nodiscard]] auto take(std::size_t participant, Chunk& chunk) -> bool;
+
+    std::vector<std::unique_ptr<Deque>> deques_;
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;  // held for a whole run
+    std::mutex mutex_;
+    std::condition_variable started_;
+    std::condition_variable finished_;
+    const Work* work_ = nullptr;
+    std::uint64_t generation_ = 0;  // runs so far
+    std::size_t busy_ = 0;          // workers still in the current run
+    bool stop_ = false;
+    std::atomic<std::uint64_t> steals_{0};
+};
+
+}  // namespace impulse::runtime
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/ir/ssa.h"
+#include "impulse/runtime/runtime.h"
+#include "impulse/runtime/value.h"
+
+namespace impulse::runtime {
+
+// Binary runtime trace: the events of the text trace (Vm::set_trace_stream) as fixed-size
+// records that name functions, blocks and instructions by id. Each name and each instruction's
+// text is written once, in a dictionary record, the first time a traced call needs it; numbers
+// are stored as they are and only strings are copied. decode_trace turns a trace back into the
+// text the trace stream would have printed.
+//
+// Records collect in segments that are written out whole. By default a full segment goes to the
+// stream straight away; with ring_segments set the writer is a flight recorder instead, keeping
+// only the newest ring_segments segments in memory until flush(), and the decoded text starts
+// with how many records were dropped. A string longer than a segment is cut to fit. The writer
+// is not synchronised: like the trace stream, it must not be shared by overlapping runs.
+class TraceWriter {
+public:
+    struct Options {
+        std::size_t segment_bytes = std::size_t{1} << 20;
+        std::size_t ring_segments = 0;
+    };
+
+    explicit TraceWriter(std::ostream& out);
+    TraceWriter(std::ostream& out, Options options);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    auto operator=(const TraceWriter&) -> TraceWriter& = delete;
+
+    // Dictionary entries; each function's are written on the first call only
+    void define_function(FunctionId function, std::string_view name);
+    void define_code(FunctionId function, const ir::SsaFunction& ssa);
+
+    void enter_function(FunctionId function);
+    void exit_function(FunctionId function, double value);
+    void exit_function(FunctionId function, const VmResult& result);
+    void enter_block(FunctionId function, std::size_t block);
+    // `instruction` indexes the instructions of `block` in the function's SSA
+    void instruction(FunctionId function, std::size_t block, std::size_t instruction);
+    void phi(const ir::SsaValue& result, const Value& value, std::size_t block);
+    void store(const ir::SsaValue& destination, const Value& value);
+    void returned(const Value& value);
+    // `target` past the function's blocks is an invalid branch
+    void branch(FunctionId function, std::size_t target, bool taken);
+    void builtin(const std::string& name, std::string_view payload);
+
+    // Writes every record buffered so far
+    void flush();
+    // Records the ring overwrote before they could be written
+    [[nodiscard]] auto dropped_records() const -> std::uint64_t { return dropped_total_; }
+
+    struct Record {
+        std::uint8_t kind = 0;
+        std::uint8_t value = 0;  // how `payload` is read
+        std::uint16_t reserved = 0;
+        std::uint32_t a = 0;
+        std::uint32_t b = 0;
+        std::uint32_t c = 0;
+        std::uint64_t payload = 0;
+    };
+    static_assert(sizeof(Record) == 24, "trace records are fixed-size");
+
+private:
+    // Appends `record`, followed by `text` in raw records when there is some
+    void append(Record record, std::string_view text);
+    void append_value(Record record, const Value& value);
+    void define(Record record, std::string_view text);
+    void next_segment();
+    void write_header();
+
+    std::ostream& out_;
+    Options options_;
+    std::size_t segment_records_ = 0;
+    std::vector<std::vector<Record>> segments_;
+    std::size_t current_ = 0;
+    std::vector<Record> dictionary_;
+    std::size_t dictionary_written_ = 0;
+    bool header_written_ = false;
+    std::uint64_t dropped_ = 0;
+    std::uint64_t dropped_total_ = 0;
+    // Per function id: bit 0 its name is defined, bit 1 its code
+    std::vector<std::uint8_t> defined_;
+    std::unordered_map<std::string, std::uint32_t> builtins_;
+};
+
+// Decodes a binary trace from `in` into the text trace format. Returns false, after writing what
+// it could, when the input is not a trace, ends in the middle of an entry, or is corrupt: a text
+// longer than the rest of the input, or an id defined out of order.
+auto decode_trace(std::istream& in, std::ostream& out) -> bool;
+
+}  // namespace impulse::runtime
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <string_view>
-#include <vector>
+
+#include "impulse/runtime/gc_buffer.h"
 
 namespace impulse::runtime {
 
@@ -16,11 +21,15 @@ enum class ValueKind : std::uint8_t {
     String,
 };
 
+// 16 bytes: a kind tag and one payload word. Strings live in the GC heap like arrays, so copying a
+// Value never allocates. The payload matching `kind` is the only one that may be read; the
+// accessors return 0 / nullptr / "" for the others.
 struct Value {
     ValueKind kind = ValueKind::Nil;
-    double number = 0.0;
-    GcObject* object = nullptr;
-    std::string text;
+    union {
+        double number = 0.0;
+        GcObject* object;  // an array or struct for Object values, ObjectKind::String for String values
+    };
 
     [[nodiscard]] static auto make_nil() -> Value { return Value{}; }
 
@@ -28,8 +37,6 @@ struct Value {
         Value result;
         result.kind = ValueKind::Number;
         result.number = v;
-        result.object = nullptr;
-        result.text.clear();
         return result;
     }
 
@@ -37,17 +44,14 @@ struct Value {
         Value result;
         result.kind = ValueKind::Object;
         result.object = obj;
-        result.number = 0.0;
-        result.text.clear();
         return result;
     }
 
-    [[nodiscard]] static auto make_string(std::string value) -> Value {
+    // `string` must be an ObjectKind::String object
+    [[nodiscard]] static auto make_string(GcObject* string) -> Value {
         Value result;
         result.kind = ValueKind::String;
-        result.number = 0.0;
-        result.object = nullptr;
-        result.text = std::move(value);
+        result.object = string;
         return result;
     }
 
@@ -55,20 +59,206 @@ struct Value {
     [[nodiscard]] auto is_object() const -> bool { return kind == ValueKind::Object; }
     [[nodiscard]] auto is_string() const -> bool { return kind == ValueKind::String; }
     [[nodiscard]] auto is_nil() const -> bool { return kind == ValueKind::Nil; }
-    [[nodiscard]] auto as_number() const -> double { return number; }
-    [[nodiscard]] auto as_object() const -> GcObject* { return object; }
-    [[nodiscard]] auto as_string() const -> std::string_view { return text; }
+    [[nodiscard]] auto as_number() const -> double { return is_number() ? number : 0.0; }
+    [[nodiscard]] auto as_object() const -> GcObject* { return is_object() ? object : nullptr; }
+    [[nodiscard]] inline auto as_string() const -> std::string_view;
+    // The GC object this value keeps alive, if any (arrays and strings)
+    [[nodiscard]] auto heap_object() const -> GcObject* {
+        return kind == ValueKind::Object || kind == ValueKind::String ? object : nullptr;
+    }
 };
 
+static_assert(sizeof(Value) == 16, "Value should stay a tag plus one payload word");
+
 enum class ObjectKind : std::uint8_t {
-    Array,
+    Array,         // boxed elements in `fields`
+    String,
+    Float64Array,  // unboxed numeric elements in `numbers`
+    Struct,        // fixed layout (see StructLayout): numeric fields in `numbers`, the others in `fields`
+};
+
+// Float64Array elements that were never assigned a number hold this signalling NaN and read back
+// as nil. Arithmetic only produces quiet NaNs, so no computed number carries these bits.
+inline constexpr std::uint64_t kFloat64Hole = 0x7FF4000000000001ULL;
+
+[[nodiscard]] inline auto float64_hole() -> double {
+    double hole = 0.0;
+    std::memcpy(&hole, &kFloat64Hole, sizeof(hole));
+    return hole;
+}
+
+[[nodiscard]] inline auto is_float64_hole(double value) -> bool {
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits == kFloat64Hole;
+}
+
+// Header at the start of every GcHeap page, a kBytes-aligned block of equal cells. Marks live in
+// its bitmap rather than in the objects, so an object's page is found by masking its address. A
+// large object gets a page of its own with a single cell.
+struct GcPage {
+    static constexpr std::size_t kBytes = std::size_t{64} * std::size_t{1024};
+    static constexpr std::size_t kMaxCells = 512;
+    static constexpr std::size_t kHeaderBytes = 128;  // cells start here
+
+    std::atomic<std::uint64_t> marks[kMaxCells / 64] = {};
+    std::uint32_t cell_bytes = 0;
+    std::uint32_t cell_count = 0;
+    std::uint8_t size_class = 0;
+
+    [[nodiscard]] static auto of(const void* object) -> GcPage* {
+        return reinterpret_cast<GcPage*>(reinterpret_cast<std::uintptr_t>(object) & ~(kBytes - 1));
+    }
+    [[nodiscard]] auto cell(std::size_t index) -> void* {
+        return reinterpret_cast<unsigned char*>(this) + kHeaderBytes + (index * cell_bytes);
+    }
+
+    [[nodiscard]] auto marked(std::size_t index) const -> bool {
+        return (marks[index / 64].load(std::memory_order_relaxed) & bit(index)) != 0;
+    }
+    // Only while no other thread marks this page
+    void set_marked(std::size_t index, bool value) {
+        std::atomic<std::uint64_t>& word = marks[index / 64];
+        const std::uint64_t bits = word.load(std::memory_order_relaxed);
+        word.store(value ? bits | bit(index) : bits & ~bit(index), std::memory_order_relaxed);
+    }
+    // Clears the mark from any thread
+    void unmark(std::size_t index) { marks[index / 64].fetch_and(~bit(index), std::memory_order_relaxed); }
+    // Sets the mark from any thread; true when this call set it
+    [[nodiscard]] auto try_mark(std::size_t index) -> bool {
+        std::atomic<std::uint64_t>& word = marks[index / 64];
+        return (word.load(std::memory_order_relaxed) & bit(index)) == 0 &&
+               (word.fetch_or(bit(index), std::memory_order_relaxed) & bit(index)) == 0;
+    }
+
+private:
+    [[nodiscard]] static constexpr auto bit(std::size_t index) -> std::uint64_t {
+        return std::uint64_t{1} << (index % 64);
+    }
 };
 
+static_assert(sizeof(GcPage) <= GcPage::kHeaderBytes, "page header overlaps the first cell");
+
+// Arrays start out as Float64Array and switch to the boxed representation, transparently, the
+// first time a non-number is stored. The array_* members work on either; indices are unchecked.
+// Objects carved from a GcHeap page keep their elements inline, in the rest of their cell, until
+// they outgrow it. Strings are immutable and come in three shapes, all ObjectKind::String: flat
+// ones own `text`, slices view the text of the flat string in fields[0], and ropes (from
+// concatenation) hold their two parts in fields[0] and fields[1] with no `chars` until the first
+// read flattens them into `text`. The parts stay reachable through `fields`, which the collector
+// traces for every kind. A struct's fields never move out of its cell: the unboxed numeric ones
+// come first, right after this header, so they sit at fixed offsets from the object.
 struct GcObject {
     ObjectKind kind = ObjectKind::Array;
-    bool marked = false;
-    std::vector<Value> fields;
+    bool old = false;         // survived a collection (see GcHeap)
+    bool remembered = false;  // old object in the heap's remembered set
+    std::uint16_t cell = 0;   // index in its page, for the mark bitmap
+    std::uint32_t inline_bytes = 0;  // element storage in the cell after this header
+    std::uint32_t shape = 0;         // Struct: StructLayout::shape of its layout
+    GcBuffer<Value> fields;    // Array elements, boxed struct fields
+    GcBuffer<double> numbers;  // Float64Array elements (kFloat64Hole for nil), numeric struct fields
+    std::string text;          // String contents of a flat string
+    const char* chars = nullptr;  // Characters of a flat string or slice; null for a rope
+    std::size_t length = 0;       // String length
     GcObject* next = nullptr;
+    std::size_t accounted_bytes = 0;  // footprint() when the heap last counted this object
+
+    // Bytes held: the cell, unused element capacity outside it and out-of-line string storage
+    [[nodiscard]] auto footprint() const -> std::size_t {
+        const std::size_t text_bytes = text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+        return sizeof(GcObject) + inline_bytes + fields.heap_bytes() + numbers.heap_bytes() + text_bytes;
+    }
+
+    // Contents of a string, flattening a rope first
+    [[nodiscard]] auto contents() -> std::string_view {
+        return chars != nullptr ? std::string_view(chars, length) : flatten();
+    }
+    // Copies a rope's parts into `text` and drops them (defined with GcHeap)
+    auto flatten() -> std::string_view;
+
+    // Mark bit of a heap object. Lives in the page bitmap (see GcPage).
+    [[nodiscard]] auto marked() const -> bool { return GcPage::of(this)->marked(cell); }
+
+    [[nodiscard]] auto is_array() const -> bool {
+        return kind == ObjectKind::Array || kind == ObjectKind::Float64Array;
+    }
+
+    [[nodiscard]] auto array_length() const -> std::size_t {
+        return kind == ObjectKind::Float64Array ? numbers.size() : fields.size();
+    }
+
+    [[nodiscard]] auto array_get(std::size_t index) const -> Value {
+        if (kind != ObjectKind::Float64Array) {
+            return fields[index];
+        }
+        const double number = numbers[index];
+        return is_float64_hole(number) ? Value::make_nil() : Value::make_number(number);
+    }
+
+    void array_set(std::size_t index, const Value& value) {
+        if (kind == ObjectKind::Float64Array) {
+            if (value.is_number()) {
+                numbers[index] = storable(value.number);
+                return;
+            }
+            box_elements();
+        }
+        fields[index] = value;
+    }
+
+    void array_push(const Value& value) {
+        if (kind == ObjectKind::Float64Array) {
+            if (value.is_number()) {
+                numbers.push_back(storable(value.number));
+                return;
+            }
+            box_elements();
+        }
+        fields.push_back(value);
+    }
+
+    // Requires a non-empty array
+    auto array_pop() -> Value {
+        Value popped = array_get(array_length() - 1);
+        if (kind == ObjectKind::Float64Array) {
+            numbers.pop_back();
+        } else {
+            fields.pop_back();
+        }
+        return popped;
+    }
+
+    // Write barrier test: true when storing `value` into this object must be reported to the
+    // heap, i.e. an old object not yet remembered gains a reference to a young one, or a marked
+    // object one that is not (incremental marking may already have traced this object)
+    [[nodiscard]] auto needs_barrier(const Value& value) const -> bool {
+        const GcObject* child = value.heap_object();
+        if (child == nullptr) {
+            return false;
+        }
+        return (marked() && !child->marked()) || (old && !remembered && !child->old);
+    }
+
+    // Switch a Float64Array to boxed elements
+    void box_elements() {
+        fields.clear();
+        fields.reserve(numbers.size());
+        for (const double number : numbers) {
+            fields.push_back(is_float64_hole(number) ? Value::make_nil() : Value::make_number(number));
+        }
+        numbers.clear();
+        numbers.shrink_to_fit();
+        kind = ObjectKind::Array;
+    }
+
+private:
+    [[nodiscard]] static auto storable(double number) -> double {
+        return is_float64_hole(number) ? std::numeric_limits<double>::quiet_NaN() : number;
+    }
 };
 
+inline auto Value::as_string() const -> std::string_view {
+    return is_string() && object != nullptr ? object->contents() : std::string_view{};
+}
+
 }  // namespace impulse::runtime
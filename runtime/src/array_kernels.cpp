@@ -0,0 +1,667 @@
+#include "impulse/runtime/array_kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include "impulse/runtime/runtime_utils.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define IMPULSE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace impulse::runtime {
+
+namespace {
+
+// Partial results per main-loop block: four AVX2 registers or two AVX-512 registers
+constexpr std::size_t kLanes = 16;
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// The vector min / max instructions: the second operand unless the first compares smaller / larger
+[[nodiscard]] inline auto min_of(double lhs, double rhs) -> double { return lhs < rhs ? lhs : rhs; }
+[[nodiscard]] inline auto max_of(double lhs, double rhs) -> double { return lhs > rhs ? lhs : rhs; }
+
+// Folds lane j with lane j + 8, then j + 4, j + 2 and j + 1, as the vector versions do with their
+// register halves
+template <typename Combine>
+[[nodiscard]] auto fold_lanes(double* lanes, Combine combine) -> double {
+    for (std::size_t width = kLanes / 2; width != 0; width /= 2) {
+        for (std::size_t j = 0; j < width; ++j) {
+            lanes[j] = combine(lanes[j], lanes[j + width]);
+        }
+    }
+    return lanes[0];
+}
+
+// The elements after the last whole block, shared by every implementation
+
+[[nodiscard]] auto finish_sum(double* lanes, const double* values, std::size_t count) -> double {
+    double total = fold_lanes(lanes, [](double lhs, double rhs) { return lhs + rhs; });
+    for (std::size_t i = 0; i < count; ++i) {
+        total += is_float64_hole(values[i]) ? 0.0 : values[i];
+    }
+    return total;
+}
+
+[[nodiscard]] auto finish_dot(double* lanes, const double* lhs, const double* rhs, std::size_t count) -> double {
+    double total = fold_lanes(lanes, [](double left, double right) { return left + right; });
+    for (std::size_t i = 0; i < count; ++i) {
+        total += is_float64_hole(lhs[i]) || is_float64_hole(rhs[i]) ? 0.0 : lhs[i] * rhs[i];
+    }
+    return total;
+}
+
+template <bool Min>
+[[nodiscard]] auto finish_extreme(double* lanes, bool seen, const double* values, std::size_t count,
+                                  double* result) -> bool {
+    double best = Min ? fold_lanes(lanes, min_of) : fold_lanes(lanes, max_of);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double value = values[i];
+        if (value == value) {  // holes are NaNs too
+            best = Min ? min_of(best, value) : max_of(best, value);
+            seen = true;
+        }
+    }
+    *result = best;
+    return seen;
+}
+
+void finish_scale(double* values, std::size_t count, double factor) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!is_float64_hole(values[i])) {
+            values[i] *= factor;
+        }
+    }
+}
+
+void finish_axpy(double factor, const double* x, double* y, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!is_float64_hole(y[i])) {
+            y[i] += is_float64_hole(x[i]) ? 0.0 : factor * x[i];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Portable versions. The lane arrays keep the combining order of the vector code.
+
+auto sum_scalar(const double* values, std::size_t count) -> double {
+    double lanes[kLanes] = {};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (std::size_t j = 0; j < kLanes; ++j) {
+            lanes[j] += is_float64_hole(values[i + j]) ? 0.0 : values[i + j];
+        }
+    }
+    return finish_sum(lanes, values + whole, count - whole);
+}
+
+auto dot_scalar(const double* lhs, const double* rhs, std::size_t count) -> double {
+    double lanes[kLanes] = {};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (std::size_t j = 0; j < kLanes; ++j) {
+            const bool hole = is_float64_hole(lhs[i + j]) || is_float64_hole(rhs[i + j]);
+            lanes[j] += hole ? 0.0 : lhs[i + j] * rhs[i + j];
+        }
+    }
+    return finish_dot(lanes, lhs + whole, rhs + whole, count - whole);
+}
+
+template <bool Min>
+auto extreme_scalar(const double* values, std::size_t count, double* result) -> bool {
+    double lanes[kLanes];
+    std::fill_n(lanes, kLanes, Min ? kInfinity : -kInfinity);
+    bool seen = false;
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (std::size_t j = 0; j < kLanes; ++j) {
+            const double value = values[i + j];
+            const bool number = value == value;
+            const double candidate = number ? value : (Min ? kInfinity : -kInfinity);
+            lanes[j] = Min ? min_of(lanes[j], candidate) : max_of(lanes[j], candidate);
+            seen = seen || number;
+        }
+    }
+    return finish_extreme<Min>(lanes, seen, values + whole, count - whole, result);
+}
+
+void scale_scalar(double* values, std::size_t count, double factor) { finish_scale(values, count, factor); }
+
+void axpy_scalar(double factor, const double* x, double* y, std::size_t count) { finish_axpy(factor, x, y, count); }
+
+constexpr ArrayKernels kScalarKernels{
+    "scalar", sum_scalar, dot_scalar, extreme_scalar<true>, extreme_scalar<false>, scale_scalar, axpy_scalar,
+};
+
+#ifdef IMPULSE_X86_KERNELS
+
+// ---------------------------------------------------------------------------------------------
+// AVX2: four registers of four lanes, elements i..i+15 of a block in lane order
+
+#define IMPULSE_AVX2 __attribute__((target("avx2")))
+
+IMPULSE_AVX2 inline auto holes_avx2(__m256d values) -> __m256d {
+    const __m256i hole = _mm256_set1_epi64x(static_cast<long long>(kFloat64Hole));
+    return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_castpd_si256(values), hole));
+}
+
+IMPULSE_AVX2 auto sum_avx2(const double* values, std::size_t count) -> double {
+    __m256d acc[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 4; ++r) {
+            const __m256d v = _mm256_loadu_pd(values + i + 4 * r);
+            acc[r] = _mm256_add_pd(acc[r], _mm256_andnot_pd(holes_avx2(v), v));
+        }
+    }
+    double lanes[kLanes];
+    for (int r = 0; r < 4; ++r) {
+        _mm256_storeu_pd(lanes + 4 * r, acc[r]);
+    }
+    return finish_sum(lanes, values + whole, count - whole);
+}
+
+IMPULSE_AVX2 auto dot_avx2(const double* lhs, const double* rhs, std::size_t count) -> double {
+    __m256d acc[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 4; ++r) {
+            const __m256d a = _mm256_loadu_pd(lhs + i + 4 * r);
+            const __m256d b = _mm256_loadu_pd(rhs + i + 4 * r);
+            const __m256d holes = _mm256_or_pd(holes_avx2(a), holes_avx2(b));
+            acc[r] = _mm256_add_pd(acc[r], _mm256_andnot_pd(holes, _mm256_mul_pd(a, b)));
+        }
+    }
+    double lanes[kLanes];
+    for (int r = 0; r < 4; ++r) {
+        _mm256_storeu_pd(lanes + 4 * r, acc[r]);
+    }
+    return finish_dot(lanes, lhs + whole, rhs + whole, count - whole);
+}
+
+template <bool Min>
+IMPULSE_AVX2 auto extreme_avx2(const double* values, std::size_t count, double* result) -> bool {
+    const __m256d skip = _mm256_set1_pd(Min ? kInfinity : -kInfinity);
+    __m256d acc[4] = {skip, skip, skip, skip};
+    __m256d seen = _mm256_setzero_pd();
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 4; ++r) {
+            const __m256d v = _mm256_loadu_pd(values + i + 4 * r);
+            const __m256d numbers = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+            const __m256d candidate = _mm256_blendv_pd(skip, v, numbers);
+            acc[r] = Min ? _mm256_min_pd(acc[r], candidate) : _mm256_max_pd(acc[r], candidate);
+            seen = _mm256_or_pd(seen, numbers);
+        }
+    }
+    double lanes[kLanes];
+    for (int r = 0; r < 4; ++r) {
+        _mm256_storeu_pd(lanes + 4 * r, acc[r]);
+    }
+    return finish_extreme<Min>(lanes, _mm256_movemask_pd(seen) != 0, values + whole, count - whole, result);
+}
+
+IMPULSE_AVX2 void scale_avx2(double* values, std::size_t count, double factor) {
+    const __m256d by = _mm256_set1_pd(factor);
+    const std::size_t whole = count - count % 4;
+    for (std::size_t i = 0; i < whole; i += 4) {
+        const __m256d v = _mm256_loadu_pd(values + i);
+        _mm256_storeu_pd(values + i, _mm256_blendv_pd(_mm256_mul_pd(v, by), v, holes_avx2(v)));
+    }
+    finish_scale(values + whole, count - whole, factor);
+}
+
+IMPULSE_AVX2 void axpy_avx2(double factor, const double* x, double* y, std::size_t count) {
+    const __m256d by = _mm256_set1_pd(factor);
+    const std::size_t whole = count - count % 4;
+    for (std::size_t i = 0; i < whole; i += 4) {
+        const __m256d xv = _mm256_loadu_pd(x + i);
+        const __m256d yv = _mm256_loadu_pd(y + i);
+        const __m256d product = _mm256_andnot_pd(holes_avx2(xv), _mm256_mul_pd(by, xv));
+        _mm256_storeu_pd(y + i, _mm256_blendv_pd(_mm256_add_pd(yv, product), yv, holes_avx2(yv)));
+    }
+    finish_axpy(factor, x + whole, y + whole, count - whole);
+}
+
+constexpr ArrayKernels kAvx2Kernels{
+    "avx2", sum_avx2, dot_avx2, extreme_avx2<true>, extreme_avx2<false>, scale_avx2, axpy_avx2,
+};
+
+// ---------------------------------------------------------------------------------------------
+// AVX-512: two registers of eight lanes
+
+#define IMPULSE_AVX512 __attribute__((target("avx512f")))
+
+IMPULSE_AVX512 inline auto numbers_avx512(__m512d values) -> __mmask8 {
+    const __m512i hole = _mm512_set1_epi64(static_cast<long long>(kFloat64Hole));
+    return _mm512_cmpneq_epi64_mask(_mm512_castpd_si512(values), hole);
+}
+
+IMPULSE_AVX512 auto sum_avx512(const double* values, std::size_t count) -> double {
+    __m512d acc[2] = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 2; ++r) {
+            const __m512d v = _mm512_loadu_pd(values + i + 8 * r);
+            acc[r] = _mm512_add_pd(acc[r], _mm512_maskz_mov_pd(numbers_avx512(v), v));
+        }
+    }
+    double lanes[kLanes];
+    _mm512_storeu_pd(lanes, acc[0]);
+    _mm512_storeu_pd(lanes + 8, acc[1]);
+    return finish_sum(lanes, values + whole, count - whole);
+}
+
+IMPULSE_AVX512 auto dot_avx512(const double* lhs, const double* rhs, std::size_t count) -> double {
+    __m512d acc[2] = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 2; ++r) {
+            const __m512d a = _mm512_loadu_pd(lhs + i + 8 * r);
+            const __m512d b = _mm512_loadu_pd(rhs + i + 8 * r);
+            const __mmask8 both = numbers_avx512(a) & numbers_avx512(b);
+            acc[r] = _mm512_add_pd(acc[r], _mm512_maskz_mov_pd(both, _mm512_mul_pd(a, b)));
+        }
+    }
+    double lanes[kLanes];
+    _mm512_storeu_pd(lanes, acc[0]);
+    _mm512_storeu_pd(lanes + 8, acc[1]);
+    return finish_dot(lanes, lhs + whole, rhs + whole, count - whole);
+}
+
+template <bool Min>
+IMPULSE_AVX512 auto extreme_avx512(const double* values, std::size_t count, double* result) -> bool {
+    const __m512d skip = _mm512_set1_pd(Min ? kInfinity : -kInfinity);
+    __m512d acc[2] = {skip, skip};
+    __mmask8 seen = 0;
+    const std::size_t whole = count - count % kLanes;
+    for (std::size_t i = 0; i < whole; i += kLanes) {
+        for (int r = 0; r < 2; ++r) {
+            const __m512d v = _mm512_loadu_pd(values + i + 8 * r);
+            const __mmask8 numbers = _mm512_cmp_pd_mask(v, v, _CMP_ORD_Q);
+            // Masked forms keep the other lanes of acc (the unmasked ones start from an undefined
+            // vector, which GCC 12 reports as maybe-uninitialized)
+            acc[r] = Min ? _mm512_mask_min_pd(acc[r], numbers, acc[r], v)
+                         : _mm512_mask_max_pd(acc[r], numbers, acc[r], v);
+            seen = static_cast<__mmask8>(seen | numbers);
+        }
+    }
+    double lanes[kLanes];
+    _mm512_storeu_pd(lanes, acc[0]);
+    _mm512_storeu_pd(lanes + 8, acc[1]);
+    return finish_extreme<Min>(lanes, seen != 0, values + whole, count - whole, result);
+}
+
+IMPULSE_AVX512 void scale_avx512(double* values, std::size_t count, double factor) {
+    const __m512d by = _mm512_set1_pd(factor);
+    const std::size_t whole = count - count % 8;
+    for (std::size_t i = 0; i < whole; i += 8) {
+        const __m512d v = _mm512_loadu_pd(values + i);
+        _mm512_storeu_pd(values + i, _mm512_mask_mul_pd(v, numbers_avx512(v), v, by));
+    }
+    finish_scale(values + whole, count - whole, factor);
+}
+
+IMPULSE_AVX512 void axpy_avx512(double factor, const double* x, double* y, std::size_t count) {
+    const __m512d by = _mm512_set1_pd(factor);
+    const std::size_t whole = count - count % 8;
+    for (std::size_t i = 0; i < whole; i += 8) {
+        const __m512d xv = _mm512_loadu_pd(x + i);
+        const __m512d yv = _mm512_loadu_pd(y + i);
+        const __m512d product = _mm512_maskz_mul_pd(numbers_avx512(xv), by, xv);
+        _mm512_storeu_pd(y + i, _mm512_mask_add_pd(yv, numbers_avx512(yv), yv, product));
+    }
+    finish_axpy(factor, x + whole, y + whole, count - whole);
+}
+
+constexpr ArrayKernels kAvx512Kernels{
+    "avx512", sum_avx512, dot_avx512, extreme_avx512<true>, extreme_avx512<false>, scale_avx512, axpy_avx512,
+};
+
+#endif  // IMPULSE_X86_KERNELS
+
+// ---------------------------------------------------------------------------------------------
+// Whole arrays
+
+[[nodiscard]] auto number_result(double value) -> VmResult {
+    VmResult result;
+    result.status = VmStatus::Success;
+    result.has_value = true;
+    result.value = value;
+    return result;
+}
+
+[[nodiscard]] auto done() -> VmResult {
+    VmResult result;
+    result.status = VmStatus::Success;
+    return result;
+}
+
+[[nodiscard]] auto not_numeric(const char* builtin) -> VmResult {
+    return make_result(VmStatus::RuntimeError, std::string(builtin) + " encountered non-numeric element");
+}
+
+[[nodiscard]] auto length_mismatch(const char* builtin) -> VmResult {
+    return make_result(VmStatus::RuntimeError, std::string(builtin) + " requires arrays of equal length");
+}
+
+// The elements of `array` unboxed: a Float64Array's own storage, or a boxed array's numbers
+// copied into `scratch` with nil as a hole. nullptr when a boxed element is not a number or nil.
+[[nodiscard]] auto unboxed(const GcObject& array, std::vector<double>& scratch) -> const double* {
+    if (array.kind == ObjectKind::Float64Array) {
+        return array.numbers.data();
+    }
+    scratch.resize(array.fields.size());
+    for (std::size_t i = 0; i < scratch.size(); ++i) {
+        const Value& field = array.fields[i];
+        if (field.is_number()) {
+            scratch[i] = field.number;
+        } else if (field.is_nil()) {
+            scratch[i] = float64_hole();
+        } else {
+            return nullptr;
+        }
+    }
+    return scratch.data();
+}
+
+// Stores unboxed `values` back into boxed `array`
+void rebox(GcObject& array, const double* values) {
+    for (std::size_t i = 0; i < array.fields.size(); ++i) {
+        array.fields[i] = is_float64_hole(values[i]) ? Value::make_nil() : Value::make_number(values[i]);
+    }
+}
+
+// Runs `update` on the unboxed elements of `array` in place
+template <typename Update>
+[[nodiscard]] auto update_unboxed(GcObject& array, const char* builtin, Update update) -> VmResult {
+    if (array.kind == ObjectKind::Float64Array) {
+        update(array.numbers.data());
+        return done();
+    }
+    std::vector<double> scratch;
+    if (unboxed(array, scratch) == nullptr) {
+        return not_numeric(builtin);
+    }
+    update(scratch.data());
+    rebox(array, scratch.data());
+    return done();
+}
+
+template <bool Min>
+[[nodiscard]] auto array_extreme(const GcObject& array, const char* builtin) -> VmResult {
+    std::vector<double> scratch;
+    const double* elements = unboxed(array, scratch);
+    if (elements == nullptr) {
+        return not_numeric(builtin);
+    }
+    double value = 0.0;
+    const ArrayKernels& kernels = array_kernels();
+    if (!(Min ? kernels.min : kernels.max)(elements, array.array_length(), &value)) {
+        return make_result(VmStatus::RuntimeError, std::string(builtin) + " requires a numeric element");
+    }
+    return number_result(value);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Sorting
+
+// Unsigned key in sort order: numbers by value with -0 before +0, then NaNs, then holes
+[[nodiscard]] inline auto sort_key(double value) -> std::uint64_t {
+    if (is_float64_hole(value)) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    if (value != value) {
+        return std::numeric_limits<std::uint64_t>::max() - 1;
+    }
+    constexpr std::uint64_t kSign = std::uint64_t{1} << 63;
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & kSign) != 0 ? ~bits : bits | kSign;
+}
+
+// Runs work(0) .. work(threads - 1), all but the first on threads of their own
+template <typename Work>
+void run_parallel(std::size_t threads, const Work& work) {
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t t = 1; t < threads; ++t) {
+        workers.emplace_back([&work, t] { work(t); });
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Stable LSD radix sort of records[0, count) by key_of(record), 11 bits a pass. Each pass counts
+// digits and scatters records on several threads, every thread owning a contiguous slice, so the
+// scatter keeps slices in order. Passes whose digit is the same for every record are skipped.
+template <typename Record, typename KeyOf>
+void parallel_radix_sort(Record* records, std::size_t count, const KeyOf& key_of) {
+    constexpr unsigned kBits = 11;
+    constexpr std::size_t kBuckets = std::size_t{1} << kBits;
+    constexpr std::size_t kMinSlice = std::size_t{1} << 14;
+    const std::size_t hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    const std::size_t threads = std::clamp<std::size_t>(count / kMinSlice, 1, hardware);
+    const auto slice = [&](std::size_t t) {
+        return std::make_pair(count * t / threads, count * (t + 1) / threads);
+    };
+
+    std::vector<Record> scratch(count);
+    std::vector<std::size_t> offsets(threads * kBuckets);
+    Record* from = records;
+    Record* to = scratch.data();
+    for (unsigned shift = 0; shift < 64; shift += kBits) {
+        const auto digit = [&](const Record& record) {
+            return static_cast<std::size_t>((key_of(record) >> shift) & (kBuckets - 1));
+        };
+        run_parallel(threads, [&](std::size_t t) {
+            std::size_t* counts = offsets.data() + t * kBuckets;
+            std::fill_n(counts, kBuckets, 0);
+            const auto [begin, end] = slice(t);
+            for (std::size_t i = begin; i < end; ++i) {
+                ++counts[digit(from[i])];
+            }
+        });
+        // Exclusive prefix sum by digit, then by thread within a digit
+        std::size_t next = 0;
+        bool one_bucket = false;
+        for (std::size_t d = 0; d < kBuckets; ++d) {
+            const std::size_t bucket_begin = next;
+            for (std::size_t t = 0; t < threads; ++t) {
+                const std::size_t counted = offsets[t * kBuckets + d];
+                offsets[t * kBuckets + d] = next;
+                next += counted;
+            }
+            one_bucket = one_bucket || next - bucket_begin == count;
+        }
+        if (one_bucket) {
+            continue;
+        }
+        run_parallel(threads, [&](std::size_t t) {
+            std::size_t* positions = offsets.data() + t * kBuckets;
+            const auto [begin, end] = slice(t);
+            for (std::size_t i = begin; i < end; ++i) {
+                to[positions[digit(from[i])]++] = from[i];
+            }
+        });
+        std::swap(from, to);
+    }
+    if (from != records) {
+        std::copy(from, from + count, records);
+    }
+}
+
+void sort_numbers(double* values, std::size_t count) {
+    if (count < kParallelSortElements) {
+        std::sort(values, values + count, [](double lhs, double rhs) { return sort_key(lhs) < sort_key(rhs); });
+        return;
+    }
+    parallel_radix_sort(values, count, [](double value) { return sort_key(value); });
+}
+
+}  // namespace
+
+auto array_kernels() -> const ArrayKernels& {
+    static const ArrayKernels* const selected = [] {
+        const std::vector<const ArrayKernels*> supported = supported_array_kernels();
+        return supported.back();
+    }();
+    return *selected;
+}
+
+auto supported_array_kernels() -> std::vector<const ArrayKernels*> {
+    std::vector<const ArrayKernels*> supported{&kScalarKernels};
+#ifdef IMPULSE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2")) {
+        supported.push_back(&kAvx2Kernels);
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        supported.push_back(&kAvx512Kernels);
+    }
+#endif
+    return supported;
+}
+
+auto array_sum(const GcObject& array) -> VmResult {
+    std::vector<double> scratch;
+    const double* elements = unboxed(array, scratch);
+    if (elements == nullptr) {
+        return not_numeric("array_sum");
+    }
+    return number_result(array_kernels().sum(elements, array.array_length()));
+}
+
+auto array_dot(const GcObject& lhs, const GcObject& rhs) -> VmResult {
+    if (lhs.array_length() != rhs.array_length()) {
+        return length_mismatch("array_dot");
+    }
+    std::vector<double> lhs_scratch;
+    std::vector<double> rhs_scratch;
+    const double* left = unboxed(lhs, lhs_scratch);
+    const double* right = unboxed(rhs, rhs_scratch);
+    if (left == nullptr || right == nullptr) {
+        return not_numeric("array_dot");
+    }
+    return number_result(array_kernels().dot(left, right, lhs.array_length()));
+}
+
+auto array_min(const GcObject& array) -> VmResult { return array_extreme<true>(array, "array_min"); }
+
+auto array_max(const GcObject& array) -> VmResult { return array_extreme<false>(array, "array_max"); }
+
+auto array_scale(GcObject& array, double factor) -> VmResult {
+    const std::size_t count = array.array_length();
+    return update_unboxed(array, "array_scale",
+                          [&](double* values) { array_kernels().scale(values, count, factor); });
+}
+
+auto array_axpy(double factor, const GcObject& x, GcObject& y) -> VmResult {
+    if (x.array_length() != y.array_length()) {
+        return length_mismatch("array_axpy");
+    }
+    std::vector<double> scratch;
+    const double* source = unboxed(x, scratch);
+    if (source == nullptr) {
+        return not_numeric("array_axpy");
+    }
+    const std::size_t count = y.array_length();
+    return update_unboxed(y, "array_axpy",
+                          [&](double* values) { array_kernels().axpy(factor, source, values, count); });
+}
+
+auto array_copy(GcObject& destination, const GcObject& source) -> VmResult {
+    if (destination.array_length() != source.array_length()) {
+        return length_mismatch("array_copy");
+    }
+    std::vector<double> scratch;
+    const double* elements = unboxed(source, scratch);
+    if (elements == nullptr) {
+        return not_numeric("array_copy");
+    }
+    if (destination.kind != ObjectKind::Float64Array) {
+        rebox(destination, elements);
+    } else if (destination.array_length() != 0) {
+        // memmove is already vectorised, and copes with an array copied onto itself
+        std::memmove(destination.numbers.data(), elements, destination.array_length() * sizeof(double));
+    }
+    return done();
+}
+
+auto array_fill_number(GcObject& array, double value) -> VmResult {
+    if (array.kind != ObjectKind::Float64Array) {
+        std::fill(array.fields.begin(), array.fields.end(), Value::make_number(value));
+        return done();
+    }
+    // A number never carries the hole bits; guard anyway as GcObject::array_set does
+    const double stored = is_float64_hole(value) ? std::numeric_limits<double>::quiet_NaN() : value;
+    std::fill(array.numbers.begin(), array.numbers.end(), stored);
+    return done();
+}
+
+auto array_sort(GcObject& array) -> VmResult {
+    const std::size_t count = array.array_length();
+    return update_unboxed(array, "array_sort", [&](double* values) { sort_numbers(values, count); });
+}
+
+auto array_sort_order(const GcObject& array, std::vector<double>& order) -> VmResult {
+    std::vector<double> scratch;
+    const double* values = unboxed(array, scratch);
+    if (values == nullptr) {
+        return not_numeric("array_sort_by_index");
+    }
+    const std::size_t count = array.array_length();
+    std::vector<std::size_t> indices(count);
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+    const auto key_of = [values](std::size_t index) { return sort_key(values[index]); };
+    if (count < kParallelSortElements) {
+        std::stable_sort(indices.begin(), indices.end(),
+                         [&](std::size_t lhs, std::size_t rhs) { return key_of(lhs) < key_of(rhs); });
+    } else {
+        parallel_radix_sort(indices.data(), count, key_of);
+    }
+    order.assign(indices.begin(), indices.end());
+    return done();
+}
+
+auto array_binary_search(const GcObject& array, double value) -> VmResult {
+    // Reads elements in place, boxed ones included, so a search stays logarithmic
+    bool numeric = true;
+    const auto key_at = [&](std::size_t index) -> std::uint64_t {
+        if (array.kind == ObjectKind::Float64Array) {
+            return sort_key(array.numbers[index]);
+        }
+        const Value& field = array.fields[index];
+        if (field.is_number()) {
+            return sort_key(field.number);
+        }
+        numeric = numeric && field.is_nil();
+        return sort_key(float64_hole());
+    };
+    const std::uint64_t key = sort_key(value);
+    std::size_t low = 0;
+    std::size_t high = array.array_length();
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (key_at(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    const bool found = low < array.array_length() && key_at(low) == key;
+    if (!numeric) {
+        return not_numeric("array_binary_search");
+    }
+    return number_result(found ? static_cast<double>(low) : -1.0);
+}
+
+}  // namespace impulse::runtime
@@ -0,0 +1,492 @@
+#include "impulse/runtime/bytecode.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "impulse/ir/bounds.h"
+#include "impulse/ir/liveness.h"
+#include "impulse/ir/tail_calls.h"
+
+#include "impulse/runtime/runtime.h"
+#include "impulse/runtime/runtime_utils.h"
+#include "impulse/runtime/ssa_interpreter.h"
+
+namespace impulse::runtime {
+
+namespace {
+
+class BytecodeBuilder {
+public:
+    BytecodeBuilder(const ir::SsaFunction& function, const SsaFrameLayout& layout,
+                    const std::vector<ir::Function>& functions, const std::vector<StructLayout>& structs)
+        : function_(function),
+          layout_(layout),
+          functions_(functions),
+          structs_(structs),
+          bounds_(function, ir::ValueFacts(function)) {}
+
+    auto build() -> SsaBytecode {
+        for (std::size_t index = 0; index < functions_.size(); ++index) {
+            function_index_.emplace(functions_[index].name, static_cast<std::uint32_t>(index));
+        }
+
+        out_.block_start.reserve(function_.blocks.size());
+        for (const auto& block : function_.blocks) {
+            out_.block_start.push_back(static_cast<std::uint32_t>(out_.code.size()));
+            for (std::size_t i = 0; i < block.instructions.size(); ++i) {
+                source_ = static_cast<std::uint32_t>(i);
+                lower(block, block.instructions[i]);
+            }
+
+            // Running off the end of a block continues at its first successor
+            source_ = SsaBytecode::kNoSource;
+            if (!block.successors.empty()) {
+                emit(BytecodeOp::Fallthrough, 0, static_cast<std::uint32_t>(block.successors.front()));
+            } else {
+                fail(VmStatus::RuntimeError, "control flow terminated without return");
+            }
+        }
+        record_live_slots();
+        return std::move(out_);
+    }
+
+private:
+    void emit(BytecodeOp op, std::uint32_t dst = 0, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0) {
+        out_.code.push_back(BytecodeInstruction{op, dst, a, b, c});
+        out_.sources.push_back(source_);
+    }
+
+    [[nodiscard]] static auto is_safepoint(BytecodeOp op) -> bool {
+        return op == BytecodeOp::LoadString || op == BytecodeOp::Add || op == BytecodeOp::Call ||
+               op == BytecodeOp::TailCall || op == BytecodeOp::ArrayMake || op == BytecodeOp::StructMake;
+    }
+
+    // Walks each block backwards from its live-out set, recording what every safepoint still needs
+    void record_live_slots() {
+        const ir::SsaLiveness liveness = ir::compute_liveness(function_);
+        std::vector<std::uint8_t> live(liveness.values.size(), 0);
+        std::vector<std::uint8_t> needed;
+        const auto mark = [&](std::vector<std::uint8_t>& set, const ir::SsaValue& value) {
+            if (const auto id = liveness.find(value)) {
+                set[*id] = 1;
+            }
+        };
+        const auto snapshot = [&](const std::vector<std::uint8_t>& set) -> LiveRange {
+            LiveRange range;
+            range.begin = static_cast<std::uint32_t>(out_.live_slots.size());
+            for (std::size_t id = 0; id < set.size(); ++id) {
+                const std::uint32_t value_slot = slot(liveness.values[id]);
+                if (set[id] != 0 && value_slot != SsaFrameLayout::kNoSlot) {
+                    out_.live_slots.push_back(value_slot);
+                }
+            }
+            range.end = static_cast<std::uint32_t>(out_.live_slots.size());
+            return range;
+        };
+
+        out_.safepoints.assign(out_.code.size(), LiveRange{});
+        out_.block_live.reserve(function_.blocks.size());
+        for (std::size_t b = 0; b < function_.blocks.size(); ++b) {
+            const auto& block = function_.blocks[b];
+            const std::size_t end = b + 1 < out_.block_start.size() ? out_.block_start[b + 1] : out_.code.size();
+            std::vector<std::vector<std::size_t>> safepoints(block.instructions.size());
+            for (std::size_t pc = out_.block_start[b]; pc < end; ++pc) {
+                if (is_safepoint(out_.code[pc].op) && out_.sources[pc] < block.instructions.size()) {
+                    safepoints[out_.sources[pc]].push_back(pc);
+                }
+            }
+
+            std::fill(live.begin(), live.end(), 0);
+            for (const auto id : liveness.live_out[b]) {
+                live[id] = 1;
+            }
+            for (std::size_t i = block.instructions.size(); i-- > 0;) {
+                const auto& inst = block.instructions[i];
+                if (!safepoints[i].empty()) {
+                    needed = live;  // the instruction's own operands stay reachable while it runs
+                    for (const auto& argument : inst.arguments) {
+                        mark(needed, argument);
+                    }
+                    const LiveRange range = snapshot(needed);
+                    for (const auto pc : safepoints[i]) {
+                        out_.safepoints[pc] = range;
+                    }
+                }
+                if (inst.result.has_value()) {
+                    if (const auto id = liveness.find(*inst.result)) {
+                        live[*id] = 0;
+                    }
+                }
+                for (const auto& argument : inst.arguments) {
+                    mark(live, argument);
+                }
+            }
+            for (const auto& phi : block.phi_nodes) {
+                mark(live, phi.result);
+            }
+            out_.block_live.push_back(snapshot(live));
+        }
+    }
+
+    void fail(VmStatus status, std::string message) {
+        emit(BytecodeOp::Fail, 0, static_cast<std::uint32_t>(status), add_string(std::move(message)));
+    }
+
+    auto add_string(std::string text) -> std::uint32_t {
+        out_.strings.push_back(std::move(text));
+        return static_cast<std::uint32_t>(out_.strings.size() - 1);
+    }
+
+    auto add_constant(double value) -> std::uint32_t {
+        for (std::size_t i = 0; i < out_.constants.size(); ++i) {
+            if (out_.constants[i] == value) {
+                return static_cast<std::uint32_t>(i);
+            }
+        }
+        out_.constants.push_back(value);
+        return static_cast<std::uint32_t>(out_.constants.size() - 1);
+    }
+
+    auto add_callee(const std::string& name) -> std::uint32_t {
+        for (std::size_t i = 0; i < out_.callees.size(); ++i) {
+            if (out_.callees[i].name == name) {
+                return static_cast<std::uint32_t>(i);
+            }
+        }
+        BytecodeCallee callee;
+        callee.name = name;
+        // Builtins shadow module functions of the same name
+        callee.builtin = SsaInterpreter::find_builtin(name);
+        if (callee.builtin == BytecodeCallee::kNoBuiltin) {
+            if (const auto it = function_index_.find(name); it != function_index_.end()) {
+                callee.function = it->second;
+            }
+        }
+        out_.callees.push_back(std::move(callee));
+        return static_cast<std::uint32_t>(out_.callees.size() - 1);
+    }
+
+    // Index into out_.structs of the layout named `name`; nullopt for an unknown struct
+    auto add_struct(const std::string& name) -> std::optional<std::uint32_t> {
+        for (std::size_t i = 0; i < out_.structs.size(); ++i) {
+            if (out_.structs[i].name == name) {
+                return static_cast<std::uint32_t>(i);
+            }
+        }
+        const StructLayout* layout = find_struct_layout(structs_, name);
+        if (layout == nullptr) {
+            return std::nullopt;
+        }
+        out_.structs.push_back(*layout);
+        return static_cast<std::uint32_t>(out_.structs.size() - 1);
+    }
+
+    // Resolves the [struct, field] immediates of a field access to its layout and slot
+    auto resolve_field(const ir::SsaInstruction& inst)
+        -> std::optional<std::pair<const StructLayout*, const StructFieldSlot*>> {
+        if (inst.immediates.size() != 2) {
+            fail(VmStatus::ModuleError, inst.opcode + " instruction malformed");
+            return std::nullopt;
+        }
+        const auto index = add_struct(inst.immediates[0]);
+        if (!index.has_value()) {
+            fail(VmStatus::ModuleError, inst.opcode + " on unknown struct '" + inst.immediates[0] + "'");
+            return std::nullopt;
+        }
+        const StructLayout& layout = out_.structs[*index];
+        const StructFieldSlot* field = layout.find(inst.immediates[1]);
+        if (field == nullptr) {
+            fail(VmStatus::ModuleError, "struct '" + layout.name + "' has no field '" + inst.immediates[1] + "'");
+            return std::nullopt;
+        }
+        return std::make_pair(&layout, field);
+    }
+
+    // Symbol 0 version 0 is the invalid value, never a slot
+    [[nodiscard]] auto slot(const ir::SsaValue& value) const -> std::uint32_t {
+        return value.is_valid() ? layout_.slot_of(value) : SsaFrameLayout::kNoSlot;
+    }
+
+    [[nodiscard]] auto result_slot(const ir::SsaInstruction& inst) const -> std::uint32_t {
+        return inst.result.has_value() ? slot(*inst.result) : SsaFrameLayout::kNoSlot;
+    }
+
+    [[nodiscard]] auto resolve_label(const std::string& label) const -> std::uint32_t {
+        const ir::SsaBlock* target = function_.find_block(label);
+        return target != nullptr ? static_cast<std::uint32_t>(target->id) : SsaBytecode::kNoBlock;
+    }
+
+    static auto binary_opcode(ir::BinaryOp op) -> std::optional<BytecodeOp> {
+        switch (op) {
+            case ir::BinaryOp::Add: return BytecodeOp::Add;
+            case ir::BinaryOp::Sub: return BytecodeOp::Sub;
+            case ir::BinaryOp::Mul: return BytecodeOp::Mul;
+            case ir::BinaryOp::Div: return BytecodeOp::Div;
+            case ir::BinaryOp::Mod: return BytecodeOp::Mod;
+            case ir::BinaryOp::Lt: return BytecodeOp::Lt;
+            case ir::BinaryOp::Le: return BytecodeOp::Le;
+            case ir::BinaryOp::Gt: return BytecodeOp::Gt;
+            case ir::BinaryOp::Ge: return BytecodeOp::Ge;
+            case ir::BinaryOp::Eq: return BytecodeOp::Eq;
+            case ir::BinaryOp::Ne: return BytecodeOp::Ne;
+            case ir::BinaryOp::And: return BytecodeOp::And;
+            case ir::BinaryOp::Or: return BytecodeOp::Or;
+            case ir::BinaryOp::Unknown: break;
+        }
+        return std::nullopt;
+    }
+
+    void lower(const ir::SsaBlock& block, const ir::SsaInstruction& inst) {
+        switch (inst.op) {
+            case ir::SsaOpcode::Literal: {
+                if (!inst.result.has_value() || inst.immediates.empty()) {
+                    fail(VmStatus::ModuleError, "literal instruction missing data");
+                    return;
+                }
+                if (!inst.number.has_value()) {
+                    fail(VmStatus::ModuleError, "unable to parse literal operand '" + inst.immediates.front() + "'");
+                    return;
+                }
+                emit(BytecodeOp::LoadNumber, result_slot(inst), add_constant(*inst.number));
+                return;
+            }
+            case ir::SsaOpcode::LiteralString:
+                if (!inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "literal_string instruction missing result");
+                    return;
+                }
+                emit(BytecodeOp::LoadString, result_slot(inst),
+                     add_string(inst.immediates.empty() ? std::string{} : inst.immediates.front()));
+                return;
+            case ir::SsaOpcode::Assign:
+                if (inst.arguments.size() != 1 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "assign instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::Move, result_slot(inst), slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::Drop:
+                if (inst.arguments.size() != 1) {
+                    fail(VmStatus::ModuleError, "drop instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::Drop, 0, slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::Unary: {
+                if (inst.arguments.empty() || inst.immediates.empty() || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "unary instruction malformed");
+                    return;
+                }
+                if (inst.unary_op == ir::UnaryOp::Unknown) {
+                    fail(VmStatus::ModuleError, "unsupported unary operator '" + inst.immediates.front() + "'");
+                    return;
+                }
+                emit(inst.unary_op == ir::UnaryOp::Not ? BytecodeOp::Not : BytecodeOp::Neg, result_slot(inst),
+                     slot(inst.arguments.front()));
+                return;
+            }
+            case ir::SsaOpcode::Binary: {
+                if (inst.arguments.size() < 2 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "binary instruction malformed");
+                    return;
+                }
+                const auto op = binary_opcode(inst.binary_op);
+                if (!op.has_value()) {
+                    const std::string& name = inst.immediates.empty() ? "" : inst.immediates.front();
+                    fail(VmStatus::ModuleError, "unsupported binary operator '" + name + "'");
+                    return;
+                }
+                emit(*op, result_slot(inst), slot(inst.arguments[0]), slot(inst.arguments[1]));
+                return;
+            }
+            case ir::SsaOpcode::Return:
+                if (inst.arguments.empty()) {
+                    fail(VmStatus::RuntimeError, "return instruction requires a value");
+                    return;
+                }
+                emit(BytecodeOp::Return, 0, slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::Branch: {
+                if (inst.immediates.empty()) {
+                    fail(VmStatus::ModuleError, "branch instruction missing label");
+                    return;
+                }
+                const std::uint32_t target = resolve_label(inst.immediates.front());
+                if (target == SsaBytecode::kNoBlock) {
+                    fail(VmStatus::ModuleError, "branch to undefined label '" + inst.immediates.front() + "'");
+                    return;
+                }
+                emit(BytecodeOp::Jump, 0, target);
+                return;
+            }
+            case ir::SsaOpcode::BranchIf: {
+                if (inst.arguments.empty() || inst.immediates.empty()) {
+                    fail(VmStatus::ModuleError, "branch_if instruction malformed");
+                    return;
+                }
+                const std::uint32_t target = resolve_label(inst.immediates.front());
+                if (target == SsaBytecode::kNoBlock) {
+                    fail(VmStatus::ModuleError, "branch_if to undefined label '" + inst.immediates.front() + "'");
+                    return;
+                }
+                if (inst.immediates.size() >= 2 && !inst.number.has_value()) {
+                    fail(VmStatus::ModuleError, "branch_if comparison value '" + inst.immediates[1] + "' invalid");
+                    return;
+                }
+                const double compare = inst.number.value_or(0.0);
+                std::uint32_t fallthrough = SsaBytecode::kNoBlock;
+                for (const auto succ : block.successors) {
+                    if (succ != target) {
+                        fallthrough = static_cast<std::uint32_t>(succ);
+                        break;
+                    }
+                }
+                emit(BytecodeOp::JumpIf, add_constant(compare), slot(inst.arguments.front()), target, fallthrough);
+                return;
+            }
+            case ir::SsaOpcode::Call: {
+                if (inst.immediates.size() < 2 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "call instruction malformed");
+                    return;
+                }
+                std::size_t arg_count = 0;
+                try {
+                    arg_count = static_cast<std::size_t>(std::stoull(inst.immediates[1]));
+                } catch (...) {
+                    fail(VmStatus::ModuleError, "call argument count '" + inst.immediates[1] + "' invalid");
+                    return;
+                }
+                if (inst.arguments.size() != arg_count) {
+                    fail(VmStatus::ModuleError, "call argument mismatch");
+                    return;
+                }
+                const auto first = static_cast<std::uint32_t>(out_.operands.size());
+                for (const auto& arg : inst.arguments) {
+                    out_.operands.push_back(slot(arg));
+                }
+                emit(ir::is_tail_call(block, source_) ? BytecodeOp::TailCall : BytecodeOp::Call, result_slot(inst),
+                     first, static_cast<std::uint32_t>(arg_count), add_callee(inst.immediates[0]));
+                return;
+            }
+            case ir::SsaOpcode::ArrayMake:
+                if (inst.arguments.size() != 1 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_make instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::ArrayMake, result_slot(inst), slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::ArrayGet:
+                if (inst.arguments.size() != 2 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_get instruction malformed");
+                    return;
+                }
+                emit(bounds_.in_bounds(inst) ? BytecodeOp::ArrayGetInBounds : BytecodeOp::ArrayGet,
+                     result_slot(inst), slot(inst.arguments[0]), slot(inst.arguments[1]));
+                return;
+            case ir::SsaOpcode::ArraySet:
+                if (inst.arguments.size() != 3 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_set instruction malformed");
+                    return;
+                }
+                emit(bounds_.in_bounds(inst) ? BytecodeOp::ArraySetInBounds : BytecodeOp::ArraySet,
+                     result_slot(inst), slot(inst.arguments[0]), slot(inst.arguments[1]), slot(inst.arguments[2]));
+                return;
+            case ir::SsaOpcode::ArrayLength:
+                if (inst.arguments.size() != 1 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_length instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::ArrayLength, result_slot(inst), slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::ArrayPush:
+                if (inst.arguments.size() != 2 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_push instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::ArrayPush, result_slot(inst), slot(inst.arguments[0]), slot(inst.arguments[1]));
+                return;
+            case ir::SsaOpcode::ArrayPop:
+                if (inst.arguments.size() != 1 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "array_pop instruction malformed");
+                    return;
+                }
+                emit(BytecodeOp::ArrayPop, result_slot(inst), slot(inst.arguments.front()));
+                return;
+            case ir::SsaOpcode::StructMake: {
+                if (inst.immediates.empty() || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "struct_make instruction malformed");
+                    return;
+                }
+                const auto index = add_struct(inst.immediates[0]);
+                if (!index.has_value()) {
+                    fail(VmStatus::ModuleError, "struct_make of unknown struct '" + inst.immediates[0] + "'");
+                    return;
+                }
+                if (inst.arguments.size() != out_.structs[*index].fields.size()) {
+                    fail(VmStatus::ModuleError, "struct_make argument mismatch");
+                    return;
+                }
+                const auto first = static_cast<std::uint32_t>(out_.operands.size());
+                for (const auto& arg : inst.arguments) {
+                    out_.operands.push_back(slot(arg));
+                }
+                emit(BytecodeOp::StructMake, result_slot(inst), *index, first);
+                return;
+            }
+            case ir::SsaOpcode::FieldGet: {
+                if (inst.arguments.size() != 1 || !inst.result.has_value()) {
+                    fail(VmStatus::ModuleError, "field_get instruction malformed");
+                    return;
+                }
+                const auto resolved = resolve_field(inst);
+                if (!resolved.has_value()) {
+                    return;
+                }
+                const auto [layout, field] = *resolved;
+                emit(field->numeric ? BytecodeOp::FieldGetNumber : BytecodeOp::FieldGetValue, result_slot(inst),
+                     slot(inst.arguments[0]), layout->shape, field->slot);
+                return;
+            }
+            case ir::SsaOpcode::FieldSet: {
+                if (inst.arguments.size() != 2) {
+                    fail(VmStatus::ModuleError, "field_set instruction malformed");
+                    return;
+                }
+                const auto resolved = resolve_field(inst);
+                if (!resolved.has_value()) {
+                    return;
+                }
+                const auto [layout, field] = *resolved;
+                emit(field->numeric ? BytecodeOp::FieldSetNumber : BytecodeOp::FieldSetValue,
+                     slot(inst.arguments[1]), slot(inst.arguments[0]), layout->shape, field->slot);
+                return;
+            }
+            case ir::SsaOpcode::Unknown:
+                break;
+        }
+        fail(VmStatus::ModuleError, "unsupported SSA opcode '" + inst.opcode + "'");
+    }
+
+    const ir::SsaFunction& function_;
+    const SsaFrameLayout& layout_;
+    const std::vector<ir::Function>& functions_;
+    const std::vector<StructLayout>& structs_;
+    ir::ArrayBounds bounds_;
+    std::unordered_map<std::string, std::uint32_t> function_index_;
+    std::uint32_t source_ = SsaBytecode::kNoSource;
+    SsaBytecode out_;
+};
+
+}  // namespace
+
+auto compile_bytecode(const ir::SsaFunction& function, const SsaFrameLayout& layout,
+                      const std::vector<ir::Function>& functions, const std::vector<StructLayout>& structs)
+    -> SsaBytecode {
+    return BytecodeBuilder(function, layout, functions, structs).build();
+}
+
+}  // namespace impulse::runtime
@@ -0,0 +1,343 @@
+#include "impulse/runtime/code_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "impulse/ir/printer.h"
+#include "impulse/ir/serialize.h"
+#include "impulse/runtime/value.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace impulse::runtime {
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x43504D49;  // "IMPC"
+// Bump whenever the file layout, the SSA encoding or the code generator changes
+constexpr std::uint32_t kFormatVersion = 10;
+// Magic, format version, key and the payload's digest
+constexpr std::size_t kHeaderBytes = 24;
+
+class Fnv1a {
+public:
+    void bytes(const void* data, std::size_t size) {
+        const auto* begin = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ begin[i]) * 0x100000001B3ULL;
+        }
+    }
+
+    template <typename T>
+    void value(const T& value) {
+        bytes(&value, sizeof(value));
+    }
+
+    void text(std::string_view text) {
+        value(text.size());
+        bytes(text.data(), text.size());
+    }
+
+    [[nodiscard]] auto digest() const -> std::uint64_t { return hash_; }
+
+private:
+    std::uint64_t hash_ = 0xCBF29CE484222325ULL;
+};
+
+void write_function(const std::string& name, const PersistedFunction& function, ir::BinaryWriter& out) {
+    out.string(name);
+    out.string(function.ssa);
+    out.u8(function.jit_checked ? 1 : 0);
+    out.u8(function.can_jit ? 1 : 0);
+    out.string(function.code);
+    out.u64(function.relocations.size());
+    for (const auto& relocation : function.relocations) {
+        out.u32(relocation.offset);
+        out.u8(static_cast<std::uint8_t>(relocation.kind));
+        out.u64(relocation.addend);
+    }
+}
+
+// Length-prefixed bytes as a view into the input
+[[nodiscard]] auto read_view(ir::BinaryReader& in) -> std::string_view {
+    const std::uint64_t size = in.u64();
+    if (size > in.remaining()) {
+        in.fail();
+        return {};
+    }
+    return in.bytes(static_cast<std::size_t>(size));
+}
+
+[[nodiscard]] auto read_function(ir::BinaryReader& in, PersistedFunction& function) -> bool {
+    function.ssa = read_view(in);
+    function.jit_checked = in.u8() != 0;
+    function.can_jit = in.u8() != 0;
+    function.code = read_view(in);
+    const std::uint64_t relocation_count = in.u64();
+    if (relocation_count > in.remaining()) {
+        return false;
+    }
+    function.relocations.resize(static_cast<std::size_t>(relocation_count));
+    for (auto& relocation : function.relocations) {
+        relocation.offset = in.u32();
+        const std::uint8_t kind = in.u8();
+        if (kind > static_cast<std::uint8_t>(jit::JitRelocationKind::Global)) {
+            return false;
+        }
+        relocation.kind = static_cast<jit::JitRelocationKind>(kind);
+        relocation.addend = in.u64();
+    }
+    return in.ok();
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef __linux__
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* memory = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory != MAP_FAILED) {
+            mapped_ = memory;
+            size_ = static_cast<std::size_t>(info.st_size);
+        }
+    }
+    close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+        fallback_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef __linux__
+    if (mapped_ != nullptr) {
+        munmap(mapped_, size_);
+    }
+#endif
+}
+
+auto MappedFile::contents() const -> std::string_view {
+    if (mapped_ != nullptr) {
+        return {static_cast<const char*>(mapped_), size_};
+    }
+    return fallback_;
+}
+
+auto code_cache_key(const ir::Module& module, const jit::JitArrayLayout& arrays,
+                    const ir::OptimizationOptions& passes, const std::vector<StructLayout>& structs) -> std::uint64_t {
+    Fnv1a hash;
+    hash.value(kFormatVersion);
+    hash.value(sizeof(Value));
+    hash.value(arrays.available);
+    for (const std::int32_t offset : {arrays.object_kind, arrays.numbers_begin, arrays.numbers_end,
+                                      arrays.elements_begin, arrays.elements_end, arrays.element_size,
+                                      arrays.value_kind, arrays.value_number, arrays.value_object,
+                                      arrays.object_shape, arrays.struct_numbers}) {
+        hash.value(offset);
+    }
+    hash.value(arrays.array_kind);
+    hash.value(arrays.float64_kind);
+    hash.value(arrays.number_kind);
+    hash.value(arrays.hole_bits);
+    hash.value(arrays.struct_kind);
+    // Compiled field accesses embed the shape and slot of the field
+    for (const auto& layout : structs) {
+        hash.value(layout.name.size());
+        hash.bytes(layout.name.data(), layout.name.size());
+        hash.value(layout.shape);
+        for (const auto& field : layout.fields) {
+            hash.value(field.name.size());
+            hash.bytes(field.name.data(), field.name.size());
+            hash.value(field.numeric);
+            hash.value(field.slot);
+        }
+    }
+    const std::string_view target = jit::JitCompiler::target();
+    hash.bytes(target.data(), target.size());
+    hash.value(jit::JitCompiler::uses_sse41());
+    hash.value(jit::JitCompiler::uses_avx2());
+    for (const bool enabled : {passes.fold_calls, passes.inlining, passes.tail_calls, passes.constant_propagation,
+                               passes.copy_propagation, passes.value_numbering, passes.loop_invariant_code_motion,
+                               passes.strength_reduction, passes.scalar_replacement, passes.dead_code_elimination}) {
+        hash.value(enabled);
+    }
+    const std::string printed = ir::print_module(module);
+    hash.bytes(printed.data(), printed.size());
+    return hash.digest();
+}
+
+auto function_hashes(const ir::Module& module) -> std::vector<std::uint64_t> {
+    std::unordered_map<std::string_view, std::size_t> indices;
+    std::vector<std::uint64_t> own;
+    own.reserve(module.functions.size());
+    for (const auto& function : module.functions) {
+        indices.emplace(function.name, own.size());
+        Fnv1a hash;
+        hash.text(function.name);
+        hash.value(function.parameters.size());
+        for (const auto& parameter : function.parameters) {
+            hash.text(parameter.name);
+            hash.text(parameter.type);
+        }
+        hash.value(function.return_type.has_value());
+        hash.text(function.return_type.value_or(""));
+        hash.value(function.blocks.size());
+        for (const auto& block : function.blocks) {
+            hash.text(block.label);
+            hash.value(block.instructions.size());
+            for (const auto& inst : block.instructions) {
+                hash.value(inst.kind);
+                hash.value(inst.operands.size());
+                for (const auto& operand : inst.operands) {
+                    hash.text(operand);
+                }
+            }
+        }
+        own.push_back(hash.digest());
+    }
+
+    // Fold in every function reachable through calls, in module order
+    std::vector<std::uint64_t> hashes;
+    hashes.reserve(own.size());
+    for (std::size_t root = 0; root < own.size(); ++root) {
+        std::vector<bool> reached(own.size(), false);
+        std::vector<std::size_t> work{root};
+        reached[root] = true;
+        while (!work.empty()) {
+            const std::size_t index = work.back();
+            work.pop_back();
+            for (const auto& block : module.functions[index].blocks) {
+                for (const auto& inst : block.instructions) {
+                    if (inst.kind != ir::InstructionKind::Call || inst.operands.empty()) {
+                        continue;
+                    }
+                    const auto callee = indices.find(inst.operands.front());
+                    if (callee != indices.end() && !reached[callee->second]) {
+                        reached[callee->second] = true;
+                        work.push_back(callee->second);
+                    }
+                }
+            }
+        }
+        Fnv1a hash;
+        hash.value(root);
+        for (std::size_t index = 0; index < own.size(); ++index) {
+            if (reached[index]) {
+                hash.value(own[index]);
+            }
+        }
+        hashes.push_back(hash.digest());
+    }
+    return hashes;
+}
+
+auto code_cache_path(const std::string& directory, std::uint64_t key) -> std::string {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        name[static_cast<std::size_t>(i)] = kHex[key & 0xF];
+        key >>= 4;
+    }
+    return (std::filesystem::path{directory} / (name + ".impc")).string();
+}
+
+auto read_code_cache(const std::string& path, std::uint64_t key) -> std::optional<PersistedModule> {
+    PersistedModule persisted;
+    persisted.file = std::make_unique<MappedFile>(path);
+    const std::string_view contents = persisted.file->contents();
+    ir::BinaryReader in(contents);
+    if (in.u32() != kMagic || in.u32() != kFormatVersion || in.u64() != key || !in.ok()) {
+        return std::nullopt;
+    }
+    // The machine code in the payload is executed as it is, so a flipped bit must not get that far
+    const std::uint64_t digest = in.u64();
+    if (!in.ok() || contents.size() < kHeaderBytes) {
+        return std::nullopt;
+    }
+    Fnv1a payload;
+    payload.bytes(contents.data() + kHeaderBytes, contents.size() - kHeaderBytes);
+    if (payload.digest() != digest) {
+        return std::nullopt;
+    }
+
+    const std::uint64_t count = in.u64();
+    if (count > in.remaining()) {
+        return std::nullopt;
+    }
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::string name = in.string();
+        PersistedFunction function;
+        if (!read_function(in, function)) {
+            return std::nullopt;
+        }
+        persisted.functions[std::move(name)] = std::move(function);
+    }
+    if (!in.ok() || in.remaining() != 0) {
+        return std::nullopt;
+    }
+    return persisted;
+}
+
+auto write_code_cache(const std::string& path, std::uint64_t key,
+                      const std::unordered_map<std::string, PersistedFunction>& functions) -> bool {
+    std::string payload;
+    ir::BinaryWriter body(payload);
+    body.u64(functions.size());
+    for (const auto& [name, function] : functions) {
+        write_function(name, function, body);
+    }
+    Fnv1a digest;
+    digest.bytes(payload.data(), payload.size());
+
+    std::string contents;
+    ir::BinaryWriter out(contents);
+    out.u32(kMagic);
+    out.u32(kFormatVersion);
+    out.u64(key);
+    out.u64(digest.digest());
+    contents += payload;
+
+    std::error_code error;
+    const std::filesystem::path target{path};
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), error);
+    }
+    std::string temporary = path + ".tmp";
+#ifdef __linux__
+    temporary += std::to_string(getpid());  // concurrent writers of one key each finish a whole file
+#endif
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace impulse::runtime
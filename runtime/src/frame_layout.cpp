@@ -0,0 +1,102 @@
+#include "impulse/runtime/frame_layout.h"
+
+#include <algorithm>
+
+namespace impulse::runtime {
+
+auto build_frame_layout(const ir::SsaFunction& function, const std::vector<ir::FunctionParameter>& parameters)
+    -> SsaFrameLayout {
+    SsaFrameLayout layout;
+
+    // Reserve versions 0..max for every symbol: parameters start at version 1, and version 0
+    // names a symbol defined outside the function
+    ir::SymbolId max_symbol = 0;
+    for (const auto& symbol : function.symbols) {
+        max_symbol = std::max(max_symbol, symbol.id);
+    }
+    std::vector<std::uint32_t> max_version(static_cast<std::size_t>(max_symbol) + 1, 1);
+    const auto note = [&](const ir::SsaValue& value) {
+        if (value.symbol >= max_version.size()) {
+            max_version.resize(static_cast<std::size_t>(value.symbol) + 1, 1);
+        }
+        max_version[value.symbol] = std::max(max_version[value.symbol], value.version);
+    };
+    std::vector<bool> read_by_name(max_version.size(), false);
+    const auto note_read = [&](const ir::SsaValue& value) {
+        note(value);
+        if (value.version == 0) {
+            if (value.symbol >= read_by_name.size()) {
+                read_by_name.resize(static_cast<std::size_t>(value.symbol) + 1, false);
+            }
+            read_by_name[value.symbol] = true;
+        }
+    };
+    for (const auto& block : function.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            note(phi.result);
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    note_read(*input.value);
+                }
+            }
+        }
+        for (const auto& inst : block.instructions) {
+            for (const auto& arg : inst.arguments) {
+                note_read(arg);
+            }
+            if (inst.result.has_value()) {
+                note(*inst.result);
+            }
+        }
+    }
+
+    read_by_name.resize(max_version.size(), false);
+    std::vector<const ir::SsaSymbol*> symbols(max_version.size(), nullptr);
+    for (const auto& symbol : function.symbols) {
+        symbols[symbol.id] = &symbol;
+    }
+
+    layout.symbol_base.resize(max_version.size());
+    layout.symbol_versions.resize(max_version.size());
+    for (std::size_t symbol = 0; symbol < max_version.size(); ++symbol) {
+        const ir::SsaSymbol* info = symbols[symbol];
+        layout.symbol_base[symbol] = static_cast<std::uint32_t>(layout.slots.size());
+        layout.symbol_versions[symbol] = max_version[symbol] + 1;
+        for (std::uint32_t version = 0; version <= max_version[symbol]; ++version) {
+            SsaFrameLayout::Slot slot;
+            slot.value = ir::SsaValue{static_cast<ir::SymbolId>(symbol), version};
+            if (info != nullptr) {
+                slot.name = info->name;
+                // Only version 0 reads look at the locals map, so only symbols read that way are mirrored
+                slot.mirror_local = version <= 1 && read_by_name[symbol] && !info->name.empty() &&
+                                    info->name.front() != '%';
+            }
+            layout.slots.push_back(std::move(slot));
+        }
+    }
+
+    layout.blocks.resize(function.blocks.size());
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+        const auto& block = function.blocks[b];
+        auto& resolved = layout.blocks[b];
+        for (const auto& phi : block.phi_nodes) {
+            SsaFrameLayout::Phi entry;
+            entry.result = layout.slot_of(phi.result);
+            for (const auto& input : phi.inputs) {
+                if (input.value.has_value()) {
+                    entry.inputs.emplace_back(input.predecessor, layout.slot_of(*input.value));
+                }
+            }
+            resolved.phis.push_back(std::move(entry));
+        }
+    }
+
+    for (const auto& parameter : parameters) {
+        const ir::SsaSymbol* symbol = function.find_symbol(parameter.name);
+        layout.parameters.push_back(symbol != nullptr ? layout.slot_of(ir::SsaValue{symbol->id, 1})
+                                                      : SsaFrameLayout::kNoSlot);
+    }
+    return layout;
+}
+
+}  // namespace impulse::runtime
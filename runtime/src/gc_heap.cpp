@@ -1,103 +1,672 @@
 #include "impulse/runtime/gc_heap.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 namespace impulse::runtime {
 
+static_assert((GcPage::kBytes - GcPage::kHeaderBytes) / sizeof(GcObject) <= GcPage::kMaxCells,
+              "the smallest cells must fit a page's mark bitmap");
+
+namespace {
+
+// Fields one parallel marking task traces; longer arrays are split so threads can share them
+constexpr std::size_t kMarkSlice = 4096;
+
+struct MarkTask {
+    GcObject* object = nullptr;
+    std::size_t begin = 0;
+};
+
+// Gray work of one collector thread: the owner pushes and pops at the back, others steal from the
+// front
+struct MarkDeque {
+    std::mutex mutex;
+    std::deque<MarkTask> tasks;
+};
+
+[[nodiscard]] auto try_mark(GcObject* object) -> bool {
+    return object != nullptr && GcPage::of(object)->try_mark(object->cell);
+}
+
+// Calls work(index) for index in [0, count) with the calling thread doing index 0
+template <typename Work>
+void run_on_threads(std::size_t count, const Work& work) {
+    std::vector<std::thread> pool;
+    pool.reserve(count - 1);
+    for (std::size_t i = 1; i < count; ++i) {
+        pool.emplace_back([&work, i] { work(i); });
+    }
+    work(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// Counters have a single writer, the heap's thread, so a plain load and store cannot lose counts
+template <typename T>
+void add(std::atomic<T>& counter, std::uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + static_cast<T>(amount), std::memory_order_relaxed);
+}
+
+}  // namespace
+
 GcHeap::GcHeap() = default;
 
 GcHeap::~GcHeap() {
-    GcObject* current = objects_;
-    while (current != nullptr) {
-        GcObject* next = current->next;
-        delete current;
-        current = next;
+    for (GcObject* object = young_; object != nullptr;) {
+        GcObject* next = object->next;
+        free_object(object);
+        object = next;
+    }
+    for (GcObject* object : old_) {
+        free_object(object);
+    }
+    for (std::size_t i = unswept_next_; i < unswept_.size(); ++i) {
+        free_object(unswept_[i]);
+    }
+    for (const auto& [text, object] : interned_) {
+        free_object(object);
     }
 }
 
 auto GcHeap::allocate_array(std::size_t length, const Value& fill) -> GcObject* {
-    auto* object = new GcObject();
-    object->kind = ObjectKind::Array;
-    object->marked = false;
+    GcObject* object = new_object(ObjectKind::Array, length * sizeof(Value));
     object->fields.resize(length, fill);
-    object->next = objects_;
-    objects_ = object;
+    link(object);
+    return object;
+}
 
-    bytes_allocated_ += sizeof(GcObject) + (length * sizeof(Value));
+auto GcHeap::allocate_float64_array(std::size_t length) -> GcObject* {
+    GcObject* object = new_object(ObjectKind::Float64Array, length * sizeof(double));
+    object->numbers.resize(length, float64_hole());
+    link(object);
     return object;
 }
 
+auto GcHeap::allocate_struct(std::uint32_t shape, std::size_t numeric, std::size_t boxed) -> GcObject* {
+    GcObject* object = new_object(ObjectKind::Struct, (numeric * sizeof(double)) + (boxed * sizeof(Value)));
+    object->shape = shape;
+    auto* payload = reinterpret_cast<unsigned char*>(object + 1);
+    object->numbers.use_inline(payload, numeric * sizeof(double));
+    object->numbers.resize(numeric, 0.0);
+    object->fields.use_inline(payload + (numeric * sizeof(double)), object->inline_bytes - (numeric * sizeof(double)));
+    object->fields.resize(boxed);
+    link(object);
+    return object;
+}
+
+auto GcHeap::allocate_string(std::string text) -> GcObject* {
+    GcObject* object = new_object(ObjectKind::String, 0);
+    object->text = std::move(text);
+    object->chars = object->text.data();
+    object->length = object->text.size();
+    link(object);
+    return object;
+}
+
+auto GcHeap::intern_string(std::string_view text) -> GcObject* {
+    if (const auto found = interned_.find(text); found != interned_.end()) {
+        return found->second;
+    }
+    GcObject* object = new_object(ObjectKind::String, 0);
+    object->text.assign(text);
+    object->chars = object->text.data();
+    object->length = object->text.size();
+    object->old = true;
+    set_marked(object, true);  // so no collection traces or frees it
+    object->accounted_bytes = object->footprint();
+    interned_bytes_ += object->accounted_bytes;
+    bytes_allocated_ += object->accounted_bytes;
+    interned_.emplace(std::string_view(object->chars, object->length), object);
+    return object;
+}
+
+auto GcHeap::concat_strings(GcObject* left, GcObject* right) -> GcObject* {
+    if (right->length == 0) {
+        return left;
+    }
+    if (left->length == 0) {
+        return right;
+    }
+    if (left->length + right->length < kMinRopeBytes) {
+        std::string combined{left->contents()};
+        combined.append(right->contents());
+        return allocate_string(std::move(combined));
+    }
+    GcObject* rope = new_object(ObjectKind::String, 2 * sizeof(Value));
+    rope->length = left->length + right->length;
+    rope->fields.push_back(Value::make_string(left));
+    rope->fields.push_back(Value::make_string(right));
+    link(rope);
+    record_write(rope, rope->fields[0]);  // a rope allocated black must not hide unmarked parts
+    record_write(rope, rope->fields[1]);
+    return rope;
+}
+
+auto GcHeap::slice_string(GcObject* text, std::size_t start, std::size_t count) -> GcObject* {
+    if (start == 0 && count == text->length) {
+        return text;
+    }
+    const std::string_view contents = text->contents();
+    if (count <= std::string().capacity()) {
+        return allocate_string(std::string(contents.substr(start, count)));
+    }
+    // A slice of a slice views the same flat string
+    GcObject* base = text->fields.empty() ? text : text->fields[0].object;
+    GcObject* slice = new_object(ObjectKind::String, sizeof(Value));
+    slice->chars = contents.data() + start;
+    slice->length = count;
+    slice->fields.push_back(Value::make_string(base));
+    link(slice);
+    record_write(slice, slice->fields[0]);
+    return slice;
+}
+
+// Ropes built by concatenation in a loop are deep on one side, so the parts are walked with an
+// explicit stack rather than recursively
+auto GcObject::flatten() -> std::string_view {
+    std::string flat;
+    flat.reserve(length);
+    std::vector<GcObject*> pending = {this};
+    while (!pending.empty()) {
+        GcObject* part = pending.back();
+        pending.pop_back();
+        if (part->chars != nullptr) {
+            flat.append(part->chars, part->length);
+        } else {
+            pending.push_back(part->fields[1].object);
+            pending.push_back(part->fields[0].object);
+        }
+    }
+    text = std::move(flat);
+    chars = text.data();
+    fields.clear();
+    return {chars, length};
+}
+
+auto GcHeap::new_object(ObjectKind kind, std::size_t payload_bytes) -> GcObject* {
+    if (sweeping()) {
+        sweep_lazily(kSweepPerAllocation);
+    }
+    std::size_t index = 0;
+    while (index < kClassCount && kSizeClasses[index] < payload_bytes) {
+        ++index;
+    }
+    GcPage* page = nullptr;
+    void* storage = nullptr;
+    if (index == kClassCount) {
+        page = allocate_page(sizeof(GcObject) + payload_bytes, 1);
+        page->size_class = kLargeClass;
+        storage = page->cell(0);
+    } else {
+        payload_bytes = kSizeClasses[index];
+        SizeClass& size_class = classes_[index];
+        if (size_class.free != nullptr) {
+            storage = size_class.free;
+            size_class.free = size_class.free->next;
+            page = GcPage::of(storage);
+        } else {
+            if (size_class.page == nullptr || size_class.used == size_class.page->cell_count) {
+                const std::size_t cell_bytes = sizeof(GcObject) + payload_bytes;
+                pages_.emplace_back(allocate_page(cell_bytes, (GcPage::kBytes - GcPage::kHeaderBytes) / cell_bytes));
+                size_class.page = pages_.back().get();
+                size_class.page->size_class = static_cast<std::uint8_t>(index);
+                size_class.used = 0;
+            }
+            page = size_class.page;
+            storage = page->cell(size_class.used++);
+        }
+    }
+    auto* object = new (storage) GcObject();
+    object->kind = kind;
+    object->cell = static_cast<std::uint16_t>(
+        (static_cast<unsigned char*>(storage) - static_cast<unsigned char*>(page->cell(0))) / page->cell_bytes);
+    object->inline_bytes = static_cast<std::uint32_t>(payload_bytes);
+    if (payload_bytes != 0 && kind != ObjectKind::Struct) {  // allocate_struct splits its payload
+        void* elements = object + 1;
+        if (kind == ObjectKind::Float64Array) {
+            object->numbers.use_inline(elements, payload_bytes);
+        } else {
+            object->fields.use_inline(elements, payload_bytes);
+        }
+    }
+    set_marked(object, marking_);  // allocated black: the cycle in progress keeps it
+    return object;
+}
+
+auto GcHeap::allocate_page(std::size_t cell_bytes, std::size_t cell_count) -> GcPage* {
+    const std::size_t bytes = cell_count == 1 ? GcPage::kHeaderBytes + cell_bytes : GcPage::kBytes;
+    auto* page = new (::operator new(bytes, std::align_val_t{GcPage::kBytes})) GcPage();
+    page->cell_bytes = static_cast<std::uint32_t>(cell_bytes);
+    page->cell_count = static_cast<std::uint32_t>(cell_count);
+    return page;
+}
+
+void GcHeap::PageDeleter::operator()(GcPage* page) const {
+    std::destroy_at(page);
+    ::operator delete(static_cast<void*>(page), std::align_val_t{GcPage::kBytes});
+}
+
+void GcHeap::free_object(GcObject* object) {
+    add(counters_.objects_freed, 1);
+    add(counters_.bytes_freed, object->accounted_bytes);
+    std::destroy_at(object);
+    release_cell(object);
+}
+
+void GcHeap::release_cell(GcObject* object) {
+    GcPage* page = GcPage::of(object);
+    if (page->size_class == kLargeClass) {
+        PageDeleter{}(page);
+        return;
+    }
+    SizeClass& size_class = classes_[page->size_class];
+    size_class.free = new (static_cast<void*>(object)) FreeCell{size_class.free};
+}
+
+void GcHeap::link(GcObject* object) {
+    object->next = young_;
+    young_ = object;
+    object->accounted_bytes = 0;
+    account(object);
+}
+
+void GcHeap::account(GcObject* object) {
+    const std::size_t bytes = object->footprint();
+    bytes_allocated_ = bytes_allocated_ - std::min(bytes_allocated_, object->accounted_bytes) + bytes;
+    if (!object->old) {
+        young_bytes_ = young_bytes_ - std::min(young_bytes_, object->accounted_bytes) + bytes;
+    }
+    object->accounted_bytes = bytes;
+}
+
+void GcHeap::write_barrier(GcObject* object, const Value& value) {
+    GcObject* child = value.heap_object();
+    if (marking_ && object->marked()) {
+        mark_object(child, false);  // a traced object must not hide an untraced one
+    }
+    if (object->old && !object->remembered && child != nullptr && !child->old) {
+        object->remembered = true;
+        remembered_.push_back(object);
+    }
+}
+
 void GcHeap::collect(const std::vector<Value*>& roots) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t bytes_before = bytes_allocated_;
+    sweep_lazily(std::numeric_limits<std::size_t>::max());
+    if (marking_) {
+        // Start over rather than keep what an interrupted cycle marked
+        marking_ = false;
+        mark_stack_.clear();
+        for (GcObject* object = young_; object != nullptr; object = object->next) {
+            set_marked(object, false);
+        }
+        for (GcObject* object : old_) {
+            set_marked(object, false);
+        }
+    }
+    if (collector_threads_ > 1 && bytes_allocated_ >= kParallelMinBytes) {
+        parallel_mark(roots);
+    } else {
+        mark_roots(roots, false);
+    }
+    clear_remembered();  // before sweeping: remembered objects may be unreachable
+    const std::size_t old_bytes = sweep_old();
+    bytes_allocated_ = interned_bytes_ + old_bytes + sweep_young();
+
+    next_gc_threshold_ = paced_threshold(bytes_allocated_);
+    add(counters_.full_collections, 1);
+    end_pause(start, bytes_before);
+}
+
+void GcHeap::collect_minor(const std::vector<Value*>& roots) {
+    if (marking_) {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t bytes_before = bytes_allocated_;
+    mark_roots(roots, true);
+    for (GcObject* object : remembered_) {
+        for (const auto& field : object->fields) {
+            mark_object(field.heap_object(), true);
+        }
+    }
+    drain_mark_stack(true);
+    clear_remembered();
+    const std::size_t old_bytes = bytes_allocated_ - std::min(bytes_allocated_, young_bytes_);
+    bytes_allocated_ = old_bytes + sweep_young();
+    add(counters_.minor_collections, 1);
+    end_pause(start, bytes_before);
+    adapt_nursery(last_pause_);
+}
+
+void GcHeap::start_marking(const std::vector<Value*>& roots) {
+    const auto start = std::chrono::steady_clock::now();
+    sweep_lazily(std::numeric_limits<std::size_t>::max());
+    marking_ = true;
     for (Value* root : roots) {
         if (root != nullptr) {
-            mark_value(*root);
+            mark_object(root->heap_object(), false);
         }
     }
+    end_pause(start, bytes_allocated_);
+}
 
-    // Sweep now calculates bytes_allocated_ internally to avoid second pass
-    sweep();
+auto GcHeap::mark_step() -> bool {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t budget = incremental() ? pacing_.mark_budget : std::numeric_limits<std::size_t>::max();
+    for (std::size_t traced = 0; traced < budget && !mark_stack_.empty(); ++traced) {
+        GcObject* current = mark_stack_.back();
+        mark_stack_.pop_back();
+        for (const auto& field : current->fields) {
+            mark_object(field.heap_object(), false);
+        }
+    }
+    end_pause(start, bytes_allocated_);
+    return mark_stack_.empty();
+}
 
-    next_gc_threshold_ = std::max(bytes_allocated_ * std::size_t{2}, default_threshold());
+void GcHeap::finish_marking(const std::vector<Value*>& roots) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t bytes_before = bytes_allocated_;
+    // Roots are not behind a barrier, so whatever they gained since start_marking is traced now
+    mark_roots(roots, false);
+    marking_ = false;
+    clear_remembered();
+    unswept_.swap(old_);
+    unswept_next_ = 0;
+    const std::size_t old_bytes = bytes_allocated_ - std::min(bytes_allocated_, young_bytes_);
+    bytes_allocated_ = old_bytes + sweep_young();
+    // No new cycle until this one's garbage is gone
+    next_gc_threshold_ = sweeping() ? std::numeric_limits<std::size_t>::max() : paced_threshold(bytes_allocated_);
+    add(counters_.full_collections, 1);
+    end_pause(start, bytes_before);
+}
+
+void GcHeap::sweep_step() {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t bytes_before = bytes_allocated_;
+    sweep_lazily(incremental() ? pacing_.mark_budget : std::numeric_limits<std::size_t>::max());
+    end_pause(start, bytes_before);
+}
+
+// Sweeps up to `budget` old objects left by finish_marking; survivors move back to old_
+void GcHeap::sweep_lazily(std::size_t budget) {
+    if (!sweeping()) {
+        return;
+    }
+    for (; unswept_next_ < unswept_.size() && budget != 0; --budget) {
+        GcObject* object = unswept_[unswept_next_++];
+        if (!object->marked()) {
+            bytes_allocated_ -= std::min(bytes_allocated_, object->accounted_bytes);
+            free_object(object);
+            continue;
+        }
+        set_marked(object, false);
+        old_.push_back(object);
+    }
+    if (!sweeping()) {
+        unswept_.clear();
+        unswept_next_ = 0;
+        next_gc_threshold_ = paced_threshold(bytes_allocated_);
+    }
 }
 
 void GcHeap::set_next_gc_threshold(std::size_t bytes) {
     next_gc_threshold_ = bytes;
 }
 
-void GcHeap::mark_value(const Value& value) {
-    if (!value.is_object() || value.object == nullptr) {
+void GcHeap::set_pacing(const GcPacing& pacing) {
+    pacing_ = pacing;
+    if (!marking_ && !sweeping()) {
+        next_gc_threshold_ = paced_threshold(bytes_allocated_);
+    }
+    if (pacing_.max_pause.count() == 0) {
+        nursery_limit_ = nursery_bytes();
+    }
+}
+
+auto GcHeap::paced_threshold(std::size_t live) const -> std::size_t {
+    const double grown = static_cast<double>(live) * std::max(pacing_.growth, 1.0);
+    std::size_t threshold = std::max(static_cast<std::size_t>(grown), pacing_.min_threshold);
+    if (pacing_.limit != 0) {
+        // Over the limit with live data alone, collecting on every allocation would not help
+        threshold = std::max(std::min(threshold, pacing_.limit), live + kMinNurseryBytes);
+    }
+    return threshold;
+}
+
+void GcHeap::adapt_nursery(std::chrono::nanoseconds pause) {
+    if (pacing_.max_pause.count() == 0) {
         return;
     }
-    mark_object(value.object);
+    if (pause > pacing_.max_pause) {
+        nursery_limit_ = std::max(nursery_limit_ / 2, kMinNurseryBytes);
+    } else if (pause < pacing_.max_pause / 4) {
+        nursery_limit_ = std::min(nursery_limit_ * 2, nursery_bytes());
+    }
 }
 
-void GcHeap::mark_object(GcObject* object) {
-    if (object == nullptr || object->marked) {
+void GcHeap::mark_roots(const std::vector<Value*>& roots, bool young_only) {
+    for (Value* root : roots) {
+        if (root != nullptr) {
+            mark_object(root->heap_object(), young_only);
+        }
+    }
+    drain_mark_stack(young_only);
+}
+
+void GcHeap::mark_object(GcObject* object, bool young_only) {
+    if (object == nullptr || object->marked() || (young_only && object->old)) {
         return;
     }
+    set_marked(object, true);
+    mark_stack_.push_back(object);
+}
+
+void GcHeap::drain_mark_stack(bool young_only) {
+    while (!mark_stack_.empty()) {
+        GcObject* current = mark_stack_.back();
+        mark_stack_.pop_back();
+        for (const auto& field : current->fields) {
+            mark_object(field.heap_object(), young_only);
+        }
+    }
+}
 
-    std::vector<GcObject*> worklist;
-    worklist.push_back(object);
+// Marks everything reachable from `roots` on collector_threads_ threads. `pending` counts tasks
+// queued or being traced: a task queues its children before it stops counting, so marking is
+// done once it drops to zero.
+void GcHeap::parallel_mark(const std::vector<Value*>& roots) {
+    const std::size_t threads = collector_threads_;
+    std::vector<MarkDeque> deques(threads);
+    std::atomic<std::size_t> pending{0};
+    std::size_t next = 0;
+    for (Value* root : roots) {
+        GcObject* object = root != nullptr ? root->heap_object() : nullptr;
+        if (try_mark(object)) {
+            deques[next++ % threads].tasks.push_back(MarkTask{object, 0});
+        }
+    }
+    pending.store(next, std::memory_order_relaxed);
 
-    while (!worklist.empty()) {
-        GcObject* current = worklist.back();
-        worklist.pop_back();
-        if (current == nullptr || current->marked) {
-            continue;
+    const auto take = [&](std::size_t self, MarkTask& task) {
+        for (std::size_t i = 0; i < threads; ++i) {
+            MarkDeque& deque = deques[(self + i) % threads];
+            const std::lock_guard<std::mutex> lock(deque.mutex);
+            if (!deque.tasks.empty()) {
+                if (i == 0) {
+                    task = deque.tasks.back();
+                    deque.tasks.pop_back();
+                } else {
+                    task = deque.tasks.front();
+                    deque.tasks.pop_front();
+                }
+                return true;
+            }
         }
-        current->marked = true;
-        for (auto& field : current->fields) {
-            if (field.is_object() && field.object != nullptr && !field.object->marked) {
-                worklist.push_back(field.object);
+        return false;
+    };
+    run_on_threads(threads, [&](std::size_t self) {
+        std::vector<MarkTask> found;
+        MarkTask task;
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (!take(self, task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            const GcBuffer<Value>& fields = task.object->fields;
+            const std::size_t end = std::min(fields.size(), task.begin + kMarkSlice);
+            if (end < fields.size()) {
+                found.push_back(MarkTask{task.object, end});
+            }
+            for (std::size_t i = task.begin; i < end; ++i) {
+                GcObject* child = fields[i].heap_object();
+                if (try_mark(child)) {
+                    found.push_back(MarkTask{child, 0});
+                }
+            }
+            if (!found.empty()) {
+                pending.fetch_add(found.size(), std::memory_order_relaxed);
+                MarkDeque& own = deques[self];
+                const std::lock_guard<std::mutex> lock(own.mutex);
+                own.tasks.insert(own.tasks.end(), found.begin(), found.end());
+                found.clear();
             }
+            pending.fetch_sub(1, std::memory_order_acq_rel);
         }
+    });
+}
+
+// Frees unmarked young objects and promotes the rest; returns the promoted bytes
+auto GcHeap::sweep_young() -> std::size_t {
+    std::size_t promoted_bytes = 0;
+    while (young_ != nullptr) {
+        GcObject* object = young_;
+        young_ = object->next;
+        if (!object->marked()) {
+            free_object(object);
+            continue;
+        }
+        set_marked(object, false);
+        object->old = true;
+        object->next = nullptr;
+        old_.push_back(object);
+        object->accounted_bytes = object->footprint();
+        promoted_bytes += object->accounted_bytes;
     }
+    young_bytes_ = 0;
+    add(counters_.bytes_promoted, promoted_bytes);
+    return promoted_bytes;
 }
 
-void GcHeap::sweep() {
-    GcObject** current = &objects_;
+// Frees unmarked old objects; returns the live old bytes. Each thread compacts its own range of
+// old_ and destroys the garbage in it; the slots are returned to the free list afterwards.
+auto GcHeap::sweep_old() -> std::size_t {
+    struct Range {
+        std::size_t begin = 0;
+        std::size_t end = 0;  // of the survivors once swept
+        std::size_t live_bytes = 0;
+        std::size_t dead_bytes = 0;
+        std::vector<GcObject*> dead;
+    };
+    const bool parallel = collector_threads_ > 1 && bytes_allocated_ >= kParallelMinBytes;
+    std::vector<Range> ranges(parallel ? std::max<std::size_t>(std::min(collector_threads_, old_.size()), 1) : 1);
+    const std::size_t step = (old_.size() + ranges.size() - 1) / ranges.size();
+    run_on_threads(ranges.size(), [&](std::size_t index) {
+        Range& range = ranges[index];
+        range.begin = std::min(index * step, old_.size());
+        const std::size_t end = std::min(range.begin + step, old_.size());
+        range.end = range.begin;
+        for (std::size_t i = range.begin; i < end; ++i) {
+            GcObject* object = old_[i];
+            if (!object->marked()) {
+                range.dead_bytes += object->accounted_bytes;
+                std::destroy_at(object);
+                range.dead.push_back(object);
+                continue;
+            }
+            object->accounted_bytes = object->footprint();
+            range.live_bytes += object->accounted_bytes;
+            GcPage::of(object)->unmark(object->cell);  // other ranges may share the bitmap word
+            old_[range.end++] = object;
+        }
+    });
+
+    std::size_t kept = 0;
     std::size_t live_bytes = 0;
-    while (*current != nullptr) {
-        if (!(*current)->marked) {
-            GcObject* unreached = *current;
-            *current = unreached->next;
-            delete unreached;
-        } else {
-            // Track live bytes during sweep to avoid second pass
-            live_bytes += sizeof(GcObject) + ((*current)->fields.size() * sizeof(Value));
-            (*current)->marked = false;
-            current = &((*current)->next);
+    for (const Range& range : ranges) {
+        if (kept != range.begin) {
+            const auto first = old_.begin() + static_cast<std::ptrdiff_t>(range.begin);
+            std::move(first, first + static_cast<std::ptrdiff_t>(range.end - range.begin),
+                      old_.begin() + static_cast<std::ptrdiff_t>(kept));
+        }
+        kept += range.end - range.begin;
+        live_bytes += range.live_bytes;
+        add(counters_.objects_freed, range.dead.size());
+        add(counters_.bytes_freed, range.dead_bytes);
+        for (GcObject* object : range.dead) {
+            release_cell(object);
         }
     }
-    bytes_allocated_ = live_bytes;
+    old_.resize(kept);
+    return live_bytes;
+}
+
+void GcHeap::clear_remembered() {
+    // Every surviving young object is promoted by either collection, so nothing stays remembered
+    for (GcObject* object : remembered_) {
+        object->remembered = false;
+    }
+    remembered_.clear();
 }
 
 auto GcHeap::bytes_allocated() const -> std::size_t { return bytes_allocated_; }
 
+void GcHeap::end_pause(std::chrono::steady_clock::time_point start, std::size_t bytes) {
+    last_pause_ = std::chrono::steady_clock::now() - start;
+    add(counters_.pauses, 1);
+    add(counters_.total_pause_ns, last_pause_.count());
+    if (last_pause_.count() > counters_.max_pause_ns.load(std::memory_order_relaxed)) {
+        counters_.max_pause_ns.store(last_pause_.count(), std::memory_order_relaxed);
+    }
+    counters_.live_bytes.store(bytes_allocated_, std::memory_order_relaxed);
+    if (bytes > counters_.peak_bytes.load(std::memory_order_relaxed)) {
+        counters_.peak_bytes.store(bytes, std::memory_order_relaxed);
+    }
+}
+
+auto GcHeap::stats() const -> GcStats {
+    GcStats stats;
+    stats.full_collections = counters_.full_collections.load(std::memory_order_relaxed);
+    stats.minor_collections = counters_.minor_collections.load(std::memory_order_relaxed);
+    stats.pauses = counters_.pauses.load(std::memory_order_relaxed);
+    stats.total_pause = std::chrono::nanoseconds{counters_.total_pause_ns.load(std::memory_order_relaxed)};
+    stats.max_pause = std::chrono::nanoseconds{counters_.max_pause_ns.load(std::memory_order_relaxed)};
+    stats.objects_freed = counters_.objects_freed.load(std::memory_order_relaxed);
+    stats.bytes_freed = counters_.bytes_freed.load(std::memory_order_relaxed);
+    stats.bytes_promoted = counters_.bytes_promoted.load(std::memory_order_relaxed);
+    stats.live_bytes = counters_.live_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = counters_.peak_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
 auto GcHeap::live_object_count() const -> std::size_t {
-    std::size_t count = 0;
-    for (GcObject* object = objects_; object != nullptr; object = object->next) {
+    std::size_t count = interned_.size() + old_.size() + (unswept_.size() - unswept_next_);
+    for (GcObject* object = young_; object != nullptr; object = object->next) {
         ++count;
     }
     return count;
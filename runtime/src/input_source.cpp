@@ -0,0 +1,117 @@
+#include "impulse/runtime/input_source.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+#include "impulse/runtime/code_cache.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace impulse::runtime {
+
+auto InputSource::open_file(const std::string& path) -> std::unique_ptr<InputSource> {
+    auto stream = std::make_unique<std::ifstream>(path, std::ios::binary);
+    if (!stream->is_open()) {
+        return nullptr;
+    }
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error)) {
+        std::unique_ptr<InputSource> source(new InputSource());
+        source->file_ = std::make_unique<MappedFile>(path);
+        source->window_ = source->file_->contents();
+        return source;
+    }
+    // Pipes and devices cannot be mapped
+    auto source = std::make_unique<InputSource>(*stream);
+    source->owned_stream_ = std::move(stream);
+    return source;
+}
+
+InputSource::InputSource(std::istream& stream, std::size_t chunk_bytes) : stream_(&stream), chunk_(chunk_bytes) {}
+
+InputSource::InputSource(int fd, std::size_t chunk_bytes) : fd_(fd), chunk_(chunk_bytes) {
+#ifndef __linux__
+    if (fd == 0) {
+        stream_ = &std::cin;
+        fd_ = -1;
+    }
+#endif
+}
+
+InputSource::InputSource(std::string text) : text_(std::move(text)) { window_ = text_; }
+
+InputSource::~InputSource() = default;
+
+auto InputSource::next_line() -> std::optional<std::string_view> {
+    std::size_t end = window_.find('\n');
+    if (end != std::string_view::npos) {
+        const std::string_view line = window_.substr(0, end);
+        window_.remove_prefix(end + 1);
+        return line;
+    }
+    // The line runs past the window: gather it from the chunks that follow
+    carry_.assign(window_);
+    window_ = {};
+    while (refill()) {
+        end = window_.find('\n');
+        if (end != std::string_view::npos) {
+            carry_.append(window_.substr(0, end));
+            window_.remove_prefix(end + 1);
+            return std::string_view(carry_);
+        }
+        carry_.append(window_);
+        window_ = {};
+    }
+    if (carry_.empty()) {
+        return std::nullopt;
+    }
+    return std::string_view(carry_);
+}
+
+auto InputSource::read_all() -> std::string_view {
+    if (stream_ == nullptr && fd_ < 0) {
+        const std::string_view rest = window_;
+        window_ = {};
+        return rest;
+    }
+    carry_.assign(window_);
+    window_ = {};
+    while (refill()) {
+        carry_.append(window_);
+        window_ = {};
+    }
+    return carry_;
+}
+
+auto InputSource::refill() -> bool {
+    std::size_t count = 0;
+    if (stream_ != nullptr) {
+        stream_->read(chunk_.data(), static_cast<std::streamsize>(chunk_.size()));
+        count = static_cast<std::size_t>(stream_->gcount());
+        if (stream_->eof()) {
+            stream_->clear();  // as with std::getline, input appended later is still read
+        }
+    }
+#ifdef __linux__
+    else if (fd_ >= 0) {
+        ssize_t done = 0;
+        do {
+            done = ::read(fd_, chunk_.data(), chunk_.size());
+        } while (done < 0 && errno == EINTR);
+        count = done > 0 ? static_cast<std::size_t>(done) : 0;
+    }
+#endif
+    if (count == 0) {
+        return false;
+    }
+    window_ = std::string_view(chunk_.data(), count);
+    return true;
+}
+
+}  // namespace impulse::runtime
@@ -0,0 +1,126 @@
+#include "impulse/runtime/output_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace impulse::runtime {
+
+OutputSink::OutputSink(int fd, std::size_t buffer_bytes) : fd_(fd), capacity_(std::max<std::size_t>(buffer_bytes, 1)) {
+    buffer_.reserve(capacity_);
+}
+
+OutputSink::OutputSink(Callback callback, std::size_t buffer_bytes)
+    : callback_(std::move(callback)), capacity_(std::max<std::size_t>(buffer_bytes, 1)) {
+    buffer_.reserve(capacity_);
+}
+
+OutputSink::~OutputSink() { flush(); }
+
+void OutputSink::write(std::string_view text, std::string_view suffix) {
+    const std::size_t size = text.size() + suffix.size();
+    if (size == 0) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(mutex_);
+    written_ += size;
+    last_ = suffix.empty() ? text.back() : suffix.back();
+    if (buffer_.size() + size <= capacity_) {
+        buffer_.append(text);
+        buffer_.append(suffix);
+        if (buffer_.size() == capacity_) {
+            deliver({}, {});
+        }
+        return;
+    }
+    deliver(text, suffix);
+}
+
+void OutputSink::flush() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (!buffer_.empty()) {
+        deliver({}, {});
+    }
+}
+
+auto OutputSink::bytes_written() const -> std::size_t {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+auto OutputSink::at_line_start() const -> bool {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return last_ == '\n';
+}
+
+auto OutputSink::ok() const -> bool {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return !failed_;
+}
+
+void OutputSink::deliver(std::string_view text, std::string_view suffix) {
+    const std::string_view pieces[] = {buffer_, text, suffix};
+    if (callback_) {
+        for (const std::string_view piece : pieces) {
+            if (!piece.empty()) {
+                callback_(piece);
+            }
+        }
+        buffer_.clear();
+        return;
+    }
+    if (failed_) {
+        buffer_.clear();
+        return;
+    }
+#ifdef __linux__
+    iovec vectors[3];
+    int count = 0;
+    for (const std::string_view piece : pieces) {
+        if (!piece.empty()) {
+            vectors[count++] = iovec{const_cast<char*>(piece.data()), piece.size()};
+        }
+    }
+    iovec* next = vectors;
+    while (count != 0) {
+        const ssize_t done = ::writev(fd_, next, count);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed_ = true;
+            break;
+        }
+        // Skip what was written, possibly stopping inside a piece
+        auto remaining = static_cast<std::size_t>(done);
+        while (count != 0 && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            ++next;
+            --count;
+        }
+        if (count != 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+            next->iov_len -= remaining;
+        }
+    }
+#else
+    // Without writev only the standard streams can be written
+    std::FILE* stream = fd_ == 2 ? stderr : stdout;
+    for (const std::string_view piece : pieces) {
+        if (!piece.empty() && std::fwrite(piece.data(), 1, piece.size(), stream) != piece.size()) {
+            failed_ = true;
+            break;
+        }
+    }
+    std::fflush(stream);
+#endif
+    buffer_.clear();
+}
+
+}  // namespace impulse::runtime
@@ -0,0 +1,299 @@
+#include "impulse/runtime/profile_export.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+namespace impulse::runtime {
+
+namespace {
+
+void write_json_string(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+// Trace-event timestamps are microseconds; three decimals keep the nanoseconds
+void write_microseconds(std::ostream& out, std::chrono::nanoseconds time) {
+    const auto ns = time.count();
+    char text[32];
+    std::snprintf(text, sizeof(text), "%s%lld.%03lld", ns < 0 ? "-" : "", static_cast<long long>(std::abs(ns) / 1000),
+                  static_cast<long long>(std::abs(ns) % 1000));
+    out << text;
+}
+
+[[nodiscard]] auto event_category(ProfileEvent::Kind kind) -> const char* {
+    switch (kind) {
+    case ProfileEvent::Kind::Call:
+        return "call";
+    case ProfileEvent::Kind::Gc:
+        return "gc";
+    case ProfileEvent::Kind::Compile:
+        return "compile";
+    }
+    return "call";
+}
+
+// Protocol buffer wire format, enough for profile.proto: varints and length-delimited fields
+class ProtoWriter {
+public:
+    void varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            bytes_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes_.push_back(static_cast<char>(value));
+    }
+
+    void field(std::uint32_t number, std::uint64_t value) {
+        varint(static_cast<std::uint64_t>(number) << 3);
+        varint(value);
+    }
+
+    void field(std::uint32_t number, std::string_view value) {
+        varint((static_cast<std::uint64_t>(number) << 3) | 2);
+        varint(value.size());
+        bytes_.append(value.data(), value.size());
+    }
+
+    void packed(std::uint32_t number, const std::vector<std::uint64_t>& values) {
+        ProtoWriter payload;
+        for (const std::uint64_t value : values) {
+            payload.varint(value);
+        }
+        field(number, payload.bytes());
+    }
+
+    [[nodiscard]] auto bytes() const -> const std::string& { return bytes_; }
+
+private:
+    std::string bytes_;
+};
+
+class StringTable {
+public:
+    StringTable() { intern(""); }  // index 0 is the empty string
+
+    auto intern(const std::string& text) -> std::uint64_t {
+        const auto [it, inserted] = indices_.emplace(text, strings_.size());
+        if (inserted) {
+            strings_.push_back(text);
+        }
+        return it->second;
+    }
+
+    [[nodiscard]] auto strings() const -> const std::vector<std::string>& { return strings_; }
+
+private:
+    std::unordered_map<std::string, std::uint64_t> indices_;
+    std::vector<std::string> strings_;
+};
+
+}  // namespace
+
+auto parse_profile_format(std::string_view name) -> std::optional<ProfileFormat> {
+    if (name == "json") {
+        return ProfileFormat::Json;
+    }
+    if (name == "chrome") {
+        return ProfileFormat::ChromeTrace;
+    }
+    if (name == "pprof") {
+        return ProfileFormat::Pprof;
+    }
+    return std::nullopt;
+}
+
+void write_profile(const ProfileReport& report, ProfileFormat format, std::ostream& out) {
+    switch (format) {
+    case ProfileFormat::Json:
+        write_profile_json(report, out);
+        break;
+    case ProfileFormat::ChromeTrace:
+        write_chrome_trace(report, out);
+        break;
+    case ProfileFormat::Pprof:
+        write_pprof(report, out);
+        break;
+    }
+}
+
+void write_profile_json(const ProfileReport& report, std::ostream& out) {
+    out << "{\n  \"functions\": [";
+    for (std::size_t i = 0; i < report.functions.size(); ++i) {
+        const auto& function = report.functions[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        write_json_string(out, function.function);
+        out << ", \"calls\": " << function.calls << ", \"total_ns\": " << function.total.count()
+            << ", \"min_ns\": " << function.min.count() << ", \"max_ns\": " << function.max.count()
+            << ", \"avg_ns\": " << (function.calls != 0 ? function.total.count() / static_cast<std::int64_t>(function.calls) : 0)
+            << ", \"tier\": ";
+        write_json_string(out, function.tier);
+        out << ", \"compile_ns\": " << function.compile_time.count() << '}';
+    }
+    out << (report.functions.empty() ? "]" : "\n  ]");
+
+    std::uint64_t pauses = 0;
+    std::chrono::nanoseconds pause_total{0};
+    std::chrono::nanoseconds pause_max{0};
+    for (const auto& event : report.events) {
+        if (event.kind == ProfileEvent::Kind::Gc) {
+            ++pauses;
+            pause_total += event.duration;
+            pause_max = std::max(pause_max, event.duration);
+        }
+    }
+    out << ",\n  \"gc\": {\"pauses\": " << pauses << ", \"total_ns\": " << pause_total.count()
+        << ", \"max_ns\": " << pause_max.count() << "},\n  \"events\": " << report.events.size()
+        << ",\n  \"dropped_events\": " << report.dropped_events << "\n}\n";
+}
+
+void write_chrome_trace(const ProfileReport& report, std::ostream& out) {
+    out << "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": \"" << report.dropped_events
+        << "\"},\n\"traceEvents\": [";
+    for (std::size_t i = 0; i < report.events.size(); ++i) {
+        const auto& event = report.events[i];
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\": ";
+        write_json_string(out, event.name);
+        out << ", \"cat\": \"" << event_category(event.kind) << "\", \"ph\": \"X\", \"ts\": ";
+        write_microseconds(out, event.start);
+        out << ", \"dur\": ";
+        write_microseconds(out, event.duration);
+        out << ", \"pid\": 1, \"tid\": " << event.thread << '}';
+    }
+    out << "\n]}\n";
+}
+
+void write_pprof(const ProfileReport& report, std::ostream& out) {
+    // Rebuild each thread's call stacks from how its spans nest: a span starting inside an open
+    // one ran under it. Outer spans sort first among those starting together.
+    std::map<std::uint32_t, std::vector<const ProfileEvent*>> threads;
+    std::chrono::nanoseconds end_of_profile{0};
+    for (const auto& event : report.events) {
+        threads[event.thread].push_back(&event);
+        end_of_profile = std::max(end_of_profile, event.start + event.duration);
+    }
+
+    StringTable strings;
+    std::unordered_map<std::string, std::uint64_t> function_ids;  // also the location ids
+    const auto function_id = [&](const ProfileEvent& event) {
+        const std::string name = event.kind == ProfileEvent::Kind::Call ? event.name
+                                 : event.kind == ProfileEvent::Kind::Gc ? "[" + event.name + "]"
+                                                                        : "[compile " + event.name + "]";
+        return function_ids.emplace(name, function_ids.size() + 1).first->second;
+    };
+
+    struct Totals {
+        std::uint64_t count = 0;
+        std::int64_t self_ns = 0;
+    };
+    std::map<std::vector<std::uint64_t>, Totals> samples;  // leaf-first stacks
+    for (auto& [thread, events] : threads) {
+        std::sort(events.begin(), events.end(), [](const ProfileEvent* lhs, const ProfileEvent* rhs) {
+            return lhs->start != rhs->start ? lhs->start < rhs->start : lhs->duration > rhs->duration;
+        });
+        struct Open {
+            const ProfileEvent* event;
+            std::uint64_t function;
+            std::chrono::nanoseconds children{0};
+        };
+        std::vector<Open> stack;
+        const auto close = [&]() {
+            const Open& top = stack.back();
+            std::vector<std::uint64_t> frames;
+            for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+                frames.push_back(it->function);
+            }
+            Totals& totals = samples[frames];
+            totals.count++;
+            totals.self_ns += std::max<std::int64_t>(0, (top.event->duration - top.children).count());
+            stack.pop_back();
+        };
+        for (const ProfileEvent* event : events) {
+            while (!stack.empty() && stack.back().event->start + stack.back().event->duration <= event->start) {
+                close();
+            }
+            if (!stack.empty()) {
+                stack.back().children += event->duration;
+            }
+            stack.push_back(Open{event, function_id(*event)});
+        }
+        while (!stack.empty()) {
+            close();
+        }
+    }
+
+    ProtoWriter profile;
+    for (const char* type : {"calls", "time"}) {
+        ProtoWriter value_type;
+        value_type.field(1, strings.intern(type));
+        value_type.field(2, strings.intern(std::string_view{type} == "calls" ? "count" : "nanoseconds"));
+        profile.field(1, value_type.bytes());
+    }
+    for (const auto& [frames, totals] : samples) {
+        ProtoWriter sample;
+        sample.packed(1, frames);
+        sample.packed(2, {totals.count, static_cast<std::uint64_t>(totals.self_ns)});
+        profile.field(2, sample.bytes());
+    }
+    std::vector<std::pair<std::uint64_t, const std::string*>> functions;
+    for (const auto& [name, id] : function_ids) {
+        functions.emplace_back(id, &name);
+    }
+    std::sort(functions.begin(), functions.end());
+    for (const auto& [id, name] : functions) {
+        ProtoWriter line;
+        line.field(1, id);
+        ProtoWriter location;
+        location.field(1, id);
+        location.field(4, line.bytes());
+        profile.field(4, location.bytes());
+    }
+    for (const auto& [id, name] : functions) {
+        const std::uint64_t index = strings.intern(*name);
+        ProtoWriter function;
+        function.field(1, id);
+        function.field(2, index);
+        function.field(3, index);
+        profile.field(5, function.bytes());
+    }
+    ProtoWriter period_type;
+    period_type.field(1, strings.intern("time"));
+    period_type.field(2, strings.intern("nanoseconds"));
+    for (const auto& text : strings.strings()) {
+        profile.field(6, text);
+    }
+    profile.field(10, static_cast<std::uint64_t>(end_of_profile.count()));  // duration_nanos
+    profile.field(11, period_type.bytes());
+    out.write(profile.bytes().data(), static_cast<std::streamsize>(profile.bytes().size()));
+}
+
+}  // namespace impulse::runtime
@@ -1,126 +1,690 @@
 #include "impulse/runtime/runtime.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <istream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "impulse/ir/dump.h"
+#include "impulse/ir/inliner.h"
 #include "impulse/ir/interpreter.h"
+#include "impulse/ir/liveness.h"
 #include "impulse/ir/optimizer.h"
+#include "impulse/ir/purity.h"
+#include "impulse/ir/serialize.h"
+#include "impulse/ir/tail_calls.h"
 #include "impulse/jit/jit.h"
+#include "impulse/jit/object_file.h"
+#include "impulse/runtime/array_kernels.h"
 #include "impulse/runtime/runtime_utils.h"
 #include "impulse/runtime/ssa_interpreter.h"
+#include "impulse/runtime/trace_writer.h"
 
 namespace impulse::runtime {
 
 class FrameGuard {
 public:
-    FrameGuard(const Vm& vm, std::unordered_map<std::string, Value>& locals, std::vector<Value>& stack)
-        : vm_(vm) {
-        vm_.push_frame(locals, stack);
-    }
+    explicit FrameGuard(Vm::ExecutionContext& context) : context_(context), frame_(context.acquire_frame()) {}
 
     FrameGuard(const FrameGuard&) = delete;
     auto operator=(const FrameGuard&) -> FrameGuard& = delete;
 
-    ~FrameGuard() { vm_.pop_frame(); }
+    ~FrameGuard() { context_.release_frame(); }
+
+    [[nodiscard]] auto frame() const -> InterpreterFrame& { return frame_; }
 
 private:
-    const Vm& vm_;
+    Vm::ExecutionContext& context_;
+    InterpreterFrame& frame_;
 };
 
-// Check if an SSA function can be JIT compiled
-// JIT supports: literal, binary (with +, -, *, /, %, <, <=, >, >=, ==, !=, &&, ||), unary (-, !), assign, return
-// JIT also supports: branch, branch_if (control flow), phi nodes (via SSA deconstruction)
-// It does not support: call, array operations, string operations, globals
-[[nodiscard]] static auto can_jit_compile(const ir::SsaFunction& ssa, const std::vector<std::string>& parameter_names) -> bool {
-    if (!jit::JitCompiler::is_supported()) {
-        return false;
+thread_local Vm::ExecutionContext* Vm::active_context_ = nullptr;
+
+// Relaxed increment of a counter other threads may bump too; a lost update only delays tiering
+static auto bump(std::atomic<std::uint64_t>& counter) -> std::uint64_t {
+    const std::uint64_t value = counter.load(std::memory_order_relaxed) + 1;
+    counter.store(value, std::memory_order_relaxed);
+    return value;
+}
+
+[[nodiscard]] static auto is_numeric_type(const std::string& type) -> bool {
+    return type == "int" || type == "float" || type == "bool";
+}
+
+// Types compiled code carries as object pointers: arrays and the module's structs
+[[nodiscard]] static auto is_array_type(const std::string& type, const std::vector<StructLayout>& structs) -> bool {
+    return type == "array" || find_struct_layout(structs, type) != nullptr;
+}
+
+// SSA values of `ssa` that hold array or struct objects: parameters of those types, the extra
+// `seeds`, and everything copied from them
+[[nodiscard]] static auto find_array_values(const ir::SsaFunction& ssa, const ir::Function& function,
+                                            const std::vector<StructLayout>& structs,
+                                            const std::vector<ir::SsaValue>& seeds = {})
+    -> std::unordered_set<std::uint64_t> {
+    std::unordered_set<std::string> array_params;
+    for (const auto& param : function.parameters) {
+        if (is_array_type(param.type, structs)) {
+            array_params.insert(param.name);
+        }
+    }
+    std::unordered_set<std::uint64_t> arrays;
+    for (const auto& seed : seeds) {
+        arrays.insert(ir::encode_ssa_value(seed));
+    }
+    if (arrays.empty() && array_params.empty()) {
+        return arrays;
     }
-    
-    // Build set of parameter symbol names
-    std::unordered_set<std::string> param_names_set(parameter_names.begin(), parameter_names.end());
-    
-    // Build set of parameter symbol IDs
-    std::unordered_set<ir::SymbolId> param_symbol_ids;
     for (const auto& symbol : ssa.symbols) {
-        if (param_names_set.find(symbol.name) != param_names_set.end()) {
-            param_symbol_ids.insert(symbol.id);
+        if (array_params.find(symbol.name) != array_params.end()) {
+            arrays.insert(ir::encode_ssa_value(ir::SsaValue{symbol.id, 0}));
+            arrays.insert(ir::encode_ssa_value(ir::SsaValue{symbol.id, 1}));
         }
     }
-    
-    // Supported binary operators
-    const std::unordered_set<std::string> supported_binary_ops = {
-        "+", "-", "*", "/", "%", "<", "<=", ">", ">=", "==", "!=", "&&", "||"
+
+    const auto is_array = [&](const ir::SsaValue& value) {
+        return arrays.find(ir::encode_ssa_value(value)) != arrays.end();
     };
-    
-    // Check that function has a return statement
-    // Phi nodes are now supported via SSA deconstruction
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& block : ssa.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                const bool any_array = std::any_of(phi.inputs.begin(), phi.inputs.end(), [&](const auto& input) {
+                    return input.value.has_value() && is_array(*input.value);
+                });
+                if (any_array) {
+                    changed = arrays.insert(ir::encode_ssa_value(phi.result)).second || changed;
+                }
+            }
+            for (const auto& inst : block.instructions) {
+                if (inst.op == ir::SsaOpcode::Assign && !inst.arguments.empty() && inst.result.has_value() &&
+                    is_array(inst.arguments[0])) {
+                    changed = arrays.insert(ir::encode_ssa_value(*inst.result)).second || changed;
+                }
+                // Array natives that return the array they updated
+                if (inst.op == ir::SsaOpcode::Call && !inst.immediates.empty() && inst.result.has_value()) {
+                    const jit::JitNativeSignature* native = jit::find_jit_native(inst.immediates[0]);
+                    if (native != nullptr && native->returned_argument >= 0 &&
+                        static_cast<std::size_t>(native->returned_argument) < inst.arguments.size() &&
+                        is_array(inst.arguments[static_cast<std::size_t>(native->returned_argument)])) {
+                        changed = arrays.insert(ir::encode_ssa_value(*inst.result)).second || changed;
+                    }
+                }
+            }
+        }
+    }
+    return arrays;
+}
+
+// Array values cross into compiled code as the object pointer bits in a double slot
+[[nodiscard]] static auto array_to_jit_arg(GcObject* object) -> double {
+    const auto bits = reinterpret_cast<std::uintptr_t>(object);
+    static_assert(sizeof(bits) <= sizeof(double), "object pointers must fit a JIT argument slot");
+    double slot = 0.0;
+    std::memcpy(&slot, &bits, sizeof(bits));
+    return slot;
+}
+
+[[nodiscard]] static auto array_from_jit_arg(double slot) -> Value {
+    std::uintptr_t bits = 0;
+    std::memcpy(&bits, &slot, sizeof(bits));
+    auto* object = reinterpret_cast<GcObject*>(bits);
+    return object != nullptr ? Value::make_object(object) : Value::make_nil();
+}
+
+// Offsets, from `base`, of the begin and end pointers inside a live, non-empty buffer. They are
+// found by probing, since GcBuffer keeps them private.
+template <typename T>
+[[nodiscard]] static auto probe_vector_pointers(const GcBuffer<T>& vector, const unsigned char* base)
+    -> std::optional<std::pair<int32_t, int32_t>> {
+    const auto begin_bits = reinterpret_cast<std::uintptr_t>(vector.data());
+    const auto end_bits = reinterpret_cast<std::uintptr_t>(vector.data() + vector.size());
+    std::optional<int32_t> begin;
+    std::optional<int32_t> end;
+    const auto* vector_bytes = reinterpret_cast<const unsigned char*>(&vector);
+    for (std::size_t offset = 0; offset + sizeof(std::uintptr_t) <= sizeof(vector); offset += sizeof(std::uintptr_t)) {
+        std::uintptr_t word = 0;
+        std::memcpy(&word, vector_bytes + offset, sizeof(word));
+        const auto position = static_cast<int32_t>(vector_bytes + offset - base);
+        if (word == begin_bits && !begin.has_value()) {
+            begin = position;
+        } else if (word == end_bits && !end.has_value()) {
+            end = position;
+        }
+    }
+    if (!begin.has_value() || !end.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_pair(*begin, *end);
+}
+
+// Describe GcObject / Value memory for inline array access in compiled code
+[[nodiscard]] static auto describe_array_layout() -> jit::JitArrayLayout {
+    jit::JitArrayLayout layout;
+    GcObject object;
+    object.fields.resize(2);
+    object.numbers.resize(2);
+    const auto* base = reinterpret_cast<const unsigned char*>(&object);
+    const auto offset_of = [&](const void* member) {
+        return static_cast<int32_t>(static_cast<const unsigned char*>(member) - base);
+    };
+
+    const auto elements = probe_vector_pointers(object.fields, base);
+    const auto numbers = probe_vector_pointers(object.numbers, base);
+    if (!elements.has_value() || !numbers.has_value()) {
+        return layout;  // unavailable: array functions stay interpreted
+    }
+
+    const Value& element = object.fields.front();
+    const auto* element_base = reinterpret_cast<const unsigned char*>(&element);
+    const auto element_offset = [&](const void* member) {
+        return static_cast<int32_t>(static_cast<const unsigned char*>(member) - element_base);
+    };
+    layout.available = true;
+    layout.object_kind = offset_of(&object.kind);
+    layout.array_kind = static_cast<std::uint8_t>(ObjectKind::Array);
+    layout.elements_begin = elements->first;
+    layout.elements_end = elements->second;
+    layout.element_size = static_cast<int32_t>(sizeof(Value));
+    layout.value_kind = element_offset(&element.kind);
+    layout.number_kind = static_cast<std::uint8_t>(ValueKind::Number);
+    layout.value_number = element_offset(&element.number);
+    layout.value_object = element_offset(&element.object);
+    layout.float64_kind = static_cast<std::uint8_t>(ObjectKind::Float64Array);
+    layout.numbers_begin = numbers->first;
+    layout.numbers_end = numbers->second;
+    layout.hole_bits = kFloat64Hole;
+    layout.struct_kind = static_cast<std::uint8_t>(ObjectKind::Struct);
+    layout.object_shape = offset_of(&object.shape);
+    layout.struct_numbers = static_cast<int32_t>(sizeof(GcObject));  // see GcHeap::allocate_struct
+    return layout;
+}
+
+namespace {
+
+// What compiled code knows about the values an instruction reads
+struct JitOperands {
+    const std::unordered_set<std::uint64_t>* arrays = nullptr;  // encoded SSA values holding arrays
+    const std::vector<StructLayout>* structs = nullptr;
+    std::unordered_set<ir::SymbolId> parameters;
+    std::unordered_set<ir::SymbolId> opaque;  // parameters that are neither numbers nor arrays
+    std::unordered_set<ir::SymbolId> globals;  // module globals the function reads (all numbers)
+    // Encoded SSA values holding string literals, which speculative code defers (jit::is_deferred)
+    std::unordered_set<std::uint64_t> strings;
+
+    [[nodiscard]] auto is_array(const ir::SsaValue& value) const -> bool {
+        return arrays->find(ir::encode_ssa_value(value)) != arrays->end();
+    }
+    [[nodiscard]] auto is_string(const ir::SsaValue& value) const -> bool {
+        return strings.find(ir::encode_ssa_value(value)) != strings.end();
+    }
+    // Whether the field a field_get / field_set names is a numeric one
+    [[nodiscard]] auto numeric_field(const ir::SsaInstruction& inst) const -> bool {
+        const StructLayout* layout = inst.immediates.size() == 2 ? find_struct_layout(*structs, inst.immediates[0]) : nullptr;
+        const StructFieldSlot* field = layout != nullptr ? layout->find(inst.immediates[1]) : nullptr;
+        return field != nullptr && field->numeric;
+    }
+};
+
+}  // namespace
+
+[[nodiscard]] static auto jit_operands(const ir::SsaFunction& ssa, const ir::Function& function,
+                                       const std::unordered_set<std::uint64_t>& array_values,
+                                       const std::unordered_map<std::string, Value>& globals,
+                                       const std::vector<StructLayout>& structs) -> JitOperands {
+    JitOperands operands;
+    operands.arrays = &array_values;
+    operands.structs = &structs;
+    std::unordered_map<std::string, const ir::FunctionParameter*> params;
+    for (const auto& param : function.parameters) {
+        params.emplace(param.name, &param);
+    }
+    for (const auto& symbol : ssa.symbols) {
+        const auto it = params.find(symbol.name);
+        if (it == params.end()) {
+            if (globals.count(symbol.name) != 0) {
+                operands.globals.insert(symbol.id);
+            }
+            continue;
+        }
+        operands.parameters.insert(symbol.id);
+        if (!is_numeric_type(it->second->type) && !is_array_type(it->second->type, structs)) {
+            operands.opaque.insert(symbol.id);
+        }
+    }
+
+    // String literals and every copy or merge of one, to a fixed point
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto& block : ssa.blocks) {
+            for (const auto& phi : block.phi_nodes) {
+                const bool merges = std::any_of(phi.inputs.begin(), phi.inputs.end(), [&](const auto& input) {
+                    return input.value.has_value() && operands.is_string(*input.value);
+                });
+                if (merges) {
+                    changed = operands.strings.insert(ir::encode_ssa_value(phi.result)).second || changed;
+                }
+            }
+            for (const auto& inst : block.instructions) {
+                if (!inst.result.has_value()) {
+                    continue;
+                }
+                if (jit::is_deferred(inst) ||
+                    (inst.op == ir::SsaOpcode::Assign && !inst.arguments.empty() && operands.is_string(inst.arguments[0]))) {
+                    changed = operands.strings.insert(ir::encode_ssa_value(*inst.result)).second || changed;
+                }
+            }
+        }
+    }
+    return operands;
+}
+
+// Array phis must merge arrays only (an element read back from an array is a number here), and
+// compiled code cannot carry strings through phis
+[[nodiscard]] static auto jit_compiles_phis(const ir::SsaBlock& block, const JitOperands& operands) -> bool {
+    for (const auto& phi : block.phi_nodes) {
+        if (operands.is_string(phi.result)) {
+            return false;
+        }
+        if (!operands.is_array(phi.result)) {
+            continue;
+        }
+        for (const auto& input : phi.inputs) {
+            if (input.value.has_value() && !operands.is_array(*input.value)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Whether compiled code can run `inst`.
+// JIT supports: literal, binary (with +, -, *, /, %, <, <=, >, >=, ==, !=, &&, ||), unary (-, !), assign, drop, return
+// JIT also supports: branch, branch_if (control flow), phi nodes (via SSA deconstruction),
+// calls to other functions of the same module, array_get / array_set / array_length on
+// array parameters, field_get / field_set of numeric fields on struct parameters and the array
+// builtins that have a jit::JitNative. Compiled code carries numbers plus array and struct object
+// pointers, so every object value must come from a parameter and every other value must be numeric.
+// Module globals are read as numbers (see JitCallTable::constants).
+// It does not support: other builtin calls, array and struct allocation, string operations
+[[nodiscard]] static auto jit_compiles_instruction(const ir::SsaInstruction& inst, const JitOperands& operands,
+                                                   const std::vector<ir::Function>& module_functions) -> bool {
+    const auto is_array = [&](const ir::SsaValue& value) { return operands.is_array(value); };
+    // Every argument except the first (the array operand, when `array_operand` is set) must be numeric
+    const auto operands_are_numeric = [&](bool array_operand) {
+        for (std::size_t i = array_operand ? 1 : 0; i < inst.arguments.size(); ++i) {
+            if (is_array(inst.arguments[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (inst.op == ir::SsaOpcode::Return) {
+        if (!operands_are_numeric(false)) {
+            return false;  // The native return value is a plain double
+        }
+    } else if (inst.op == ir::SsaOpcode::Unary) {
+        if (inst.unary_op == ir::UnaryOp::Unknown || !operands_are_numeric(false)) {
+            return false;
+        }
+    } else if (inst.op == ir::SsaOpcode::Binary) {
+        // The compiler covers every operator the parser produces
+        if (inst.binary_op == ir::BinaryOp::Unknown || !operands_are_numeric(false)) {
+            return false;
+        }
+    } else if (inst.op == ir::SsaOpcode::Branch || inst.op == ir::SsaOpcode::BranchIf) {
+        if (!operands_are_numeric(false)) {
+            return false;
+        }
+    } else if (inst.op == ir::SsaOpcode::ArrayGet || inst.op == ir::SsaOpcode::ArraySet ||
+               inst.op == ir::SsaOpcode::ArrayLength) {
+        if (inst.arguments.empty() || !is_array(inst.arguments[0]) || !operands_are_numeric(true)) {
+            return false;  // Only arrays reached through parameters are addressable natively
+        }
+    } else if (inst.op == ir::SsaOpcode::FieldGet || inst.op == ir::SsaOpcode::FieldSet) {
+        if (inst.arguments.empty() || !is_array(inst.arguments[0]) || !operands_are_numeric(true) ||
+            !operands.numeric_field(inst)) {
+            return false;  // Boxed fields need the interpreter's value model
+        }
+    } else if (inst.op == ir::SsaOpcode::Call && !inst.immediates.empty() &&
+               jit::find_jit_math(inst.immediates[0]) != nullptr) {
+        // Math builtins are evaluated natively on numbers
+        if (inst.arguments.size() != jit::find_jit_math(inst.immediates[0])->arity || !operands_are_numeric(false)) {
+            return false;
+        }
+    } else if (inst.op == ir::SsaOpcode::Call && !inst.immediates.empty() &&
+               jit::find_jit_native(inst.immediates[0]) != nullptr) {
+        // Array kernels are called natively when every argument has the kind they take
+        const jit::JitNativeSignature& native = *jit::find_jit_native(inst.immediates[0]);
+        if (inst.arguments.size() != native.arity) {
+            return false;
+        }
+        for (std::size_t i = 0; i < inst.arguments.size(); ++i) {
+            if (is_array(inst.arguments[i]) != (((native.array_arguments >> i) & 1U) != 0)) {
+                return false;
+            }
+        }
+    } else if (inst.op == ir::SsaOpcode::Call) {
+        if (inst.immediates.empty() || SsaInterpreter::is_builtin(inst.immediates[0])) {
+            return false;  // Builtins need the interpreter's value model
+        }
+        const auto callee = std::find_if(module_functions.begin(), module_functions.end(),
+                                         [&](const ir::Function& candidate) {
+                                             return candidate.name == inst.immediates[0];
+                                         });
+        if (callee == module_functions.end() || callee->parameters.size() != inst.arguments.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < inst.arguments.size(); ++i) {
+            const std::string& type = callee->parameters[i].type;
+            const bool passes_array = is_array(inst.arguments[i]);
+            if (is_array_type(type, *operands.structs) ? !passes_array : (!is_numeric_type(type) || passes_array)) {
+                return false;
+            }
+        }
+    } else if (inst.op != ir::SsaOpcode::Literal && inst.op != ir::SsaOpcode::Assign && inst.op != ir::SsaOpcode::Drop) {
+        return false;  // Unsupported opcode (includes builtins, array allocation, etc.)
+    }
+
+    // Symbols read before any definition must be parameters or module globals
+    for (const auto& arg : inst.arguments) {
+        if (operands.opaque.count(arg.symbol) != 0 || operands.is_string(arg)) {
+            return false;  // A string (or other non-numeric) parameter or literal
+        }
+        if (arg.version == 0) {
+            // Version 0 means it's a reference to a symbol, not a computed value
+            if (operands.parameters.count(arg.symbol) == 0 && operands.globals.count(arg.symbol) == 0) {
+                return false;  // Neither: the interpreter reports it as undefined
+            }
+        }
+    }
+    return true;
+}
+
+// Check if an SSA function can be JIT compiled: every instruction (see jit_compiles_instruction)
+// and a return. With `region` set only the blocks it marks are checked (an OSR loop, which need
+// not return).
+[[nodiscard]] static auto can_jit_compile_blocks(const ir::SsaFunction& ssa, const ir::Function& function,
+                                                 const std::vector<ir::Function>& module_functions,
+                                                 const std::unordered_map<std::string, Value>& globals,
+                                                 const std::vector<StructLayout>& structs,
+                                                 const std::unordered_set<std::uint64_t>& array_values,
+                                                 const std::vector<bool>* region) -> bool {
+    if (!jit::JitCompiler::is_supported()) {
+        return false;
+    }
+    const JitOperands operands = jit_operands(ssa, function, array_values, globals, structs);
     bool has_return = false;
     for (const auto& block : ssa.blocks) {
+        if (region != nullptr && (block.id >= region->size() || !(*region)[block.id])) {
+            continue;
+        }
+        if (!jit_compiles_phis(block, operands)) {
+            return false;
+        }
         for (const auto& inst : block.instructions) {
-            if (inst.opcode == "return") {
-                has_return = true;
+            if (!jit_compiles_instruction(inst, operands, module_functions)) {
+                return false;
+            }
+            has_return = has_return || inst.op == ir::SsaOpcode::Return;
+        }
+    }
+    
+    // Must have a return statement
+    return has_return || region != nullptr;
+}
+
+// Speculative compilation of a function can_jit_compile rejects: per block, how many leading
+// instructions compiled code runs before handing the call to the interpreter (see
+// jit::plan_speculation). Empty when speculation does not pay: unless compiled code can finish a
+// call or runs a loop, it would only add an exit to every call.
+[[nodiscard]] static auto speculative_prefixes(const ir::SsaFunction& ssa, const ir::Function& function,
+                                               const std::vector<ir::Function>& module_functions,
+                                               const std::unordered_map<std::string, Value>& globals,
+                                               const std::vector<StructLayout>& structs,
+                                               const std::unordered_set<std::uint64_t>& array_values)
+    -> std::vector<std::size_t> {
+    if (!jit::JitCompiler::is_supported()) {
+        return {};
+    }
+    const JitOperands operands = jit_operands(ssa, function, array_values, globals, structs);
+    std::vector<std::size_t> compiled;
+    compiled.reserve(ssa.blocks.size());
+    for (const auto& block : ssa.blocks) {
+        std::size_t count = 0;
+        if (jit_compiles_phis(block, operands)) {
+            while (count < block.instructions.size() &&
+                   (jit::is_deferred(block.instructions[count]) ||
+                    jit_compiles_instruction(block.instructions[count], operands, module_functions))) {
+                ++count;
             }
-            if (inst.opcode == "unary") {
-                // Check if unary operator is supported (-, !)
-                if (inst.immediates.empty()) {
-                    return false;
+        }
+        compiled.push_back(count);
+    }
+
+    const auto plan = jit::plan_speculation(ssa, compiled);
+    if (!plan.has_value()) {
+        return {};
+    }
+    for (const auto& block : ssa.blocks) {
+        if (!plan->in_region(block.id)) {
+            continue;
+        }
+        const bool returns = std::any_of(block.instructions.begin(), block.instructions.begin() +
+                                             static_cast<std::ptrdiff_t>(compiled[block.id]),
+                                         [](const ir::SsaInstruction& inst) { return inst.op == ir::SsaOpcode::Return; });
+        const bool loops = std::any_of(block.predecessors.begin(), block.predecessors.end(), [&](std::size_t pred) {
+            return pred >= block.id && plan->in_region(pred) &&
+                   compiled[pred] >= ssa.blocks[pred].instructions.size();
+        });
+        if (returns || loops) {
+            return compiled;
+        }
+    }
+    return {};
+}
+
+[[nodiscard]] static auto can_jit_compile(const ir::SsaFunction& ssa, const ir::Function& function,
+                                          const std::vector<ir::Function>& module_functions,
+                                          const std::unordered_map<std::string, Value>& globals,
+                                          const std::vector<StructLayout>& structs) -> bool {
+    for (const auto& param : function.parameters) {
+        if (!is_numeric_type(param.type) && !is_array_type(param.type, structs)) {
+            return false;
+        }
+    }
+    return can_jit_compile_blocks(ssa, function, module_functions, globals, structs,
+                                  find_array_values(ssa, function, structs), nullptr);
+}
+
+namespace {
+
+// A module's functions grouped into strongly connected components of its call graph, in the order
+// Tarjan's algorithm finishes them: every component comes after the components it calls
+struct CallComponents {
+    std::vector<std::vector<std::size_t>> members;  // function indices
+    std::vector<std::vector<std::size_t>> callees;  // other components each one calls
+};
+
+}  // namespace
+
+[[nodiscard]] static auto call_components(const std::vector<ir::Function>& functions) -> CallComponents {
+    const std::size_t count = functions.size();
+    std::unordered_map<std::string, std::size_t> index_of;
+    for (std::size_t i = 0; i < count; ++i) {
+        index_of.emplace(functions[i].name, i);
+    }
+    std::vector<std::vector<std::size_t>> calls(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        for (const auto& block : functions[i].blocks) {
+            for (const auto& inst : block.instructions) {
+                if (inst.kind != ir::InstructionKind::Call || inst.operands.empty()) {
+                    continue;
                 }
-                const std::string& op = inst.immediates[0];
-                if (op != "-" && op != "!") {
-                    return false;  // Unsupported unary operator
+                const auto callee = index_of.find(inst.operands.front());
+                if (callee != index_of.end()) {
+                    calls[i].push_back(callee->second);
                 }
             }
-            if (inst.opcode == "binary") {
-                // Check if the operator is supported
-                if (inst.immediates.empty() || 
-                    supported_binary_ops.find(inst.immediates[0]) == supported_binary_ops.end()) {
-                    return false;  // Unsupported binary operator (e.g., %, &&, ||)
+        }
+    }
+
+    constexpr std::size_t kUnvisited = std::numeric_limits<std::size_t>::max();
+    CallComponents graph;
+    std::vector<std::size_t> order(count, kUnvisited);
+    std::vector<std::size_t> low(count, 0);
+    std::vector<std::size_t> component_of(count, kUnvisited);
+    std::vector<std::size_t> stack;
+    std::vector<std::pair<std::size_t, std::size_t>> walk;  // function and its next call to follow
+    std::size_t visited = 0;
+    const auto visit = [&](std::size_t function) {
+        order[function] = low[function] = visited++;
+        stack.push_back(function);
+        walk.emplace_back(function, 0);
+    };
+    for (std::size_t root = 0; root < count; ++root) {
+        if (order[root] != kUnvisited) {
+            continue;
+        }
+        visit(root);
+        while (!walk.empty()) {
+            const std::size_t function = walk.back().first;
+            const std::size_t next = walk.back().second;
+            if (next < calls[function].size()) {
+                ++walk.back().second;
+                const std::size_t callee = calls[function][next];
+                if (order[callee] == kUnvisited) {
+                    visit(callee);
+                } else if (component_of[callee] == kUnvisited) {
+                    low[function] = std::min(low[function], order[callee]);  // still on the stack
                 }
-            } else if (inst.opcode == "branch" || inst.opcode == "branch_if") {
-                // Control flow is now supported by JIT
                 continue;
-            } else if (inst.opcode != "literal" && inst.opcode != "assign" && 
-                       inst.opcode != "return") {
-                return false;  // Unsupported opcode (includes call, array ops, etc.)
             }
-            
-            // Check if any arguments reference non-parameter symbols (i.e., globals)
-            for (const auto& arg : inst.arguments) {
-                if (arg.version == 0) {
-                    // Version 0 means it's a reference to a symbol, not a computed value
-                    // If it's not a parameter, it's likely a global
-                    if (param_symbol_ids.find(arg.symbol) == param_symbol_ids.end()) {
-                        return false;  // Uses globals, not supported
-                    }
+            walk.pop_back();
+            if (!walk.empty()) {
+                low[walk.back().first] = std::min(low[walk.back().first], low[function]);
+            }
+            if (low[function] != order[function]) {
+                continue;
+            }
+            std::vector<std::size_t> members;
+            std::size_t member = kUnvisited;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                component_of[member] = graph.members.size();
+                members.push_back(member);
+            } while (member != function);
+            // Build members in source order, as lazy loading mostly does
+            std::sort(members.begin(), members.end());
+            graph.members.push_back(std::move(members));
+        }
+    }
+
+    graph.callees.resize(graph.members.size());
+    for (std::size_t c = 0; c < graph.members.size(); ++c) {
+        auto& callees = graph.callees[c];
+        for (const auto function : graph.members[c]) {
+            for (const auto callee : calls[function]) {
+                if (component_of[callee] != c) {
+                    callees.push_back(component_of[callee]);
                 }
             }
         }
+        std::sort(callees.begin(), callees.end());
+        callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
     }
-    
-    // Must have a return statement
-    if (!has_return) {
-        return false;
+    return graph;
+}
+
+Vm::~Vm() {
+    {
+        const std::lock_guard<std::mutex> lock(compile_queue_mutex_);
+        stop_compiler_ = true;
     }
-    
-    return true;
+    compile_queued_.notify_all();
+    if (compiler_thread_.joinable()) {
+        compiler_thread_.join();
+    }
+}
+
+// Why the struct or field `inst` names does not resolve against `structs`, if it does not
+[[nodiscard]] static auto check_struct_operands(const ir::Instruction& inst, const std::vector<StructLayout>& structs)
+    -> std::optional<std::string> {
+    if (inst.kind != ir::InstructionKind::MakeStruct && inst.kind != ir::InstructionKind::FieldGet &&
+        inst.kind != ir::InstructionKind::FieldSet) {
+        return std::nullopt;
+    }
+    const std::string name = inst.operands.empty() ? std::string{} : inst.operands[0];
+    const std::string field = inst.operands.size() < 2 ? std::string{} : inst.operands[1];
+    if (name.empty()) {
+        return "field '" + field + "' of a value whose struct type is not known";
+    }
+    const StructLayout* layout = find_struct_layout(structs, name);
+    if (layout == nullptr) {
+        return "unknown struct '" + name + "'";
+    }
+    if (inst.kind != ir::InstructionKind::MakeStruct && layout->find(field) == nullptr) {
+        return "struct '" + name + "' has no field '" + field + "'";
+    }
+    return std::nullopt;
+}
+
+// Whether `fresh` can take over `old`'s call table: the same functions in the same order (call
+// table slots), and the same bindings and structs (folded into or checked by compiled code)
+[[nodiscard]] static auto same_linkage(const ir::Module& old, const ir::Module& fresh) -> bool {
+    const auto same_function = [](const ir::Function& lhs, const ir::Function& rhs) { return lhs.name == rhs.name; };
+    const auto same_binding = [](const ir::Binding& lhs, const ir::Binding& rhs) {
+        return lhs.storage == rhs.storage && lhs.name == rhs.name && lhs.type == rhs.type &&
+               lhs.initializer == rhs.initializer && lhs.constant_value == rhs.constant_value;
+    };
+    const auto same_struct = [](const ir::Struct& lhs, const ir::Struct& rhs) {
+        return lhs.name == rhs.name &&
+               std::equal(lhs.fields.begin(), lhs.fields.end(), rhs.fields.begin(), rhs.fields.end(),
+                          [](const ir::StructField& a, const ir::StructField& b) {
+                              return a.name == b.name && a.type == b.type;
+                          });
+    };
+    return std::equal(old.functions.begin(), old.functions.end(), fresh.functions.begin(), fresh.functions.end(),
+                      same_function) &&
+           std::equal(old.bindings.begin(), old.bindings.end(), fresh.bindings.begin(), fresh.bindings.end(),
+                      same_binding) &&
+           std::equal(old.structs.begin(), old.structs.end(), fresh.structs.begin(), fresh.structs.end(),
+                      same_struct);
 }
 
 auto Vm::load(ir::Module module) -> VmLoadResult {
+    wait_for_background_compilation();  // queued requests point into modules_
     VmLoadResult result;
     LoadedModule loaded;
     loaded.name = normalize_module_name(module);
     loaded.module = std::move(module);
 
+    // Initializers may call pure functions, which run at load like the rest of the initializer
+    loaded.pure = ir::find_pure_functions(loaded.module);
     std::unordered_map<std::string, double> environment;
+    ir::CallEvaluator calls(loaded.module, loaded.pure, environment);
     for (const auto& binding : loaded.module.bindings) {
-        const auto eval = ir::interpret_binding(binding, environment);
+        const auto eval = ir::interpret_binding(binding, environment, &calls);
         if (eval.status == ir::EvalStatus::Success && eval.value.has_value()) {
             environment[binding.name] = *eval.value;
             loaded.globals[binding.name] = Value::make_number(*eval.value);
@@ -135,33 +699,125 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
         }
     }
 
+    for (const auto& structure : loaded.module.structs) {
+        loaded.structs.push_back(build_struct_layout(structure, next_struct_shape_++));
+    }
+    for (const auto& function : loaded.module.functions) {
+        for (const auto& block : function.blocks) {
+            for (const auto& inst : block.instructions) {
+                if (auto problem = check_struct_operands(inst, loaded.structs)) {
+                    result.success = false;
+                    result.diagnostics.push_back("function '" + function.name + "': " + *problem);
+                }
+            }
+        }
+    }
+
     if (result.success) {
         const auto existing = std::find_if(modules_.begin(), modules_.end(), [&](const LoadedModule& candidate) {
             return candidate.name == loaded.name;
         });
-        if (existing != modules_.end()) {
-            // Module is being reloaded - clear caches for this module
-            std::string module_prefix = loaded.name + "::";
-            auto it = jit_cache_.begin();
-            while (it != jit_cache_.end()) {
-                if (it->first.find(module_prefix) == 0) {
-                    it = jit_cache_.erase(it);
-                } else {
-                    ++it;
+        loaded.function_hashes = function_hashes(loaded.module);
+        LoadedModule* stored = nullptr;
+        if (existing != modules_.end() && same_linkage(existing->module, loaded.module)) {
+            // Same functions in the same order, bindings and structs: the call table stays, and
+            // so does everything kept for functions whose code is unchanged. Compiled callers of
+            // the others go back through the trampoline until the new code is compiled.
+            loaded.first_function = existing->first_function;
+            loaded.structs = existing->structs;  // compiled code checks their shapes
+            loaded.link = existing->link;
+            for (std::size_t i = 0; i < loaded.module.functions.size(); ++i) {
+                if (existing->function_hashes[i] == loaded.function_hashes[i]) {
+                    ++result.functions_kept;
+                    continue;
+                }
+                auto record = std::make_unique<FunctionRecord>();
+                record->key = loaded.name + "::" + loaded.module.functions[i].name;
+                function_records_[loaded.first_function + i] = std::move(record);
+                loaded.link->table.entries[i].store(nullptr, std::memory_order_relaxed);
+            }
+            *existing = std::move(loaded);
+            stored = &*existing;
+        } else {
+            loaded.first_function = static_cast<FunctionId>(function_records_.size());
+            for (const auto& function : loaded.module.functions) {
+                auto record = std::make_unique<FunctionRecord>();
+                record->key = loaded.name + "::" + function.name;
+                function_records_.push_back(std::move(record));
+            }
+            if (existing != modules_.end()) {
+                // Module is being reloaded: drop everything kept for its functions
+                for (std::size_t i = 0; i < existing->module.functions.size(); ++i) {
+                    function_records_[existing->first_function + i] = std::make_unique<FunctionRecord>();
+                }
+                *existing = std::move(loaded);
+                stored = &*existing;
+            } else {
+                modules_.push_back(std::move(loaded));
+                stored = &modules_.back();
+            }
+
+            // Fresh call table for the module: one slot per function, indexed like module.functions.
+            // Replacing a reloaded module's link unmaps all of its previous compiled code at once.
+            auto link = std::make_unique<JitLink>();
+            link->vm = this;
+            link->module_name = stored->name;
+            link->table.entries = std::vector<std::atomic<jit::JitFunction>>(stored->module.functions.size());
+            for (std::size_t i = 0; i < stored->module.functions.size(); ++i) {
+                link->table.slots.emplace(stored->module.functions[i].name, i);
+            }
+            link->table.trampoline = &Vm::jit_call_trampoline;
+            link->table.trap = &Vm::jit_trap_handler;
+            link->table.natives = jit_natives();
+            link->table.arrays = describe_array_layout();
+            for (const auto& layout : stored->structs) {
+                jit::JitStructLayout& compiled = link->table.structs[layout.name];
+                compiled.shape = layout.shape;
+                for (const auto& field : layout.fields) {
+                    if (field.numeric) {
+                        compiled.numeric_fields.emplace(field.name, field.slot);
+                    }
                 }
             }
-            // Clear SSA cache for this module
-            auto ssa_it = ssa_cache_.begin();
-            while (ssa_it != ssa_cache_.end()) {
-                if (ssa_it->first.find(module_prefix) == 0) {
-                    ssa_it = ssa_cache_.erase(ssa_it);
+            link->table.code = &link->code;
+            link->table.owner = link.get();
+            for (const auto& binding : stored->module.bindings) {
+                const double value = stored->globals.at(binding.name).as_number();
+                if (binding.storage == ir::StorageClass::Var) {
+                    link->table.global_slots.emplace(binding.name, link->table.globals.size());
+                    link->table.globals.push_back(value);
                 } else {
-                    ++ssa_it;
+                    link->table.constants.emplace(binding.name, value);
                 }
             }
-            *existing = std::move(loaded);
-        } else {
-            modules_.push_back(std::move(loaded));
+
+            stored->link = link.get();
+            auto& slot = jit_links_[stored->name];
+            if (slot != nullptr && jit_symbols_ != nullptr) {
+                jit_symbols_->forget(slot.get());  // its code is unmapped with it
+            }
+            slot = std::move(link);
+        }
+
+        const bool precompiled = !precompiled_code_.empty() && stored->link != nullptr;
+        if (!code_cache_directory_.empty() || precompiled) {
+            const std::uint64_t key =
+                code_cache_key(stored->module, stored->link->table.arrays, optimization_options_, stored->structs);
+            if (!code_cache_directory_.empty()) {
+                auto persisted = std::make_unique<PersistedCode>();
+                persisted->key = key;
+                persisted->path = code_cache_path(code_cache_directory_, persisted->key);
+                if (auto contents = read_code_cache(persisted->path, persisted->key)) {
+                    persisted->contents = std::move(*contents);
+                }
+                persisted_code_[stored->name] = std::move(persisted);
+            }
+            if (precompiled) {
+                result.functions_precompiled = bind_precompiled_code(*stored, key);
+            }
+        }
+        if (eager_load_threads_ != 0) {
+            prepare_module(*stored);
         }
     }
 
@@ -183,123 +839,500 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
         return make_result(VmStatus::MissingSymbol, "function '" + entry + "' not found in module '" + module_name + "'");
     }
 
-    std::unordered_map<std::string, Value> parameters;
-    for (const auto& parameter : functionIt->parameters) {
-        parameters.emplace(parameter.name, Value::make_number(0.0));
-    }
+    const std::vector<Value> arguments(functionIt->parameters.size(), Value::make_number(0.0));
 
-    output_buffer_.clear();
-    auto result = execute_function(*moduleIt, *functionIt, parameters, &output_buffer_);
-    if (!output_buffer_.empty() && (result.status == VmStatus::Success || result.message.empty())) {
-        result.message = output_buffer_;
+    ExecutionContext& context = thread_context();
+    ExecutionContext* const outer = active_context_;
+    active_context_ = &context;
+    context.output.clear();
+    const auto id = moduleIt->first_function +
+                    static_cast<FunctionId>(functionIt - moduleIt->module.functions.begin());
+    auto result = execute_function(context, *moduleIt, id, arguments);
+    active_context_ = outer;
+    if (output_sink_ != nullptr) {
+        output_sink_->flush();
+    } else if (!context.output.empty() && (result.status == VmStatus::Success || result.message.empty())) {
+        result.message = context.output;
     }
     return result;
 }
 
-[[nodiscard]] auto Vm::execute_function(const LoadedModule& module, const ir::Function& function,
-                                        const std::unordered_map<std::string, Value>& parameters,
-                                        std::string* output_buffer) const -> VmResult {
-    if (function.blocks.empty()) {
-        return make_result(VmStatus::ModuleError, "function has no basic blocks");
+[[nodiscard]] auto Vm::cached_ssa(const LoadedModule& module, FunctionId id) const -> const CachedSsa& {
+    const FunctionRecord& record = *function_records_[id];
+    if (record.ssa_ready.load(std::memory_order_acquire)) {
+        return *record.ssa;
+    }
+    const std::lock_guard<std::mutex> lock(state_mutex_);
+    if (record.ssa == nullptr) {
+        metrics_.ssa_misses.fetch_add(1, std::memory_order_relaxed);
     }
+    return cached_ssa_locked(module, id);
+}
 
-    // Start profiling timer
-    const auto start_time = profiling_enabled_ 
-        ? std::chrono::high_resolution_clock::now() 
-        : std::chrono::high_resolution_clock::time_point{};
-    bool was_jit_compiled = false;
+[[nodiscard]] auto Vm::cached_ssa_locked(const LoadedModule& module, FunctionId id) const -> const CachedSsa& {
+    FunctionRecord& record = *function_records_[id];
+    if (record.ssa != nullptr) {
+        return *record.ssa;  // built by another thread while this one waited for the lock
+    }
+    const auto& functions = module.module.functions;
+    const ir::Function& function = functions[id - module.first_function];
 
-    std::vector<Value> stack;
-    std::unordered_map<std::string, Value> locals;
-    locals.reserve(parameters.size());
-    for (const auto& [name, value] : parameters) {
-        locals.emplace(name, value);
+    // Build SSA (or decode it from the code cache) and cache it together with its frame layout
+    // and bytecode
+    auto cached = std::make_unique<CachedSsa>();
+    PersistedCode* persisted = persisted_code(module.name);
+    std::optional<ir::SsaFunction> restored;
+    // Tracing and profiling report every call, so they keep the calls the source makes
+    const bool observed = tracing() || profiling_enabled_;
+    if (persisted != nullptr && !observed) {
+        const auto saved = persisted->contents.functions.find(function.name);
+        if (saved != persisted->contents.functions.end() && !saved->second.ssa.empty()) {
+            ir::BinaryReader in(saved->second.ssa);
+            restored = ir::deserialize_ssa(in);
+        }
     }
-    FrameGuard frame_guard(*this, locals, stack);
-    
-    // Check SSA cache first (major performance optimization - SSA building is expensive)
-    std::string cache_key = module.name + "::" + function.name;
-    const ir::SsaFunction* ssa_ptr = nullptr;
-    auto ssa_cache_it = ssa_cache_.find(cache_key);
-    if (ssa_cache_it != ssa_cache_.end()) {
-        // Use cached SSA (use pointer to avoid copy)
-        ssa_ptr = &ssa_cache_it->second;
+    if (restored.has_value()) {
+        cached->ssa = std::move(*restored);
+    } else if (optimization_options_.fold_calls && !observed) {
+        // Calls to pure functions with literal arguments are evaluated now, as binding
+        // initializers are at load
+        std::unordered_map<std::string, double> constants;
+        for (const auto& binding : module.module.bindings) {
+            if (binding.storage != ir::StorageClass::Var) {
+                constants.emplace(binding.name, module.globals.at(binding.name).as_number());
+            }
+        }
+        ir::CallEvaluator calls(module.module, module.pure, constants);
+        ir::Function folded = function;
+        [[maybe_unused]] const std::size_t replaced = ir::fold_constant_calls(folded, calls);
+        cached->ssa = ir::build_ssa(folded);
     } else {
-        // Build SSA and cache it
-        ir::SsaFunction ssa = ir::build_ssa(function);
-        [[maybe_unused]] const bool optimized = ir::optimize_ssa(ssa);
-        ssa_cache_[cache_key] = std::move(ssa);  // Cache the SSA representation
-        ssa_ptr = &ssa_cache_[cache_key];
+        cached->ssa = ir::build_ssa(function);
+    }
+    if (!restored.has_value()) {
+        if (optimization_options_.inlining && !observed) {
+            record.building = true;
+            const auto lookup = [&](const std::string& name) -> std::optional<ir::InlineCandidate> {
+                const auto callee = std::find_if(functions.begin(), functions.end(),
+                                                 [&](const ir::Function& candidate) { return candidate.name == name; });
+                if (SsaInterpreter::is_builtin(name) || callee == functions.end() || callee->blocks.empty()) {
+                    return std::nullopt;
+                }
+                const auto callee_id = module.first_function + static_cast<FunctionId>(callee - functions.begin());
+                if (function_records_[callee_id]->building) {
+                    return std::nullopt;
+                }
+                ir::InlineCandidate candidate;
+                candidate.ssa = &cached_ssa_locked(module, callee_id).ssa;
+                for (const auto& parameter : callee->parameters) {
+                    candidate.parameters.push_back(parameter.name);
+                }
+                // Call counts are kept whether or not profiling is on
+                candidate.calls = function_records_[callee_id]->counters.calls.load(std::memory_order_relaxed);
+                return candidate;
+            };
+            [[maybe_unused]] const std::size_t inlined = ir::inline_calls(cached->ssa, lookup);
+            record.building = false;
+        }
+        if (optimization_options_.tail_calls && !observed) {
+            std::vector<std::string> parameters;
+            for (const auto& parameter : function.parameters) {
+                parameters.push_back(parameter.name);
+            }
+            [[maybe_unused]] const std::size_t looped = ir::eliminate_self_tail_calls(cached->ssa, parameters);
+        }
+        [[maybe_unused]] const bool optimized = ir::optimize_ssa(cached->ssa, optimization_options_);
+        if (persisted != nullptr) {
+            persisted->dirty.store(true, std::memory_order_relaxed);
+        }
     }
+    cached->layout = build_frame_layout(cached->ssa, function.parameters);
+    cached->bytecode = compile_bytecode(cached->ssa, cached->layout, functions, module.structs);
+    cached->block_entries = std::make_unique<std::atomic<std::uint64_t>[]>(cached->ssa.blocks.size());
+    record.ssa = std::move(cached);
+    record.ssa_ready.store(true, std::memory_order_release);
+    return *record.ssa;
+}
 
-    // Extract parameter names in order
-    std::vector<std::string> param_names;
-    param_names.reserve(function.parameters.size());
-    for (const auto& param : function.parameters) {
-        param_names.push_back(param.name);
+void Vm::compile_function(const LoadedModule& module, FunctionId id) const {
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    FunctionRecord& record = *function_records_[id];
+    const ir::Function& function = module.module.functions[id - module.first_function];
+    const ir::SsaFunction& ssa = record.ssa->ssa;
+    JitLink* link = module.link;
+
+    // Reuse an earlier run's verdict and code when the code cache has them
+    PersistedCode* persisted = persisted_code(module.name);
+    const PersistedFunction* saved = nullptr;
+    if (persisted != nullptr && link != nullptr) {
+        const auto saved_it = persisted->contents.functions.find(function.name);
+        if (saved_it != persisted->contents.functions.end() && saved_it->second.jit_checked) {
+            saved = &saved_it->second;
+        }
     }
-    
-    // Check JIT cache (cache_key already computed above)
-    auto cache_it = jit_cache_.find(cache_key);
-    
-    // Try JIT compilation if the function is suitable
-    // JIT can compile any suitable function, not just entry points
-    if (jit_enabled_) {
-        jit::JitFunction jit_func = nullptr;
-        bool can_jit = false;
-        
-        if (cache_it != jit_cache_.end()) {
-            // Use cached result
-            jit_func = cache_it->second.function;
-            can_jit = cache_it->second.can_jit;
-        } else {
-            // Check if function can be JIT compiled and compile if possible
-            can_jit = can_jit_compile(*ssa_ptr, param_names);
-            if (can_jit) {
-                jit::JitCompiler compiler;
-                auto [func, buffer] = compiler.compile_with_buffer(*ssa_ptr, param_names);
-                jit_func = func;
-                
-                // Cache the result with the code buffer to keep executable memory alive
-                JitCacheEntry entry;
-                entry.function = jit_func;
-                entry.code_buffer = std::move(buffer);
-                entry.can_jit = can_jit;
-                jit_cache_[cache_key] = std::move(entry);
-            } else {
-                // Cache that it can't be JIT compiled
-                JitCacheEntry entry;
-                entry.function = nullptr;
-                entry.can_jit = false;
-                jit_cache_[cache_key] = std::move(entry);
-            }
+    JitCacheEntry entry;
+    bool restored = false;
+    if (saved != nullptr) {
+        entry.can_jit = saved->can_jit;
+        if (entry.can_jit) {
+            entry.function = jit::link_code(std::vector<uint8_t>(saved->code.begin(), saved->code.end()),
+                                            saved->relocations, link->table);
         }
-        
-        if (can_jit && jit_func != nullptr) {
-            was_jit_compiled = true;
-            
-            // Write trace output for JIT-compiled functions (to match interpreter behavior)
-            if (trace_stream_ != nullptr) {
-                *trace_stream_ << "enter function " << function.name << '\n';
-            }
-            
-            // Prepare arguments array for JIT function
-            std::vector<double> args_array;
-            args_array.reserve(function.parameters.size());
+        restored = !entry.can_jit || entry.function != nullptr;
+    }
+
+    if (!restored) {
+        // Check if function can be JIT compiled and compile if possible
+        if (persisted != nullptr) {
+            persisted->dirty.store(true, std::memory_order_relaxed);
+        }
+        entry.can_jit = can_jit_compile(ssa, function, module.module.functions, module.globals, module.structs);
+        entry.function = nullptr;
+        if (entry.can_jit) {
+            std::vector<std::string> param_names;
+            param_names.reserve(function.parameters.size());
             for (const auto& param : function.parameters) {
-                auto it = parameters.find(param.name);
-                if (it != parameters.end() && it->second.is_number()) {
-                    args_array.push_back(it->second.as_number());
-                } else {
-                    args_array.push_back(0.0);
-                }
+                param_names.push_back(param.name);
             }
-            
-            // Call JIT compiled function
+            jit::JitCompiler compiler;
+            auto [func, buffer] =
+                compiler.compile_with_buffer(ssa, param_names, link != nullptr ? &link->table : nullptr);
+            // Keep the code buffer with the entry so executable memory stays alive
+            entry.function = func;
+            entry.code_buffer = std::move(buffer);
+        }
+    }
+    if (entry.function != nullptr) {
+        publish_code(link, record.key, entry.function,
+                     restored ? saved->code.size() : entry.code_buffer.code().size());
+        (restored ? metrics_.code_cache_hits : metrics_.jit_compilations).fetch_add(1, std::memory_order_relaxed);
+    } else {
+        metrics_.jit_rejections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Not persisted: speculative code is cheap to rebuild and the cache keeps one entry per function
+    if (!entry.can_jit && link != nullptr) {
+        const std::unordered_set<std::uint64_t> arrays = find_array_values(ssa, function, module.structs);
+        const std::vector<std::size_t> compiled =
+            speculative_prefixes(ssa, function, module.module.functions, module.globals, module.structs, arrays);
+        if (auto plan = compiled.empty() ? std::nullopt : jit::plan_speculation(ssa, compiled)) {
+            jit::JitCompiler compiler;
+            auto [func, buffer] = compiler.compile_osr_with_buffer(ssa, *plan, &link->table);
+            if (func != nullptr) {
+                publish_code(link, record.key + " [speculative]", func, buffer.code().size());
+                metrics_.jit_compilations.fetch_add(1, std::memory_order_relaxed);
+                entry.speculative = std::make_unique<OsrCacheEntry>();
+                entry.speculative->function.store(func, std::memory_order_relaxed);
+                entry.speculative->code_buffer = std::move(buffer);
+                entry.speculative->plan = std::move(*plan);
+                entry.speculative->arrays = arrays;
+            }
+        }
+    }
+    record.jit = std::move(entry);
+    record.jit_ready.store(true, std::memory_order_release);
+    const std::int64_t elapsed = (std::chrono::high_resolution_clock::now() - start_time) / std::chrono::nanoseconds{1};
+    record.compile_nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+    metrics_.compile_nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+    if (profiling_enabled_) {
+        record_profile_event(ProfileEvent::Kind::Compile, record.key, start_time);
+    }
+}
+
+void Vm::request_compilation(const LoadedModule& module, FunctionId id) const {
+    if (function_records_[id]->compile_claimed.exchange(true, std::memory_order_relaxed)) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(compile_queue_mutex_);
+        compile_queue_.push_back(CompileRequest{&module, id});
+        if (!compiler_thread_.joinable()) {
+            compiler_thread_ = std::thread([this] { compiler_loop(); });
+        }
+    }
+    compile_queued_.notify_one();
+}
+
+void Vm::compiler_loop() const {
+    std::unique_lock<std::mutex> lock(compile_queue_mutex_);
+    for (;;) {
+        compile_queued_.wait(lock, [this] { return stop_compiler_ || !compile_queue_.empty(); });
+        if (stop_compiler_) {
+            return;
+        }
+        const CompileRequest request = compile_queue_.front();
+        compile_queue_.pop_front();
+        ++compiles_in_flight_;
+        lock.unlock();
+        compile_function(*request.module, request.id);
+        lock.lock();
+        --compiles_in_flight_;
+        if (compile_queue_.empty() && compiles_in_flight_ == 0) {
+            compile_idle_.notify_all();
+        }
+    }
+}
+
+void Vm::wait_for_background_compilation() const {
+    std::unique_lock<std::mutex> lock(compile_queue_mutex_);
+    compile_idle_.wait(lock, [this] { return compile_queue_.empty() && compiles_in_flight_ == 0; });
+}
+
+void Vm::set_background_compilation(bool enabled) const {
+    background_compilation_ = enabled;
+}
+
+void Vm::set_eager_loading(std::size_t threads) const {
+    eager_load_threads_ = threads;
+}
+
+void Vm::prepare_module(const LoadedModule& module) const {
+    const auto& functions = module.module.functions;
+    const CallComponents graph = call_components(functions);
+    const std::size_t count = graph.members.size();
+
+    // A component becomes ready once every component it calls is built
+    std::vector<std::size_t> waiting(count);
+    std::vector<std::vector<std::size_t>> callers(count);
+    std::deque<std::size_t> ready;
+    for (std::size_t c = 0; c < count; ++c) {
+        waiting[c] = graph.callees[c].size();
+        for (const auto callee : graph.callees[c]) {
+            callers[callee].push_back(c);
+        }
+        if (waiting[c] == 0) {
+            ready.push_back(c);
+        }
+    }
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t finished = 0;
+    const auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] { return !ready.empty() || finished == count; });
+            if (ready.empty()) {
+                return;
+            }
+            const std::size_t component = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            // No other thread touches this component's records, and everything it inlines from is
+            // built, so the builder needs no lock
+            for (const auto index : graph.members[component]) {
+                if (!functions[index].blocks.empty()) {
+                    [[maybe_unused]] const CachedSsa& built =
+                        cached_ssa_locked(module, module.first_function + static_cast<FunctionId>(index));
+                }
+            }
+            for (const auto index : graph.members[component]) {
+                const FunctionId id = module.first_function + static_cast<FunctionId>(index);
+                FunctionRecord& record = *function_records_[id];
+                if (!jit_enabled_ || functions[index].blocks.empty() ||
+                    record.compile_claimed.exchange(true, std::memory_order_relaxed)) {
+                    continue;
+                }
+                compile_function(module, id);
+                if (record.jit->function != nullptr && module.link != nullptr && direct_jit_calls_allowed() &&
+                    !memoized(module, id)) {
+                    module.link->table.entries[index].store(record.jit->function, std::memory_order_release);
+                }
+            }
+            lock.lock();
+            ++finished;
+            for (const auto caller : callers[component]) {
+                if (--waiting[caller] == 0) {
+                    ready.push_back(caller);
+                }
+            }
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    const std::size_t helpers = std::min(eager_load_threads_, count) - (count != 0 ? 1 : 0);
+    pool.reserve(helpers);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+auto Vm::execute_function(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                          const std::vector<Value>& arguments) const -> VmResult {
+    FunctionRecord* memo = nullptr;
+    std::string memo_key;
+    if (memoized(module, id) &&
+        function_records_[id]->counters.calls.load(std::memory_order_relaxed) >= tier_thresholds_.memoize &&
+        std::all_of(arguments.begin(), arguments.end(), [](const Value& value) { return value.is_number(); })) {
+        memo = function_records_[id].get();
+        memo_key.resize(arguments.size() * sizeof(double));
+        for (std::size_t i = 0; i < arguments.size(); ++i) {
+            const double number = arguments[i].as_number();
+            std::memcpy(memo_key.data() + i * sizeof(double), &number, sizeof(double));
+        }
+        const std::lock_guard<std::mutex> lock(memo->memo_mutex);
+        if (const auto it = memo->memo.find(memo_key); it != memo->memo.end()) {
+            bump(context.memo_hits);
+            VmResult result;
+            result.status = VmStatus::Success;
+            result.has_value = true;
+            result.value = it->second;
+            return result;
+        }
+    }
+    // The tail calls a pure function makes are to pure functions, so the last result is its own
+    const auto remember = [&](const VmResult& result) {
+        if (memo != nullptr && result.status == VmStatus::Success && result.has_value) {
+            const std::lock_guard<std::mutex> lock(memo->memo_mutex);
+            if (memo->memo.size() < kMaxMemoEntries) {
+                memo->memo.emplace(std::move(memo_key), result.value);
+            }
+        }
+    };
+
+    std::optional<std::size_t> tail;
+    std::vector<Value> tail_arguments;
+    VmResult result = execute_frame(context, module, id, arguments, tail, tail_arguments);
+    if (!tail.has_value()) {
+        remember(result);
+        return result;
+    }
+    // Each frame is released before the next one runs. The arguments in between wait in a frame
+    // of their own, which keeps them reported as GC roots.
+    FrameGuard arguments_guard(context);
+    std::vector<Value>& next_arguments = arguments_guard.frame().arguments;
+    while (tail.has_value()) {
+        const FunctionId callee = module.first_function + static_cast<FunctionId>(*tail);
+        tail.reset();
+        std::swap(next_arguments, tail_arguments);
+        result = execute_frame(context, module, callee, next_arguments, tail, tail_arguments);
+    }
+    remember(result);
+    return result;
+}
+
+auto Vm::execute_frame(ExecutionContext& context, const LoadedModule& module, FunctionId id,
+                       const std::vector<Value>& arguments, std::optional<std::size_t>& tail,
+                       std::vector<Value>& tail_arguments) const -> VmResult {
+    const ir::Function& function = module.module.functions[id - module.first_function];
+    if (function.blocks.empty()) {
+        return make_result(VmStatus::ModuleError, "function has no basic blocks");
+    }
+
+    // Start profiling timer
+    const auto start_time = profiling_enabled_ 
+        ? std::chrono::high_resolution_clock::now() 
+        : std::chrono::high_resolution_clock::time_point{};
+
+    FrameGuard frame_guard(context);
+    InterpreterFrame& frame = frame_guard.frame();
+
+    bump(context.ssa_lookups);
+    const CachedSsa& cached = cached_ssa(module, id);
+    // Records only move when a module is loaded, never during a call
+    FunctionRecord& record = *function_records_[id];
+    // Use cached SSA (use pointer to avoid copy)
+    const ir::SsaFunction* ssa_ptr = &cached.ssa;
+    const SsaFrameLayout& frame_layout = cached.layout;
+    const SsaBytecode& bytecode = cached.bytecode;
+
+    SharedTierCounters& counters = record.counters;
+    const std::uint64_t calls = bump(counters.calls);
+
+    const auto update_profile = [&](bool was_jit_compiled) {
+        const auto end_time = std::chrono::high_resolution_clock::now();
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+        const std::lock_guard<std::mutex> lock(state_mutex_);
+        auto& profile = record.profile;
+        profile.full_name = record.key;
+        profile.call_count++;
+        profile.total_time += duration;
+        if (duration < profile.min_time) {
+            profile.min_time = duration;
+        }
+        if (duration > profile.max_time) {
+            profile.max_time = duration;
+        }
+        profile.was_jit_compiled = was_jit_compiled;
+        record_profile_event(ProfileEvent::Kind::Call, record.key, start_time, end_time);
+    };
+    
+    // Try JIT compilation if the function is suitable
+    // JIT can compile any suitable function, not just entry points
+    if (jit_enabled_ && !block_profiling_enabled_) {
+        if (!record.jit_ready.load(std::memory_order_acquire) &&
+            (calls >= tier_thresholds_.calls ||
+             counters.back_edges.load(std::memory_order_relaxed) >= tier_thresholds_.back_edges)) {
+            if (background_compilation_) {
+                request_compilation(module, id);  // this call and those until it is done stay interpreted
+            } else if (!record.compile_claimed.exchange(true, std::memory_order_relaxed)) {
+                compile_function(module, id);  // a thread that loses the claim stays interpreted
+            }
+        }
+        const JitCacheEntry* compiled = record.jit_ready.load(std::memory_order_acquire) ? &*record.jit : nullptr;
+        
+        if (compiled != nullptr && compiled->can_jit && compiled->function != nullptr) {
+            const jit::JitFunction jit_func = compiled->function;
+
+            // Publish the native entry so compiled callers stop going through the trampoline
+            if (module.link != nullptr && direct_jit_calls_allowed() && !memoized(module, id)) {
+                auto& slot = module.link->table.entries[id - module.first_function];
+                if (slot.load(std::memory_order_relaxed) != jit_func) {
+                    slot.store(jit_func, std::memory_order_release);
+                }
+            }
+            
+            // Write trace output for JIT-compiled functions (to match interpreter behavior)
+            if (trace_stream_ != nullptr) {
+                *trace_stream_ << "enter function " << function.name << '\n';
+            }
+            if (trace_writer_ != nullptr) {
+                trace_writer_->define_function(id, function.name);
+                trace_writer_->enter_function(id);
+            }
+            
+            // Prepare arguments array for JIT function
+            std::vector<double>& args_array = frame.native_arguments;
+            for (std::size_t i = 0; i < function.parameters.size(); ++i) {
+                const Value* argument = i < arguments.size() ? &arguments[i] : nullptr;
+                if (argument != nullptr && argument->is_number()) {
+                    args_array.push_back(argument->as_number());
+                } else if (argument != nullptr && argument->is_object()) {
+                    args_array.push_back(array_to_jit_arg(argument->as_object()));
+                } else {
+                    args_array.push_back(0.0);
+                }
+            }
+            
+            // Call JIT compiled function
             // Use a valid pointer even for empty arrays to avoid nullptr issues
             double dummy = 0.0;
             double* args_ptr = args_array.empty() ? &dummy : args_array.data();
             double result_value = jit_func(args_ptr);
+            if (jit::is_jit_unwind(result_value)) {
+                // A trampolined callee failed; compiled frames have already returned
+                VmResult failure = std::move(*context.pending);
+                context.pending.reset();
+                if (trace_stream_ != nullptr) {
+                    *trace_stream_ << "exit function " << function.name;
+                    if (failure.status == VmStatus::Success && failure.has_value) {
+                        *trace_stream_ << " = " << failure.value;
+                    } else {
+                        *trace_stream_ << " status=" << static_cast<int>(failure.status);
+                        if (!failure.message.empty()) {
+                            *trace_stream_ << " message='" << failure.message << "'";
+                        }
+                    }
+                    *trace_stream_ << '\n';
+                }
+                if (trace_writer_ != nullptr) {
+                    trace_writer_->exit_function(id, failure);
+                }
+                return failure;
+            }
             
             // Write exit trace for JIT-compiled functions
             if (trace_stream_ != nullptr) {
@@ -307,23 +1340,13 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
                 *trace_stream_ << " = " << result_value;
                 *trace_stream_ << '\n';
             }
+            if (trace_writer_ != nullptr) {
+                trace_writer_->exit_function(id, result_value);
+            }
             
             // Update profiling data
             if (profiling_enabled_) {
-                const auto end_time = std::chrono::high_resolution_clock::now();
-                const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-                std::string full_name = module.name + "::" + function.name;
-                auto& profile = profiling_data_[full_name];
-                profile.full_name = full_name;
-                profile.call_count++;
-                profile.total_time += duration;
-                if (duration < profile.min_time) {
-                    profile.min_time = duration;
-                }
-                if (duration > profile.max_time) {
-                    profile.max_time = duration;
-                }
-                profile.was_jit_compiled = was_jit_compiled;
+                update_profile(true);
             }
             
             VmResult result;
@@ -338,46 +1361,126 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
         // JIT compilation failed or not suitable, fall through to interpreter
     }
 
-    auto call_function = [this, &module, output_buffer](const ir::Function& target,
-                                                        const std::vector<Value>& args) -> VmResult {
-        std::unordered_map<std::string, Value> call_params;
-        call_params.reserve(target.parameters.size());
-        for (std::size_t i = 0; i < target.parameters.size() && i < args.size(); ++i) {
-            call_params[target.parameters[i].name] = args[i];
-        }
-        return execute_function(module, target, call_params, output_buffer);
+    // The callbacks capture this and one pointer, so std::function keeps them without allocating
+    struct CallContext {
+        ExecutionContext& execution;
+        const LoadedModule& module;
+        FunctionId id;
+        const SharedTierCounters& counters;
+        OsrCacheEntry* osr = nullptr;  // the loop entry tried last
+    };
+    CallContext call_context{context, module, id, counters};
+
+    auto call_function = [this, &call_context](std::size_t target, const std::vector<Value>& args) -> VmResult {
+        return execute_function(call_context.execution, call_context.module,
+                                call_context.module.first_function + static_cast<FunctionId>(target), args);
     };
 
-    auto allocate_array = [this](std::size_t length) -> GcObject* { return heap_.allocate_array(length); };
-    auto collect_fn = [this]() { maybe_collect(); };
-    auto read_line = [this]() -> std::optional<std::string> {
+    GcHeap* heap = &context.heap;
+    auto allocate_array = [heap](std::size_t length) -> GcObject* { return heap->allocate_float64_array(length); };
+    auto allocate_string = [heap](std::string text) -> GcObject* { return heap->allocate_string(std::move(text)); };
+    auto collect_fn = [this, &context]() { maybe_collect(context); };
+    auto read_line = [this, &context]() -> std::optional<std::string_view> {
+        std::string& line = context.input;
         if (read_line_provider_) {
-            if (auto provided = read_line_provider_()) {
-                return provided;
+            auto provided = read_line_provider_();
+            if (!provided.has_value()) {
+                return std::nullopt;
             }
-            return std::string{};
+            line = std::move(*provided);
+            return std::string_view(line);
+        }
+        if (input_source_ != nullptr) {
+            return input_source_->next_line();
         }
         if (input_stream_ != nullptr) {
-            std::string line;
             if (std::getline(*input_stream_, line)) {
-                return line;
+                return std::string_view(line);
             }
             if (input_stream_->eof()) {
                 input_stream_->clear();
             }
-            return std::string{};
         }
-        return std::string{};
+        return std::nullopt;
     };
 
     if (trace_stream_ != nullptr) {
         *trace_stream_ << "enter function " << function.name << '\n';
     }
+    if (trace_writer_ != nullptr) {
+        trace_writer_->define_function(id, function.name);
+        trace_writer_->enter_function(id);
+    }
 
-    SsaInterpreter interpreter(*ssa_ptr, parameters, locals, module.module.functions, module.globals,
-                               std::move(call_function), std::move(allocate_array), std::move(collect_fn),
-                               output_buffer, trace_stream_, std::move(read_line));
-    auto result = interpreter.run();
+    SsaInterpreter interpreter(*ssa_ptr, frame_layout, bytecode, frame, arguments, module.module.functions,
+                               module.globals,
+                               std::move(call_function), std::move(allocate_array), std::move(allocate_string),
+                               std::move(collect_fn),
+                               &context.output, trace_stream_, std::move(read_line));
+    interpreter.set_back_edge_counter(&counters.back_edges);
+    interpreter.set_parallel_map([this, &call_context](const std::string& builtin, std::size_t target,
+                                                       const std::vector<double>& inputs,
+                                                       std::vector<double>& outputs) {
+        return parallel_map(call_context.execution, call_context.module,
+                            call_context.module.first_function + static_cast<FunctionId>(target), builtin, inputs,
+                            outputs);
+    });
+    if (trace_writer_ != nullptr) {
+        interpreter.set_trace_writer(trace_writer_, id);
+    }
+    // Tracing and profiling report every call with its own enter and exit
+    interpreter.set_tail_calls(!tracing() && !profiling_enabled_);
+    if (block_profiling_enabled_) {
+        interpreter.set_block_counters(cached.block_entries.get());
+    }
+    interpreter.set_write_barrier(
+        [heap](GcObject* object, const Value& value) { heap->write_barrier(object, value); });
+    interpreter.set_resize_hook([heap](GcObject* object) { heap->record_resize(object); });
+    interpreter.set_string_heap(heap);
+    interpreter.set_struct_allocator([heap](const StructLayout& layout) -> GcObject* {
+        return heap->allocate_struct(layout.shape, layout.numeric_count, layout.boxed_count);
+    });
+    interpreter.set_output_sink(output_sink_);
+    if (!read_line_provider_ && (input_source_ != nullptr || input_stream_ != nullptr)) {
+        interpreter.set_read_all([this, &context]() -> std::string_view {
+            if (input_source_ != nullptr) {
+                return input_source_->read_all();
+            }
+            std::string& text = context.input;
+            text.assign(std::istreambuf_iterator<char>(*input_stream_), std::istreambuf_iterator<char>());
+            input_stream_->clear();
+            return text;
+        });
+    }
+    if (jit_enabled_ && !blocks_observed()) {
+        // Tracing keeps the whole call interpreted so every block shows up in the trace
+        interpreter.set_osr_handler(
+            [this, &call_context](SsaInterpreter& running, std::size_t block) -> std::optional<VmResult> {
+                if (call_context.counters.back_edges.load(std::memory_order_relaxed) < tier_thresholds_.back_edges ||
+                    !speculation_allowed(*function_records_[call_context.id])) {
+                    return std::nullopt;
+                }
+                return enter_osr(call_context.execution, call_context.module, call_context.id, block, running,
+                                 call_context.osr);
+            });
+    }
+    // Speculative code runs the call up to where it hands over to the interpreter
+    std::optional<VmResult> finished;
+    if (jit_enabled_ && !blocks_observed() && record.jit_ready.load(std::memory_order_acquire) &&
+        record.jit->speculative != nullptr && speculation_allowed(record)) {
+        finished = run_osr_entry(context, record, *record.jit->speculative, interpreter,
+                                 counters.speculative_entries);
+    }
+    auto result = finished.has_value() ? std::move(*finished) : interpreter.run();
+    bump(context.interpreted_calls);
+    context.interpreter_instructions.store(
+        context.interpreter_instructions.load(std::memory_order_relaxed) + interpreter.instructions_executed(),
+        std::memory_order_relaxed);
+    if (const auto callee = interpreter.tail_call()) {
+        tail = *callee;
+        tail_arguments.assign(interpreter.tail_arguments().begin(), interpreter.tail_arguments().end());
+        return result;
+    }
 
     if (trace_stream_ != nullptr) {
         *trace_stream_ << "exit function " << function.name;
@@ -391,26 +1494,308 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
         }
         *trace_stream_ << '\n';
     }
+    if (trace_writer_ != nullptr) {
+        trace_writer_->exit_function(id, result);
+    }
 
     // Update profiling data for interpreter path
     if (profiling_enabled_) {
-        const auto end_time = std::chrono::high_resolution_clock::now();
-        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-        std::string full_name = module.name + "::" + function.name;
-        auto& profile = profiling_data_[full_name];
-        profile.full_name = full_name;
-        profile.call_count++;
-        profile.total_time += duration;
-        if (duration < profile.min_time) {
-            profile.min_time = duration;
+        update_profile(false);
+    }
+
+    return result;
+}
+
+auto Vm::enter_osr(ExecutionContext& context, const LoadedModule& module, FunctionId id, std::size_t block,
+                   SsaInterpreter& frame, OsrCacheEntry*& last) const -> std::optional<VmResult> {
+    FunctionRecord& record = *function_records_[id];
+    if (last == nullptr || last->block != block) {
+        const std::lock_guard<std::mutex> lock(state_mutex_);
+        auto& slot = record.osr[block];
+        if (slot == nullptr) {
+            const auto start_time = std::chrono::high_resolution_clock::now();
+            slot = std::make_unique<OsrCacheEntry>();
+            slot->block = block;
+            const ir::Function& function = module.module.functions[id - module.first_function];
+            const ir::SsaFunction& ssa = record.ssa->ssa;
+            if (auto plan = jit::plan_osr(ssa, block)) {
+                // Locals carry no declared type in SSA; values are statically typed, so whatever
+                // holds an array or struct now always does (every later entry re-checks below)
+                std::vector<ir::SsaValue> array_inputs;
+                for (const auto& input : plan->inputs) {
+                    const auto value = frame.read_value(input);
+                    if (value.has_value() && value->is_object() && value->as_object() != nullptr) {
+                        array_inputs.push_back(input);
+                    }
+                }
+                slot->arrays = find_array_values(ssa, function, module.structs, array_inputs);
+                if (can_jit_compile_blocks(ssa, function, module.module.functions, module.globals, module.structs,
+                                           slot->arrays, &plan->region)) {
+                    jit::JitCompiler compiler;
+                    auto [func, buffer] = compiler.compile_osr_with_buffer(
+                        ssa, *plan, module.link != nullptr ? &module.link->table : nullptr);
+                    if (func != nullptr) {
+                        publish_code(module.link, record.key + " [osr " + ssa.blocks[block].name + "]", func,
+                                     buffer.code().size());
+                    }
+                    slot->function.store(func, std::memory_order_relaxed);
+                    slot->code_buffer = std::move(buffer);
+                }
+                slot->plan = std::move(*plan);
+            }
+            const std::int64_t elapsed =
+                (std::chrono::high_resolution_clock::now() - start_time) / std::chrono::nanoseconds{1};
+            record.compile_nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+            metrics_.compile_nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+            (slot->function.load(std::memory_order_relaxed) != nullptr ? metrics_.jit_compilations
+                                                                       : metrics_.jit_rejections)
+                .fetch_add(1, std::memory_order_relaxed);
+            if (profiling_enabled_) {
+                record_profile_event(ProfileEvent::Kind::Compile, record.key + " [osr " + ssa.blocks[block].name + "]",
+                                     start_time);
+            }
         }
-        if (duration > profile.max_time) {
-            profile.max_time = duration;
+        last = slot.get();
+    }
+    return run_osr_entry(context, record, *last, frame, record.counters.osr_entries);
+}
+
+auto Vm::run_osr_entry(ExecutionContext& context, FunctionRecord& record, OsrCacheEntry& entry,
+                       SsaInterpreter& frame, std::atomic<std::uint64_t>& entries) const -> std::optional<VmResult> {
+    const jit::JitFunction native = entry.function.load(std::memory_order_relaxed);
+    if (native == nullptr) {
+        return std::nullopt;
+    }
+    const auto is_array = [&](const ir::SsaValue& value) {
+        return entry.arrays.find(ir::encode_ssa_value(value)) != entry.arrays.end();
+    };
+
+    std::vector<double> state(entry.plan.state_size(), 0.0);
+    for (std::size_t i = 0; i < entry.plan.inputs.size(); ++i) {
+        const auto value = frame.read_value(entry.plan.inputs[i]);
+        if (!value.has_value() || value->is_nil()) {
+            if (is_array(entry.plan.inputs[i])) {
+                return std::nullopt;  // compiled code dereferences array values unconditionally
+            }
+            continue;  // not assigned on the path taken so far; the loop cannot read it either
+        }
+        if (is_array(entry.plan.inputs[i]) && value->is_object() && value->as_object() != nullptr) {
+            state[i + 1] = array_to_jit_arg(value->as_object());
+        } else if (!is_array(entry.plan.inputs[i]) && value->is_number()) {
+            state[i + 1] = value->as_number();
+        } else {
+            // Values are statically typed, so this loop would never get numeric inputs
+            entry.function.store(nullptr, std::memory_order_relaxed);
+            return std::nullopt;
         }
-        profile.was_jit_compiled = was_jit_compiled;
     }
 
-    return result;
+    bump(entries);
+    const double result_value = native(state.data());
+    if (jit::is_jit_unwind(result_value)) {
+        VmResult failure = std::move(*context.pending);
+        context.pending.reset();
+        return failure;
+    }
+
+    const auto exit_code = static_cast<std::size_t>(state[0]);
+    if (exit_code == 0) {
+        VmResult result;
+        result.status = VmStatus::Success;
+        result.has_value = true;
+        result.value = result_value;
+        return result;
+    }
+    const jit::OsrExit& exit = entry.plan.exits[exit_code - 1];
+    const ir::SsaFunction& ssa = record.ssa->ssa;
+    for (const auto& [block, index] : entry.plan.deferred) {
+        const ir::SsaInstruction& inst = ssa.blocks[block].instructions[index];
+        frame.write_value(*inst.result, Value::make_string(context.heap.intern_string(inst.immediates[0])));
+    }
+    for (std::size_t i = 0; i < exit.outputs.size(); ++i) {
+        frame.write_value(exit.outputs[i], is_array(exit.outputs[i]) ? array_from_jit_arg(state[i + 1])
+                                                                      : Value::make_number(state[i + 1]));
+    }
+    if (!exit.instruction.has_value()) {
+        frame.resume_at(exit.from, exit.to);
+        return std::nullopt;
+    }
+    if (exit.guard) {
+        bump(record.counters.deopts);
+    }
+    frame.resume_inside(exit.from, *exit.instruction);
+    return std::nullopt;
+}
+
+void Vm::publish_code(const JitLink* link, const std::string& name, jit::JitFunction code,
+                      std::size_t size) const {
+    if (jit_symbols_ != nullptr) {
+        jit_symbols_->add(link, name, reinterpret_cast<const void*>(code), size);
+    }
+}
+
+auto Vm::speculation_allowed(const FunctionRecord& record) const -> bool {
+    return record.counters.deopts.load(std::memory_order_relaxed) < tier_thresholds_.deopts;
+}
+
+auto Vm::find_module(const std::string& name) const -> const LoadedModule* {
+    const auto it = std::find_if(modules_.begin(), modules_.end(),
+                                 [&](const LoadedModule& module) { return module.name == name; });
+    return it != modules_.end() ? &*it : nullptr;
+}
+
+auto Vm::persisted_code(const std::string& module_name) const -> PersistedCode* {
+    const auto it = persisted_code_.find(module_name);
+    return it != persisted_code_.end() ? it->second.get() : nullptr;
+}
+
+auto Vm::direct_jit_calls_allowed() const -> bool {
+    return !tracing() && !profiling_enabled_ && !block_profiling_enabled_;
+}
+
+auto Vm::memoized(const LoadedModule& module, FunctionId id) const -> bool {
+    // Tracing and profiling report every call
+    return memoization_ && !tracing() && !profiling_enabled_ && module.pure[id - module.first_function];
+}
+
+auto Vm::blocks_observed() const -> bool {
+    return tracing() || block_profiling_enabled_;
+}
+
+void Vm::reset_jit_call_entries() const {
+    for (auto& [name, link] : jit_links_) {
+        for (auto& entry : link->table.entries) {
+            entry.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
+
+auto Vm::jit_call_trampoline(jit::JitCallTable* table, std::uint64_t slot, double* args) -> double {
+    auto* link = static_cast<JitLink*>(table->owner);
+    ExecutionContext& context = *active_context_;
+    const LoadedModule* module = link->vm->find_module(link->module_name);
+    if (module == nullptr || slot >= module->module.functions.size()) {
+        context.pending =
+            make_result(VmStatus::MissingSymbol, "call target not found in module '" + link->module_name + "'");
+        return jit::jit_unwind_value();
+    }
+
+    const ir::Function& target = module->module.functions[slot];
+    // A frame of its own holds the converted arguments, which keeps them reported as GC roots
+    FrameGuard arguments_guard(context);
+    std::vector<Value>& arguments = arguments_guard.frame().arguments;
+    for (std::size_t i = 0; i < target.parameters.size(); ++i) {
+        const auto& param = target.parameters[i];
+        arguments.push_back(is_array_type(param.type, module->structs) ? array_from_jit_arg(args[i])
+                                                                        : Value::make_number(args[i]));
+    }
+
+    const auto id = module->first_function + static_cast<FunctionId>(slot);
+    auto result = link->vm->execute_function(context, *module, id, arguments);
+    if (result.status != VmStatus::Success || !result.has_value) {
+        // Mirror the interpreter: a failing (or value-less) callee ends every caller up the chain
+        context.pending = std::move(result);
+        return jit::jit_unwind_value();
+    }
+    return result.value;
+}
+
+void Vm::jit_trap_handler(jit::JitCallTable* /*table*/, std::uint64_t trap) {
+    // Same messages the interpreter reports for these failures
+    std::string message;
+    switch (static_cast<jit::JitTrap>(trap)) {
+        case jit::JitTrap::ArrayGetNotArray: message = "array_get requires an array value"; break;
+        case jit::JitTrap::ArrayGetBadIndex: message = "array_get index must be a non-negative integer"; break;
+        case jit::JitTrap::ArrayGetOutOfBounds: message = "array_get index out of bounds"; break;
+        case jit::JitTrap::ArrayGetNotNumeric: message = "array_get requires a numeric element in compiled code"; break;
+        case jit::JitTrap::ArraySetNotArray: message = "array_set requires an array value"; break;
+        case jit::JitTrap::ArraySetBadIndex: message = "array_set index must be a non-negative integer"; break;
+        case jit::JitTrap::ArraySetOutOfBounds: message = "array_set index out of bounds"; break;
+        case jit::JitTrap::ArrayLengthNotArray: message = "array_length requires an array value"; break;
+        case jit::JitTrap::ModuloBadOperands:
+            message = "modulo requires non-negative integer operands and non-zero divisor";
+            break;
+        case jit::JitTrap::FieldGetNotStruct: message = "field_get requires a struct of the declared type"; break;
+        case jit::JitTrap::FieldSetNotStruct: message = "field_set requires a struct of the declared type"; break;
+        case jit::JitTrap::DivisionByZero: message = "division by zero during execution"; break;
+        default: message = "compiled code raised an unknown trap"; break;
+    }
+    active_context_->pending = make_result(VmStatus::RuntimeError, message);
+}
+
+// The array an argument slot of compiled code holds, or nullptr
+[[nodiscard]] static auto array_from_jit_slot(double slot) -> GcObject* {
+    const Value value = array_from_jit_arg(slot);
+    GcObject* object = value.is_object() ? value.as_object() : nullptr;
+    return object != nullptr && object->is_array() ? object : nullptr;
+}
+
+[[nodiscard]] static auto not_an_array(const std::string& builtin) -> VmResult {
+    return make_result(VmStatus::RuntimeError, builtin + " requires an array value");
+}
+
+auto Vm::jit_natives() -> std::array<jit::JitFunction, jit::kJitNativeCount> {
+    std::array<jit::JitFunction, jit::kJitNativeCount> natives{};
+    const auto define = [&](jit::JitNative id, jit::JitFunction entry) { natives[static_cast<std::size_t>(id)] = entry; };
+    define(jit::JitNative::ArraySum, [](double* args) {
+        const GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_sum(*array) : not_an_array("array_sum"), 0.0);
+    });
+    define(jit::JitNative::ArrayDot, [](double* args) {
+        const GcObject* lhs = array_from_jit_slot(args[0]);
+        const GcObject* rhs = array_from_jit_slot(args[1]);
+        return jit_native_result(lhs != nullptr && rhs != nullptr ? array_dot(*lhs, *rhs) : not_an_array("array_dot"),
+                                 0.0);
+    });
+    define(jit::JitNative::ArrayMin, [](double* args) {
+        const GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_min(*array) : not_an_array("array_min"), 0.0);
+    });
+    define(jit::JitNative::ArrayMax, [](double* args) {
+        const GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_max(*array) : not_an_array("array_max"), 0.0);
+    });
+    define(jit::JitNative::ArrayScale, [](double* args) {
+        GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_scale(*array, args[1]) : not_an_array("array_scale"),
+                                 args[0]);
+    });
+    define(jit::JitNative::ArrayAxpy, [](double* args) {
+        const GcObject* x = array_from_jit_slot(args[1]);
+        GcObject* y = array_from_jit_slot(args[2]);
+        return jit_native_result(x != nullptr && y != nullptr ? array_axpy(args[0], *x, *y) : not_an_array("array_axpy"),
+                                 args[2]);
+    });
+    define(jit::JitNative::ArrayCopy, [](double* args) {
+        GcObject* destination = array_from_jit_slot(args[0]);
+        const GcObject* source = array_from_jit_slot(args[1]);
+        return jit_native_result(destination != nullptr && source != nullptr ? array_copy(*destination, *source)
+                                                                             : not_an_array("array_copy"),
+                                 args[0]);
+    });
+    define(jit::JitNative::ArrayFill, [](double* args) {
+        GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_fill_number(*array, args[1]) : not_an_array("array_fill"),
+                                 args[0]);
+    });
+    define(jit::JitNative::ArraySort, [](double* args) {
+        GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(array != nullptr ? array_sort(*array) : not_an_array("array_sort"), args[0]);
+    });
+    define(jit::JitNative::ArrayBinarySearch, [](double* args) {
+        const GcObject* array = array_from_jit_slot(args[0]);
+        return jit_native_result(
+            array != nullptr ? array_binary_search(*array, args[1]) : not_an_array("array_binary_search"), 0.0);
+    });
+    return natives;
+}
+
+auto Vm::jit_native_result(VmResult result, double updated) -> double {
+    if (result.status != VmStatus::Success) {
+        active_context_->pending = std::move(result);
+        return jit::jit_unwind_value();
+    }
+    return result.has_value ? result.value : updated;
 }
 
 [[nodiscard]] auto Vm::normalize_module_name(const ir::Module& module) -> std::string { 
@@ -419,6 +1804,16 @@ auto Vm::load(ir::Module module) -> VmLoadResult {
 
 void Vm::set_trace_stream(std::ostream* stream) const { 
     trace_stream_ = stream; 
+    if (stream != nullptr) {
+        reset_jit_call_entries();  // route calls through execute_function so they are traced
+    }
+}
+
+void Vm::set_trace_writer(TraceWriter* writer) const {
+    trace_writer_ = writer;
+    if (writer != nullptr) {
+        reset_jit_call_entries();
+    }
 }
 
 void Vm::set_input_stream(std::istream* stream) const { 
@@ -429,94 +1824,661 @@ void Vm::set_read_line_provider(std::function<std::optional<std::string>()> prov
     read_line_provider_ = std::move(provider);
 }
 
+void Vm::set_input_source(InputSource* source) const {
+    input_source_ = source;
+}
+
+void Vm::set_output_sink(OutputSink* sink) const {
+    output_sink_ = sink;
+}
+
 void Vm::set_jit_enabled(bool enabled) const {
     jit_enabled_ = enabled;
 }
 
 void Vm::collect_garbage() const {
-    root_buffer_.clear();
-    gather_roots(root_buffer_);
-    heap_.collect(root_buffer_);
-    root_buffer_.clear();
+    collect(thread_context());
+}
+
+void Vm::collect(ExecutionContext& context) const {
+    const bool observed = profiling_enabled_ || gc_callback_;
+    const auto start_time = observed ? std::chrono::high_resolution_clock::now()
+                                     : std::chrono::high_resolution_clock::time_point{};
+    const std::uint64_t freed_before = gc_callback_ ? context.heap.stats().bytes_freed : 0;
+    context.root_buffer.clear();
+    gather_roots(context, context.root_buffer);
+    context.heap.collect(context.root_buffer);
+    context.root_buffer.clear();
+    if (observed) {
+        end_gc_pause(context, GcEvent::Kind::Full, start_time, freed_before);
+    }
+}
+
+void Vm::end_gc_pause(ExecutionContext& context, GcEvent::Kind kind,
+                      std::chrono::high_resolution_clock::time_point start, std::uint64_t freed_before) const {
+    if (profiling_enabled_) {
+        static constexpr const char* kNames[] = {"gc minor", "gc full", "gc mark", "gc sweep"};
+        record_profile_event(ProfileEvent::Kind::Gc, kNames[static_cast<std::size_t>(kind)], start);
+    }
+    if (gc_callback_) {
+        GcEvent event;
+        event.kind = kind;
+        event.pause = context.heap.last_pause();
+        event.bytes_freed = context.heap.stats().bytes_freed - freed_before;
+        event.heap_bytes = context.heap.bytes_allocated();
+        gc_callback_(event);
+    }
+}
+
+auto Vm::thread_context() const -> ExecutionContext& {
+    const std::lock_guard<std::mutex> lock(contexts_mutex_);
+    auto& context = contexts_[std::this_thread::get_id()];
+    if (context == nullptr) {
+        context = std::make_unique<ExecutionContext>();
+        context->heap.set_pacing(gc_pacing_);
+        context->heap.set_collector_threads(gc_threads_);
+    }
+    return *context;
+}
+
+void Vm::set_gc_pacing(const GcPacing& pacing) const {
+    const std::lock_guard<std::mutex> lock(contexts_mutex_);
+    gc_pacing_ = pacing;
+    for (auto& [thread, context] : contexts_) {
+        context->heap.set_pacing(pacing);
+    }
+}
+
+auto Vm::gc_pacing() const -> GcPacing {
+    const std::lock_guard<std::mutex> lock(contexts_mutex_);
+    return gc_pacing_;
+}
+
+void Vm::set_gc_threads(std::size_t threads) const {
+    const std::lock_guard<std::mutex> lock(contexts_mutex_);
+    gc_threads_ = threads;
+    for (auto& [thread, context] : contexts_) {
+        context->heap.set_collector_threads(threads);
+    }
+}
+
+void Vm::set_parallel_threads(std::size_t threads) const {
+    const std::lock_guard<std::mutex> lock(parallel_mutex_);
+    parallel_threads_ = threads;
+    parallel_pool_.reset();
+}
+
+auto Vm::parallel_map(ExecutionContext& context, const LoadedModule& module, FunctionId id, const std::string& builtin,
+                      const std::vector<double>& inputs, std::vector<double>& outputs) const
+    -> std::optional<VmResult> {
+    // Pure callees touch no heap object and no binding that may change, so threads cannot race
+    const ir::Function& function = module.module.functions[id - module.first_function];
+    if (!module.pure[id - module.first_function]) {
+        return make_result(VmStatus::RuntimeError,
+                           builtin + " requires a pure function, and '" + function.name + "' is not");
+    }
+    outputs.assign(inputs.size(), 0.0);
+
+    // The batch is hot by definition: compile the callee now rather than after a few calls
+    jit::JitFunction native = nullptr;
+    if (jit_enabled_ && direct_jit_calls_allowed() && !function.blocks.empty()) {
+        [[maybe_unused]] const CachedSsa& built = cached_ssa(module, id);
+        FunctionRecord& record = *function_records_[id];
+        if (!record.jit_ready.load(std::memory_order_acquire) &&
+            !record.compile_claimed.exchange(true, std::memory_order_relaxed)) {
+            compile_function(module, id);
+        }
+        if (record.jit_ready.load(std::memory_order_acquire) && record.jit->can_jit) {
+            native = record.jit->function;
+        }
+    }
+    if (native == nullptr) {
+        std::vector<Value> arguments(1);
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            arguments[0] = Value::make_number(inputs[i]);
+            VmResult result = execute_function(context, module, id, arguments);
+            if (result.status != VmStatus::Success) {
+                return result;
+            }
+            outputs[i] = result.value;
+        }
+        return std::nullopt;
+    }
+
+    TaskPool* pool = nullptr;
+    {
+        const std::lock_guard<std::mutex> lock(parallel_mutex_);
+        if (parallel_pool_ == nullptr) {
+            const std::size_t hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+            parallel_pool_ = std::make_unique<TaskPool>(parallel_threads_ != 0 ? parallel_threads_ : hardware);
+        }
+        pool = parallel_pool_.get();
+    }
+    // Elements past the first failure are skipped, but every one before it runs, so the failure
+    // reported is the one a sequential loop would have hit
+    constexpr std::size_t kMinChunk = 256;
+    std::atomic<std::size_t> first_failure{inputs.size()};
+    std::mutex failure_mutex;
+    std::optional<VmResult> failure;
+    const std::size_t chunk = std::max(inputs.size() / (pool->threads() * 8), kMinChunk);
+    pool->run(inputs.size(), chunk, [&](std::size_t participant, std::size_t begin, std::size_t end) {
+        ExecutionContext* const outer = active_context_;
+        ExecutionContext& running = participant == 0 ? context : thread_context();
+        active_context_ = &running;  // for traps and trampolined callees
+        for (std::size_t i = begin; i < end && i < first_failure.load(std::memory_order_relaxed); ++i) {
+            double argument = inputs[i];
+            const double value = native(&argument);
+            if (!jit::is_jit_unwind(value)) {
+                outputs[i] = value;
+                continue;
+            }
+            VmResult failed = std::move(*running.pending);
+            running.pending.reset();
+            const std::lock_guard<std::mutex> lock(failure_mutex);
+            if (i < first_failure.load(std::memory_order_relaxed)) {
+                first_failure.store(i, std::memory_order_relaxed);
+                failure = std::move(failed);
+            }
+            break;
+        }
+        active_context_ = outer;
+    });
+    context.parallel_elements.store(
+        context.parallel_elements.load(std::memory_order_relaxed) + inputs.size(), std::memory_order_relaxed);
+    return failure;
+}
+
+void Vm::set_optimization_options(const ir::OptimizationOptions& options) {
+    optimization_options_ = options;
+}
+
+void Vm::set_code_cache_directory(std::string directory) {
+    code_cache_directory_ = std::move(directory);
+}
+
+auto Vm::metrics() const -> VmMetrics {
+    VmMetrics metrics;
+    {
+        const std::lock_guard<std::mutex> lock(contexts_mutex_);
+        for (const auto& [thread, context] : contexts_) {
+            const GcStats stats = context->heap.stats();
+            GcStats& gc = metrics.gc;
+            gc.full_collections += stats.full_collections;
+            gc.minor_collections += stats.minor_collections;
+            gc.pauses += stats.pauses;
+            gc.total_pause += stats.total_pause;
+            gc.max_pause = std::max(gc.max_pause, stats.max_pause);
+            gc.objects_freed += stats.objects_freed;
+            gc.bytes_freed += stats.bytes_freed;
+            gc.bytes_promoted += stats.bytes_promoted;
+            gc.live_bytes += stats.live_bytes;
+            gc.peak_bytes += stats.peak_bytes;
+            ++metrics.gc_threads;
+            metrics.interpreted_calls += context->interpreted_calls.load(std::memory_order_relaxed);
+            metrics.interpreter_instructions += context->interpreter_instructions.load(std::memory_order_relaxed);
+            metrics.ssa_cache_lookups += context->ssa_lookups.load(std::memory_order_relaxed);
+            metrics.memo_hits += context->memo_hits.load(std::memory_order_relaxed);
+            metrics.parallel_elements += context->parallel_elements.load(std::memory_order_relaxed);
+        }
+    }
+    metrics.jit_compilations = metrics_.jit_compilations.load(std::memory_order_relaxed);
+    metrics.jit_rejections = metrics_.jit_rejections.load(std::memory_order_relaxed);
+    metrics.code_cache_hits = metrics_.code_cache_hits.load(std::memory_order_relaxed);
+    metrics.jit_compile_time = std::chrono::nanoseconds{metrics_.compile_nanoseconds.load(std::memory_order_relaxed)};
+    metrics.ssa_cache_misses = metrics_.ssa_misses.load(std::memory_order_relaxed);
+    for (const auto& [name, link] : jit_links_) {
+        metrics.code_bytes += link->code.bytes_used();
+        metrics.code_bytes_reserved += link->code.bytes_reserved();
+    }
+    for (const auto& record : function_records_) {
+        metrics.calls += record->counters.calls.load(std::memory_order_relaxed);
+        metrics.osr_entries += record->counters.osr_entries.load(std::memory_order_relaxed);
+        metrics.speculative_entries += record->counters.speculative_entries.load(std::memory_order_relaxed);
+        metrics.deopts += record->counters.deopts.load(std::memory_order_relaxed);
+    }
+    return metrics;
+}
+
+void Vm::set_gc_callback(GcCallback callback) {
+    gc_callback_ = std::move(callback);
+}
+
+void Vm::set_jit_symbols(jit::JitSymbolOptions options) {
+    jit_symbols_ = options.any() ? std::make_unique<jit::JitSymbols>(std::move(options)) : nullptr;
+}
+
+auto Vm::save_code_cache() const -> bool {
+    wait_for_background_compilation();
+    const std::lock_guard<std::mutex> lock(state_mutex_);
+    bool saved = true;
+    for (auto& [module_name, persisted] : persisted_code_) {
+        const LoadedModule* module = find_module(module_name);
+        if (!persisted->dirty.load(std::memory_order_relaxed) || module == nullptr) {
+            continue;
+        }
+
+        // Start from the file's entries (views into its mapping) and overlay this run's work
+        auto functions = persisted->contents.functions;
+        std::vector<std::string> encoded(module->module.functions.size());
+        for (std::size_t i = 0; i < module->module.functions.size(); ++i) {
+            const std::string& name = module->module.functions[i].name;
+            const FunctionRecord& record = *function_records_[module->first_function + i];
+            PersistedFunction& function = functions[name];
+            if (record.ssa_ready.load(std::memory_order_acquire)) {
+                ir::BinaryWriter out(encoded[i]);
+                ir::serialize_ssa(record.ssa->ssa, out);
+                function.ssa = encoded[i];
+            }
+            if (!record.jit_ready.load(std::memory_order_acquire)) {
+                continue;  // not compiled, or still being compiled on another thread
+            }
+            const JitCacheEntry& entry = *record.jit;
+            const auto& code = entry.code_buffer.code();
+            if (!code.empty()) {
+                function.jit_checked = true;
+                function.can_jit = entry.function != nullptr;
+                function.code = std::string_view(reinterpret_cast<const char*>(code.data()), code.size());
+                function.relocations = entry.code_buffer.relocations();
+            } else if (!entry.can_jit) {
+                function.jit_checked = true;
+                function.can_jit = false;
+                function.code = {};
+                function.relocations.clear();
+            }
+            // Otherwise the code was linked from the file, which already holds it
+        }
+        if (write_code_cache(persisted->path, persisted->key, functions)) {
+            persisted->dirty.store(false, std::memory_order_relaxed);
+        } else {
+            saved = false;
+        }
+    }
+    return saved;
+}
+
+void Vm::set_precompiled_code(std::string path) {
+    precompiled_code_ = std::move(path);
+}
+
+auto Vm::bind_precompiled_code(const LoadedModule& module, std::uint64_t key) const -> std::size_t {
+    const MappedFile file(precompiled_code_);
+    const auto object = jit::read_object_file(file.contents());
+    if (!object.has_value() || object->key != key) {
+        return 0;
+    }
+    const std::string prefix = module.name + "::";
+    std::size_t bound = 0;
+    for (const auto& function : object->functions) {
+        const auto slot = function.name.compare(0, prefix.size(), prefix) == 0
+                              ? module.link->table.slots.find(function.name.substr(prefix.size()))
+                              : module.link->table.slots.end();
+        if (slot == module.link->table.slots.end()) {
+            continue;
+        }
+        FunctionRecord& record = *function_records_[module.first_function + slot->second];
+        if (record.jit_ready.load(std::memory_order_acquire)) {
+            continue;  // kept over a reload
+        }
+        JitCacheEntry entry;
+        entry.can_jit = true;
+        entry.function = jit::link_code(std::vector<uint8_t>(function.code.begin(), function.code.end()),
+                                        function.relocations, module.link->table);
+        if (entry.function == nullptr) {
+            continue;
+        }
+        // The call table slot is left for the first call to fill, once tracing and profiling are
+        // known (see direct_jit_calls_allowed)
+        publish_code(module.link, record.key, entry.function, function.code.size());
+        metrics_.code_cache_hits.fetch_add(1, std::memory_order_relaxed);
+        record.compile_claimed.store(true, std::memory_order_relaxed);
+        record.jit = std::move(entry);
+        record.jit_ready.store(true, std::memory_order_release);
+        ++bound;
+    }
+    return bound;
+}
+
+auto Vm::write_precompiled_code(const std::string& module_name, const std::string& path) const
+    -> std::optional<std::size_t> {
+    wait_for_background_compilation();
+    const std::lock_guard<std::mutex> lock(state_mutex_);
+    const LoadedModule* module = find_module(module_name);
+    if (module == nullptr || module->link == nullptr) {
+        return std::nullopt;
+    }
+    jit::JitObject object;
+    object.key = code_cache_key(module->module, module->link->table.arrays, optimization_options_, module->structs);
+    const PersistedCode* persisted = persisted_code(module_name);
+    for (std::size_t i = 0; i < module->module.functions.size(); ++i) {
+        const FunctionRecord& record = *function_records_[module->first_function + i];
+        if (!record.jit_ready.load(std::memory_order_acquire) || record.jit->function == nullptr) {
+            continue;
+        }
+        jit::JitObjectFunction function{record.key, {}, {}};
+        const auto& buffer = record.jit->code_buffer;
+        if (!buffer.code().empty()) {
+            function.code = std::string_view(reinterpret_cast<const char*>(buffer.code().data()), buffer.code().size());
+            function.relocations = buffer.relocations();
+        } else if (persisted != nullptr) {
+            // Linked from the code cache, which still maps it
+            const auto saved = persisted->contents.functions.find(module->module.functions[i].name);
+            if (saved != persisted->contents.functions.end() && saved->second.can_jit) {
+                function.code = saved->second.code;
+                function.relocations = saved->second.relocations;
+            }
+        }
+        if (!function.code.empty()) {  // otherwise bound from another precompiled object
+            object.functions.push_back(std::move(function));
+        }
+    }
+    const std::string bytes = jit::write_object_file(object);
+    if (bytes.empty()) {
+        return std::nullopt;
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+        return std::nullopt;
+    }
+    return object.functions.size();
 }
 
-void Vm::push_frame(std::unordered_map<std::string, Value>& locals, std::vector<Value>& stack) const {
-    ExecutionFrame frame;
-    frame.locals = &locals;
-    frame.stack = &stack;
-    frames_.push_back(frame);
+auto Vm::ExecutionContext::acquire_frame() -> InterpreterFrame& {
+    if (frame_depth == frame_pool.size()) {
+        frame_pool.push_back(std::make_unique<InterpreterFrame>());
+    }
+    InterpreterFrame& frame = *frame_pool[frame_depth++];
+    frame.reset(0);  // nothing of an earlier call may be reported as a root
+    return frame;
 }
 
-void Vm::pop_frame() const {
-    if (!frames_.empty()) {
-        frames_.pop_back();
+void Vm::ExecutionContext::release_frame() {
+    if (frame_depth != 0) {
+        --frame_depth;
     }
 }
 
-void Vm::gather_roots(std::vector<Value*>& out) const {
+void Vm::gather_roots(const ExecutionContext& context, std::vector<Value*>& out) const {
     for (const auto& module : modules_) {
         for (const auto& entry : module.globals) {
             out.push_back(const_cast<Value*>(&entry.second));
         }
     }
 
-    for (const auto& frame : frames_) {
-        if (frame.locals != nullptr) {
-            for (auto& pair : *frame.locals) {
-                out.push_back(&pair.second);
-            }
+    for (std::size_t depth = 0; depth < context.frame_depth; ++depth) {
+        InterpreterFrame& frame = *context.frame_pool[depth];
+        for (auto& pair : frame.locals) {
+            out.push_back(&pair.second);
         }
-        if (frame.stack != nullptr) {
-            for (auto& value : *frame.stack) {
+        if (frame.precise_roots) {
+            for (std::size_t i = 0; i < frame.live_count; ++i) {
+                out.push_back(&frame.registers[frame.live_slots[i]]);
+            }
+        } else {
+            for (auto& value : frame.registers) {
                 out.push_back(&value);
             }
         }
+        for (auto& value : frame.arguments) {
+            out.push_back(&value);
+        }
+    }
+}
+
+void Vm::maybe_collect(ExecutionContext& context) const {
+    GcHeap& heap = context.heap;
+    const bool observed = profiling_enabled_ || gc_callback_;
+    const auto start_time = observed ? std::chrono::high_resolution_clock::now()
+                                     : std::chrono::high_resolution_clock::time_point{};
+    const std::uint64_t freed_before = gc_callback_ ? heap.stats().bytes_freed : 0;
+    std::optional<GcEvent::Kind> pause;  // the step taken, if any
+    if (heap.marking()) {
+        pause = GcEvent::Kind::Mark;
+        if (heap.mark_step()) {
+            context.root_buffer.clear();
+            gather_roots(context, context.root_buffer);
+            heap.finish_marking(context.root_buffer);
+            context.root_buffer.clear();
+        }
+    } else {
+        if (heap.sweeping()) {
+            pause = GcEvent::Kind::Sweep;
+            heap.sweep_step();
+        }
+        if (heap.should_collect() && heap.incremental()) {
+            pause = GcEvent::Kind::Mark;
+            context.root_buffer.clear();
+            gather_roots(context, context.root_buffer);
+            heap.start_marking(context.root_buffer);
+            context.root_buffer.clear();
+        } else if (heap.should_collect()) {
+            collect(context);  // records its own pause
+        } else if (heap.should_collect_minor()) {
+            pause = GcEvent::Kind::Minor;
+            context.root_buffer.clear();
+            gather_roots(context, context.root_buffer);
+            heap.collect_minor(context.root_buffer);
+            context.root_buffer.clear();
+        }
+    }
+    if (pause.has_value() && observed) {
+        end_gc_pause(context, *pause, start_time, freed_before);
     }
 }
 
-void Vm::maybe_collect() const {
-    if (heap_.should_collect()) {
-        collect_garbage();
+auto Vm::find_record(const std::string& module_name, const std::string& function_name) const
+    -> const FunctionRecord* {
+    const auto id = function_id(module_name, function_name);
+    return id.has_value() ? function_records_[*id].get() : nullptr;
+}
+
+auto Vm::function_id(const std::string& module_name, const std::string& function_name) const
+    -> std::optional<FunctionId> {
+    const LoadedModule* module = find_module(module_name);
+    if (module == nullptr) {
+        return std::nullopt;
+    }
+    const auto& functions = module->module.functions;
+    const auto it = std::find_if(functions.begin(), functions.end(),
+                                 [&](const ir::Function& function) { return function.name == function_name; });
+    if (it == functions.end()) {
+        return std::nullopt;
     }
+    return module->first_function + static_cast<FunctionId>(it - functions.begin());
 }
 
 auto Vm::is_function_cached(const std::string& module_name, const std::string& function_name) const -> bool {
-    std::string cache_key = module_name + "::" + function_name;
-    return jit_cache_.find(cache_key) != jit_cache_.end();
+    const FunctionRecord* record = find_record(module_name, function_name);
+    return record != nullptr && record->jit_ready.load(std::memory_order_acquire);
 }
 
 auto Vm::is_function_jit_compiled(const std::string& module_name, const std::string& function_name) const -> bool {
-    std::string cache_key = module_name + "::" + function_name;
-    auto it = jit_cache_.find(cache_key);
-    if (it != jit_cache_.end()) {
-        return it->second.can_jit && it->second.function != nullptr;
-    }
-    return false;
+    const FunctionRecord* record = find_record(module_name, function_name);
+    return record != nullptr && record->jit_ready.load(std::memory_order_acquire) && record->jit->can_jit &&
+           record->jit->function != nullptr;
 }
 
 auto Vm::get_jit_cache_size() const -> size_t {
-    return jit_cache_.size();
+    return static_cast<std::size_t>(
+        std::count_if(function_records_.begin(), function_records_.end(), [](const auto& record) {
+            return record->jit_ready.load(std::memory_order_acquire);
+        }));
+}
+
+void Vm::set_memoization(bool enabled) const {
+    memoization_ = enabled;
+    if (enabled) {
+        reset_jit_call_entries();  // route calls to pure functions through execute_function
+    }
+}
+
+void Vm::set_tier_thresholds(TierThresholds thresholds) const {
+    tier_thresholds_ = thresholds;
+}
+
+auto Vm::tier_thresholds() const -> TierThresholds {
+    return tier_thresholds_;
+}
+
+auto Vm::function_tier(const std::string& module_name, const std::string& function_name) const -> ExecutionTier {
+    return is_function_jit_compiled(module_name, function_name) ? ExecutionTier::Jit : ExecutionTier::Interpreter;
+}
+
+auto Vm::function_tier_counters(const std::string& module_name, const std::string& function_name) const
+    -> TierCounters {
+    const FunctionRecord* record = find_record(module_name, function_name);
+    if (record == nullptr) {
+        return TierCounters{};
+    }
+    TierCounters counters;
+    counters.calls = record->counters.calls.load(std::memory_order_relaxed);
+    counters.back_edges = record->counters.back_edges.load(std::memory_order_relaxed);
+    counters.osr_entries = record->counters.osr_entries.load(std::memory_order_relaxed);
+    counters.speculative_entries = record->counters.speculative_entries.load(std::memory_order_relaxed);
+    counters.deopts = record->counters.deopts.load(std::memory_order_relaxed);
+    return counters;
 }
 
 void Vm::set_profiling_enabled(bool enabled) const {
+    if (enabled && !profiling_enabled_) {
+        const std::lock_guard<std::mutex> lock(profile_events_mutex_);
+        if (profile_events_.empty()) {
+            profile_epoch_ = std::chrono::high_resolution_clock::now();
+        }
+    }
     profiling_enabled_ = enabled;
+    if (enabled) {
+        reset_jit_call_entries();  // route calls through execute_function so they are counted
+    }
 }
 
 void Vm::reset_profiling() const {
-    profiling_data_.clear();
+    {
+        const std::lock_guard<std::mutex> lock(profile_events_mutex_);
+        profile_events_.clear();
+        dropped_profile_events_ = 0;
+        profile_epoch_ = std::chrono::high_resolution_clock::now();
+    }
+    const std::lock_guard<std::mutex> lock(state_mutex_);
+    for (auto& record : function_records_) {
+        record->profile = FunctionProfile{};
+        if (record->ssa_ready.load(std::memory_order_acquire)) {
+            for (std::size_t b = 0; b < record->ssa->ssa.blocks.size(); ++b) {
+                record->ssa->block_entries[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
 }
 
-void Vm::dump_profiling_results(std::ostream& out) const {
-    if (profiling_data_.empty()) {
-        out << "No profiling data collected.\n";
+void Vm::set_block_profiling_enabled(bool enabled) const {
+    block_profiling_enabled_ = enabled;
+    if (enabled) {
+        reset_jit_call_entries();  // route calls through execute_function so their blocks are counted
+    }
+}
+
+auto Vm::get_block_profile() const -> std::vector<BlockProfile> {
+    std::vector<BlockProfile> profile;
+    const std::lock_guard<std::mutex> lock(state_mutex_);
+    for (const auto& record : function_records_) {
+        if (!record->ssa_ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+        const ir::SsaFunction& ssa = record->ssa->ssa;
+        for (std::size_t b = 0; b < ssa.blocks.size(); ++b) {
+            const std::uint64_t entries = record->ssa->block_entries[b].load(std::memory_order_relaxed);
+            if (entries == 0) {
+                continue;
+            }
+            BlockProfile block;
+            block.function = record->key;
+            block.block = b;
+            block.label = ssa.blocks[b].name;
+            block.entries = entries;
+            block.instructions = entries * ssa.blocks[b].instructions.size();
+            for (const auto& inst : ssa.blocks[b].instructions) {
+                block.code.push_back(ir::ssa_instruction_to_string(inst));
+            }
+            profile.push_back(std::move(block));
+        }
+    }
+    std::sort(profile.begin(), profile.end(), [](const BlockProfile& lhs, const BlockProfile& rhs) {
+        if (lhs.instructions != rhs.instructions) {
+            return lhs.instructions > rhs.instructions;
+        }
+        return lhs.function != rhs.function ? lhs.function < rhs.function : lhs.block < rhs.block;
+    });
+    return profile;
+}
+
+void Vm::record_profile_event(ProfileEvent::Kind kind, std::string name,
+                              std::chrono::high_resolution_clock::time_point start,
+                              std::chrono::high_resolution_clock::time_point end) const {
+    const std::lock_guard<std::mutex> lock(profile_events_mutex_);
+    if (profile_events_.size() >= kMaxProfileEvents) {
+        ++dropped_profile_events_;
         return;
     }
+    ProfileEvent event;
+    event.kind = kind;
+    event.name = std::move(name);
+    event.thread = profile_threads_.emplace(std::this_thread::get_id(), profile_threads_.size()).first->second;
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - profile_epoch_);
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+    profile_events_.push_back(std::move(event));
+}
 
-    // Convert to vector and sort by total time (descending)
+auto Vm::get_profile_report() const -> ProfileReport {
+    ProfileReport report;
+    {
+        const std::lock_guard<std::mutex> lock(state_mutex_);
+        for (const auto& record : function_records_) {
+            const FunctionProfile& profile = record->profile;
+            if (profile.call_count == 0) {
+                continue;
+            }
+            FunctionProfileSummary summary;
+            summary.function = record->key;
+            summary.calls = profile.call_count;
+            summary.total = profile.total_time;
+            summary.min = profile.min_time;
+            summary.max = profile.max_time;
+            summary.compile_time = std::chrono::nanoseconds{record->compile_nanoseconds.load(std::memory_order_relaxed)};
+            const JitCacheEntry* jit = record->jit_ready.load(std::memory_order_acquire) ? &*record->jit : nullptr;
+            const bool osr = std::any_of(record->osr.begin(), record->osr.end(), [](const auto& slot) {
+                return slot.second->function.load(std::memory_order_relaxed) != nullptr;
+            });
+            if (jit != nullptr && jit->function != nullptr) {
+                summary.tier = "jit";
+            } else if (jit != nullptr && jit->speculative != nullptr) {
+                summary.tier = "speculative";
+            } else {
+                summary.tier = osr ? "osr" : "interpreter";
+            }
+            report.functions.push_back(std::move(summary));
+        }
+    }
+    std::sort(report.functions.begin(), report.functions.end(),
+              [](const FunctionProfileSummary& lhs, const FunctionProfileSummary& rhs) {
+                  return lhs.total != rhs.total ? lhs.total > rhs.total : lhs.function < rhs.function;
+              });
+    const std::lock_guard<std::mutex> lock(profile_events_mutex_);
+    report.events = profile_events_;
+    report.dropped_events = dropped_profile_events_;
+    return report;
+}
+
+void Vm::dump_profiling_results(std::ostream& out) const {
+    // Collect the profiled functions and sort by total time (descending)
+    const std::lock_guard<std::mutex> lock(state_mutex_);
     std::vector<const FunctionProfile*> profiles;
-    profiles.reserve(profiling_data_.size());
-    for (const auto& [name, profile] : profiling_data_) {
-        profiles.push_back(&profile);
+    for (const auto& record : function_records_) {
+        if (record->profile.call_count != 0) {
+            profiles.push_back(&record->profile);
+        }
+    }
+    if (profiles.empty()) {
+        out << "No profiling data collected.\n";
+        return;
     }
     std::sort(profiles.begin(), profiles.end(), 
         [](const FunctionProfile* a, const FunctionProfile* b) {
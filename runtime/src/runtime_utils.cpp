@@ -15,43 +15,6 @@ namespace impulse::runtime {
 
 // encode_value_id, to_index, and make_result are now inline in the header for performance
 
-[[nodiscard]] auto strip_numeric_separators(const std::string& literal) -> std::string {
-    std::string sanitized;
-    sanitized.reserve(literal.size());
-    for (char ch : literal) {
-        if (ch != '_') {
-            sanitized.push_back(ch);
-        }
-    }
-    return sanitized;
-}
-
-[[nodiscard]] auto parse_literal(const std::string& operand) -> std::optional<double> {
-    if (operand.empty()) {
-        return std::nullopt;
-    }
-    if (operand == "true") {
-        return 1.0;
-    }
-    if (operand == "false") {
-        return 0.0;
-    }
-    try {
-        const std::string sanitized = strip_numeric_separators(operand);
-        if (sanitized.empty()) {
-            return std::nullopt;
-        }
-        size_t processed = 0;
-        const double value = std::stod(sanitized, &processed);
-        if (processed != sanitized.size() || !std::isfinite(value)) {
-            return std::nullopt;
-        }
-        return value;
-    } catch (...) {
-        return std::nullopt;
-    }
-}
-
 [[nodiscard]] auto format_ssa_value(const ir::SsaValue& value) -> std::string {
     if (!value.is_valid()) {
         return "<invalid>";
@@ -143,8 +106,11 @@ namespace impulse::runtime {
             if (value.object == nullptr) {
                 return "object@null";
             }
-            if (value.object->kind == ObjectKind::Array) {
-                return "[array length=" + std::to_string(value.object->fields.size()) + "]";
+            if (value.object->is_array()) {
+                return "[array length=" + std::to_string(value.object->array_length()) + "]";
+            }
+            if (value.object->kind == ObjectKind::Struct) {
+                return "[struct shape=" + std::to_string(value.object->shape) + "]";
             }
             std::ostringstream out;
             out << "object@" << static_cast<const void*>(value.object);
@@ -182,8 +148,12 @@ namespace impulse::runtime {
                 out << "object@null";
                 break;
             }
-            if (value.object->kind == ObjectKind::Array) {
-                out << "[array length=" << value.object->fields.size() << "]";
+            if (value.object->is_array()) {
+                out << "[array length=" << value.object->array_length() << "]";
+                break;
+            }
+            if (value.object->kind == ObjectKind::Struct) {
+                out << "[struct shape=" << value.object->shape << "]";
                 break;
             }
             out << "object@" << static_cast<const void*>(value.object);
@@ -0,0 +1,85 @@
+#include "impulse/runtime/serve.h"
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+#include "impulse/runtime/input_source.h"
+#include "impulse/runtime/output_sink.h"
+
+namespace impulse::runtime {
+
+namespace {
+
+constexpr std::size_t kReadChunkBytes = std::size_t{64} << 10;
+
+// Digits only, so "-1" and "+1" are refused rather than wrapped or skipped
+[[nodiscard]] auto parse_byte_count(const std::string& text) -> std::optional<std::size_t> {
+    if (text.empty() || text.size() > 10 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return std::nullopt;
+    }
+    const auto count = std::stoull(text);
+    if (count > kMaxRequestInputBytes) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(count);
+}
+
+}  // namespace
+
+auto serve_requests(const Vm& vm, const std::string& module_name, std::istream& in, std::ostream& out,
+                    std::ostream& errors) -> int {
+    std::string header;
+    while (std::getline(in, header)) {
+        std::istringstream fields(header);
+        std::string command;
+        std::string entry;
+        std::string size;
+        const auto input_bytes = fields >> command >> entry >> size ? parse_byte_count(size) : std::nullopt;
+        if (command != "run" || !input_bytes.has_value()) {
+            errors << "Malformed request: " << header << '\n';
+            return 2;
+        }
+        // Read a chunk at a time, so a header claiming more than the stream holds costs no more
+        std::string text;
+        while (text.size() < *input_bytes) {
+            const std::size_t before = text.size();
+            const std::size_t wanted = std::min(kReadChunkBytes, *input_bytes - before);
+            text.resize(before + wanted);
+            in.read(text.data() + before, static_cast<std::streamsize>(wanted));
+            text.resize(before + static_cast<std::size_t>(in.gcount()));
+            if (text.size() != before + wanted) {
+                errors << "Request input ended after " << text.size() << " of " << *input_bytes << " bytes\n";
+                return 2;
+            }
+        }
+
+        InputSource input(std::move(text));
+        std::string output;
+        OutputSink sink([&](std::string_view chunk) { output.append(chunk); });
+        vm.set_input_source(&input);
+        vm.set_output_sink(&sink);
+        const auto result = vm.run(module_name, entry);
+        vm.set_output_sink(nullptr);
+        vm.set_input_source(nullptr);
+        // Nothing a run allocated outlives it (globals only hold numbers)
+        vm.collect_garbage();
+
+        if (result.status == VmStatus::Success) {
+            const long long exit_code = result.has_value ? std::llround(result.value) : 0;
+            out << "exit " << exit_code << ' ' << output.size() << '\n' << output;
+        } else {
+            const std::string reason = result.message.empty() ? "runtime execution failed" : result.message;
+            out << "error " << reason.size() << '\n' << reason;
+        }
+        out.flush();
+    }
+    return 0;
+}
+
+}  // namespace impulse::runtime
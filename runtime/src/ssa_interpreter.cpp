@@ -11,69 +11,48 @@
 #include <string_view>
 #include <unordered_map>
 
+#include "impulse/runtime/array_kernels.h"
 #include "impulse/runtime/runtime_utils.h"
 
 using impulse::runtime::kEpsilon;
 
 namespace impulse::runtime {
 
-// Static builtin table - initialized once
-std::unordered_map<std::string, SsaInterpreter::BuiltinHandler> SsaInterpreter::builtin_table_;
-bool SsaInterpreter::builtin_table_initialized_ = false;
+// Static builtin table - initialized once, by whichever thread needs it first
+std::vector<SsaInterpreter::Builtin> SsaInterpreter::builtins_;
+std::unordered_map<std::string, std::uint32_t> SsaInterpreter::builtin_ids_;
 
-SsaInterpreter::SsaInterpreter(const ir::SsaFunction& ssa, const std::unordered_map<std::string, Value>& parameters,
-                               std::unordered_map<std::string, Value>& locals, const std::vector<ir::Function>& functions,
+SsaInterpreter::SsaInterpreter(const ir::SsaFunction& ssa, const SsaFrameLayout& layout, const SsaBytecode& code,
+                               InterpreterFrame& frame, const std::vector<Value>& arguments,
+                               const std::vector<ir::Function>& functions,
                                const std::unordered_map<std::string, Value>& globals, CallFunction call_function,
-                               AllocateArray allocate_array, MaybeCollect maybe_collect, std::string* output_buffer,
+                               AllocateArray allocate_array, AllocateString allocate_string,
+                               MaybeCollect maybe_collect, std::string* output_buffer,
                                std::ostream* trace, ReadLine read_line)
     : ssa_(ssa),
-      parameters_(parameters),
-      locals_(locals),
+      locals_(frame.locals),
       functions_(functions),
       globals_(globals),
+      layout_(layout),
+      code_(code),
+      frame_(frame),
+      registers_(frame.registers),
+      defined_(frame.defined),
+      call_arguments_(frame.arguments),
       call_function_(std::move(call_function)),
       allocate_array_(std::move(allocate_array)),
+      allocate_string_(std::move(allocate_string)),
       maybe_collect_(std::move(maybe_collect)),
       output_buffer_(output_buffer),
       trace_(trace),
+      tracing_(trace != nullptr),
       read_line_(std::move(read_line)) {
-    for (const auto& block : ssa_.blocks) {
-        block_lookup_.emplace(block.name, block.id);
-    }
-    
-    // Build function lookup map for O(1) function lookup (performance optimization)
-    for (const auto& func : functions_) {
-        function_lookup_[func.name] = &func;
-    }
+    frame.reset(layout_.slots.size());
 
-    // Build symbol ID to name cache to avoid repeated find_symbol calls (performance optimization)
-    for (const auto& symbol : ssa_.symbols) {
-        if (!symbol.name.empty()) {
-            symbol_id_to_name_[symbol.id] = symbol.name;
-        }
+    for (std::size_t i = 0; i < layout_.parameters.size() && i < arguments.size(); ++i) {
+        store_slot(layout_.parameters[i], arguments[i]);
     }
 
-    // Build phi predecessor cache for faster phi materialization (performance optimization)
-    for (const auto& block : ssa_.blocks) {
-        for (const auto& phi : block.phi_nodes) {
-            const std::uint64_t phi_key = encode_value_id(phi.result);
-            auto& pred_map = phi_predecessor_cache_[phi_key];
-            for (const auto& input : phi.inputs) {
-                if (input.value.has_value()) {
-                    pred_map[input.predecessor] = &input;
-                }
-            }
-        }
-    }
-
-    // Initialize parameters using cached symbol lookup
-    for (const auto& [name, value] : parameters_) {
-        const auto* symbol = ssa_.find_symbol(name);
-        if (symbol != nullptr) {
-            store_value(ir::SsaValue{symbol->id, 1}, value);
-        }
-    }
-    
     // Ensure built-in function table is initialized (lazy, once)
     ensure_builtin_table();
 }
@@ -83,455 +62,546 @@ auto SsaInterpreter::run() -> VmResult {
         return make_result(VmStatus::ModuleError, "function has no basic blocks");
     }
 
+    // The entry block, or where compiled code handed the call over (see resume_at)
     std::size_t current = 0;
-    std::optional<std::size_t> previous;
+    std::size_t pc = 0;
+    std::optional<VmResult> entered;
+    if (!osr_resume_.has_value()) {
+        entered = enter_block(current, pc, std::nullopt, false);
+    } else {
+        const Resume resume = *osr_resume_;
+        osr_resume_.reset();
+        current = resume.block;
+        if (resume.instruction.has_value()) {
+            pc = resume_pc(current, *resume.instruction);
+        } else {
+            entered = enter_block(current, pc, resume.previous, resume.block <= resume.previous);
+        }
+    }
+    if (entered.has_value()) {
+        return *entered;
+    }
 
-    while (current < ssa_.blocks.size()) {
-        const auto& block = ssa_.blocks[current];
+    const BytecodeInstruction* const code = code_.code.data();
+    const double* const constants = code_.constants.data();
 
-        trace_block_entry(block);
+    // Takes the edge current -> target and continues at the target's first instruction
+    const auto jump = [&](std::uint32_t target) -> std::optional<VmResult> {
+        const bool back_edge = target <= current;
+        if (back_edge && back_edge_counter_ != nullptr) {
+            back_edge_counter_->store(back_edge_counter_->load(std::memory_order_relaxed) + 1,
+                                      std::memory_order_relaxed);
+        }
+        const std::size_t previous = current;
+        current = target;
+        return enter_block(current, pc, previous, back_edge);
+    };
 
-        if (auto error = materialize_phi(block, previous)) {
-            return *error;
+    // Dense opcode switch over fixed-width instructions; compilers lower it to a jump table
+    for (;;) {
+        const BytecodeInstruction& inst = code[pc];
+        if (tracing_) {
+            trace_instruction(current, pc);
         }
+        ++pc;
 
-        bool jumped = false;
-        for (const auto& inst : block.instructions) {
-            if (auto outcome = execute_instruction(block, inst, current, previous, jumped)) {
-                return *outcome;
+        switch (inst.op) {
+            case BytecodeOp::LoadNumber:
+                store_number(inst.dst, constants[inst.a]);
+                break;
+            case BytecodeOp::LoadString:
+                enter_safepoint(inst);
+                store_string_object(inst.dst, literal_string(code_.strings[inst.a]));
+                break;
+            case BytecodeOp::Move: {
+                const Value* value = lookup_slot(inst.a);
+                if (value == nullptr) {
+                    return make_result(VmStatus::RuntimeError, "assign instruction missing source value");
+                }
+                store_slot(inst.dst, *value);
+                break;
             }
-            if (jumped) {
+            case BytecodeOp::Drop:
+                if (lookup_slot(inst.a) == nullptr) {
+                    return make_result(VmStatus::RuntimeError, "drop instruction missing value");
+                }
+                break;
+            case BytecodeOp::Neg:
+            case BytecodeOp::Not: {
+                const Value* operand = lookup_slot(inst.a);
+                if (operand == nullptr || !operand->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "unary instruction requires numeric operand");
+                }
+                const double value = operand->number;
+                store_number(inst.dst, inst.op == BytecodeOp::Neg ? -value : (value == 0.0 ? 1.0 : 0.0));
+                break;
+            }
+            case BytecodeOp::Add:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left + right; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Sub:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left - right; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Mul:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left * right; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Lt:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left < right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Le:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left <= right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Gt:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left > right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Ge:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left >= right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Eq:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left == right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Ne:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return left != right ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::And:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return (left != 0.0 && right != 0.0) ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Or:
+                if (auto outcome = numeric_binary(inst, [](double left, double right) { return (left != 0.0 || right != 0.0) ? 1.0 : 0.0; })) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Div:
+            case BytecodeOp::Mod: {
+                const Value* lhs = lookup_slot(inst.a);
+                const Value* rhs = lookup_slot(inst.b);
+                if (lhs == nullptr || rhs == nullptr) {
+                    return make_result(VmStatus::RuntimeError, "binary instruction missing operands");
+                }
+                if (auto outcome = execute_binary(inst, *lhs, *rhs)) {
+                    return *outcome;
+                }
+                break;
+            }
+            case BytecodeOp::Return: {
+                const Value* value = lookup_slot(inst.a);
+                if (value == nullptr || !value->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "return value must be numeric");
+                }
+                VmResult result;
+                result.status = VmStatus::Success;
+                result.has_value = true;
+                result.value = value->number;
+                trace_return(*value);
+                return result;
+            }
+            case BytecodeOp::Jump:
+                trace_branch(inst.a, true);
+                if (auto outcome = jump(inst.a)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::Fallthrough:
+                if (auto outcome = jump(inst.a)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::JumpIf: {
+                const Value* condition = lookup_slot(inst.a);
+                if (condition == nullptr || !condition->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "branch_if requires numeric condition");
+                }
+                std::uint32_t target = inst.b;
+                if (std::abs(condition->number - constants[inst.dst]) < kEpsilon) {
+                    trace_branch(target, true);
+                } else {
+                    target = inst.c;
+                    if (target == SsaBytecode::kNoBlock) {
+                        return make_result(VmStatus::RuntimeError, "branch_if missing fallthrough successor");
+                    }
+                    trace_branch(target, false);
+                }
+                if (auto outcome = jump(target)) {
+                    return *outcome;
+                }
+                break;
+            }
+            case BytecodeOp::Call:
+            case BytecodeOp::TailCall:
+                if (auto outcome = execute_call(inst)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::ArrayMake:
+                if (auto outcome = execute_array_make(inst)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::ArrayGet: {
+                const Value* arrayValue = lookup_slot(inst.a);
+                const Value* indexValue = lookup_slot(inst.b);
+                if (arrayValue == nullptr || indexValue == nullptr || !indexValue->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "array_get requires valid array and numeric index");
+                }
+                GcObject* object = arrayValue->as_object();
+                if (object == nullptr || !object->is_array()) {
+                    return make_result(VmStatus::RuntimeError, "array_get requires an array value");
+                }
+                const double indexNum = indexValue->number;
+                if (indexNum < 0.0) {
+                    return make_result(VmStatus::RuntimeError, "array_get index must be a non-negative integer");
+                }
+                const std::size_t index = static_cast<std::size_t>(indexNum);
+                if (indexNum != static_cast<double>(index)) {
+                    return make_result(VmStatus::RuntimeError, "array_get index must be a non-negative integer");
+                }
+                if (index >= object->array_length()) {
+                    return make_result(VmStatus::RuntimeError, "array_get index out of bounds");
+                }
+                store_slot(inst.dst, object->array_get(index));
+                break;
+            }
+            case BytecodeOp::ArraySet: {
+                const Value* arrayValue = lookup_slot(inst.a);
+                const Value* indexValue = lookup_slot(inst.b);
+                const Value* value = lookup_slot(inst.c);
+                if (arrayValue == nullptr || indexValue == nullptr || value == nullptr || !indexValue->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "array_set requires valid array, numeric index, and value");
+                }
+                GcObject* object = arrayValue->as_object();
+                if (object == nullptr || !object->is_array()) {
+                    return make_result(VmStatus::RuntimeError, "array_set requires an array value");
+                }
+                const double indexNum = indexValue->number;
+                if (indexNum < 0.0) {
+                    return make_result(VmStatus::RuntimeError, "array_set index must be a non-negative integer");
+                }
+                const std::size_t index = static_cast<std::size_t>(indexNum);
+                if (indexNum != static_cast<double>(index)) {
+                    return make_result(VmStatus::RuntimeError, "array_set index must be a non-negative integer");
+                }
+                if (index >= object->array_length()) {
+                    return make_result(VmStatus::RuntimeError, "array_set index out of bounds");
+                }
+                object->array_set(index, *value);
+                record_write(object, *value);
+                store_slot(inst.dst, *value);
                 break;
             }
+            case BytecodeOp::ArrayGetInBounds: {
+                // compile_bytecode proved the array and the index defined and the index in range
+                const GcObject* object = registers_[inst.a].as_object();
+                store_slot(inst.dst, object->array_get(static_cast<std::size_t>(registers_[inst.b].number)));
+                break;
+            }
+            case BytecodeOp::ArraySetInBounds: {
+                const Value* value = lookup_slot(inst.c);
+                if (value == nullptr) {
+                    return make_result(VmStatus::RuntimeError, "array_set requires valid array, numeric index, and value");
+                }
+                GcObject* object = registers_[inst.a].as_object();
+                object->array_set(static_cast<std::size_t>(registers_[inst.b].number), *value);
+                record_write(object, *value);
+                store_slot(inst.dst, *value);
+                break;
+            }
+            case BytecodeOp::ArrayLength: {
+                const Value* arrayValue = lookup_slot(inst.a);
+                if (arrayValue == nullptr || !arrayValue->is_object() || arrayValue->as_object() == nullptr ||
+                    !arrayValue->as_object()->is_array()) {
+                    return make_result(VmStatus::RuntimeError, "array_length requires an array value");
+                }
+                store_number(inst.dst, static_cast<double>(arrayValue->as_object()->array_length()));
+                break;
+            }
+            case BytecodeOp::ArrayPush:
+                if (auto outcome = execute_array_push(inst)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::ArrayPop:
+                if (auto outcome = execute_array_pop(inst)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::StructMake:
+                if (auto outcome = execute_struct_make(inst)) {
+                    return *outcome;
+                }
+                break;
+            case BytecodeOp::FieldGetNumber: {
+                const GcObject* object = struct_operand(inst);
+                if (object == nullptr) {
+                    return field_error(inst);
+                }
+                store_number(inst.dst, object->numbers[inst.c]);
+                break;
+            }
+            case BytecodeOp::FieldGetValue: {
+                const GcObject* object = struct_operand(inst);
+                if (object == nullptr) {
+                    return field_error(inst);
+                }
+                store_slot(inst.dst, object->fields[inst.c]);
+                break;
+            }
+            case BytecodeOp::FieldSetNumber: {
+                GcObject* object = struct_operand(inst);
+                const Value* value = lookup_slot(inst.dst);
+                if (object == nullptr || value == nullptr) {
+                    return field_error(inst);
+                }
+                if (!value->is_number()) {
+                    return make_result(VmStatus::RuntimeError, "field_set of a numeric field requires a number");
+                }
+                object->numbers[inst.c] = value->number;
+                break;
+            }
+            case BytecodeOp::FieldSetValue: {
+                GcObject* object = struct_operand(inst);
+                const Value* value = lookup_slot(inst.dst);
+                if (object == nullptr || value == nullptr) {
+                    return field_error(inst);
+                }
+                object->fields[inst.c] = *value;
+                record_write(object, *value);
+                break;
+            }
+            case BytecodeOp::Fail:
+                return make_result(static_cast<VmStatus>(inst.a), code_.strings[inst.b]);
         }
+    }
+}
 
-        if (next_block_.has_value()) {
-            previous = current;
-            current = *next_block_;
-            next_block_.reset();
-            continue;
+auto SsaInterpreter::enter_block(std::size_t& current, std::size_t& pc, std::optional<std::size_t> previous,
+                                 bool back_edge) -> std::optional<VmResult> {
+    for (;;) {
+        const auto& block = ssa_.blocks[current];
+        trace_block_entry(block);
+        if (block_counters_ != nullptr) {
+            auto& count = block_counters_[current];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         }
 
-        if (!jumped) {
-            if (const auto fallback = pick_fallthrough(block)) {
-                previous = current;
-                current = *fallback;
-                continue;
-            }
-            return make_result(VmStatus::RuntimeError, "control flow terminated without return");
+        if (auto error = materialize_phi(block, previous)) {
+            return error;
+        }
+        pc = code_.block_start[current];
+        instructions_ += (current + 1 < code_.block_start.size() ? code_.block_start[current + 1] : code_.code.size()) - pc;
+        if (!back_edge || !osr_handler_) {
+            return std::nullopt;
+        }
+        report_live(code_.block_live[current]);  // compiled code may call back into the collector
+        if (auto outcome = osr_handler_(*this, current)) {
+            return outcome;
         }
+        if (!osr_resume_.has_value()) {
+            return std::nullopt;
+        }
+        const Resume resume = *osr_resume_;
+        osr_resume_.reset();
+        current = resume.block;
+        if (resume.instruction.has_value()) {
+            pc = resume_pc(current, *resume.instruction);
+            return std::nullopt;
+        }
+        back_edge = resume.block <= resume.previous;
+        previous = resume.previous;
+    }
+}
+
+auto SsaInterpreter::resume_pc(std::size_t block, std::size_t instruction) const -> std::size_t {
+    // The block's first bytecode instruction from that SSA instruction on (its fallthrough, when
+    // the instruction itself produced no code)
+    const std::size_t end = block + 1 < code_.block_start.size() ? code_.block_start[block + 1] : code_.code.size();
+    std::size_t pc = code_.block_start[block];
+    while (pc + 1 < end && code_.sources[pc] < instruction) {
+        ++pc;
     }
+    return pc;
+}
 
-    return make_result(VmStatus::RuntimeError, "function did not encounter a return instruction");
+auto SsaInterpreter::literal_string(const std::string& text) -> GcObject* {
+    return string_heap_ != nullptr ? string_heap_->intern_string(text) : allocate_string_(text);
+}
+
+auto SsaInterpreter::concat_strings(const Value& lhs, const Value& rhs) -> GcObject* {
+    if (string_heap_ != nullptr && lhs.object != nullptr && rhs.object != nullptr) {
+        return string_heap_->concat_strings(lhs.object, rhs.object);
+    }
+    std::string combined{lhs.as_string()};
+    combined.append(rhs.as_string());
+    return allocate_string_(std::move(combined));
+}
+
+auto SsaInterpreter::slice_string(const Value& text, std::size_t start, std::size_t count) -> GcObject* {
+    if (string_heap_ != nullptr && text.object != nullptr) {
+        return string_heap_->slice_string(text.object, start, count);
+    }
+    return allocate_string_(std::string(text.as_string().substr(start, count)));
 }
 
 // append_output and trace_builtin are now inline in the header for performance
 
 auto SsaInterpreter::materialize_phi(const ir::SsaBlock& block, std::optional<std::size_t> previous)
     -> std::optional<VmResult> {
-    // Fast path: skip if no phi nodes
-    if (block.phi_nodes.empty()) {
-        return std::nullopt;
-    }
-    
-    for (const auto& phi : block.phi_nodes) {
-        if (!phi.result.is_valid()) {
+    const auto& phis = layout_.blocks[block.id].phis;
+    for (std::size_t i = 0; i < phis.size(); ++i) {
+        const auto& phi = phis[i];
+        if (phi.result == SsaFrameLayout::kNoSlot) {
             return make_result(VmStatus::ModuleError, "phi node missing result value");
         }
 
-        std::optional<Value> incoming;
+        // The input from the edge just taken, else the first input that is defined
+        const Value* incoming = nullptr;
         if (previous.has_value()) {
-            // Use cached phi predecessor lookup instead of std::find_if
-            const std::uint64_t phi_key = encode_value_id(phi.result);
-            const auto cacheIt = phi_predecessor_cache_.find(phi_key);
-            if (cacheIt != phi_predecessor_cache_.end()) {
-                const auto& pred_map = cacheIt->second;
-                const auto inputIt = pred_map.find(*previous);
-                if (inputIt != pred_map.end() && inputIt->second->value.has_value()) {
-                    incoming = lookup_value(*inputIt->second->value);
+            for (const auto& [predecessor, slot] : phi.inputs) {
+                if (predecessor == *previous) {
+                    incoming = lookup_slot(slot);
+                    break;
                 }
             }
         }
-
-        if (!incoming.has_value()) {
-            // Fast path: try first input before iterating
-            if (!phi.inputs.empty() && phi.inputs[0].value.has_value()) {
-                incoming = lookup_value(*phi.inputs[0].value);
-            }
-            if (!incoming.has_value()) {
-                for (const auto& input : phi.inputs) {
-                    if (!input.value.has_value()) {
-                        continue;
-                    }
-                    incoming = lookup_value(*input.value);
-                    if (incoming.has_value()) {
-                        break;
-                    }
+        if (incoming == nullptr) {
+            for (const auto& input : phi.inputs) {
+                incoming = lookup_slot(input.second);
+                if (incoming != nullptr) {
+                    break;
                 }
             }
         }
 
-        if (!incoming.has_value()) {
+        if (incoming == nullptr) {
             // Initialize undefined phi to default value (0)
             // This handles variables defined only in conditional branches
-            incoming = Value::make_number(0);
+            store_number(phi.result, 0.0);
+        } else {
+            // Copy first: the input may share a slot's storage with the locals map
+            const Value value = *incoming;
+            store_slot(phi.result, value);
         }
-
-        store_value(phi.result, *incoming);
-        trace_phi_materialization(block, phi, *incoming);
+        trace_phi_materialization(block, block.phi_nodes[i], registers_[phi.result]);
     }
     return std::nullopt;
 }
 
-auto SsaInterpreter::execute_instruction(const ir::SsaBlock& block, const ir::SsaInstruction& inst,
-                                         std::size_t current,
-                                         std::optional<std::size_t>& previous, bool& jumped)
+auto SsaInterpreter::execute_binary(const BytecodeInstruction& inst, const Value& lhs, const Value& rhs)
     -> std::optional<VmResult> {
-    // Trace only if enabled (avoid string operations in hot path)
-    if (trace_ != nullptr) {
-        trace_instruction(block, inst);
-    }
-
-    // Fast opcode dispatch using enum switch (much faster than string comparison)
-    // Compiler generates jump table for O(1) dispatch
-    switch (inst.op) {
-        case ir::SsaOpcode::ArrayGet:
-            return handle_array_get(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Binary:
-            return handle_binary(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::ArraySet:
-            return handle_array_set(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::BranchIf:
-            return handle_branch_if(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Call:
-            return handle_call(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Literal:
-            return handle_literal(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Assign:
-            return handle_assign(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Return:
-            return handle_return(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Branch:
-            return handle_branch(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::ArrayLength:
-            return handle_array_length(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::ArrayMake:
-            return handle_array_make(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Unary:
-            return handle_unary(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::LiteralString:
-            return handle_literal_string(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Drop:
-            return handle_drop(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::ArrayPush:
-            return handle_array_push(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::ArrayPop:
-            return handle_array_pop(block, inst, current, previous, jumped);
-        case ir::SsaOpcode::Unknown:
-            return make_result(VmStatus::ModuleError, "unsupported SSA opcode '" + inst.opcode + "'");
-    }
-
-    return make_result(VmStatus::ModuleError, "unsupported SSA opcode '" + inst.opcode + "'");
-}
-
-auto SsaInterpreter::handle_literal(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (!inst.result.has_value() || inst.immediates.empty()) {
-        return make_result(VmStatus::ModuleError, "literal instruction missing data");
-    }
-    const auto parsed = parse_literal(inst.immediates.front());
-    if (!parsed.has_value()) {
-        return make_result(VmStatus::ModuleError,
-                           "unable to parse literal operand '" + inst.immediates.front() + "'");
-    }
-    store_value(*inst.result, Value::make_number(*parsed));
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_literal_string(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (!inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "literal_string instruction missing result");
-    }
-    const std::string value = inst.immediates.empty() ? std::string{} : inst.immediates.front();
-    store_value(*inst.result, Value::make_string(value));
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_unary(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.empty() || inst.immediates.empty() || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "unary instruction malformed");
-    }
-    const auto operand = lookup_value(inst.arguments.front());
-    if (!operand.has_value() || !operand->is_number()) {
-        return make_result(VmStatus::RuntimeError, "unary instruction requires numeric operand");
-    }
-    const double value = operand->number;
-    const std::string& op = inst.immediates.front();
-    if (op == "!") {
-        store_value(*inst.result, Value::make_number(value == 0.0 ? 1.0 : 0.0));
-    } else if (op == "-") {
-        store_value(*inst.result, Value::make_number(-value));
-    } else {
-        return make_result(VmStatus::ModuleError, "unsupported unary operator '" + op + "'");
-    }
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_binary(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() < 2 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "binary instruction malformed");
-    }
-    const auto lhsValue = lookup_value(inst.arguments[0]);
-    const auto rhsValue = lookup_value(inst.arguments[1]);
-
-    if (!lhsValue.has_value() || !rhsValue.has_value()) {
-        return make_result(VmStatus::RuntimeError, "binary instruction missing operands");
-    }
-
     // String operations - check type first
-    if (lhsValue->is_string() && rhsValue->is_string()) {
-        if (inst.binary_op == ir::BinaryOp::Add) {
-            std::string combined{lhsValue->as_string()};
-            combined.append(rhsValue->as_string());
-            store_value(*inst.result, Value::make_string(std::move(combined)));
+    if (lhs.is_string() && rhs.is_string()) {
+        if (inst.op == BytecodeOp::Add) {
+            enter_safepoint(inst);
+            store_string_object(inst.dst, concat_strings(lhs, rhs));
             return std::nullopt;
         }
-        if (inst.binary_op == ir::BinaryOp::Eq) {
-            store_value(*inst.result, Value::make_number(lhsValue->as_string() == rhsValue->as_string() ? 1.0 : 0.0));
+        // Interned literals compare by identity
+        if (inst.op == BytecodeOp::Eq) {
+            store_number(inst.dst, lhs.object == rhs.object || lhs.as_string() == rhs.as_string() ? 1.0 : 0.0);
             return std::nullopt;
         }
-        if (inst.binary_op == ir::BinaryOp::Ne) {
-            store_value(*inst.result, Value::make_number(lhsValue->as_string() != rhsValue->as_string() ? 1.0 : 0.0));
+        if (inst.op == BytecodeOp::Ne) {
+            store_number(inst.dst, lhs.object != rhs.object && lhs.as_string() != rhs.as_string() ? 1.0 : 0.0);
             return std::nullopt;
         }
     }
 
-    if (!lhsValue->is_number() || !rhsValue->is_number()) {
+    if (!lhs.is_number() || !rhs.is_number()) {
         return make_result(VmStatus::RuntimeError, "binary instruction requires numeric operands");
     }
 
-    const double left = lhsValue->number;
-    const double right = rhsValue->number;
-
-    // Fast binary operator dispatch using enum switch (compiler generates jump table)
-    switch (inst.binary_op) {
-        case ir::BinaryOp::Add:
-            store_value(*inst.result, Value::make_number(left + right));
-            return std::nullopt;
-        case ir::BinaryOp::Sub:
-            store_value(*inst.result, Value::make_number(left - right));
-            return std::nullopt;
-        case ir::BinaryOp::Mul:
-            store_value(*inst.result, Value::make_number(left * right));
-            return std::nullopt;
-        case ir::BinaryOp::Div:
+    const double left = lhs.number;
+    const double right = rhs.number;
+    switch (inst.op) {
+        case BytecodeOp::Div:
             if (std::abs(right) < kEpsilon) {
                 return make_result(VmStatus::RuntimeError, "division by zero during execution");
             }
-            store_value(*inst.result, Value::make_number(left / right));
+            store_number(inst.dst, left / right);
             return std::nullopt;
-        case ir::BinaryOp::Mod: {
+        case BytecodeOp::Mod: {
             const auto leftIndex = to_index(left);
             const auto rightIndex = to_index(right);
             if (!leftIndex.has_value() || !rightIndex.has_value() || *rightIndex == 0) {
                 return make_result(VmStatus::RuntimeError, "modulo requires non-negative integer operands and non-zero divisor");
             }
-            store_value(*inst.result, Value::make_number(static_cast<double>(*leftIndex % *rightIndex)));
+            store_number(inst.dst, static_cast<double>(*leftIndex % *rightIndex));
             return std::nullopt;
         }
-        case ir::BinaryOp::Lt:
-            store_value(*inst.result, Value::make_number(left < right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Le:
-            store_value(*inst.result, Value::make_number(left <= right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Gt:
-            store_value(*inst.result, Value::make_number(left > right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Ge:
-            store_value(*inst.result, Value::make_number(left >= right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Eq:
-            store_value(*inst.result, Value::make_number(left == right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Ne:
-            store_value(*inst.result, Value::make_number(left != right ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::And:
-            store_value(*inst.result, Value::make_number((left != 0.0 && right != 0.0) ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Or:
-            store_value(*inst.result, Value::make_number((left != 0.0 || right != 0.0) ? 1.0 : 0.0));
-            return std::nullopt;
-        case ir::BinaryOp::Unknown:
+        default:
+            // The numeric cases of the other operators never get here
             break;
     }
-
-    // Fallback for unknown operators
-    const std::string& op = inst.immediates.empty() ? "" : inst.immediates.front();
-    return make_result(VmStatus::ModuleError, "unsupported binary operator '" + op + "'");
-}
-
-auto SsaInterpreter::handle_assign(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 1 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "assign instruction malformed");
-    }
-    const auto value = lookup_value(inst.arguments.front());
-    if (!value.has_value()) {
-        return make_result(VmStatus::RuntimeError, "assign instruction missing source value");
-    }
-    store_value(*inst.result, *value);
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_drop(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 1) {
-        return make_result(VmStatus::ModuleError, "drop instruction malformed");
-    }
-    const auto value = lookup_value(inst.arguments.front());
-    if (!value.has_value()) {
-        return make_result(VmStatus::RuntimeError, "drop instruction missing value");
-    }
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_return(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.empty()) {
-        return make_result(VmStatus::RuntimeError, "return instruction requires a value");
-    }
-    const auto value = lookup_value(inst.arguments.front());
-    if (!value.has_value() || !value->is_number()) {
-        return make_result(VmStatus::RuntimeError, "return value must be numeric");
-    }
-    VmResult result;
-    result.status = VmStatus::Success;
-    result.has_value = true;
-    result.value = value->number;
-    trace_return(*value);
-    return result;
-}
-
-auto SsaInterpreter::handle_branch(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t current, std::optional<std::size_t>& previous, bool& jumped) -> std::optional<VmResult> {
-    if (inst.immediates.empty()) {
-        return make_result(VmStatus::ModuleError, "branch instruction missing label");
-    }
-    const auto target = resolve_block(inst.immediates.front());
-    if (!target.has_value()) {
-        return make_result(VmStatus::ModuleError,
-                           "branch to undefined label '" + inst.immediates.front() + "'");
-    }
-    next_block_ = target;
-    trace_branch(*target, true);
-    jumped = true;
-    previous = current;
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_branch_if(const ir::SsaBlock& block, const ir::SsaInstruction& inst, std::size_t current, std::optional<std::size_t>& previous, bool& jumped) -> std::optional<VmResult> {
-    if (inst.arguments.empty() || inst.immediates.empty()) {
-        return make_result(VmStatus::ModuleError, "branch_if instruction malformed");
-    }
-    const auto conditionValue = lookup_value(inst.arguments.front());
-    if (!conditionValue.has_value() || !conditionValue->is_number()) {
-        return make_result(VmStatus::RuntimeError, "branch_if requires numeric condition");
-    }
-    const auto target = resolve_block(inst.immediates.front());
-    if (!target.has_value()) {
-        return make_result(VmStatus::ModuleError,
-                           "branch_if to undefined label '" + inst.immediates.front() + "'");
-    }
-    double compare_val = 0.0;
-    if (inst.immediates.size() >= 2) {
-        try {
-            compare_val = std::stod(inst.immediates[1]);
-        } catch (...) {
-            return make_result(VmStatus::ModuleError,
-                               "branch_if comparison value '" + inst.immediates[1] + "' invalid");
-        }
-    }
-
-    if (std::abs(conditionValue->number - compare_val) < kEpsilon) {
-        next_block_ = target;
-        trace_branch(*target, true);
-    } else {
-        const auto fallback = pick_fallthrough(block, target);
-        if (!fallback.has_value()) {
-            return make_result(VmStatus::RuntimeError, "branch_if missing fallthrough successor");
-        }
-        next_block_ = fallback;
-        trace_branch(*fallback, false);
-    }
-    jumped = true;
-    previous = current;
-    return std::nullopt;
+    return make_result(VmStatus::ModuleError, "unsupported binary operator");
 }
 
-auto SsaInterpreter::handle_call(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.immediates.size() < 2 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "call instruction malformed");
-    }
-    const std::string& callee_name = inst.immediates[0];
-    std::size_t arg_count = 0;
-    try {
-        arg_count = static_cast<std::size_t>(std::stoull(inst.immediates[1]));
-    } catch (...) {
-        return make_result(VmStatus::ModuleError,
-                           "call argument count '" + inst.immediates[1] + "' invalid");
-    }
-
-    if (inst.arguments.size() != arg_count) {
-        return make_result(VmStatus::ModuleError, "call argument mismatch");
-    }
-
-    std::vector<Value> args;
-    args.reserve(arg_count);
-    for (const auto& arg : inst.arguments) {
-        const auto value = lookup_value(arg);
-        if (!value.has_value()) {
+auto SsaInterpreter::execute_call(const BytecodeInstruction& inst) -> std::optional<VmResult> {
+    call_arguments_.clear();
+    for (std::uint32_t i = 0; i < inst.b; ++i) {
+        const Value* value = lookup_slot(code_.operands[inst.a + i]);
+        if (value == nullptr) {
             return make_result(VmStatus::RuntimeError, "call argument not initialized");
         }
-        args.push_back(*value);
+        call_arguments_.push_back(*value);
     }
+    enter_safepoint(inst);
 
-    // Check built-in function table first
-    ensure_builtin_table();
-    const auto builtin_it = builtin_table_.find(callee_name);
-    if (builtin_it != builtin_table_.end()) {
-        return builtin_it->second(this, callee_name, args, inst.result);
-    }
-
-    // Not a built-in, look up in module functions using O(1) map lookup
-    const ir::Function* target_func = nullptr;
-    const auto func_it = function_lookup_.find(callee_name);
-    if (func_it != function_lookup_.end()) {
-        target_func = func_it->second;
+    const BytecodeCallee& callee = code_.callees[inst.c];
+    if (callee.builtin != BytecodeCallee::kNoBuiltin) {
+        const std::optional<ir::SsaValue> result =
+            inst.dst < layout_.slots.size() ? layout_.slots[inst.dst].value : ir::SsaValue{};
+        const Builtin& builtin = builtins_[callee.builtin];
+        return builtin.handler(this, builtin, BuiltinArguments{call_arguments_.data(), call_arguments_.size()}, result);
     }
 
-    if (target_func == nullptr) {
-        return make_result(VmStatus::MissingSymbol, "function '" + callee_name + "' not found");
+    if (callee.function == BytecodeCallee::kNoFunction) {
+        return make_result(VmStatus::MissingSymbol, "function '" + callee.name + "' not found");
     }
-
-    if (target_func->parameters.size() != arg_count) {
+    const ir::Function& target_func = functions_[callee.function];
+    if (target_func.parameters.size() != inst.b) {
         return make_result(
             VmStatus::ModuleError,
-            "function '" + callee_name + "' expects " + std::to_string(target_func->parameters.size()) +
-                " arguments, got " + std::to_string(arg_count));
+            "function '" + callee.name + "' expects " + std::to_string(target_func.parameters.size()) +
+                " arguments, got " + std::to_string(inst.b));
+    }
+
+    if (inst.op == BytecodeOp::TailCall && tail_calls_) {
+        // The arguments stay in the frame for the caller of run() to pick up
+        tail_call_ = callee.function;
+        return make_result(VmStatus::Success, "");
     }
 
-    auto call_result = call_function_(*target_func, args);
+    auto call_result = call_function_(callee.function, call_arguments_);
     if (call_result.status != VmStatus::Success || !call_result.has_value) {
         return call_result;
     }
 
-    store_value(*inst.result, Value::make_number(call_result.value));
+    store_number(inst.dst, call_result.value);
     return std::nullopt;
 }
 
-auto SsaInterpreter::handle_array_make(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 1 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_make instruction malformed");
-    }
-    const auto lengthValue = lookup_value(inst.arguments.front());
-    if (!lengthValue.has_value() || !lengthValue->is_number()) {
+auto SsaInterpreter::execute_array_make(const BytecodeInstruction& inst) -> std::optional<VmResult> {
+    const Value* lengthValue = lookup_slot(inst.a);
+    if (lengthValue == nullptr || !lengthValue->is_number()) {
         return make_result(VmStatus::RuntimeError, "make_array length must be numeric");
     }
     const auto maybeLength = to_index(lengthValue->number);
@@ -539,149 +609,166 @@ auto SsaInterpreter::handle_array_make(const ir::SsaBlock&, const ir::SsaInstruc
         return make_result(VmStatus::RuntimeError, "make_array length must be a non-negative integer");
     }
     GcObject* object = allocate_array_(*maybeLength);
-    const Value allocated = Value::make_object(object);
-    store_value(*inst.result, allocated);
+    store_slot(inst.dst, Value::make_object(object));
+    enter_safepoint(inst);
     maybe_collect_();
     return std::nullopt;
 }
 
-auto SsaInterpreter::handle_array_get(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 2 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_get instruction malformed");
-    }
-    const auto arrayValue = lookup_value(inst.arguments[0]);
-    const auto indexValue = lookup_value(inst.arguments[1]);
-    if (!arrayValue.has_value() || !indexValue.has_value() || !indexValue->is_number()) {
-        return make_result(VmStatus::RuntimeError, "array_get requires valid array and numeric index");
-    }
-    GcObject* object = arrayValue->as_object();
-    if (object == nullptr || object->kind != ObjectKind::Array) {
-        return make_result(VmStatus::RuntimeError, "array_get requires an array value");
-    }
-    // Fast path: convert to index and check bounds in one go
-    const double indexNum = indexValue->number;
-    // Optimized bounds checking: use integer comparison when possible
-    if (indexNum < 0.0) {
-        return make_result(VmStatus::RuntimeError, "array_get index must be a non-negative integer");
-    }
-    const std::size_t index = static_cast<std::size_t>(indexNum);
-    // Check if it's actually an integer (fast path for common case)
-    if (indexNum != static_cast<double>(index)) {
-        return make_result(VmStatus::RuntimeError, "array_get index must be a non-negative integer");
-    }
-    if (index >= object->fields.size()) {
-        return make_result(VmStatus::RuntimeError, "array_get index out of bounds");
-    }
-    store_value(*inst.result, object->fields[index]);
-    return std::nullopt;
-}
-
-auto SsaInterpreter::handle_array_set(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 3 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_set instruction malformed");
-    }
-    const auto arrayValue = lookup_value(inst.arguments[0]);
-    const auto indexValue = lookup_value(inst.arguments[1]);
-    const auto value = lookup_value(inst.arguments[2]);
-    if (!arrayValue.has_value() || !indexValue.has_value() || !value.has_value() || !indexValue->is_number()) {
-        return make_result(VmStatus::RuntimeError, "array_set requires valid array, numeric index, and value");
-    }
-    GcObject* object = arrayValue->as_object();
-    if (object == nullptr || object->kind != ObjectKind::Array) {
-        return make_result(VmStatus::RuntimeError, "array_set requires an array value");
-    }
-    // Fast path: convert to index and check bounds in one go
-    const double indexNum = indexValue->number;
-    // Optimized bounds checking: use integer comparison when possible
-    if (indexNum < 0.0) {
-        return make_result(VmStatus::RuntimeError, "array_set index must be a non-negative integer");
+auto SsaInterpreter::execute_struct_make(const BytecodeInstruction& inst) -> std::optional<VmResult> {
+    const StructLayout& layout = code_.structs[inst.a];
+    if (!allocate_struct_) {
+        return make_result(VmStatus::RuntimeError, "struct_make has no heap to allocate from");
     }
-    const std::size_t index = static_cast<std::size_t>(indexNum);
-    // Check if it's actually an integer (fast path for common case)
-    if (indexNum != static_cast<double>(index)) {
-        return make_result(VmStatus::RuntimeError, "array_set index must be a non-negative integer");
+    // Every field is checked first, so the instance is complete once anything can see it
+    for (std::size_t i = 0; i < layout.fields.size(); ++i) {
+        const Value* value = lookup_slot(code_.operands[inst.b + i]);
+        if (value == nullptr) {
+            return make_result(VmStatus::RuntimeError, "struct_make missing field values");
+        }
+        if (layout.fields[i].numeric && !value->is_number()) {
+            return make_result(VmStatus::RuntimeError,
+                               "field '" + layout.fields[i].name + "' of struct '" + layout.name + "' requires a number");
+        }
     }
-    if (index >= object->fields.size()) {
-        return make_result(VmStatus::RuntimeError, "array_set index out of bounds");
+    GcObject* object = allocate_struct_(layout);
+    for (std::size_t i = 0; i < layout.fields.size(); ++i) {
+        const Value& value = *lookup_slot(code_.operands[inst.b + i]);
+        if (layout.fields[i].numeric) {
+            object->numbers[layout.fields[i].slot] = value.number;
+        } else {
+            object->fields[layout.fields[i].slot] = value;
+            record_write(object, value);
+        }
     }
-    object->fields[index] = *value;
-    store_value(*inst.result, *value);
+    store_slot(inst.dst, Value::make_object(object));
+    enter_safepoint(inst);
+    maybe_collect_();
     return std::nullopt;
 }
 
-auto SsaInterpreter::handle_array_length(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 1 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_length instruction malformed");
-    }
-    const auto arrayValue = lookup_value(inst.arguments.front());
-    if (!arrayValue.has_value() || !arrayValue->is_object() || arrayValue->as_object() == nullptr ||
-        arrayValue->as_object()->kind != ObjectKind::Array) {
-        return make_result(VmStatus::RuntimeError, "array_length requires an array value");
-    }
-    const auto length = static_cast<double>(arrayValue->as_object()->fields.size());
-    store_value(*inst.result, Value::make_number(length));
-    return std::nullopt;
+auto SsaInterpreter::field_error(const BytecodeInstruction& inst) -> VmResult {
+    const bool get = inst.op == BytecodeOp::FieldGetNumber || inst.op == BytecodeOp::FieldGetValue;
+    return make_result(VmStatus::RuntimeError, get ? "field_get requires a struct of the declared type"
+                                                   : "field_set requires a struct of the declared type");
 }
 
-auto SsaInterpreter::handle_array_push(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 2 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_push instruction malformed");
-    }
-    const auto arrayValue = lookup_value(inst.arguments[0]);
-    const auto value = lookup_value(inst.arguments[1]);
-    if (!arrayValue.has_value() || !value.has_value()) {
+auto SsaInterpreter::execute_array_push(const BytecodeInstruction& inst) -> std::optional<VmResult> {
+    const Value* arrayValue = lookup_slot(inst.a);
+    const Value* value = lookup_slot(inst.b);
+    if (arrayValue == nullptr || value == nullptr) {
         return make_result(VmStatus::RuntimeError, "array_push missing arguments");
     }
     GcObject* object = arrayValue->as_object();
-    if (object == nullptr || object->kind != ObjectKind::Array) {
+    if (object == nullptr || !object->is_array()) {
         return make_result(VmStatus::RuntimeError, "array_push requires an array value");
     }
-    object->fields.push_back(*value);
-    store_value(*inst.result, Value::make_number(static_cast<double>(object->fields.size())));
+    object->array_push(*value);
+    record_write(object, *value);
+    store_number(inst.dst, static_cast<double>(object->array_length()));
     return std::nullopt;
 }
 
-auto SsaInterpreter::handle_array_pop(const ir::SsaBlock&, const ir::SsaInstruction& inst, std::size_t, std::optional<std::size_t>&, bool&) -> std::optional<VmResult> {
-    if (inst.arguments.size() != 1 || !inst.result.has_value()) {
-        return make_result(VmStatus::ModuleError, "array_pop instruction malformed");
-    }
-    const auto arrayValue = lookup_value(inst.arguments.front());
-    if (!arrayValue.has_value()) {
+auto SsaInterpreter::execute_array_pop(const BytecodeInstruction& inst) -> std::optional<VmResult> {
+    const Value* arrayValue = lookup_slot(inst.a);
+    if (arrayValue == nullptr) {
         return make_result(VmStatus::RuntimeError, "array_pop missing array argument");
     }
     GcObject* object = arrayValue->as_object();
-    if (object == nullptr || object->kind != ObjectKind::Array) {
+    if (object == nullptr || !object->is_array()) {
         return make_result(VmStatus::RuntimeError, "array_pop requires an array value");
     }
-    if (object->fields.empty()) {
+    if (object->array_length() == 0) {
         return make_result(VmStatus::RuntimeError, "array_pop on empty array");
     }
-    const Value popped = object->fields.back();
-    object->fields.pop_back();
-    store_value(*inst.result, popped);
+    const Value popped = object->array_pop();
+    store_slot(inst.dst, popped);
     return std::nullopt;
 }
 
+auto SsaInterpreter::map_inputs(const Builtin& builtin, const Value& function, const std::vector<double>& inputs,
+                                const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    if (!function.is_string()) {
+        return make_result(VmStatus::RuntimeError, builtin.name + " expects a function name");
+    }
+    const std::string_view name = function.as_string();
+    const auto callee = std::find_if(functions_.begin(), functions_.end(),
+                                     [&](const ir::Function& candidate) { return candidate.name == name; });
+    if (callee == functions_.end()) {
+        return make_result(VmStatus::RuntimeError, builtin.name + ": unknown function '" + std::string(name) + "'");
+    }
+    if (callee->parameters.size() != 1) {
+        return make_result(VmStatus::RuntimeError,
+                           builtin.name + ": '" + std::string(name) + "' must take exactly one argument");
+    }
+    if (!result.has_value()) {
+        return make_result(VmStatus::ModuleError, builtin.name + " requires destination for result");
+    }
 
-// lookup_value and store_value are now inline in the header for performance
+    const auto index = static_cast<std::size_t>(callee - functions_.begin());
+    std::vector<double> outputs;
+    if (parallel_map_) {
+        if (auto failure = parallel_map_(builtin.name, index, inputs, outputs)) {
+            return failure;
+        }
+    } else {
+        outputs.reserve(inputs.size());
+        std::vector<Value> arguments(1);
+        for (const double input : inputs) {
+            arguments[0] = Value::make_number(input);
+            VmResult called = call_function_(index, arguments);
+            if (called.status != VmStatus::Success) {
+                return called;
+            }
+            outputs.push_back(called.value);
+        }
+    }
 
-// resolve_block and pick_fallthrough are now inline in the header for performance
+    GcObject* array = allocate_array_(outputs.size());
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        array->array_set(i, Value::make_number(outputs[i]));
+    }
+    trace_builtin(builtin.name, "len=" + std::to_string(outputs.size()));
+    store_value(*result, Value::make_object(array));
+    maybe_collect_();
+    return std::nullopt;
+}
 
 // Trace functions are now inline in the header for performance
 
 // Ensure builtin table is initialized (lazy initialization)
+auto SsaInterpreter::is_builtin(const std::string& name) -> bool {
+    return find_builtin(name) != BytecodeCallee::kNoBuiltin;
+}
+
+auto SsaInterpreter::find_builtin(const std::string& name) -> std::uint32_t {
+    ensure_builtin_table();
+    const auto it = builtin_ids_.find(name);
+    return it != builtin_ids_.end() ? it->second : BytecodeCallee::kNoBuiltin;
+}
+
+void SsaInterpreter::add_builtin(Builtin builtin) {
+    builtin_ids_[builtin.name] = static_cast<std::uint32_t>(builtins_.size());
+    builtins_.push_back(std::move(builtin));
+}
+
+void SsaInterpreter::add_builtin(const std::string& name, BuiltinHandler handler) {
+    Builtin builtin;
+    builtin.name = name;
+    builtin.handler = handler;
+    add_builtin(std::move(builtin));
+}
+
 void SsaInterpreter::ensure_builtin_table() {
-    if (builtin_table_initialized_) {
-        return;
-    }
-    init_builtin_table_static();
-    builtin_table_initialized_ = true;
+    // A function-local static is initialised exactly once even when threads race here
+    static const bool initialized = (init_builtin_table_static(), true);
+    (void)initialized;
 }
 
 // Builtin function implementations - static initialization, done once
 void SsaInterpreter::init_builtin_table_static() {
     // I/O functions
-    builtin_table_["print"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("print", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "print requires destination for result");
         }
@@ -691,11 +778,11 @@ void SsaInterpreter::init_builtin_table_static() {
             text << format_value_for_output(args[i]);
         }
         self->append_output(text.str(), false);
-        self->trace_builtin(name, text.str());
+        self->trace_builtin(builtin.name, text.str());
         self->store_value(*result, Value::make_number(0.0));
         return std::nullopt;
-    };
-    builtin_table_["println"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    });
+    add_builtin("println", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "println requires destination for result");
         }
@@ -705,13 +792,13 @@ void SsaInterpreter::init_builtin_table_static() {
             text << format_value_for_output(args[i]);
         }
         self->append_output(text.str(), true);
-        self->trace_builtin(name, text.str());
+        self->trace_builtin(builtin.name, text.str());
         self->store_value(*result, Value::make_number(0.0));
         return std::nullopt;
-    };
+    });
     
     // String functions
-    builtin_table_["string_length"] = [](SsaInterpreter* self, const std::string&, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_length", [](SsaInterpreter* self, const Builtin&, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
             return make_result(VmStatus::RuntimeError, "string_length expects exactly one argument");
         }
@@ -724,9 +811,9 @@ void SsaInterpreter::init_builtin_table_static() {
         const auto length = static_cast<double>(args[0].as_string().size());
         self->store_value(*result, Value::make_number(length));
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["string_equals"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_equals", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "string_equals expects exactly two arguments");
         }
@@ -738,11 +825,11 @@ void SsaInterpreter::init_builtin_table_static() {
         }
         const bool equal = args[0].as_string() == args[1].as_string();
         self->store_value(*result, Value::make_number(equal ? 1.0 : 0.0));
-        self->trace_builtin(name, equal ? "true" : "false");
+        self->trace_builtin(builtin.name, equal ? "true" : "false");
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["string_concat"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_concat", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "string_concat expects exactly two arguments");
         }
@@ -752,14 +839,13 @@ void SsaInterpreter::init_builtin_table_static() {
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "string_concat requires destination for result");
         }
-        std::string combined{args[0].as_string()};
-        combined.append(args[1].as_string());
-        self->trace_builtin(name, combined);
-        self->store_value(*result, Value::make_string(std::move(combined)));
+        const Value combined = Value::make_string(self->concat_strings(args[0], args[1]));
+        self->trace_builtin(builtin.name, combined);
+        self->store_string_object(*result, combined.object);
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["string_repeat"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_repeat", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "string_repeat expects exactly two arguments");
         }
@@ -782,12 +868,12 @@ void SsaInterpreter::init_builtin_table_static() {
         for (std::size_t i = 0; i < *maybeCount; ++i) {
             repeated.append(pattern);
         }
-        self->trace_builtin(name, repeated);
-        self->store_value(*result, Value::make_string(std::move(repeated)));
+        self->trace_builtin(builtin.name, repeated);
+        self->store_string(*result, std::move(repeated));
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["string_slice"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_slice", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 3) {
             return make_result(VmStatus::RuntimeError, "string_slice expects exactly three arguments");
         }
@@ -812,51 +898,51 @@ void SsaInterpreter::init_builtin_table_static() {
         if (*maybeStart + *maybeCount > text.size()) {
             return make_result(VmStatus::RuntimeError, "string_slice exceeds string bounds");
         }
-        std::string sliced{text.substr(*maybeStart, *maybeCount)};
-        self->trace_builtin(name, sliced);
-        self->store_value(*result, Value::make_string(std::move(sliced)));
+        const Value sliced = Value::make_string(self->slice_string(args[0], *maybeStart, *maybeCount));
+        self->trace_builtin(builtin.name, sliced);
+        self->store_string_object(*result, sliced.object);
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["string_lower"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_lower", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
-            return make_result(VmStatus::RuntimeError, name + " expects exactly one argument");
+            return make_result(VmStatus::RuntimeError, builtin.name + " expects exactly one argument");
         }
         if (!args[0].is_string()) {
-            return make_result(VmStatus::RuntimeError, name + " expects a string argument");
+            return make_result(VmStatus::RuntimeError, builtin.name + " expects a string argument");
         }
         if (!result.has_value()) {
-            return make_result(VmStatus::ModuleError, name + " requires destination for result");
+            return make_result(VmStatus::ModuleError, builtin.name + " requires destination for result");
         }
         std::string transformed{args[0].as_string()};
         for (char& ch : transformed) {
             ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
         }
-        self->trace_builtin(name, transformed);
-        self->store_value(*result, Value::make_string(std::move(transformed)));
+        self->trace_builtin(builtin.name, transformed);
+        self->store_string(*result, std::move(transformed));
         return std::nullopt;
-    };
+    });
     
-    builtin_table_["string_upper"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_upper", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
-            return make_result(VmStatus::RuntimeError, name + " expects exactly one argument");
+            return make_result(VmStatus::RuntimeError, builtin.name + " expects exactly one argument");
         }
         if (!args[0].is_string()) {
-            return make_result(VmStatus::RuntimeError, name + " expects a string argument");
+            return make_result(VmStatus::RuntimeError, builtin.name + " expects a string argument");
         }
         if (!result.has_value()) {
-            return make_result(VmStatus::ModuleError, name + " requires destination for result");
+            return make_result(VmStatus::ModuleError, builtin.name + " requires destination for result");
         }
         std::string transformed{args[0].as_string()};
         for (char& ch : transformed) {
             ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
         }
-        self->trace_builtin(name, transformed);
-        self->store_value(*result, Value::make_string(std::move(transformed)));
+        self->trace_builtin(builtin.name, transformed);
+        self->store_string(*result, std::move(transformed));
         return std::nullopt;
-    };
+    });
     
-    builtin_table_["string_trim"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("string_trim", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
             return make_result(VmStatus::RuntimeError, "string_trim expects exactly one argument");
         }
@@ -875,57 +961,57 @@ void SsaInterpreter::init_builtin_table_static() {
         while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1])) != 0) {
             --end;
         }
-        std::string trimmed{text.substr(begin, end - begin)};
-        self->trace_builtin(name, trimmed);
-        self->store_value(*result, Value::make_string(std::move(trimmed)));
+        const Value trimmed = Value::make_string(self->slice_string(args[0], begin, end - begin));
+        self->trace_builtin(builtin.name, trimmed);
+        self->store_string_object(*result, trimmed.object);
         return std::nullopt;
-    };
+    });
 
     // Array functions
-    builtin_table_["array_push"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("array_push", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "array_push expects exactly two arguments");
         }
-        if (!args[0].is_object() || args[0].as_object() == nullptr || args[0].as_object()->kind != ObjectKind::Array) {
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
             return make_result(VmStatus::RuntimeError, "array_push requires an array value");
         }
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "array_push requires destination for result");
         }
         GcObject* object = args[0].as_object();
-        object->fields.push_back(args[1]);
-        self->trace_builtin(name, "len=" + std::to_string(object->fields.size()));
+        object->array_push(args[1]);
+        self->record_write(object, args[1]);
+        self->trace_builtin(builtin.name, "len=" + std::to_string(object->array_length()));
         self->store_value(*result, args[0]);
         self->maybe_collect_();
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["array_pop"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("array_pop", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
             return make_result(VmStatus::RuntimeError, "array_pop expects exactly one argument");
         }
-        if (!args[0].is_object() || args[0].as_object() == nullptr || args[0].as_object()->kind != ObjectKind::Array) {
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
             return make_result(VmStatus::RuntimeError, "array_pop requires an array value");
         }
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "array_pop requires destination for result");
         }
         GcObject* object = args[0].as_object();
-        if (object->fields.empty()) {
+        if (object->array_length() == 0) {
             return make_result(VmStatus::RuntimeError, "array_pop cannot operate on an empty array");
         }
-        Value popped = object->fields.back();
-        object->fields.pop_back();
-        self->trace_builtin(name, describe_value(popped));
+        Value popped = object->array_pop();
+        self->trace_builtin(builtin.name, describe_value(popped));
         self->store_value(*result, popped);
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["array_join"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("array_join", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "array_join expects exactly two arguments");
         }
-        if (!args[0].is_object() || args[0].as_object() == nullptr || args[0].as_object()->kind != ObjectKind::Array) {
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
             return make_result(VmStatus::RuntimeError, "array_join requires an array value");
         }
         if (!args[1].is_string()) {
@@ -936,9 +1022,9 @@ void SsaInterpreter::init_builtin_table_static() {
         }
         const std::string_view separator = args[1].as_string();
         std::ostringstream builder;
-        const auto& elements = args[0].as_object()->fields;
-        for (std::size_t i = 0; i < elements.size(); ++i) {
-            const Value& value = elements[i];
+        const GcObject* elements = args[0].as_object();
+        for (std::size_t i = 0; i < elements->array_length(); ++i) {
+            const Value value = elements->array_get(i);
             if (i != 0) builder << separator;
             if (value.is_string()) {
                 builder << value.as_string();
@@ -951,87 +1037,253 @@ void SsaInterpreter::init_builtin_table_static() {
             }
         }
         const std::string merged = builder.str();
-        self->trace_builtin(name, merged);
-        self->store_value(*result, Value::make_string(merged));
+        self->trace_builtin(builtin.name, merged);
+        self->store_string(*result, merged);
         return std::nullopt;
-    };
+    });
 
-    builtin_table_["array_fill"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("array_fill", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "array_fill expects exactly two arguments");
         }
-        if (!args[0].is_object() || args[0].as_object() == nullptr || args[0].as_object()->kind != ObjectKind::Array) {
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
             return make_result(VmStatus::RuntimeError, "array_fill requires an array value");
         }
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "array_fill requires destination for result");
         }
         GcObject* object = args[0].as_object();
-        for (auto& field : object->fields) {
-            field = args[1];
+        if (args[1].is_number()) {
+            (void)array_fill_number(*object, args[1].number);  // cannot fail
+        } else {
+            if (object->kind == ObjectKind::Float64Array) {
+                object->box_elements();
+            }
+            for (std::size_t i = 0; i < object->array_length(); ++i) {
+                object->array_set(i, args[1]);
+            }
+            self->record_write(object, args[1]);
         }
-        self->trace_builtin(name, "len=" + std::to_string(object->fields.size()));
+        self->trace_builtin(builtin.name, "len=" + std::to_string(object->array_length()));
         self->store_value(*result, args[0]);
         return std::nullopt;
+    });
+
+    // The numeric array builtins run on the array kernels (array_kernels.h), which compiled code
+    // calls natively too; both take their signatures from jit::find_jit_native. Reductions
+    // return a number, the others the array they updated.
+    const auto make_array_kernel = [](const std::string& name, ArrayKernelCall kernel) {
+        Builtin builtin;
+        builtin.name = name;
+        builtin.kernel = kernel;
+        builtin.signature = *jit::find_jit_native(name);
+        builtin.handler = [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+            static constexpr const char* kCounts[] = {"no", "one", "two", "three"};
+            const jit::JitNativeSignature& signature = builtin.signature;
+            const std::string& name = builtin.name;
+            if (args.size() != signature.arity) {
+                return make_result(VmStatus::RuntimeError, name + " expects exactly " + kCounts[signature.arity] +
+                                                               (signature.arity == 1 ? " argument" : " arguments"));
+            }
+            for (std::size_t i = 0; i < args.size(); ++i) {
+                if (((signature.array_arguments >> i) & 1U) == 0) {
+                    if (!args[i].is_number()) {
+                        return make_result(VmStatus::RuntimeError, name + " expects a numeric argument");
+                    }
+                } else if (!args[i].is_object() || args[i].as_object() == nullptr || !args[i].as_object()->is_array()) {
+                    return make_result(VmStatus::RuntimeError, name + " requires an array value");
+                }
+            }
+            if (!result.has_value()) {
+                return make_result(VmStatus::ModuleError, name + " requires destination for result");
+            }
+            VmResult outcome = builtin.kernel(args);
+            if (outcome.status != VmStatus::Success) {
+                return outcome;
+            }
+            if (signature.returned_argument < 0) {
+                self->trace_builtin(name, std::to_string(outcome.value));
+                self->store_value(*result, Value::make_number(outcome.value));
+            } else {
+                const Value& updated = args[static_cast<std::size_t>(signature.returned_argument)];
+                self->trace_builtin(name, "len=" + std::to_string(updated.as_object()->array_length()));
+                self->store_value(*result, updated);
+            }
+            return std::nullopt;
+        };
+        add_builtin(std::move(builtin));
     };
-
-    builtin_table_["array_sum"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    make_array_kernel("array_sum", [](BuiltinArguments args) { return array_sum(*args[0].as_object()); });
+    make_array_kernel("array_dot", [](BuiltinArguments args) {
+        return array_dot(*args[0].as_object(), *args[1].as_object());
+    });
+    make_array_kernel("array_min", [](BuiltinArguments args) { return array_min(*args[0].as_object()); });
+    make_array_kernel("array_max", [](BuiltinArguments args) { return array_max(*args[0].as_object()); });
+    make_array_kernel("array_scale", [](BuiltinArguments args) {
+        return array_scale(*args[0].as_object(), args[1].number);
+    });
+    make_array_kernel("array_axpy", [](BuiltinArguments args) {
+        return array_axpy(args[0].number, *args[1].as_object(), *args[2].as_object());
+    });
+    make_array_kernel("array_copy", [](BuiltinArguments args) {
+        return array_copy(*args[0].as_object(), *args[1].as_object());
+    });
+    make_array_kernel("array_sort", [](BuiltinArguments args) { return array_sort(*args[0].as_object()); });
+    make_array_kernel("array_binary_search", [](BuiltinArguments args) {
+        return array_binary_search(*args[0].as_object(), args[1].number);
+    });
+
+    add_builtin("array_sort_by_index", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 1) {
-            return make_result(VmStatus::RuntimeError, "array_sum expects exactly one argument");
+            return make_result(VmStatus::RuntimeError, "array_sort_by_index expects exactly one argument");
         }
-        if (!args[0].is_object() || args[0].as_object() == nullptr || args[0].as_object()->kind != ObjectKind::Array) {
-            return make_result(VmStatus::RuntimeError, "array_sum requires an array value");
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
+            return make_result(VmStatus::RuntimeError, "array_sort_by_index requires an array value");
         }
         if (!result.has_value()) {
-            return make_result(VmStatus::ModuleError, "array_sum requires destination for result");
-        }
-        double total = 0.0;
-        for (const auto& field : args[0].as_object()->fields) {
-            if (field.is_number()) {
-                total += field.number;
-            } else if (!field.is_nil()) {
-                return make_result(VmStatus::RuntimeError, "array_sum encountered non-numeric element");
-            }
+            return make_result(VmStatus::ModuleError, "array_sort_by_index requires destination for result");
+        }
+        std::vector<double> order;
+        VmResult sorted = array_sort_order(*args[0].as_object(), order);
+        if (sorted.status != VmStatus::Success) {
+            return sorted;
+        }
+        GcObject* indices = self->allocate_array_(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            indices->array_set(i, Value::make_number(order[i]));
         }
-        self->trace_builtin(name, std::to_string(total));
-        self->store_value(*result, Value::make_number(total));
+        self->trace_builtin(builtin.name, "len=" + std::to_string(order.size()));
+        self->store_value(*result, Value::make_object(indices));
+        self->maybe_collect_();
         return std::nullopt;
-    };
+    });
+
+    // Data-parallel maps over numbers. The callee is named by a string and takes one number; the
+    // Vm runs compiled pure callees on its task pool.
+    add_builtin("parallel_for", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+        if (args.size() != 3) {
+            return make_result(VmStatus::RuntimeError, "parallel_for expects exactly three arguments");
+        }
+        if (!args[0].is_number() || !args[1].is_number() || !std::isfinite(args[0].number) ||
+            !std::isfinite(args[1].number)) {
+            return make_result(VmStatus::RuntimeError, "parallel_for expects numeric bounds");
+        }
+        std::vector<double> inputs;
+        for (double i = args[0].number; i < args[1].number; i += 1.0) {
+            inputs.push_back(i);
+        }
+        return self->map_inputs(builtin, args[2], inputs, result);
+    });
+    add_builtin("array_map_parallel", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+        if (args.size() != 2) {
+            return make_result(VmStatus::RuntimeError, "array_map_parallel expects exactly two arguments");
+        }
+        if (!args[0].is_object() || args[0].as_object() == nullptr || !args[0].as_object()->is_array()) {
+            return make_result(VmStatus::RuntimeError, "array_map_parallel requires an array value");
+        }
+        const GcObject* array = args[0].as_object();
+        std::vector<double> inputs(array->array_length());
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            const Value element = array->array_get(i);
+            if (!element.is_number()) {
+                return make_result(VmStatus::RuntimeError, "array_map_parallel requires numeric elements");
+            }
+            inputs[i] = element.number;
+        }
+        return self->map_inputs(builtin, args[1], inputs, result);
+    });
 
-    builtin_table_["read_line"] = [](SsaInterpreter* self, const std::string& name, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("read_line", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (!args.empty()) {
             return make_result(VmStatus::RuntimeError, "read_line expects no arguments");
         }
         if (!result.has_value()) {
             return make_result(VmStatus::ModuleError, "read_line requires destination for result");
         }
-        std::string line;
+        std::string_view line;
         if (self->read_line_) {
-            if (auto fetched = self->read_line_()) {
-                line = std::move(*fetched);
+            line = self->read_line_().value_or(std::string_view{});
+        }
+        self->trace_builtin(builtin.name, line);
+        self->store_string(*result, std::string(line));
+        return std::nullopt;
+    });
+
+    add_builtin("read_lines", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+        if (args.size() != 1 || !args[0].is_number()) {
+            return make_result(VmStatus::RuntimeError, "read_lines expects a numeric argument");
+        }
+        const auto limit = to_index(args[0].number);
+        if (!limit.has_value()) {
+            return make_result(VmStatus::RuntimeError, "read_lines count must be a non-negative integer");
+        }
+        if (!result.has_value()) {
+            return make_result(VmStatus::ModuleError, "read_lines requires destination for result");
+        }
+        // Up to `limit` lines, fewer at the end of input. Nothing collects until the array is
+        // complete, so the strings need no rooting of their own.
+        GcObject* lines = self->allocate_array_(0);
+        self->store_value(*result, Value::make_object(lines));
+        while (self->read_line_ && lines->array_length() < *limit) {
+            const std::optional<std::string_view> line = self->read_line_();
+            if (!line.has_value()) {
+                break;
             }
+            const Value text = Value::make_string(self->allocate_string_(std::string(*line)));
+            lines->array_push(text);
+            self->record_write(lines, text);
         }
-        self->trace_builtin(name, line);
-        self->store_value(*result, Value::make_string(std::move(line)));
+        self->trace_builtin(builtin.name, "len=" + std::to_string(lines->array_length()));
+        self->maybe_collect_();
         return std::nullopt;
-    };
+    });
+
+    add_builtin("read_all", [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+        if (!args.empty()) {
+            return make_result(VmStatus::RuntimeError, "read_all expects no arguments");
+        }
+        if (!result.has_value()) {
+            return make_result(VmStatus::ModuleError, "read_all requires destination for result");
+        }
+        std::string text;
+        if (self->read_all_) {
+            text = self->read_all_();
+        } else if (self->read_line_) {
+            // Lines lose their '\n', so only inner line breaks can be restored
+            bool first = true;
+            while (const std::optional<std::string_view> line = self->read_line_()) {
+                if (!first) {
+                    text.push_back('\n');
+                }
+                text.append(*line);
+                first = false;
+            }
+        }
+        self->trace_builtin(builtin.name, "len=" + std::to_string(text.size()));
+        self->store_string(*result, std::move(text));
+        return std::nullopt;
+    });
     
     // Math functions - simple unary
     auto make_unary_math = [](const std::string& name, double (*func)(double)) {
-        builtin_table_[name] = [func, name](SsaInterpreter* self, const std::string&, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+        Builtin builtin;
+        builtin.name = name;
+        builtin.math = func;
+        builtin.handler = [](SsaInterpreter* self, const Builtin& builtin, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
             if (args.size() != 1) {
-                return make_result(VmStatus::RuntimeError, name + " expects exactly one argument");
+                return make_result(VmStatus::RuntimeError, builtin.name + " expects exactly one argument");
             }
             if (!args[0].is_number()) {
-                return make_result(VmStatus::RuntimeError, name + " expects a numeric argument");
+                return make_result(VmStatus::RuntimeError, builtin.name + " expects a numeric argument");
             }
             if (!result.has_value()) {
-                return make_result(VmStatus::ModuleError, name + " requires destination for result");
+                return make_result(VmStatus::ModuleError, builtin.name + " requires destination for result");
             }
-            const double res = func(args[0].number);
+            const double res = builtin.math(args[0].number);
             self->store_value(*result, Value::make_number(res));
             return std::nullopt;
         };
+        add_builtin(std::move(builtin));
     };
     
     make_unary_math("sqrt", std::sqrt);
@@ -1058,7 +1310,7 @@ void SsaInterpreter::init_builtin_table_static() {
     make_unary_math("std::math::log10", std::log10);
     
     // Binary math function
-    builtin_table_["pow"] = [](SsaInterpreter* self, const std::string&, const std::vector<Value>& args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
+    add_builtin("pow", [](SsaInterpreter* self, const Builtin&, BuiltinArguments args, const std::optional<ir::SsaValue>& result) -> std::optional<VmResult> {
         if (args.size() != 2) {
             return make_result(VmStatus::RuntimeError, "pow expects exactly two arguments");
         }
@@ -1071,8 +1323,10 @@ void SsaInterpreter::init_builtin_table_static() {
         const double res = std::pow(args[0].number, args[1].number);
         self->store_value(*result, Value::make_number(res));
         return std::nullopt;
-    };
-    builtin_table_["std::math::pow"] = builtin_table_["pow"];
+    });
+    Builtin pow = builtins_[builtin_ids_.at("pow")];
+    pow.name = "std::math::pow";
+    add_builtin(std::move(pow));
 }
 
 }  // namespace impulse::runtime
@@ -0,0 +1,40 @@
+#include "impulse/runtime/struct_layout.h"
+
+#include <utility>
+
+namespace impulse::runtime {
+
+auto StructLayout::find(std::string_view field) const -> const StructFieldSlot* {
+    for (const auto& candidate : fields) {
+        if (candidate.name == field) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+auto build_struct_layout(const ir::Struct& structure, std::uint32_t shape) -> StructLayout {
+    StructLayout layout;
+    layout.name = structure.name;
+    layout.shape = shape;
+    layout.fields.reserve(structure.fields.size());
+    for (const auto& field : structure.fields) {
+        StructFieldSlot slot;
+        slot.name = field.name;
+        slot.numeric = field.type == "int" || field.type == "float" || field.type == "bool";
+        slot.slot = slot.numeric ? layout.numeric_count++ : layout.boxed_count++;
+        layout.fields.push_back(std::move(slot));
+    }
+    return layout;
+}
+
+auto find_struct_layout(const std::vector<StructLayout>& layouts, std::string_view name) -> const StructLayout* {
+    for (const auto& layout : layouts) {
+        if (layout.name == name) {
+            return &layout;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace impulse::runtime
@@ -0,0 +1,111 @@
+#include "impulse/runtime/task_pool.h"
+
+#include <algorithm>
+
+namespace impulse::runtime {
+
+TaskPool::TaskPool(std::size_t threads) {
+    const std::size_t participants = std::max<std::size_t>(threads, 1);
+    deques_.reserve(participants);
+    for (std::size_t i = 0; i < participants; ++i) {
+        deques_.push_back(std::make_unique<Deque>());
+    }
+    workers_.reserve(participants - 1);
+    for (std::size_t i = 1; i < participants; ++i) {
+        workers_.emplace_back([this, i] { worker(i); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    started_.notify_all();
+    for (auto& thread : workers_) {
+        thread.join();
+    }
+}
+
+void TaskPool::run(std::size_t count, std::size_t chunk, const Work& work) {
+    chunk = std::max<std::size_t>(chunk, 1);
+    if (count == 0) {
+        return;
+    }
+    const std::lock_guard<std::mutex> run_lock(run_mutex_);
+    if (workers_.empty() || count <= chunk) {
+        for (std::size_t begin = 0; begin < count; begin += chunk) {
+            work(0, begin, std::min(begin + chunk, count));
+        }
+        return;
+    }
+
+    // Every chunk is dealt before anyone starts, so an empty set of deques means the run is over
+    std::size_t next = 0;
+    for (std::size_t begin = 0; begin < count; begin += chunk) {
+        deques_[next]->chunks.push_back(Chunk{begin, std::min(begin + chunk, count)});
+        next = (next + 1) % deques_.size();
+    }
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        work_ = &work;
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    started_.notify_all();
+    drain(0, work);
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] { return busy_ == 0; });
+    work_ = nullptr;
+}
+
+void TaskPool::worker(std::size_t participant) {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        started_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) {
+            return;
+        }
+        seen = generation_;
+        const Work& work = *work_;
+        lock.unlock();
+        drain(participant, work);
+        lock.lock();
+        if (--busy_ == 0) {
+            finished_.notify_one();
+        }
+    }
+}
+
+void TaskPool::drain(std::size_t participant, const Work& work) {
+    Chunk chunk;
+    while (take(participant, chunk)) {
+        work(participant, chunk.begin, chunk.end);
+    }
+}
+
+auto TaskPool::take(std::size_t participant, Chunk& chunk) -> bool {
+    {
+        Deque& own = *deques_[participant];
+        const std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.back();
+            own.chunks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < deques_.size(); ++i) {
+        Deque& victim = *deques_[(participant + i) % deques_.size()];
+        const std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.front();
+            victim.chunks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace impulse::runtime
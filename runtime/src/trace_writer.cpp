@@ -0,0 +1,509 @@
+#include "impulse/runtime/trace_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+#include "impulse/runtime/runtime_utils.h"
+
+namespace impulse::runtime {
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'M', 'P', 'T', 'R', 'A', 'C', 'E'};
+constexpr std::uint32_t kFormatVersion = 1;
+constexpr std::size_t kRecordBytes = sizeof(TraceWriter::Record);
+constexpr std::uint64_t kTextChunkRecords = 4096;  // how much of a text the decoder reads at once
+
+enum class Kind : std::uint8_t {
+    Text,             // raw bytes of the entry before it
+    FunctionName,     // a: function; the name follows
+    BlockName,        // a: function, b: block; the name follows
+    InstructionText,  // a: function, b: block, c: instruction; its text follows
+    BuiltinName,      // a: builtin; the name follows
+    EnterFunction,    // a: function
+    ExitFunction,     // a: function, c: status; the value or the message
+    EnterBlock,       // a: function, b: block
+    Instruction,      // a: function, b: block, c: instruction
+    Phi,              // a, b: result symbol and version, c: block; the value
+    Store,            // a, b: destination symbol and version; the value
+    Return,           // the value
+    Branch,           // a: function, b: target, c: taken
+    Builtin,          // a: builtin; the payload
+    Dropped,          // payload: how many records the ring overwrote
+};
+
+// How a record's payload is read. String and Text are followed by `payload` bytes of text.
+enum class Payload : std::uint8_t {
+    None,
+    Number,  // f64 bits
+    Nil,
+    Array,   // length
+    Struct,  // shape
+    String,  // printed quoted and escaped
+    Text,    // printed as it is
+    NullObject,
+};
+
+[[nodiscard]] auto text_records(std::size_t bytes) -> std::size_t {
+    return (bytes + kRecordBytes - 1) / kRecordBytes;
+}
+
+[[nodiscard]] auto make_record(Kind kind, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0)
+    -> TraceWriter::Record {
+    TraceWriter::Record record;
+    record.kind = static_cast<std::uint8_t>(kind);
+    record.a = a;
+    record.b = b;
+    record.c = c;
+    return record;
+}
+
+[[nodiscard]] auto narrow(std::size_t value) -> std::uint32_t {
+    return static_cast<std::uint32_t>(std::min<std::size_t>(value, std::numeric_limits<std::uint32_t>::max()));
+}
+
+void push_text(std::vector<TraceWriter::Record>& records, std::string_view text) {
+    for (std::size_t offset = 0; offset < text.size(); offset += kRecordBytes) {
+        TraceWriter::Record chunk;
+        std::memcpy(static_cast<void*>(&chunk), text.data() + offset, std::min(kRecordBytes, text.size() - offset));
+        records.push_back(chunk);
+    }
+}
+
+void write_records(std::ostream& out, const std::vector<TraceWriter::Record>& records, std::size_t begin = 0) {
+    if (begin < records.size()) {
+        out.write(reinterpret_cast<const char*>(records.data() + begin),
+                  static_cast<std::streamsize>((records.size() - begin) * kRecordBytes));
+    }
+}
+
+}  // namespace
+
+TraceWriter::TraceWriter(std::ostream& out) : TraceWriter(out, Options{}) {}
+
+TraceWriter::TraceWriter(std::ostream& out, Options options)
+    : out_(out),
+      options_(options),
+      segment_records_(std::max<std::size_t>(options.segment_bytes / kRecordBytes, 2)),
+      segments_(std::max<std::size_t>(options.ring_segments, 1)) {
+    segments_.front().reserve(segment_records_);
+}
+
+TraceWriter::~TraceWriter() { flush(); }
+
+void TraceWriter::define(Record record, std::string_view text) {
+    record.value = static_cast<std::uint8_t>(Payload::Text);
+    record.payload = text.size();
+    dictionary_.push_back(record);
+    push_text(dictionary_, text);
+}
+
+void TraceWriter::define_function(FunctionId function, std::string_view name) {
+    if (function >= defined_.size()) {
+        defined_.resize(static_cast<std::size_t>(function) + 1, 0);
+    }
+    if ((defined_[function] & 1) == 0) {
+        defined_[function] |= 1;
+        define(make_record(Kind::FunctionName, function), name);
+    }
+}
+
+void TraceWriter::define_code(FunctionId function, const ir::SsaFunction& ssa) {
+    if (function >= defined_.size()) {
+        defined_.resize(static_cast<std::size_t>(function) + 1, 0);
+    }
+    if ((defined_[function] & 2) != 0) {
+        return;
+    }
+    defined_[function] |= 2;
+    for (std::size_t b = 0; b < ssa.blocks.size(); ++b) {
+        const auto& block = ssa.blocks[b];
+        define(make_record(Kind::BlockName, function, narrow(b)), block.name);
+        for (std::size_t i = 0; i < block.instructions.size(); ++i) {
+            define(make_record(Kind::InstructionText, function, narrow(b), narrow(i)),
+                   format_ssa_instruction(block.instructions[i]));
+        }
+    }
+}
+
+void TraceWriter::enter_function(FunctionId function) { append(make_record(Kind::EnterFunction, function), {}); }
+
+void TraceWriter::exit_function(FunctionId function, double value) {
+    Record record = make_record(Kind::ExitFunction, function);
+    append_value(record, Value::make_number(value));
+}
+
+void TraceWriter::exit_function(FunctionId function, const VmResult& result) {
+    if (result.status == VmStatus::Success && result.has_value) {
+        exit_function(function, result.value);
+        return;
+    }
+    Record record = make_record(Kind::ExitFunction, function, 0, static_cast<std::uint32_t>(result.status));
+    record.value = static_cast<std::uint8_t>(Payload::Text);
+    record.payload = result.message.size();
+    append(record, result.message);
+}
+
+void TraceWriter::enter_block(FunctionId function, std::size_t block) {
+    append(make_record(Kind::EnterBlock, function, narrow(block)), {});
+}
+
+void TraceWriter::instruction(FunctionId function, std::size_t block, std::size_t instruction) {
+    append(make_record(Kind::Instruction, function, narrow(block), narrow(instruction)), {});
+}
+
+void TraceWriter::phi(const ir::SsaValue& result, const Value& value, std::size_t block) {
+    append_value(make_record(Kind::Phi, result.symbol, result.version, narrow(block)), value);
+}
+
+void TraceWriter::store(const ir::SsaValue& destination, const Value& value) {
+    append_value(make_record(Kind::Store, destination.symbol, destination.version), value);
+}
+
+void TraceWriter::returned(const Value& value) { append_value(make_record(Kind::Return), value); }
+
+void TraceWriter::branch(FunctionId function, std::size_t target, bool taken) {
+    append(make_record(Kind::Branch, function, narrow(target), taken ? 1 : 0), {});
+}
+
+void TraceWriter::builtin(const std::string& name, std::string_view payload) {
+    auto it = builtins_.find(name);
+    if (it == builtins_.end()) {
+        it = builtins_.emplace(name, narrow(builtins_.size())).first;
+        define(make_record(Kind::BuiltinName, it->second), name);
+    }
+    Record record = make_record(Kind::Builtin, it->second);
+    record.value = static_cast<std::uint8_t>(Payload::String);
+    record.payload = payload.size();
+    append(record, payload);
+}
+
+void TraceWriter::append_value(Record record, const Value& value) {
+    switch (value.kind) {
+        case ValueKind::Nil:
+            record.value = static_cast<std::uint8_t>(Payload::Nil);
+            break;
+        case ValueKind::Number:
+            record.value = static_cast<std::uint8_t>(Payload::Number);
+            std::memcpy(&record.payload, &value.number, sizeof(record.payload));
+            break;
+        case ValueKind::String: {
+            const std::string_view text = value.as_string();
+            record.value = static_cast<std::uint8_t>(Payload::String);
+            record.payload = text.size();
+            append(record, text);
+            return;
+        }
+        case ValueKind::Object:
+            if (value.object == nullptr) {
+                record.value = static_cast<std::uint8_t>(Payload::NullObject);
+            } else if (value.object->is_array()) {
+                record.value = static_cast<std::uint8_t>(Payload::Array);
+                record.payload = value.object->array_length();
+            } else if (value.object->kind == ObjectKind::Struct) {
+                record.value = static_cast<std::uint8_t>(Payload::Struct);
+                record.payload = value.object->shape;
+            } else {
+                const std::string text = describe_value(value);
+                record.value = static_cast<std::uint8_t>(Payload::Text);
+                record.payload = text.size();
+                append(record, text);
+                return;
+            }
+            break;
+    }
+    append(record, {});
+}
+
+void TraceWriter::append(Record record, std::string_view text) {
+    if (1 + text_records(text.size()) > segment_records_) {
+        text = text.substr(0, (segment_records_ - 1) * kRecordBytes);
+        record.payload = text.size();
+    }
+    if (segments_[current_].size() + 1 + text_records(text.size()) > segment_records_) {
+        next_segment();
+    }
+    auto& segment = segments_[current_];
+    segment.push_back(record);
+    push_text(segment, text);
+}
+
+void TraceWriter::next_segment() {
+    if (options_.ring_segments == 0) {
+        flush();
+        return;
+    }
+    current_ = (current_ + 1) % segments_.size();
+    auto& segment = segments_[current_];
+    dropped_ += segment.size();
+    dropped_total_ += segment.size();
+    segment.clear();
+    segment.reserve(segment_records_);
+}
+
+void TraceWriter::write_header() {
+    out_.write(kMagic, sizeof(kMagic));
+    const std::uint32_t header[2] = {kFormatVersion, static_cast<std::uint32_t>(kRecordBytes)};
+    out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    header_written_ = true;
+}
+
+void TraceWriter::flush() {
+    if (!header_written_) {
+        write_header();
+    }
+    write_records(out_, dictionary_, dictionary_written_);
+    dictionary_written_ = dictionary_.size();
+    if (dropped_ != 0) {
+        Record record = make_record(Kind::Dropped);
+        record.payload = dropped_;
+        out_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        dropped_ = 0;
+    }
+    // Oldest segment first: the ring continues after the one being filled
+    for (std::size_t i = 1; i <= segments_.size(); ++i) {
+        auto& segment = segments_[(current_ + i) % segments_.size()];
+        write_records(out_, segment);
+        segment.clear();
+    }
+    out_.flush();
+}
+
+namespace {
+
+class TraceDecoder {
+public:
+    TraceDecoder(std::istream& in, std::ostream& out) : in_(in), out_(out) {}
+
+    auto run() -> bool {
+        char magic[sizeof(kMagic)];
+        std::uint32_t header[2] = {};
+        if (!in_.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+            !in_.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != kFormatVersion ||
+            header[1] != kRecordBytes) {
+            return false;
+        }
+        // Where the input ends, so that lengths can be checked against it
+        const auto start = in_.tellg();
+        if (start != std::streampos(-1) && in_.seekg(0, std::ios::end)) {
+            end_ = in_.tellg();
+            in_.seekg(start);
+        }
+        in_.clear();
+        TraceWriter::Record record;
+        while (in_.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            if (!decode(record)) {
+                return false;
+            }
+        }
+        return in_.gcount() == 0;
+    }
+
+private:
+    struct Function {
+        std::string name;
+        std::vector<std::string> blocks;
+        std::vector<std::vector<std::string>> instructions;
+    };
+
+    auto decode(const TraceWriter::Record& record) -> bool {
+        std::string text;
+        const auto payload = static_cast<Payload>(record.value);
+        if ((payload == Payload::String || payload == Payload::Text) && !read_text(record.payload, text)) {
+            return false;
+        }
+        switch (static_cast<Kind>(record.kind)) {
+            case Kind::FunctionName:
+                function(record.a).name = std::move(text);
+                return true;
+            // Ids are defined in order (a block's name before its instructions), so each one is at
+            // most the next one after those seen so far
+            case Kind::BlockName: {
+                auto& blocks = function(record.a).blocks;
+                if (record.b > blocks.size()) {
+                    return false;
+                }
+                blocks.resize(std::max<std::size_t>(blocks.size(), std::size_t{record.b} + 1));
+                blocks[record.b] = std::move(text);
+                return true;
+            }
+            case Kind::InstructionText: {
+                auto& code = function(record.a);
+                if (record.b >= code.blocks.size()) {
+                    return false;
+                }
+                code.instructions.resize(std::max<std::size_t>(code.instructions.size(), std::size_t{record.b} + 1));
+                auto& block = code.instructions[record.b];
+                if (record.c > block.size()) {
+                    return false;
+                }
+                block.resize(std::max<std::size_t>(block.size(), std::size_t{record.c} + 1));
+                block[record.c] = std::move(text);
+                return true;
+            }
+            case Kind::BuiltinName:
+                if (record.a > builtins_.size()) {
+                    return false;
+                }
+                builtins_.resize(std::max<std::size_t>(builtins_.size(), std::size_t{record.a} + 1));
+                builtins_[record.a] = std::move(text);
+                return true;
+            case Kind::EnterFunction:
+                out_ << "enter function " << function(record.a).name << '\n';
+                return true;
+            case Kind::ExitFunction:
+                out_ << "exit function " << function(record.a).name;
+                if (payload == Payload::Number) {
+                    out_ << " = " << number(record);
+                } else {
+                    out_ << " status=" << record.c;
+                    if (!text.empty()) {
+                        out_ << " message='" << text << "'";
+                    }
+                }
+                out_ << '\n';
+                return true;
+            case Kind::EnterBlock:
+                out_ << "enter block " << record.b;
+                block_name(record.a, record.b);
+                out_ << '\n';
+                return true;
+            case Kind::Instruction: {
+                const auto& instructions = function(record.a).instructions;
+                if (record.b >= instructions.size() || record.c >= instructions[record.b].size()) {
+                    return false;
+                }
+                out_ << "    " << instructions[record.b][record.c] << '\n';
+                return true;
+            }
+            case Kind::Phi:
+                out_ << "    phi " << format_ssa_value(ir::SsaValue{record.a, record.b}) << " := ";
+                value(record, text);
+                out_ << " in block " << record.c << '\n';
+                return true;
+            case Kind::Store:
+                out_ << "      -> " << format_ssa_value(ir::SsaValue{record.a, record.b}) << " = ";
+                value(record, text);
+                out_ << '\n';
+                return true;
+            case Kind::Return:
+                out_ << "    return ";
+                value(record, text);
+                out_ << '\n';
+                return true;
+            case Kind::Branch:
+                out_ << "    -> branch ";
+                if (record.b < function(record.a).blocks.size()) {
+                    out_ << record.b;
+                    block_name(record.a, record.b);
+                } else {
+                    out_ << "<invalid>";
+                }
+                out_ << (record.c != 0 ? " [taken]" : " [skipped]") << '\n';
+                return true;
+            case Kind::Builtin:
+                if (record.a >= builtins_.size()) {
+                    return false;
+                }
+                out_ << "    builtin " << builtins_[record.a];
+                if (!text.empty()) {
+                    out_ << " \"" << escape_string(text) << "\"";
+                }
+                out_ << '\n';
+                return true;
+            case Kind::Dropped:
+                out_ << "... " << record.payload << " earlier records dropped\n";
+                return true;
+            case Kind::Text:
+                break;
+        }
+        return false;
+    }
+
+    // The length comes from the file: one longer than what is left of it is corrupt. A stream that
+    // cannot seek has no known end, so the text grows as its records arrive instead
+    auto read_text(std::uint64_t size, std::string& text) -> bool {
+        if (size > bytes_left()) {
+            return false;
+        }
+        const std::uint64_t records = size / kRecordBytes + (size % kRecordBytes != 0 ? 1 : 0);
+        text.clear();
+        for (std::uint64_t read = 0; read < records; read += kTextChunkRecords) {
+            const auto bytes = static_cast<std::size_t>(std::min(records - read, kTextChunkRecords)) * kRecordBytes;
+            const std::size_t at = text.size();
+            text.resize(at + bytes);
+            if (!in_.read(text.data() + at, static_cast<std::streamsize>(bytes))) {
+                return false;
+            }
+        }
+        text.resize(static_cast<std::size_t>(size));
+        return true;
+    }
+
+    auto bytes_left() -> std::uint64_t {
+        const auto position = in_.tellg();
+        if (end_ == std::streampos(-1) || position == std::streampos(-1)) {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+        return static_cast<std::uint64_t>(end_ - position);
+    }
+
+    auto function(std::uint32_t id) -> Function& { return functions_[id]; }
+
+    void block_name(std::uint32_t function_id, std::uint32_t block) {
+        const auto& blocks = function(function_id).blocks;
+        if (block < blocks.size() && !blocks[block].empty()) {
+            out_ << " (" << blocks[block] << ')';
+        }
+    }
+
+    [[nodiscard]] static auto number(const TraceWriter::Record& record) -> double {
+        double value = 0.0;
+        std::memcpy(&value, &record.payload, sizeof(value));
+        return value;
+    }
+
+    // As describe_value prints it
+    void value(const TraceWriter::Record& record, const std::string& text) {
+        switch (static_cast<Payload>(record.value)) {
+            case Payload::Number:
+                out_ << number(record);
+                break;
+            case Payload::Nil:
+                out_ << "nil";
+                break;
+            case Payload::Array:
+                out_ << "[array length=" << record.payload << "]";
+                break;
+            case Payload::Struct:
+                out_ << "[struct shape=" << record.payload << "]";
+                break;
+            case Payload::String:
+                out_ << '"' << escape_string(text) << '"';
+                break;
+            case Payload::Text:
+                out_ << text;
+                break;
+            case Payload::NullObject:
+                out_ << "object@null";
+                break;
+            case Payload::None:
+                break;
+        }
+    }
+
+    std::istream& in_;
+    std::ostream& out_;
+    std::unordered_map<std::uint32_t, Function> functions_;
+    std::vector<std::string> builtins_;
+    std::streampos end_ = -1;
+};
+
+}  // namespace
+
+auto decode_trace(std::istream& in, std::ostream& out) -> bool { return TraceDecoder(in, out).run(); }
+
+}  // namespace impulse::runtime
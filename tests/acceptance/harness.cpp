@@ -1,13 +1,20 @@
 #include "harness.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <optional>
 #include <sstream>
+#include <streambuf>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "impulse/frontend/dump.h"
 #include "impulse/frontend/lowering.h"
@@ -17,6 +24,7 @@
 #include "impulse/ir/analysis.h"
 #include "impulse/ir/dump.h"
 #include "impulse/runtime/runtime.h"
+#include "impulse/runtime/task_pool.h"
 
 namespace impulse::tests::acceptance {
 namespace {
@@ -25,6 +33,9 @@ using impulse::frontend::Lexer;
 using impulse::frontend::Parser;
 using impulse::frontend::Token;
 
+// How far a case's pipeline runs; each stage needs the ones before it
+enum class Depth { Tokens, Ast, Semantic, Ir, Analyses, Runtime };
+
 struct PipelineOutputs {
     bool parse_success = false;
     bool semantic_success = false;
@@ -41,7 +52,6 @@ struct PipelineOutputs {
     std::string ssa;
     std::string optimisation_log;
     std::string diagnostics;
-    std::string runtime_trace;
     std::string runtime_summary;
 };
 
@@ -92,8 +102,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
     return out.str();
 }
 
-[[nodiscard]] auto run_pipeline(const std::string& source, const std::optional<std::string>& stdin_text)
-    -> PipelineOutputs {
+// Runs the stages up to `depth`; the runtime trace goes to `trace` as it is produced
+[[nodiscard]] auto run_pipeline(const std::string& source, const std::optional<std::string>& stdin_text, Depth depth,
+                                std::ostream* trace) -> PipelineOutputs {
     PipelineOutputs outputs;
 
     Lexer lexer(source);
@@ -103,6 +114,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         impulse::frontend::dump_tokens(tokens, token_stream);
         outputs.tokens = token_stream.str();
     }
+    if (depth == Depth::Tokens) {
+        return outputs;
+    }
 
     Parser parser(source);
     auto parse_result = parser.parseModule();
@@ -123,6 +137,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         impulse::frontend::dump_ast(parse_result.module, ast_stream);
         outputs.ast = ast_stream.str();
     }
+    if (depth == Depth::Ast) {
+        return outputs;
+    }
 
     const auto semantic_result = impulse::frontend::analyzeModule(parse_result.module);
     outputs.semantic_success = semantic_result.success;
@@ -135,6 +152,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         outputs.runtime_summary = "semantic failure\n";
         return outputs;
     }
+    if (depth == Depth::Semantic) {
+        return outputs;
+    }
 
     const impulse::ir::Module lowered = impulse::frontend::lower_to_ir(parse_result.module);
     {
@@ -142,6 +162,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         impulse::ir::dump_ir(lowered, ir_stream);
         outputs.ir = ir_stream.str();
     }
+    if (depth == Depth::Ir) {
+        return outputs;
+    }
 
     const auto analyses = impulse::ir::analyse_module(lowered);
     {
@@ -169,6 +192,9 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         outputs.ssa = ssa_stream.str();
         outputs.optimisation_log = log_stream.str();
     }
+    if (depth == Depth::Analyses) {
+        return outputs;
+    }
 
     impulse::runtime::Vm vm;
     vm.set_jit_enabled(false);  // Disable JIT for acceptance tests to ensure consistent trace output
@@ -178,8 +204,7 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
         stdin_stream.clear();
         vm.set_input_stream(&stdin_stream);
     }
-    std::ostringstream trace_stream;
-    vm.set_trace_stream(&trace_stream);
+    vm.set_trace_stream(trace);
     const auto load_result = vm.load(lowered);
     if (!load_result.success) {
         std::ostringstream out;
@@ -188,7 +213,6 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
             out << "  " << diag << '\n';
         }
         outputs.runtime_summary = out.str();
-        outputs.runtime_trace = trace_stream.str();
         return outputs;
     }
 
@@ -199,7 +223,6 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
     if (stdin_text.has_value()) {
         vm.set_input_stream(nullptr);
     }
-    outputs.runtime_trace = trace_stream.str();
     outputs.runtime_status = result.status;
     outputs.runtime_has_value = result.has_value;
     outputs.runtime_value = result.value;
@@ -218,9 +241,8 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
     return outputs;
 }
 
-[[nodiscard]] auto collect_cases() -> std::vector<std::filesystem::path> {
+[[nodiscard]] auto collect_cases(const std::filesystem::path& root) -> std::vector<std::filesystem::path> {
     std::vector<std::filesystem::path> cases;
-    const auto root = cases_root();
     if (!std::filesystem::exists(root)) {
         return cases;
     }
@@ -237,57 +259,218 @@ void append_diagnostics(std::string_view stage, const std::vector<impulse::front
     return cases;
 }
 
-[[nodiscard]] auto compare_output(const std::filesystem::path& expected_path, const std::string& actual)
-    -> std::optional<std::string> {
-    const auto expected = read_text_file(expected_path);
-    if (!expected.has_value()) {
-        std::ostringstream out;
-        out << "missing expectation: " << expected_path.filename().string();
-        return out.str();
+class Fnv1a {
+public:
+    void bytes(const void* data, std::size_t size) {
+        const auto* begin = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ begin[i]) * 0x100000001B3ULL;
+        }
     }
-    if (*expected == actual) {
-        return std::nullopt;
+
+    template <typename T>
+    void value(const T& value) {
+        bytes(&value, sizeof(value));
+    }
+
+    void text(std::string_view text) {
+        value(text.size());
+        bytes(text.data(), text.size());
     }
 
-    std::istringstream exp_stream(*expected);
-    std::istringstream act_stream(actual);
-    std::string exp_line;
-    std::string act_line;
-    std::size_t line = 1;
-    while (true) {
-        const bool exp_ok = static_cast<bool>(std::getline(exp_stream, exp_line));
-        const bool act_ok = static_cast<bool>(std::getline(act_stream, act_line));
-        if (!exp_ok && !act_ok) {
-            break;
+    [[nodiscard]] auto digest() const -> std::uint64_t { return hash_; }
+
+private:
+    std::uint64_t hash_ = 0xCBF29CE484222325ULL;
+};
+
+constexpr std::size_t kChunkBytes = std::size_t{64} << 10;
+
+// Compares the text written to it with an expected file as it arrives, reading the file a chunk at
+// a time and keeping only the line in progress. After the first difference it takes the rest of
+// that line for the report and then refuses output, which fails the stream, so a trace that has
+// already diverged costs next to nothing to finish.
+class GoldenBuffer final : public std::streambuf {
+public:
+    explicit GoldenBuffer(const std::filesystem::path& expected)
+        : expected_(expected, std::ios::binary), chunk_(kChunkBytes) {}
+
+    [[nodiscard]] auto is_open() const -> bool { return expected_.is_open(); }
+
+    // The first difference, worded as a line-by-line comparison would put it. Call once, after
+    // the last write.
+    [[nodiscard]] auto finish() -> std::optional<std::string> {
+        if (state_ == State::Matching) {
+            const int expected = next_expected();
+            if (expected == kEnd) {
+                return std::nullopt;
+            }
+            begin_mismatch(expected);
         }
-        if (!exp_ok || !act_ok) {
-            return std::string{"length mismatch at line "} + std::to_string(line);
+        state_ = State::Done;
+        if (!expected_has_line_ || !actual_has_line_) {
+            return std::string{"length mismatch at line "} + std::to_string(line_);
         }
-        if (exp_line != act_line) {
+        if (expected_line_ != actual_line_) {
             std::ostringstream diff;
-            diff << "line " << line << " differs\n  expected: " << exp_line << "\n    actual: " << act_line;
+            diff << "line " << line_ << " differs\n  expected: " << expected_line_ << "\n    actual: " << actual_line_;
             return diff.str();
         }
-        ++line;
+        return std::string{"content differs (unknown cause)"};
     }
 
-    return std::string{"content differs (unknown cause)"};
+protected:
+    auto overflow(int_type ch) -> int_type override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        return put(traits_type::to_char_type(ch)) ? ch : traits_type::eof();
+    }
+
+    auto xsputn(const char* data, std::streamsize count) -> std::streamsize override {
+        std::streamsize written = 0;
+        while (written < count && put(data[written])) {
+            ++written;
+        }
+        return written;
+    }
+
+private:
+    enum class State { Matching, Collecting, Done };
+    static constexpr int kEnd = -1;
+
+    auto put(char ch) -> bool {
+        switch (state_) {
+            case State::Matching:
+                if (next_expected() == static_cast<unsigned char>(ch)) {
+                    if (ch == '\n') {
+                        ++line_;
+                        prefix_.clear();
+                    } else {
+                        prefix_.push_back(ch);
+                    }
+                    return true;
+                }
+                begin_mismatch(last_expected_);
+                actual_has_line_ = true;
+                [[fallthrough]];
+            case State::Collecting:
+                if (ch == '\n') {
+                    state_ = State::Done;
+                } else {
+                    actual_line_.push_back(ch);
+                    state_ = State::Collecting;
+                }
+                return true;
+            case State::Done:
+                break;
+        }
+        return false;
+    }
+
+    // `expected` is the expected file's character where the texts part, or kEnd
+    void begin_mismatch(int expected) {
+        expected_has_line_ = !prefix_.empty() || expected != kEnd;
+        actual_has_line_ = !prefix_.empty();
+        expected_line_ = prefix_;
+        actual_line_ = prefix_;
+        while (expected != kEnd && expected != '\n') {
+            expected_line_.push_back(static_cast<char>(expected));
+            expected = next_expected();
+        }
+    }
+
+    auto next_expected() -> int {
+        if (position_ == filled_) {
+            expected_.read(chunk_.data(), static_cast<std::streamsize>(chunk_.size()));
+            filled_ = static_cast<std::size_t>(expected_.gcount());
+            position_ = 0;
+            if (filled_ == 0) {
+                return last_expected_ = kEnd;
+            }
+        }
+        return last_expected_ = static_cast<unsigned char>(chunk_[position_++]);
+    }
+
+    std::ifstream expected_;
+    std::vector<char> chunk_;
+    std::size_t position_ = 0;
+    std::size_t filled_ = 0;
+    int last_expected_ = kEnd;
+    State state_ = State::Matching;
+    std::size_t line_ = 1;
+    std::string prefix_;  // the current line, identical on both sides so far
+    std::string expected_line_;
+    std::string actual_line_;
+    bool expected_has_line_ = false;
+    bool actual_has_line_ = false;
+};
+
+[[nodiscard]] auto missing_expectation(const std::filesystem::path& expected_path) -> std::string {
+    std::ostringstream out;
+    out << "missing expectation: " << expected_path.filename().string();
+    return out.str();
 }
 
-[[nodiscard]] auto expected_definitions() -> std::vector<std::pair<std::string, std::string>> {
+[[nodiscard]] auto compare_output(const std::filesystem::path& expected_path, const std::string& actual)
+    -> std::optional<std::string> {
+    GoldenBuffer golden(expected_path);
+    if (!golden.is_open()) {
+        return missing_expectation(expected_path);
+    }
+    golden.sputn(actual.data(), static_cast<std::streamsize>(actual.size()));
+    return golden.finish();
+}
+
+struct Expectation {
+    std::string label;
+    std::string filename;
+    Depth depth;
+};
+
+[[nodiscard]] auto expected_definitions() -> std::vector<Expectation> {
     return {
-        {"tokens", "expected.tokens.txt"},
-        {"ast", "expected.ast.txt"},
-        {"ir", "expected.ir.txt"},
-        {"cfg", "expected.cfg.txt"},
-        {"ssa", "expected.ssa.txt"},
-        {"optimisation log", "expected.optimisation.txt"},
-        {"runtime trace", "expected.runtime-trace.txt"},
-        {"runtime result", "expected.runtime.txt"},
-        {"diagnostics", "expected.diagnostics.txt"},
+        {"tokens", "expected.tokens.txt", Depth::Tokens},
+        {"ast", "expected.ast.txt", Depth::Ast},
+        {"ir", "expected.ir.txt", Depth::Ir},
+        {"cfg", "expected.cfg.txt", Depth::Analyses},
+        {"ssa", "expected.ssa.txt", Depth::Analyses},
+        {"optimisation log", "expected.optimisation.txt", Depth::Analyses},
+        {"runtime trace", "expected.runtime-trace.txt", Depth::Runtime},
+        {"runtime result", "expected.runtime.txt", Depth::Runtime},
+        {"diagnostics", "expected.diagnostics.txt", Depth::Semantic},
     };
 }
 
+// Every output but the runtime trace, which is compared while it is written
+[[nodiscard]] auto select_output(const PipelineOutputs& outputs, const std::string& label) -> const std::string* {
+    if (label == "tokens") {
+        return &outputs.tokens;
+    }
+    if (label == "ast") {
+        return &outputs.ast;
+    }
+    if (label == "ir") {
+        return &outputs.ir;
+    }
+    if (label == "cfg") {
+        return &outputs.cfg;
+    }
+    if (label == "ssa") {
+        return &outputs.ssa;
+    }
+    if (label == "optimisation log") {
+        return &outputs.optimisation_log;
+    }
+    if (label == "runtime result") {
+        return &outputs.runtime_summary;
+    }
+    if (label == "diagnostics") {
+        return &outputs.diagnostics;
+    }
+    return nullptr;
+}
+
 struct CaseData {
     std::string name;
     std::filesystem::path program_path;
@@ -309,75 +492,177 @@ struct CaseData {
     return data;
 }
 
-}  // namespace
+// Stands in for the code of every stage: relinking the tests invalidates every stamp
+[[nodiscard]] auto build_identity() -> std::optional<std::uint64_t> {
+    std::error_code error;
+    const auto binary = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (error) {
+        return std::nullopt;
+    }
+    const auto size = std::filesystem::file_size(binary, error);
+    if (error) {
+        return std::nullopt;
+    }
+    const auto written = std::filesystem::last_write_time(binary, error);
+    if (error) {
+        return std::nullopt;
+    }
+    Fnv1a hash;
+    hash.text(binary.string());
+    hash.value(size);
+    hash.value(written.time_since_epoch().count());
+    return hash.digest();
+}
 
-auto run_suite() -> std::vector<CaseReport> {
-    std::vector<CaseReport> reports;
-    const auto case_paths = collect_cases();
-    reports.reserve(case_paths.size());
-
-    for (const auto& case_path : case_paths) {
-        const auto data = load_case(case_path);
-        CaseReport report;
-        report.name = data.name;
-
-        if (data.stdin_load_error) {
-            report.messages.emplace_back("failed to read stdin.txt");
-            reports.push_back(std::move(report));
-            continue;
+// Everything an expectation's verdict depends on; nullopt when the expected file cannot be read
+[[nodiscard]] auto stage_key(std::uint64_t build, const CaseData& data, const std::string& source,
+                             const Expectation& expectation, const std::filesystem::path& expected_path)
+    -> std::optional<std::uint64_t> {
+    Fnv1a hash;
+    hash.value(build);
+    hash.text(expectation.label);
+    hash.text(source);
+    hash.value(data.stdin_text.has_value());
+    if (data.stdin_text.has_value()) {
+        hash.text(*data.stdin_text);
+    }
+    std::ifstream expected(expected_path, std::ios::binary);
+    if (!expected) {
+        return std::nullopt;
+    }
+    std::vector<char> chunk(kChunkBytes);
+    while (expected) {
+        expected.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        hash.bytes(chunk.data(), static_cast<std::size_t>(expected.gcount()));
+    }
+    return hash.digest();
+}
+
+// One line per passed expectation: its key in hex, then its label
+[[nodiscard]] auto read_stamps(const std::filesystem::path& path) -> std::unordered_set<std::uint64_t> {
+    std::unordered_set<std::uint64_t> keys;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        try {
+            keys.insert(std::stoull(line.substr(0, line.find(' ')), nullptr, 16));
+        } catch (const std::exception&) {
+            // A damaged stamp only costs a rerun
         }
+    }
+    return keys;
+}
+
+[[nodiscard]] auto run_case(const std::filesystem::path& case_path, const SuiteOptions& options,
+                            const std::optional<std::uint64_t>& build) -> CaseReport {
+    const auto data = load_case(case_path);
+    CaseReport report;
+    report.name = data.name;
+
+    if (data.stdin_load_error) {
+        report.messages.emplace_back("failed to read stdin.txt");
+        return report;
+    }
+
+    const auto source = read_text_file(data.program_path);
+    if (!source.has_value()) {
+        report.messages.emplace_back("failed to read program.impulse");
+        return report;
+    }
 
-        const auto source = read_text_file(data.program_path);
-        if (!source.has_value()) {
-            report.messages.emplace_back("failed to read program.impulse");
-            reports.push_back(std::move(report));
+    const auto expectations = expected_definitions();
+    const bool stamping = build.has_value() && !options.stamps.empty();
+    const auto stamp_path = options.stamps / (data.name + ".stamps");
+    const auto passed_before = stamping ? read_stamps(stamp_path) : std::unordered_set<std::uint64_t>{};
+    std::vector<std::optional<std::uint64_t>> keys(expectations.size());
+    std::vector<bool> pending(expectations.size(), false);
+    std::optional<Depth> depth;
+    for (std::size_t i = 0; i < expectations.size(); ++i) {
+        const auto& expectation = expectations[i];
+        if (stamping) {
+            keys[i] = stage_key(*build, data, *source, expectation, case_path / expectation.filename);
+        }
+        if (keys[i].has_value() && passed_before.count(*keys[i]) != 0) {
+            ++report.skipped_stages;
             continue;
         }
+        pending[i] = true;
+        depth = std::max(depth.value_or(expectation.depth), expectation.depth);
+    }
 
-        const auto outputs = run_pipeline(*source, data.stdin_text);
-        bool success = true;
-
-        const auto expectation_map = expected_definitions();
-        for (const auto& [label, filename] : expectation_map) {
-            const auto expected_path = case_path / filename;
-            const std::string* actual = nullptr;
-            if (label == "tokens") {
-                actual = &outputs.tokens;
-            } else if (label == "ast") {
-                actual = &outputs.ast;
-            } else if (label == "ir") {
-                actual = &outputs.ir;
-            } else if (label == "cfg") {
-                actual = &outputs.cfg;
-            } else if (label == "ssa") {
-                actual = &outputs.ssa;
-            } else if (label == "optimisation log") {
-                actual = &outputs.optimisation_log;
-            } else if (label == "runtime trace") {
-                actual = &outputs.runtime_trace;
-            } else if (label == "runtime result") {
-                actual = &outputs.runtime_summary;
-            } else if (label == "diagnostics") {
-                actual = &outputs.diagnostics;
+    std::optional<GoldenBuffer> trace_golden;
+    std::optional<std::string> trace_diff;
+    std::ostringstream stamps;
+    if (depth.has_value()) {
+        for (std::size_t i = 0; i < expectations.size(); ++i) {
+            if (pending[i] && expectations[i].label == "runtime trace") {
+                trace_golden.emplace(case_path / expectations[i].filename);
+                if (!trace_golden->is_open()) {
+                    trace_golden.reset();
+                    trace_diff = missing_expectation(case_path / expectations[i].filename);
+                }
             }
+        }
+        std::ostream trace_stream(trace_golden.has_value() ? &*trace_golden : nullptr);
+        const auto outputs =
+            run_pipeline(*source, data.stdin_text, *depth, trace_golden.has_value() ? &trace_stream : nullptr);
+        if (trace_golden.has_value()) {
+            trace_diff = trace_golden->finish();
+        }
 
-            if (actual == nullptr) {
-                continue;
+        for (std::size_t i = 0; i < expectations.size(); ++i) {
+            const auto& expectation = expectations[i];
+            std::optional<std::string> diff;
+            if (pending[i]) {
+                const std::string* actual = select_output(outputs, expectation.label);
+                diff = actual != nullptr ? compare_output(case_path / expectation.filename, *actual) : trace_diff;
             }
-
-            const auto diff = compare_output(expected_path, *actual);
             if (diff.has_value()) {
-                success = false;
                 std::ostringstream message;
-                message << label << ": " << *diff;
+                message << expectation.label << ": " << *diff;
                 report.messages.emplace_back(message.str());
+            } else if (keys[i].has_value()) {
+                stamps << std::hex << std::setw(16) << std::setfill('0') << *keys[i] << ' ' << expectation.label
+                       << '\n';
             }
         }
+    }
 
-        report.success = success;
-        reports.push_back(std::move(report));
+    report.success = report.messages.empty();
+    if (stamping && depth.has_value()) {
+        std::error_code error;
+        std::filesystem::create_directories(options.stamps, error);
+        std::ofstream(stamp_path, std::ios::trunc) << stamps.str();
     }
+    return report;
+}
+
+}  // namespace
 
+auto run_suite() -> std::vector<CaseReport> {
+    SuiteOptions options;
+#ifdef IMPULSE_ACCEPTANCE_STAMPS
+    options.stamps = IMPULSE_ACCEPTANCE_STAMPS;
+#endif
+    return run_suite(options);
+}
+
+auto run_suite(const SuiteOptions& options) -> std::vector<CaseReport> {
+    const auto case_paths = collect_cases(options.cases.empty() ? cases_root() : options.cases);
+    std::vector<CaseReport> reports(case_paths.size());
+    const auto build = build_identity();
+
+    // Cases share nothing: each runs its own Vm and writes only its own stamp file
+    std::size_t threads = options.threads;
+    if (threads == 0) {
+        threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    impulse::runtime::TaskPool pool(std::min(threads, std::max<std::size_t>(case_paths.size(), 1)));
+    pool.run(case_paths.size(), 1, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            reports[i] = run_case(case_paths[i], options, build);
+        }
+    });
     return reports;
 }
 
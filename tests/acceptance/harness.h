@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -9,8 +11,23 @@ struct CaseReport {
     std::string name;
     bool success = false;
     std::vector<std::string> messages;
+    // Expectations that were not checked again because nothing they depend on changed
+    std::size_t skipped_stages = 0;
 };
 
+struct SuiteOptions {
+    std::filesystem::path cases;  // empty: tests/acceptance/cases
+    std::size_t threads = 0;      // cases run at once; 0 is one per hardware thread
+    // Where each case records the expectations it passed, keyed by a hash of the program, its
+    // stdin, the expected file and the test binary. An expectation whose key is recorded there is
+    // skipped, and the pipeline stops after the last stage still to be checked. Empty runs every
+    // stage.
+    std::filesystem::path stamps;
+};
+
+// The build's defaults: the source tree's cases, one thread per core, and the build directory's
+// stamps
 [[nodiscard]] auto run_suite() -> std::vector<CaseReport>;
+[[nodiscard]] auto run_suite(const SuiteOptions& options) -> std::vector<CaseReport>;
 
 }  // namespace impulse::tests::acceptance
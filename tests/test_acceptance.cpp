@@ -1,10 +1,46 @@
 #include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "acceptance/harness.h"
 
 using impulse::tests::acceptance::CaseReport;
 
+namespace {
+
+// A fresh directory under the system temp directory, removed again when the test ends however
+// it ends; the random name keeps parallel ctest runs and other builds out of each other's way
+class ScratchDirectory {
+public:
+    explicit ScratchDirectory(const std::string& prefix) {
+        std::random_device random;
+        const auto suffix = (static_cast<std::uint64_t>(random()) << 32U) | random();
+        std::ostringstream name;
+        name << prefix << '-' << std::hex << suffix;
+        path_ = std::filesystem::temp_directory_path() / name.str();
+        std::filesystem::create_directories(path_);
+    }
+    ~ScratchDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    auto operator=(const ScratchDirectory&) -> ScratchDirectory& = delete;
+
+    [[nodiscard]] auto path() const -> const std::filesystem::path& { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+}  // namespace
+
 TEST(AcceptanceTest, AllCases) {
     const auto reports = impulse::tests::acceptance::run_suite();
     for (const CaseReport& report : reports) {
@@ -18,3 +54,67 @@ TEST(AcceptanceTest, AllCases) {
         }
     }
 }
+
+TEST(AcceptanceTest, UnchangedExpectationsAreSkipped) {
+    const ScratchDirectory scratch("impulse-acceptance-test");
+    const auto& root = scratch.path();
+    std::filesystem::create_directories(root / "cases");
+    const auto source = std::filesystem::path{__FILE__}.parent_path() / "acceptance" / "cases";
+    for (const char* name : {"exam_primes", "runtime_demo", "strings"}) {
+        std::filesystem::copy(source / name, root / "cases" / name, std::filesystem::copy_options::recursive);
+    }
+
+    impulse::tests::acceptance::SuiteOptions options;
+    options.cases = root / "cases";
+    options.threads = 3;
+    options.stamps = root / "stamps";
+
+    const auto first = impulse::tests::acceptance::run_suite(options);
+    ASSERT_EQ(first.size(), 3U);
+    for (const CaseReport& report : first) {
+        EXPECT_TRUE(report.success) << report.name;
+        EXPECT_EQ(report.skipped_stages, 0U) << report.name;
+    }
+
+    const auto second = impulse::tests::acceptance::run_suite(options);
+    ASSERT_EQ(second.size(), 3U);
+    for (const CaseReport& report : second) {
+        EXPECT_TRUE(report.success) << report.name;
+        EXPECT_EQ(report.skipped_stages, 9U) << report.name;
+    }
+
+    // Only the edited expectation runs again, and the trace stops at its first differing line
+    const auto trace_path = root / "cases" / "exam_primes" / "expected.runtime-trace.txt";
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(trace_path);
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+    }
+    ASSERT_GT(lines.size(), 200U);
+    const std::string original = lines[150];
+    lines[150] = "enter block 99";
+    {
+        std::ofstream out(trace_path, std::ios::trunc);
+        for (const auto& line : lines) {
+            out << line << '\n';
+        }
+    }
+
+    const auto third = impulse::tests::acceptance::run_suite(options);
+    ASSERT_EQ(third.size(), 3U);
+    EXPECT_EQ(third[0].name, "exam_primes");
+    EXPECT_FALSE(third[0].success);
+    EXPECT_EQ(third[0].skipped_stages, 8U);
+    ASSERT_EQ(third[0].messages.size(), 1U);
+    EXPECT_EQ(third[0].messages[0],
+              "runtime trace: line 151 differs\n  expected: enter block 99\n    actual: " + original);
+    EXPECT_TRUE(third[1].success);
+    EXPECT_EQ(third[1].skipped_stages, 9U);
+
+    // A failed expectation is not stamped, so it keeps being checked
+    const auto fourth = impulse::tests::acceptance::run_suite(options);
+    EXPECT_FALSE(fourth[0].success);
+    EXPECT_EQ(fourth[0].skipped_stages, 8U);
+}
@@ -31,7 +31,7 @@ namespace {
     return buffer.str();
 }
 
-[[nodiscard]] auto run_benchmark(const std::string& source) -> impulse::runtime::VmResult {
+[[nodiscard]] auto run_benchmark(const std::string& source, const std::string& input = "") -> impulse::runtime::VmResult {
     impulse::frontend::Parser parser(source);
     auto parse_result = parser.parseModule();
     if (!parse_result.success) {
@@ -54,6 +54,8 @@ namespace {
 
     const auto lowered = impulse::frontend::lower_to_ir(parse_result.module);
     impulse::runtime::Vm vm;
+    std::istringstream input_stream(input);
+    vm.set_input_stream(&input_stream);
     const auto load_result = vm.load(lowered);
     if (!load_result.success) {
         impulse::runtime::VmResult error_result;
@@ -259,3 +261,39 @@ TEST(BenchmarkTest, NBodyParseAndSemantic) {
     EXPECT_TRUE(semantic.diagnostics.empty()) 
         << "Unexpected diagnostics in nbody.impulse";
 }
+
+// The *_scaled benchmarks read their size from standard input and fall back to a small default
+TEST(BenchmarkTest, ScaledBenchmarksAtDefaultSizes) {
+    const std::pair<const char*, double> cases[] = {
+        {"sort_scaled.impulse", 1.0},           {"sieve_scaled.impulse", 9592.0},
+        {"strings_scaled.impulse", 60100.0},    {"trees_scaled.impulse", 135854.0},
+        {"buckets_scaled.impulse", 10000.0},    {"recursion_scaled.impulse", 50051021.0},
+    };
+    for (const auto& [file, expected] : cases) {
+        const auto source = read_file(get_benchmarks_dir() / file);
+        ASSERT_TRUE(source.has_value()) << "Failed to read " << file;
+        const auto result = run_benchmark(*source);
+        EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << file << ": " << result.message;
+        EXPECT_DOUBLE_EQ(result.value, expected) << file;
+    }
+
+    const auto nbody = read_file(get_benchmarks_dir() / "nbody_scaled.impulse");
+    ASSERT_TRUE(nbody.has_value()) << "Failed to read nbody_scaled.impulse";
+    const auto result = run_benchmark(*nbody);
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << "Runtime error: " << result.message;
+    EXPECT_NEAR(result.value, -0.169087605235, 1e-10);
+}
+
+TEST(BenchmarkTest, ScaledBenchmarksReadTheirSize) {
+    const auto sieve = read_file(get_benchmarks_dir() / "sieve_scaled.impulse");
+    ASSERT_TRUE(sieve.has_value()) << "Failed to read sieve_scaled.impulse";
+    EXPECT_DOUBLE_EQ(run_benchmark(*sieve, "1000000\n").value, 78498.0);
+    EXPECT_DOUBLE_EQ(run_benchmark(*sieve, "1000").value, 168.0);
+
+    const auto buckets = read_file(get_benchmarks_dir() / "buckets_scaled.impulse");
+    ASSERT_TRUE(buckets.has_value()) << "Failed to read buckets_scaled.impulse";
+    EXPECT_DOUBLE_EQ(run_benchmark(*buckets, "50000").value, 50000.0);
+
+    // Anything but digits falls back to the default
+    EXPECT_DOUBLE_EQ(run_benchmark(*sieve, "ten").value, 9592.0);
+}
@@ -759,6 +759,40 @@ func main() -> int {
     EXPECT_DOUBLE_EQ(result.value, 0.0);
 }
 
+TEST(StressTest, TailCallsRunInConstantStack) {
+    // Self tail calls become loops; the mutual ones reuse the caller's frame (Vm) or jump (JIT)
+    const std::string source = R"(module test;
+
+func is_even(n: int) -> int {
+    if n == 0 {
+        return 1;
+    }
+    return is_odd(n - 1);
+}
+
+func is_odd(n: int) -> int {
+    if n == 0 {
+        return 0;
+    }
+    return is_even(n - 1);
+}
+
+func swap(a: int, b: int, n: int) -> int {
+    if n == 0 {
+        return a * 10 + b;
+    }
+    return swap(b, a, n - 1);
+}
+
+func main() -> int {
+    return is_even(1000001) + swap(1, 2, 1000001) * 10;
+}
+)";
+    const auto result = run_program(source);
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success);
+    EXPECT_DOUBLE_EQ(result.value, 210.0);
+}
+
 TEST(StressTest, FibonacciRecursive) {
     const std::string source = R"(module test;
 
@@ -1,15 +1,28 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../frontend/include/impulse/frontend/lowering.h"
 #include "../frontend/include/impulse/frontend/parser.h"
+#include "../ir/include/impulse/ir/bounds.h"
 #include "../ir/include/impulse/ir/cfg.h"
+#include "../ir/include/impulse/ir/dump.h"
+#include "../ir/include/impulse/ir/inliner.h"
 #include "../ir/include/impulse/ir/interpreter.h"
+#include "../ir/include/impulse/ir/liveness.h"
+#include "../ir/include/impulse/ir/loops.h"
+#include "../ir/include/impulse/ir/optimizer.h"
+#include "../ir/include/impulse/ir/purity.h"
+#include "../ir/include/impulse/ir/serialize.h"
 #include "../ir/include/impulse/ir/ssa.h"
+#include "../ir/include/impulse/ir/tail_calls.h"
 
 TEST(IRTest, EmitIrText) {
     const std::string source = R"(module demo;
@@ -285,6 +298,7 @@ TEST(IRTest, SsaInsertsPhiNodes) {
 
     impulse::ir::BasicBlock merge;
     merge.label = "merge";
+    merge.instructions.push_back({impulse::ir::InstructionKind::Reference, {"x"}});
     merge.instructions.push_back({impulse::ir::InstructionKind::Return, {}});
     function.blocks.push_back(merge);
 
@@ -293,7 +307,7 @@ TEST(IRTest, SsaInsertsPhiNodes) {
 
     const auto* mergeBlock = ssa.find_block("merge");
     ASSERT_NE(mergeBlock, nullptr);
-    EXPECT_FALSE(mergeBlock->phi_nodes.empty());
+    ASSERT_FALSE(mergeBlock->phi_nodes.empty());
     const auto& phi = mergeBlock->phi_nodes.front();
     const auto* symbol = ssa.find_symbol(phi.symbol);
     ASSERT_NE(symbol, nullptr);
@@ -327,6 +341,7 @@ TEST(IRTest, SsaPopulatesPhiInputs) {
 
     impulse::ir::BasicBlock merge;
     merge.label = "merge";
+    merge.instructions.push_back({impulse::ir::InstructionKind::Reference, {"x"}});
     merge.instructions.push_back({impulse::ir::InstructionKind::Return, {}});
     function.blocks.push_back(merge);
 
@@ -349,6 +364,150 @@ TEST(IRTest, SsaPopulatesPhiInputs) {
     }
 }
 
+TEST(IRTest, SsaPlacesPhisOnlyWhereLive) {
+    // x is read after the merge; y is stored on both arms but never read again
+    impulse::ir::Function function;
+    function.name = "pruned";
+    impulse::ir::BasicBlock body;
+    body.label = "entry";
+    const auto add = [&](impulse::ir::InstructionKind kind, std::vector<std::string> operands) {
+        body.instructions.push_back({kind, std::move(operands)});
+    };
+    using Kind = impulse::ir::InstructionKind;
+    add(Kind::Literal, {"1"});
+    add(Kind::BranchIf, {"then", "1"});
+    add(Kind::Branch, {"else"});
+    add(Kind::Label, {"then"});
+    add(Kind::Literal, {"10"});
+    add(Kind::Store, {"x"});
+    add(Kind::Literal, {"11"});
+    add(Kind::Store, {"y"});
+    add(Kind::Branch, {"merge"});
+    add(Kind::Label, {"else"});
+    add(Kind::Literal, {"20"});
+    add(Kind::Store, {"x"});
+    add(Kind::Literal, {"21"});
+    add(Kind::Store, {"y"});
+    add(Kind::Branch, {"merge"});
+    add(Kind::Label, {"merge"});
+    add(Kind::Reference, {"x"});
+    add(Kind::Return, {});
+    function.blocks.push_back(body);
+
+    const auto ssa = impulse::ir::build_ssa(function);
+    const auto* merge = ssa.find_block("merge");
+    ASSERT_NE(merge, nullptr);
+    ASSERT_EQ(merge->phi_nodes.size(), 1U);
+    EXPECT_EQ(ssa.find_symbol(merge->phi_nodes.front().symbol)->name, "x");
+}
+
+TEST(IRTest, DominatorsIgnoreBlockNumbering) {
+    // Block indices deliberately disagree with any depth-first order:
+    // 0 -> 3, 3 -> 1 | 2, 1 -> 4, 2 -> 4, 4 -> 3 (loop back to 3) | 5
+    impulse::ir::SsaFunction function;
+    const std::vector<std::vector<std::size_t>> successors{{3}, {4}, {4}, {1, 2}, {3, 5}, {}};
+    function.blocks.resize(successors.size());
+    for (std::size_t b = 0; b < successors.size(); ++b) {
+        function.blocks[b].id = b;
+        function.blocks[b].successors = successors[b];
+        for (const auto successor : successors[b]) {
+            function.blocks[successor].predecessors.push_back(b);
+        }
+    }
+    function.blocks.push_back({});  // unreachable
+    function.blocks.back().id = 6;
+    function.blocks.back().successors = {4};
+    function.blocks[4].predecessors.push_back(6);
+
+    impulse::ir::compute_dominators(function);
+    const std::vector<std::size_t> expected{0, 3, 3, 0, 3, 4};
+    for (std::size_t b = 0; b < expected.size(); ++b) {
+        EXPECT_EQ(function.blocks[b].immediate_dominator, expected[b]) << "block " << b;
+    }
+    EXPECT_EQ(function.blocks[6].immediate_dominator, std::numeric_limits<std::size_t>::max());
+    const auto& frontier = function.blocks[4].dominance_frontier;
+    EXPECT_NE(std::find(frontier.begin(), frontier.end(), 3U), frontier.end());
+}
+
+// A generated function of 2,500 if/else diamonds inside one loop: 10,003 blocks, 16 variables that
+// the arms update and 4 that they store without reading. Dominators, phi placement and renaming
+// are all near-linear, so this builds in a few tens of milliseconds in an optimised build; the
+// budget leaves room for sanitizer and debug builds while still catching a quadratic step.
+TEST(IRTest, SsaBuildsTenThousandBlocksWithinBudget) {
+    constexpr int kDiamonds = 2500;
+    constexpr int kVariables = 16;
+    using Kind = impulse::ir::InstructionKind;
+    impulse::ir::Function function;
+    function.name = "generated";
+    function.parameters.push_back({"n", "int"});
+    impulse::ir::BasicBlock body;
+    body.label = "entry";
+    const auto add = [&](Kind kind, std::vector<std::string> operands) {
+        body.instructions.push_back({kind, std::move(operands)});
+    };
+    for (int v = 0; v < kVariables; ++v) {
+        add(Kind::Literal, {"0"});
+        add(Kind::Store, {"v" + std::to_string(v)});
+    }
+    add(Kind::Label, {"loop"});
+    for (int i = 0; i < kDiamonds; ++i) {
+        const std::string n = std::to_string(i);
+        const std::string left = "v" + std::to_string(i % kVariables);
+        const std::string right = "v" + std::to_string((i * 7 + 3) % kVariables);
+        add(Kind::Reference, {"n"});
+        add(Kind::Literal, {n});
+        add(Kind::Binary, {"<"});
+        add(Kind::BranchIf, {"then" + n, "1"});
+        add(Kind::Branch, {"else" + n});
+        add(Kind::Label, {"then" + n});
+        add(Kind::Reference, {left});
+        add(Kind::Literal, {"1"});
+        add(Kind::Binary, {"+"});
+        add(Kind::Store, {left});
+        add(Kind::Literal, {"1"});
+        add(Kind::Store, {"unused" + std::to_string(i % 4)});
+        add(Kind::Branch, {"join" + n});
+        add(Kind::Label, {"else" + n});
+        add(Kind::Reference, {right});
+        add(Kind::Literal, {"2"});
+        add(Kind::Binary, {"*"});
+        add(Kind::Store, {right});
+        add(Kind::Branch, {"join" + n});
+        add(Kind::Label, {"join" + n});
+    }
+    add(Kind::Reference, {"n"});
+    add(Kind::Literal, {"1"});
+    add(Kind::Binary, {"-"});
+    add(Kind::Store, {"n"});
+    add(Kind::Reference, {"n"});
+    add(Kind::Literal, {"0"});
+    add(Kind::Binary, {">"});
+    add(Kind::BranchIf, {"loop", "1"});
+    add(Kind::Reference, {"v0"});
+    add(Kind::Return, {});
+    function.blocks.push_back(std::move(body));
+
+    const auto cfg = impulse::ir::build_control_flow_graph(function);
+    ASSERT_GE(cfg.blocks.size(), 10000U);
+    const auto start = std::chrono::steady_clock::now();
+    const auto ssa = impulse::ir::build_ssa(function, cfg);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+
+    std::size_t phis = 0;
+    for (const auto& block : ssa.blocks) {
+        for (const auto& phi : block.phi_nodes) {
+            ++phis;
+            EXPECT_EQ(ssa.find_symbol(phi.symbol)->name.rfind("unused", 0), std::string::npos);
+        }
+    }
+    // Each join merges the variable its arms changed (two when they differ), the loop header the
+    // updated variables and n
+    EXPECT_GT(phis, static_cast<std::size_t>(kDiamonds));
+    EXPECT_LE(phis, static_cast<std::size_t>(2 * kDiamonds + kVariables + 1));
+    EXPECT_EQ(ssa.blocks[cfg.blocks.size() - 1].immediate_dominator, cfg.blocks.size() - 2);
+}
+
 TEST(IRTest, SsaMaterializesInstructions) {
     impulse::ir::Function function;
     function.name = "ssa_materialize";
@@ -384,3 +543,838 @@ TEST(IRTest, SsaMaterializesInstructions) {
     EXPECT_EQ(ret.arguments.size(), 1);
     EXPECT_EQ(ret.arguments.front().symbol, assign.result->symbol);
 }
+
+TEST(IRTest, SsaSerializationRoundTrips) {
+    const std::string source = R"(module demo;
+
+func pick(flag: int) -> int {
+    let x: int = 1;
+    if flag > 0 {
+        x = 10;
+    } else {
+        x = 20;
+    }
+    while x > 5 {
+        x = x - 3;
+    }
+    return x;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    ASSERT_EQ(lowered.functions.size(), 1);
+    const auto ssa = impulse::ir::build_ssa(lowered.functions.front());
+
+    std::string encoded;
+    impulse::ir::BinaryWriter writer(encoded);
+    impulse::ir::serialize_ssa(ssa, writer);
+
+    impulse::ir::BinaryReader reader(encoded);
+    const auto decoded = impulse::ir::deserialize_ssa(reader);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(reader.remaining(), 0);
+
+    std::ostringstream expected;
+    std::ostringstream actual;
+    impulse::ir::dump_ssa(ssa, expected);
+    impulse::ir::dump_ssa(*decoded, actual);
+    EXPECT_EQ(actual.str(), expected.str());
+    ASSERT_NE(decoded->find_symbol("x"), nullptr);
+    EXPECT_EQ(decoded->find_symbol("x")->id, ssa.find_symbol("x")->id);
+
+    // Truncated input is rejected rather than decoded partially
+    impulse::ir::BinaryReader truncated(std::string_view(encoded).substr(0, encoded.size() / 2));
+    EXPECT_FALSE(impulse::ir::deserialize_ssa(truncated).has_value());
+}
+
+TEST(IRTest, SsaDecodesOperandsOnce) {
+    const std::string source = R"(module demo;
+
+func f(n: int) -> int {
+    let total: int = 1_000;
+    if !(n < 3) {
+        total = -total;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    const auto ssa = impulse::ir::build_ssa(lowered.functions.front());
+
+    const auto check = [](const impulse::ir::SsaFunction& function) {
+        std::vector<double> literals;
+        std::vector<impulse::ir::UnaryOp> unary;
+        std::vector<impulse::ir::BinaryOp> binary;
+        std::size_t branches = 0;
+        for (const auto& block : function.blocks) {
+            for (const auto& inst : block.instructions) {
+                if (inst.op == impulse::ir::SsaOpcode::Literal) {
+                    ASSERT_TRUE(inst.number.has_value());
+                    literals.push_back(*inst.number);
+                } else if (inst.op == impulse::ir::SsaOpcode::Unary) {
+                    unary.push_back(inst.unary_op);
+                } else if (inst.op == impulse::ir::SsaOpcode::Binary) {
+                    binary.push_back(inst.binary_op);
+                } else if (inst.op == impulse::ir::SsaOpcode::BranchIf) {
+                    ASSERT_TRUE(inst.number.has_value());
+                    EXPECT_EQ(*inst.number, std::stod(inst.immediates[1]));
+                    ++branches;
+                }
+            }
+        }
+        EXPECT_NE(std::find(literals.begin(), literals.end(), 1000.0), literals.end());
+        EXPECT_NE(std::find(literals.begin(), literals.end(), 3.0), literals.end());
+        EXPECT_NE(std::find(unary.begin(), unary.end(), impulse::ir::UnaryOp::Not), unary.end());
+        EXPECT_NE(std::find(unary.begin(), unary.end(), impulse::ir::UnaryOp::Neg), unary.end());
+        EXPECT_EQ(std::count(binary.begin(), binary.end(), impulse::ir::BinaryOp::Lt), 1);
+        EXPECT_EQ(branches, 1U);
+    };
+    check(ssa);
+
+    // Only the text is serialized; reading decodes it again
+    std::string encoded;
+    impulse::ir::BinaryWriter writer(encoded);
+    impulse::ir::serialize_ssa(ssa, writer);
+    impulse::ir::BinaryReader reader(encoded);
+    const auto decoded = impulse::ir::deserialize_ssa(reader);
+    ASSERT_TRUE(decoded.has_value());
+    check(*decoded);
+
+    // A literal the runtime cannot load stays undecoded, for the bytecode compiler to report
+    impulse::ir::SsaInstruction bad;
+    bad.opcode = "literal";
+    bad.immediates = {"1.2.3"};
+    impulse::ir::decode_operands(bad);
+    EXPECT_EQ(bad.op, impulse::ir::SsaOpcode::Literal);
+    EXPECT_FALSE(bad.number.has_value());
+}
+
+TEST(IRTest, LivenessTracksPhiEdges) {
+    impulse::ir::Function function;
+    function.name = "liveness_phi";
+
+    impulse::ir::BasicBlock entry;
+    entry.label = "entry";
+    entry.instructions.push_back({impulse::ir::InstructionKind::Literal, {"5"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::Store, {"y"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::Literal, {"1"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::BranchIf, {"then", "0"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::Branch, {"else"}});
+    function.blocks.push_back(entry);
+
+    impulse::ir::BasicBlock thenBlock;
+    thenBlock.label = "then";
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Literal, {"10"}});
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Store, {"x"}});
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Branch, {"merge"}});
+    function.blocks.push_back(thenBlock);
+
+    impulse::ir::BasicBlock elseBlock;
+    elseBlock.label = "else";
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Literal, {"20"}});
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Store, {"x"}});
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Branch, {"merge"}});
+    function.blocks.push_back(elseBlock);
+
+    impulse::ir::BasicBlock merge;
+    merge.label = "merge";
+    merge.instructions.push_back({impulse::ir::InstructionKind::Reference, {"x"}});
+    merge.instructions.push_back({impulse::ir::InstructionKind::Reference, {"y"}});
+    merge.instructions.push_back({impulse::ir::InstructionKind::Binary, {"+"}});
+    merge.instructions.push_back({impulse::ir::InstructionKind::Return, {}});
+    function.blocks.push_back(merge);
+
+    const auto cfg = impulse::ir::build_control_flow_graph(function);
+    const auto ssa = impulse::ir::build_ssa(function, cfg);
+    const auto liveness = impulse::ir::compute_liveness(ssa);
+    ASSERT_EQ(liveness.live_in.size(), ssa.blocks.size());
+
+    const auto* mergeBlock = ssa.find_block("merge");
+    ASSERT_NE(mergeBlock, nullptr);
+    ASSERT_EQ(mergeBlock->phi_nodes.size(), 1);
+    const auto& phi = mergeBlock->phi_nodes.front();
+
+    // Each phi input is live out of its own predecessor only; the phi result is never live in
+    for (const auto& input : phi.inputs) {
+        ASSERT_TRUE(input.value.has_value());
+        EXPECT_TRUE(liveness.is_live_out(input.predecessor, *input.value));
+        EXPECT_FALSE(liveness.is_live_out(input.predecessor, phi.result));
+        for (const auto& other : phi.inputs) {
+            if (other.predecessor != input.predecessor) {
+                EXPECT_FALSE(liveness.is_live_out(other.predecessor, *input.value));
+            }
+        }
+    }
+    const auto phi_id = liveness.find(phi.result);
+    ASSERT_TRUE(phi_id.has_value());
+    const auto& merge_in = liveness.live_in[mergeBlock->id];
+    EXPECT_EQ(std::count(merge_in.begin(), merge_in.end(), *phi_id), 0);
+
+    // y is defined in entry and used in merge, so it flows through both arms
+    const auto* y = ssa.find_symbol("y");
+    ASSERT_NE(y, nullptr);
+    const impulse::ir::SsaValue y_value{y->id, 1};
+    for (const auto& input : phi.inputs) {
+        EXPECT_TRUE(liveness.is_live_out(input.predecessor, y_value));
+    }
+}
+
+namespace {
+
+auto build_function_ssa(const std::string& source, const std::string& name) -> impulse::ir::SsaFunction {
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    EXPECT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    for (const auto& function : lowered.functions) {
+        if (function.name == name) {
+            return impulse::ir::build_ssa(function);
+        }
+    }
+    ADD_FAILURE() << "no function " << name;
+    return {};
+}
+
+auto count_opcode(const impulse::ir::SsaFunction& ssa, impulse::ir::SsaOpcode op) -> std::size_t {
+    std::size_t count = 0;
+    for (const auto& block : ssa.blocks) {
+        count += static_cast<std::size_t>(std::count_if(block.instructions.begin(), block.instructions.end(),
+                                                        [&](const auto& inst) { return inst.op == op; }));
+    }
+    return count;
+}
+
+}  // namespace
+
+TEST(IRTest, OptimizerFoldsConstantBranches) {
+    const std::string source = R"(module demo;
+
+func pick() -> int {
+    let limit: int = 4;
+    let scale: int = limit * 3;
+    if scale > 10 {
+        return scale + 1;
+    }
+    return 0;
+}
+)";
+
+    auto ssa = build_function_ssa(source, "pick");
+    const std::size_t blocks_before = ssa.blocks.size();
+    std::vector<std::string> log;
+    EXPECT_TRUE(impulse::ir::optimize_ssa(ssa, {}, &log));
+
+    // The condition folds, the untaken arm goes away and only the constant result is left
+    EXPECT_LT(ssa.blocks.size(), blocks_before);
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::BranchIf), 0);
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::Binary), 0);
+    for (std::size_t i = 0; i < ssa.blocks.size(); ++i) {
+        EXPECT_EQ(ssa.blocks[i].id, i);
+    }
+    bool returns_thirteen = false;
+    for (const auto& block : ssa.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.op == impulse::ir::SsaOpcode::Literal && inst.immediates.front() == "13") {
+                returns_thirteen = true;
+            }
+        }
+    }
+    EXPECT_TRUE(returns_thirteen);
+    ASSERT_EQ(log.size(), 7);
+    EXPECT_EQ(log.front().rfind("sccp: ", 0), 0);
+    EXPECT_NE(log.front().find("1 branch resolved"), std::string::npos);
+}
+
+TEST(IRTest, OptimizerSharesRedundantValuesAndKeepsFaults) {
+    const std::string source = R"(module demo;
+
+let bias: int = 2;
+
+func mix(a: int, b: int) -> int {
+    let left: int = a * b + bias;
+    let right: int = b * a + bias;
+    let unused: int = a / 0;
+    let copy: int = left;
+    return copy + right;
+}
+)";
+
+    auto ssa = build_function_ssa(source, "mix");
+    EXPECT_TRUE(impulse::ir::optimize_ssa(ssa));
+
+    // b * a reuses a * b; the global is read by name each time, so its additions stay separate.
+    // The unused division by zero still has to fault
+    std::size_t multiplies = 0;
+    std::size_t divisions = 0;
+    for (const auto& block : ssa.blocks) {
+        for (const auto& inst : block.instructions) {
+            multiplies += inst.binary_op == impulse::ir::BinaryOp::Mul ? 1 : 0;
+            divisions += inst.binary_op == impulse::ir::BinaryOp::Div ? 1 : 0;
+        }
+    }
+    EXPECT_EQ(multiplies, 1);
+    EXPECT_EQ(divisions, 1);
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::Assign), 0);
+}
+
+TEST(IRTest, OptimizerPassesCanBeDisabled) {
+    const std::string source = R"(module demo;
+
+func count(n: int) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < n {
+        total = total + 2 * 3;
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    const auto original = build_function_ssa(source, "count");
+    std::ostringstream expected;
+    impulse::ir::dump_ssa(original, expected);
+
+    impulse::ir::OptimizationOptions none;
+    for (const char* pass : {"fold-calls", "inline", "tail-calls", "sccp", "copy-propagation", "gvn", "licm",
+                             "strength-reduction", "scalar-replacement", "dce"}) {
+        EXPECT_TRUE(impulse::ir::disable_optimization_pass(none, pass));
+    }
+    EXPECT_FALSE(impulse::ir::disable_optimization_pass(none, "unroll"));
+
+    auto untouched = original;
+    impulse::ir::index_symbols(untouched);
+    std::vector<std::string> log;
+    EXPECT_FALSE(impulse::ir::optimize_ssa(untouched, none, &log));
+    std::ostringstream actual;
+    impulse::ir::dump_ssa(untouched, actual);
+    EXPECT_EQ(actual.str(), expected.str());
+    ASSERT_EQ(log.size(), 7);
+    EXPECT_EQ(log[2], "gvn: disabled");
+
+    // Constant folding alone rewrites 2 * 3 but removes nothing
+    impulse::ir::OptimizationOptions sccp_only = none;
+    sccp_only.constant_propagation = true;
+    auto folded = original;
+    impulse::ir::index_symbols(folded);
+    EXPECT_TRUE(impulse::ir::optimize_ssa(folded, sccp_only));
+    for (std::size_t i = 0; i < original.blocks.size(); ++i) {
+        EXPECT_EQ(folded.blocks[i].instructions.size(), original.blocks[i].instructions.size());
+    }
+    EXPECT_EQ(count_opcode(folded, impulse::ir::SsaOpcode::Binary),
+              count_opcode(original, impulse::ir::SsaOpcode::Binary) - 1);
+}
+
+TEST(IRTest, LoopNestFindsNaturalLoopsAndPreheaders) {
+    const std::string source = R"(module demo;
+
+func grid(n: int) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < n {
+        while total < i * 10 {
+            total = total + 1;
+        }
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    auto ssa = build_function_ssa(source, "grid");
+    auto nest = impulse::ir::find_loops(ssa);
+    ASSERT_EQ(nest.loops.size(), 2);
+    const auto& inner = nest.loops[0];
+    const auto& outer = nest.loops[1];
+    EXPECT_EQ(inner.depth, 2);
+    EXPECT_EQ(inner.parent, std::optional<std::size_t>{1});
+    EXPECT_EQ(outer.depth, 1);
+    EXPECT_TRUE(outer.contains(inner.header));
+    EXPECT_EQ(nest.loop_of(inner.header), &inner);
+    ASSERT_TRUE(outer.preheader.has_value());
+    EXPECT_EQ(*outer.preheader, 0);
+    // The inner loop is entered straight from the outer loop's condition
+    EXPECT_FALSE(inner.preheader.has_value());
+
+    EXPECT_EQ(impulse::ir::insert_preheaders(ssa), 1);
+    nest = impulse::ir::find_loops(ssa);
+    ASSERT_EQ(nest.loops.size(), 2);
+    for (const auto& loop : nest.loops) {
+        ASSERT_TRUE(loop.preheader.has_value());
+        EXPECT_EQ(*loop.preheader + 1, loop.header);
+        for (const auto latch : loop.latches) {
+            EXPECT_GE(latch, loop.header);  // back edges still point backwards
+        }
+    }
+    for (std::size_t i = 0; i < ssa.blocks.size(); ++i) {
+        EXPECT_EQ(ssa.blocks[i].id, i);
+    }
+    EXPECT_EQ(impulse::ir::insert_preheaders(ssa), 0);
+}
+
+TEST(IRTest, OptimizerHoistsLoopInvariants) {
+    const std::string source = R"(module demo;
+
+func scaled(n: int, k: int) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < n {
+        total = total + k * 7 + 100 / k;
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    auto ssa = build_function_ssa(source, "scaled");
+    std::vector<std::string> log;
+    EXPECT_TRUE(impulse::ir::optimize_ssa(ssa, {}, &log));
+
+    // k * 7 cannot fault and moves to the entry; 100 / k might divide by zero and stays put
+    const auto nest = impulse::ir::find_loops(ssa);
+    ASSERT_EQ(nest.loops.size(), 1);
+    const auto& loop = nest.loops.front();
+    for (const auto b : loop.blocks) {
+        for (const auto& inst : ssa.blocks[b].instructions) {
+            EXPECT_NE(inst.binary_op, impulse::ir::BinaryOp::Mul);
+            EXPECT_NE(inst.op, impulse::ir::SsaOpcode::Literal);
+        }
+    }
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::Binary), 6);
+    bool divides_in_loop = false;
+    for (const auto b : loop.blocks) {
+        for (const auto& inst : ssa.blocks[b].instructions) {
+            divides_in_loop = divides_in_loop || inst.binary_op == impulse::ir::BinaryOp::Div;
+        }
+    }
+    EXPECT_TRUE(divides_in_loop);
+    ASSERT_EQ(log.size(), 7);
+    EXPECT_EQ(log[3].rfind("licm: ", 0), 0);
+}
+
+TEST(IRTest, OptimizerReducesInductionMultiplies) {
+    const std::string source = R"(module demo;
+
+func strided(n: int) -> int {
+    let total: int = 0;
+    let i: int = 1;
+    while i < n {
+        total = total + i * 8;
+        i = i + 2;
+    }
+    return total;
+}
+)";
+
+    auto ssa = build_function_ssa(source, "strided");
+    std::vector<std::string> log;
+    EXPECT_TRUE(impulse::ir::optimize_ssa(ssa, {}, &log));
+    ASSERT_EQ(log.size(), 7);
+    EXPECT_EQ(log[4], "strength-reduction: 1 multiplication reduced");
+
+    // The product becomes a second header phi starting at 1 * 8 and stepping by 2 * 8
+    const auto nest = impulse::ir::find_loops(ssa);
+    ASSERT_EQ(nest.loops.size(), 1);
+    EXPECT_EQ(ssa.blocks[nest.loops.front().header].phi_nodes.size(), 3);
+    std::size_t multiplies = 0;
+    bool steps_by_sixteen = false;
+    for (const auto& block : ssa.blocks) {
+        for (const auto& inst : block.instructions) {
+            multiplies += inst.binary_op == impulse::ir::BinaryOp::Mul ? 1 : 0;
+            steps_by_sixteen =
+                steps_by_sixteen || (inst.op == impulse::ir::SsaOpcode::Literal && inst.immediates.front() == "16");
+        }
+    }
+    EXPECT_EQ(multiplies, 0);
+    EXPECT_TRUE(steps_by_sixteen);
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::Binary), 4);
+}
+
+TEST(IRTest, OptimizerReplacesArraysThatDoNotEscape) {
+    const std::string source = R"(module demo;
+
+func local(x: float, y: float) -> float {
+    let v: array = array(3);
+    array_set(v, 0, x);
+    array_set(v, 1, y);
+    array_set(v, 2, x * y);
+    let i: int = 0;
+    let s: float = 0.0;
+    while i < 10 {
+        array_set(v, 0, array_get(v, 0) + array_get(v, 1));
+        s = s + array_get(v, 2);
+        i = i + 1;
+    }
+    return s + array_get(v, 0) + array_length(v);
+}
+
+func passed(x: float) -> float {
+    let v: array = array(2);
+    array_set(v, 0, x);
+    return local(array_length(v), 1.0) + array_sum(v);
+}
+
+func unset(x: float) -> float {
+    let v: array = array(1);
+    if x > 0.0 {
+        array_set(v, 0, x);
+    }
+    return array_get(v, 0);
+}
+
+func indexed(x: float, i: int) -> float {
+    let v: array = array(2);
+    array_set(v, 0, x);
+    array_set(v, 1, x);
+    return array_get(v, i);
+}
+)";
+
+    // The elements of v become the loop's values: a header phi for element 0, the product for 2
+    auto local = build_function_ssa(source, "local");
+    std::vector<std::string> log;
+    EXPECT_TRUE(impulse::ir::optimize_ssa(local, {}, &log));
+    ASSERT_EQ(log.size(), 7);
+    EXPECT_EQ(log[5], "scalar-replacement: 1 array replaced");
+    for (const auto op : {impulse::ir::SsaOpcode::ArrayMake, impulse::ir::SsaOpcode::ArrayGet,
+                          impulse::ir::SsaOpcode::ArraySet, impulse::ir::SsaOpcode::ArrayLength}) {
+        EXPECT_EQ(count_opcode(local, op), 0);
+    }
+    const auto nest = impulse::ir::find_loops(local);
+    ASSERT_EQ(nest.loops.size(), 1);
+    EXPECT_EQ(local.blocks[nest.loops.front().header].phi_nodes.size(), 3);
+
+    // Passed to a builtin, read where it may still be nil, or indexed by a variable: they stay
+    for (const char* name : {"passed", "unset", "indexed"}) {
+        auto kept = build_function_ssa(source, name);
+        (void)impulse::ir::optimize_ssa(kept);
+        EXPECT_EQ(count_opcode(kept, impulse::ir::SsaOpcode::ArrayMake), 1) << name;
+    }
+}
+
+TEST(IRTest, OptimizerKeepsSymbolIndexWhenReplacementBailsOut) {
+    const std::string source = R"(module demo;
+
+func f(c: int) -> int {
+    let a: array = array(3);
+    if c > 0 {
+        array_set(a, 0, 5);
+    }
+    array_set(a, 1, 7);
+    return array_get(a, 1) + array_length(a) + array_get(a, 0);
+}
+)";
+
+    // Element 0 needs a phi at the join before it turns out to be nil on one path, so the pass
+    // gives up after adding temporaries; the lookup index must not point at the old symbols
+    auto ssa = build_function_ssa(source, "f");
+    (void)impulse::ir::optimize_ssa(ssa);
+    EXPECT_EQ(count_opcode(ssa, impulse::ir::SsaOpcode::ArrayMake), 1);
+    EXPECT_EQ(ssa.symbol_id_index_.size(), ssa.symbols.size());
+    for (const auto& symbol : ssa.symbols) {
+        EXPECT_EQ(ssa.find_symbol(symbol.id), &symbol) << symbol.name;
+        EXPECT_EQ(ssa.find_symbol(symbol.name), &symbol) << symbol.name;
+    }
+}
+
+TEST(IRTest, ArrayBoundsProvesCountedLoops) {
+    const std::string source = R"(module demo;
+
+func scan(a: array) -> float {
+    let i: int = 0;
+    let s: float = 0.0;
+    while i < array_length(a) {
+        s = s + array_get(a, i);
+        array_set(a, i, s);
+        if i > 0 {
+            s = s + array_get(a, i - 1);
+        }
+        i = i + 2;
+    }
+    return s;
+}
+
+func touch(a: array) -> int {
+    return array_length(a);
+}
+
+func popped(a: array) -> float {
+    let i: int = 0;
+    let s: float = 0.0;
+    while i < array_length(a) {
+        s = s + array_get(a, i);
+        if s > 10.0 {
+            s = array_pop(a);
+        }
+        i = i + 1;
+    }
+    return s;
+}
+
+func called(a: array) -> float {
+    let i: int = 0;
+    let s: float = 0.0;
+    while i < array_length(a) {
+        s = s + array_get(a, i) + touch(a);
+        i = i + 1;
+    }
+    return s;
+}
+
+func hoisted(a: array) -> float {
+    let n: int = array_length(a);
+    array_pop(a);
+    let i: int = 0;
+    let s: float = 0.0;
+    while i < n {
+        s = s + array_get(a, i);
+        i = i + 1;
+    }
+    return s;
+}
+
+func inclusive(a: array) -> float {
+    let i: int = 0;
+    let s: float = 0.0;
+    while i <= array_length(a) {
+        s = s + array_get(a, i);
+        i = i + 1;
+    }
+    return s;
+}
+)";
+
+    // a[i] is read and written below the guard; a[i - 1] is not covered by it
+    auto scan = build_function_ssa(source, "scan");
+    (void)impulse::ir::optimize_ssa(scan);
+    const impulse::ir::ArrayBounds bounds(scan, impulse::ir::ValueFacts(scan));
+    EXPECT_EQ(bounds.size(), 2);
+    for (const auto& block : scan.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.op == impulse::ir::SsaOpcode::ArraySet) {
+                EXPECT_TRUE(bounds.in_bounds(inst));
+            }
+        }
+    }
+
+    // A pop or a user call in the loop, a length taken before a pop, or `<=`: nothing is proven
+    for (const char* name : {"popped", "called", "hoisted", "inclusive"}) {
+        auto kept = build_function_ssa(source, name);
+        (void)impulse::ir::optimize_ssa(kept);
+        EXPECT_EQ(impulse::ir::ArrayBounds(kept, impulse::ir::ValueFacts(kept)).size(), 0) << name;
+    }
+}
+
+TEST(IRTest, InlinerSplicesSmallCallees) {
+    const std::string source = R"(module demo;
+
+let factor: int = 3;
+
+func square(x: int) -> int {
+    return x * x;
+}
+
+func clamp(x: int, hi: int) -> int {
+    if x > hi {
+        return hi;
+    }
+    return x;
+}
+
+func scaled(x: int) -> int {
+    return x * factor;
+}
+
+func shout(x: int) -> int {
+    println(x);
+    return x;
+}
+
+func fact(n: int) -> int {
+    if n < 2 {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+
+func main() -> int {
+    return square(3) + clamp(12, 10) + scaled(2) + shout(1) + fact(4);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    std::unordered_map<std::string, impulse::ir::SsaFunction> functions;
+    std::unordered_map<std::string, std::vector<std::string>> parameters;
+    for (const auto& function : lowered.functions) {
+        functions.emplace(function.name, impulse::ir::build_ssa(function));
+        for (const auto& parameter : function.parameters) {
+            parameters[function.name].push_back(parameter.name);
+        }
+    }
+    const auto lookup = [&](const std::string& name) -> std::optional<impulse::ir::InlineCandidate> {
+        const auto it = functions.find(name);
+        if (it == functions.end()) {
+            return std::nullopt;
+        }
+        return impulse::ir::InlineCandidate{&it->second, parameters[name], 0};
+    };
+
+    // Reading a global by name and calling a builtin need a frame of their own; the recursive
+    // call inside the copy of fact stays a call
+    auto main = functions.at("main");
+    impulse::ir::index_symbols(main);
+    EXPECT_EQ(impulse::ir::inline_calls(main, lookup), 3);
+    std::vector<std::string> callees;
+    for (const auto& block : main.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.op == impulse::ir::SsaOpcode::Call) {
+                callees.push_back(inst.immediates.front());
+            }
+        }
+    }
+    std::sort(callees.begin(), callees.end());
+    EXPECT_EQ(callees, (std::vector<std::string>{"fact", "scaled", "shout"}));
+    EXPECT_NE(main.find_block("inline0.square.entry"), nullptr);
+
+    // With the bodies in place square(3) + clamp(12, 10) folds to 19, and fact's copy to 4 * fact(3)
+    EXPECT_TRUE(impulse::ir::optimize_ssa(main));
+    EXPECT_EQ(count_opcode(main, impulse::ir::SsaOpcode::Binary), 4);
+    EXPECT_EQ(impulse::ir::find_loops(main).loops.size(), 0);
+
+    auto fact = functions.at("fact");
+    impulse::ir::index_symbols(fact);
+    EXPECT_EQ(impulse::ir::inline_calls(fact, lookup), 0);
+
+    impulse::ir::InlineOptions tiny;
+    tiny.max_callee_instructions = 1;
+    auto limited = functions.at("main");
+    impulse::ir::index_symbols(limited);
+    EXPECT_EQ(impulse::ir::inline_calls(limited, lookup, tiny), 0);
+    tiny.hot_calls = 0;  // every callee counts as hot
+    EXPECT_EQ(impulse::ir::inline_calls(limited, lookup, tiny), 3);
+}
+
+TEST(IRTest, PurityAnalysisAndCallFolding) {
+    const std::string source = R"(module demo;
+
+let scale: int = 3;
+var counter: int = 0;
+
+func fib(n: int) -> int {
+    if n < 2 {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+func scaled(n: int) -> int {
+    return fib(n) * scale;
+}
+
+func counted(n: int) -> int {
+    return n + counter;
+}
+
+func loud(n: int) -> int {
+    println(n);
+    return n;
+}
+
+func calls_loud(n: int) -> int {
+    return loud(n) + 1;
+}
+
+func main() -> int {
+    return scaled(fib(6)) + counted(1) + loud(fib(3));
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    const auto pure = impulse::ir::find_pure_functions(lowered);
+    EXPECT_EQ(pure, (std::vector<bool>{true, true, false, false, false, false}));
+
+    const std::unordered_map<std::string, double> environment{{"scale", 3.0}, {"counter", 0.0}};
+    impulse::ir::CallEvaluator calls(lowered, pure, environment);
+    const auto fib30 = calls.call("fib", {30.0});
+    ASSERT_EQ(fib30.status, impulse::ir::EvalStatus::Success) << fib30.message;
+    EXPECT_DOUBLE_EQ(*fib30.value, 832040.0);
+    EXPECT_EQ(calls.call("loud", {1.0}).status, impulse::ir::EvalStatus::NonConstant);
+
+    // scaled(fib(6)) folds inside out; counted reads a var and loud prints, so both stay calls
+    auto& main = lowered.functions.back();
+    EXPECT_EQ(impulse::ir::fold_constant_calls(main, calls), 3U);
+    std::vector<std::string> callees;
+    for (const auto& block : main.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.kind == impulse::ir::InstructionKind::Call) {
+                callees.push_back(inst.operands.front());
+            }
+        }
+    }
+    EXPECT_EQ(callees, (std::vector<std::string>{"counted", "loud"}));
+    EXPECT_EQ(main.blocks.front().instructions.front().operands.front(), "63");
+
+    // A small budget leaves fib(30) to the Vm
+    impulse::ir::CallEvaluator tight(lowered, pure, environment, 100);
+    EXPECT_EQ(tight.call("fib", {30.0}).status, impulse::ir::EvalStatus::NonConstant);
+}
+
+TEST(IRTest, SelfTailCallsBecomeLoops) {
+    const std::string source = R"(module demo;
+
+func swap(a: int, b: int, n: int) -> int {
+    if n == 0 {
+        return a * 10 + b;
+    }
+    return swap(b, a, n - 1);
+}
+
+func fact(n: int) -> int {
+    if n < 2 {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    ASSERT_EQ(lowered.functions.size(), 2U);
+
+    auto swap = impulse::ir::build_ssa(lowered.functions[0]);
+    impulse::ir::index_symbols(swap);
+    EXPECT_EQ(impulse::ir::eliminate_self_tail_calls(swap, {"a", "b", "n"}), 1U);
+    EXPECT_EQ(count_opcode(swap, impulse::ir::SsaOpcode::Call), 0);
+    EXPECT_EQ(swap.blocks.front().name, "tail.entry");
+    EXPECT_TRUE(swap.blocks.front().predecessors.empty());
+
+    // One phi per parameter on the loop header; a and b are passed as each other, so both are
+    // copied before the back edge
+    const auto loops = impulse::ir::find_loops(swap);
+    ASSERT_EQ(loops.loops.size(), 1U);
+    EXPECT_EQ(loops.loops.front().header, 1U);
+    EXPECT_EQ(loops.loops.front().preheader, std::optional<std::size_t>(0));
+    EXPECT_EQ(swap.blocks[1].phi_nodes.size(), 3U);
+    EXPECT_EQ(count_opcode(swap, impulse::ir::SsaOpcode::Assign), 2);
+
+    // The multiply after fact's recursive call keeps it from being a tail call
+    auto fact = impulse::ir::build_ssa(lowered.functions[1]);
+    impulse::ir::index_symbols(fact);
+    EXPECT_EQ(impulse::ir::eliminate_self_tail_calls(fact, {"n"}), 0U);
+    EXPECT_EQ(count_opcode(fact, impulse::ir::SsaOpcode::Call), 1);
+}
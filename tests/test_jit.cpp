@@ -1,15 +1,27 @@
 #include <gtest/gtest.h>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../frontend/include/impulse/frontend/lowering.h"
 #include "../frontend/include/impulse/frontend/parser.h"
 #include "../frontend/include/impulse/frontend/semantic.h"
+#include "../ir/include/impulse/ir/optimizer.h"
+#include "../jit/include/impulse/jit/arm64.h"
+#include "../jit/include/impulse/jit/code_arena.h"
+#include "../jit/include/impulse/jit/jit.h"
+#include "../jit/include/impulse/jit/object_file.h"
+#include "../jit/include/impulse/jit/vectorize.h"
 #include "../runtime/include/impulse/runtime/runtime.h"
 
 using namespace impulse::runtime;
@@ -17,6 +29,24 @@ using namespace std::chrono;
 
 namespace {
 
+// These tests exercise compiled code, so skip the interpreter tier
+constexpr TierThresholds kCompileOnFirstCall{1, 1};
+
+// Keeps every call, for tests that watch how the callees themselves are compiled
+auto without_inlining() -> impulse::ir::OptimizationOptions {
+    impulse::ir::OptimizationOptions options;
+    options.inlining = false;
+    options.fold_calls = false;
+    return options;
+}
+
+// The AArch64 backend compiles numeric code only (see compile_arm64): calls, arrays, structs,
+// globals, % and on-stack replacement stay with the interpreter there. Tests of those features
+// still compare results on every target, but expect compiled code on x86-64 alone
+[[nodiscard]] auto compiles_beyond_numeric_code() -> bool {
+    return std::string(impulse::jit::JitCompiler::target()) == "x86-64";
+}
+
 // Helper to run a function and measure execution time
 struct ExecutionResult {
     VmResult result;
@@ -96,6 +126,7 @@ ExecutionResult run_with_timing(const std::string& source, const std::string& fu
     {
         Vm vm;
         vm.set_jit_enabled(true);
+        vm.set_tier_thresholds(kCompileOnFirstCall);
         
         auto load_result = vm.load(lowered);
         if (!load_result.success) {
@@ -145,9 +176,12 @@ ExecutionResult run_with_timing(const std::string& source, const std::string& fu
 
 // Helper to create a Vm and load a module (for cache inspection)
 // Returns a unique_ptr to Vm since Vm is not copyable
-std::pair<std::unique_ptr<Vm>, std::string> create_vm_with_module(const std::string& source) {
+std::pair<std::unique_ptr<Vm>, std::string> create_vm_with_module(const std::string& source,
+                                                                  std::size_t load_threads = 0) {
     auto vm = std::make_unique<Vm>();
     vm->set_jit_enabled(true);
+    vm->set_tier_thresholds(kCompileOnFirstCall);
+    vm->set_eager_loading(load_threads);
     
     impulse::frontend::Parser parser(source);
     auto parse_result = parser.parseModule();
@@ -240,6 +274,7 @@ func main() -> float {
     array_set(arr, 0, 10.0);
     array_set(arr, 1, 20.0);
     array_set(arr, 2, 30.0);
+    array_push(arr, 0.0);  // keeps the array from being replaced by its elements
     return array_get(arr, 0) + array_get(arr, 1) + array_get(arr, 2);
 }
 )";
@@ -398,6 +433,7 @@ func main() -> float {
     ASSERT_FALSE(module_name.empty()) << "Failed to create VM";
     ASSERT_NE(vm_ptr, nullptr) << "Failed to create VM";
     auto& vm = *vm_ptr;
+    vm.set_optimization_options(without_inlining());
     
     // Cache should be empty initially
     EXPECT_EQ(vm.get_jit_cache_size(), 0) << "Cache should be empty before first call";
@@ -715,3 +751,1755 @@ func main() -> float {
     std::cout << "========================================\n" << std::endl;
 }
 
+
+// Register allocation: more simultaneously live values than allocatable XMM registers
+TEST(JitCorrectnessTest, HighRegisterPressureLoop) {
+    const std::string source = R"(module test;
+
+func main() -> float {
+    let a: float = 1.0;
+    let b: float = 2.0;
+    let c: float = 3.0;
+    let d: float = 4.0;
+    let e: float = 5.0;
+    let f: float = 6.0;
+    let g: float = 7.0;
+    let h: float = 8.0;
+    let j: float = 9.0;
+    let k: float = 10.0;
+    let l: float = 11.0;
+    let m: float = 12.0;
+    let n: float = 13.0;
+    let o: float = 14.0;
+    let p: float = 15.0;
+    let q: float = 16.0;
+    let r: float = 17.0;
+    let s: float = 18.0;
+    let i: float = 0.0;
+    while i < 100.0 {
+        a = a + b * 0.5;
+        b = b + c - d;
+        c = c * 1.01 + e;
+        d = d - f / 7.0;
+        e = e + i % 3.0;
+        f = f + h - j;
+        g = g + k * 0.25;
+        h = h - l / 11.0;
+        j = j + m - n;
+        k = k + o * 0.125;
+        l = l - p / 13.0;
+        m = m + q - r;
+        n = n + s * 0.0625;
+        o = o - a / 17.0;
+        p = p + -b;
+        q = q + c * 0.001;
+        r = r - d / 19.0;
+        s = s + e * 0.002;
+        i = i + 1.0;
+    }
+    return a + b + c + d + e + f + g + h + j + k + l + m + n + o + p + q + r + s;
+}
+)";
+
+    auto result = run_with_timing(source);
+
+    EXPECT_EQ(result.result.status, VmStatus::Success) << "Execution failed: " << result.result.message;
+    EXPECT_TRUE(result.result.has_value);
+    EXPECT_TRUE(result.jit_used);
+}
+
+// Phi moves on a back edge form a cycle (a, b) -> (b, a) and must be emitted as a parallel copy
+TEST(JitCorrectnessTest, LoopPhiSwap) {
+    const std::string source = R"(module test;
+
+func main() -> float {
+    let a: float = 1.0;
+    let b: float = 2.0;
+    let c: float = 3.0;
+    let i: float = 0.0;
+    let acc: float = 0.0;
+    while i < 7.0 {
+        let t: float = a;
+        a = b;
+        b = c;
+        c = t;
+        acc = acc * 10.0 + a;
+        i = i + 1.0;
+    }
+    return acc + a * 0.1 + b * 0.01 + c * 0.001;
+}
+)";
+
+    auto result = run_with_timing(source);
+
+    EXPECT_EQ(result.result.status, VmStatus::Success) << "Execution failed: " << result.result.message;
+    EXPECT_TRUE(result.result.has_value);
+    EXPECT_NEAR(result.result.value, 2312312.0 + 0.2 + 0.03 + 0.001, 1e-6);
+    EXPECT_TRUE(result.jit_used);
+}
+
+// Calls between compiled functions, including recursion
+TEST(JitCallTest, RecursiveCallsAreCompiled) {
+    const std::string source = R"(module test;
+
+func fib(n: int) -> int {
+    if n < 2 {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+func main() -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < 15 {
+        total = total + fib(i);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    auto result = run_with_timing(source);
+    EXPECT_EQ(result.result.status, VmStatus::Success) << "Execution failed: " << result.result.message;
+    EXPECT_NEAR(result.result.value, 986.0, 1e-9);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(result.jit_used);
+    }
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    auto run_result = vm_ptr->run(module_name, "main");
+    EXPECT_NEAR(run_result.value, 986.0, 1e-9);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "main"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "fib"));
+    }
+}
+
+// A callee the JIT cannot compile is reached through the trampoline
+TEST(JitCallTest, TrampolineIntoInterpretedCallee) {
+    const std::string source = R"(module test;
+
+func sum_to(n: int) -> int {
+    let values: array = array(n);
+    let i: int = 0;
+    let total: int = 0;
+    while i < n {
+        array_set(values, i, i * 2);
+        total = total + array_get(values, i);
+        i = i + 1;
+    }
+    return total;
+}
+
+func main() -> int {
+    let a: int = 3;
+    let b: int = 4;
+    let c: int = a * b;
+    return sum_to(10) + a + b * c + sum_to(5);
+}
+)";
+
+    auto result = run_with_timing(source);
+    EXPECT_EQ(result.result.status, VmStatus::Success) << "Execution failed: " << result.result.message;
+    EXPECT_NEAR(result.result.value, 90.0 + 3.0 + 48.0 + 20.0, 1e-9);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(result.jit_used);
+    }
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    (void)vm_ptr->run(module_name, "main");
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "main"));
+    }
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "sum_to"));
+}
+
+// A runtime error in a trampolined callee unwinds through compiled frames
+TEST(JitCallTest, CalleeErrorPropagates) {
+    const std::string source = R"(module test;
+
+func bad(i: int) -> int {
+    let values: array = array(2);
+    return array_get(values, i);
+}
+
+func middle(i: int) -> int {
+    return bad(i) + 1;
+}
+
+func main() -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < 5 {
+        total = total + middle(i);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    auto jit_result = vm_ptr->run(module_name, "main");
+    EXPECT_EQ(jit_result.status, VmStatus::RuntimeError);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "middle"));
+    }
+
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "main");
+    EXPECT_EQ(interpreted.status, VmStatus::RuntimeError);
+    EXPECT_EQ(jit_result.message, interpreted.message);
+
+    // The unwind state is cleared, so the VM keeps working afterwards
+    vm_ptr->set_jit_enabled(true);
+    auto again = vm_ptr->run(module_name, "main");
+    EXPECT_EQ(again.status, VmStatus::RuntimeError);
+    EXPECT_EQ(again.message, interpreted.message);
+}
+
+// Array parameters are indexed inline by compiled code, including across compiled calls
+TEST(JitArrayTest, ArrayLoopsAreCompiled) {
+    const std::string source = R"(module test;
+
+func fill(values: array, seed: int) -> int {
+    let n: int = array_length(values);
+    let i: int = 0;
+    while i < n {
+        seed = (seed * 75 + 74) % 65537;
+        array_set(values, i, seed % 100);
+        i = i + 1;
+    }
+    return n;
+}
+
+func swap(values: array, i: int, j: int) -> int {
+    let temp: int = array_get(values, i);
+    array_set(values, i, array_get(values, j));
+    array_set(values, j, temp);
+    return 0;
+}
+
+func sort(values: array) -> int {
+    let n: int = array_length(values);
+    let i: int = 0;
+    while i < n {
+        let j: int = 0;
+        while j < n - i - 1 {
+            if array_get(values, j) > array_get(values, j + 1) {
+                swap(values, j, j + 1);
+            }
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return 0;
+}
+
+func checksum(values: array) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < array_length(values) {
+        if i > 0 {
+            if array_get(values, i - 1) > array_get(values, i) {
+                return -1;
+            }
+        }
+        total = total + array_get(values, i) * (i + 1);
+        i = i + 1;
+    }
+    return total;
+}
+
+func main() -> int {
+    let values: array = array(64);
+    fill(values, 7);
+    sort(values);
+    return checksum(values);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    auto jit_result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(jit_result.status, VmStatus::Success) << jit_result.message;
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "fill"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "swap"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "sort"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "checksum"));
+    }
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "main"));  // allocates
+    EXPECT_GT(jit_result.value, 0.0);
+
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(interpreted.status, VmStatus::Success) << interpreted.message;
+    EXPECT_DOUBLE_EQ(jit_result.value, interpreted.value);
+}
+
+// Failed inline checks report the interpreter's runtime errors
+TEST(JitArrayTest, BoundsChecksMatchInterpreter) {
+    const std::string source = R"(module test;
+
+func get(values: array, i: float) -> float {
+    return array_get(values, i);
+}
+
+func put(values: array, i: float) -> float {
+    return array_set(values, i, 1.0);
+}
+
+func read_past_end() -> float {
+    let values: array = array(4);
+    put(values, 3.0);
+    return get(values, 3.0) + get(values, 4.0);
+}
+
+func read_fraction() -> float {
+    let values: array = array(4);
+    put(values, 1.0);
+    return get(values, 1.0) + get(values, 1.5);
+}
+
+func write_negative() -> float {
+    let values: array = array(4);
+    return put(values, 0.0 - 1.0);
+}
+
+func write_empty() -> float {
+    let values: array = array(0);
+    return put(values, 0.0);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+
+    for (const std::string entry : {"read_past_end", "read_fraction", "write_negative", "write_empty"}) {
+        vm_ptr->set_jit_enabled(true);
+        auto jit_result = vm_ptr->run(module_name, entry);
+        vm_ptr->set_jit_enabled(false);
+        auto interpreted = vm_ptr->run(module_name, entry);
+
+        EXPECT_EQ(jit_result.status, VmStatus::RuntimeError) << entry;
+        EXPECT_EQ(interpreted.status, VmStatus::RuntimeError) << entry;
+        EXPECT_EQ(jit_result.message, interpreted.message) << entry;
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "get"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "put"));
+    }
+}
+
+// Numeric fields of struct parameters are loaded and stored in place; building a struct and
+// reading its boxed fields stay interpreted
+TEST(JitStructTest, NumericFieldsAreCompiled) {
+    const std::string source = R"(module test;
+
+struct Vec {
+    x: float;
+    y: float;
+}
+
+struct Body {
+    position: Vec;
+    vx: float;
+    vy: float;
+    mass: float;
+}
+
+func advance(b: Body, p: Vec, dt: float, steps: int) -> float {
+    let i: int = 0;
+    while i < steps {
+        b.vx = b.vx - p.x * dt / b.mass;
+        b.vy = b.vy - p.y * dt / b.mass;
+        p.x = p.x + b.vx * dt;
+        p.y = p.y + b.vy * dt;
+        i = i + 1;
+    }
+    return p.x * p.y;
+}
+
+func energy(b: Body, p: Vec) -> float {
+    return 0.5 * b.mass * (b.vx * b.vx + b.vy * b.vy) - b.mass / sqrt(p.x * p.x + p.y * p.y);
+}
+
+func main() -> float {
+    let b: Body = Body(Vec(1.0, 0.0), 0.0, 1.0, 2.0);
+    let p: Vec = b.position;
+    advance(b, p, 0.01, 500);
+    return energy(b, b.position) + b.position.x;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    auto jit_result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(jit_result.status, VmStatus::Success) << jit_result.message;
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "advance"));
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "energy"));
+    }
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "main"));  // allocates
+
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(interpreted.status, VmStatus::Success) << interpreted.message;
+    EXPECT_DOUBLE_EQ(jit_result.value, interpreted.value);
+}
+
+// A struct of another type than the field access names fails the shape check, as it does in the
+// interpreter. Only code that skipped semantic analysis can get there.
+TEST(JitStructTest, ShapeChecksMatchInterpreter) {
+    const std::string source = R"(module test;
+
+struct Vec {
+    x: float;
+    y: float;
+}
+
+struct Pair {
+    x: float;
+    y: float;
+}
+
+func get(v: Vec) -> float {
+    return v.y;
+}
+
+func put(v: Vec) -> float {
+    v.y = 2.0;
+    return 0.0;
+}
+
+func read_pair() -> float {
+    return get(Vec(1.0, 3.0)) + get(Pair(1.0, 3.0));
+}
+
+func write_pair() -> float {
+    return put(Vec(1.0, 3.0)) + put(Pair(1.0, 3.0));
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parsed = parser.parseModule();
+    ASSERT_TRUE(parsed.success);
+    Vm vm;
+    vm.set_tier_thresholds(kCompileOnFirstCall);
+    vm.set_optimization_options(without_inlining());  // get and put keep their own code
+    ASSERT_TRUE(vm.load(impulse::frontend::lower_to_ir(parsed.module)).success);
+
+    for (const std::string entry : {"read_pair", "write_pair"}) {
+        vm.set_jit_enabled(true);
+        auto jit_result = vm.run("test", entry);
+        vm.set_jit_enabled(false);
+        auto interpreted = vm.run("test", entry);
+
+        EXPECT_EQ(jit_result.status, VmStatus::RuntimeError) << entry;
+        EXPECT_EQ(interpreted.status, VmStatus::RuntimeError) << entry;
+        EXPECT_EQ(jit_result.message, interpreted.message) << entry;
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm.is_function_jit_compiled("test", "get"));
+        EXPECT_TRUE(vm.is_function_jit_compiled("test", "put"));
+    }
+}
+
+// Compiled array code handles both representations: unboxed numbers and boxed values
+TEST(JitArrayTest, BoxedAndFloat64ArraysAreCompiled) {
+    const std::string source = R"(module test;
+
+func total(values: array) -> float {
+    let sum: float = 0.0;
+    let i: int = 0;
+    while i < array_length(values) {
+        array_set(values, i, array_get(values, i) * 2.0);
+        sum = sum + array_get(values, i);
+        i = i + 1;
+    }
+    return sum;
+}
+
+func numbers() -> float {
+    let values: array = array(3);
+    array_set(values, 0, 1.0);
+    array_set(values, 1, 2.0);
+    array_set(values, 2, 3.0);
+    return total(values);
+}
+
+func boxed() -> float {
+    let values: array = array(3);
+    array_set(values, 0, "boxes the array");
+    array_set(values, 0, 1.0);
+    array_set(values, 1, 2.0);
+    array_set(values, 2, 3.0);
+    return total(values);
+}
+
+func unassigned() -> float {
+    let values: array = array(2);
+    array_set(values, 0, 1.0);
+    return total(values);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+
+    for (const std::string entry : {"numbers", "boxed"}) {
+        auto result = vm_ptr->run(module_name, entry);
+        ASSERT_EQ(result.status, VmStatus::Success) << entry << ": " << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 12.0) << entry;
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "total"));
+    }
+
+    // A never-assigned element reads as nil, which compiled code reports instead of reading
+    auto jit_result = vm_ptr->run(module_name, "unassigned");
+    EXPECT_EQ(jit_result.status, VmStatus::RuntimeError);
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "unassigned");
+    EXPECT_EQ(interpreted.status, VmStatus::RuntimeError);
+}
+
+// Accesses a counted loop keeps in range compile without index and bounds checks
+TEST(JitArrayTest, CountedLoopsMatchInterpreter) {
+    const std::string source = R"(module test;
+
+func strided(values: array) -> float {
+    let sum: float = 0.0;
+    let i: int = 1;
+    while array_length(values) > i {
+        array_set(values, i, array_get(values, i) + sum);
+        sum = sum + array_get(values, i);
+        i = i + 3;
+    }
+    return sum;
+}
+
+func run() -> float {
+    let values: array = array(10);
+    array_fill(values, 1.5);
+    return strided(values) + strided(array(0));
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+
+    vm_ptr->set_jit_enabled(true);
+    auto jit_result = vm_ptr->run(module_name, "run");
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "run");
+    ASSERT_EQ(jit_result.status, VmStatus::Success) << jit_result.message;
+    ASSERT_EQ(interpreted.status, VmStatus::Success) << interpreted.message;
+    EXPECT_DOUBLE_EQ(jit_result.value, interpreted.value);
+    EXPECT_DOUBLE_EQ(interpreted.value, 10.5);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "strided"));
+    }
+}
+
+// The array kernels are called natively from compiled code and agree with the interpreter
+TEST(JitArrayTest, ArrayKernelsAreCalledNatively) {
+    const std::string source = R"(module test;
+
+func stats(values: array, weights: array) -> float {
+    array_scale(weights, 2.0);
+    array_axpy(0.5, values, weights);
+    return array_dot(values, weights) + array_sum(values) + array_min(values) * 1000.0 + array_max(weights) * 100.0;
+}
+
+func run() -> float {
+    let values: array = array(40);
+    let weights: array = array(40);
+    array_fill(weights, 1.0);
+    let i: int = 0;
+    while i < 40 {
+        array_set(values, i, i + 1);
+        i = i + 1;
+    }
+    return stats(values, weights);
+}
+
+func mismatch() -> float {
+    let values: array = array(3);
+    let weights: array = array(4);
+    array_fill(values, 1.0);
+    array_fill(weights, 1.0);
+    return stats(values, weights);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+
+    // dot = sum v * (2 + v / 2) over 1..40, plus sum, min * 1000 and max * 100
+    for (const bool jit : {true, false}) {
+        vm_ptr->set_jit_enabled(jit);
+        auto result = vm_ptr->run(module_name, "run");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 12710.0 + 820.0 + 1000.0 + 2200.0);
+    }
+    vm_ptr->set_jit_enabled(true);
+    auto jit_result = vm_ptr->run(module_name, "mismatch");
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "stats"));
+    }
+    vm_ptr->set_jit_enabled(false);
+    auto interpreted = vm_ptr->run(module_name, "mismatch");
+    EXPECT_EQ(jit_result.status, VmStatus::RuntimeError);
+    EXPECT_EQ(interpreted.status, VmStatus::RuntimeError);
+    EXPECT_EQ(jit_result.message, "array_axpy requires arrays of equal length");
+    EXPECT_EQ(jit_result.message, interpreted.message);
+}
+
+TEST(JitArrayTest, SortAndSearchRunNatively) {
+    const std::string source = R"(module test;
+
+func rank(values: array, needle: float) -> float {
+    array_sort(values);
+    return array_binary_search(values, needle);
+}
+
+func run() -> float {
+    let values: array = array(50);
+    let i: int = 0;
+    while i < 50 {
+        array_set(values, i, (i * 17) % 50);
+        i = i + 1;
+    }
+    let order: array = array_sort_by_index(values);
+    return rank(values, 42.0) * 100.0 + array_get(order, 0) + array_get(values, 49);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    for (const bool jit : {true, false}) {
+        vm_ptr->set_jit_enabled(jit);
+        auto result = vm_ptr->run(module_name, "run");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 4200.0 + 0.0 + 49.0);
+    }
+    vm_ptr->set_jit_enabled(true);
+    (void)vm_ptr->run(module_name, "run");
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "rank"));
+    }
+}
+
+TEST(JitArrayTest, IntegerRemainderMatchesTheInterpreter) {
+    const std::string source = R"(module test;
+
+func sieve(flags: array, n: float) -> float {
+    let count: int = 0;
+    let i: int = 2;
+    while i < n {
+        if i % 7 != 3 {
+            array_set(flags, i % 13, array_get(flags, i % 13) + 1.0);
+            count = count + 1;
+        }
+        i = i + 1;
+    }
+    return count * 1000.0 + array_get(flags, 5) + n % 4.0;
+}
+
+func run(n: float) -> float {
+    let flags: array = array(13);
+    array_fill(flags, 0.0);
+    return sieve(flags, n);
+}
+
+func whole() -> float {
+    return run(500.0);
+}
+
+func fraction() -> float {
+    return run(6.5);
+}
+
+func negative() -> float {
+    return run(-3.0);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    for (const char* entry : {"whole", "whole", "fraction", "negative"}) {
+        std::vector<VmResult> results;
+        for (const bool jit : {true, false}) {
+            vm_ptr->set_jit_enabled(jit);
+            results.push_back(vm_ptr->run(module_name, entry));
+        }
+        ASSERT_EQ(results[0].status, results[1].status) << entry;
+        if (results[0].status == VmStatus::Success) {
+            EXPECT_DOUBLE_EQ(results[0].value, results[1].value) << entry;
+        } else {
+            EXPECT_EQ(results[0].message, results[1].message) << entry;
+        }
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "sieve"));
+    }
+    vm_ptr->set_jit_enabled(true);
+    const auto fractional = vm_ptr->run(module_name, "fraction");
+    EXPECT_EQ(fractional.status, VmStatus::RuntimeError);
+    EXPECT_EQ(fractional.message, "modulo requires non-negative integer operands and non-zero divisor");
+}
+
+TEST(JitBranchTest, FusedAndMaterializedComparisonsAgreeWithTheInterpreter) {
+    const std::string source = R"(module test;
+
+func score(x: float, y: float) -> float {
+    let total: float = 0.0;
+    if x < y { total = total + 1.0; }
+    if x <= y { total = total + 2.0; }
+    if x > y { total = total + 4.0; }
+    if x >= y { total = total + 8.0; }
+    if x == y { total = total + 16.0; }
+    if x != y { total = total + 32.0; }
+    let lt: float = x < y;
+    let eq: float = x == y;
+    let ne: float = x != y;
+    let ge: float = x >= y;
+    return total + lt * 64.0 + eq * 128.0 + ne * 256.0 + ge * 512.0 + (lt + eq + ne + ge) * 1024.0;
+}
+
+func count(n: float) -> float {
+    let i: int = 0;
+    let hits: int = 0;
+    while i < n {
+        if i % 3 == 0 { hits = hits + 1; }
+        i = i + 1;
+    }
+    return hits;
+}
+
+func run() -> float {
+    let nan: float = sqrt(-1.0);
+    return score(1.0, 2.0) + score(2.0, 1.0) * 10000.0 + score(3.0, 3.0) * 100000000.0 +
+           score(nan, 1.0) * 1000000000000.0 + score(1.0, nan) * 10000000000000000.0 + count(1000.0);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    std::vector<double> results;
+    for (const bool jit : {true, false}) {
+        vm_ptr->set_jit_enabled(jit);
+        auto result = vm_ptr->run(module_name, "run");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        results.push_back(result.value);
+    }
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "score"));
+    EXPECT_DOUBLE_EQ(results[0], results[1]);
+}
+
+TEST(JitMathTest, MathBuiltinsCompileToNativeCode) {
+    const std::string source = R"(module test;
+
+func mix(x: float, y: float) -> float {
+    let a: float = sqrt(x * x + y * y);
+    let b: float = abs(y) + floor(x) * 3.0 + ceil(y) * 5.0 + round(x * 0.5) * 7.0;
+    let c: float = sin(x) * cos(y) + tan(x / 7.0) + exp(y / 9.0) + log(a) + log10(a + 1.0);
+    return a + b * 11.0 + c * 13.0 + pow(a, 0.75);
+}
+
+func run() -> float {
+    let total: float = 0.0;
+    let i: int = 0;
+    while i < 40 {
+        total = total + mix(i * 0.37 - 5.0, 3.5 - i * 0.21);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    std::vector<double> results;
+    for (const bool jit : {true, false}) {
+        vm_ptr->set_jit_enabled(jit);
+        auto result = vm_ptr->run(module_name, "run");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        results.push_back(result.value);
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "mix"));
+    }
+    std::uint64_t jit_bits = 0;
+    std::uint64_t interpreted_bits = 0;
+    std::memcpy(&jit_bits, &results[0], sizeof(jit_bits));
+    std::memcpy(&interpreted_bits, &results[1], sizeof(interpreted_bits));
+    EXPECT_EQ(jit_bits, interpreted_bits);
+}
+
+namespace {
+
+// xmm0 = value; ret
+auto constant_function(double value) -> impulse::jit::CodeBuffer {
+    std::int64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    impulse::jit::CodeBuffer buffer;
+    buffer.emit_mov_reg_imm64(0, bits);
+    buffer.emit_movq_xmm_reg(0, 0);
+    buffer.emit_ret();
+    return buffer;
+}
+
+}  // namespace
+
+// Counted loops over element i of their arrays are planned for four iterations at a time
+TEST(JitVectorTest, PlansCountedUnitStrideLoops) {
+    const std::string source = R"(module test;
+
+func saxpy(a: array, b: array, s: float, n: int) -> int {
+    let i: int = 0;
+    while i < n {
+        array_set(a, i, array_get(a, i) * s + array_get(b, i));
+        i = i + 1;
+    }
+    return n;
+}
+
+func shift(a: array, n: int) -> int {
+    let i: int = 0;
+    while i < n {
+        array_set(a, i, array_get(a, i + 1));
+        i = i + 1;
+    }
+    return n;
+}
+
+func doubled(a: array, n: int) -> int {
+    let i: int = 0;
+    let steps: int = 0;
+    while i < n {
+        array_set(a, i, array_get(a, i) * 2.0);
+        steps = steps + 3;
+        i = i + 1;
+    }
+    return steps;
+}
+
+func total(a: array, n: int) -> float {
+    let sum: float = 0.0;
+    let i: int = 0;
+    while i < n {
+        sum = sum + array_get(a, i);
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parse_result.module);
+    std::unordered_map<std::string, std::vector<impulse::jit::VectorLoop>> plans;
+    for (const auto& function : lowered.functions) {
+        auto ssa = impulse::ir::build_ssa(function);
+        (void)impulse::ir::optimize_ssa(ssa, without_inlining());
+        const impulse::ir::ValueFacts facts(ssa);
+        plans[function.name] = impulse::jit::plan_vector_loops(ssa, facts);
+    }
+
+    ASSERT_EQ(plans["saxpy"].size(), 1U);
+    EXPECT_EQ(plans["saxpy"].front().arrays.size(), 2U);
+    EXPECT_TRUE(plans["saxpy"].front().reductions.empty());
+    ASSERT_EQ(plans["doubled"].size(), 1U);
+    EXPECT_EQ(plans["doubled"].front().reductions.size(), 1U);
+    // Reading element i + 1 carries a dependence between iterations, and a sum of doubles would
+    // round differently four lanes at a time
+    EXPECT_TRUE(plans["shift"].empty());
+    EXPECT_TRUE(plans["total"].empty());
+}
+
+// Vectorized loops give the interpreter's results, remainder iterations, aliasing arrays and
+// boxed arrays included, and leave holes to the scalar loop, which reports them
+TEST(JitVectorTest, VectorizedLoopsMatchTheInterpreter) {
+    const std::string source = R"(module test;
+
+func saxpy(a: array, b: array, s: float, start: int, n: int) -> int {
+    let i: int = start;
+    let steps: int = 0;
+    while i < n {
+        array_set(a, i, array_get(a, i) * s + array_get(b, i) / 3.0);
+        steps = steps + 2;
+        i = i + 1;
+    }
+    return steps;
+}
+
+func checksum(a: array) -> float {
+    let sum: float = 0.0;
+    let i: int = 0;
+    while i < array_length(a) {
+        sum = sum + array_get(a, i) * (i + 1);
+        i = i + 1;
+    }
+    return sum;
+}
+
+func run() -> float {
+    let n: int = 1003;
+    let a: array = array(n);
+    let b: array = array(n);
+    let i: int = 0;
+    while i < n {
+        array_set(a, i, i * 0.25);
+        array_set(b, i, 1.0 / (i + 1));
+        i = i + 1;
+    }
+    let steps: int = saxpy(a, b, 0.5, 0, n);
+    steps = steps + saxpy(a, a, 1.5, 0, n);
+    steps = steps + saxpy(a, b, 2.0, 7, n - 2);
+    let boxed: array = array(9);
+    array_set(boxed, 0, "boxes the array");
+    i = 0;
+    while i < 9 {
+        array_set(boxed, i, i);
+        i = i + 1;
+    }
+    steps = steps + saxpy(boxed, boxed, 2.0, 0, 9);
+    return checksum(a) + checksum(boxed) + steps;
+}
+
+func hole() -> float {
+    let a: array = array(20);
+    let i: int = 0;
+    while i < 20 {
+        if i != 13 { array_set(a, i, i); }
+        i = i + 1;
+    }
+    return saxpy(a, a, 2.0, 0, 20);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    std::vector<VmResult> results;
+    for (const bool jit : {true, false}) {
+        vm_ptr->set_jit_enabled(jit);
+        results.push_back(vm_ptr->run(module_name, "run"));
+        ASSERT_EQ(results.back().status, VmStatus::Success) << results.back().message;
+    }
+    EXPECT_EQ(results[0].value, results[1].value);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "saxpy"));
+    }
+
+    vm_ptr->set_jit_enabled(true);
+    const auto jit_hole = vm_ptr->run(module_name, "hole");
+    vm_ptr->set_jit_enabled(false);
+    const auto interpreted_hole = vm_ptr->run(module_name, "hole");
+    EXPECT_EQ(jit_hole.status, VmStatus::RuntimeError);
+    EXPECT_EQ(interpreted_hole.status, VmStatus::RuntimeError);
+}
+
+// Dividing by an array element stays in the scalar loop, which fails on a zero divisor as the
+// interpreter does
+TEST(JitVectorTest, DivisionByAZeroElementFailsLikeTheInterpreter) {
+    const std::string source = R"(module test;
+
+func divide(a: array, b: array, n: int) -> int {
+    let i: int = 0;
+    while i < n {
+        array_set(a, i, array_get(a, i) / array_get(b, i));
+        i = i + 1;
+    }
+    return n;
+}
+
+func fill(zero: int) -> float {
+    let n: int = 4096;
+    let a: array = array(n);
+    let b: array = array(n);
+    let i: int = 0;
+    while i < n {
+        array_set(a, i, i + 1.0);
+        array_set(b, i, 2.0);
+        i = i + 1;
+    }
+    if zero >= 0 { array_set(b, zero, 0.0); }
+    divide(a, b, n);
+    return array_get(a, n - 1) + array_get(a, 40);
+}
+
+func nonzero() -> float { return fill(-1); }
+
+func zero() -> float { return fill(40); }
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    for (const std::string entry : {"nonzero", "zero"}) {
+        std::vector<VmResult> results;
+        for (const bool jit : {true, false}) {
+            vm_ptr->set_jit_enabled(jit);
+            results.push_back(vm_ptr->run(module_name, entry));
+        }
+        EXPECT_EQ(results[0].status, results[1].status) << entry;
+        if (entry == "nonzero") {
+            ASSERT_EQ(results[0].status, VmStatus::Success) << results[0].message;
+            EXPECT_EQ(results[0].value, results[1].value);
+        } else {
+            EXPECT_EQ(results[0].status, VmStatus::RuntimeError);
+            EXPECT_EQ(results[0].message, results[1].message);
+            EXPECT_NE(results[0].message.find("division by zero"), std::string::npos) << results[0].message;
+        }
+    }
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "divide"));
+    }
+}
+
+TEST(JitSpeculationTest, RunsCompilablePathsAndDeoptimisesToTheInterpreter) {
+    const std::string source = R"(module test;
+
+func copy(dst: array, src: array, n: int) -> int {
+    let i: int = 0;
+    let copied: int = 0;
+    while i < n {
+        if n < 0 { print("negative length"); }
+        array_set(dst, i, array_get(src, i));
+        copied = copied + 1;
+        i = i + 1;
+    }
+    return copied;
+}
+
+func numbers() -> float {
+    let a: array = array(8);
+    let b: array = array(8);
+    let i: int = 0;
+    while i < 8 { array_set(a, i, i * 1.5); i = i + 1; }
+    let total: float = 0.0;
+    let round: int = 0;
+    while round < 3 {
+        total = total + copy(b, a, 8);
+        round = round + 1;
+    }
+    i = 0;
+    while i < 8 { total = total + array_get(b, i); i = i + 1; }
+    return total;
+}
+
+func mixed() -> float {
+    let a: array = array(6);
+    let b: array = array(6);
+    let i: int = 0;
+    while i < 6 { array_set(a, i, i); i = i + 1; }
+    array_set(a, 4, "four");
+    let copied: int = copy(b, a, 6);
+    print(array_get(b, 4));
+    return copied + array_get(b, 5);
+}
+
+func hole() -> float {
+    let a: array = array(6);
+    let b: array = array(6);
+    array_set(a, 0, 1);
+    return copy(b, a, 6) + array_length(b);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    for (const char* entry : {"numbers", "mixed", "hole"}) {
+        vm_ptr->set_jit_enabled(true);
+        const auto speculated = vm_ptr->run(module_name, entry);
+        vm_ptr->set_jit_enabled(false);
+        const auto interpreted = vm_ptr->run(module_name, entry);
+        ASSERT_EQ(interpreted.status, VmStatus::Success) << entry << ": " << interpreted.message;
+        EXPECT_EQ(speculated.status, VmStatus::Success) << entry << ": " << speculated.message;
+        EXPECT_EQ(speculated.value, interpreted.value) << entry;
+        EXPECT_EQ(speculated.message, interpreted.message) << entry;
+    }
+
+    // The print keeps copy from compiling whole; its loop ran natively from the start of each
+    // call, and the string and the hole each failed a guard once
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "copy"));
+    const auto counters = vm_ptr->function_tier_counters(module_name, "copy");
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_EQ(counters.speculative_entries, 5U);
+        EXPECT_EQ(counters.deopts, 2U);
+    }
+}
+
+TEST(JitSpeculationTest, FunctionsThatKeepDeoptimisingStayInterpreted) {
+    const std::string source = R"(module test;
+
+func first(a: array, b: array) -> float {
+    if array_length(a) == 0 { print("empty"); }
+    array_set(b, 0, array_get(a, 0));
+    return 1.0;
+}
+
+func main() -> float {
+    let a: array = array(1);
+    let b: array = array(1);
+    array_set(a, 0, "boxed");
+    let sum: float = 0.0;
+    let i: int = 0;
+    while i < 10 {
+        sum = sum + first(a, b);
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    TierThresholds thresholds = kCompileOnFirstCall;
+    thresholds.deopts = 3;
+    vm_ptr->set_tier_thresholds(thresholds);
+
+    const auto result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 10.0);
+    // Compiled code cannot carry the string it reads, so the element check fails: three times,
+    // after which first runs interpreted
+    const auto counters = vm_ptr->function_tier_counters(module_name, "first");
+    EXPECT_EQ(counters.calls, 10U);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_EQ(counters.deopts, 3U);
+        EXPECT_EQ(counters.speculative_entries, 3U);
+    }
+}
+
+TEST(JitCodeArenaTest, PacksFunctionsIntoSharedExecutablePages) {
+    if (!impulse::jit::JitCompiler::is_supported()) {
+        GTEST_SKIP() << "JIT not supported on this platform";
+    }
+    impulse::jit::JitCodeArena arena;
+    auto first_buffer = constant_function(1.5);
+    auto second_buffer = constant_function(-4.0);
+    const auto first = first_buffer.finalize(&arena);
+    const auto second = second_buffer.finalize(&arena);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+
+    EXPECT_EQ(arena.function_count(), 2U);
+    EXPECT_EQ(arena.region_count(), 1U);
+    const auto first_address = reinterpret_cast<std::uintptr_t>(first);
+    const auto second_address = reinterpret_cast<std::uintptr_t>(second);
+    EXPECT_EQ(second_address % impulse::jit::JitCodeArena::kFunctionAlignment, 0U);
+    EXPECT_EQ(second_address - first_address, impulse::jit::JitCodeArena::kFunctionAlignment);
+
+    double args[1] = {0.0};
+    EXPECT_DOUBLE_EQ(first(args), 1.5);
+    EXPECT_DOUBLE_EQ(second(args), -4.0);
+
+#ifdef __linux__
+    // W^X: the mapping holding the code is executable but not writable
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    bool found = false;
+    while (std::getline(maps, line)) {
+        std::uintptr_t begin = 0;
+        std::uintptr_t end = 0;
+        char perms[5] = {};
+        if (std::sscanf(line.c_str(), "%lx-%lx %4s", &begin, &end, perms) == 3 && first_address >= begin &&
+            first_address < end) {
+            found = true;
+            EXPECT_EQ(std::string(perms).substr(0, 3), "r-x") << line;
+        }
+    }
+    EXPECT_TRUE(found);
+#endif
+}
+
+// Reloading a module drops its compiled code together with its call table
+TEST(JitCodeArenaTest, ReloadedModulesRecompile) {
+    const std::string first = R"(module test;
+
+func value(x: float) -> float {
+    return x + 1.0;
+}
+)";
+    const std::string second = R"(module test;
+
+func value(x: float) -> float {
+    return x * 10.0;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(first);
+    ASSERT_FALSE(module_name.empty());
+    auto before = vm_ptr->run(module_name, "value");
+    ASSERT_EQ(before.status, VmStatus::Success) << before.message;
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "value"));
+
+    impulse::frontend::Parser parser(second);
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    ASSERT_TRUE(vm_ptr->load(impulse::frontend::lower_to_ir(parse_result.module)).success);
+
+    auto after = vm_ptr->run(module_name, "value");
+    ASSERT_EQ(after.status, VmStatus::Success) << after.message;
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "value"));
+    EXPECT_DOUBLE_EQ(before.value, 1.0);
+    EXPECT_DOUBLE_EQ(after.value, 0.0);
+}
+
+// A reload that only edits function bodies keeps the compiled code of the functions it leaves
+// alone; callers of an edited function are recompiled with it, since its SSA may be inlined
+TEST(JitCodeArenaTest, ReloadKeepsUnchangedFunctions) {
+    if (!compiles_beyond_numeric_code()) {
+        GTEST_SKIP() << "the AArch64 backend does not compile calls";
+    }
+    const auto source = [](const std::string& offset, const std::string& factor) {
+        return "module test;\n\nfunc offset(x: float) -> float {\n    return x + " + offset +
+               ";\n}\n\nfunc scaled(x: float) -> float {\n    return offset(x) * 2.0;\n}\n\n"
+               "func factor(x: float) -> float {\n    return x * " + factor + ";\n}\n";
+    };
+    const auto lower = [](const std::string& text) {
+        impulse::frontend::Parser parser(text);
+        auto parsed = parser.parseModule();
+        EXPECT_TRUE(parsed.success);
+        return impulse::frontend::lower_to_ir(parsed.module);
+    };
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source("1.0", "3.0"));
+    ASSERT_FALSE(module_name.empty());
+    for (const std::string entry : {"scaled", "factor"}) {
+        ASSERT_EQ(vm_ptr->run(module_name, entry).status, VmStatus::Success) << entry;
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, entry)) << entry;
+    }
+
+    // Only factor changes: offset and scaled keep their code
+    auto reloaded = vm_ptr->load(lower(source("1.0", "5.0")));
+    ASSERT_TRUE(reloaded.success);
+    EXPECT_EQ(reloaded.functions_kept, 2U);
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "scaled"));
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "factor"));
+    EXPECT_DOUBLE_EQ(vm_ptr->run(module_name, "factor").value, 0.0);
+    EXPECT_DOUBLE_EQ(vm_ptr->run(module_name, "scaled").value, 2.0);
+
+    // Changing offset invalidates its caller too
+    reloaded = vm_ptr->load(lower(source("4.0", "5.0")));
+    ASSERT_TRUE(reloaded.success);
+    EXPECT_EQ(reloaded.functions_kept, 1U);
+    EXPECT_FALSE(vm_ptr->is_function_jit_compiled(module_name, "scaled"));
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "factor"));
+    EXPECT_DOUBLE_EQ(vm_ptr->run(module_name, "scaled").value, 8.0);
+    EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "scaled"));
+}
+
+// const / let globals are folded into compiled code and var globals read from the module's table
+TEST(JitGlobalsTest, FunctionsReadingGlobalsCompile) {
+    const std::string source = R"(module test;
+
+const G: float = 4.0;
+let DT: float = G * 0.25;
+var scale: float = 3.0;
+
+func step(x: float) -> float {
+    let total: float = 0.0;
+    let i: int = 0;
+    while i < 4 {
+        total = total + x * G + DT * scale;
+        i = i + 1;
+    }
+    return total;
+}
+
+func main() -> float {
+    return step(2.0);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    const auto result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 44.0);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "step"));
+    }
+}
+
+// Rebinding the globals by reloading the module recompiles against the new values
+TEST(JitGlobalsTest, ReloadedGlobalsAreNotStale) {
+    const auto source = [](const std::string& g, const std::string& scale) {
+        return "module test;\n\nconst G: float = " + g + ";\nvar scale: float = " + scale +
+               ";\n\nfunc value(x: float) -> float {\n    return x * G + scale;\n}\n";
+    };
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source("2.0", "1.0"));
+    ASSERT_FALSE(module_name.empty());
+    auto before = vm_ptr->run(module_name, "value");
+    ASSERT_EQ(before.status, VmStatus::Success) << before.message;
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "value"));
+    }
+
+    impulse::frontend::Parser parser(source("5.0", "7.0"));
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    ASSERT_TRUE(vm_ptr->load(impulse::frontend::lower_to_ir(parse_result.module)).success);
+
+    auto after = vm_ptr->run(module_name, "value");
+    ASSERT_EQ(after.status, VmStatus::Success) << after.message;
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_TRUE(vm_ptr->is_function_jit_compiled(module_name, "value"));
+    }
+    EXPECT_DOUBLE_EQ(before.value, 1.0);
+    EXPECT_DOUBLE_EQ(after.value, 7.0);
+}
+
+// Functions start in the interpreter and are promoted once they cross the call threshold
+TEST(TieringTest, HotFunctionsArePromoted) {
+    const std::string source = R"(module test;
+
+func square(x: float) -> float {
+    return x * x;
+}
+
+func main() -> float {
+    let total: float = 0.0;
+    let i: float = 0.0;
+    while i < 4.0 {
+        total = total + square(i);
+        i = i + 1.0;
+    }
+    return total;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    vm_ptr->set_tier_thresholds(TierThresholds{3, 1000});
+    EXPECT_EQ(vm_ptr->tier_thresholds().calls, 3U);
+    EXPECT_EQ(vm_ptr->tier_thresholds().back_edges, 1000U);
+
+    auto result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 14.0);
+
+    const TierCounters square_counters = vm_ptr->function_tier_counters(module_name, "square");
+    EXPECT_EQ(square_counters.calls, 4U);
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "square"), ExecutionTier::Jit);
+
+    const TierCounters main_counters = vm_ptr->function_tier_counters(module_name, "main");
+    EXPECT_EQ(main_counters.calls, 1U);
+    EXPECT_EQ(main_counters.back_edges, 4U);
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "main"), ExecutionTier::Interpreter);
+    EXPECT_FALSE(vm_ptr->is_function_cached(module_name, "main"));
+}
+
+// Back-edges taken in the interpreter promote a loop-heavy function on its next call
+TEST(TieringTest, BackEdgesPromoteLoopingFunctions) {
+    const std::string source = R"(module test;
+
+func main() -> float {
+    let total: float = 0.0;
+    let i: float = 0.0;
+    while i < 50.0 {
+        total = total + i;
+        i = i + 1.0;
+    }
+    return total;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_tier_thresholds(TierThresholds{100, 40});
+
+    auto first = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(first.status, VmStatus::Success) << first.message;
+    EXPECT_NE(first.message, "__JIT_USED__");
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "main"), ExecutionTier::Interpreter);
+    EXPECT_GE(vm_ptr->function_tier_counters(module_name, "main").back_edges, 40U);
+
+    auto second = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(second.status, VmStatus::Success) << second.message;
+    EXPECT_EQ(second.message, "__JIT_USED__");
+    EXPECT_DOUBLE_EQ(second.value, first.value);
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "main"), ExecutionTier::Jit);
+}
+
+// Hot functions compiled on the background thread are picked up by later calls
+TEST(TieringTest, BackgroundCompilationPublishesCode) {
+    const std::string source = R"(module test;
+
+func square(x: float) -> float {
+    return x * x;
+}
+
+func main() -> float {
+    return square(3.0) + square(4.0);
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_optimization_options(without_inlining());
+    vm_ptr->set_tier_thresholds(TierThresholds{1, 1000});
+    vm_ptr->set_background_compilation(true);
+
+    auto first = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(first.status, VmStatus::Success) << first.message;
+    EXPECT_DOUBLE_EQ(first.value, 25.0);
+
+    vm_ptr->wait_for_background_compilation();
+    if (!compiles_beyond_numeric_code()) {
+        return;
+    }
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "square"), ExecutionTier::Jit);
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "main"), ExecutionTier::Jit);
+    auto second = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(second.status, VmStatus::Success) << second.message;
+    EXPECT_EQ(second.message, "__JIT_USED__");
+    EXPECT_DOUBLE_EQ(second.value, 25.0);
+}
+
+TEST(TieringTest, EagerLoadingCompilesEveryFunction) {
+    const std::string source = R"(module test;
+
+func is_even(n: int) -> int {
+    if n == 0 {
+        return 1;
+    }
+    return is_odd(n - 1);
+}
+
+func is_odd(n: int) -> int {
+    if n == 0 {
+        return 0;
+    }
+    return is_even(n - 1);
+}
+
+func double_it(x: int) -> int {
+    return x + x;
+}
+
+func main() -> int {
+    return is_even(double_it(21)) + is_odd(7) * 10 + double_it(50);
+}
+)";
+
+    auto [lazy_vm, lazy_name] = create_vm_with_module(source);
+    ASSERT_FALSE(lazy_name.empty());
+    const auto expected = lazy_vm->run(lazy_name, "main");
+    ASSERT_EQ(expected.status, VmStatus::Success) << expected.message;
+    EXPECT_DOUBLE_EQ(expected.value, 111.0);
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source, 4);
+    ASSERT_FALSE(module_name.empty());
+    for (const char* name : {"is_even", "is_odd", "double_it", "main"}) {
+        EXPECT_TRUE(vm_ptr->is_function_cached(module_name, name)) << name;
+        if (compiles_beyond_numeric_code()) {
+            EXPECT_EQ(vm_ptr->function_tier(module_name, name), ExecutionTier::Jit) << name;
+        }
+    }
+    const auto result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, expected.value);
+}
+
+TEST(JitObjectTest, PrecompiledObjectsBindAtLoad) {
+    if (!compiles_beyond_numeric_code()) {
+        GTEST_SKIP() << "precompiled objects are written for x86-64 only";
+    }
+    const auto source = [](const std::string& scale) {
+        return "module test;\n\nvar bias: float = 0.5;\n\nfunc norm(x: float, y: float) -> float {\n"
+               "    return sqrt(x * x + y * y) * " + scale + " + bias;\n}\n\n"
+               "func total(n: int) -> float {\n    let sum: float = 0.0;\n    let i: int = 0;\n"
+               "    while i < n {\n        sum = sum + norm(i, 1.0);\n        i = i + 1;\n    }\n"
+               "    return sum;\n}\n";
+    };
+    const auto lower = [](const std::string& text) {
+        impulse::frontend::Parser parser(text);
+        auto parsed = parser.parseModule();
+        EXPECT_TRUE(parsed.success);
+        return impulse::frontend::lower_to_ir(parsed.module);
+    };
+    const std::string path = (std::filesystem::temp_directory_path() / "impulse-aot-test.o").string();
+
+    double expected = 0.0;
+    {
+        Vm vm;
+        vm.set_optimization_options(without_inlining());
+        vm.set_eager_loading(1);
+        ASSERT_TRUE(vm.load(lower(source("2.0"))).success);
+        const auto written = vm.write_precompiled_code("test", path);
+        ASSERT_TRUE(written.has_value());
+        EXPECT_EQ(*written, 2U);
+        const auto result = vm.run("test", "total");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        expected = result.value;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto object = impulse::jit::read_object_file(contents);
+    ASSERT_TRUE(object.has_value());
+    ASSERT_EQ(object->functions.size(), 2U);
+    EXPECT_EQ(object->functions[0].name, "test::norm");
+    EXPECT_FALSE(object->functions[0].relocations.empty());  // the global and sqrt
+    const std::string copy = impulse::jit::write_object_file(*object);  // the views point into it
+    const auto rewritten = impulse::jit::read_object_file(copy);
+    ASSERT_TRUE(rewritten.has_value());
+    EXPECT_EQ(rewritten->key, object->key);
+    EXPECT_EQ(rewritten->functions[1].code, object->functions[1].code);
+    EXPECT_EQ(rewritten->functions[1].relocations.size(), object->functions[1].relocations.size());
+    EXPECT_FALSE(impulse::jit::read_object_file(contents.substr(0, contents.size() / 2)).has_value());
+
+    {
+        // Native from the first call, with nothing compiled
+        Vm vm;
+        vm.set_optimization_options(without_inlining());
+        vm.set_precompiled_code(path);
+        const auto loaded = vm.load(lower(source("2.0")));
+        ASSERT_TRUE(loaded.success);
+        EXPECT_EQ(loaded.functions_precompiled, 2U);
+        EXPECT_EQ(vm.function_tier("test", "norm"), ExecutionTier::Jit);
+        const auto result = vm.run("test", "total");
+        ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, expected);
+        EXPECT_EQ(vm.metrics().jit_compilations, 0U);
+        EXPECT_EQ(vm.function_tier_counters("test", "total").calls, 1U);
+    }
+
+    {
+        // Compiled for other code: ignored
+        Vm vm;
+        vm.set_optimization_options(without_inlining());
+        vm.set_precompiled_code(path);
+        const auto loaded = vm.load(lower(source("3.0")));
+        ASSERT_TRUE(loaded.success);
+        EXPECT_EQ(loaded.functions_precompiled, 0U);
+        EXPECT_EQ(vm.function_tier("test", "norm"), ExecutionTier::Interpreter);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TieringTest, HotLoopsAreReplacedOnStack) {
+    // main is entered once and cannot be compiled as a whole (array allocation, printing),
+    // but its loops can be entered natively once they are hot
+    const std::string source = R"(module test;
+
+func main() -> int {
+    let sieve: array = array(2000);
+    let i: int = 0;
+    while i < 2000 {
+        array_set(sieve, i, 1);
+        i = i + 1;
+    }
+    let count: int = 0;
+    i = 2;
+    while i < 2000 {
+        if array_get(sieve, i) == 1 {
+            count = count + 1;
+            let j: int = i * i;
+            while j < 2000 {
+                array_set(sieve, j, 0);
+                j = j + i;
+            }
+        }
+        i = i + 1;
+    }
+    println(count);
+    while i > 0 {
+        if i == 1234 {
+            return count + i;
+        }
+        i = i - 1;
+    }
+    return -1;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_tier_thresholds(TierThresholds{100, 100});
+
+    auto result = vm_ptr->run(module_name, "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 303.0 + 1234.0);
+    EXPECT_EQ(vm_ptr->function_tier(module_name, "main"), ExecutionTier::Interpreter);
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_GE(vm_ptr->function_tier_counters(module_name, "main").osr_entries, 3U);
+    }
+
+    auto [interpreted, interpreted_module] = create_vm_with_module(source);
+    interpreted->set_jit_enabled(false);
+    auto expected = interpreted->run(interpreted_module, "main");
+    ASSERT_EQ(expected.status, VmStatus::Success) << expected.message;
+    EXPECT_DOUBLE_EQ(result.value, expected.value);
+}
+
+TEST(TieringTest, OnStackReplacementReportsRuntimeErrors) {
+    const std::string source = R"(module test;
+
+func main() -> int {
+    let values: array = array(10);
+    let i: int = 0;
+    while i < 1000 {
+        array_set(values, i % 11, i);
+        i = i + 1;
+    }
+    return 0;
+}
+)";
+
+    auto [vm_ptr, module_name] = create_vm_with_module(source);
+    ASSERT_FALSE(module_name.empty());
+    vm_ptr->set_tier_thresholds(TierThresholds{100, 5});
+
+    auto result = vm_ptr->run(module_name, "main");
+    EXPECT_EQ(result.status, VmStatus::RuntimeError);
+    EXPECT_EQ(result.message, "array_set index out of bounds");
+    if (compiles_beyond_numeric_code()) {
+        EXPECT_EQ(vm_ptr->function_tier_counters(module_name, "main").osr_entries, 1U);
+    }
+}
+
+// The AArch64 encoder is plain byte output, so its encodings are checked on any host against
+// what an assembler produces
+TEST(JitArm64Test, EncodesInstructions) {
+    using impulse::jit::Arm64Assembler;
+    using impulse::jit::Arm64Condition;
+    Arm64Assembler assembler;
+    assembler.prologue(4096 + 32);
+    assembler.ldr_d(3, 0, 16);
+    assembler.str_d(3, Arm64Assembler::kSp, 8);
+    assembler.str_x(Arm64Assembler::kZr, Arm64Assembler::kSp, 24);
+    assembler.fadd(0, 1, 2);
+    assembler.fsub(0, 1, 2);
+    assembler.fmul(0, 1, 2);
+    assembler.fdiv(0, 1, 2);
+    assembler.fneg(4, 5);
+    assembler.fmov(4, 5);
+    assembler.fmov_dx(1, 9);
+    assembler.fcmp(0, 1);
+    assembler.fcmp_zero(0);
+    assembler.mov_imm64(9, 0x4045000012340000ULL);
+    assembler.cset(9, Arm64Condition::Mi);
+    assembler.ucvtf(0, 9);
+    assembler.and_w(9, 9, 10);
+    assembler.orr_w(9, 9, 10);
+    assembler.epilogue();
+
+    const std::vector<std::uint32_t> expected = {
+        0xA9BF7BFD,  // stp x29, x30, [sp, #-16]!
+        0x910003FD,  // mov x29, sp
+        0xD14007FF,  // sub sp, sp, #1, lsl #12
+        0xD10083FF,  // sub sp, sp, #32
+        0xFD400803,  // ldr d3, [x0, #16]
+        0xFD0007E3,  // str d3, [sp, #8]
+        0xF9000FFF,  // str xzr, [sp, #24]
+        0x1E622820,  // fadd d0, d1, d2
+        0x1E623820,  // fsub d0, d1, d2
+        0x1E620820,  // fmul d0, d1, d2
+        0x1E621820,  // fdiv d0, d1, d2
+        0x1E6140A4,  // fneg d4, d5
+        0x1E6040A4,  // fmov d4, d5
+        0x9E670121,  // fmov d1, x9
+        0x1E612000,  // fcmp d0, d1
+        0x1E602008,  // fcmp d0, #0.0
+        0xD2A24689,  // movz x9, #0x1234, lsl #16
+        0xF2E808A9,  // movk x9, #0x4045, lsl #48
+        0x1A9F57E9,  // cset w9, mi
+        0x1E630120,  // ucvtf d0, w9
+        0x0A0A0129,  // and w9, w9, w10
+        0x2A0A0129,  // orr w9, w9, w10
+        0x910003BF,  // mov sp, x29
+        0xA8C17BFD,  // ldp x29, x30, [sp], #16
+        0xD65F03C0,  // ret
+    };
+    EXPECT_EQ(assembler.words(), expected);
+}
+
+TEST(JitArm64Test, PatchesBranches) {
+    using impulse::jit::Arm64Assembler;
+    using impulse::jit::Arm64Condition;
+    Arm64Assembler assembler;
+    const std::size_t top = assembler.new_label();
+    const std::size_t done = assembler.new_label();
+    assembler.bind(top);
+    assembler.fcmp_zero(0);
+    assembler.b_cond(Arm64Condition::Ne, done);
+    assembler.b(top);
+    assembler.bind(done);
+    assembler.epilogue();
+
+    const auto bytes = assembler.finish();
+    ASSERT_TRUE(bytes.has_value());
+    ASSERT_EQ(bytes->size(), 6U * 4U);
+    const auto word = [&](std::size_t index) {
+        std::uint32_t value = 0;
+        std::memcpy(&value, bytes->data() + index * 4, sizeof(value));
+        return value;
+    };
+    EXPECT_EQ(word(1), 0x54000041U);  // b.ne .+8
+    EXPECT_EQ(word(2), 0x17FFFFFEU);  // b .-8
+
+    Arm64Assembler unbound;
+    unbound.b(unbound.new_label());
+    EXPECT_FALSE(unbound.finish().has_value());
+}
+
+// Numeric code compiles for AArch64; arrays and calls are left to the interpreter
+TEST(JitArm64Test, CompilesNumericFunctionsOnly) {
+    const std::string source = R"(module test;
+
+func sum_to(n: int) -> float {
+    let total: float = 0.0;
+    let i: int = 0;
+    while i < n && total >= 0.0 {
+        total = total + i * 0.5 - -1.0 / 4.0;
+        i = i + 1;
+    }
+    return total;
+}
+
+func first(a: array) -> float {
+    return array_get(a, 0);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parse_result.module);
+    std::unordered_map<std::string, bool> compiled;
+    for (const auto& function : lowered.functions) {
+        auto ssa = impulse::ir::build_ssa(function);
+        (void)impulse::ir::optimize_ssa(ssa, without_inlining());
+        std::vector<std::pair<impulse::ir::SsaValue, int>> parameters;
+        for (const auto& symbol : ssa.symbols) {
+            for (std::size_t i = 0; i < function.parameters.size(); ++i) {
+                if (symbol.name == function.parameters[i].name) {
+                    parameters.emplace_back(impulse::ir::SsaValue{symbol.id, 1}, static_cast<int>(i));
+                }
+            }
+        }
+        const auto code = impulse::jit::compile_arm64(ssa, parameters);
+        compiled[function.name] = code.has_value() && !code->empty() && code->size() % 4 == 0;
+    }
+    EXPECT_TRUE(compiled["sum_to"]);
+    EXPECT_FALSE(compiled["first"]);
+}
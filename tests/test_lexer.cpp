@@ -90,3 +90,30 @@ panic(message);
     ASSERT_NE(stringIt, tokens.end());
     EXPECT_EQ(stringIt->lexeme, "panic\n");
 }
+
+TEST(LexerTest, PullModeMatchesTokenize) {
+    const std::string source = R"(module demo;
+func main() -> int { return 1.5e3 + "a\"b"; } $
+)";
+
+    Lexer whole(source);
+    const auto tokens = whole.tokenize();
+
+    Lexer pulled(source);
+    for (const auto& expected : tokens) {
+        const Token token = pulled.next();
+        EXPECT_EQ(token.kind, expected.kind);
+        EXPECT_EQ(token.lexeme, expected.lexeme);
+        EXPECT_EQ(token.line, expected.line);
+        EXPECT_EQ(token.column, expected.column);
+    }
+    EXPECT_EQ(pulled.next().kind, TokenKind::EndOfFile);
+
+    const auto string = std::find_if(tokens.begin(), tokens.end(), [](const Token& token) {
+        return token.kind == TokenKind::StringLiteral;
+    });
+    ASSERT_NE(string, tokens.end());
+    EXPECT_EQ(string->lexeme, "a\"b");
+    EXPECT_EQ(tokens[tokens.size() - 2].kind, TokenKind::Error);
+    EXPECT_EQ(tokens[tokens.size() - 2].lexeme, "$");
+}
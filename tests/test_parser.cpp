@@ -41,6 +41,27 @@ let missing: int = 0)";
     EXPECT_FALSE(result.diagnostics.empty());
 }
 
+// The parser pulls tokens as it goes; lexer errors past where it gave up are still reported,
+// ahead of the parser's own
+TEST(ParserTest, LexerErrorsAfterAParseErrorAreReported) {
+    const std::string source = R"(module test;
+
+func broken( -> int {
+}
+
+func later() -> int {
+    return "unterminated;
+}
+)";
+
+    Parser parser(source);
+    ParseResult result = parser.parseModule();
+    EXPECT_FALSE(result.success);
+    ASSERT_GE(result.diagnostics.size(), 2U);
+    EXPECT_EQ(result.diagnostics.front().message, "Unterminated string literal");
+    EXPECT_EQ(result.diagnostics.front().location.line, 7U);
+}
+
 TEST(ParserTest, AssignmentStatement) {
     const std::string source = R"(module test;
 
@@ -65,3 +86,84 @@ func main() -> int {
     EXPECT_EQ(assignStmt.kind, impulse::frontend::Statement::Kind::Assign);
     EXPECT_EQ(assignStmt.assign_target.value, "x");
 }
+
+TEST(ParserTest, FieldAccessAndAssignment) {
+    const std::string source = R"(module test;
+
+func main(b: Body) -> float {
+    b.position.x = b.mass * 2.0;
+    return b.position.x;
+}
+)";
+
+    Parser parser(source);
+    ParseResult result = parser.parseModule();
+    ASSERT_TRUE(result.success) << "Parse should succeed";
+    const auto& statements = result.module.declarations[0].function.parsed_body.statements;
+    ASSERT_EQ(statements.size(), 2);
+
+    // b.position.x = ...: the object is b.position, the field x
+    const auto& assign = statements[0];
+    EXPECT_EQ(assign.kind, impulse::frontend::Statement::Kind::FieldAssign);
+    EXPECT_EQ(assign.assign_target.value, "x");
+    ASSERT_NE(assign.assign_object, nullptr);
+    EXPECT_EQ(assign.assign_object->kind, impulse::frontend::Expression::Kind::Field);
+    EXPECT_EQ(assign.assign_object->identifier.value, "position");
+    ASSERT_NE(assign.assign_object->operand, nullptr);
+    EXPECT_EQ(assign.assign_object->operand->identifier.value, "b");
+
+    // Field access binds tighter than arithmetic and chains to the left
+    const auto& read = *statements[1].return_expression;
+    EXPECT_EQ(read.kind, impulse::frontend::Expression::Kind::Field);
+    EXPECT_EQ(read.identifier.value, "x");
+    EXPECT_EQ(read.operand->kind, impulse::frontend::Expression::Kind::Field);
+    EXPECT_EQ(assign.assign_value->kind, impulse::frontend::Expression::Kind::Binary);
+}
+
+TEST(ParserTest, NodesLiveInTheModuleArena) {
+    const std::string source = R"(module test;
+
+func main() -> int {
+    let x: int = 1 + 2 * 3;
+    if x > 4 {
+        return x;
+    }
+    return 0;
+}
+)";
+
+    impulse::frontend::Module module;
+    {
+        Parser parser(source);
+        ParseResult result = parser.parseModule();
+        ASSERT_TRUE(result.success);
+        ASSERT_NE(result.module.arena, nullptr);
+        EXPECT_GT(result.module.arena->bytes_used(), 0U);
+        EXPECT_GE(result.module.arena->bytes_reserved(), result.module.arena->bytes_used());
+        module = std::move(result.module);
+    }
+
+    // The tree outlives the parser and the result it was moved out of
+    ASSERT_EQ(module.declarations.size(), 1U);
+    const auto& body = module.declarations[0].function.parsed_body.statements;
+    ASSERT_EQ(body.size(), 3U);
+    ASSERT_NE(body[0].binding.initializer_expr, nullptr);
+    EXPECT_EQ(body[0].binding.initializer_expr->kind, impulse::frontend::Expression::Kind::Binary);
+    ASSERT_NE(body[1].condition, nullptr);
+    ASSERT_EQ(body[1].then_body.size(), 1U);
+    EXPECT_EQ(body[1].then_body[0].kind, impulse::frontend::Statement::Kind::Return);
+
+    // Assigning over a parsed module drops its declarations before the arena they point into
+    Parser other(R"(module other;
+
+func one() -> int {
+    return 1;
+}
+)");
+    module = other.parseModule().module;
+    ASSERT_EQ(module.declarations.size(), 1U);
+    EXPECT_EQ(module.declarations[0].function.name.value, "one");
+    module = {};
+    EXPECT_EQ(module.arena, nullptr);
+    EXPECT_TRUE(module.declarations.empty());
+}
@@ -19,7 +19,7 @@ func compute(x: float) -> float {
 }
 
 func accumulate(n: float) -> float {
-    // This function uses loops, so won't be JIT compiled
+    // Loop with a call - runs once, so tiering keeps it in the interpreter
     let sum: float = 0.0;
     let i: float = 0.0;
     while i < n {
@@ -75,11 +75,12 @@ func main() -> float {
     EXPECT_FALSE(profiling_output.empty());
     EXPECT_NE(profiling_output.find("Function Profiling Results"), std::string::npos);
     
-    // The compute function should be JIT compiled
+    // The compute function is hot, so it gets promoted to the JIT
     EXPECT_TRUE(vm.is_function_jit_compiled(module_name, "compute"));
     
-    // The accumulate function should not be JIT compiled (has loops)
-    EXPECT_FALSE(vm.is_function_jit_compiled(module_name, "accumulate"));
+    // accumulate is entered once: it stays in the interpreter, but its loop is counted
+    EXPECT_EQ(vm.function_tier(module_name, "accumulate"), ExecutionTier::Interpreter);
+    EXPECT_GE(vm.function_tier_counters(module_name, "accumulate").back_edges, 1000U);
 }
 
 // Example: Comparing JIT vs interpreter performance with profiling
@@ -156,3 +157,150 @@ func main() -> float {
     }
 }
 
+
+// Block profiling counts every block entry, so a loop's body shows up once per iteration
+TEST(ProfilingTest, BlockProfileCountsLoopIterations) {
+    const std::string source = R"(module test;
+
+func square(x: float) -> float {
+    return x * x;
+}
+
+func main() -> float {
+    let total: float = 0.0;
+    let i: float = 0.0;
+    while i < 100.0 {
+        total = total + square(i);
+        i = i + 1.0;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parse_result.module);
+
+    Vm vm;
+    vm.set_jit_enabled(true);
+    impulse::ir::OptimizationOptions options;
+    options.inlining = false;  // square keeps its own blocks
+    vm.set_optimization_options(options);
+    vm.set_block_profiling_enabled(true);
+    ASSERT_TRUE(vm.load(lowered).success);
+
+    auto result = vm.run("test", "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 328350.0);
+
+    const auto profile = vm.get_block_profile();
+    ASSERT_FALSE(profile.empty());
+    std::uint64_t square_entries = 0;
+    std::uint64_t loop_bodies = 0;
+    for (const auto& block : profile) {
+        EXPECT_EQ(block.instructions, block.entries * block.code.size());
+        if (block.function == "test::square") {
+            square_entries += block.entries;
+        } else if (block.function == "test::main" && block.entries == 100) {
+            ++loop_bodies;
+        }
+    }
+    // Counting keeps square in the interpreter, so all of its calls are seen
+    EXPECT_EQ(square_entries, 100U);
+    EXPECT_EQ(loop_bodies, 1U);
+    EXPECT_FALSE(vm.is_function_jit_compiled("test", "square"));
+    for (std::size_t i = 1; i < profile.size(); ++i) {
+        EXPECT_GE(profile[i - 1].instructions, profile[i].instructions);
+    }
+
+    vm.reset_profiling();
+    EXPECT_TRUE(vm.get_block_profile().empty());
+}
+
+// The profile as data: statistics plus a timeline that the exporters turn into files
+TEST(ProfilingTest, ProfileReportExportsTimeline) {
+    const std::string source = R"(module test;
+
+func square(x: float) -> float {
+    return x * x;
+}
+
+func main() -> float {
+    let total: float = 0.0;
+    let i: float = 0.0;
+    while i < 100.0 {
+        total = total + square(i);
+        i = i + 1.0;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    auto parse_result = parser.parseModule();
+    ASSERT_TRUE(parse_result.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parse_result.module);
+
+    Vm vm;
+    impulse::ir::OptimizationOptions options;
+    options.inlining = false;
+    vm.set_optimization_options(options);
+    vm.set_profiling_enabled(true);
+    ASSERT_TRUE(vm.load(lowered).success);
+    auto result = vm.run("test", "main");
+    ASSERT_EQ(result.status, VmStatus::Success) << result.message;
+    vm.collect_garbage();
+
+    const ProfileReport report = vm.get_profile_report();
+    ASSERT_EQ(report.functions.size(), 2U);
+    EXPECT_EQ(report.functions[0].function, "test::main");  // includes square's time
+    const FunctionProfileSummary& square = report.functions[1];
+    EXPECT_EQ(square.function, "test::square");
+    EXPECT_EQ(square.calls, 100U);
+    EXPECT_EQ(square.tier, "jit");
+    EXPECT_GT(square.compile_time.count(), 0);
+
+    std::size_t calls = 0;
+    std::size_t pauses = 0;
+    std::size_t compiles = 0;
+    std::chrono::nanoseconds square_time{0};
+    for (const auto& event : report.events) {
+        EXPECT_EQ(event.thread, 0U);
+        EXPECT_GE(event.start.count(), 0);
+        calls += event.kind == ProfileEvent::Kind::Call ? 1 : 0;
+        pauses += event.kind == ProfileEvent::Kind::Gc ? 1 : 0;
+        compiles += event.kind == ProfileEvent::Kind::Compile && event.name == "test::square" ? 1 : 0;
+        if (event.kind == ProfileEvent::Kind::Call && event.name == "test::square") {
+            square_time += event.duration;
+        }
+    }
+    EXPECT_EQ(calls, 101U);
+    EXPECT_EQ(pauses, 1U);
+    EXPECT_EQ(compiles, 1U);
+    EXPECT_EQ(square_time, square.total);
+    EXPECT_EQ(report.dropped_events, 0U);
+
+    std::ostringstream json;
+    write_profile(report, *parse_profile_format("json"), json);
+    EXPECT_NE(json.str().find("{\"name\": \"test::square\", \"calls\": 100,"), std::string::npos) << json.str();
+    EXPECT_NE(json.str().find("\"gc\": {\"pauses\": 1,"), std::string::npos);
+
+    std::ostringstream trace;
+    write_profile(report, *parse_profile_format("chrome"), trace);
+    EXPECT_EQ(trace.str().rfind("{\"displayTimeUnit\": \"ns\"", 0), 0U);
+    EXPECT_NE(trace.str().find("\"name\": \"gc full\", \"cat\": \"gc\", \"ph\": \"X\""), std::string::npos);
+
+    std::ostringstream pprof;
+    write_profile(report, *parse_profile_format("pprof"), pprof);
+    const std::string bytes = pprof.str();
+    ASSERT_FALSE(bytes.empty());
+    EXPECT_EQ(bytes[0], '\x0A');  // sample_type, length-delimited
+    EXPECT_NE(bytes.find("test::square"), std::string::npos);
+    EXPECT_NE(bytes.find("[compile test::square]"), std::string::npos);
+    EXPECT_NE(bytes.find("[gc full]"), std::string::npos);
+    EXPECT_FALSE(parse_profile_format("text").has_value());
+
+    vm.reset_profiling();
+    EXPECT_TRUE(vm.get_profile_report().events.empty());
+}
@@ -1,21 +1,93 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <numeric>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "../frontend/include/impulse/frontend/lowering.h"
 #include "../frontend/include/impulse/frontend/parser.h"
 #include "../frontend/include/impulse/frontend/semantic.h"
+#include "../ir/include/impulse/ir/cfg.h"
+#include "../ir/include/impulse/ir/optimizer.h"
+#include "../ir/include/impulse/ir/ssa.h"
+#include "../runtime/include/impulse/runtime/array_kernels.h"
+#include "../runtime/include/impulse/runtime/bytecode.h"
+#include "../runtime/include/impulse/runtime/frame_layout.h"
 #include "../runtime/include/impulse/runtime/gc_heap.h"
 #include "../runtime/include/impulse/runtime/runtime.h"
+#include "../runtime/include/impulse/runtime/serve.h"
+#include "../runtime/include/impulse/runtime/ssa_interpreter.h"
+#include "../runtime/include/impulse/runtime/trace_writer.h"
 #include "../runtime/include/impulse/runtime/value.h"
 
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
 using impulse::runtime::GcHeap;
 using impulse::runtime::GcObject;
+using impulse::runtime::GcStats;
 using impulse::runtime::Value;
 
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+
+auto counted_allocation(std::size_t size) noexcept -> void* {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size != 0 ? size : 1);
+}
+
+// Out of line: once an inlined delete exposes its free, GCC pairs it with the new expression at
+// the call site and reports a mismatch (-Wmismatched-new-delete)
+[[gnu::noinline]] void release(void* memory) noexcept { std::free(memory); }
+
+}  // namespace
+
+// Counts every allocation of the test binary, for the allocation-free call path test. Every
+// unaligned form is replaced, so each new is paired with a delete of this file
+auto operator new(std::size_t size) -> void* {
+    if (void* memory = counted_allocation(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new[](std::size_t size) -> void* { return operator new(size); }
+
+auto operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept -> void* {
+    return counted_allocation(size);
+}
+
+auto operator new[](std::size_t size, const std::nothrow_t& /*tag*/) noexcept -> void* {
+    return counted_allocation(size);
+}
+
+void operator delete(void* memory) noexcept { release(memory); }
+
+void operator delete[](void* memory) noexcept { release(memory); }
+
+void operator delete(void* memory, const std::nothrow_t& /*tag*/) noexcept { release(memory); }
+
+void operator delete[](void* memory, const std::nothrow_t& /*tag*/) noexcept { release(memory); }
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept { release(memory); }
+
+void operator delete[](void* memory, std::size_t /*size*/) noexcept { release(memory); }
+
 TEST(RuntimeTest, CollectsUnreachableObjects) {
     GcHeap heap;
 
@@ -130,6 +202,181 @@ func main() -> float {
     EXPECT_NE(result.message.find("array_get index out of bounds"), std::string::npos);
 }
 
+TEST(RuntimeTest, StructFieldsExecution) {
+    const std::string source = R"(module demo;
+
+struct Vec {
+    x: float;
+    y: float;
+}
+
+struct Body {
+    position: Vec;
+    name: string;
+    mass: float;
+}
+
+func push(b: Body, dx: float) -> float {
+    b.position.x = b.position.x + dx;
+    b.mass = b.mass * 2.0;
+    return b.position.x;
+}
+
+func main() -> float {
+    let b: Body = Body(Vec(1.0, 2.0), "mars", 3.0);
+    let moved: float = push(b, 4.0);
+    return moved * 100.0 + b.mass * 10.0 + string_length(b.name) + b.position.y;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    ASSERT_TRUE(impulse::frontend::analyzeModule(parseResult.module).success);
+
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    ASSERT_TRUE(vm.load(lowered).success);
+
+    // Structs are references: push's stores show through b
+    const auto result = vm.run("demo", "main");
+    ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 500.0 + 60.0 + 4.0 + 2.0);
+}
+
+TEST(RuntimeTest, StructFieldsAreCheckedAtLoad) {
+    // No semantic pass, so the unknown field reaches the runtime
+    const std::string source = R"(module demo;
+
+struct Vec {
+    x: float;
+}
+
+func main(p: Vec) -> float {
+    return p.z;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    impulse::runtime::Vm vm;
+    const auto loadResult = vm.load(impulse::frontend::lower_to_ir(parseResult.module));
+    EXPECT_FALSE(loadResult.success);
+    ASSERT_FALSE(loadResult.diagnostics.empty());
+    EXPECT_NE(loadResult.diagnostics.front().find("struct 'Vec' has no field 'z'"), std::string::npos)
+        << loadResult.diagnostics.front();
+}
+
+TEST(RuntimeTest, ScalarReplacedArraysKeepResults) {
+    const std::string source = R"(module demo;
+
+func cross_z(out: array, ax: float, ay: float, bx: float, by: float) -> float {
+    array_set(out, 0, ax * by - ay * bx);
+    array_set(out, 1, ax * bx + ay * by);
+    return 0.0;
+}
+
+func main() -> float {
+    let total: float = 0.0;
+    let i: int = 0;
+    while i < 100 {
+        let pair: array = array(2);
+        cross_z(pair, i, 2.0, 3.0, i);
+        total = total + array_get(pair, 0) * 0.5 + array_get(pair, 1);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    ASSERT_TRUE(impulse::frontend::analyzeModule(parseResult.module).success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    // Once cross_z is inlined the pair never leaves main, and its allocations go
+    double expected = 0.0;
+    for (const bool replace : {false, true}) {
+        impulse::ir::OptimizationOptions options;
+        options.scalar_replacement = replace;
+        impulse::runtime::Vm vm;
+        vm.set_optimization_options(options);
+        ASSERT_TRUE(vm.load(lowered).success);
+        const auto result = vm.run("demo", "main");
+        ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+        if (!replace) {
+            expected = result.value;
+            vm.collect_garbage();
+            EXPECT_GE(vm.metrics().gc.objects_freed, 100U);
+            continue;
+        }
+        EXPECT_DOUBLE_EQ(result.value, expected);
+        vm.collect_garbage();
+        EXPECT_EQ(vm.metrics().gc.objects_freed, 0U);
+    }
+}
+
+TEST(RuntimeTest, CountedLoopsSkipArrayChecks) {
+    const std::string source = R"(module demo;
+
+func grow(values: array) -> float {
+    let sum: float = 0.0;
+    let i: int = 0;
+    while i < array_length(values) {
+        sum = sum + array_get(values, i);
+        if i < 3 {
+            array_push(values, i);
+        }
+        i = i + 1;
+    }
+    return sum;
+}
+
+func main() -> float {
+    let values: array = array(2);
+    array_set(values, 0, 1.0);
+    array_set(values, 1, 2.0);
+    let words: array = array(3);
+    array_set(words, 0, "a");
+    array_set(words, 1, "bb");
+    array_set(words, 2, "ccc");
+    let letters: int = 0;
+    let i: int = 0;
+    while i < array_length(words) {
+        letters = letters + string_length(array_get(words, i));
+        i = i + 1;
+    }
+    return grow(values) * 10 + letters;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    // Pushing inside the loop only grows the array, so the read stays proven
+    const auto& grow = lowered.functions.front();
+    auto ssa = impulse::ir::build_ssa(grow);
+    (void)impulse::ir::optimize_ssa(ssa);
+    const auto layout = impulse::runtime::build_frame_layout(ssa, grow.parameters);
+    const auto code = impulse::runtime::compile_bytecode(ssa, layout, lowered.functions);
+    EXPECT_EQ(std::count_if(code.code.begin(), code.code.end(),
+                            [](const auto& inst) { return inst.op == impulse::runtime::BytecodeOp::ArrayGetInBounds; }),
+              1);
+
+    impulse::runtime::Vm vm;
+    vm.set_jit_enabled(false);
+    ASSERT_TRUE(vm.load(lowered).success);
+    const auto result = vm.run("demo", "main");
+    ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 6.0 * 10 + 6.0);
+}
+
 TEST(RuntimeTest, StringBuiltinsExecution) {
     const std::string source = R"(module demo;
 
@@ -209,6 +456,110 @@ func main() -> int {
     EXPECT_LT(std::abs(result.value - 10.0), 1e-9);
 }
 
+TEST(RuntimeTest, OutputSinkStreamsProgramOutput) {
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let i: int = 0;
+    while i < 100 {
+        println("line");
+        i = i + 1;
+    }
+    print(string_repeat("x", 200));
+    return 0;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    ASSERT_TRUE(vm.load(lowered).success);
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        expected += "line\n";
+    }
+    expected += std::string(200, 'x');
+
+    std::vector<std::string> chunks;
+    {
+        impulse::runtime::OutputSink sink([&](std::string_view chunk) { chunks.emplace_back(chunk); }, 64);
+        vm.set_output_sink(&sink);
+        const auto result = vm.run("demo", "main");
+        EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success);
+        EXPECT_TRUE(result.message.empty());  // nothing was collected
+        EXPECT_FALSE(sink.at_line_start());
+        EXPECT_EQ(sink.bytes_written(), expected.size());
+    }
+    std::string streamed;
+    for (const auto& chunk : chunks) {
+        EXPECT_TRUE(chunk.size() <= 64 || chunk == std::string(200, 'x'));  // only the long write is passed through
+        streamed += chunk;
+    }
+    EXPECT_GT(chunks.size(), 5U);
+    EXPECT_EQ(streamed, expected);
+
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        impulse::runtime::OutputSink sink(fileno(file), 100);
+        vm.set_output_sink(&sink);
+        EXPECT_EQ(vm.run("demo", "main").status, impulse::runtime::VmStatus::Success);
+        EXPECT_TRUE(sink.ok());
+    }
+    vm.set_output_sink(nullptr);
+    std::rewind(file);
+    std::string written(expected.size() + 1, '\0');
+    written.resize(std::fread(written.data(), 1, written.size(), file));
+    std::fclose(file);
+    EXPECT_EQ(written, expected);
+
+    EXPECT_EQ(vm.run("demo", "main").message, expected);  // collected again without a sink
+}
+
+TEST(RuntimeTest, StringConcatenationInLoops) {
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let log: string = "";
+    let i: int = 0;
+    while i < 2000 {
+        log = log + "entry;";
+        i = i + 1;
+    }
+    let tail: string = string_slice(log, 5994, 6);
+    if !string_equals(tail, "entry;") {
+        return -1;
+    }
+    let middle: string = string_slice(log, 600, 60);
+    if !string_equals(string_slice(middle, 6, 6), "entry;") {
+        return -2;
+    }
+    return string_length(log);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto semantic = impulse::frontend::analyzeModule(parseResult.module);
+    EXPECT_TRUE(semantic.success);
+
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    const auto loadResult = vm.load(lowered);
+    ASSERT_TRUE(loadResult.success);
+
+    const auto result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success);
+    EXPECT_TRUE(result.has_value);
+    EXPECT_LT(std::abs(result.value - 12000.0), 1e-9);
+}
+
 TEST(RuntimeTest, ArrayStackBuiltins) {
     const std::string source = R"(module demo;
 
@@ -312,6 +663,184 @@ func main() -> int {
     EXPECT_LT(std::abs(result.value - 8.0), 1e-9);
 }
 
+TEST(RuntimeTest, InputSourceReadsLinesInPlace) {
+    // Lines that span chunks and a last line without '\n'
+    std::istringstream stream("first line\nsecond\n\nlast");
+    impulse::runtime::InputSource chunked(stream, 4);
+    std::vector<std::string> lines;
+    while (const auto line = chunked.next_line()) {
+        lines.emplace_back(*line);
+    }
+    EXPECT_EQ(lines, (std::vector<std::string>{"first line", "second", "", "last"}));
+    EXPECT_FALSE(chunked.next_line().has_value());
+
+    const auto path = std::filesystem::temp_directory_path() / "impulse_input_source_test.txt";
+    {
+        std::FILE* file = std::fopen(path.string().c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::fputs("alpha\nbeta\ngamma\n", file);
+        std::fclose(file);
+    }
+    auto mapped = impulse::runtime::InputSource::open_file(path.string());
+    ASSERT_NE(mapped, nullptr);
+    const auto first = mapped->next_line();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(*first, "alpha");
+    EXPECT_EQ(mapped->read_all(), "beta\ngamma\n");
+    EXPECT_FALSE(mapped->next_line().has_value());
+    mapped.reset();
+    std::filesystem::remove(path);
+    EXPECT_EQ(impulse::runtime::InputSource::open_file(path.string()), nullptr);
+
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let head: array = read_lines(2);
+    let rest: string = read_all();
+    return array_length(head) * 1000 + string_length(array_get(head, 1)) * 100 + string_length(rest);
+}
+)";
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    EXPECT_TRUE(impulse::frontend::analyzeModule(parseResult.module).success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    ASSERT_TRUE(vm.load(lowered).success);
+    impulse::runtime::InputSource text(std::string("one\nthree\nremaining input\n"));
+    vm.set_input_source(&text);
+    auto result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success);
+    EXPECT_DOUBLE_EQ(result.value, 2516.0);
+
+    // read_all at the end of input returns an empty string
+    std::istringstream shortInput("only\nx\n");
+    impulse::runtime::InputSource fromStream(shortInput);
+    vm.set_input_source(&fromStream);
+    result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success);
+    EXPECT_DOUBLE_EQ(result.value, 2100.0);
+}
+
+TEST(RuntimeTest, ArrayKernelsGiveTheSameResultsOnEveryCpu) {
+    const auto bits = [](double value) {
+        std::uint64_t out = 0;
+        std::memcpy(&out, &value, sizeof(out));
+        return out;
+    };
+    std::vector<double> values;
+    std::vector<double> others;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(i % 17 == 3 ? impulse::runtime::float64_hole() : std::sin(i) * 1e3);
+        others.push_back(i % 29 == 5 ? impulse::runtime::float64_hole() : std::cos(i * 0.7));
+    }
+    values[40] = std::numeric_limits<double>::quiet_NaN();  // skipped by min / max only
+
+    const auto& scalar = *impulse::runtime::supported_array_kernels().front();
+    for (const auto* kernels : impulse::runtime::supported_array_kernels()) {
+        for (const std::size_t count : {0U, 1U, 15U, 16U, 17U, 40U, 63U, 1000U}) {
+            SCOPED_TRACE(std::string(kernels->isa) + " count " + std::to_string(count));
+            EXPECT_EQ(bits(kernels->sum(others.data(), count)), bits(scalar.sum(others.data(), count)));
+            EXPECT_EQ(bits(kernels->dot(values.data(), others.data(), count)),
+                      bits(scalar.dot(values.data(), others.data(), count)));
+            double low = 0.0;
+            double expected = 0.0;
+            EXPECT_EQ(kernels->min(values.data(), count, &low), scalar.min(values.data(), count, &expected));
+            EXPECT_EQ(bits(low), bits(expected));
+            EXPECT_EQ(kernels->max(values.data(), count, &low), scalar.max(values.data(), count, &expected));
+            EXPECT_EQ(bits(low), bits(expected));
+
+            std::vector<double> scaled(values.begin(), values.end());
+            std::vector<double> scaled_scalar = scaled;
+            kernels->scale(scaled.data(), count, -1.5);
+            scalar.scale(scaled_scalar.data(), count, -1.5);
+            kernels->axpy(0.25, others.data(), scaled.data(), count);
+            scalar.axpy(0.25, others.data(), scaled_scalar.data(), count);
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                ASSERT_EQ(bits(scaled[i]), bits(scaled_scalar[i])) << i;
+            }
+        }
+    }
+    EXPECT_TRUE(impulse::runtime::is_float64_hole(values[3]));
+
+    // Boxed arrays go through the same kernels; nil counts as a hole
+    GcHeap heap;
+    GcObject* boxed = heap.allocate_array(20);
+    GcObject* unboxed = heap.allocate_float64_array(20);
+    for (std::size_t i = 0; i < 20; ++i) {
+        boxed->array_set(i, i == 7 ? Value::make_nil() : Value::make_number(static_cast<double>(i)));
+        unboxed->array_set(i, Value::make_number(2.0));
+    }
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_sum(*boxed).value, 190.0 - 7.0);
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_dot(*boxed, *unboxed).value, 2.0 * (190.0 - 7.0));
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_max(*boxed).value, 19.0);
+    ASSERT_EQ(impulse::runtime::array_axpy(-1.0, *unboxed, *boxed).status, impulse::runtime::VmStatus::Success);
+    EXPECT_DOUBLE_EQ(boxed->array_get(19).number, 17.0);
+    EXPECT_TRUE(boxed->array_get(7).is_nil());
+    ASSERT_EQ(impulse::runtime::array_copy(*unboxed, *boxed).status, impulse::runtime::VmStatus::Success);
+    EXPECT_TRUE(unboxed->array_get(7).is_nil());
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_min(*unboxed).value, -2.0);
+
+    boxed->array_set(3, Value::make_string(heap.allocate_string("text")));
+    EXPECT_EQ(impulse::runtime::array_sum(*boxed).message, "array_sum encountered non-numeric element");
+    EXPECT_EQ(impulse::runtime::array_min(*heap.allocate_float64_array(4)).message,
+              "array_min requires a numeric element");
+}
+
+TEST(RuntimeTest, ArraySortOrdersNumbersThenNaNsThenNil) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    GcHeap heap;
+    GcObject* small = heap.allocate_float64_array(7);
+    const double elements[] = {3.0, nan, -0.0, impulse::runtime::float64_hole(), 0.0, -5.0, 3.0};
+    for (std::size_t i = 0; i < 7; ++i) {
+        small->numbers[i] = elements[i];
+    }
+    std::vector<double> order;
+    ASSERT_EQ(impulse::runtime::array_sort_order(*small, order).status, impulse::runtime::VmStatus::Success);
+    EXPECT_EQ(order, (std::vector<double>{5.0, 2.0, 4.0, 0.0, 6.0, 1.0, 3.0}));  // stable for the 3s
+    ASSERT_EQ(impulse::runtime::array_sort(*small).status, impulse::runtime::VmStatus::Success);
+    EXPECT_TRUE(std::signbit(small->numbers[1]));
+    EXPECT_FALSE(std::signbit(small->numbers[2]));
+    EXPECT_TRUE(std::isnan(small->numbers[5]));
+    EXPECT_TRUE(small->array_get(6).is_nil());
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_binary_search(*small, 3.0).value, 3.0);
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_binary_search(*small, 1.0).value, -1.0);
+
+    // Large enough for the parallel radix sort, with duplicates and negatives
+    const std::size_t count = impulse::runtime::kParallelSortElements + 1000;
+    GcObject* large = heap.allocate_float64_array(count);
+    std::vector<double> expected(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        expected[i] = large->numbers[i] = static_cast<double>((i * 7919) % 5003) - 2500.0;
+    }
+    ASSERT_EQ(impulse::runtime::array_sort_order(*large, order).status, impulse::runtime::VmStatus::Success);
+    std::vector<double> stable(count);
+    std::iota(stable.begin(), stable.end(), 0.0);
+    std::stable_sort(stable.begin(), stable.end(), [&](double lhs, double rhs) {
+        return expected[static_cast<std::size_t>(lhs)] < expected[static_cast<std::size_t>(rhs)];
+    });
+    EXPECT_EQ(order, stable);
+    ASSERT_EQ(impulse::runtime::array_sort(*large).status, impulse::runtime::VmStatus::Success);
+    std::sort(expected.begin(), expected.end());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), large->numbers.data()));
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_binary_search(*large, -2500.0).value, 0.0);
+
+    GcObject* boxed = heap.allocate_array(4);
+    boxed->array_set(0, Value::make_number(2.0));
+    boxed->array_set(1, Value::make_nil());
+    boxed->array_set(2, Value::make_number(-1.0));
+    boxed->array_set(3, Value::make_number(1.0));
+    ASSERT_EQ(impulse::runtime::array_sort(*boxed).status, impulse::runtime::VmStatus::Success);
+    EXPECT_DOUBLE_EQ(boxed->array_get(0).number, -1.0);
+    EXPECT_TRUE(boxed->array_get(3).is_nil());
+    EXPECT_DOUBLE_EQ(impulse::runtime::array_binary_search(*boxed, 2.0).value, 2.0);
+    boxed->array_set(1, Value::make_string(heap.allocate_string("text")));
+    EXPECT_EQ(impulse::runtime::array_sort(*boxed).message, "array_sort encountered non-numeric element");
+    EXPECT_EQ(impulse::runtime::array_binary_search(*boxed, 2.0).message,
+              "array_binary_search encountered non-numeric element");
+}
+
 TEST(RuntimeTest, GcPreservesRoots) {
     GcHeap heap;
     heap.set_next_gc_threshold(1);
@@ -342,3 +871,1503 @@ TEST(RuntimeTest, GcCollectsWhenThresholdExceeded) {
     EXPECT_EQ(heap.live_object_count(), 0);
     EXPECT_EQ(heap.bytes_allocated(), 0);
 }
+
+TEST(RuntimeTest, GcStatsCountCollections) {
+    GcHeap heap;
+    GcObject* kept = heap.allocate_array(4);
+    Value root = Value::make_object(kept);
+    std::vector<Value*> roots = {&root};
+    for (int i = 0; i < 10; ++i) {
+        [[maybe_unused]] GcObject* garbage = heap.allocate_array(8);
+    }
+    const std::size_t before = heap.bytes_allocated();
+
+    heap.collect_minor(roots);
+    GcStats stats = heap.stats();
+    EXPECT_EQ(stats.minor_collections, 1U);
+    EXPECT_EQ(stats.full_collections, 0U);
+    EXPECT_EQ(stats.objects_freed, 10U);
+    EXPECT_EQ(stats.bytes_freed + stats.bytes_promoted, before);
+    EXPECT_EQ(stats.live_bytes, heap.bytes_allocated());
+    EXPECT_EQ(stats.peak_bytes, before);
+
+    root = Value::make_nil();
+    heap.collect(roots);
+    stats = heap.stats();
+    EXPECT_EQ(stats.full_collections, 1U);
+    EXPECT_EQ(stats.pauses, 2U);
+    EXPECT_EQ(stats.objects_freed, 11U);
+    EXPECT_EQ(stats.bytes_freed, before);
+    EXPECT_EQ(stats.live_bytes, 0U);
+    EXPECT_GE(stats.total_pause, stats.max_pause);
+}
+
+TEST(RuntimeTest, GcTracesStringsThroughArrays) {
+    GcHeap heap;
+
+    GcObject* array = heap.allocate_array(1);
+    GcObject* kept = heap.allocate_string("kept");
+    array->fields[0] = Value::make_string(kept);
+    [[maybe_unused]] GcObject* dropped = heap.allocate_string("dropped");
+
+    Value root = Value::make_object(array);
+    std::vector<Value*> roots = {&root};
+    heap.collect(roots);
+
+    EXPECT_EQ(heap.live_object_count(), 2);
+    EXPECT_EQ(array->fields[0].as_string(), "kept");
+    EXPECT_EQ(sizeof(Value), 16U);
+}
+
+TEST(RuntimeTest, GcStringsShareStorage) {
+    GcHeap heap;
+
+    GcObject* literal = heap.intern_string("line");
+    EXPECT_EQ(heap.intern_string("line"), literal);
+    const std::string piece(300, 'x');
+    GcObject* rope = heap.allocate_string(piece);
+    for (int i = 0; i < 3; ++i) {
+        rope = heap.concat_strings(rope, heap.allocate_string(piece));
+    }
+    EXPECT_EQ(rope->chars, nullptr);  // not flattened yet
+    EXPECT_EQ(rope->length, 4U * piece.size());
+    EXPECT_EQ(heap.concat_strings(literal, heap.intern_string("")), literal);
+
+    Value root = Value::make_string(rope);
+    std::vector<Value*> roots = {&root};
+    heap.collect(roots);  // the parts live on through the rope
+    EXPECT_EQ(heap.live_object_count(), 2U + 4U + 3U);  // literals, parts, ropes
+    EXPECT_EQ(root.as_string(), piece + piece + piece + piece);
+    ASSERT_NE(rope->chars, nullptr);
+
+    GcObject* slice = heap.slice_string(rope, 100, 500);
+    EXPECT_EQ(slice->chars, rope->chars + 100);
+    GcObject* inner = heap.slice_string(slice, 10, 200);
+    EXPECT_EQ(inner->chars, rope->chars + 110);
+    EXPECT_EQ(inner->fields[0].object, rope);
+    GcObject* small = heap.slice_string(inner, 0, 4);
+    EXPECT_NE(small->chars, inner->chars);  // short slices are copied
+    EXPECT_EQ(Value::make_string(small).as_string(), "xxxx");
+
+    root = Value::make_string(inner);
+    heap.collect(roots);  // the rope is gone, the flat string it became stays for the slice
+    EXPECT_EQ(heap.live_object_count(), 2U + 1U + 1U);  // literals, the flattened rope, inner
+    EXPECT_EQ(root.as_string(), std::string(200, 'x'));
+    EXPECT_EQ(literal->contents(), "line");
+}
+
+TEST(RuntimeTest, Float64ArraysBoxOnFirstNonNumber) {
+    GcHeap heap;
+
+    GcObject* array = heap.allocate_float64_array(3);
+    ASSERT_EQ(array->kind, impulse::runtime::ObjectKind::Float64Array);
+    EXPECT_TRUE(array->array_get(0).is_nil());
+    array->array_set(1, Value::make_number(2.5));
+    array->array_push(Value::make_number(std::nan("")));
+    EXPECT_EQ(array->array_length(), 4U);
+    EXPECT_TRUE(array->fields.empty());
+    EXPECT_TRUE(array->array_get(3).is_number());  // a stored NaN is a number, not a hole
+
+    GcObject* text = heap.allocate_string("text");
+    array->array_set(2, Value::make_string(text));
+    ASSERT_EQ(array->kind, impulse::runtime::ObjectKind::Array);
+    EXPECT_TRUE(array->numbers.empty());
+    EXPECT_TRUE(array->array_get(0).is_nil());
+    EXPECT_DOUBLE_EQ(array->array_get(1).as_number(), 2.5);
+    EXPECT_EQ(array->array_get(2).as_string(), "text");
+
+    Value root = Value::make_object(array);
+    std::vector<Value*> roots = {&root};
+    heap.collect(roots);
+    EXPECT_EQ(heap.live_object_count(), 2);
+}
+
+TEST(RuntimeTest, GcStoresSmallArraysInlineAndReusesCells) {
+    GcHeap heap;
+
+    GcObject* small = heap.allocate_float64_array(4);
+    const auto* cell_end = reinterpret_cast<const unsigned char*>(small + 1) + small->inline_bytes;
+    EXPECT_EQ(static_cast<const void*>(small->numbers.data()), static_cast<const void*>(small + 1));
+    EXPECT_LE(reinterpret_cast<const unsigned char*>(small->numbers.data() + 4), cell_end);
+    EXPECT_EQ(small->footprint(), sizeof(GcObject) + small->inline_bytes);
+
+    GcObject* large = heap.allocate_array(10000);
+    EXPECT_EQ(large->inline_bytes, 10000U * sizeof(Value));
+    EXPECT_EQ(static_cast<const void*>(large->fields.data()), static_cast<const void*>(large + 1));
+    large->array_push(Value::make_nil());  // outgrows its cell
+    EXPECT_NE(static_cast<const void*>(large->fields.data()), static_cast<const void*>(large + 1));
+    EXPECT_EQ(large->array_length(), 10001U);
+
+    std::vector<Value*> roots;
+    heap.collect(roots);
+    EXPECT_EQ(heap.live_object_count(), 0U);
+    GcObject* reused = heap.allocate_float64_array(3);  // same size class as `small`
+    EXPECT_EQ(reused, small);
+    EXPECT_FALSE(reused->marked());
+}
+
+TEST(RuntimeTest, GcStoresStructFieldsInline) {
+    GcHeap heap;
+
+    GcObject* object = heap.allocate_struct(7, 2, 1);
+    EXPECT_EQ(object->kind, impulse::runtime::ObjectKind::Struct);
+    EXPECT_EQ(object->shape, 7U);
+    ASSERT_EQ(object->numbers.size(), 2U);
+    ASSERT_EQ(object->fields.size(), 1U);
+    EXPECT_EQ(static_cast<const void*>(object->numbers.data()), static_cast<const void*>(object + 1));
+    EXPECT_EQ(static_cast<const void*>(object->fields.data()), static_cast<const void*>(object->numbers.data() + 2));
+    EXPECT_EQ(object->numbers[1], 0.0);
+    EXPECT_TRUE(object->fields[0].is_nil());
+
+    object->numbers[1] = 2.5;
+    object->fields[0] = Value::make_string(heap.allocate_string("name"));
+    Value root = Value::make_object(object);
+    std::vector<Value*> roots = {&root};
+    heap.collect(roots);
+    EXPECT_EQ(heap.live_object_count(), 2U);
+    EXPECT_EQ(object->numbers[1], 2.5);
+    EXPECT_EQ(object->fields[0].as_string(), "name");
+}
+
+TEST(RuntimeTest, GcCountsArrayGrowth) {
+    GcHeap heap;
+
+    GcObject* array = heap.allocate_array(0);
+    const std::size_t empty = heap.bytes_allocated();
+    for (int i = 0; i < 1000; ++i) {
+        array->array_push(Value::make_string(nullptr));
+    }
+    heap.record_resize(array);
+    EXPECT_GE(heap.bytes_allocated(), empty + (1000 * sizeof(Value)));
+    EXPECT_EQ(heap.young_bytes(), heap.bytes_allocated());
+
+    Value root = Value::make_object(array);
+    std::vector<Value*> roots = {&root};
+    heap.collect_minor(roots);
+    EXPECT_EQ(heap.bytes_allocated(), array->footprint());
+    array->array_push(Value::make_nil());
+    array->fields.shrink_to_fit();
+    heap.record_resize(array);  // old objects are counted too
+    EXPECT_EQ(heap.bytes_allocated(), array->footprint());
+    EXPECT_EQ(heap.young_bytes(), 0U);
+
+    root = Value::make_nil();
+    heap.collect(roots);
+    EXPECT_EQ(heap.bytes_allocated(), 0U);
+}
+
+TEST(RuntimeTest, GcPacingBoundsThresholdAndPauses) {
+    GcHeap heap;
+    impulse::runtime::GcPacing pacing;
+    pacing.growth = 8.0;
+    pacing.min_threshold = 1024;
+    pacing.limit = std::size_t{64} * 1024;
+    heap.set_pacing(pacing);
+    EXPECT_LE(heap.next_gc_threshold(), pacing.limit);
+
+    GcObject* array = heap.allocate_array(1000);  // about 16 KiB
+    Value root = Value::make_object(array);
+    std::vector<Value*> roots = {&root};
+    heap.collect(roots);
+    EXPECT_EQ(heap.next_gc_threshold(), pacing.limit);  // 8x the live bytes, capped
+
+    pacing.limit = 0;
+    heap.set_pacing(pacing);
+    EXPECT_EQ(heap.next_gc_threshold(), heap.bytes_allocated() * 8);
+
+    // No minor collection fits a 1ns budget, so the nursery keeps shrinking to its floor
+    pacing.max_pause = std::chrono::nanoseconds{1};
+    heap.set_pacing(pacing);
+    for (int i = 0; i < 8; ++i) {
+        heap.collect_minor(roots);
+    }
+    EXPECT_LT(heap.nursery_limit(), GcHeap::nursery_bytes());
+    EXPECT_GT(heap.nursery_limit(), 0U);
+    pacing.max_pause = std::chrono::nanoseconds{0};
+    heap.set_pacing(pacing);
+    EXPECT_EQ(heap.nursery_limit(), GcHeap::nursery_bytes());
+}
+
+TEST(RuntimeTest, ParallelCollectionsMatchSerialOnes) {
+    // Rows of small arrays, one row long enough to be split between markers, and as much garbage
+    const auto build = [](GcHeap& heap, Value& root) {
+        GcObject* table = heap.allocate_array(64);
+        root = Value::make_object(table);
+        for (std::size_t row = 0; row < table->fields.size(); ++row) {
+            GcObject* cells = heap.allocate_array(row == 0 ? 20000 : 200);
+            table->fields[row] = Value::make_object(cells);
+            for (auto& cell : cells->fields) {
+                cell = Value::make_object(heap.allocate_array(1));
+                [[maybe_unused]] GcObject* garbage = heap.allocate_array(1);
+            }
+        }
+    };
+    GcHeap serial;
+    GcHeap parallel;
+    parallel.set_collector_threads(4);
+    Value serial_root;
+    Value parallel_root;
+    build(serial, serial_root);
+    build(parallel, parallel_root);
+    std::vector<Value*> serial_roots = {&serial_root};
+    std::vector<Value*> parallel_roots = {&parallel_root};
+    ASSERT_GE(parallel.bytes_allocated(), std::size_t{1024} * 1024);
+
+    for (int round = 0; round < 2; ++round) {  // young objects first, then the old table
+        serial.collect(serial_roots);
+        parallel.collect(parallel_roots);
+        EXPECT_EQ(parallel.live_object_count(), serial.live_object_count());
+        if (round == 0) {
+            EXPECT_EQ(parallel.live_object_count(), 1U + 64U + 20000U + (63U * 200U));
+        }
+        EXPECT_EQ(parallel.bytes_allocated(), serial.bytes_allocated());
+        GcObject* rows = parallel_root.as_object();
+        for (std::size_t row = 1; row < rows->fields.size(); row += 2) {
+            rows->fields[row] = Value::make_nil();  // drops half the rows for the next round
+        }
+        rows = serial_root.as_object();
+        for (std::size_t row = 1; row < rows->fields.size(); row += 2) {
+            rows->fields[row] = Value::make_nil();
+        }
+    }
+    serial.collect(serial_roots);
+    parallel.collect(parallel_roots);
+    EXPECT_EQ(parallel.live_object_count(), serial.live_object_count());
+    EXPECT_EQ(parallel.bytes_allocated(), serial.bytes_allocated());
+}
+
+TEST(RuntimeTest, IncrementalMarkingFollowsStoresAndSweepsLazily) {
+    GcHeap heap;
+    impulse::runtime::GcPacing pacing;
+    pacing.mark_budget = 1;
+    heap.set_pacing(pacing);
+
+    GcObject* holder = heap.allocate_array(1);
+    GcObject* source = heap.allocate_array(1);
+    source->fields[0] = Value::make_object(heap.allocate_array(0));
+    Value source_root = Value::make_object(source);
+    Value holder_root = Value::make_object(holder);
+    Value garbage_root = Value::make_object(heap.allocate_array(4));
+    std::vector<Value*> roots = {&source_root, &holder_root, &garbage_root};
+    heap.collect(roots);  // everything old
+    garbage_root = Value::make_nil();
+
+    heap.start_marking(roots);
+    ASSERT_TRUE(heap.marking());
+    EXPECT_FALSE(heap.mark_step());  // traces the holder, the last root grayed
+    // Move the only reference to the child from the untraced source into the traced holder
+    holder->fields[0] = source->fields[0];
+    heap.record_write(holder, holder->fields[0]);
+    source->fields[0] = Value::make_nil();
+    GcObject* fresh = heap.allocate_string("fresh");
+    EXPECT_TRUE(fresh->marked());  // allocated during marking
+    heap.collect_minor(roots);   // waits for the cycle
+    while (!heap.mark_step()) {
+    }
+    heap.finish_marking(roots);
+    EXPECT_FALSE(heap.marking());
+    EXPECT_TRUE(heap.sweeping());
+    EXPECT_TRUE(fresh->old);
+
+    [[maybe_unused]] GcObject* next = heap.allocate_array(0);  // sweeps a few old objects
+    EXPECT_FALSE(heap.sweeping());
+    EXPECT_EQ(heap.live_object_count(), 5U);  // holder, source, child, fresh, next
+    EXPECT_TRUE(holder->fields[0].heap_object() != nullptr);
+    EXPECT_FALSE(holder->fields[0].heap_object()->marked());
+    EXPECT_LT(heap.next_gc_threshold(), std::numeric_limits<std::size_t>::max());
+}
+
+TEST(RuntimeTest, IncrementalCollectionsRunPrograms) {
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let rows: array = array(0);
+    let i: int = 0;
+    while i < 20000 {
+        let row: array = array(8);
+        array_set(row, 0, i);
+        array_set(row, 1, "row");
+        if i % 50 == 0 {
+            array_push(rows, row);
+        }
+        i = i + 1;
+    }
+    let total: int = 0;
+    let k: int = 0;
+    while k < array_length(rows) {
+        let row: array = array_get(rows, k);
+        total = total + array_get(row, 0) + string_length(array_get(row, 1));
+        k = k + 1;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    impulse::runtime::GcPacing pacing;
+    pacing.min_threshold = std::size_t{64} * 1024;
+    pacing.growth = 1.0;
+    pacing.mark_budget = 16;
+    vm.set_gc_pacing(pacing);
+    const auto loadResult = vm.load(lowered);
+    ASSERT_TRUE(loadResult.success);
+
+    const auto result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 3991200.0);
+}
+
+TEST(RuntimeTest, MinorCollectionsPromoteSurvivors) {
+    GcHeap heap;
+
+    GcObject* parent = heap.allocate_array(1);
+    [[maybe_unused]] GcObject* garbage = heap.allocate_array(4);
+    Value root = Value::make_object(parent);
+    std::vector<Value*> roots = {&root};
+    heap.collect_minor(roots);
+
+    EXPECT_EQ(heap.live_object_count(), 1);
+    EXPECT_TRUE(parent->old);
+    EXPECT_EQ(heap.young_bytes(), 0U);
+
+    // A young object reachable only through an old one survives thanks to the write barrier
+    GcObject* child = heap.allocate_string("child");
+    parent->fields[0] = Value::make_string(child);
+    heap.record_write(parent, parent->fields[0]);
+    EXPECT_TRUE(parent->remembered);
+    heap.collect_minor(roots);
+
+    EXPECT_EQ(heap.live_object_count(), 2);
+    EXPECT_TRUE(child->old);
+    EXPECT_FALSE(parent->remembered);
+    EXPECT_EQ(parent->fields[0].as_string(), "child");
+
+    root = Value::make_nil();
+    heap.collect(roots);
+    EXPECT_EQ(heap.live_object_count(), 0);
+    EXPECT_EQ(heap.bytes_allocated(), 0U);
+}
+
+TEST(RuntimeTest, YoungArraysStoredIntoOldArraysSurvive) {
+    // Enough short-lived arrays for many minor collections; `rows` is promoted early and then
+    // keeps receiving young arrays
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let rows: array = array(0);
+    let i: int = 0;
+    while i < 30000 {
+        let row: array = array(16);
+        array_set(row, 0, i);
+        if i % 100 == 0 {
+            array_push(rows, row);
+        }
+        i = i + 1;
+    }
+    let total: int = 0;
+    let k: int = 0;
+    while k < array_length(rows) {
+        let row: array = array_get(rows, k);
+        total = total + array_get(row, 0);
+        k = k + 1;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    const auto loadResult = vm.load(lowered);
+    ASSERT_TRUE(loadResult.success);
+
+    const auto result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_TRUE(result.has_value);
+    EXPECT_DOUBLE_EQ(result.value, 4485000.0);
+}
+
+TEST(RuntimeTest, CodeCacheWarmStartReusesCompiledFunctions) {
+    const std::string source = R"(module demo;
+
+func square(x: int) -> int {
+    return x * x;
+}
+
+func sum_squares(n: int) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < n {
+        total = total + square(i);
+        i = i + 1;
+    }
+    return total;
+}
+
+func main() -> int {
+    return sum_squares(100) + sum_squares(10);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    const auto directory = std::filesystem::temp_directory_path() / "impulse-code-cache-test";
+    std::filesystem::remove_all(directory);
+    impulse::ir::OptimizationOptions keep_calls;  // the test checks the callees' own code
+    keep_calls.inlining = false;
+    keep_calls.fold_calls = false;
+
+    {
+        impulse::runtime::Vm vm;
+        vm.set_code_cache_directory(directory.string());
+        vm.set_tier_thresholds({1, 1000});
+        vm.set_optimization_options(keep_calls);
+        ASSERT_TRUE(vm.load(lowered).success);
+        const auto result = vm.run("demo", "main");
+        ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 328635.0);
+        ASSERT_TRUE(vm.save_code_cache());
+    }
+    ASSERT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator{}), 1);
+
+    {
+        // Warm start: everything comes from the mapped file, so nothing is left to write back
+        // (the mapping outlives the file's directory entry)
+        impulse::runtime::Vm vm;
+        vm.set_code_cache_directory(directory.string());
+        vm.set_tier_thresholds({1, 1000});
+        vm.set_optimization_options(keep_calls);
+        ASSERT_TRUE(vm.load(lowered).success);
+        std::filesystem::remove_all(directory);
+
+        const auto result = vm.run("demo", "main");
+        ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 328635.0);
+        EXPECT_TRUE(vm.is_function_jit_compiled("demo", "square"));
+        if (std::string(impulse::jit::JitCompiler::target()) == "x86-64") {  // AArch64: no calls
+            EXPECT_TRUE(vm.is_function_jit_compiled("demo", "sum_squares"));
+        }
+        ASSERT_TRUE(vm.save_code_cache());
+        EXPECT_FALSE(std::filesystem::exists(directory));
+    }
+
+    enum class Damage { None, Truncated, Flipped, Intact };
+    for (const Damage damage : {Damage::None, Damage::Truncated, Damage::Flipped, Damage::Intact}) {
+        // A truncated file, or one with a few bits flipped anywhere (the machine code included), is
+        // ignored and then replaced by the run's own results
+        const auto path = std::filesystem::exists(directory) ? std::filesystem::directory_iterator(directory)->path()
+                                                             : std::filesystem::path{};
+        if (damage == Damage::Truncated) {
+            std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+        } else if (damage == Damage::Flipped) {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            const auto size = static_cast<std::streamoff>(std::filesystem::file_size(path));
+            for (const std::streamoff offset : {size / 3, size / 2, size * 2 / 3}) {
+                char byte = 0;
+                file.seekg(offset);
+                file.get(byte);
+                file.seekp(offset);
+                file.put(static_cast<char>(byte ^ 0x10));
+            }
+        }
+        impulse::runtime::Vm vm;
+        vm.set_code_cache_directory(directory.string());
+        vm.set_tier_thresholds({1, 1000});
+        vm.set_optimization_options(keep_calls);
+        ASSERT_TRUE(vm.load(lowered).success);
+        const auto result = vm.run("demo", "main");
+        ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+        EXPECT_DOUBLE_EQ(result.value, 328635.0);
+        EXPECT_EQ(vm.metrics().code_cache_hits > 0, damage == Damage::Intact);
+        ASSERT_TRUE(vm.save_code_cache());
+    }
+    std::filesystem::remove_all(directory);
+}
+
+TEST(RuntimeTest, MetricsCountCollectionsCompilationsAndInterpretedCode) {
+    const std::string source = R"(module demo;
+
+func square(x: int) -> int {
+    return x * x;
+}
+
+func churn(n: int) -> int {
+    let i: int = 0;
+    let total: int = 0;
+    while i < n {
+        let values: array = array(64);
+        array_set(values, 0, square(i));
+        total = total + array_get(values, 0);
+        i = i + 1;
+    }
+    return total;
+}
+
+func main() -> int {
+    return churn(4000);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    impulse::ir::OptimizationOptions keep_calls;
+    keep_calls.inlining = false;
+    vm.set_optimization_options(keep_calls);
+    std::vector<impulse::runtime::GcEvent> pauses;
+    vm.set_gc_callback([&](const impulse::runtime::GcEvent& event) { pauses.push_back(event); });
+    ASSERT_TRUE(vm.load(lowered).success);
+    const auto result = vm.run("demo", "main");
+    ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+
+    const impulse::runtime::VmMetrics metrics = vm.metrics();
+    EXPECT_EQ(metrics.gc_threads, 1U);
+    EXPECT_GT(metrics.gc.minor_collections, 0U);
+    ASSERT_EQ(pauses.size(), metrics.gc.pauses);
+    std::uint64_t freed = 0;
+    for (const auto& pause : pauses) {
+        freed += pause.bytes_freed;
+    }
+    EXPECT_EQ(freed, metrics.gc.bytes_freed);
+    EXPECT_GT(metrics.gc.bytes_freed, 0U);
+
+    EXPECT_GE(metrics.jit_compilations, 1U);  // square, and churn's loop
+    EXPECT_GT(metrics.jit_compile_time.count(), 0);
+    EXPECT_GT(metrics.code_bytes, 0U);
+    EXPECT_GE(metrics.code_bytes_reserved, metrics.code_bytes);
+    EXPECT_GE(metrics.calls, 3U);
+    EXPECT_GT(metrics.interpreted_calls, 0U);
+    EXPECT_GT(metrics.interpreter_instructions, 0U);
+    EXPECT_GE(metrics.ssa_cache_lookups, metrics.interpreted_calls);
+    EXPECT_GE(metrics.ssa_cache_misses, 3U);
+    EXPECT_LE(metrics.ssa_cache_misses, metrics.ssa_cache_lookups);
+}
+
+TEST(RuntimeTest, PureCallsAreFoldedAndMemoised) {
+    const std::string source = R"(module demo;
+
+let fib25: int = fib(25);
+
+func fib(n: int) -> int {
+    if n < 2 {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+func loud(n: int) -> int {
+    println(n);
+    return n;
+}
+
+func constant() -> int {
+    return fib25 - fib(24) + loud(fib(5));
+}
+
+func varying() -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < 40 {
+        total = total + fib(i % 4 + 18);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    // The initializer calls fib at load; constant's calls to fib are folded, loud's output stays
+    impulse::runtime::Vm vm;
+    ASSERT_TRUE(vm.load(lowered).success);
+    EXPECT_EQ(vm.function_tier_counters("demo", "fib").calls, 0U);
+    const auto constant = vm.run("demo", "constant");
+    ASSERT_EQ(constant.status, impulse::runtime::VmStatus::Success) << constant.message;
+    EXPECT_DOUBLE_EQ(constant.value, 75025.0 - 46368.0 + 5.0);
+    EXPECT_EQ(constant.message, "5\n");
+    EXPECT_EQ(vm.function_tier_counters("demo", "fib").calls, 0U);
+
+    // Memoised, fib runs once per distinct argument after the first few calls
+    impulse::runtime::Vm memoising;
+    memoising.set_memoization(true);
+    memoising.set_tier_thresholds({2, 1000, 64, 100});
+    ASSERT_TRUE(memoising.load(lowered).success);
+    const auto varying = memoising.run("demo", "varying");
+    ASSERT_EQ(varying.status, impulse::runtime::VmStatus::Success) << varying.message;
+    EXPECT_DOUBLE_EQ(varying.value, 10.0 * (2584.0 + 4181.0 + 6765.0 + 10946.0));
+    EXPECT_GT(memoising.metrics().memo_hits, 0U);
+    EXPECT_LT(memoising.function_tier_counters("demo", "fib").calls, 1000U);
+}
+
+#ifdef __linux__
+TEST(RuntimeTest, JitSymbolsNameInstalledCode) {
+    const std::string source = R"(module demo;
+
+func square(x: int) -> int {
+    return x * x;
+}
+
+func main() -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < 2000 {
+        total = total + square(i);
+        i = i + 1;
+    }
+    return total;
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    const auto directory = std::filesystem::temp_directory_path() / "impulse-jit-symbols-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    impulse::ir::OptimizationOptions keep_calls;
+    keep_calls.inlining = false;
+    {
+        impulse::runtime::Vm vm;
+        impulse::jit::JitSymbolOptions options;
+        options.perf_map = true;
+        options.jitdump = true;
+        options.gdb = true;
+        options.directory = directory.string();
+        vm.set_jit_symbols(options);
+        vm.set_tier_thresholds({2, 100});
+        vm.set_optimization_options(keep_calls);
+        ASSERT_TRUE(vm.load(lowered).success);
+        const auto result = vm.run("demo", "main");
+        ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+        ASSERT_TRUE(vm.is_function_jit_compiled("demo", "square"));
+        ASSERT_TRUE(vm.load(lowered).success);  // reloading forgets the old code
+    }
+
+    const auto pid = std::to_string(getpid());
+    std::ifstream map(directory / ("perf-" + pid + ".map"));
+    ASSERT_TRUE(map);
+    std::vector<std::string> names;
+    for (std::string line; std::getline(map, line);) {
+        std::istringstream fields(line);
+        std::string address;
+        std::string size;
+        std::string name;
+        fields >> address >> size;
+        std::getline(fields >> std::ws, name);
+        EXPECT_NE(std::stoull(address, nullptr, 16), 0U) << line;
+        EXPECT_NE(std::stoull(size, nullptr, 16), 0U) << line;
+        names.push_back(name);
+    }
+    EXPECT_NE(std::find(names.begin(), names.end(), "demo::square"), names.end());
+    EXPECT_NE(std::find_if(names.begin(), names.end(),
+                           [](const std::string& name) { return name.rfind("demo::main [osr ", 0) == 0; }),
+              names.end());
+
+    std::ifstream dump(directory / ("jit-" + pid + ".dump"), std::ios::binary);
+    std::uint32_t magic = 0;
+    ASSERT_TRUE(dump.read(reinterpret_cast<char*>(&magic), sizeof(magic)));
+    EXPECT_EQ(magic, 0x4A695444U);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(RuntimeTest, JitSymbolsRegisterAndForgetGdbObjects) {
+    static const unsigned char code[16] = {0xC3};
+    impulse::jit::JitSymbolOptions options;
+    options.gdb = true;
+    impulse::jit::JitSymbols symbols(options);
+    int first = 0;
+    int second = 0;
+    symbols.add(&first, "demo::a", code, 1);
+    symbols.add(&first, "demo::b", code + 1, 1);
+    symbols.add(&second, "demo::c", code + 2, 1);
+    EXPECT_EQ(symbols.gdb_entry_count(), 3U);
+    symbols.forget(&first);
+    EXPECT_EQ(symbols.gdb_entry_count(), 1U);
+    symbols.forget(nullptr);
+    EXPECT_EQ(symbols.gdb_entry_count(), 0U);
+}
+#endif
+
+TEST(RuntimeTest, InlinedCallsBehaveLikeCalls) {
+    const std::string source = R"(module demo;
+
+func at(values: array, i: int) -> int {
+    return array_get(values, i) * 2;
+}
+
+func average(total: int, count: int) -> int {
+    return total / count;
+}
+
+func run(limit: int, spread: int) -> int {
+    let values: array = array(4);
+    let sum: int = 0;
+    let i: int = 0;
+    while i < limit {
+        if i < 4 {
+            array_set(values, i, i + 1);
+        }
+        sum = sum + at(values, i) + average(i, spread - i);
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+
+    impulse::ir::OptimizationOptions keep_calls;
+    keep_calls.inlining = false;
+    // The first run succeeds, the second divides by zero and the third reads past the array
+    for (const char* arguments : {"3, 4", "4, 3", "5, 9"}) {
+        impulse::frontend::Parser parser(source + "func main() -> int {\n    return run(" + arguments + ");\n}\n");
+        impulse::frontend::ParseResult parseResult = parser.parseModule();
+        ASSERT_TRUE(parseResult.success);
+        const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+        // Interpreted on both sides: compiled code does not trap on a zero divisor
+        impulse::runtime::Vm inlined;
+        impulse::runtime::Vm called;
+        inlined.set_jit_enabled(false);
+        called.set_jit_enabled(false);
+        called.set_optimization_options(keep_calls);
+        ASSERT_TRUE(inlined.load(lowered).success);
+        ASSERT_TRUE(called.load(lowered).success);
+        const auto expected = called.run("demo", "main");
+        const auto actual = inlined.run("demo", "main");
+        EXPECT_EQ(actual.status, expected.status) << arguments;
+        EXPECT_EQ(actual.message, expected.message) << arguments;
+        EXPECT_DOUBLE_EQ(actual.value, expected.value) << arguments;
+
+        // Traced runs keep every call so each one is reported
+        impulse::runtime::Vm traced;
+        std::ostringstream trace;
+        traced.set_jit_enabled(false);
+        traced.set_trace_stream(&trace);
+        ASSERT_TRUE(traced.load(lowered).success);
+        EXPECT_EQ(traced.run("demo", "main").status, expected.status) << arguments;
+        EXPECT_NE(trace.str().find("enter function average"), std::string::npos) << arguments;
+    }
+}
+
+TEST(RuntimeTest, InterpretedCallsDoNotAllocate) {
+    const std::string source = R"(module demo;
+
+func fact(n: int) -> int {
+    if n <= 1 {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+
+func sort(values: array, low: int, high: int) -> int {
+    if low >= high {
+        return 0;
+    }
+    let pivot: int = array_get(values, high);
+    let store: int = low;
+    let i: int = low;
+    while i < high {
+        let current: int = array_get(values, i);
+        if current < pivot {
+            array_set(values, i, array_get(values, store));
+            array_set(values, store, current);
+            store = store + 1;
+        }
+        i = i + 1;
+    }
+    array_set(values, high, array_get(values, store));
+    array_set(values, store, pivot);
+    return sort(values, low, store - 1) + sort(values, store + 1, high) + 1;
+}
+
+func sorted(length: int) -> int {
+    let values: array = array(length);
+    let i: int = 0;
+    while i < length {
+        array_set(values, i, (i * 7919) % length);
+        i = i + 1;
+    }
+    return sort(values, 0, length - 1);
+}
+
+func small() -> int {
+    return fact(5) + sorted(8);
+}
+
+func large() -> int {
+    return fact(15) + sorted(32);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    vm.set_jit_enabled(false);
+    ASSERT_TRUE(vm.load(lowered).success);
+    // The first runs build the SSA and grow the frame pool to its final depth
+    ASSERT_EQ(vm.run("demo", "large").status, impulse::runtime::VmStatus::Success);
+    ASSERT_EQ(vm.run("demo", "small").status, impulse::runtime::VmStatus::Success);
+
+    // Only the array itself is allocated, however many calls a run makes
+    const auto allocations = [&](const char* entry) {
+        const std::size_t before = allocation_count.load();
+        const auto result = vm.run("demo", entry);
+        EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << entry;
+        return allocation_count.load() - before;
+    };
+    const std::size_t small = allocations("small");
+    EXPECT_EQ(allocations("large"), small);
+    EXPECT_LE(small, 1U);
+}
+
+TEST(RuntimeTest, FunctionIdsAreDenseAndKeptOnReload) {
+    const auto lower = [](const std::string& source) {
+        impulse::frontend::Parser parser(source);
+        impulse::frontend::ParseResult parseResult = parser.parseModule();
+        EXPECT_TRUE(parseResult.success);
+        return impulse::frontend::lower_to_ir(parseResult.module);
+    };
+    const std::string first = "module first;\nfunc one() -> int {\n    return 1;\n}\n"
+                              "func two() -> int {\n    return one() + 1;\n}\n";
+    const std::string second = "module second;\nfunc three() -> int {\n    return 3;\n}\n";
+
+    impulse::runtime::Vm vm;
+    vm.set_jit_enabled(false);
+    ASSERT_TRUE(vm.load(lower(first)).success);
+    ASSERT_TRUE(vm.load(lower(second)).success);
+    EXPECT_EQ(vm.function_id("first", "one"), 0U);
+    EXPECT_EQ(vm.function_id("first", "two"), 1U);
+    EXPECT_EQ(vm.function_id("second", "three"), 2U);
+    EXPECT_FALSE(vm.function_id("second", "one").has_value());
+    EXPECT_FALSE(vm.function_id("third", "one").has_value());
+
+    EXPECT_DOUBLE_EQ(vm.run("first", "two").value, 2.0);
+    EXPECT_EQ(vm.function_tier_counters("first", "two").calls, 1U);
+
+    // Reloading the same functions keeps their ids, and what unchanged ones did
+    const auto reloaded = vm.load(lower(first));
+    ASSERT_TRUE(reloaded.success);
+    EXPECT_EQ(reloaded.functions_kept, 2U);
+    EXPECT_EQ(vm.function_id("first", "one"), 0U);
+    EXPECT_EQ(vm.function_tier_counters("first", "two").calls, 1U);
+
+    // A reload that changes the function list hands out new ids and forgets everything
+    const auto grown = vm.load(lower(first + "func four() -> int {\n    return 4;\n}\n"));
+    ASSERT_TRUE(grown.success);
+    EXPECT_EQ(grown.functions_kept, 0U);
+    EXPECT_EQ(vm.function_id("first", "one"), 3U);
+    EXPECT_EQ(vm.function_id("first", "four"), 5U);
+    EXPECT_EQ(vm.function_id("second", "three"), 2U);
+    EXPECT_EQ(vm.function_tier_counters("first", "two").calls, 0U);
+    EXPECT_DOUBLE_EQ(vm.run("first", "two").value, 2.0);
+    EXPECT_DOUBLE_EQ(vm.run("second", "three").value, 3.0);
+}
+
+TEST(RuntimeTest, ThreadsShareOneVm) {
+    const std::string source = R"(module demo;
+
+func fib(n: int) -> int {
+    if n < 2 {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+func total(values: array, length: int) -> int {
+    let sum: int = 0;
+    let i: int = 0;
+    while i < length {
+        sum = sum + array_get(values, i);
+        i = i + 1;
+    }
+    return sum;
+}
+
+func numbers() -> int {
+    let values: array = array(50);
+    let i: int = 0;
+    while i < 50 {
+        array_set(values, i, i);
+        i = i + 1;
+    }
+    return total(values, 50) + fib(15);
+}
+
+func words() -> int {
+    let text: string = "";
+    let i: int = 0;
+    while i < 40 {
+        text = string_concat(text, "ab");
+        i = i + 1;
+    }
+    println(string_slice(text, 0, 6));
+    return string_length(text);
+}
+
+func overrun() -> int {
+    let values: array = array(4);
+    let i: int = 0;
+    while i < 4 {
+        array_set(values, i, i);
+        i = i + 1;
+    }
+    return total(values, 8);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    impulse::runtime::Vm vm;
+    impulse::ir::OptimizationOptions keep_calls;  // fib(15) is run, not folded, so fib gets compiled
+    keep_calls.fold_calls = false;
+    vm.set_optimization_options(keep_calls);
+    ASSERT_TRUE(vm.load(impulse::frontend::lower_to_ir(parseResult.module)).success);
+
+    // Every thread runs each entry many times; results, output and errors must match a lone run
+    constexpr int kThreads = 4;
+    constexpr int kRounds = 50;
+    std::vector<int> mismatches(kThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&vm, &mismatches, t] {
+            for (int round = 0; round < kRounds; ++round) {
+                const auto numbers = vm.run("demo", "numbers");
+                const auto words = vm.run("demo", "words");
+                const auto overrun = vm.run("demo", "overrun");
+                const bool same = numbers.status == impulse::runtime::VmStatus::Success && numbers.value == 1835.0 &&
+                                  words.status == impulse::runtime::VmStatus::Success && words.value == 80.0 &&
+                                  words.message == "ababab\n" &&
+                                  overrun.status == impulse::runtime::VmStatus::RuntimeError &&
+                                  overrun.message.find("out of bounds") != std::string::npos;
+                mismatches[t] += same ? 0 : 1;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < kThreads; ++t) {
+        EXPECT_EQ(mismatches[t], 0) << "thread " << t;
+    }
+    if (std::string(impulse::jit::JitCompiler::target()) == "x86-64") {  // AArch64: no calls or arrays
+        EXPECT_TRUE(vm.is_function_jit_compiled("demo", "fib"));
+        EXPECT_TRUE(vm.is_function_jit_compiled("demo", "total"));
+    }
+    EXPECT_GE(vm.function_tier_counters("demo", "words").calls, 1U);
+}
+
+TEST(RuntimeTest, StringsSurviveCollections) {
+    // Enough string garbage to cross the default collection threshold many times over
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let kept: array = array(0);
+    let i: int = 0;
+    while i < 20000 {
+        let piece: string = string_repeat("x", 40);
+        if i % 1000 == 0 {
+            array_push(kept, string_concat(piece, "!"));
+        }
+        i = i + 1;
+    }
+    let joined: string = array_join(kept, "");
+    return string_length(joined);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto semantic = impulse::frontend::analyzeModule(parseResult.module);
+    EXPECT_TRUE(semantic.success);
+
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    impulse::runtime::Vm vm;
+    const auto loadResult = vm.load(lowered);
+    ASSERT_TRUE(loadResult.success);
+
+    const auto result = vm.run("demo", "main");
+    EXPECT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_TRUE(result.has_value);
+    EXPECT_LT(std::abs(result.value - 20.0 * 41.0), 1e-9);
+}
+
+TEST(RuntimeTest, FrameLayoutAndBytecodeResolveSlotsAndBranches) {
+    impulse::ir::Function function;
+    function.name = "layout_phi";
+
+    impulse::ir::BasicBlock entry;
+    entry.label = "entry";
+    entry.instructions.push_back({impulse::ir::InstructionKind::Literal, {"1"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::BranchIf, {"then", "0"}});
+    entry.instructions.push_back({impulse::ir::InstructionKind::Branch, {"else"}});
+    function.blocks.push_back(entry);
+
+    impulse::ir::BasicBlock thenBlock;
+    thenBlock.label = "then";
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Literal, {"10"}});
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Store, {"x"}});
+    thenBlock.instructions.push_back({impulse::ir::InstructionKind::Branch, {"merge"}});
+    function.blocks.push_back(thenBlock);
+
+    impulse::ir::BasicBlock elseBlock;
+    elseBlock.label = "else";
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Literal, {"20"}});
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Store, {"x"}});
+    elseBlock.instructions.push_back({impulse::ir::InstructionKind::Branch, {"merge"}});
+    function.blocks.push_back(elseBlock);
+
+    impulse::ir::BasicBlock merge;
+    merge.label = "merge";
+    merge.instructions.push_back({impulse::ir::InstructionKind::Reference, {"x"}});
+    merge.instructions.push_back({impulse::ir::InstructionKind::Return, {}});
+    function.blocks.push_back(merge);
+
+    const auto cfg = impulse::ir::build_control_flow_graph(function);
+    const auto ssa = impulse::ir::build_ssa(function, cfg);
+    const auto layout = impulse::runtime::build_frame_layout(ssa);
+    ASSERT_EQ(layout.blocks.size(), ssa.blocks.size());
+
+    // Every value gets its own slot and slots are dense
+    std::vector<bool> seen(layout.slots.size(), false);
+    for (const auto& block : ssa.blocks) {
+        for (const auto& inst : block.instructions) {
+            if (!inst.result.has_value()) {
+                continue;
+            }
+            const auto slot = layout.slot_of(*inst.result);
+            ASSERT_LT(slot, layout.slots.size());
+            EXPECT_FALSE(seen[slot]);
+            seen[slot] = true;
+            EXPECT_EQ(layout.slots[slot].value.symbol, inst.result->symbol);
+            EXPECT_EQ(layout.slots[slot].value.version, inst.result->version);
+        }
+    }
+
+    const auto* mergeBlock = ssa.find_block("merge");
+    ASSERT_NE(mergeBlock, nullptr);
+    ASSERT_EQ(mergeBlock->phi_nodes.size(), 1);
+    const auto& phi = layout.blocks[mergeBlock->id].phis.front();
+    EXPECT_EQ(phi.result, layout.slot_of(mergeBlock->phi_nodes.front().result));
+    ASSERT_EQ(phi.inputs.size(), 2);
+    for (const auto& [pred, slot] : phi.inputs) {
+        ASSERT_LT(slot, layout.slots.size());
+        EXPECT_EQ(layout.slots[slot].name, "x");
+    }
+
+    const auto code = impulse::runtime::compile_bytecode(ssa, layout, {});
+    ASSERT_EQ(code.block_start.size(), ssa.blocks.size());
+    ASSERT_EQ(code.sources.size(), code.code.size());
+    using impulse::runtime::BytecodeOp;
+
+    // Both arms jump straight to the merge block by index
+    for (const auto& [pred, slot] : phi.inputs) {
+        const auto end = pred + 1 < code.block_start.size() ? code.block_start[pred + 1] : code.code.size();
+        bool jumps = false;
+        for (auto pc = code.block_start[pred]; pc < end; ++pc) {
+            if (code.code[pc].op == BytecodeOp::Jump) {
+                EXPECT_EQ(code.code[pc].a, mergeBlock->id);
+                jumps = true;
+            }
+        }
+        EXPECT_TRUE(jumps);
+    }
+
+    const auto* thenSsa = ssa.find_block("then");
+    ASSERT_NE(thenSsa, nullptr);
+    const auto& entryCode = code.code[code.block_start[0]];
+    EXPECT_EQ(entryCode.op, BytecodeOp::LoadNumber);
+    EXPECT_EQ(code.constants[entryCode.a], 1.0);
+    const auto& branch = code.code[code.block_start[0] + 1];
+    ASSERT_EQ(branch.op, BytecodeOp::JumpIf);
+    EXPECT_EQ(branch.b, thenSsa->id);
+    EXPECT_NE(branch.c, thenSsa->id);
+    EXPECT_LT(branch.c, ssa.blocks.size());
+    EXPECT_EQ(code.constants[branch.dst], 0.0);
+}
+
+TEST(RuntimeTest, BytecodeResolvesBuiltinsOnce) {
+    const std::string source = R"(module demo;
+
+func helper(x: float) -> float {
+    return x;
+}
+
+func main() -> float {
+    return sqrt(16.0) + pow(2.0, 3.0) + helper(1.0) + pow(1.0, 5.0);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    const auto& main = lowered.functions.back();
+    const auto ssa = impulse::ir::build_ssa(main);
+    const auto layout = impulse::runtime::build_frame_layout(ssa, main.parameters);
+    const auto code = impulse::runtime::compile_bytecode(ssa, layout, lowered.functions);
+
+    // Each builtin callee carries its handler's index; module functions carry none
+    ASSERT_EQ(code.callees.size(), 3U);
+    std::unordered_set<std::uint32_t> builtins;
+    for (const auto& callee : code.callees) {
+        if (callee.name == "helper") {
+            EXPECT_EQ(callee.builtin, impulse::runtime::BytecodeCallee::kNoBuiltin);
+            EXPECT_EQ(callee.function, 0U);
+            continue;
+        }
+        EXPECT_EQ(callee.builtin, impulse::runtime::SsaInterpreter::find_builtin(callee.name)) << callee.name;
+        builtins.insert(callee.builtin);
+    }
+    EXPECT_EQ(builtins.size(), 2U);
+    EXPECT_EQ(impulse::runtime::SsaInterpreter::find_builtin("helper"), impulse::runtime::BytecodeCallee::kNoBuiltin);
+    // An alias has an entry of its own, which reports errors under its name
+    const auto alias = impulse::runtime::SsaInterpreter::find_builtin("std::math::pow");
+    EXPECT_NE(alias, impulse::runtime::BytecodeCallee::kNoBuiltin);
+    EXPECT_NE(alias, impulse::runtime::SsaInterpreter::find_builtin("pow"));
+
+    impulse::runtime::Vm vm;
+    vm.set_jit_enabled(false);
+    ASSERT_TRUE(vm.load(lowered).success);
+    const auto result = vm.run("demo", "main");
+    ASSERT_EQ(result.status, impulse::runtime::VmStatus::Success) << result.message;
+    EXPECT_DOUBLE_EQ(result.value, 4.0 + 8.0 + 1.0 + 1.0);
+}
+
+TEST(RuntimeTest, SafepointsReportOnlyLiveRegisters) {
+    const std::string source = R"(module demo;
+
+func main() -> int {
+    let big: array = array(1000);
+    array_set(big, 0, 7);
+    let first: int = array_get(big, 0);
+    let small: array = array(1);
+    array_set(small, 0, first);
+    return array_get(small, 0);
+}
+)";
+
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+    ASSERT_EQ(lowered.functions.size(), 1U);
+    const auto& function = lowered.functions.front();
+    const auto ssa = impulse::ir::build_ssa(function);
+    const auto layout = impulse::runtime::build_frame_layout(ssa, function.parameters);
+    const auto code = impulse::runtime::compile_bytecode(ssa, layout, lowered.functions);
+    ASSERT_EQ(code.safepoints.size(), code.code.size());
+    ASSERT_EQ(code.block_live.size(), ssa.blocks.size());
+
+    std::vector<std::size_t> allocations;
+    for (std::size_t pc = 0; pc < code.code.size(); ++pc) {
+        if (code.code[pc].op == impulse::runtime::BytecodeOp::ArrayMake) {
+            allocations.push_back(pc);
+        }
+    }
+    ASSERT_EQ(allocations.size(), 2U);
+    const auto live = [&](std::size_t pc) {
+        const auto range = code.safepoints[pc];
+        return std::vector<std::uint32_t>(code.live_slots.begin() + range.begin, code.live_slots.begin() + range.end);
+    };
+    const std::uint32_t big = code.code[allocations[0]].dst;
+    const std::uint32_t small = code.code[allocations[1]].dst;
+    const auto first = live(allocations[0]);
+    EXPECT_NE(std::find(first.begin(), first.end(), big), first.end());
+    // `big` is dead once `small` is allocated, so a collection there may free it
+    const auto second = live(allocations[1]);
+    EXPECT_EQ(std::find(second.begin(), second.end(), big), second.end());
+    EXPECT_NE(std::find(second.begin(), second.end(), small), second.end());
+}
+
+TEST(RuntimeTest, BinaryTraceDecodesToTheTextTrace) {
+    const std::string source = R"(module demo;
+
+func describe(values: array, count: int) -> int {
+    let total: int = 0;
+    let i: int = 0;
+    while i < count {
+        total = total + array_get(values, i);
+        i = i + 1;
+    }
+    println("total \"" + "of\t" + "values\"");
+    return total / (count - 2);
+}
+
+func main() -> int {
+    let values: array = array(0);
+    array_push(values, 2);
+    array_push(values, 4);
+    array_push(values, 6);
+    return describe(values, 3) + describe(values, 2);
+}
+)";
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    // Both traces of one run: the second call fails, so the exits report a status and a message
+    impulse::runtime::Vm vm;
+    std::ostringstream text;
+    std::ostringstream binary;
+    impulse::runtime::TraceWriter writer(binary);
+    vm.set_trace_stream(&text);
+    vm.set_trace_writer(&writer);
+    ASSERT_TRUE(vm.load(lowered).success);
+    EXPECT_EQ(vm.run("demo", "main").status, impulse::runtime::VmStatus::RuntimeError);
+    writer.flush();
+    ASSERT_NE(text.str().find("status="), std::string::npos);
+    ASSERT_NE(text.str().find("builtin println"), std::string::npos);
+
+    std::istringstream in(binary.str());
+    std::ostringstream decoded;
+    ASSERT_TRUE(impulse::runtime::decode_trace(in, decoded));
+    EXPECT_EQ(decoded.str(), text.str());
+
+    // A ring of two small segments keeps the tail of the trace and says how much it dropped
+    impulse::runtime::Vm ringed;
+    std::ostringstream ring;
+    impulse::runtime::TraceWriter::Options options;
+    options.segment_bytes = 24 * 16;
+    options.ring_segments = 2;
+    impulse::runtime::TraceWriter recorder(ring, options);
+    ringed.set_trace_writer(&recorder);
+    ASSERT_TRUE(ringed.load(lowered).success);
+    EXPECT_EQ(ringed.run("demo", "main").status, impulse::runtime::VmStatus::RuntimeError);
+    recorder.flush();
+    EXPECT_GT(recorder.dropped_records(), 0U);
+
+    std::istringstream ring_in(ring.str());
+    std::ostringstream tail;
+    ASSERT_TRUE(impulse::runtime::decode_trace(ring_in, tail));
+    const std::string dropped = "... " + std::to_string(recorder.dropped_records()) + " earlier records dropped\n";
+    ASSERT_EQ(tail.str().rfind(dropped, 0), 0U);
+    const std::string kept = tail.str().substr(dropped.size());
+    ASSERT_GE(text.str().size(), kept.size());
+    EXPECT_EQ(text.str().substr(text.str().size() - kept.size()), kept);
+
+    // Not a trace, or one cut off in the middle of a record
+    std::istringstream garbage("not a trace");
+    std::ostringstream ignored;
+    EXPECT_FALSE(impulse::runtime::decode_trace(garbage, ignored));
+    std::istringstream cut(binary.str().substr(0, binary.str().size() - 5));
+    EXPECT_FALSE(impulse::runtime::decode_trace(cut, ignored));
+
+    // Corrupt lengths and ids fail instead of allocating what they claim. The first record (after
+    // the 16-byte header) names a function; its name follows in records of its own
+    using Record = impulse::runtime::TraceWriter::Record;
+    Record first;
+    std::memcpy(&first, binary.str().data() + 16, sizeof(first));
+    const std::size_t block_name = 1 + (first.payload + sizeof(Record) - 1) / sizeof(Record);
+    ASSERT_EQ(binary.str()[16 + block_name * sizeof(Record)], 2);  // BlockName
+    const auto corrupted = [&](std::size_t record, std::size_t offset, auto value) {
+        std::string bytes = binary.str();
+        std::memcpy(bytes.data() + 16 + record * sizeof(Record) + offset, &value, sizeof(value));
+        std::istringstream in(bytes);
+        return impulse::runtime::decode_trace(in, ignored);
+    };
+    EXPECT_FALSE(corrupted(0, offsetof(Record, payload), std::uint64_t{1} << 62U));
+    EXPECT_FALSE(corrupted(0, offsetof(Record, payload), ~std::uint64_t{0}));
+    EXPECT_FALSE(corrupted(block_name, offsetof(Record, b), std::uint32_t{0x40000000}));
+    // A flipped high bit anywhere decodes or fails, but never throws
+    for (std::size_t record = 0; record < (binary.str().size() - 16) / sizeof(Record); ++record) {
+        for (const std::size_t offset : {offsetof(Record, a), offsetof(Record, b), offsetof(Record, c)}) {
+            EXPECT_NO_THROW((void)corrupted(record, offset + 3, std::uint8_t{0x40})) << record;
+        }
+        EXPECT_NO_THROW((void)corrupted(record, offsetof(Record, payload) + 7, std::uint8_t{0x40})) << record;
+    }
+}
+
+TEST(RuntimeTest, ParallelMapsRunPureCalleesOnThePool) {
+    const std::string source = R"(module demo;
+
+func collatz(n: int) -> int {
+    let steps: int = 0;
+    while n > 1 {
+        if n % 2 == 0 {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        steps = steps + 1;
+    }
+    return steps;
+}
+
+func checked(n: int) -> int {
+    return (n - 3000) % 7;
+}
+
+let offset: int = 1;
+
+func shifted(n: int) -> int {
+    return print(n) + offset;
+}
+
+func steps() -> int {
+    let counts: array = parallel_for(1, 5001, "collatz");
+    let again: array = array_map_parallel(counts, "collatz");
+    return array_sum(counts) * 1000 + array_sum(again);
+}
+
+func failing() -> int {
+    let values: array = parallel_for(0, 5000, "checked");
+    return array_length(values);
+}
+
+func impure() -> int {
+    let values: array = parallel_for(0, 3, "shifted");
+    return array_length(values);
+}
+)";
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    // The interpreter makes the calls one at a time; the JIT spreads them over four threads
+    impulse::runtime::Vm sequential;
+    sequential.set_jit_enabled(false);
+    ASSERT_TRUE(sequential.load(lowered).success);
+    const auto expected = sequential.run("demo", "steps");
+    ASSERT_EQ(expected.status, impulse::runtime::VmStatus::Success) << expected.message;
+    EXPECT_EQ(sequential.metrics().parallel_elements, 0U);
+
+    impulse::runtime::Vm parallel;
+    parallel.set_parallel_threads(4);
+    ASSERT_TRUE(parallel.load(lowered).success);
+    const auto actual = parallel.run("demo", "steps");
+    ASSERT_EQ(actual.status, impulse::runtime::VmStatus::Success) << actual.message;
+    EXPECT_DOUBLE_EQ(actual.value, expected.value);
+    EXPECT_EQ(parallel.metrics().parallel_elements, 10000U);
+
+    // The first failing element is reported, as a loop would report it
+    const auto sequential_failure = sequential.run("demo", "failing");
+    const auto parallel_failure = parallel.run("demo", "failing");
+    EXPECT_EQ(sequential_failure.status, impulse::runtime::VmStatus::RuntimeError);
+    EXPECT_EQ(parallel_failure.status, sequential_failure.status);
+    EXPECT_EQ(parallel_failure.message, sequential_failure.message);
+
+    // Callees that print, or read bindings that may change, are turned down
+    const auto rejected = parallel.run("demo", "impure");
+    EXPECT_EQ(rejected.status, impulse::runtime::VmStatus::RuntimeError);
+    EXPECT_EQ(rejected.message, "parallel_for requires a pure function, and 'shifted' is not");
+}
+
+TEST(RuntimeTest, ServeAnswersRequestsAndRefusesMalformedOnes) {
+    const std::string source = R"(module demo;
+
+func greet() -> int {
+    let name: string = read_line();
+    println("hi " + name);
+    return 3;
+}
+
+func fail() -> int {
+    let a: array = array(1);
+    return array_get(a, 5);
+}
+)";
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    impulse::runtime::Vm vm;
+    ASSERT_TRUE(vm.load(impulse::frontend::lower_to_ir(parseResult.module)).success);
+
+    const auto serve = [&](const std::string& requests, std::string& out, std::string& errors) {
+        std::istringstream in(requests);
+        std::ostringstream replies;
+        std::ostringstream diagnostics;
+        const int status = impulse::runtime::serve_requests(vm, "demo", in, replies, diagnostics);
+        out = replies.str();
+        errors = diagnostics.str();
+        return status;
+    };
+
+    std::string out;
+    std::string errors;
+    const auto failure = vm.run("demo", "fail");
+    ASSERT_EQ(failure.status, impulse::runtime::VmStatus::RuntimeError);
+    EXPECT_EQ(serve("run greet 4\nAda\nrun fail 0\nrun greet 0\n", out, errors), 0);
+    EXPECT_EQ(out, "exit 3 7\nhi Ada\nerror " + std::to_string(failure.message.size()) + "\n" + failure.message +
+                       "exit 3 4\nhi \n");
+    EXPECT_EQ(errors, "");
+
+    // Lengths that are negative, signed, too large to allocate or not numbers end the loop
+    for (const std::string header : {"run greet -1", "run greet +4", "run greet 99999999999999999999",
+                                     "run greet 2147483648", "run greet four", "run greet", "walk greet 0"}) {
+        EXPECT_EQ(serve("run greet 0\n" + header + "\nrun greet 0\n", out, errors), 2) << header;
+        EXPECT_EQ(out, "exit 3 4\nhi \n") << header;
+        EXPECT_EQ(errors, "Malformed request: " + header + "\n");
+    }
+
+    // A length past the end of the stream is read up to what is there, then refused
+    EXPECT_EQ(serve("run greet 100\nAda\n", out, errors), 2);
+    EXPECT_EQ(out, "");
+    EXPECT_EQ(errors, "Request input ended after 4 of 100 bytes\n");
+}
+
+TEST(RuntimeTest, ParallelMapsTrapDivisionByZeroInCompiledCode) {
+    const std::string source = R"(module demo;
+
+func d(x: int) -> int {
+    return 12 / x;
+}
+
+func sums() -> int {
+    let values: array = parallel_for(1, 4, "d");
+    return array_sum(values);
+}
+
+func zero() -> int {
+    let values: array = parallel_for(0, 3, "d");
+    return array_length(values);
+}
+)";
+    impulse::frontend::Parser parser(source);
+    impulse::frontend::ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+    const auto lowered = impulse::frontend::lower_to_ir(parseResult.module);
+
+    for (const bool jit : {true, false}) {
+        impulse::runtime::Vm vm;
+        vm.set_jit_enabled(jit);
+        vm.set_parallel_threads(2);
+        ASSERT_TRUE(vm.load(lowered).success);
+        const auto sums = vm.run("demo", "sums");
+        ASSERT_EQ(sums.status, impulse::runtime::VmStatus::Success) << sums.message;
+        EXPECT_DOUBLE_EQ(sums.value, 22.0);
+        const auto zero = vm.run("demo", "zero");
+        EXPECT_EQ(zero.status, impulse::runtime::VmStatus::RuntimeError) << "jit=" << jit;
+        EXPECT_EQ(zero.message, "division by zero during execution") << "jit=" << jit;
+        // Under the JIT both batches ran d's compiled code
+        EXPECT_EQ(vm.metrics().parallel_elements, jit ? 6U : 0U);
+    }
+}
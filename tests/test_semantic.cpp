@@ -191,6 +191,72 @@ struct int {
     EXPECT_TRUE(foundConflict) << "Expected diagnostic for struct name clashing with primitive type";
 }
 
+TEST(SemanticTest, StructConstructionAndFieldAccess) {
+    const std::string source = R"(module demo;
+struct Vec2 {
+    x: float;
+    y: float;
+}
+struct Particle {
+    position: Vec2;
+    mass: float;
+}
+func kinetic(p: Particle) -> float {
+    p.position.x = p.position.x + 1.0;
+    return p.mass * p.position.x;
+}
+func main() -> float {
+    let p: Particle = Particle(Vec2(1.0, 2.0), 3.0);
+    return kinetic(p);
+}
+)";
+
+    Parser parser(source);
+    ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto semantic = impulse::frontend::analyzeModule(parseResult.module);
+    EXPECT_TRUE(semantic.success) << (semantic.diagnostics.empty() ? "" : semantic.diagnostics[0].message);
+}
+
+TEST(SemanticTest, StructFieldDiagnostics) {
+    const std::string source = R"(module demo;
+struct Vec2 {
+    x: float;
+    y: float;
+}
+func main() -> float {
+    let v: Vec2 = Vec2(1.0);
+    let w: Vec2 = Vec2(1.0, "two");
+    let n: float = 4.0;
+    v.z = 1.0;
+    v.x = "one";
+    return n.x;
+}
+)";
+
+    Parser parser(source);
+    ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto semantic = impulse::frontend::analyzeModule(parseResult.module);
+    EXPECT_FALSE(semantic.success);
+
+    const auto reported = [&](const std::string& text) {
+        for (const auto& diag : semantic.diagnostics) {
+            if (diag.message.find(text) != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+    EXPECT_TRUE(reported("Struct 'Vec2' has 2 field(s) but received 1 argument(s)"));
+    EXPECT_TRUE(reported("Cannot convert argument of type 'string' to field 'y'"));
+    EXPECT_TRUE(reported("Struct 'Vec2' has no field 'z'"));
+    EXPECT_TRUE(reported("Cannot assign expression of type 'string' to field 'x'"));
+    EXPECT_TRUE(reported("Field access requires a struct value but got 'float'"));
+}
+
 TEST(SemanticTest, InterfaceTypeConflicts) {
     const std::string source = R"(module demo;
 struct Display {
@@ -516,3 +582,36 @@ func main() -> int {
     }
     EXPECT_TRUE(foundDiagnostic) << "Expected diagnostic for missing return statement";
 }
+
+TEST(SemanticTest, ParallelBuiltinsNameOneArgumentFunctions) {
+    const std::string source = R"(module demo;
+func square(x: int) -> int {
+    return x * x;
+}
+func add(a: int, b: int) -> int {
+    return a + b;
+}
+func main() -> int {
+    let squares: array = parallel_for(0, 10, "square");
+    let again: array = array_map_parallel(squares, "square");
+    let sums: array = array_map_parallel(again, "add");
+    let missing: array = parallel_for(0, "ten", "cube");
+    return array_length(sums) + array_length(missing);
+}
+)";
+
+    Parser parser(source);
+    ParseResult parseResult = parser.parseModule();
+    ASSERT_TRUE(parseResult.success);
+
+    const auto semantic = impulse::frontend::analyzeModule(parseResult.module);
+    EXPECT_FALSE(semantic.success);
+    std::vector<std::string> messages;
+    for (const auto& diag : semantic.diagnostics) {
+        messages.push_back(diag.message);
+    }
+    ASSERT_EQ(messages.size(), 3U);
+    EXPECT_EQ(messages[0], "array_map_parallel: 'add' must take exactly one argument");
+    EXPECT_EQ(messages[1], "parallel_for expects numeric bounds but got 'string'");
+    EXPECT_EQ(messages[2], "parallel_for: unknown function 'cube'");
+}
@@ -0,0 +1,423 @@
+// impulse-bench: runs every benchmarks/*.impulse program under each tier configuration, with
+// warmup and repetitions, and reports the spread of each phase as a table and as JSON.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "impulse/frontend/lowering.h"
+#include "impulse/frontend/parser.h"
+#include "impulse/frontend/semantic.h"
+#include "impulse/runtime/output_sink.h"
+#include "impulse/runtime/runtime.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A tier configuration to run every benchmark under
+struct Mode {
+    std::string name;
+    std::string description;
+    std::function<void(impulse::runtime::Vm&)> configure;
+};
+
+[[nodiscard]] auto allModes() -> std::vector<Mode> {
+    using impulse::runtime::TierThresholds;
+    using impulse::runtime::Vm;
+    return {
+        {"interpreter", "SSA interpreter only", [](Vm& vm) { vm.set_jit_enabled(false); }},
+        {"jit", "default tiering", [](Vm& /*vm*/) {}},
+        {"jit-eager", "compile on first call and first back-edge",
+         [](Vm& vm) { vm.set_tier_thresholds(TierThresholds{1, 1, TierThresholds{}.deopts}); }},
+        {"jit-no-osr", "tier up by calls only, no on-stack replacement",
+         [](Vm& vm) {
+             TierThresholds thresholds;
+             thresholds.back_edges = std::numeric_limits<std::uint64_t>::max();
+             vm.set_tier_thresholds(thresholds);
+         }},
+        {"jit-background", "compile on a background thread", [](Vm& vm) { vm.set_background_compilation(true); }},
+        {"jit-preload", "build and compile everything at load", [](Vm& vm) { vm.set_eager_loading(1); }},
+    };
+}
+
+// Phases of one run, in the order they happen
+constexpr const char* kPhases[] = {"parse", "semantic", "lower", "ssa", "compile", "execute", "total"};
+constexpr std::size_t kPhaseCount = sizeof(kPhases) / sizeof(kPhases[0]);
+
+struct Sample {
+    std::chrono::nanoseconds phases[kPhaseCount]{};
+};
+
+struct Summary {
+    double median = 0;
+    double p95 = 0;
+    double mean = 0;
+    double stddev = 0;
+    double min = 0;
+    double max = 0;
+};
+
+struct Result {
+    std::string benchmark;
+    std::string mode;
+    std::optional<double> value;  // what main returned, on success
+    std::string error;
+    std::vector<Sample> samples;
+};
+
+struct Options {
+    std::filesystem::path benchmarks = std::filesystem::path{IMPULSE_SOURCE_DIR} / "benchmarks";
+    std::vector<std::string> filters;
+    std::vector<std::string> modes;
+    std::size_t warmup = 1;
+    std::size_t repetitions = 5;
+    std::string input;  // every program's standard input, e.g. the size of a *_scaled benchmark
+    std::optional<std::string> out;
+};
+
+void printUsage(const std::vector<Mode>& modes) {
+    std::cout << "Usage: impulse-bench [options]\n"
+                 "\n"
+                 "  --benchmarks <dir>        Directory of *.impulse programs (default: the source tree's benchmarks/)\n"
+                 "  --filter <name>           Only benchmarks whose file name contains name (repeatable)\n"
+                 "  --modes <list>            Comma-separated tier configurations (default: all)\n"
+                 "  --warmup <n>              Untimed runs before measuring (default 1)\n"
+                 "  --repetitions <n>         Timed runs (default 5)\n"
+                 "  --input <text>            Standard input of every program (sizes the *_scaled benchmarks)\n"
+                 "  --out <path>              Write the results as JSON\n"
+                 "\n"
+                 "Modes:\n";
+    for (const auto& mode : modes) {
+        std::cout << "  " << std::left << std::setw(26) << mode.name << mode.description << '\n';
+    }
+}
+
+[[nodiscard]] auto parseCount(const std::string& arg, const char* value, std::size_t& out) -> bool {
+    const std::string text{value};
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        std::cerr << "Invalid value for " << arg << ": " << text << '\n';
+        return false;
+    }
+    out = static_cast<std::size_t>(std::stoull(text));
+    return true;
+}
+
+[[nodiscard]] auto parseArgs(int argc, char** argv, const std::vector<Mode>& modes) -> std::optional<Options> {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h") {
+            printUsage(modes);
+            return std::nullopt;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << (arg.rfind("--", 0) == 0 ? "Missing value for " : "Unknown argument: ") << arg << '\n';
+            return std::nullopt;
+        }
+        const char* value = argv[++i];
+        if (arg == "--benchmarks") {
+            opts.benchmarks = value;
+        } else if (arg == "--filter") {
+            opts.filters.emplace_back(value);
+        } else if (arg == "--modes") {
+            std::stringstream names{value};
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (std::none_of(modes.begin(), modes.end(), [&](const Mode& mode) { return mode.name == name; })) {
+                    std::cerr << "Unknown mode: " << name << '\n';
+                    return std::nullopt;
+                }
+                opts.modes.push_back(name);
+            }
+        } else if (arg == "--warmup") {
+            if (!parseCount(arg, value, opts.warmup)) {
+                return std::nullopt;
+            }
+        } else if (arg == "--repetitions") {
+            if (!parseCount(arg, value, opts.repetitions) || opts.repetitions == 0) {
+                return std::nullopt;
+            }
+        } else if (arg == "--input") {
+            opts.input = value;
+        } else if (arg == "--out") {
+            opts.out = value;
+        } else {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return std::nullopt;
+        }
+    }
+    return opts;
+}
+
+[[nodiscard]] auto joinModulePath(const std::vector<std::string>& path) -> std::string {
+    std::string name;
+    for (const auto& part : path) {
+        name += (name.empty() ? "" : "::") + part;
+    }
+    return name;
+}
+
+// One run from source to exit, timing each phase. SSA is only built at load for jit-preload;
+// elsewhere it is part of execution. Compilation is whatever the VM measured (Vm::metrics), at
+// load or during the run, and is taken out of the phase it happened in.
+[[nodiscard]] auto runOnce(const std::string& source, const std::string& input, const Mode& mode, Sample& sample,
+                           std::string& error) -> std::optional<double> {
+    const auto begin = Clock::now();
+    auto last = begin;
+    const auto lap = [&](std::size_t phase) {
+        const auto now = Clock::now();
+        sample.phases[phase] = now - last;
+        last = now;
+    };
+
+    impulse::frontend::Parser parser(source);
+    auto parsed = parser.parseModule();
+    lap(0);
+    if (!parsed.success) {
+        error = "parse failed";
+        return std::nullopt;
+    }
+    const auto semantic = impulse::frontend::analyzeModule(parsed.module);
+    lap(1);
+    if (!semantic.success) {
+        error = "semantic analysis failed";
+        return std::nullopt;
+    }
+    auto lowered = impulse::frontend::lower_to_ir(parsed.module);
+    lap(2);
+
+    impulse::runtime::Vm vm;
+    mode.configure(vm);
+    impulse::runtime::OutputSink discard([](std::string_view /*text*/) {});
+    vm.set_output_sink(&discard);
+    std::istringstream stdin_text(input);
+    vm.set_input_stream(&stdin_text);
+    const std::string module_name = joinModulePath(lowered.path);
+    if (!vm.load(std::move(lowered)).success) {
+        error = "load failed";
+        return std::nullopt;
+    }
+    const auto compiled_at_load = vm.metrics().jit_compile_time;
+    lap(3);
+    const auto result = vm.run(module_name, "main");
+    lap(5);
+    vm.set_output_sink(nullptr);
+    vm.set_input_stream(nullptr);
+
+    const auto compile_time = vm.metrics().jit_compile_time;  // at load and during the run
+    sample.phases[3] -= std::min(compiled_at_load, sample.phases[3]);
+    sample.phases[4] = compile_time;
+    if (mode.name != "jit-background") {  // background compilation overlaps execution
+        sample.phases[5] -= std::min(compile_time - compiled_at_load, sample.phases[5]);
+    }
+    sample.phases[6] = Clock::now() - begin;
+
+    if (result.status != impulse::runtime::VmStatus::Success || !result.has_value) {
+        error = result.message.empty() ? "run failed" : result.message;
+        return std::nullopt;
+    }
+    return result.value;
+}
+
+[[nodiscard]] auto summarize(std::vector<double> values) -> Summary {
+    Summary summary;
+    if (values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    const std::size_t n = values.size();
+    summary.median = n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    // Nearest rank
+    summary.p95 = values[static_cast<std::size_t>(std::ceil(0.95 * static_cast<double>(n))) - 1];
+    summary.min = values.front();
+    summary.max = values.back();
+    double sum = 0;
+    for (const double value : values) {
+        sum += value;
+    }
+    summary.mean = sum / static_cast<double>(n);
+    double squares = 0;
+    for (const double value : values) {
+        squares += (value - summary.mean) * (value - summary.mean);
+    }
+    summary.stddev = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0.0;
+    return summary;
+}
+
+[[nodiscard]] auto phaseValues(const Result& result, std::size_t phase) -> std::vector<double> {
+    std::vector<double> values;
+    for (const auto& sample : result.samples) {
+        values.push_back(static_cast<double>(sample.phases[phase].count()));
+    }
+    return values;
+}
+
+void writeJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void writeSummary(std::ostream& out, const Summary& summary) {
+    out << std::fixed << std::setprecision(0) << "{\"median\": " << summary.median << ", \"p95\": " << summary.p95
+        << ", \"mean\": " << summary.mean << ", \"stddev\": " << summary.stddev << ", \"min\": " << summary.min
+        << ", \"max\": " << summary.max << '}';
+}
+
+// Times are nanoseconds
+void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+    out << "{\n  \"warmup\": " << options.warmup << ",\n  \"repetitions\": " << options.repetitions
+        << ",\n  \"input\": ";
+    writeJsonString(out, options.input);
+    out << ",\n  \"timestamp\": " << std::time(nullptr) << ",\n  \"unit\": \"ns\",\n  \"results\": [";
+    for (std::size_t r = 0; r < results.size(); ++r) {
+        const Result& result = results[r];
+        out << (r == 0 ? "\n" : ",\n") << "    {\"benchmark\": ";
+        writeJsonString(out, result.benchmark);
+        out << ", \"mode\": ";
+        writeJsonString(out, result.mode);
+        if (result.value.has_value()) {
+            out << ", \"value\": " << std::setprecision(17) << std::defaultfloat << *result.value;
+        } else {
+            out << ", \"error\": ";
+            writeJsonString(out, result.error);
+        }
+        out << ",\n     \"phases\": {";
+        for (std::size_t phase = 0; phase < kPhaseCount; ++phase) {
+            out << (phase == 0 ? "" : ",") << "\n       \"" << kPhases[phase] << "\": ";
+            writeSummary(out, summarize(phaseValues(result, phase)));
+        }
+        out << "},\n     \"samples\": [";
+        for (std::size_t i = 0; i < result.samples.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << result.samples[i].phases[kPhaseCount - 1].count();
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void printRow(const Result& result) {
+    const auto milliseconds = [](double ns) { return ns / 1e6; };
+    const Summary total = summarize(phaseValues(result, kPhaseCount - 1));
+    const Summary execute = summarize(phaseValues(result, 5));
+    const Summary compile = summarize(phaseValues(result, 4));
+    std::cout << std::left << std::setw(18) << result.benchmark << std::setw(16) << result.mode << std::right
+              << std::fixed << std::setprecision(3);
+    if (!result.value.has_value()) {
+        std::cout << "  error: " << result.error << '\n';
+        return;
+    }
+    std::cout << std::setw(12) << milliseconds(total.median) << std::setw(12) << milliseconds(total.p95)
+              << std::setw(12) << milliseconds(total.stddev) << std::setw(12) << milliseconds(compile.median)
+              << std::setw(12) << milliseconds(execute.median) << '\n';
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+    const std::vector<Mode> modes = allModes();
+    auto options = parseArgs(argc, argv, modes);
+    if (!options.has_value()) {
+        return argc > 1 && (std::string_view{argv[1]} == "--help" || std::string_view{argv[1]} == "-h") ? 0 : 2;
+    }
+
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(options->benchmarks, error)) {
+        const auto name = entry.path().filename().string();
+        if (entry.path().extension() != ".impulse") {
+            continue;
+        }
+        if (!options->filters.empty() &&
+            std::none_of(options->filters.begin(), options->filters.end(),
+                         [&](const std::string& filter) { return name.find(filter) != std::string::npos; })) {
+            continue;
+        }
+        files.push_back(entry.path());
+    }
+    if (error || files.empty()) {
+        std::cerr << "No benchmarks found in '" << options->benchmarks.string() << "'\n";
+        return 2;
+    }
+    std::sort(files.begin(), files.end());
+
+    std::cout << std::left << std::setw(18) << "benchmark" << std::setw(16) << "mode" << std::right << std::setw(12)
+              << "median ms" << std::setw(12) << "p95 ms" << std::setw(12) << "stddev ms" << std::setw(12)
+              << "compile ms" << std::setw(12) << "execute ms" << '\n';
+    std::vector<Result> results;
+    bool mismatch = false;
+    for (const auto& file : files) {
+        std::ifstream stream(file);
+        std::ostringstream buffer;
+        buffer << stream.rdbuf();
+        const std::string source = buffer.str();
+
+        std::optional<double> expected;
+        for (const Mode& mode : modes) {
+            if (!options->modes.empty() &&
+                std::find(options->modes.begin(), options->modes.end(), mode.name) == options->modes.end()) {
+                continue;
+            }
+            Result result;
+            result.benchmark = file.stem().string();
+            result.mode = mode.name;
+            for (std::size_t run = 0; run < options->warmup + options->repetitions; ++run) {
+                Sample sample;
+                result.value = runOnce(source, options->input, mode, sample, result.error);
+                if (!result.value.has_value()) {
+                    break;
+                }
+                if (run >= options->warmup) {
+                    result.samples.push_back(sample);
+                }
+            }
+            // Every configuration has to compute the same thing
+            if (result.value.has_value()) {
+                if (expected.has_value() && *expected != *result.value) {
+                    std::cerr << result.benchmark << ": " << mode.name << " returned " << *result.value
+                              << ", expected " << *expected << '\n';
+                    mismatch = true;
+                }
+                expected = expected.value_or(*result.value);
+            }
+            printRow(result);
+            results.push_back(std::move(result));
+        }
+    }
+
+    if (options->out.has_value()) {
+        std::ofstream out(*options->out, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Failed to open '" << *options->out << "' for the results\n";
+            return 2;
+        }
+        writeJson(out, *options, results);
+    }
+    const bool failed = std::any_of(results.begin(), results.end(), [](const Result& result) { return !result.value; });
+    return failed || mismatch ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+// impulse-microbench: Google Benchmark cases for single runtime primitives, driving the
+// interpreter, the heap, SSA construction and the JIT directly rather than through the Vm, so a
+// regression can be pinned to the piece that slowed down. Sizes are the benchmark arguments.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "impulse/frontend/lowering.h"
+#include "impulse/frontend/parser.h"
+#include "impulse/ir/optimizer.h"
+#include "impulse/ir/ssa.h"
+#include "impulse/jit/jit.h"
+#include "impulse/runtime/bytecode.h"
+#include "impulse/runtime/frame_layout.h"
+#include "impulse/runtime/gc_heap.h"
+#include "impulse/runtime/ssa_interpreter.h"
+
+namespace {
+
+using impulse::runtime::GcHeap;
+using impulse::runtime::GcObject;
+using impulse::runtime::SsaInterpreter;
+using impulse::runtime::Value;
+using impulse::runtime::VmResult;
+using impulse::runtime::VmStatus;
+
+[[nodiscard]] auto lower(const std::string& source) -> impulse::ir::Module {
+    impulse::frontend::Parser parser(source);
+    auto parsed = parser.parseModule();
+    if (!parsed.success) {
+        throw std::runtime_error("benchmark program does not parse");
+    }
+    return impulse::frontend::lower_to_ir(parsed.module);
+}
+
+[[nodiscard]] auto find_function(const impulse::ir::Module& module, const std::string& name)
+    -> const impulse::ir::Function& {
+    for (const auto& function : module.functions) {
+        if (function.name == name) {
+            return function;
+        }
+    }
+    throw std::runtime_error("benchmark program has no function " + name);
+}
+
+// `statements` dependent arithmetic statements on x, which the optimizer cannot fold
+[[nodiscard]] auto straight_line_source(std::int64_t statements) -> std::string {
+    std::string source = "module bench;\n\nfunc chain(x: int) -> int {\n    let v0: int = x;\n";
+    for (std::int64_t i = 1; i <= statements; ++i) {
+        source += "    let v" + std::to_string(i) + ": int = v" + std::to_string(i - 1) + " * 3 + x - " +
+                  std::to_string(i % 7) + ";\n";
+    }
+    source += "    return v" + std::to_string(statements) + ";\n}\n";
+    return source;
+}
+
+// One function's SSA and the interpreter's view of it, as the Vm caches them
+struct InterpreterFixture {
+    impulse::ir::Module module;
+    impulse::ir::SsaFunction ssa;
+    impulse::runtime::SsaFrameLayout layout;
+    impulse::runtime::SsaBytecode code;
+    impulse::runtime::InterpreterFrame frame;
+    std::unordered_map<std::string, Value> globals;
+
+    InterpreterFixture(const std::string& source, const std::string& function) : module(lower(source)) {
+        const auto& definition = find_function(module, function);
+        ssa = impulse::ir::build_ssa(definition);
+        (void)impulse::ir::optimize_ssa(ssa);
+        layout = impulse::runtime::build_frame_layout(ssa, definition.parameters);
+        code = impulse::runtime::compile_bytecode(ssa, layout, module.functions);
+    }
+
+    [[nodiscard]] auto run(const std::vector<Value>& arguments, SsaInterpreter::CallFunction call,
+                           std::uint64_t* instructions = nullptr) -> VmResult {
+        SsaInterpreter interpreter(
+            ssa, layout, code, frame, arguments, module.functions, globals, std::move(call),
+            [](std::size_t) -> GcObject* { return nullptr; }, [](std::string) -> GcObject* { return nullptr; },
+            [] {}, nullptr, nullptr, [] { return std::nullopt; });
+        auto result = interpreter.run();
+        if (instructions != nullptr) {
+            *instructions += interpreter.instructions_executed();
+        }
+        return result;
+    }
+};
+
+// Interpreter side of a call (argument marshalling, the call instruction, storing the result);
+// the callee is a stub, so the Vm's own call path is not part of it
+void BM_InterpreterCall(benchmark::State& state) {
+    const std::string source = R"(module bench;
+
+func leaf(x: int) -> int {
+    return x + 1;
+}
+
+func caller(n: int) -> int {
+    let i: int = 0;
+    let sum: int = 0;
+    while i < n {
+        sum = sum + leaf(i);
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+    InterpreterFixture fixture(source, "caller");
+    const std::vector<Value> arguments{Value::make_number(static_cast<double>(state.range(0)))};
+    const auto leaf = [](std::size_t, const std::vector<Value>& args) {
+        return VmResult{VmStatus::Success, true, args.front().as_number() + 1.0, {}};
+    };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fixture.run(arguments, leaf));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));  // calls
+}
+BENCHMARK(BM_InterpreterCall)->Arg(1)->Arg(64)->Arg(4096);
+
+// Builtin calls: argument marshalling and the handler, with no string or heap work in it
+void BM_InterpreterBuiltinCall(benchmark::State& state) {
+    const std::string source = R"(module bench;
+
+func caller(n: int) -> float {
+    let i: int = 0;
+    let sum: float = 0.0;
+    while i < n {
+        sum = sum + abs(i - 3);
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+    InterpreterFixture fixture(source, "caller");
+    const std::vector<Value> arguments{Value::make_number(static_cast<double>(state.range(0)))};
+    const auto no_calls = [](std::size_t, const std::vector<Value>&) { return VmResult{}; };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fixture.run(arguments, no_calls));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));  // calls
+}
+BENCHMARK(BM_InterpreterBuiltinCall)->Arg(64)->Arg(4096);
+
+// Register file traffic: every instruction of the chain reads its operands (lookup_value) and
+// writes its result (store_value)
+void BM_InterpreterFrameAccess(benchmark::State& state) {
+    InterpreterFixture fixture(straight_line_source(state.range(0)), "chain");
+    const std::vector<Value> arguments{Value::make_number(2.0)};
+    const auto no_calls = [](std::size_t, const std::vector<Value>&) { return VmResult{}; };
+    std::uint64_t instructions = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fixture.run(arguments, no_calls, &instructions));
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(instructions));
+}
+BENCHMARK(BM_InterpreterFrameAccess)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_GcAllocateArray(benchmark::State& state) {
+    const auto length = static_cast<std::size_t>(state.range(0));
+    auto heap = std::make_unique<GcHeap>();
+    std::size_t allocated = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(heap->allocate_array(length));
+        // Nothing is rooted; start over before the heap outgrows the caches
+        if (++allocated == 4096) {
+            state.PauseTiming();
+            heap->collect({});
+            allocated = 0;
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GcAllocateArray)->Arg(0)->Arg(8)->Arg(64)->Arg(1024);
+
+// Full collection of a heap with `live` reachable arrays of 8 elements and as much garbage
+void BM_GcCollect(benchmark::State& state) {
+    const auto live = static_cast<std::size_t>(state.range(0));
+    GcHeap heap;
+    std::vector<Value> objects;
+    objects.reserve(live);
+    for (std::size_t i = 0; i < live; ++i) {
+        objects.push_back(Value::make_object(heap.allocate_array(8, Value::make_number(1.0))));
+    }
+    std::vector<Value*> roots;
+    roots.reserve(live);
+    for (auto& object : objects) {
+        roots.push_back(&object);
+    }
+    heap.collect(roots);  // promoted, as a long-running program's data would be
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < live; ++i) {
+            benchmark::DoNotOptimize(heap.allocate_array(8));
+        }
+        state.ResumeTiming();
+        heap.collect(roots);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(live));  // objects traced
+    state.counters["heap_bytes"] = static_cast<double>(heap.bytes_allocated());
+}
+BENCHMARK(BM_GcCollect)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17)->Unit(benchmark::kMicrosecond);
+
+void BM_BuildSsa(benchmark::State& state) {
+    const auto module = lower(straight_line_source(state.range(0)));
+    const auto& function = find_function(module, "chain");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(impulse::ir::build_ssa(function));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));  // statements
+}
+BENCHMARK(BM_BuildSsa)->Arg(16)->Arg(256)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+// Functions compiled per second, register allocation and code emission included
+void BM_JitCompile(benchmark::State& state) {
+    if (!impulse::jit::JitCompiler::is_supported()) {
+        state.SkipWithError("the JIT does not support this platform");
+        return;
+    }
+    const auto module = lower(straight_line_source(state.range(0)));
+    auto ssa = impulse::ir::build_ssa(find_function(module, "chain"));
+    (void)impulse::ir::optimize_ssa(ssa);
+    const std::vector<std::string> parameters{"x"};
+    for (auto _ : state) {
+        impulse::jit::JitCompiler compiler;
+        auto compiled = compiler.compile_with_buffer(ssa, parameters);
+        if (compiled.first == nullptr) {
+            state.SkipWithError("compilation failed");
+            return;
+        }
+        benchmark::DoNotOptimize(compiled.first);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JitCompile)->Arg(16)->Arg(256)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
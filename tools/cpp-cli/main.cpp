@@ -1,16 +1,22 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <utility>
 
+#include <unistd.h>
+
 #include "impulse/frontend/dump.h"
 #include "impulse/frontend/lowering.h"
 #include "impulse/frontend/parser.h"
@@ -18,7 +24,12 @@
 #include "impulse/ir/analysis.h"
 #include "impulse/ir/dump.h"
 #include "impulse/ir/interpreter.h"
+#include "impulse/ir/optimizer.h"
+#include "impulse/ir/purity.h"
+#include "impulse/runtime/profile_export.h"
 #include "impulse/runtime/runtime.h"
+#include "impulse/runtime/serve.h"
+#include "impulse/runtime/trace_writer.h"
 
 namespace {
 
@@ -33,6 +44,7 @@ struct Options {
     bool check = false;
     bool evaluate = false;
     bool run = false;
+    bool serve = false;
     std::optional<std::string> evalBinding;
     std::optional<std::string> entryBinding;
     DumpOption dumpTokens;
@@ -42,10 +54,29 @@ struct Options {
     DumpOption dumpSsa;
     DumpOption dumpOptimisationLog;
     DumpOption traceRuntime;
+    bool binaryTrace = false;
+    std::uint64_t traceRing = 0;
+    std::optional<std::string> decodeTrace;
+    std::optional<std::string> decodeTraceOut;
+    DumpOption profile;
+    std::optional<std::string> profileOut;
+    impulse::runtime::ProfileFormat profileFormat = impulse::runtime::ProfileFormat::Json;
     bool useProcessStdin = false;
     std::optional<std::string> stdinFile;
     std::optional<std::string> stdinText;
     bool jitEnabled = true;
+    bool backgroundJit = false;
+    bool memoize = false;
+    std::optional<std::uint64_t> tierCalls;
+    std::optional<std::uint64_t> tierBackEdges;
+    std::uint64_t loadThreads = 0;
+    std::uint64_t gcThreads = 1;
+    std::uint64_t parallelThreads = 0;
+    std::optional<std::string> cacheDir;
+    std::optional<std::string> aotOut;
+    std::optional<std::string> precompiled;
+    impulse::jit::JitSymbolOptions jitSymbols;
+    impulse::ir::OptimizationOptions passes;
     bool showTime = false;
 };
 
@@ -57,10 +88,30 @@ void printUsage() {
                  "  --check                           Run semantic checks only\n"
                  "  --evaluate [--eval-binding <name>] Evaluate constant bindings\n"
                  "  --run [--entry-binding <name>]    Execute the program\n"
+                 "  --serve                           Load once, then run each request read from stdin\n"
+                 "                                    (\"run <entry> <n>\" and n bytes of input; replies\n"
+                 "                                    \"exit <code> <n>\" or \"error <n>\" and n bytes of output)\n"
                  "\n"
                  "Execution options:\n"
                  "  --jit                             Enable JIT compilation (default)\n"
                  "  --no-jit                          Disable JIT compilation\n"
+                 "  --background-jit                  Compile hot functions on a background thread\n"
+                 "  --memoize                         Keep the results of hot pure functions by argument\n"
+                 "  --tier-calls <n>                  Compile a function after n calls (default 2)\n"
+                 "  --tier-back-edges <n>             Compile a function after n loop back-edges (default 1000)\n"
+                 "  --load-threads <n>                Build and compile every function on n threads at load\n"
+                 "  --gc-threads <n>                  Mark and sweep full collections on n threads (default 1)\n"
+                 "  --parallel-threads <n>            Run parallel_for and array_map_parallel on n threads\n"
+                 "                                    (default: one per core)\n"
+                 "  --cache-dir <path>                Reuse compiled SSA and machine code cached under path\n"
+                 "  --aot <out.o>                     Compile every function the JIT accepts into an ELF object\n"
+                 "                                    and exit\n"
+                 "  --precompiled <in.o>              Bind the machine code of an --aot object at load\n"
+                 "  --jit-symbols <tools>             Name compiled code for perf, jitdump and/or gdb\n"
+                 "                                    (comma-separated; files go to /tmp)\n"
+                 "  --disable-pass <name>             Skip an SSA pass: fold-calls, inline, tail-calls,\n"
+                 "                                    sccp, copy-propagation, gvn, licm,\n"
+                 "                                    strength-reduction, scalar-replacement or dce\n"
                  "  --time                            Show execution time\n"
                  "\n"
                  "Introspection options (optional path argument writes to file):\n"
@@ -71,6 +122,12 @@ void printUsage() {
                  "  --dump-ssa [path]                 Dump SSA before/after optimisation\n"
                  "  --dump-optimisation-log [path]    Dump optimiser pass summary\n"
                  "  --trace-runtime [path]            Dump SSA execution trace during run\n"
+                 "  --trace-format=<format>           Trace as text (default) or binary (needs a path)\n"
+                 "  --trace-ring <n>                  Binary trace keeping only the last n 1 MiB segments\n"
+                 "  --decode-trace <in> [path]        Print a binary trace as text and exit\n"
+                 "  --profile [path]                  Count SSA block entries during run, hottest first\n"
+                 "  --profile-out <path>              Time every call during run and export the profile\n"
+                 "  --profile-format=<format>         Export as json (default), chrome (trace events) or pprof\n"
                  "\n"
                  "Runtime input options:\n"
                  "  --stdin                           Read program input from process stdin\n"
@@ -109,6 +166,30 @@ auto write_dump(const DumpOption& option, const std::string& label,
     return true;
 }
 
+// Every block with its counts; the hottest ones also list their instructions
+void writeBlockProfile(std::ostream& out, const std::vector<impulse::runtime::BlockProfile>& profile) {
+    constexpr std::size_t kListedBlocks = 10;
+    std::uint64_t total = 0;
+    for (const auto& block : profile) {
+        total += block.instructions;
+    }
+    out << "Block profile: " << total << " instructions in " << profile.size() << " blocks\n";
+    out << std::right << std::setw(14) << "instructions" << std::setw(8) << "%" << std::setw(12) << "entries"
+        << "  block\n";
+    for (std::size_t i = 0; i < profile.size(); ++i) {
+        const auto& block = profile[i];
+        const double share = total != 0 ? 100.0 * static_cast<double>(block.instructions) / static_cast<double>(total) : 0.0;
+        out << std::setw(14) << block.instructions << std::setw(7) << std::fixed << std::setprecision(1) << share
+            << '%' << std::setw(12) << block.entries << "  " << block.function << " #" << block.block << " ("
+            << block.label << ")\n";
+        if (i < kListedBlocks) {
+            for (const auto& line : block.code) {
+                out << std::setw(36) << "" << line << '\n';
+            }
+        }
+    }
+}
+
 auto parseArgs(int argc, char** argv) -> std::optional<Options> {
     Options opts;
     for (int i = 1; i < argc; ++i) {
@@ -161,6 +242,67 @@ auto parseArgs(int argc, char** argv) -> std::optional<Options> {
             opts.run = true;
             continue;
         }
+        if (arg == "--trace-format" || arg.rfind("--trace-format=", 0) == 0) {
+            std::string format;
+            if (arg == "--trace-format") {
+                if (i + 1 >= argc) {
+                    std::cerr << "Missing value for --trace-format\n";
+                    return std::nullopt;
+                }
+                format = argv[++i];
+            } else {
+                format = arg.substr(std::string{"--trace-format="}.size());
+            }
+            if (format != "text" && format != "binary") {
+                std::cerr << "Unknown trace format: " << format << '\n';
+                return std::nullopt;
+            }
+            opts.binaryTrace = format == "binary";
+            continue;
+        }
+        if (arg == "--decode-trace") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --decode-trace\n";
+                return std::nullopt;
+            }
+            opts.decodeTrace = argv[++i];
+            opts.decodeTraceOut = parseOptionalOutputPath(argc, argv, i);
+            continue;
+        }
+        if (arg == "--profile") {
+            opts.profile.enabled = true;
+            opts.profile.path = parseOptionalOutputPath(argc, argv, i);
+            opts.run = true;
+            continue;
+        }
+        if (arg == "--profile-out") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --profile-out\n";
+                return std::nullopt;
+            }
+            opts.profileOut = argv[++i];
+            opts.run = true;
+            continue;
+        }
+        if (arg == "--profile-format" || arg.rfind("--profile-format=", 0) == 0) {
+            std::string format;
+            if (arg == "--profile-format") {
+                if (i + 1 >= argc) {
+                    std::cerr << "Missing value for --profile-format\n";
+                    return std::nullopt;
+                }
+                format = argv[++i];
+            } else {
+                format = arg.substr(std::string{"--profile-format="}.size());
+            }
+            const auto parsed = impulse::runtime::parse_profile_format(format);
+            if (!parsed.has_value()) {
+                std::cerr << "Unknown profile format: " << format << '\n';
+                return std::nullopt;
+            }
+            opts.profileFormat = *parsed;
+            continue;
+        }
         if (arg == "--check") {
             opts.check = true;
             continue;
@@ -182,6 +324,10 @@ auto parseArgs(int argc, char** argv) -> std::optional<Options> {
             opts.run = true;
             continue;
         }
+        if (arg == "--serve") {
+            opts.serve = true;
+            continue;
+        }
         if (arg == "--entry-binding") {
             if (i + 1 >= argc) {
                 std::cerr << "Missing value for --entry-binding\n";
@@ -223,6 +369,88 @@ auto parseArgs(int argc, char** argv) -> std::optional<Options> {
             opts.jitEnabled = false;
             continue;
         }
+        if (arg == "--background-jit") {
+            opts.backgroundJit = true;
+            continue;
+        }
+        if (arg == "--memoize") {
+            opts.memoize = true;
+            continue;
+        }
+        if (arg == "--tier-calls" || arg == "--tier-back-edges" || arg == "--load-threads" ||
+            arg == "--gc-threads" || arg == "--parallel-threads" || arg == "--trace-ring") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << '\n';
+                return std::nullopt;
+            }
+            const std::string value{argv[++i]};
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Invalid value for " << arg << ": " << value << '\n';
+                return std::nullopt;
+            }
+            if (arg == "--load-threads") {
+                opts.loadThreads = std::stoull(value);
+            } else if (arg == "--gc-threads") {
+                opts.gcThreads = std::stoull(value);
+            } else if (arg == "--parallel-threads") {
+                opts.parallelThreads = std::stoull(value);
+            } else if (arg == "--trace-ring") {
+                opts.traceRing = std::stoull(value);
+                opts.binaryTrace = true;
+            } else {
+                (arg == "--tier-calls" ? opts.tierCalls : opts.tierBackEdges) = std::stoull(value);
+            }
+            continue;
+        }
+        if (arg == "--cache-dir") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --cache-dir\n";
+                return std::nullopt;
+            }
+            opts.cacheDir = argv[++i];
+            continue;
+        }
+        if (arg == "--aot" || arg == "--precompiled") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << '\n';
+                return std::nullopt;
+            }
+            (arg == "--aot" ? opts.aotOut : opts.precompiled) = argv[++i];
+            continue;
+        }
+        if (arg == "--jit-symbols") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --jit-symbols\n";
+                return std::nullopt;
+            }
+            std::stringstream tools{argv[++i]};
+            std::string tool;
+            while (std::getline(tools, tool, ',')) {
+                if (tool == "perf") {
+                    opts.jitSymbols.perf_map = true;
+                } else if (tool == "jitdump") {
+                    opts.jitSymbols.jitdump = true;
+                } else if (tool == "gdb") {
+                    opts.jitSymbols.gdb = true;
+                } else {
+                    std::cerr << "Unknown --jit-symbols tool: " << tool << '\n';
+                    return std::nullopt;
+                }
+            }
+            continue;
+        }
+        if (arg == "--disable-pass") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --disable-pass\n";
+                return std::nullopt;
+            }
+            const std::string pass{argv[++i]};
+            if (!impulse::ir::disable_optimization_pass(opts.passes, pass)) {
+                std::cerr << "Unknown optimisation pass: " << pass << '\n';
+                return std::nullopt;
+            }
+            continue;
+        }
         if (arg == "--time") {
             opts.showTime = true;
             continue;
@@ -231,10 +459,17 @@ auto parseArgs(int argc, char** argv) -> std::optional<Options> {
         return std::nullopt;
     }
 
+    if (opts.decodeTrace.has_value()) {
+        return opts;
+    }
     if (opts.filePath.empty()) {
         std::cerr << "--file is required\n";
         return std::nullopt;
     }
+    if (opts.binaryTrace && (!opts.traceRuntime.enabled || !opts.traceRuntime.path.has_value())) {
+        std::cerr << "A binary trace needs --trace-runtime <path>\n";
+        return std::nullopt;
+    }
 
     const int stdinSources = static_cast<int>(opts.useProcessStdin) + (opts.stdinFile.has_value() ? 1 : 0) +
                              (opts.stdinText.has_value() ? 1 : 0);
@@ -242,6 +477,15 @@ auto parseArgs(int argc, char** argv) -> std::optional<Options> {
         std::cerr << "Specify at most one of --stdin, --stdin-file, or --stdin-text\n";
         return std::nullopt;
     }
+    if (opts.aotOut.has_value() && !opts.jitEnabled) {
+        std::cerr << "--aot needs the JIT\n";
+        return std::nullopt;
+    }
+    if (opts.serve && (stdinSources != 0 || opts.entryBinding.has_value() || opts.traceRuntime.enabled ||
+                       opts.profile.enabled || opts.profileOut.has_value())) {
+        std::cerr << "--serve takes entries and input from its requests and cannot trace or profile\n";
+        return std::nullopt;
+    }
 
     return opts;
 }
@@ -290,6 +534,40 @@ auto joinModulePath(const std::vector<std::string>& path) -> std::string {
     return builder.str();
 }
 
+void configureVm(impulse::runtime::Vm& vm, const Options& options) {
+    vm.set_jit_enabled(options.jitEnabled);
+    vm.set_background_compilation(options.backgroundJit);
+    vm.set_memoization(options.memoize);
+    vm.set_optimization_options(options.passes);
+    impulse::runtime::TierThresholds thresholds = vm.tier_thresholds();
+    thresholds.calls = options.tierCalls.value_or(thresholds.calls);
+    thresholds.back_edges = options.tierBackEdges.value_or(thresholds.back_edges);
+    vm.set_tier_thresholds(thresholds);
+    if (options.cacheDir.has_value()) {
+        vm.set_code_cache_directory(*options.cacheDir);
+    }
+    vm.set_jit_symbols(options.jitSymbols);
+    vm.set_gc_threads(options.gcThreads);
+    vm.set_parallel_threads(options.parallelThreads);
+    if (options.precompiled.has_value()) {
+        vm.set_precompiled_code(*options.precompiled);
+    }
+}
+
+// Load diagnostics; false when the module did not load
+auto reportLoad(const impulse::runtime::VmLoadResult& result, const Options& options) -> bool {
+    if (!result.success) {
+        for (const auto& diag : result.diagnostics) {
+            std::cerr << "runtime load error: " << diag << '\n';
+        }
+        return false;
+    }
+    if (options.precompiled.has_value() && result.functions_precompiled == 0) {
+        std::cerr << "warning: '" << *options.precompiled << "' has no code for this module and build\n";
+    }
+    return true;
+}
+
 }  // namespace
 
 auto main(int argc, char** argv) -> int {
@@ -298,17 +576,34 @@ auto main(int argc, char** argv) -> int {
         return 1;
     }
 
+    if (options->decodeTrace.has_value()) {
+        std::ifstream in(*options->decodeTrace, std::ios::binary);
+        if (!in) {
+            std::cerr << "Failed to open runtime trace '" << *options->decodeTrace << "'\n";
+            return 1;
+        }
+        bool decoded = false;
+        if (!write_dump(DumpOption{true, options->decodeTraceOut}, "decoded trace",
+                        [&](std::ostream& out) { decoded = impulse::runtime::decode_trace(in, out); })) {
+            return 1;
+        }
+        if (!decoded) {
+            std::cerr << "'" << *options->decodeTrace << "' is not a complete binary runtime trace\n";
+            return 2;
+        }
+        return 0;
+    }
+
     const auto source = readFile(options->filePath);
     if (!source.has_value()) {
         std::cerr << "Failed to read file: " << options->filePath << '\n';
         return 1;
     }
 
-    impulse::frontend::Lexer dumpLexer(*source);
-    const auto tokens = dumpLexer.tokenize();
-
+    // The parser lexes on its own; only a token dump needs them all at once
     if (!write_dump(options->dumpTokens, "token", [&](std::ostream& out) {
-            impulse::frontend::dump_tokens(tokens, out);
+            impulse::frontend::Lexer dumpLexer(*source);
+            impulse::frontend::dump_tokens(dumpLexer.tokenize(), out);
         })) {
         return 1;
     }
@@ -354,7 +649,7 @@ auto main(int argc, char** argv) -> int {
     std::optional<std::vector<impulse::ir::FunctionAnalysis>> analysedFunctions;
     auto ensureAnalysedFunctions = [&]() -> const std::vector<impulse::ir::FunctionAnalysis>& {
         if (!analysedFunctions.has_value()) {
-            analysedFunctions = impulse::ir::analyse_module(ensureLoweredModule());
+            analysedFunctions = impulse::ir::analyse_module(ensureLoweredModule(), options->passes);
         }
         return *analysedFunctions;
     };
@@ -411,8 +706,10 @@ auto main(int argc, char** argv) -> int {
         evaluations.reserve(lowered.bindings.size());
         bool evalSuccess = true;
 
+        // Calls to pure functions are evaluated as the Vm does at load
+        impulse::ir::CallEvaluator calls(lowered, impulse::ir::find_pure_functions(lowered), environment);
         for (const auto& binding : lowered.bindings) {
-            auto eval = impulse::ir::interpret_binding(binding, environment);
+            auto eval = impulse::ir::interpret_binding(binding, environment, &calls);
             if (eval.status == impulse::ir::EvalStatus::Success && eval.value.has_value()) {
                 environment.emplace(binding.name, *eval.value);
             } else if (eval.status == impulse::ir::EvalStatus::Error) {
@@ -432,6 +729,57 @@ auto main(int argc, char** argv) -> int {
         return 0;
     }
 
+    // The VM takes the IR over, and the syntax tree goes in one piece with its arena
+    auto loadInto = [&](impulse::runtime::Vm& vm) -> std::optional<std::string> {
+        auto moduleName = joinModulePath(ensureLoweredModule().path);
+        const auto loadResult = vm.load(std::move(*loweredModule));
+        loweredModule.reset();
+        parseResult.module = {};
+        if (!reportLoad(loadResult, *options)) {
+            return std::nullopt;
+        }
+        return moduleName;
+    };
+
+    if (options->aotOut.has_value()) {
+        if (!runSemantic().has_value()) {
+            return 2;
+        }
+        impulse::runtime::Vm vm;
+        configureVm(vm, *options);
+        vm.set_eager_loading(std::max<std::uint64_t>(options->loadThreads, 1));
+        const std::size_t functions = ensureLoweredModule().functions.size();
+        const auto moduleName = loadInto(vm);
+        if (!moduleName.has_value()) {
+            return 2;
+        }
+        const auto written = vm.write_precompiled_code(*moduleName, *options->aotOut);
+        if (!written.has_value()) {
+            std::cerr << "Failed to write ahead-of-time object '" << *options->aotOut << "'\n";
+            return 1;
+        }
+        std::cout << "Compiled " << *written << " of " << functions << " functions into " << *options->aotOut << '\n';
+        return 0;
+    }
+
+    if (options->serve) {
+        if (!runSemantic().has_value()) {
+            return 2;
+        }
+        impulse::runtime::Vm vm;
+        configureVm(vm, *options);
+        vm.set_eager_loading(options->loadThreads);
+        const auto moduleName = loadInto(vm);
+        if (!moduleName.has_value()) {
+            return 2;
+        }
+        const int status = impulse::runtime::serve_requests(vm, *moduleName, std::cin, std::cout, std::cerr);
+        if (options->cacheDir.has_value() && !vm.save_code_cache()) {
+            std::cerr << "warning: failed to write code cache under '" << *options->cacheDir << "'\n";
+        }
+        return status;
+    }
+
     if (options->run || options->entryBinding.has_value()) {
         const auto semantic = runSemantic();
         if (!semantic.has_value()) {
@@ -444,59 +792,81 @@ auto main(int argc, char** argv) -> int {
         bool triedRuntime = false;
         if (loweredModule.has_value()) {
             impulse::runtime::Vm vm;
-            vm.set_jit_enabled(options->jitEnabled);
+            configureVm(vm, *options);
 
-            std::ifstream stdinFileStream;
-            std::istringstream stdinTextStream;
+            std::unique_ptr<impulse::runtime::InputSource> input;
             if (options->stdinText.has_value()) {
-                stdinTextStream.str(*options->stdinText);
-                stdinTextStream.clear();
-                vm.set_input_stream(&stdinTextStream);
+                input = std::make_unique<impulse::runtime::InputSource>(*options->stdinText);
             } else if (options->stdinFile.has_value()) {
-                stdinFileStream.open(options->stdinFile->c_str(), std::ios::in);
-                if (!stdinFileStream.is_open()) {
+                input = impulse::runtime::InputSource::open_file(*options->stdinFile);
+                if (input == nullptr) {
                     std::cerr << "Failed to open stdin file '" << *options->stdinFile << "'\n";
                     return 2;
                 }
-                vm.set_input_stream(&stdinFileStream);
             } else if (options->useProcessStdin) {
-                vm.set_input_stream(&std::cin);
+                input = std::make_unique<impulse::runtime::InputSource>(STDIN_FILENO);
             }
+            vm.set_input_source(input.get());
 
             std::ofstream traceFile;
             std::ostringstream traceBuffer;
             std::ostream* traceStream = nullptr;
+            std::optional<impulse::runtime::TraceWriter> traceWriter;
             bool traceToBuffer = false;
 
             if (options->traceRuntime.enabled) {
                 if (options->traceRuntime.path.has_value()) {
-                    traceFile.open(options->traceRuntime.path->c_str(), std::ios::out | std::ios::trunc);
+                    traceFile.open(options->traceRuntime.path->c_str(),
+                                   std::ios::out | std::ios::trunc | std::ios::binary);
                     if (!traceFile.is_open()) {
                         std::cerr << "Failed to open runtime trace output '" << *options->traceRuntime.path << "'\n";
                         return 2;
                     }
-                    traceStream = &traceFile;
+                    if (options->binaryTrace) {
+                        impulse::runtime::TraceWriter::Options traceOptions;
+                        traceOptions.ring_segments = static_cast<std::size_t>(options->traceRing);
+                        traceWriter.emplace(traceFile, traceOptions);
+                    } else {
+                        traceStream = &traceFile;
+                    }
                 } else {
                     traceStream = &traceBuffer;
                     traceToBuffer = true;
                 }
             }
 
-            const auto loadResult = vm.load(*loweredModule);
-            if (!loadResult.success) {
-                for (const auto& diag : loadResult.diagnostics) {
-                    std::cerr << "runtime load error: " << diag << '\n';
-                }
-            } else {
+            // A trace has to see every call, which compiled and inlined code would hide
+            const bool tracing = traceStream != nullptr || traceWriter.has_value();
+            vm.set_eager_loading(tracing ? 0 : options->loadThreads);
+            const auto moduleName = loadInto(vm);
+            if (moduleName.has_value()) {
                 triedRuntime = true;
                 if (traceStream != nullptr) {
                     vm.set_trace_stream(traceStream);
                 }
-                const auto moduleName = joinModulePath(loweredModule->path);
+                if (traceWriter.has_value()) {
+                    vm.set_trace_writer(&*traceWriter);
+                }
+                vm.set_block_profiling_enabled(options->profile.enabled);
+                vm.set_profiling_enabled(options->profileOut.has_value());
+                // Program output streams to stdout, except behind a buffered trace that prints first
+                std::optional<impulse::runtime::OutputSink> stdoutSink;
+                if (!traceToBuffer) {
+                    std::cout.flush();
+                    stdoutSink.emplace(STDOUT_FILENO);
+                    vm.set_output_sink(&*stdoutSink);
+                }
                 const auto startTime = std::chrono::high_resolution_clock::now();
-                const auto vmResult = vm.run(moduleName, entry);
+                const auto vmResult = vm.run(*moduleName, entry);
                 const auto endTime = std::chrono::high_resolution_clock::now();
                 const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+                if (options->cacheDir.has_value() && !vm.save_code_cache()) {
+                    std::cerr << "warning: failed to write code cache under '" << *options->cacheDir << "'\n";
+                }
+                if (traceWriter.has_value()) {
+                    vm.set_trace_writer(nullptr);
+                    traceWriter->flush();
+                }
                 if (traceStream != nullptr) {
                     vm.set_trace_stream(nullptr);
                     if (traceToBuffer) {
@@ -511,8 +881,25 @@ auto main(int argc, char** argv) -> int {
                         traceFile.flush();
                     }
                 }
+                vm.set_output_sink(nullptr);
+                const auto writeProfile = [&]() {
+                    if (options->profileOut.has_value()) {
+                        std::ofstream file(*options->profileOut, std::ios::binary | std::ios::trunc);
+                        if (!file) {
+                            std::cerr << "Failed to open '" << *options->profileOut << "' for profile output\n";
+                            return false;
+                        }
+                        impulse::runtime::write_profile(vm.get_profile_report(), options->profileFormat, file);
+                    }
+                    return write_dump(options->profile, "profile", [&](std::ostream& out) {
+                        writeBlockProfile(out, vm.get_block_profile());
+                    });
+                };
                 if (vmResult.status == impulse::runtime::VmStatus::Success && vmResult.has_value) {
-                    // Print program output (from println/print calls)
+                    // Print program output (from println/print calls) unless it was streamed
+                    if (stdoutSink.has_value() && !stdoutSink->at_line_start()) {
+                        std::cout << '\n';
+                    }
                     if (!vmResult.message.empty()) {
                         std::cout << vmResult.message;
                         if (vmResult.message.back() != '\n') {
@@ -524,6 +911,9 @@ auto main(int argc, char** argv) -> int {
                     if (options->showTime) {
                         std::cout << "Execution time: " << elapsedMs << " ms\n";
                     }
+                    if (!writeProfile()) {
+                        return 1;
+                    }
                     return evalSuccess ? 0 : 2;
                 }
                 if (vmResult.status != impulse::runtime::VmStatus::MissingSymbol) {
@@ -532,11 +922,12 @@ auto main(int argc, char** argv) -> int {
                         reason = "runtime execution failed";
                     }
                     std::cerr << "Entry function '" << entry << "' failed: " << reason << '\n';
-                    vm.set_input_stream(nullptr);
+                    vm.set_input_source(nullptr);
+                    static_cast<void>(writeProfile());
                     return 2;
                 }
             }
-            vm.set_input_stream(nullptr);
+            vm.set_input_source(nullptr);
         }
 
         const auto it = std::find_if(evaluations.begin(), evaluations.end(), [&](const auto& pair) {